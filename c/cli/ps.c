@@ -4,20 +4,45 @@
 #include <string.h>
 #include <unistd.h>
 #include <time.h>
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
 
 #include "../frontend.h"
 #include "../runtime/ps_vm.h"
 #include "../runtime/ps_runtime.h"
 #include "../runtime/ps_errors.h"
 #include "../runtime/ps_list.h"
+#include "../runtime/ps_profile.h"
 #include "../diag.h"
 
 #ifndef PATH_MAX
 #define PATH_MAX 4096
 #endif
 
+// Values allocated between two cycle collections with a bare --gc-cycles.
+#define PS_GC_DEFAULT_THRESHOLD 10000
+// Values destroyed per VM block boundary with a bare --free-budget.
+#define PS_FREE_DEFAULT_BUDGET 1000
+
 static const char *g_last_run_file = NULL;
 
+// Runtime side of the `--time` breakdown (the frontend keeps its own).
+typedef struct {
+  uint64_t ir_load_ns;
+  uint64_t exec_ns;
+  uint64_t teardown_ns;
+  size_t ir_instructions;
+} RunTimes;
+
+static RunTimes g_times;
+
+static uint64_t mono_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
 static void usage(void) {
   fprintf(stderr, "Usage:\n");
   fprintf(stderr, "  ps run <file> [args...]\n");
@@ -27,7 +52,9 @@ static void usage(void) {
   fprintf(stderr, "  ps ast <file>\n");
   fprintf(stderr, "  ps ir <file>\n");
   fprintf(stderr, "Options:\n");
-  fprintf(stderr, "  --help, --version, --trace, --trace-ir, --time\n");
+  fprintf(stderr, "  --help, --version, --trace, --trace-ir, --time[=json], --no-fuse, --profile[=<file.json>],\n");
+  fprintf(stderr, "  --sample-profile=<file.folded|file.json>, --max-heap=<N>[K|M|G], --heap-report[=<file>],\n");
+  fprintf(stderr, "  --gc-cycles[=<allocations>], --free-budget[=<values>]\n");
 }
 
 static void print_diag(FILE *out, const char *fallback_file, const PsDiag *d) {
@@ -39,8 +66,9 @@ static const char *exc_string(PS_Value *v) {
   return v->as.string_v.ptr ? v->as.string_v.ptr : "";
 }
 
-static void print_exception(FILE *out, const char *fallback_file, PS_Value *ex) {
+static void print_exception(PS_Context *ctx, FILE *out, const char *fallback_file, PS_Value *ex) {
   if (!ex || ex->tag != PS_V_EXCEPTION) return;
+  ps_exception_resolve(ctx, ex);
   const char *tn = ex->as.exc_v.type_name ? ex->as.exc_v.type_name : (ex->as.exc_v.is_runtime ? "RuntimeException" : "Exception");
   const char *raw = exc_string(ex->as.exc_v.file);
   if (tn && strcmp(tn, "Utf8DecodeException") == 0) raw = "ps_tmp";
@@ -119,7 +147,11 @@ static PS_IR_Module *load_ir_from_file(PS_Context *ctx, const char *file) {
     return NULL;
   }
   buf[len] = '\0';
-  PS_IR_Module *m = ps_ir_load_json(ctx, buf, len);
+  uint64_t t0 = mono_ns();
+  uint64_t mod0 = ctx->module_load_ns;
+  PS_IR_Module *m = ps_ir_load_json_insitu(ctx, buf, len);
+  g_times.ir_load_ns += mono_ns() - t0 - (ctx->module_load_ns - mod0);
+  g_times.ir_instructions += ps_ir_instr_count(m);
   free(buf);
   return m;
 #else
@@ -137,7 +169,11 @@ static PS_IR_Module *load_ir_from_file(PS_Context *ctx, const char *file) {
     free(buf);
     return NULL;
   }
-  PS_IR_Module *m = ps_ir_load_json(ctx, buf, len);
+  uint64_t t0 = mono_ns();
+  uint64_t mod0 = ctx->module_load_ns;
+  PS_IR_Module *m = ps_ir_load_json_insitu(ctx, buf, len);
+  g_times.ir_load_ns += mono_ns() - t0 - (ctx->module_load_ns - mod0);
+  g_times.ir_instructions += ps_ir_instr_count(m);
   free(buf);
   return m;
 #endif
@@ -172,8 +208,13 @@ static int run_file(PS_Context *ctx, const char *file, PS_Value *args_list, PS_V
     argvs[0] = args_list;
     argc = 1;
   }
+  uint64_t t0 = mono_ns();
+  uint64_t mod0 = ctx->module_load_ns;
   int rc = ps_vm_run_main(ctx, m, argvs, argc, out_ret);
+  uint64_t t1 = mono_ns();
   ps_ir_free(m);
+  g_times.exec_ns += t1 - t0 - (ctx->module_load_ns - mod0);
+  g_times.teardown_ns += mono_ns() - t1;
   return rc;
 }
 
@@ -187,9 +228,73 @@ static int static_check_before_run(const char *file) {
   return 0;
 }
 
+// Native modules load lazily from IR load or execution; their time is already
+// taken out of those phases (see load_ir_from_file/run_file).
+static void print_times(int json, uint64_t total_ns, uint64_t module_ns, size_t modules_loaded) {
+  static const char *const names[] = {"preprocess", "lex", "parse", "analyze", "ir_emit",
+                                      "ir_load", "module_load", "exec", "teardown", "other"};
+  PsFrontendStats fs;
+  ps_frontend_stats(&fs);
+  double ms[10];
+  double accounted = 0.0;
+  for (int i = 0; i < PS_FRONTEND_PHASE_COUNT; i++) ms[i] = fs.ms[i];
+  ms[5] = g_times.ir_load_ns / 1e6;
+  ms[6] = module_ns / 1e6;
+  ms[7] = g_times.exec_ns / 1e6;
+  ms[8] = g_times.teardown_ns / 1e6;
+  for (int i = 0; i < 9; i++) accounted += ms[i];
+  double total = total_ns / 1e6;
+  ms[9] = total > accounted ? total - accounted : 0.0;
+  unsigned long long counts[] = {(unsigned long long)fs.files, (unsigned long long)fs.tokens,
+                                 (unsigned long long)fs.ast_nodes, (unsigned long long)g_times.ir_instructions,
+                                 (unsigned long long)ps_value_alloc_total(), (unsigned long long)ps_value_live_peak(),
+                                 (unsigned long long)modules_loaded};
+  static const char *const count_names[] = {"files", "tokens", "ast_nodes", "ir_instructions",
+                                            "values_allocated", "peak_live_values", "modules_loaded"};
+  if (json) {
+    fprintf(stderr, "{\"total_ms\":%.3f,\"phases\":{", total);
+    for (int i = 0; i < 10; i++) fprintf(stderr, "%s\"%s\":%.3f", i ? "," : "", names[i], ms[i]);
+    fprintf(stderr, "},\"counts\":{");
+    for (int i = 0; i < 7; i++) fprintf(stderr, "%s\"%s\":%llu", i ? "," : "", count_names[i], counts[i]);
+    fprintf(stderr, "}}\n");
+    return;
+  }
+  fprintf(stderr, "time: %.2f ms\n", total);
+  for (int i = 0; i < 10; i++) fprintf(stderr, "  %-16s %10.3f ms\n", names[i], ms[i]);
+  for (int i = 0; i < 7; i++) fprintf(stderr, "  %-16s %10llu\n", count_names[i], counts[i]);
+}
+
+// "512M" -> bytes. 0 on a malformed or zero size.
+static size_t parse_heap_size(const char *s) {
+  char *end = NULL;
+  unsigned long long n = strtoull(s, &end, 10);
+  if (end == s) return 0;
+  unsigned shift = 0;
+  if (*end == 'K' || *end == 'k') shift = 10;
+  else if (*end == 'M' || *end == 'm') shift = 20;
+  else if (*end == 'G' || *end == 'g') shift = 30;
+  if (shift) end++;
+  if (*end != '\0' || n > (SIZE_MAX >> shift)) return 0;
+  return (size_t)(n << shift);
+}
+
+// Positive decimal count, 0 when invalid.
+static size_t parse_count(const char *s) {
+  char *end = NULL;
+  unsigned long long n = strtoull(s, &end, 10);
+  if (end == s || *end != '\0' || n > SIZE_MAX) return 0;
+  return (size_t)n;
+}
+
 static int is_cli_option(const char *arg) {
   return strcmp(arg, "--help") == 0 || strcmp(arg, "--version") == 0 || strcmp(arg, "--trace") == 0 ||
-         strcmp(arg, "--trace-ir") == 0 || strcmp(arg, "--time") == 0;
+         strcmp(arg, "--trace-ir") == 0 || strcmp(arg, "--time") == 0 || strcmp(arg, "--time=json") == 0 ||
+         strcmp(arg, "--no-fuse") == 0 ||
+         strcmp(arg, "--profile") == 0 || strncmp(arg, "--profile=", 10) == 0 ||
+         strncmp(arg, "--sample-profile=", 17) == 0 || strncmp(arg, "--max-heap=", 11) == 0 ||
+         strcmp(arg, "--heap-report") == 0 || strncmp(arg, "--heap-report=", 14) == 0 ||
+         strcmp(arg, "--gc-cycles") == 0 || strncmp(arg, "--gc-cycles=", 12) == 0 ||
+         strcmp(arg, "--free-budget") == 0 || strncmp(arg, "--free-budget=", 14) == 0;
 }
 
 static int is_cli_command(const char *arg) {
@@ -224,6 +329,15 @@ int main(int argc, char **argv) {
   int trace = 0;
   int trace_ir = 0;
   int do_time = 0;
+  int no_fuse = 0;
+  int profile = 0;
+  const char *profile_out = NULL;
+  const char *sample_out = NULL;
+  size_t max_heap = 0;
+  int heap_report = 0;
+  const char *heap_report_out = NULL;
+  size_t gc_threshold = 0;
+  size_t free_budget = 0;
   int cmd_index = -1;
   for (int i = 1; i < argc; i++) {
     if (strcmp(argv[i], "--help") == 0) {
@@ -237,6 +351,42 @@ int main(int argc, char **argv) {
     if (strcmp(argv[i], "--trace") == 0) trace = 1;
     if (strcmp(argv[i], "--trace-ir") == 0) trace_ir = 1;
     if (strcmp(argv[i], "--time") == 0) do_time = 1;
+    if (strcmp(argv[i], "--time=json") == 0) do_time = 2;
+    if (strcmp(argv[i], "--no-fuse") == 0) no_fuse = 1;
+    if (strcmp(argv[i], "--profile") == 0) profile = 1;
+    if (strncmp(argv[i], "--profile=", 10) == 0) {
+      profile = 1;
+      profile_out = argv[i] + 10;
+    }
+    if (strncmp(argv[i], "--sample-profile=", 17) == 0) sample_out = argv[i] + 17;
+    if (strcmp(argv[i], "--heap-report") == 0) heap_report = 1;
+    if (strncmp(argv[i], "--heap-report=", 14) == 0) {
+      heap_report = 1;
+      heap_report_out = argv[i] + 14;
+    }
+    if (strncmp(argv[i], "--max-heap=", 11) == 0) {
+      max_heap = parse_heap_size(argv[i] + 11);
+      if (!max_heap) {
+        fprintf(stderr, "ps: invalid --max-heap size: %s\n", argv[i] + 11);
+        return 2;
+      }
+    }
+    if (strcmp(argv[i], "--gc-cycles") == 0) gc_threshold = PS_GC_DEFAULT_THRESHOLD;
+    if (strncmp(argv[i], "--gc-cycles=", 12) == 0) {
+      gc_threshold = parse_count(argv[i] + 12);
+      if (!gc_threshold) {
+        fprintf(stderr, "ps: invalid --gc-cycles threshold: %s\n", argv[i] + 12);
+        return 2;
+      }
+    }
+    if (strcmp(argv[i], "--free-budget") == 0) free_budget = PS_FREE_DEFAULT_BUDGET;
+    if (strncmp(argv[i], "--free-budget=", 14) == 0) {
+      free_budget = parse_count(argv[i] + 14);
+      if (!free_budget) {
+        fprintf(stderr, "ps: invalid --free-budget count: %s\n", argv[i] + 14);
+        return 2;
+      }
+    }
     if (cmd_index == -1 && !is_cli_option(argv[i]) && is_cli_command(argv[i])) {
       cmd_index = i;
     }
@@ -250,9 +400,23 @@ int main(int argc, char **argv) {
   if (!ctx) return 2;
   ctx->trace = trace;
   ctx->trace_ir = trace_ir;
+  ctx->no_fuse = no_fuse;
+  if (profile) ctx->profile = ps_profile_create();
+  if (sample_out && *sample_out) ctx->sampler = ps_sampler_create();
+  if (max_heap) ps_heap_set_limit(ctx, max_heap);
+  if (heap_report) ctx->heap.census = ps_census_create();
+  if (gc_threshold) ps_heap_set_gc(ctx, gc_threshold);
+  if (free_budget) {
+    ps_heap_set_free_budget(ctx, free_budget);
+#if defined(__GLIBC__) && defined(M_MXFAST)
+    // glibc consolidates all its fastbin chunks at the next large request:
+    // after a big release that single step costs as much as the destruction
+    // the budget spreads out.
+    mallopt(M_MXFAST, 0);
+#endif
+  }
 
-  struct timespec t0, t1;
-  if (do_time) clock_gettime(CLOCK_MONOTONIC, &t0);
+  uint64_t t0 = do_time ? mono_ns() : 0;
 
   int rc = 0;
   int exit_code = 0;
@@ -336,15 +500,35 @@ int main(int argc, char **argv) {
     rc = 2;
   }
 
-  if (do_time) {
-    clock_gettime(CLOCK_MONOTONIC, &t1);
-    double ms = (t1.tv_sec - t0.tv_sec) * 1000.0 + (t1.tv_nsec - t0.tv_nsec) / 1e6;
-    fprintf(stderr, "time: %.2f ms\n", ms);
+  if (ctx->profile && !static_failure) {
+    if (profile_out && *profile_out) {
+      FILE *pf = fopen(profile_out, "w");
+      if (pf) {
+        ps_profile_write_json(ctx->profile, pf);
+        fclose(pf);
+      } else {
+        fprintf(stderr, "ps: cannot write profile to %s\n", profile_out);
+      }
+    } else {
+      ps_profile_report(ctx->profile, stderr);
+    }
+  }
+
+  if (ctx->sampler && !static_failure) {
+    FILE *sf = fopen(sample_out, "w");
+    if (sf) {
+      size_t n = strlen(sample_out);
+      if (n > 5 && strcmp(sample_out + n - 5, ".json") == 0) ps_sampler_write_chrome(ctx->sampler, sf);
+      else ps_sampler_write_folded(ctx->sampler, sf);
+      fclose(sf);
+    } else {
+      fprintf(stderr, "ps: cannot write sample profile to %s\n", sample_out);
+    }
   }
 
   if (rc != 0) {
     if (ctx->last_exception) {
-      print_exception(stderr, g_last_run_file, ctx->last_exception);
+      print_exception(ctx, stderr, g_last_run_file, ctx->last_exception);
     } else if (ps_last_error_code(ctx) != PS_ERR_NONE) {
       const char *code = NULL;
       const char *cat = ps_runtime_category(ps_last_error_code(ctx), ps_last_error_message(ctx), &code);
@@ -371,6 +555,30 @@ int main(int argc, char **argv) {
   }
 
   if (ret) ps_value_release(ret);
+  if (free_budget) ps_heap_set_free_budget(ctx, 0);
+  if (gc_threshold) ps_heap_collect(ctx);
+  // Values still alive here are held by the context or leaked (cycles).
+  if (ctx->heap.census && !static_failure) {
+    if (heap_report_out && *heap_report_out) {
+      FILE *hf = fopen(heap_report_out, "w");
+      if (hf) {
+        size_t n = strlen(heap_report_out);
+        ps_census_write(ctx->heap.census, hf, n > 5 && strcmp(heap_report_out + n - 5, ".json") == 0);
+        fclose(hf);
+      } else {
+        fprintf(stderr, "ps: cannot write heap report to %s\n", heap_report_out);
+      }
+    } else {
+      ps_census_write(ctx->heap.census, stderr, 0);
+    }
+  }
+  uint64_t module_ns = ctx->module_load_ns;
+  size_t modules_loaded = ctx->modules_loaded;
+  uint64_t t_destroy = do_time ? mono_ns() : 0;
   ps_ctx_destroy(ctx);
+  if (do_time) {
+    g_times.teardown_ns += mono_ns() - t_destroy;
+    print_times(do_time == 2, mono_ns() - t0, module_ns, modules_loaded);
+  }
   return exit_code;
 }
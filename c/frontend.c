@@ -12,6 +12,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <sys/stat.h>
+#include <time.h>
 #include <unistd.h>
 
 #include "runtime/ps_json.h"
@@ -46,6 +47,31 @@ typedef struct PreprocessMapEntry {
 
 static PreprocessMapEntry *g_preprocess_maps = NULL;
 
+// Phase accounting for `ps --time`. Time is charged to the innermost active
+// phase only, so nested frontend passes (imports) are not counted twice.
+static PsFrontendStats g_stats;
+static int g_phase = -1;
+static struct timespec g_phase_mark;
+
+static int phase_enter(int phase) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  if (g_phase >= 0) {
+    g_stats.ms[g_phase] += (double)(now.tv_sec - g_phase_mark.tv_sec) * 1000.0 +
+                           (double)(now.tv_nsec - g_phase_mark.tv_nsec) / 1e6;
+  }
+  int prev = g_phase;
+  g_phase = phase;
+  g_phase_mark = now;
+  return prev;
+}
+
+void ps_frontend_stats(PsFrontendStats *out) {
+  if (!out) return;
+  if (g_phase >= 0) phase_enter(g_phase);
+  *out = g_stats;
+}
+
 static const PreprocessLineMap *preprocess_map_lookup(const char *file) {
   if (!file) return NULL;
   for (PreprocessMapEntry *e = g_preprocess_maps; e; e = e->next) {
@@ -201,6 +227,7 @@ static int token_vec_push(TokenVec *v, Token t) {
 static AstNode *ast_new(const char *kind, const char *text, int line, int col) {
   AstNode *n = (AstNode *)calloc(1, sizeof(AstNode));
   if (!n) return NULL;
+  g_stats.ast_nodes += 1;
   n->kind = strdup(kind ? kind : "Unknown");
   n->text = text ? strdup(text) : NULL;
   n->line = line;
@@ -520,6 +547,11 @@ static int lex_last_is_generic_type_head(Lexer *l) {
   if (!l || l->toks.len == 0) return 0;
   size_t head_idx = l->toks.len - 1;
   Token *t = &l->toks.items[head_idx];
+  // `JSON.decodeAs<T>(...)`: the only call that takes an explicit type argument.
+  if (t->kind == TK_ID && strcmp(t->text, "decodeAs") == 0 && head_idx > 0 &&
+      l->toks.items[head_idx - 1].kind == TK_SYM && strcmp(l->toks.items[head_idx - 1].text, ".") == 0) {
+    return 1;
+  }
   if (t->kind != TK_KW) return 0;
   if (!(strcmp(t->text, "list") == 0 || strcmp(t->text, "map") == 0 ||
         strcmp(t->text, "slice") == 0 || strcmp(t->text, "view") == 0)) {
@@ -1852,6 +1884,31 @@ static int parse_postfix_expr(Parser *p, AstNode **out) {
         return 0;
       }
       expr = mem;
+      size_t type_end = 0;
+      if (strcmp(name->text, "decodeAs") == 0 && p_at(p, TK_SYM, "<") && scan_type_from(p, p->i + 1, &type_end) &&
+          type_end + 1 < p->toks->len && p->toks->items[type_end].kind == TK_SYM &&
+          strcmp(p->toks->items[type_end].text, ">") == 0 && p->toks->items[type_end + 1].kind == TK_SYM &&
+          strcmp(p->toks->items[type_end + 1].text, "(") == 0) {
+        p_eat(p, TK_SYM, "<");
+        size_t type_start = p->i;
+        Token *type_tok = p_t(p, 0);
+        if (!parse_type(p)) {
+          ast_free(mem);
+          return 0;
+        }
+        char *type_txt = token_span_text(p, type_start, p->i);
+        AstNode *tn = ast_new("Type", type_txt ? type_txt : "", type_tok->line, type_tok->col);
+        free(type_txt);
+        if (!tn || !ast_add_child(mem, tn)) {
+          ast_free(tn);
+          ast_free(mem);
+          return 0;
+        }
+        if (!p_eat(p, TK_SYM, ">")) {
+          ast_free(mem);
+          return 0;
+        }
+      }
       continue;
     }
     if (p_at(p, TK_SYM, "++") || p_at(p, TK_SYM, "--")) {
@@ -2532,7 +2589,7 @@ static void preprocess_config_load_once(void) {
   ps_json_free(root);
 }
 
-static char *read_file(const char *path, size_t *out_n, PsDiag *out_diag) {
+static char *read_source(const char *path, size_t *out_n, PsDiag *out_diag) {
   size_t n = 0;
   char *raw = read_file_raw(path, &n);
   if (!raw) {
@@ -2565,6 +2622,15 @@ static char *read_file(const char *path, size_t *out_n, PsDiag *out_diag) {
   return pre;
 }
 
+// Source file after mcpp preprocessing (when enabled).
+static char *read_file(const char *path, size_t *out_n, PsDiag *out_diag) {
+  int prev = phase_enter(PS_PHASE_PREPROCESS);
+  char *src = read_source(path, out_n, out_diag);
+  phase_enter(prev);
+  g_stats.files += 1;
+  return src;
+}
+
 typedef struct Sym {
   char *name;
   char *type;
@@ -4302,6 +4368,25 @@ static int add_builtin_exception_protos(Analyzer *a) {
     if (!proto_add_method0(jv, "asObject", "map<string,JSONValue>")) return 0;
   }
 
+  if (!proto_find(a->protos, "JSONReader")) {
+    ProtoInfo *jr = proto_append(a, "JSONReader", NULL);
+    if (!jr) return 0;
+    jr->builtin = 1;
+    if (!proto_add_method0(jr, "hasNext", "bool")) return 0;
+    if (!proto_add_method0(jr, "next", "JSONValue")) return 0;
+    if (!proto_add_method0(jr, "nextEvent", "string")) return 0;
+    if (!proto_add_method0(jr, "key", "string")) return 0;
+    if (!proto_add_method0(jr, "value", "JSONValue")) return 0;
+    if (!proto_add_method0(jr, "close", "void")) return 0;
+  }
+  {
+    ProtoInfo *jr = proto_find(a->protos, "JSONReader");
+    if (jr) {
+      jr->builtin = 1;
+      jr->sealed = 1;
+    }
+  }
+
   if (!proto_find(a->protos, "RegExp")) {
     ProtoInfo *rx = proto_append(a, "RegExp", NULL);
     if (!rx) return 0;
@@ -4321,6 +4406,7 @@ static int add_builtin_exception_protos(Analyzer *a) {
       const char *pn[] = {"input", "start", "max"};
       const char *pt[] = {"string", "int", "int"};
       if (!proto_add_method_ex(rx, "findAll", "list<RegExpMatch>", 3, pn, pt)) return 0;
+      if (!proto_add_method_ex(rx, "findAllSpans", "list<int>", 3, pn, pt)) return 0;
     }
     {
       const char *pn[] = {"input", "replacement", "start"};
@@ -5242,7 +5328,8 @@ static int check_method_arity(Analyzer *a, AstNode *e, const char *recv_t, const
   } else if (strcmp(recv_t, "RegExp") == 0) {
     if (strcmp(method, "test") == 0 || strcmp(method, "find") == 0) {
       min = max = 2;
-    } else if (strcmp(method, "findAll") == 0 || strcmp(method, "replaceFirst") == 0 || strcmp(method, "split") == 0) {
+    } else if (strcmp(method, "findAll") == 0 || strcmp(method, "findAllSpans") == 0 || strcmp(method, "replaceFirst") == 0 ||
+               strcmp(method, "split") == 0) {
       min = max = 3;
     } else if (strcmp(method, "replaceAll") == 0) {
       min = max = 4;
@@ -5428,6 +5515,7 @@ static char *method_ret_type(const char *recv_t, const char *m) {
     if (strcmp(m, "test") == 0) return strdup("bool");
     if (strcmp(m, "find") == 0) return strdup("RegExpMatch");
     if (strcmp(m, "findAll") == 0) return strdup("list<RegExpMatch>");
+    if (strcmp(m, "findAllSpans") == 0) return strdup("list<int>");
     if (strcmp(m, "replaceFirst") == 0 || strcmp(m, "replaceAll") == 0) return strdup("string");
     if (strcmp(m, "split") == 0) return strdup("list<string>");
     if (strcmp(m, "pattern") == 0 || strcmp(m, "flags") == 0) return strdup("string");
@@ -5435,6 +5523,95 @@ static char *method_ret_type(const char *recv_t, const char *m) {
   return NULL;
 }
 
+// `JSON.decodeAs<T>(...)`, through any alias of the JSON module.
+static int is_json_decode_as_callee(Analyzer *a, AstNode *callee) {
+  if (!callee || strcmp(callee->kind, "MemberExpr") != 0 || callee->child_len == 0 || !callee->text) return 0;
+  if (strcmp(callee->text, "decodeAs") != 0) return 0;
+  AstNode *target = callee->children[0];
+  if (strcmp(target->kind, "Identifier") != 0) return 0;
+  ImportNamespace *ns = find_namespace(a, target->text ? target->text : "");
+  return ns && !ns->is_proto && ns->module && strcmp(ns->module, "JSON") == 0;
+}
+
+typedef struct JsonDecodeSeen {
+  char *name;
+  struct JsonDecodeSeen *next;
+} JsonDecodeSeen;
+
+static void json_decode_seen_free(JsonDecodeSeen *s) {
+  while (s) {
+    JsonDecodeSeen *n = s->next;
+    free(s->name);
+    free(s);
+    s = n;
+  }
+}
+
+// Splits the arguments of a canonical generic type ("map<K,V>") at its
+// top-level comma; returns 0 when there is none.
+static int split_generic_args(const char *inner, size_t len, size_t *comma) {
+  int depth = 0;
+  for (size_t i = 0; i < len; i++) {
+    if (inner[i] == '<') depth++;
+    else if (inner[i] == '>') depth--;
+    else if (inner[i] == ',' && depth == 0) {
+      *comma = i;
+      return 1;
+    }
+  }
+  return 0;
+}
+
+// Targets of JSON.decodeAs: scalars, JSONValue, list<T>, map<string,T> and
+// user prototypes whose fields (inherited ones included) are all decodable.
+// `t` is a canonical type (no spaces).
+static int json_decodable_type(Analyzer *a, const char *t, JsonDecodeSeen **seen) {
+  if (!t) return 0;
+  if (strcmp(t, "int") == 0 || strcmp(t, "float") == 0 || strcmp(t, "bool") == 0 || strcmp(t, "byte") == 0 ||
+      strcmp(t, "string") == 0 || strcmp(t, "JSONValue") == 0) {
+    return 1;
+  }
+  size_t n = strlen(t);
+  if (n > 6 && strncmp(t, "list<", 5) == 0 && t[n - 1] == '>') {
+    char *inner = dup_range(t, 5, n - 1);
+    int r = json_decodable_type(a, inner, seen);
+    free(inner);
+    return r;
+  }
+  if (n > 5 && strncmp(t, "map<", 4) == 0 && t[n - 1] == '>') {
+    size_t comma = 0;
+    if (!split_generic_args(t + 4, n - 5, &comma)) return 0;
+    if (comma != 6 || strncmp(t + 4, "string", 6) != 0) return 0;
+    char *inner = dup_range(t, 4 + comma + 1, n - 1);
+    int r = json_decodable_type(a, inner, seen);
+    free(inner);
+    return r;
+  }
+  if (strchr(t, '<')) return 0;
+  for (JsonDecodeSeen *s = *seen; s; s = s->next) {
+    if (strcmp(s->name, t) == 0) return 1;
+  }
+  ProtoInfo *proto = proto_find(a->protos, t);
+  if (!proto || proto->builtin || proto_is_subtype(a->protos, t, "Exception")) return 0;
+  JsonDecodeSeen *mark = (JsonDecodeSeen *)calloc(1, sizeof(JsonDecodeSeen));
+  if (!mark) return 0;
+  mark->name = strdup(t);
+  mark->next = *seen;
+  *seen = mark;
+  for (ProtoInfo *p = proto; p; p = proto_find(a->protos, p->parent)) {
+    for (ProtoField *f = p->fields; f; f = f->next) {
+      char *ft = canon_type(f->type);
+      int r = json_decodable_type(a, ft, seen);
+      free(ft);
+      if (!r) return 0;
+    }
+    if (!p->parent || strcmp(p->parent, "Object") == 0) break;
+    ProtoInfo *parent = proto_find(a->protos, p->parent);
+    if (!parent || parent->builtin) return 0;
+  }
+  return 1;
+}
+
 static char *infer_call_type(Analyzer *a, AstNode *e, Scope *scope, int *ok) {
   (void)scope;
   if (e->child_len == 0) return strdup("unknown");
@@ -5484,6 +5661,13 @@ static char *infer_call_type(Analyzer *a, AstNode *e, Scope *scope, int *ok) {
   }
   if (strcmp(callee->kind, "MemberExpr") == 0 && callee->child_len > 0) {
     AstNode *target = callee->children[0];
+    if (callee->child_len > 1 && !is_json_decode_as_callee(a, callee)) {
+      char msg[256];
+      snprintf(msg, sizeof(msg), "unexpected type argument for '%s'", callee->text ? callee->text : "");
+      set_diag(a->diag, a->file, e->line, e->col, "E3001", "TYPE_MISMATCH_ASSIGNMENT", msg);
+      *ok = 0;
+      return NULL;
+    }
     if (strcmp(target->kind, "SuperExpr") == 0) {
       const char *mname = callee->text ? callee->text : "";
       int argc = (int)e->child_len - 1;
@@ -5653,6 +5837,28 @@ static char *infer_call_type(Analyzer *a, AstNode *e, Scope *scope, int *ok) {
           return NULL;
         }
         if (!check_call_args(a, e, scope, ok)) return NULL;
+        if (is_json_decode_as_callee(a, callee)) {
+          if (callee->child_len < 2) {
+            set_diag(a->diag, a->file, e->line, e->col, "E3006", "MISSING_TYPE_CONTEXT",
+                     "JSON.decodeAs requires a type argument");
+            *ok = 0;
+            return NULL;
+          }
+          char *want = canon_type(callee->children[1]->text);
+          JsonDecodeSeen *seen = NULL;
+          int decodable = want && json_decodable_type(a, want, &seen);
+          json_decode_seen_free(seen);
+          if (!decodable) {
+            char msg[320];
+            snprintf(msg, sizeof(msg), "cannot decode JSON into %s", want ? want : "unknown");
+            set_diag(a->diag, a->file, e->line, e->col, "E3001", "TYPE_MISMATCH_ASSIGNMENT", msg);
+            free(want);
+            *ok = 0;
+            return NULL;
+          }
+          free(want);
+          return canon_type(callee->children[1]->text);
+        }
         return strdup(rf->ret_type);
       }
     }
@@ -6887,7 +7093,7 @@ static int analyze_method(Analyzer *a, AstNode *fn, const char *self_type) {
   return had_error ? 0 : 1;
 }
 
-static int parse_file_internal(const char *file, PsDiag *out_diag, AstNode **out_root) {
+static int parse_source(const char *file, PsDiag *out_diag, AstNode **out_root) {
   memset(out_diag, 0, sizeof(*out_diag));
   size_t n = 0;
   char *src = read_file(file, &n, out_diag);
@@ -6905,7 +7111,11 @@ static int parse_file_internal(const char *file, PsDiag *out_diag, AstNode **out
   lx.col = 1;
   lx.diag = out_diag;
 
-  if (!run_lexer(&lx)) {
+  phase_enter(PS_PHASE_LEX);
+  int lex_ok = run_lexer(&lx);
+  phase_enter(PS_PHASE_PARSE);
+  g_stats.tokens += lx.toks.len;
+  if (!lex_ok) {
     token_vec_free(&lx.toks);
     free(src);
     return 1;
@@ -6928,6 +7138,13 @@ static int parse_file_internal(const char *file, PsDiag *out_diag, AstNode **out
   return ok ? 0 : 1;
 }
 
+static int parse_file_internal(const char *file, PsDiag *out_diag, AstNode **out_root) {
+  int prev = phase_enter(PS_PHASE_PARSE);
+  int rc = parse_source(file, out_diag, out_root);
+  phase_enter(prev);
+  return rc;
+}
+
 static const char *token_kind_name(TokenKind k) {
   switch (k) {
     case TK_KW: return "kw";
@@ -7663,6 +7880,11 @@ static char *ir_guess_expr_type(AstNode *e, IrFnCtx *ctx) {
             return strdup(pm && pm->ret_type ? pm->ret_type : "unknown");
           }
         }
+        if (ns && !ns->is_proto) {
+          if (c->child_len > 1 && strcmp(c->text, "decodeAs") == 0) return canon_type(c->children[1]->text);
+          RegFn *rf = registry_find_fn(ctx->registry, ns->module, c->text);
+          if (rf) return strdup(rf->ret_type ? rf->ret_type : "unknown");
+        }
       }
       char *recv_t = (c->child_len > 0) ? ir_guess_expr_type(c->children[0], ctx) : NULL;
       const char *m = c->text;
@@ -8112,7 +8334,8 @@ static char *ir_lower_call(AstNode *e, IrFnCtx *ctx) {
         int restore_loc = 0;
         if (ns->module && strcmp(ns->module, "JSON") == 0) {
           const char *m = callee->text ? callee->text : "";
-          if (strcmp(m, "decode") == 0 || strcmp(m, "encode") == 0 || strcmp(m, "isValid") == 0) {
+          if (strcmp(m, "decode") == 0 || strcmp(m, "decodeAs") == 0 || strcmp(m, "encode") == 0 ||
+              strcmp(m, "encodeTo") == 0 || strcmp(m, "isValid") == 0) {
             ir_set_loc(ctx, callee);
             restore_loc = 1;
           }
@@ -8128,6 +8351,22 @@ static char *ir_lower_call(AstNode *e, IrFnCtx *ctx) {
           free(prev);
           free(arg_esc);
         }
+        // JSON.decodeAs<T>(text): the target type travels as a trailing string argument.
+        if (callee->child_len > 1 && callee->text && strcmp(callee->text, "decodeAs") == 0) {
+          char *type_tmp = ir_next_tmp(ctx);
+          char *type_txt = canon_type(callee->children[1]->text);
+          char *tmp_esc = json_escape(type_tmp ? type_tmp : "");
+          char *type_esc = json_escape(type_txt ? type_txt : "");
+          ir_emit(ctx, str_printf("{\"op\":\"const\",\"dst\":\"%s\",\"literalType\":\"string\",\"value\":\"%s\"}",
+                                  tmp_esc ? tmp_esc : "", type_esc ? type_esc : ""));
+          char *prev = args_json;
+          args_json = str_printf("%s%s\"%s\"", prev, (argc == 0 ? "" : ","), tmp_esc ? tmp_esc : "");
+          free(prev);
+          free(tmp_esc);
+          free(type_esc);
+          free(type_txt);
+          free(type_tmp);
+        }
         char *ins = str_printf(
             "{\"op\":\"call_static\",\"dst\":\"%s\",\"callee\":\"%s\",\"args\":[%s],\"variadic\":false}",
             dst_esc ? dst_esc : "", callee_esc ? callee_esc : "", args_json ? args_json : "");
@@ -8163,8 +8402,8 @@ static char *ir_lower_call(AstNode *e, IrFnCtx *ctx) {
       if (recv_type && proto_find(ctx->protos, recv_type) &&
           strcmp(recv_type, "Dir") != 0 && strcmp(recv_type, "Walker") != 0 &&
           strcmp(recv_type, "TextFile") != 0 && strcmp(recv_type, "BinaryFile") != 0 &&
-          strcmp(recv_type, "JSONValue") != 0 && strcmp(recv_type, "RegExp") != 0 &&
-          strcmp(recv_type, "CivilDateTime") != 0 &&
+          strcmp(recv_type, "JSONValue") != 0 && strcmp(recv_type, "JSONReader") != 0 &&
+          strcmp(recv_type, "RegExp") != 0 && strcmp(recv_type, "CivilDateTime") != 0 &&
           strcmp(recv_type, "PathInfo") != 0 &&
           strcmp(recv_type, "PathEntry") != 0 &&
           strcmp(recv_type, "RegExpMatch") != 0 &&
@@ -8237,7 +8476,7 @@ static char *ir_lower_call(AstNode *e, IrFnCtx *ctx) {
         const char *m = callee->text ? callee->text : "";
         int is_rx_method =
             strcmp(m, "test") == 0 || strcmp(m, "find") == 0 || strcmp(m, "findAll") == 0 ||
-            strcmp(m, "replaceFirst") == 0 || strcmp(m, "replaceAll") == 0 ||
+            strcmp(m, "findAllSpans") == 0 || strcmp(m, "replaceFirst") == 0 || strcmp(m, "replaceAll") == 0 ||
             strcmp(m, "split") == 0 || strcmp(m, "pattern") == 0 || strcmp(m, "flags") == 0;
         if (is_rx_method) {
           char *args_json = strdup("");
@@ -8276,10 +8515,20 @@ static char *ir_lower_call(AstNode *e, IrFnCtx *ctx) {
           return dst;
         }
       }
-      if (recv_type && (strcmp(recv_type, "Dir") == 0 || strcmp(recv_type, "Walker") == 0)) {
+      if (recv_type && (strcmp(recv_type, "Dir") == 0 || strcmp(recv_type, "Walker") == 0 ||
+                        strcmp(recv_type, "JSONReader") == 0)) {
         const char *m = callee->text ? callee->text : "";
         const char *helper = NULL;
-        if (strcmp(recv_type, "Dir") == 0) {
+        const char *module = "Fs";
+        if (strcmp(recv_type, "JSONReader") == 0) {
+          module = "JSON";
+          if (strcmp(m, "hasNext") == 0) helper = "__reader_hasNext";
+          else if (strcmp(m, "next") == 0) helper = "__reader_next";
+          else if (strcmp(m, "nextEvent") == 0) helper = "__reader_nextEvent";
+          else if (strcmp(m, "key") == 0) helper = "__reader_key";
+          else if (strcmp(m, "value") == 0) helper = "__reader_value";
+          else if (strcmp(m, "close") == 0) helper = "__reader_close";
+        } else if (strcmp(recv_type, "Dir") == 0) {
           if (strcmp(m, "hasNext") == 0) helper = "__dir_hasNext";
           else if (strcmp(m, "next") == 0) helper = "__dir_next";
           else if (strcmp(m, "close") == 0) helper = "__dir_close";
@@ -8296,7 +8545,7 @@ static char *ir_lower_call(AstNode *e, IrFnCtx *ctx) {
           args_json = str_printf("%s\"%s\"", prev ? prev : "", recv_arg ? recv_arg : "");
           free(prev);
           free(recv_arg);
-          char *callee_full = str_printf("Fs.%s", helper);
+          char *callee_full = str_printf("%s.%s", module, helper);
           char *callee_esc = json_escape(callee_full ? callee_full : "");
           char *ins = str_printf(
               "{\"op\":\"call_static\",\"dst\":\"%s\",\"callee\":\"%s\",\"args\":[%s],\"variadic\":false}",
@@ -10718,7 +10967,7 @@ static int ir_fn_terminated(IrFnCtx *ctx) {
   return ir_is_terminated_block(&ctx->blocks.items[ctx->cur_block].instrs);
 }
 
-int ps_emit_ir_json(const char *file, PsDiag *out_diag, FILE *out) {
+static int emit_ir_json(const char *file, PsDiag *out_diag, FILE *out) {
   AstNode *root = NULL;
   int rc = parse_file_internal(file, out_diag, &root);
   if (rc != 0) {
@@ -10775,6 +11024,7 @@ int ps_emit_ir_json(const char *file, PsDiag *out_diag, FILE *out) {
     return 1;
   }
 
+  phase_enter(PS_PHASE_IR_EMIT);
   fputs("{\n", out);
   fputs("  \"ir_version\": \"1.0.0\",\n", out);
   fputs("  \"format\": \"ProtoScriptIR\",\n", out);
@@ -11543,10 +11793,19 @@ int ps_emit_ir_json(const char *file, PsDiag *out_diag, FILE *out) {
   return 0;
 }
 
+int ps_emit_ir_json(const char *file, PsDiag *out_diag, FILE *out) {
+  int prev = phase_enter(PS_PHASE_ANALYZE);
+  int rc = emit_ir_json(file, out_diag, out);
+  phase_enter(prev);
+  return rc;
+}
+
 int ps_check_file_static(const char *file, PsDiag *out_diag) {
   AstNode *root = NULL;
   Analyzer a;
+  int prev = phase_enter(PS_PHASE_ANALYZE);
   int rc = frontend_analyze_program(file, out_diag, &root, &a);
+  phase_enter(prev);
   if (rc != 0) return rc;
   ast_free(root);
   analyzer_cleanup(&a);
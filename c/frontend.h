@@ -1,6 +1,7 @@
 #ifndef PS_FRONTEND_H
 #define PS_FRONTEND_H
 
+#include <stddef.h>
 #include <stdio.h>
 
 typedef struct {
@@ -35,6 +36,26 @@ typedef struct {
   PsDiagItem items[PS_DIAG_MAX_ITEMS];
 } PsDiag;
 
+typedef enum {
+  PS_PHASE_PREPROCESS,
+  PS_PHASE_LEX,
+  PS_PHASE_PARSE,
+  PS_PHASE_ANALYZE,
+  PS_PHASE_IR_EMIT,
+  PS_FRONTEND_PHASE_COUNT
+} PsFrontendPhase;
+
+// Cumulative frontend work since process start (every pass, including the
+// static check that precedes `run` and imported modules).
+typedef struct {
+  double ms[PS_FRONTEND_PHASE_COUNT];
+  size_t files;
+  size_t tokens;
+  size_t ast_nodes;
+} PsFrontendStats;
+
+void ps_frontend_stats(PsFrontendStats *out);
+
 int ps_parse_file_syntax(const char *file, PsDiag *out_diag);
 int ps_parse_file_ast(const char *file, PsDiag *out_diag, FILE *out);
 int ps_check_file_static(const char *file, PsDiag *out_diag);
@@ -0,0 +1,85 @@
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Conformance target for JSON.decode: the indexed decoder used for large
+// documents must accept exactly the inputs the recursive descent parser
+// accepts and build the same tree. The module is compiled into this target to
+// reach both (static) decoders.
+#undef ps_module_init
+#define ps_module_init ps_module_init_JSON
+#include "../../tests/modules_src/json.c"
+
+static PS_Context *g_ctx = NULL;
+
+static int json_same(PS_Context *ctx, PS_Value *a, PS_Value *b) {
+  PS_JsonKind ka;
+  PS_JsonKind kb;
+  if (!ps_json_kind(a, &ka) || !ps_json_kind(b, &kb) || ka != kb) return 0;
+  PS_Value *pa = ps_json_payload(a);
+  PS_Value *pb = ps_json_payload(b);
+  switch (ka) {
+    case PS_JSON_KIND_NULL:
+      return 1;
+    case PS_JSON_KIND_BOOL:
+      return ps_json_bool(a) == ps_json_bool(b);
+    case PS_JSON_KIND_NUMBER: {
+      double x = ps_json_number(a);
+      double y = ps_json_number(b);
+      return memcmp(&x, &y, sizeof(x)) == 0;
+    }
+    case PS_JSON_KIND_STRING:
+      return ps_string_len(pa) == ps_string_len(pb) && memcmp(ps_string_ptr(pa), ps_string_ptr(pb), ps_string_len(pa)) == 0;
+    case PS_JSON_KIND_ARRAY: {
+      size_t n = ps_list_len(pa);
+      if (n != ps_list_len(pb)) return 0;
+      for (size_t i = 0; i < n; i++) {
+        if (!json_same(ctx, ps_list_get(ctx, pa, i), ps_list_get(ctx, pb, i))) return 0;
+      }
+      return 1;
+    }
+    case PS_JSON_KIND_OBJECT: {
+      size_t n = ps_map_len(pa);
+      if (n != ps_map_len(pb)) return 0;
+      for (size_t i = 0; i < n; i++) {
+        PS_Value *ka_v = NULL, *va = NULL, *kb_v = NULL, *vb = NULL;
+        if (ps_map_entry(ctx, pa, i, &ka_v, &va) != PS_OK || ps_map_entry(ctx, pb, i, &kb_v, &vb) != PS_OK) return 0;
+        if (ps_string_len(ka_v) != ps_string_len(kb_v) ||
+            memcmp(ps_string_ptr(ka_v), ps_string_ptr(kb_v), ps_string_len(ka_v)) != 0) {
+          return 0;
+        }
+        if (!json_same(ctx, va, vb)) return 0;
+      }
+      return 1;
+    }
+  }
+  return 0;
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+  if (!data) return 0;
+  // Bounds the recursion of the reference parser.
+  if (size > 4096) return 0;
+  if (!g_ctx) {
+    g_ctx = ps_ctx_create();
+    if (!g_ctx) return 0;
+  }
+  // decode only sees strings, which are valid UTF-8.
+  PS_Value *text = ps_make_string_utf8(g_ctx, (const char *)data, size);
+  if (!text) {
+    ps_clear_error(g_ctx);
+    return 0;
+  }
+  const char *s = ps_string_ptr(text);
+  PS_Value *direct = json_parse_direct(g_ctx, s, size);
+  ps_clear_error(g_ctx);
+  PS_Value *indexed = json_parse_indexed(g_ctx, s, size);
+  ps_clear_error(g_ctx);
+  if ((direct == NULL) != (indexed == NULL)) abort();
+  if (direct && !json_same(g_ctx, direct, indexed)) abort();
+  if (direct) ps_value_release(direct);
+  if (indexed) ps_value_release(indexed);
+  ps_value_release(text);
+  return 0;
+}
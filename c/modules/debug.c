@@ -7,6 +7,7 @@
 #include "runtime/ps_list.h"
 #include "runtime/ps_map.h"
 #include "runtime/ps_object.h"
+#include "runtime/ps_profile.h"
 #include "runtime/ps_modules.h"
 #include "runtime/ps_runtime.h"
 #include "runtime/ps_string.h"
@@ -207,6 +208,7 @@ static const char *value_tag_name(PS_Value *v) {
     case PS_V_MAP: return "map";
     case PS_V_VIEW: return "view";
     case PS_V_OBJECT: return "object";
+    case PS_V_JSON: return "object";
     case PS_V_EXCEPTION: return "Exception";
     case PS_V_FILE: return "file";
     case PS_V_ITER: return "iter";
@@ -629,7 +631,7 @@ static void debug_print_chain(DebugState *st, PS_Context *ctx, const char *proto
 static int debug_is_ref_type(PS_Value *v) {
   if (!v) return 0;
   return v->tag == PS_V_LIST || v->tag == PS_V_MAP || v->tag == PS_V_OBJECT || v->tag == PS_V_VIEW || v->tag == PS_V_EXCEPTION ||
-         v->tag == PS_V_FILE;
+         v->tag == PS_V_FILE || v->tag == PS_V_JSON;
 }
 
 static const char *debug_file_proto_name(PS_Value *v) {
@@ -639,6 +641,7 @@ static const char *debug_file_proto_name(PS_Value *v) {
 
 static PS_Value *debug_exception_field(PS_Context *ctx, PS_Value *ex, const char *name) {
   if (!ex || ex->tag != PS_V_EXCEPTION || !name) return NULL;
+  ps_exception_resolve(ctx, ex);
   if (strcmp(name, "file") == 0) return ex->as.exc_v.file;
   if (strcmp(name, "line") == 0) return ps_make_int(ctx, ex->as.exc_v.line);
   if (strcmp(name, "column") == 0) return ps_make_int(ctx, ex->as.exc_v.column);
@@ -705,10 +708,11 @@ static int debug_dump_ref_desc(PS_Context *ctx, DebugState *st, PS_Value *v) {
     size_t len = v->as.view_v.len;
     return debug_printf(st, "%s(len=%zu) [...]", view_type_name(v), len);
   }
-  if (v->tag == PS_V_OBJECT || v->tag == PS_V_EXCEPTION) {
+  if (v->tag == PS_V_OBJECT || v->tag == PS_V_EXCEPTION || v->tag == PS_V_JSON) {
     if (debug_dump_native(ctx, st, v, (int)st->max_depth, 0)) return 1;
     const char *proto_name = NULL;
     if (v->tag == PS_V_EXCEPTION) proto_name = v->as.exc_v.type_name;
+    if (v->tag == PS_V_JSON) proto_name = "JSONValue";
     if (!proto_name && v->tag == PS_V_OBJECT) proto_name = ps_object_proto_name_internal(v);
     return debug_printf(st, "object<%s>", proto_name ? proto_name : "unknown");
   }
@@ -999,6 +1003,7 @@ static int debug_dump_object(PS_Context *ctx, DebugState *st, PS_Value *v, int d
   if (v->tag == PS_V_EXCEPTION) proto_name = v->as.exc_v.type_name;
   if (!proto_name && v->tag == PS_V_OBJECT) proto_name = ps_object_proto_name_internal(v);
   if (!proto_name && v->tag == PS_V_FILE) proto_name = debug_file_proto_name(v);
+  if (v->tag == PS_V_JSON) proto_name = "JSONValue";
   const char *name = proto_name ? proto_name : "unknown";
   if (!debug_printf(st, "object<%s> {", name)) return 0;
   if (depth >= (int)st->max_depth) {
@@ -1090,6 +1095,7 @@ static int debug_dump_value(PS_Context *ctx, DebugState *st, PS_Value *v, int de
     case PS_V_OBJECT:
     case PS_V_EXCEPTION:
     case PS_V_FILE:
+    case PS_V_JSON:
       return debug_dump_object(ctx, st, v, depth, indent);
     default:
       return debug_dump_scalar(st, v);
@@ -1130,11 +1136,90 @@ static PS_Status debug_dump(PS_Context *ctx, int argc, PS_Value **argv, PS_Value
   return PS_OK;
 }
 
+static int debug_stat_put(PS_Context *ctx, PS_Value *map, const char *key, size_t n) {
+  PS_Value *k = ps_make_string_utf8(ctx, key, strlen(key));
+  PS_Value *v = k ? ps_make_int(ctx, (int64_t)n) : NULL;
+  int ok = v && ps_map_set(ctx, map, k, v);
+  if (k) ps_value_release(k);
+  if (v) ps_value_release(v);
+  return ok;
+}
+
+static PS_Status debug_heap_stats(PS_Context *ctx, int argc, PS_Value **argv, PS_Value **out) {
+  (void)argv;
+  if (!ctx || argc != 0 || !out) {
+    ps_throw(ctx, PS_ERR_TYPE, "Debug.heapStats expects no argument");
+    return PS_ERR;
+  }
+  // Snapshot first: building the result allocates.
+  PS_HeapStats hs;
+  ps_heap_stats(ctx, &hs);
+  static const struct {
+    const char *key;
+    PS_TypeTag type;
+  } by_type[] = {
+      {"values.bool", PS_T_BOOL},     {"values.int", PS_T_INT},       {"values.float", PS_T_FLOAT},
+      {"values.byte", PS_T_BYTE},     {"values.glyph", PS_T_GLYPH},   {"values.string", PS_T_STRING},
+      {"values.bytes", PS_T_BYTES},   {"values.list", PS_T_LIST},     {"values.map", PS_T_MAP},
+      {"values.object", PS_T_OBJECT}, {"values.file", PS_T_FILE},     {"values.group", PS_T_GROUP},
+      {"values.other", PS_T_VOID},
+  };
+  PS_Value *map = ps_make_map(ctx);
+  if (!map) return PS_ERR;
+  int ok = debug_stat_put(ctx, map, "values", hs.live_values) &&
+           debug_stat_put(ctx, map, "peakValues", hs.peak_values) &&
+           debug_stat_put(ctx, map, "bytes", hs.live_bytes) &&
+           debug_stat_put(ctx, map, "peakBytes", hs.peak_bytes) &&
+           debug_stat_put(ctx, map, "maxBytes", hs.max_bytes);
+  for (size_t i = 0; ok && i < sizeof(by_type) / sizeof(by_type[0]); i++) {
+    ok = debug_stat_put(ctx, map, by_type[i].key, hs.values_by_type[by_type[i].type]);
+  }
+  ok = ok && debug_stat_put(ctx, map, "bytes.values", hs.value_bytes) &&
+       debug_stat_put(ctx, map, "bytes.string", hs.string_bytes) &&
+       debug_stat_put(ctx, map, "bytes.bytes", hs.bytes_bytes) &&
+       debug_stat_put(ctx, map, "bytes.list", hs.list_bytes) &&
+       debug_stat_put(ctx, map, "bytes.map", hs.map_bytes) &&
+       debug_stat_put(ctx, map, "bytes.object", hs.object_bytes);
+  if (!ok) {
+    ps_value_release(map);
+    return PS_ERR;
+  }
+  *out = map;
+  return PS_OK;
+}
+
+static PS_Status debug_heap_snapshot(PS_Context *ctx, int argc, PS_Value **argv, PS_Value **out) {
+  (void)out;
+  if (!ctx || argc != 1 || !argv || ps_typeof(argv[0]) != PS_T_STRING) {
+    ps_throw(ctx, PS_ERR_TYPE, "Debug.heapSnapshot expects a path");
+    return PS_ERR;
+  }
+  if (!ctx->heap.census) {
+    ps_throw(ctx, PS_ERR_INTERNAL, "heap census disabled (run with --heap-report)");
+    return PS_ERR;
+  }
+  const char *path = ps_string_ptr(argv[0]);
+  FILE *f = fopen(path, "w");
+  if (!f) {
+    ps_throw(ctx, PS_ERR_RANGE, "Debug.heapSnapshot: cannot open file");
+    return PS_ERR;
+  }
+  size_t n = strlen(path);
+  ps_census_write(ctx->heap.census, f, n > 5 && strcmp(path + n - 5, ".json") == 0);
+  if (fclose(f) != 0) {
+    ps_throw(ctx, PS_ERR_INTERNAL, "debug output failed");
+    return PS_ERR;
+  }
+  return PS_OK;
+}
+
 PS_Status ps_module_init_Debug(PS_Context *ctx, PS_Module *out) {
   (void)ctx;
   if (!out) return PS_ERR;
   static const PS_NativeFnDesc fns[] = {
     { "dump", debug_dump, 1, PS_T_VOID, NULL, 0 },
+    { "heapStats", debug_heap_stats, 0, PS_T_MAP, NULL, 0 },
+    { "heapSnapshot", debug_heap_snapshot, 1, PS_T_VOID, NULL, 0 },
   };
   out->module_name = "Debug";
   out->api_version = PS_API_VERSION;
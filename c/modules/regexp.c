@@ -1,6 +1,9 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
 #include <ctype.h>
 #include <limits.h>
-#include <regex.h>
+#include <stdarg.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -8,27 +11,174 @@
 
 #include "ps/ps_api.h"
 
+// Patterns are parsed into a small syntax tree and compiled to a Thompson NFA
+// over UTF-8 bytes: code point classes become byte-range sequences, so
+// matching never decodes the input. Searches are leftmost-first with
+// greedy/lazy priorities. A lazily built DFA answers "is there a match" and
+// a Pike VM extracts the captures; both run in time linear in the input.
+// The search start always acts as the beginning of the text.
+//
+// Before either engine runs, literals extracted at compile time narrow the
+// search: a required substring missing from the input rejects it outright,
+// and a literal prefix (or the set of possible first bytes) lets both engines
+// jump with memmem/memchr over stretches where no match can start.
+
+#define RX_MAX_GROUPS 99
+#define RX_MAX_REPEAT 1000
+#define RX_MAX_INSTS 100000
+#define RX_MAX_DEPTH 1000
+#define RX_MAX_CP 0x10FFFFu
+#define RX_UNSET SIZE_MAX
+
+#define RX_DFA_MAX_MEM ((size_t)2 << 20)
+#define RX_DFA_MAX_FLUSH 4
+#define RX_DFA_UNKNOWN (-1)
+#define RX_DFA_MATCH (-2)
+#define RX_DFA_DEAD (-3)
+#define RX_DFA_FULL (-4)
+#define RX_DFA_OOM (-5)
+
+enum {
+  RX_OP_RANGE,  // one byte in [lo, hi]
+  RX_OP_SET,    // one byte in sets[x]
+  RX_OP_SPLIT,  // fork: x first, then y
+  RX_OP_JMP,    // goto x
+  RX_OP_SAVE,   // caps[x] = position
+  RX_OP_ASSERT, // zero-width test x
+  RX_OP_MATCH,
+  RX_OP_FAIL
+};
+
+enum { RX_A_BEGIN, RX_A_END, RX_A_LINE_BEGIN, RX_A_LINE_END, RX_A_WORD, RX_A_NOT_WORD };
+
+enum { RX_ERR_NONE, RX_ERR_SYNTAX, RX_ERR_LIMIT, RX_ERR_OOM };
+
+// DFA state flags: what precedes the current position.
+enum { RX_DF_START = 1, RX_DF_NL = 2, RX_DF_WORD = 4 };
+
+typedef struct {
+  uint8_t op;
+  uint8_t lo;
+  uint8_t hi;
+  int x;
+  int y;
+} RxInst;
+
+typedef struct {
+  int pc;
+  int slot; // >= 0: restore caps[slot] = val
+  size_t val;
+} RxStackItem;
+
+typedef struct {
+  int *sparse;
+  int *dense;
+  int n;
+  int *thr_pc;
+  size_t *thr_caps;
+  int thr_n;
+  size_t caps_cap;
+} RxThreads;
+
+typedef struct {
+  RxThreads a;
+  RxThreads b;
+  RxStackItem *stack;
+  size_t *tmp;
+  int ready;
+} RxVm;
+
+typedef struct {
+  uint32_t hash;
+  int flags;
+  int n;
+  size_t inst_off;
+  size_t next_off;
+} RxDState;
+
+typedef struct {
+  RxDState *states;
+  size_t len;
+  size_t cap;
+  int *insts;
+  size_t inst_len;
+  size_t inst_cap;
+  int32_t *next;
+  size_t next_len;
+  size_t next_cap;
+  int *table;
+  size_t table_cap;
+  size_t mem;
+  int start;
+  int *stack;
+  int *sparse;
+  int *dense;
+  int *out_sparse;
+  int *out;
+  int ready;
+} RxDfa;
+
 typedef struct {
-  int id;
-  regex_t re;
-  int valid;
-  int cflags;
+  RxInst *insts;
+  int len;
+  int cap;
+  uint8_t (*sets)[32];
+  int set_len;
+  int set_cap;
+  int groups;
+  int ncap;
+  int anchored;
+  uint8_t *prefix; // every match starts with these bytes
+  size_t prefix_len;
+  uint8_t *needle; // every match contains these bytes
+  size_t needle_len;
+  uint8_t first_set[256]; // bytes a match can start with
+  int first_count;        // 0 when not worth scanning for
+  uint8_t first_byte;
+  uint8_t byte_class[256];
+  uint8_t class_rep[256];
+  int nclasses;
+  RxVm vm;
+  RxDfa dfa;
+} RxProg;
+
+// A compiled pattern, held in a slot of the handle table. The `_rid` of a
+// RegExp object is the slot index plus one, with the slot generation in the
+// high 32 bits: entries past the cache size are freed and their slot reused
+// under a new generation, so an old handle never resolves to another pattern.
+typedef struct RegexEntry {
+  size_t slot;
+  uint32_t gen;
+  uint32_t hash;
+  RxProg *prog;
+  size_t *caps;
   char *pattern;
-  char *pattern_posix;
+  size_t pattern_len;
   char flags[4];
-  int logical_to_phys[100];
-  int logical_groups;
+  struct RegexEntry *lru_prev; // most recently used first
+  struct RegexEntry *lru_next;
 } RegexEntry;
 
 typedef struct {
-  RegexEntry *items;
+  RegexEntry *entry; // NULL while free
+  uint32_t gen;
+  size_t next_free; // free list: slot index + 1, 0 = end
+} RegexSlot;
+
+// Per-context store (ps_ctx_set_module_data): handle table with its free
+// list, (pattern, flags) index and LRU list of the entries.
+typedef struct {
+  RegexSlot *slots;
   size_t len;
   size_t cap;
-  int next_id;
+  size_t free_head; // slot index + 1, 0 = none
+  uint32_t *index;  // open addressing: slot index + 1, 0 = empty
+  size_t index_cap;
+  RegexEntry *lru_head;
+  RegexEntry *lru_tail;
+  size_t live;
 } RegexStore;
 
-static RegexStore g_store = {0};
-
 static PS_Status rx_throw(PS_Context *ctx, PS_ErrorCode code, const char *kind, const char *msg) {
   char buf[512];
   const char *k = kind ? kind : "RegExpError";
@@ -100,6 +250,15 @@ static int utf8_validate(const char *s, size_t len, size_t *out_glyphs) {
   size_t i = 0;
   size_t g = 0;
   while (i < len) {
+    // ASCII runs are one glyph per byte: step over them a word at a time.
+    while (i + 8 <= len) {
+      uint64_t w;
+      memcpy(&w, s + i, 8);
+      if (w & 0x8080808080808080ULL) break;
+      i += 8;
+      g += 8;
+    }
+    if (i >= len) break;
     uint32_t cp = 0;
     size_t next = 0;
     if (!utf8_decode_one((const uint8_t *)s, len, i, &cp, &next)) return 0;
@@ -111,72 +270,45 @@ static int utf8_validate(const char *s, size_t len, size_t *out_glyphs) {
   return 1;
 }
 
-typedef struct {
-  size_t *glyph_to_byte;
-  size_t glyph_count;
-} GlyphIndex;
-
-static void glyph_index_free(GlyphIndex *idx) {
-  if (!idx) return;
-  free(idx->glyph_to_byte);
-  idx->glyph_to_byte = NULL;
-  idx->glyph_count = 0;
-}
-
-static int glyph_index_build(const char *s, size_t len, GlyphIndex *out) {
-  if (!s || !out) return 0;
-  memset(out, 0, sizeof(*out));
-  size_t cap = 16;
-  size_t *arr = (size_t *)malloc(sizeof(size_t) * cap);
-  if (!arr) return 0;
-  arr[0] = 0;
-  size_t count = 0;
-  size_t i = 0;
-  while (i < len) {
-    uint32_t cp = 0;
-    size_t next = 0;
-    if (!utf8_decode_one((const uint8_t *)s, len, i, &cp, &next)) {
-      free(arr);
-      return 0;
-    }
-    (void)cp;
-    count += 1;
-    if (count + 1 > cap) {
-      size_t ncap = cap * 2;
-      size_t *narr = (size_t *)realloc(arr, sizeof(size_t) * ncap);
-      if (!narr) {
-        free(arr);
-        return 0;
-      }
-      arr = narr;
-      cap = ncap;
-    }
-    arr[count] = next;
-    i = next;
+static size_t utf8_encode_one(uint32_t cp, uint8_t out[4]) {
+  if (cp < 0x80) {
+    out[0] = (uint8_t)cp;
+    return 1;
   }
-  out->glyph_to_byte = arr;
-  out->glyph_count = count;
-  return 1;
+  if (cp < 0x800) {
+    out[0] = (uint8_t)(0xC0 | (cp >> 6));
+    out[1] = (uint8_t)(0x80 | (cp & 0x3F));
+    return 2;
+  }
+  if (cp < 0x10000) {
+    out[0] = (uint8_t)(0xE0 | (cp >> 12));
+    out[1] = (uint8_t)(0x80 | ((cp >> 6) & 0x3F));
+    out[2] = (uint8_t)(0x80 | (cp & 0x3F));
+    return 3;
+  }
+  out[0] = (uint8_t)(0xF0 | (cp >> 18));
+  out[1] = (uint8_t)(0x80 | ((cp >> 12) & 0x3F));
+  out[2] = (uint8_t)(0x80 | ((cp >> 6) & 0x3F));
+  out[3] = (uint8_t)(0x80 | (cp & 0x3F));
+  return 4;
 }
 
-static size_t glyph_to_byte_pos(const GlyphIndex *idx, size_t glyph_pos) {
-  if (!idx || !idx->glyph_to_byte) return 0;
-  if (glyph_pos > idx->glyph_count) return idx->glyph_to_byte[idx->glyph_count];
-  return idx->glyph_to_byte[glyph_pos];
+// Glyph arithmetic on valid UTF-8: count lead bytes.
+static size_t utf8_glyphs_between(const uint8_t *s, size_t a, size_t b) {
+  size_t g = 0;
+  for (size_t i = a; i < b; i++) {
+    if ((s[i] & 0xC0) != 0x80) g += 1;
+  }
+  return g;
 }
 
-static size_t byte_to_glyph_pos(const GlyphIndex *idx, size_t byte_pos) {
-  if (!idx || !idx->glyph_to_byte) return 0;
-  size_t lo = 0;
-  size_t hi = idx->glyph_count;
-  while (lo < hi) {
-    size_t mid = lo + (hi - lo) / 2;
-    size_t b = idx->glyph_to_byte[mid];
-    if (b < byte_pos) lo = mid + 1;
-    else hi = mid;
+static size_t utf8_skip_glyphs(const uint8_t *s, size_t len, size_t pos, size_t glyphs) {
+  while (glyphs > 0 && pos < len) {
+    pos += 1;
+    while (pos < len && (s[pos] & 0xC0) == 0x80) pos += 1;
+    glyphs -= 1;
   }
-  if (lo <= idx->glyph_count && idx->glyph_to_byte[lo] == byte_pos) return lo;
-  return lo;
+  return pos;
 }
 
 static PS_Status get_string_arg(PS_Context *ctx, PS_Value *v, const char **s, size_t *len) {
@@ -198,130 +330,1801 @@ static PS_Status get_int_arg(PS_Context *ctx, PS_Value *v, int64_t *out) {
   return PS_OK;
 }
 
-static RegexEntry *store_find(int id) {
-  for (size_t i = 0; i < g_store.len; i++) {
-    if (g_store.items[i].valid && g_store.items[i].id == id) return &g_store.items[i];
+// ---- Code point sets -------------------------------------------------------
+
+typedef struct {
+  uint32_t *r; // lo, hi pairs
+  size_t n;    // pairs
+  size_t cap;  // pairs
+} RxRanges;
+
+static int rx_ranges_add(RxRanges *s, uint32_t lo, uint32_t hi) {
+  if (s->n == s->cap) {
+    size_t ncap = s->cap ? s->cap * 2 : 8;
+    uint32_t *nr = (uint32_t *)realloc(s->r, ncap * 2 * sizeof(uint32_t));
+    if (!nr) return 0;
+    s->r = nr;
+    s->cap = ncap;
   }
-  return NULL;
+  s->r[2 * s->n] = lo;
+  s->r[2 * s->n + 1] = hi;
+  s->n += 1;
+  return 1;
 }
 
-static RegexEntry *store_add(void) {
-  if (g_store.len == g_store.cap) {
-    size_t ncap = g_store.cap == 0 ? 8 : g_store.cap * 2;
-    RegexEntry *n = (RegexEntry *)realloc(g_store.items, sizeof(RegexEntry) * ncap);
-    if (!n) return NULL;
-    g_store.items = n;
-    g_store.cap = ncap;
+static void rx_ranges_free(RxRanges *s) {
+  free(s->r);
+  s->r = NULL;
+  s->n = 0;
+  s->cap = 0;
+}
+
+static int rx_range_cmp(const void *a, const void *b) {
+  uint32_t x = ((const uint32_t *)a)[0];
+  uint32_t y = ((const uint32_t *)b)[0];
+  return x < y ? -1 : (x > y ? 1 : 0);
+}
+
+// Sorts and merges overlapping or adjacent ranges.
+static void rx_ranges_norm(RxRanges *s) {
+  if (s->n < 2) return;
+  qsort(s->r, s->n, 2 * sizeof(uint32_t), rx_range_cmp);
+  size_t w = 0;
+  for (size_t i = 1; i < s->n; i++) {
+    uint32_t lo = s->r[2 * i];
+    uint32_t hi = s->r[2 * i + 1];
+    if (lo <= s->r[2 * w + 1] + 1) {
+      if (hi > s->r[2 * w + 1]) s->r[2 * w + 1] = hi;
+    } else {
+      w += 1;
+      s->r[2 * w] = lo;
+      s->r[2 * w + 1] = hi;
+    }
   }
-  RegexEntry *e = &g_store.items[g_store.len++];
-  memset(e, 0, sizeof(*e));
-  e->id = ++g_store.next_id;
-  e->valid = 1;
-  return e;
+  s->n = w + 1;
 }
 
-static int is_escaped(const char *s, size_t i) {
-  size_t c = 0;
-  while (i > 0 && s[i - 1] == '\\') {
-    c += 1;
-    i -= 1;
+// Complement of a normalized set.
+static int rx_ranges_negate(RxRanges *s) {
+  RxRanges out = {0};
+  uint32_t next = 0;
+  int ok = 1;
+  for (size_t i = 0; i < s->n && ok; i++) {
+    if (s->r[2 * i] > next) ok = rx_ranges_add(&out, next, s->r[2 * i] - 1);
+    next = s->r[2 * i + 1] + 1;
   }
-  return (c % 2) != 0;
+  if (ok && next <= RX_MAX_CP) ok = rx_ranges_add(&out, next, RX_MAX_CP);
+  rx_ranges_free(s);
+  *s = out;
+  return ok;
 }
 
-static int has_forbidden_meta(const char *p, size_t len) {
-  int in_class = 0;
-  for (size_t i = 0; i + 1 < len; i++) {
-    if (p[i] == '\\' && !is_escaped(p, i)) {
-      i += 1;
-      continue;
+static int rx_ranges_append(RxRanges *dst, const RxRanges *src) {
+  for (size_t i = 0; i < src->n; i++) {
+    if (!rx_ranges_add(dst, src->r[2 * i], src->r[2 * i + 1])) return 0;
+  }
+  return 1;
+}
+
+// Simple case folding for the `i` flag: ASCII, Latin-1, Latin Extended-A,
+// basic Greek and Cyrillic. delta == 0 marks upper/lower pairs that
+// alternate from `lo`; otherwise cp in [lo, hi] folds to cp + delta.
+static const struct {
+  int32_t lo;
+  int32_t hi;
+  int32_t delta;
+} rx_fold_table[] = {
+  {0x41, 0x5A, 32},     {0xC0, 0xD6, 32},     {0xD8, 0xDE, 32},   {0x178, 0x178, -0x79},
+  {0x100, 0x12F, 0},    {0x132, 0x137, 0},    {0x139, 0x148, 0},  {0x14A, 0x177, 0},
+  {0x179, 0x17E, 0},    {0x391, 0x3A1, 32},   {0x3A3, 0x3AB, 32}, {0x400, 0x40F, 80},
+  {0x410, 0x42F, 32},   {0x460, 0x481, 0},    {0x48A, 0x4BF, 0},
+};
+
+#define RX_FOLD_MIN 0x41u
+#define RX_FOLD_MAX 0x4BFu
+
+static int rx_fold_variants(uint32_t cp, uint32_t out[4]) {
+  int n = 0;
+  int32_t c = (int32_t)cp;
+  for (size_t k = 0; k < sizeof(rx_fold_table) / sizeof(rx_fold_table[0]) && n < 4; k++) {
+    int32_t lo = rx_fold_table[k].lo;
+    int32_t hi = rx_fold_table[k].hi;
+    int32_t d = rx_fold_table[k].delta;
+    if (d == 0) {
+      if (c >= lo && c <= hi) out[n++] = (uint32_t)(lo + ((c - lo) ^ 1));
+    } else if (c >= lo && c <= hi) {
+      out[n++] = (uint32_t)(c + d);
+    } else if (c >= lo + d && c <= hi + d) {
+      out[n++] = (uint32_t)(c - d);
     }
-    if (!in_class && p[i] == '[' && !is_escaped(p, i)) {
-      in_class = 1;
-      continue;
+  }
+  return n;
+}
+
+static int rx_ranges_fold(RxRanges *s) {
+  size_t n0 = s->n;
+  for (size_t i = 0; i < n0; i++) {
+    uint32_t lo = s->r[2 * i] < RX_FOLD_MIN ? RX_FOLD_MIN : s->r[2 * i];
+    uint32_t hi = s->r[2 * i + 1] > RX_FOLD_MAX ? RX_FOLD_MAX : s->r[2 * i + 1];
+    for (uint32_t cp = lo; cp <= hi; cp++) {
+      uint32_t v[4];
+      int k = rx_fold_variants(cp, v);
+      for (int j = 0; j < k; j++) {
+        if (!rx_ranges_add(s, v[j], v[j])) return 0;
+      }
     }
-    if (in_class && p[i] == ']' && !is_escaped(p, i)) {
-      in_class = 0;
-      continue;
+  }
+  rx_ranges_norm(s);
+  return 1;
+}
+
+static int rx_shorthand(RxRanges *s, char c) {
+  RxRanges t = {0};
+  int ok = 1;
+  switch (c) {
+    case 'd':
+    case 'D':
+      ok = rx_ranges_add(&t, '0', '9');
+      break;
+    case 'w':
+    case 'W':
+      ok = rx_ranges_add(&t, '0', '9') && rx_ranges_add(&t, 'A', 'Z') && rx_ranges_add(&t, '_', '_') &&
+           rx_ranges_add(&t, 'a', 'z');
+      break;
+    default:
+      ok = rx_ranges_add(&t, '\t', '\r') && rx_ranges_add(&t, ' ', ' ');
+      break;
+  }
+  if (ok && isupper((unsigned char)c)) ok = rx_ranges_negate(&t);
+  if (ok) ok = rx_ranges_append(s, &t);
+  rx_ranges_free(&t);
+  return ok;
+}
+
+// A single normalized range covers [lo, hi].
+static int rx_ranges_cover(const uint32_t *r, size_t n, uint32_t lo, uint32_t hi) {
+  for (size_t i = 0; i < n; i++) {
+    if (r[2 * i] <= lo && r[2 * i + 1] >= hi) return 1;
+  }
+  return 0;
+}
+
+// ---- Parser ----------------------------------------------------------------
+
+enum { RXN_LIT, RXN_CLASS, RXN_ASSERT, RXN_GROUP, RXN_CAT, RXN_ALT, RXN_REPEAT };
+
+typedef struct {
+  int kind;
+  int first;
+  int last;
+  int next;
+  int cap;      // GROUP: capture number, 0 when non-capturing
+  int min;      // REPEAT
+  int max;      // REPEAT: < 0 when unbounded
+  int greedy;   // REPEAT
+  uint32_t cp;  // LIT code point, ASSERT kind
+  size_t off;   // CLASS: first pair in RxParser.ranges
+  size_t count; // CLASS: pairs
+} RxNode;
+
+typedef struct {
+  const char *p;
+  size_t len;
+  size_t i;
+  int icase;
+  int multiline;
+  int dotall;
+  RxNode *nodes;
+  size_t node_len;
+  size_t node_cap;
+  RxRanges ranges;
+  int groups;
+  int depth;
+  int err_kind;
+  char err[160];
+} RxParser;
+
+static int rx_err(RxParser *ps, int kind, const char *fmt, ...) {
+  if (ps->err_kind == RX_ERR_NONE) {
+    va_list ap;
+    va_start(ap, fmt);
+    vsnprintf(ps->err, sizeof(ps->err), fmt, ap);
+    va_end(ap);
+    ps->err_kind = kind;
+  }
+  return -1;
+}
+
+static int rx_oom(RxParser *ps) {
+  return rx_err(ps, RX_ERR_OOM, "out of memory");
+}
+
+static int rx_node(RxParser *ps, int kind) {
+  if (ps->node_len == ps->node_cap) {
+    size_t ncap = ps->node_cap ? ps->node_cap * 2 : 32;
+    RxNode *nn = (RxNode *)realloc(ps->nodes, ncap * sizeof(RxNode));
+    if (!nn) return rx_oom(ps);
+    ps->nodes = nn;
+    ps->node_cap = ncap;
+  }
+  RxNode *n = &ps->nodes[ps->node_len];
+  memset(n, 0, sizeof(*n));
+  n->kind = kind;
+  n->first = n->last = n->next = -1;
+  return (int)ps->node_len++;
+}
+
+static void rx_node_push(RxParser *ps, int parent, int child) {
+  RxNode *pn = &ps->nodes[parent];
+  if (pn->last < 0) pn->first = child;
+  else ps->nodes[pn->last].next = child;
+  pn->last = child;
+}
+
+// Takes ownership of `s`.
+static int rx_class_node(RxParser *ps, RxRanges *s, int ok) {
+  int n = ok ? rx_node(ps, RXN_CLASS) : rx_oom(ps);
+  if (n >= 0) {
+    ps->nodes[n].off = ps->ranges.n;
+    ps->nodes[n].count = s->n;
+    if (!rx_ranges_append(&ps->ranges, s)) n = rx_oom(ps);
+  }
+  rx_ranges_free(s);
+  return n;
+}
+
+static int rx_lit_node(RxParser *ps, uint32_t cp) {
+  uint32_t v[4];
+  int k = ps->icase ? rx_fold_variants(cp, v) : 0;
+  if (k > 0) {
+    RxRanges s = {0};
+    int ok = rx_ranges_add(&s, cp, cp);
+    for (int j = 0; j < k && ok; j++) ok = rx_ranges_add(&s, v[j], v[j]);
+    if (ok) rx_ranges_norm(&s);
+    return rx_class_node(ps, &s, ok);
+  }
+  int n = rx_node(ps, RXN_LIT);
+  if (n >= 0) ps->nodes[n].cp = cp;
+  return n;
+}
+
+static int rx_assert_node(RxParser *ps, int kind) {
+  int n = rx_node(ps, RXN_ASSERT);
+  if (n >= 0) ps->nodes[n].cp = (uint32_t)kind;
+  return n;
+}
+
+static int rx_hex_value(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+
+// Reads exactly `n` hex digits at ps->i.
+static int rx_hex_fixed(RxParser *ps, int n, uint32_t *out) {
+  uint32_t v = 0;
+  for (int k = 0; k < n; k++) {
+    if (ps->i >= ps->len || rx_hex_value(ps->p[ps->i]) < 0) return 0;
+    v = v * 16 + (uint32_t)rx_hex_value(ps->p[ps->i]);
+    ps->i += 1;
+  }
+  *out = v;
+  return 1;
+}
+
+// \u{H..H} or \uHHHH (a surrogate pair of \uHHHH escapes is combined).
+static int rx_parse_unicode_escape(RxParser *ps, uint32_t *cp) {
+  if (ps->i < ps->len && ps->p[ps->i] == '{') {
+    ps->i += 1;
+    uint32_t v = 0;
+    size_t digits = 0;
+    while (ps->i < ps->len && rx_hex_value(ps->p[ps->i]) >= 0 && digits < 6) {
+      v = v * 16 + (uint32_t)rx_hex_value(ps->p[ps->i]);
+      ps->i += 1;
+      digits += 1;
     }
-    if (!in_class && (p[i] == '*' || p[i] == '+' || p[i] == '?') && p[i + 1] == '?') return 1;
+    if (digits == 0 || ps->i >= ps->len || ps->p[ps->i] != '}') return rx_err(ps, RX_ERR_SYNTAX, "invalid escape");
+    ps->i += 1;
+    if (v > RX_MAX_CP || (v >= 0xD800 && v <= 0xDFFF)) return rx_err(ps, RX_ERR_SYNTAX, "invalid escape");
+    *cp = v;
+    return 0;
   }
-  for (size_t i = 0; i + 2 < len; i++) {
-    if (p[i] == '(' && p[i + 1] == '?' && (p[i + 2] == '=' || p[i + 2] == '!')) return 1;
+  uint32_t v = 0;
+  if (!rx_hex_fixed(ps, 4, &v)) return rx_err(ps, RX_ERR_SYNTAX, "invalid escape");
+  if (v >= 0xD800 && v <= 0xDBFF && ps->i + 1 < ps->len && ps->p[ps->i] == '\\' && ps->p[ps->i + 1] == 'u') {
+    size_t save = ps->i;
+    uint32_t lo = 0;
+    ps->i += 2;
+    if (rx_hex_fixed(ps, 4, &lo) && lo >= 0xDC00 && lo <= 0xDFFF) {
+      *cp = 0x10000 + ((v - 0xD800) << 10) + (lo - 0xDC00);
+      return 0;
+    }
+    ps->i = save;
+  }
+  if (v >= 0xD800 && v <= 0xDFFF) return rx_err(ps, RX_ERR_SYNTAX, "invalid escape");
+  *cp = v;
+  return 0;
+}
+
+// Escape body at ps->i (after the backslash). Returns 1 with *cp set, 2 after
+// adding a shorthand class to `set`, -1 on error.
+static int rx_parse_escape_item(RxParser *ps, int in_class, uint32_t *cp, RxRanges *set) {
+  char c = ps->p[ps->i];
+  switch (c) {
+    case 'd':
+    case 'D':
+    case 'w':
+    case 'W':
+    case 's':
+    case 'S':
+      ps->i += 1;
+      return rx_shorthand(set, c) ? 2 : rx_oom(ps);
+    case 'n':
+      *cp = '\n';
+      break;
+    case 'r':
+      *cp = '\r';
+      break;
+    case 't':
+      *cp = '\t';
+      break;
+    case 'f':
+      *cp = '\f';
+      break;
+    case 'v':
+      *cp = '\v';
+      break;
+    case 'b':
+      if (!in_class) return rx_err(ps, RX_ERR_SYNTAX, "invalid escape");
+      *cp = '\b';
+      break;
+    case '0':
+      if (ps->i + 1 < ps->len && isdigit((unsigned char)ps->p[ps->i + 1])) return rx_err(ps, RX_ERR_SYNTAX, "invalid escape");
+      *cp = 0;
+      break;
+    case 'x':
+      ps->i += 1;
+      if (!rx_hex_fixed(ps, 2, cp)) return rx_err(ps, RX_ERR_SYNTAX, "invalid escape");
+      return 1;
+    case 'u':
+      ps->i += 1;
+      return rx_parse_unicode_escape(ps, cp) < 0 ? -1 : 1;
+    case 'k':
+      return rx_err(ps, RX_ERR_SYNTAX, "forbidden metasyntax (backreference/lookaround)");
+    default: {
+      if (c >= '1' && c <= '9') return rx_err(ps, RX_ERR_SYNTAX, "forbidden metasyntax (backreference/lookaround)");
+      if (isalnum((unsigned char)c)) return rx_err(ps, RX_ERR_SYNTAX, "invalid escape");
+      size_t next = 0;
+      if (!utf8_decode_one((const uint8_t *)ps->p, ps->len, ps->i, cp, &next)) return rx_err(ps, RX_ERR_SYNTAX, "pattern must be valid UTF-8");
+      ps->i = next;
+      return 1;
+    }
   }
-  for (size_t i = 0; i + 3 < len; i++) {
-    if (p[i] == '(' && p[i + 1] == '?' && p[i + 2] == '<' && (p[i + 3] == '=' || p[i + 3] == '!')) return 1;
+  ps->i += 1;
+  return 1;
+}
+
+static int rx_parse_alt(RxParser *ps);
+
+static int rx_at_repeat(const RxParser *ps) {
+  if (ps->i >= ps->len) return 0;
+  char c = ps->p[ps->i];
+  if (c == '*' || c == '+' || c == '?') return 1;
+  return c == '{' && ps->i + 1 < ps->len && isdigit((unsigned char)ps->p[ps->i + 1]);
+}
+
+static int rx_parse_count(RxParser *ps, int *out) {
+  size_t start = ps->i;
+  long v = 0;
+  while (ps->i < ps->len && isdigit((unsigned char)ps->p[ps->i])) {
+    if (v <= RX_MAX_REPEAT) v = v * 10 + (ps->p[ps->i] - '0');
+    ps->i += 1;
   }
-  for (size_t i = 0; i + 1 < len; i++) {
-    if (p[i] == '\\' && !is_escaped(p, i) && p[i + 1] >= '1' && p[i + 1] <= '9') return 1;
+  if (ps->i == start) return 0;
+  *out = v > RX_MAX_REPEAT ? RX_MAX_REPEAT + 1 : (int)v;
+  return 1;
+}
+
+// {m}, {m,} or {m,n} at ps->i.
+static int rx_parse_braces(RxParser *ps, int *min, int *max) {
+  ps->i += 1;
+  if (!rx_parse_count(ps, min)) return rx_err(ps, RX_ERR_SYNTAX, "invalid repetition");
+  *max = *min;
+  if (ps->i < ps->len && ps->p[ps->i] == ',') {
+    ps->i += 1;
+    *max = -1;
+    if (ps->i < ps->len && isdigit((unsigned char)ps->p[ps->i])) rx_parse_count(ps, max);
   }
+  if (ps->i >= ps->len || ps->p[ps->i] != '}') return rx_err(ps, RX_ERR_SYNTAX, "invalid repetition");
+  ps->i += 1;
+  if (*min > RX_MAX_REPEAT || *max > RX_MAX_REPEAT) return rx_err(ps, RX_ERR_LIMIT, "repetition count too large (max %d)", RX_MAX_REPEAT);
+  if (*max >= 0 && *max < *min) return rx_err(ps, RX_ERR_SYNTAX, "invalid repetition range");
   return 0;
 }
 
-static int validate_basic_syntax(const char *p, size_t len, char *err, size_t err_cap) {
-  int paren = 0;
-  int in_class = 0;
-  int class_has_content = 0;
-  for (size_t i = 0; i < len; i++) {
-    char c = p[i];
-    if (c == '\\') {
-      i += 1;
-      continue;
+static int rx_parse_repeat(RxParser *ps, int atom) {
+  if (!rx_at_repeat(ps)) return atom;
+  if (ps->nodes[atom].kind == RXN_ASSERT) return rx_err(ps, RX_ERR_SYNTAX, "quantifier without atom");
+  int min = 0;
+  int max = -1;
+  char c = ps->p[ps->i];
+  if (c == '*') {
+    ps->i += 1;
+  } else if (c == '+') {
+    min = 1;
+    ps->i += 1;
+  } else if (c == '?') {
+    max = 1;
+    ps->i += 1;
+  } else if (rx_parse_braces(ps, &min, &max) < 0) {
+    return -1;
+  }
+  int greedy = 1;
+  if (ps->i < ps->len && ps->p[ps->i] == '?') {
+    greedy = 0;
+    ps->i += 1;
+  }
+  if (rx_at_repeat(ps)) return rx_err(ps, RX_ERR_SYNTAX, "quantifier without atom");
+  int rep = rx_node(ps, RXN_REPEAT);
+  if (rep < 0) return -1;
+  ps->nodes[rep].min = min;
+  ps->nodes[rep].max = max;
+  ps->nodes[rep].greedy = greedy;
+  rx_node_push(ps, rep, atom);
+  return rep;
+}
+
+// One class member at ps->i: 1 with *cp set, 2 after adding a shorthand.
+static int rx_parse_class_item(RxParser *ps, uint32_t *cp, RxRanges *set) {
+  if (ps->p[ps->i] == '\\') {
+    ps->i += 1;
+    if (ps->i >= ps->len) return rx_err(ps, RX_ERR_SYNTAX, "unclosed character class");
+    return rx_parse_escape_item(ps, 1, cp, set);
+  }
+  size_t next = 0;
+  if (!utf8_decode_one((const uint8_t *)ps->p, ps->len, ps->i, cp, &next)) return rx_err(ps, RX_ERR_SYNTAX, "pattern must be valid UTF-8");
+  ps->i = next;
+  return 1;
+}
+
+static int rx_parse_class(RxParser *ps) {
+  ps->i += 1;
+  int neg = 0;
+  if (ps->i < ps->len && ps->p[ps->i] == '^') {
+    neg = 1;
+    ps->i += 1;
+  }
+  RxRanges s = {0};
+  int ok = 1;
+  if (ps->i < ps->len && ps->p[ps->i] == ']') {
+    if (!neg) return rx_err(ps, RX_ERR_SYNTAX, "empty character class");
+    ps->i += 1;
+    return rx_class_node(ps, &s, rx_ranges_add(&s, 0, RX_MAX_CP));
+  }
+  for (;;) {
+    if (ps->i >= ps->len) {
+      rx_ranges_free(&s);
+      return rx_err(ps, RX_ERR_SYNTAX, "unclosed character class");
+    }
+    if (ps->p[ps->i] == ']') {
+      ps->i += 1;
+      break;
+    }
+    uint32_t lo = 0;
+    int kind = rx_parse_class_item(ps, &lo, &s);
+    if (kind < 0) {
+      rx_ranges_free(&s);
+      return -1;
     }
-    if (!in_class) {
-      if (c == '[') {
-        in_class = 1;
-        class_has_content = 0;
-        continue;
+    if (kind == 2) continue;
+    if (ps->i + 1 < ps->len && ps->p[ps->i] == '-' && ps->p[ps->i + 1] != ']') {
+      ps->i += 1;
+      uint32_t hi = 0;
+      RxRanges t = {0};
+      int k2 = rx_parse_class_item(ps, &hi, &t);
+      if (k2 < 0) {
+        rx_ranges_free(&t);
+        rx_ranges_free(&s);
+        return -1;
       }
-      if (c == '(') {
-        paren += 1;
-        continue;
+      if (k2 == 2) {
+        // [a-\d]: no range, the '-' is literal.
+        ok = rx_ranges_add(&s, lo, lo) && rx_ranges_add(&s, '-', '-') && rx_ranges_append(&s, &t);
+      } else if (hi < lo) {
+        rx_ranges_free(&t);
+        rx_ranges_free(&s);
+        return rx_err(ps, RX_ERR_SYNTAX, "inverted range in class");
+      } else {
+        ok = rx_ranges_add(&s, lo, hi);
       }
-      if (c == ')') {
-        if (paren == 0) {
-          snprintf(err, err_cap, "unmatched ')' in pattern");
-          return 0;
-        }
-        paren -= 1;
-        continue;
+      rx_ranges_free(&t);
+    } else {
+      ok = rx_ranges_add(&s, lo, lo);
+    }
+    if (!ok) break;
+  }
+  if (ok) {
+    rx_ranges_norm(&s);
+    if (ps->icase) ok = rx_ranges_fold(&s);
+    if (ok && neg) ok = rx_ranges_negate(&s);
+  }
+  return rx_class_node(ps, &s, ok);
+}
+
+static int rx_parse_group(RxParser *ps) {
+  ps->i += 1;
+  int cap = 0;
+  if (ps->i < ps->len && ps->p[ps->i] == '?') {
+    char a = ps->i + 1 < ps->len ? ps->p[ps->i + 1] : '\0';
+    char b = ps->i + 2 < ps->len ? ps->p[ps->i + 2] : '\0';
+    if (a == ':') {
+      ps->i += 2;
+    } else if (a == '=' || a == '!' || (a == '<' && (b == '=' || b == '!'))) {
+      return rx_err(ps, RX_ERR_SYNTAX, "forbidden metasyntax (backreference/lookaround)");
+    } else {
+      return rx_err(ps, RX_ERR_SYNTAX, "unsupported group syntax");
+    }
+  } else {
+    if (ps->groups >= RX_MAX_GROUPS) return rx_err(ps, RX_ERR_LIMIT, "too many capturing groups (max 99)");
+    cap = ++ps->groups;
+  }
+  int child = rx_parse_alt(ps);
+  if (child < 0) return -1;
+  if (ps->i >= ps->len || ps->p[ps->i] != ')') {
+    return rx_err(ps, RX_ERR_SYNTAX, "Invalid regular expression: /%.*s/: Unterminated group", (int)ps->len, ps->p);
+  }
+  ps->i += 1;
+  int g = rx_node(ps, RXN_GROUP);
+  if (g < 0) return -1;
+  ps->nodes[g].cap = cap;
+  rx_node_push(ps, g, child);
+  return g;
+}
+
+static int rx_parse_atom(RxParser *ps) {
+  if (rx_at_repeat(ps)) return rx_err(ps, RX_ERR_SYNTAX, "quantifier without atom");
+  char c = ps->p[ps->i];
+  switch (c) {
+    case '(':
+      return rx_parse_group(ps);
+    case '[':
+      return rx_parse_class(ps);
+    case '.': {
+      ps->i += 1;
+      RxRanges s = {0};
+      int ok = ps->dotall ? rx_ranges_add(&s, 0, RX_MAX_CP) : (rx_ranges_add(&s, 0, '\n' - 1) && rx_ranges_add(&s, '\n' + 1, RX_MAX_CP));
+      return rx_class_node(ps, &s, ok);
+    }
+    case '^':
+      ps->i += 1;
+      return rx_assert_node(ps, ps->multiline ? RX_A_LINE_BEGIN : RX_A_BEGIN);
+    case '$':
+      ps->i += 1;
+      return rx_assert_node(ps, ps->multiline ? RX_A_LINE_END : RX_A_END);
+    case '\\': {
+      ps->i += 1;
+      if (ps->i >= ps->len) return rx_err(ps, RX_ERR_SYNTAX, "trailing backslash in pattern");
+      if (ps->p[ps->i] == 'b' || ps->p[ps->i] == 'B') {
+        int kind = ps->p[ps->i] == 'b' ? RX_A_WORD : RX_A_NOT_WORD;
+        ps->i += 1;
+        return rx_assert_node(ps, kind);
+      }
+      RxRanges s = {0};
+      uint32_t cp = 0;
+      int k = rx_parse_escape_item(ps, 0, &cp, &s);
+      if (k < 0) {
+        rx_ranges_free(&s);
+        return -1;
+      }
+      if (k == 2) {
+        rx_ranges_norm(&s);
+        return rx_class_node(ps, &s, 1);
+      }
+      return rx_lit_node(ps, cp);
+    }
+    default: {
+      uint32_t cp = 0;
+      size_t next = 0;
+      if (!utf8_decode_one((const uint8_t *)ps->p, ps->len, ps->i, &cp, &next)) return rx_err(ps, RX_ERR_SYNTAX, "pattern must be valid UTF-8");
+      ps->i = next;
+      return rx_lit_node(ps, cp);
+    }
+  }
+}
+
+static int rx_parse_cat(RxParser *ps) {
+  int cat = rx_node(ps, RXN_CAT);
+  if (cat < 0) return -1;
+  while (ps->i < ps->len && ps->p[ps->i] != '|' && ps->p[ps->i] != ')') {
+    int atom = rx_parse_atom(ps);
+    if (atom >= 0) atom = rx_parse_repeat(ps, atom);
+    if (atom < 0) return -1;
+    rx_node_push(ps, cat, atom);
+  }
+  return cat;
+}
+
+static int rx_parse_alt(RxParser *ps) {
+  if (++ps->depth > RX_MAX_DEPTH) return rx_err(ps, RX_ERR_LIMIT, "pattern nesting too deep");
+  int first = rx_parse_cat(ps);
+  if (first < 0) return -1;
+  int alt = -1;
+  while (ps->i < ps->len && ps->p[ps->i] == '|') {
+    ps->i += 1;
+    if (alt < 0) {
+      alt = rx_node(ps, RXN_ALT);
+      if (alt < 0) return -1;
+      rx_node_push(ps, alt, first);
+    }
+    int next = rx_parse_cat(ps);
+    if (next < 0) return -1;
+    rx_node_push(ps, alt, next);
+  }
+  ps->depth -= 1;
+  return alt >= 0 ? alt : first;
+}
+
+// ---- Compiler --------------------------------------------------------------
+
+typedef struct {
+  uint8_t n;
+  uint8_t lo[4];
+  uint8_t hi[4];
+} RxUtf8Seq;
+
+typedef struct {
+  RxUtf8Seq *items;
+  size_t len;
+  size_t cap;
+} RxUtf8Seqs;
+
+static void rx_prog_free(RxProg *prog);
+
+static int rx_emit(RxParser *ps, RxProg *prog, int op, int lo, int hi, int x, int y) {
+  if (prog->len >= RX_MAX_INSTS) return rx_err(ps, RX_ERR_LIMIT, "pattern too large");
+  if (prog->len == prog->cap) {
+    int ncap = prog->cap ? prog->cap * 2 : 64;
+    RxInst *ni = (RxInst *)realloc(prog->insts, (size_t)ncap * sizeof(RxInst));
+    if (!ni) return rx_oom(ps);
+    prog->insts = ni;
+    prog->cap = ncap;
+  }
+  RxInst *in = &prog->insts[prog->len];
+  in->op = (uint8_t)op;
+  in->lo = (uint8_t)lo;
+  in->hi = (uint8_t)hi;
+  in->x = x;
+  in->y = y;
+  return prog->len++;
+}
+
+static int rx_emit_set(RxParser *ps, RxProg *prog, const uint8_t bits[32]) {
+  if (prog->set_len == prog->set_cap) {
+    int ncap = prog->set_cap ? prog->set_cap * 2 : 4;
+    uint8_t(*ns)[32] = (uint8_t(*)[32])realloc(prog->sets, (size_t)ncap * 32);
+    if (!ns) return rx_oom(ps);
+    prog->sets = ns;
+    prog->set_cap = ncap;
+  }
+  memcpy(prog->sets[prog->set_len], bits, 32);
+  return rx_emit(ps, prog, RX_OP_SET, 0, 0, prog->set_len++, 0);
+}
+
+static int rx_seq_push(RxUtf8Seqs *seqs, uint32_t lo, uint32_t hi) {
+  if (seqs->len == seqs->cap) {
+    size_t ncap = seqs->cap ? seqs->cap * 2 : 8;
+    RxUtf8Seq *ni = (RxUtf8Seq *)realloc(seqs->items, ncap * sizeof(RxUtf8Seq));
+    if (!ni) return 0;
+    seqs->items = ni;
+    seqs->cap = ncap;
+  }
+  RxUtf8Seq *q = &seqs->items[seqs->len++];
+  q->n = (uint8_t)utf8_encode_one(lo, q->lo);
+  utf8_encode_one(hi, q->hi);
+  return 1;
+}
+
+// Splits [lo, hi] into byte-range sequences whose bytes vary independently
+// (the classic utf8-ranges construction). Surrogates are skipped.
+static int rx_utf8_split(RxUtf8Seqs *seqs, uint32_t lo, uint32_t hi) {
+  if (lo <= 0xD7FF && hi >= 0xE000) return rx_utf8_split(seqs, lo, 0xD7FF) && rx_utf8_split(seqs, 0xE000, hi);
+  if (lo >= 0xD800 && lo <= 0xDFFF) lo = 0xE000;
+  if (hi >= 0xD800 && hi <= 0xDFFF) hi = 0xD7FF;
+  if (lo > hi) return 1;
+  static const uint32_t limits[] = {0x7F, 0x7FF, 0xFFFF};
+  for (int k = 0; k < 3; k++) {
+    if (lo <= limits[k] && hi > limits[k]) return rx_utf8_split(seqs, lo, limits[k]) && rx_utf8_split(seqs, limits[k] + 1, hi);
+  }
+  if (hi > 0x7F) {
+    for (int k = 1; k < 4; k++) {
+      uint32_t m = (1u << (6 * k)) - 1;
+      if ((lo & ~m) != (hi & ~m)) {
+        if ((lo & m) != 0) return rx_utf8_split(seqs, lo, lo | m) && rx_utf8_split(seqs, (lo | m) + 1, hi);
+        if ((hi & m) != m) return rx_utf8_split(seqs, lo, (hi & ~m) - 1) && rx_utf8_split(seqs, hi & ~m, hi);
       }
-      if ((c == '*' || c == '+' || c == '?') && (i == 0 || p[i - 1] == '|' || p[i - 1] == '(')) {
-        snprintf(err, err_cap, "quantifier without atom");
-        return 0;
+    }
+  }
+  return rx_seq_push(seqs, lo, hi);
+}
+
+static int rx_seq_loose(RxUtf8Seqs *seqs, uint8_t lead_lo, uint8_t lead_hi, int n) {
+  if (!rx_seq_push(seqs, 0, 0)) return 0;
+  RxUtf8Seq *q = &seqs->items[seqs->len - 1];
+  q->n = (uint8_t)n;
+  q->lo[0] = lead_lo;
+  q->hi[0] = lead_hi;
+  for (int k = 1; k < n; k++) {
+    q->lo[k] = 0x80;
+    q->hi[k] = 0xBF;
+  }
+  return 1;
+}
+
+// Emits one byte test for an ASCII bitmap: RANGE when contiguous, else SET.
+static int rx_emit_ascii(RxParser *ps, RxProg *prog, const uint8_t bits[32]) {
+  int lo = -1;
+  int hi = -1;
+  int contiguous = 1;
+  for (int b = 0; b < 128; b++) {
+    if (!(bits[b >> 3] & (1u << (b & 7)))) continue;
+    if (lo < 0) lo = b;
+    else if (hi != b - 1) contiguous = 0;
+    hi = b;
+  }
+  if (contiguous) return rx_emit(ps, prog, RX_OP_RANGE, lo, hi, 0, 0);
+  return rx_emit_set(ps, prog, bits);
+}
+
+static int rx_compile_class(RxParser *ps, RxProg *prog, const uint32_t *r, size_t n) {
+  uint8_t ascii[32];
+  memset(ascii, 0, sizeof(ascii));
+  int has_ascii = 0;
+  RxUtf8Seqs seqs = {0};
+  int ok = 1;
+  for (size_t i = 0; i < n && ok; i++) {
+    uint32_t lo = r[2 * i];
+    uint32_t hi = r[2 * i + 1];
+    for (uint32_t b = lo; b <= hi && b < 0x80; b++) {
+      ascii[b >> 3] |= (uint8_t)(1u << (b & 7));
+      has_ascii = 1;
+    }
+    if (hi < 0x80) continue;
+    if (lo < 0x80) lo = 0x80;
+    // Bands covered entirely match any well-formed sequence of that length.
+    static const uint32_t bands[3][2] = {{0x80, 0x7FF}, {0x800, 0xFFFF}, {0x10000, RX_MAX_CP}};
+    for (int k = 0; k < 3 && ok; k++) {
+      uint32_t blo = lo > bands[k][0] ? lo : bands[k][0];
+      uint32_t bhi = hi < bands[k][1] ? hi : bands[k][1];
+      if (blo > bhi) continue;
+      int full = k == 1 ? (rx_ranges_cover(r, n, 0x800, 0xD7FF) && rx_ranges_cover(r, n, 0xE000, 0xFFFF))
+                        : rx_ranges_cover(r, n, bands[k][0], bands[k][1]);
+      if (!full) {
+        ok = rx_utf8_split(&seqs, blo, bhi);
+      } else if (blo == bands[k][0]) {
+        static const uint8_t leads[3][2] = {{0xC2, 0xDF}, {0xE0, 0xEF}, {0xF0, 0xF4}};
+        ok = rx_seq_loose(&seqs, leads[k][0], leads[k][1], k + 2);
       }
+    }
+  }
+  if (!ok) {
+    free(seqs.items);
+    return rx_oom(ps);
+  }
+  size_t alts = seqs.len + (has_ascii ? 1 : 0);
+  if (alts == 0) {
+    free(seqs.items);
+    return rx_emit(ps, prog, RX_OP_FAIL, 0, 0, 0, 0) < 0 ? -1 : 0;
+  }
+  int jumps = -1; // JMPs to the end, chained through y
+  for (size_t a = 0; a < alts; a++) {
+    int split = -1;
+    if (a + 1 < alts) {
+      split = rx_emit(ps, prog, RX_OP_SPLIT, 0, 0, 0, 0);
+      if (split < 0) break;
+      prog->insts[split].x = split + 1;
+    }
+    if (has_ascii && a == 0) {
+      if (rx_emit_ascii(ps, prog, ascii) < 0) break;
     } else {
-      if (c == ']') {
-        if (!class_has_content) {
-          snprintf(err, err_cap, "empty character class");
-          return 0;
+      const RxUtf8Seq *q = &seqs.items[a - (has_ascii ? 1 : 0)];
+      int bad = 0;
+      for (int k = 0; k < q->n && !bad; k++) bad = rx_emit(ps, prog, RX_OP_RANGE, q->lo[k], q->hi[k], 0, 0) < 0;
+      if (bad) break;
+    }
+    if (split >= 0) {
+      int j = rx_emit(ps, prog, RX_OP_JMP, 0, 0, 0, jumps);
+      if (j < 0) break;
+      jumps = j;
+      prog->insts[split].y = prog->len;
+    }
+  }
+  free(seqs.items);
+  if (ps->err_kind != RX_ERR_NONE) return -1;
+  while (jumps >= 0) {
+    int next = prog->insts[jumps].y;
+    prog->insts[jumps].x = prog->len;
+    prog->insts[jumps].y = 0;
+    jumps = next;
+  }
+  return 0;
+}
+
+static int rx_compile_node(RxParser *ps, RxProg *prog, int id) {
+  const RxNode *nd = &ps->nodes[id];
+  switch (nd->kind) {
+    case RXN_LIT: {
+      uint8_t bytes[4];
+      size_t n = utf8_encode_one(nd->cp, bytes);
+      for (size_t k = 0; k < n; k++) {
+        if (rx_emit(ps, prog, RX_OP_RANGE, bytes[k], bytes[k], 0, 0) < 0) return -1;
+      }
+      return 0;
+    }
+    case RXN_CLASS:
+      return rx_compile_class(ps, prog, ps->ranges.r + 2 * nd->off, nd->count);
+    case RXN_ASSERT:
+      return rx_emit(ps, prog, RX_OP_ASSERT, 0, 0, (int)nd->cp, 0) < 0 ? -1 : 0;
+    case RXN_GROUP:
+      if (nd->cap > 0 && rx_emit(ps, prog, RX_OP_SAVE, 0, 0, 2 * nd->cap, 0) < 0) return -1;
+      if (rx_compile_node(ps, prog, nd->first) < 0) return -1;
+      if (nd->cap > 0 && rx_emit(ps, prog, RX_OP_SAVE, 0, 0, 2 * nd->cap + 1, 0) < 0) return -1;
+      return 0;
+    case RXN_CAT:
+      for (int c = nd->first; c >= 0; c = ps->nodes[c].next) {
+        if (rx_compile_node(ps, prog, c) < 0) return -1;
+      }
+      return 0;
+    case RXN_ALT: {
+      int jumps = -1;
+      for (int c = nd->first; c >= 0; c = ps->nodes[c].next) {
+        if (ps->nodes[c].next < 0) {
+          if (rx_compile_node(ps, prog, c) < 0) return -1;
+          break;
         }
-        in_class = 0;
-        continue;
+        int split = rx_emit(ps, prog, RX_OP_SPLIT, 0, 0, 0, 0);
+        if (split < 0) return -1;
+        prog->insts[split].x = split + 1;
+        if (rx_compile_node(ps, prog, c) < 0) return -1;
+        int j = rx_emit(ps, prog, RX_OP_JMP, 0, 0, 0, jumps);
+        if (j < 0) return -1;
+        jumps = j;
+        prog->insts[split].y = prog->len;
       }
-      class_has_content = 1;
-      if (c == '-' && i > 0 && i + 1 < len && p[i - 1] != '[' && p[i + 1] != ']') {
-        unsigned char a = (unsigned char)p[i - 1];
-        unsigned char b = (unsigned char)p[i + 1];
-        if (a > b) {
-          snprintf(err, err_cap, "inverted range in class");
-          return 0;
+      while (jumps >= 0) {
+        int next = prog->insts[jumps].y;
+        prog->insts[jumps].x = prog->len;
+        prog->insts[jumps].y = 0;
+        jumps = next;
+      }
+      return 0;
+    }
+    default: {
+      int body = nd->first;
+      int min = nd->min;
+      int max = nd->max;
+      int greedy = nd->greedy;
+      int copies = (max < 0 && min > 0) ? min - 1 : min;
+      for (int k = 0; k < copies; k++) {
+        if (rx_compile_node(ps, prog, body) < 0) return -1;
+      }
+      if (max < 0 && min == 0) {
+        int split = rx_emit(ps, prog, RX_OP_SPLIT, 0, 0, 0, 0);
+        if (split < 0 || rx_compile_node(ps, prog, body) < 0) return -1;
+        if (rx_emit(ps, prog, RX_OP_JMP, 0, 0, split, 0) < 0) return -1;
+        prog->insts[split].x = greedy ? split + 1 : prog->len;
+        prog->insts[split].y = greedy ? prog->len : split + 1;
+      } else if (max < 0) {
+        int loop = prog->len;
+        if (rx_compile_node(ps, prog, body) < 0) return -1;
+        int split = rx_emit(ps, prog, RX_OP_SPLIT, 0, 0, 0, 0);
+        if (split < 0) return -1;
+        prog->insts[split].x = greedy ? loop : split + 1;
+        prog->insts[split].y = greedy ? split + 1 : loop;
+      } else {
+        int splits = -1; // optional copies, chained through y until patched
+        for (int k = min; k < max; k++) {
+          int split = rx_emit(ps, prog, RX_OP_SPLIT, 0, 0, 0, splits);
+          if (split < 0 || rx_compile_node(ps, prog, body) < 0) return -1;
+          splits = split;
+        }
+        while (splits >= 0) {
+          int next = prog->insts[splits].y;
+          prog->insts[splits].x = greedy ? splits + 1 : prog->len;
+          prog->insts[splits].y = greedy ? prog->len : splits + 1;
+          splits = next;
         }
       }
+      return 0;
     }
   }
-  if (in_class) {
-    snprintf(err, err_cap, "unclosed character class");
-    return 0;
+}
+
+static int rx_is_word_byte(int b) {
+  return b >= 0 && b < 0x80 && (isalnum(b) || b == '_');
+}
+
+// Partitions bytes into classes no instruction or assertion can tell apart.
+static void rx_build_byte_classes(RxProg *prog) {
+  uint8_t edge[257];
+  memset(edge, 0, sizeof(edge));
+  for (int pc = 0; pc < prog->len; pc++) {
+    const RxInst *in = &prog->insts[pc];
+    if (in->op == RX_OP_RANGE) {
+      edge[in->lo] = 1;
+      edge[in->hi + 1] = 1;
+    } else if (in->op == RX_OP_SET) {
+      const uint8_t *bits = prog->sets[in->x];
+      for (int b = 1; b < 256; b++) {
+        int cur = (bits[b >> 3] >> (b & 7)) & 1;
+        int prev = (bits[(b - 1) >> 3] >> ((b - 1) & 7)) & 1;
+        if (cur != prev) edge[b] = 1;
+      }
+    }
   }
-  if (paren != 0) {
-    snprintf(err, err_cap, "Invalid regular expression: /%.*s/: Unterminated group", (int)len, p ? p : "");
+  edge['\n'] = 1;
+  edge['\n' + 1] = 1;
+  for (int b = 1; b < 256; b++) {
+    if (rx_is_word_byte(b) != rx_is_word_byte(b - 1)) edge[b] = 1;
+  }
+  int cls = 0;
+  for (int b = 0; b < 256; b++) {
+    if (b > 0 && edge[b]) cls += 1;
+    prog->byte_class[b] = (uint8_t)cls;
+    if (b == 0 || edge[b]) prog->class_rep[cls] = (uint8_t)b;
+  }
+  prog->nclasses = cls + 1;
+}
+
+typedef struct {
+  uint8_t *cur;
+  size_t cur_len;
+  size_t cap;
+  uint8_t *prefix;
+  size_t prefix_len;
+  int prefix_open;
+  uint8_t *best;
+  size_t best_len;
+  int oom;
+} RxLitScan;
+
+static uint8_t *rx_bytes_dup(const uint8_t *src, size_t len) {
+  uint8_t *out = (uint8_t *)malloc(len);
+  if (out) memcpy(out, src, len);
+  return out;
+}
+
+// Closes the current run of literal bytes; the first run is the prefix when
+// nothing came before it, the longest one becomes the needle.
+static void rx_lit_break(RxLitScan *sc) {
+  if (sc->prefix_open) {
+    sc->prefix_open = 0;
+    if (sc->cur_len > 0) {
+      sc->prefix = rx_bytes_dup(sc->cur, sc->cur_len);
+      sc->prefix_len = sc->prefix ? sc->cur_len : 0;
+      if (!sc->prefix) sc->oom = 1;
+    }
+  }
+  if (sc->cur_len > sc->best_len) {
+    uint8_t *nb = rx_bytes_dup(sc->cur, sc->cur_len);
+    if (!nb) {
+      sc->oom = 1;
+    } else {
+      free(sc->best);
+      sc->best = nb;
+      sc->best_len = sc->cur_len;
+    }
+  }
+  sc->cur_len = 0;
+}
+
+// Walks the concatenation spine of the pattern: literals inside plain groups
+// and around assertions stay adjacent, anything else ends the current run.
+static void rx_lit_scan(const RxParser *ps, int id, RxLitScan *sc) {
+  const RxNode *nd = &ps->nodes[id];
+  if (nd->kind == RXN_LIT) {
+    if (sc->cur_len + 4 > sc->cap) {
+      size_t ncap = sc->cap ? sc->cap * 2 : 32;
+      uint8_t *nc = (uint8_t *)realloc(sc->cur, ncap);
+      if (!nc) {
+        sc->oom = 1;
+        return;
+      }
+      sc->cur = nc;
+      sc->cap = ncap;
+    }
+    sc->cur_len += utf8_encode_one(nd->cp, sc->cur + sc->cur_len);
+  } else if (nd->kind == RXN_GROUP) {
+    rx_lit_scan(ps, nd->first, sc);
+  } else if (nd->kind == RXN_CAT) {
+    for (int c = nd->first; c >= 0; c = ps->nodes[c].next) rx_lit_scan(ps, c, sc);
+  } else if (nd->kind != RXN_ASSERT) {
+    rx_lit_break(sc);
+  }
+}
+
+// Sets prog->prefix and prog->needle from the literal runs of the pattern.
+static int rx_extract_literals(const RxParser *ps, int root, RxProg *prog) {
+  RxLitScan sc;
+  memset(&sc, 0, sizeof(sc));
+  sc.prefix_open = 1;
+  rx_lit_scan(ps, root, &sc);
+  rx_lit_break(&sc);
+  prog->prefix = sc.prefix;
+  prog->prefix_len = sc.prefix_len;
+  // A needle no longer than the prefix adds nothing to the prefix search.
+  if (sc.best_len > sc.prefix_len) {
+    prog->needle = sc.best;
+    prog->needle_len = sc.best_len;
+    sc.best = NULL;
+  }
+  free(sc.cur);
+  free(sc.best);
+  return !sc.oom;
+}
+
+// Collects the bytes that can begin a match, treating assertions as passing.
+// Left empty when the pattern can match without consuming a byte, or when
+// too many bytes qualify for a scan to pay off.
+static int rx_build_first_set(RxProg *prog) {
+  int *stack = (int *)malloc(((size_t)prog->len * 2 + 2) * sizeof(int));
+  uint8_t *seen = (uint8_t *)calloc((size_t)prog->len, 1);
+  if (!stack || !seen) {
+    free(stack);
+    free(seen);
     return 0;
   }
+  int sp = 0;
+  int empty = 0;
+  stack[sp++] = 0;
+  while (sp > 0 && !empty) {
+    int pc = stack[--sp];
+    if (seen[pc]) continue;
+    seen[pc] = 1;
+    const RxInst *in = &prog->insts[pc];
+    switch (in->op) {
+      case RX_OP_SPLIT:
+        stack[sp++] = in->y;
+        stack[sp++] = in->x;
+        break;
+      case RX_OP_JMP:
+        stack[sp++] = in->x;
+        break;
+      case RX_OP_SAVE:
+      case RX_OP_ASSERT:
+        stack[sp++] = pc + 1;
+        break;
+      case RX_OP_MATCH:
+        empty = 1;
+        break;
+      case RX_OP_RANGE:
+        for (int b = in->lo; b <= in->hi; b++) prog->first_set[b] = 1;
+        break;
+      case RX_OP_SET:
+        for (int b = 0; b < 256; b++) {
+          if ((prog->sets[in->x][b >> 3] >> (b & 7)) & 1) prog->first_set[b] = 1;
+        }
+        break;
+      default:
+        break;
+    }
+  }
+  free(stack);
+  free(seen);
+  int count = 0;
+  for (int b = 0; b < 256; b++) {
+    if (prog->first_set[b]) {
+      count += 1;
+      prog->first_byte = (uint8_t)b;
+    }
+  }
+  prog->first_count = (empty || count > 128) ? 0 : count;
+  return 1;
+}
+
+// Next position >= pos where a match can start, or RX_UNSET when none.
+static size_t rx_next_candidate(const RxProg *prog, const uint8_t *s, size_t len, size_t pos) {
+  if (pos >= len) return RX_UNSET;
+  const uint8_t *hit = NULL;
+  if (prog->prefix_len > 1) {
+    hit = (const uint8_t *)memmem(s + pos, len - pos, prog->prefix, prog->prefix_len);
+  } else if (prog->prefix_len == 1) {
+    hit = (const uint8_t *)memchr(s + pos, prog->prefix[0], len - pos);
+  } else if (prog->first_count == 1) {
+    hit = (const uint8_t *)memchr(s + pos, prog->first_byte, len - pos);
+  } else {
+    while (pos < len && !prog->first_set[s[pos]]) pos++;
+    return pos < len ? pos : RX_UNSET;
+  }
+  return hit ? (size_t)(hit - s) : RX_UNSET;
+}
+
+static int rx_can_skip(const RxProg *prog) {
+  return !prog->anchored && (prog->prefix_len > 0 || prog->first_count > 0);
+}
+
+// Cheap rejection: a required literal is missing after `start`.
+static int rx_needle_missing(const RxProg *prog, const uint8_t *s, size_t len, size_t start) {
+  if (prog->needle_len == 0) return 0;
+  return memmem(s + start, len - start, prog->needle, prog->needle_len) == NULL;
+}
+
+static RxProg *rx_compile(const char *pattern, size_t len, const char *flags, char *err, size_t err_cap, int *err_kind) {
+  RxParser ps;
+  memset(&ps, 0, sizeof(ps));
+  ps.p = pattern;
+  ps.len = len;
+  ps.icase = strchr(flags, 'i') != NULL;
+  ps.multiline = strchr(flags, 'm') != NULL;
+  ps.dotall = strchr(flags, 's') != NULL;
+  RxProg *prog = (RxProg *)calloc(1, sizeof(RxProg));
+  if (!prog) rx_oom(&ps);
+  int root = prog ? rx_parse_alt(&ps) : -1;
+  if (root >= 0 && ps.i < ps.len) root = rx_err(&ps, RX_ERR_SYNTAX, "unmatched ')' in pattern");
+  if (root >= 0) {
+    prog->groups = ps.groups;
+    prog->ncap = 2 * (ps.groups + 1);
+    if (rx_emit(&ps, prog, RX_OP_SAVE, 0, 0, 0, 0) < 0 || rx_compile_node(&ps, prog, root) < 0 ||
+        rx_emit(&ps, prog, RX_OP_SAVE, 0, 0, 1, 0) < 0 || rx_emit(&ps, prog, RX_OP_MATCH, 0, 0, 0, 0) < 0) {
+      root = -1;
+    } else if (!rx_extract_literals(&ps, root, prog) || !rx_build_first_set(prog)) {
+      root = rx_oom(&ps);
+    }
+  }
+  free(ps.nodes);
+  rx_ranges_free(&ps.ranges);
+  if (root < 0) {
+    snprintf(err, err_cap, "%s", ps.err);
+    *err_kind = ps.err_kind;
+    rx_prog_free(prog);
+    return NULL;
+  }
+  prog->anchored = prog->insts[1].op == RX_OP_ASSERT && prog->insts[1].x == RX_A_BEGIN;
+  rx_build_byte_classes(prog);
+  return prog;
+}
+
+// ---- Pike VM ---------------------------------------------------------------
+
+static int rx_assert_ok(int kind, int prev, int next) {
+  switch (kind) {
+    case RX_A_BEGIN:
+      return prev < 0;
+    case RX_A_END:
+      return next < 0;
+    case RX_A_LINE_BEGIN:
+      return prev < 0 || prev == '\n';
+    case RX_A_LINE_END:
+      return next < 0 || next == '\n';
+    case RX_A_WORD:
+      return rx_is_word_byte(prev) != rx_is_word_byte(next);
+    default:
+      return rx_is_word_byte(prev) == rx_is_word_byte(next);
+  }
+}
+
+static int rx_byte_ok(const RxProg *prog, const RxInst *in, uint8_t b) {
+  if (in->op == RX_OP_RANGE) return b >= in->lo && b <= in->hi;
+  return (prog->sets[in->x][b >> 3] >> (b & 7)) & 1;
+}
+
+static int rx_threads_init(RxThreads *t, int len) {
+  t->sparse = (int *)calloc((size_t)len, sizeof(int));
+  t->dense = (int *)calloc((size_t)len, sizeof(int));
+  t->thr_pc = (int *)malloc((size_t)len * sizeof(int));
+  t->n = 0;
+  t->thr_n = 0;
+  t->thr_caps = NULL;
+  t->caps_cap = 0;
+  return t->sparse && t->dense && t->thr_pc;
+}
+
+static void rx_threads_free(RxThreads *t) {
+  free(t->sparse);
+  free(t->dense);
+  free(t->thr_pc);
+  free(t->thr_caps);
+}
+
+static int rx_vm_init(RxProg *prog) {
+  RxVm *vm = &prog->vm;
+  if (vm->ready) return 1;
+  vm->stack = (RxStackItem *)malloc(((size_t)prog->len * 2 + 2) * sizeof(RxStackItem));
+  vm->tmp = (size_t *)malloc((size_t)prog->ncap * sizeof(size_t));
+  if (!rx_threads_init(&vm->a, prog->len) || !rx_threads_init(&vm->b, prog->len) || !vm->stack || !vm->tmp) return 0;
+  vm->ready = 1;
+  return 1;
+}
+
+// Follows empty transitions from `pc0` at `pos` and queues the byte-consuming
+// and MATCH instructions reached, in priority order. Only the first `ncap`
+// capture slots are tracked; `caps` is restored on return.
+static int rx_add_thread(RxProg *prog, RxThreads *t, int pc0, size_t *caps, int ncap, const uint8_t *s, size_t start, size_t len, size_t pos) {
+  RxStackItem *stack = prog->vm.stack;
+  int sp = 0;
+  int prev = pos > start ? s[pos - 1] : -1;
+  int next = pos < len ? s[pos] : -1;
+  stack[sp].pc = pc0;
+  stack[sp].slot = -1;
+  sp += 1;
+  while (sp > 0) {
+    RxStackItem it = stack[--sp];
+    if (it.slot >= 0) {
+      caps[it.slot] = it.val;
+      continue;
+    }
+    int pc = it.pc;
+    for (;;) {
+      int d = t->sparse[pc];
+      if (d < t->n && t->dense[d] == pc) break;
+      t->sparse[pc] = t->n;
+      t->dense[t->n++] = pc;
+      const RxInst *in = &prog->insts[pc];
+      if (in->op == RX_OP_JMP) {
+        pc = in->x;
+      } else if (in->op == RX_OP_SPLIT) {
+        stack[sp].pc = in->y;
+        stack[sp].slot = -1;
+        sp += 1;
+        pc = in->x;
+      } else if (in->op == RX_OP_SAVE) {
+        if (in->x < ncap) {
+          stack[sp].pc = 0;
+          stack[sp].slot = in->x;
+          stack[sp].val = caps[in->x];
+          sp += 1;
+          caps[in->x] = pos;
+        }
+        pc += 1;
+      } else if (in->op == RX_OP_ASSERT) {
+        if (!rx_assert_ok(in->x, prev, next)) break;
+        pc += 1;
+      } else if (in->op == RX_OP_FAIL) {
+        break;
+      } else {
+        size_t need = ((size_t)t->thr_n + 1) * (size_t)ncap;
+        if (need > t->caps_cap) {
+          size_t ncap2 = t->caps_cap ? t->caps_cap * 2 : (size_t)ncap * 16;
+          while (ncap2 < need) ncap2 *= 2;
+          size_t *nc = (size_t *)realloc(t->thr_caps, ncap2 * sizeof(size_t));
+          if (!nc) return 0;
+          t->thr_caps = nc;
+          t->caps_cap = ncap2;
+        }
+        t->thr_pc[t->thr_n] = pc;
+        memcpy(t->thr_caps + (size_t)t->thr_n * (size_t)ncap, caps, (size_t)ncap * sizeof(size_t));
+        t->thr_n += 1;
+        break;
+      }
+    }
+  }
   return 1;
 }
 
-static int normalize_flags(PS_Context *ctx, const char *in, size_t len, char out[4], int *out_cflags) {
+// Leftmost-first search from `start`; returns 1 and fills `out` on a match,
+// 0 without match, -1 when out of memory. `ncap` is prog->ncap for all the
+// groups, or 2 when only the bounds of the match are needed (cheaper threads).
+static int rx_vm_search(RxProg *prog, const uint8_t *s, size_t len, size_t start, int ncap, size_t *out) {
+  if (!rx_vm_init(prog)) return -1;
+  RxThreads *clist = &prog->vm.a;
+  RxThreads *nlist = &prog->vm.b;
+  size_t *tmp = prog->vm.tmp;
+  int matched = 0;
+  int skip = rx_can_skip(prog);
+  clist->n = clist->thr_n = 0;
+  nlist->n = nlist->thr_n = 0;
+  for (size_t pos = start;; pos++) {
+    if (skip && !matched && clist->thr_n == 0) {
+      pos = rx_next_candidate(prog, s, len, pos);
+      if (pos == RX_UNSET) break;
+    }
+    if (!matched && (!prog->anchored || pos == start)) {
+      for (int k = 0; k < ncap; k++) tmp[k] = RX_UNSET;
+      if (!rx_add_thread(prog, clist, 0, tmp, ncap, s, start, len, pos)) return -1;
+    }
+    if (clist->thr_n == 0 && (matched || prog->anchored)) break;
+    for (int i = 0; i < clist->thr_n; i++) {
+      const RxInst *in = &prog->insts[clist->thr_pc[i]];
+      size_t *caps = clist->thr_caps + (size_t)i * (size_t)ncap;
+      if (in->op == RX_OP_MATCH) {
+        memcpy(out, caps, (size_t)ncap * sizeof(size_t));
+        matched = 1;
+        break;
+      }
+      if (pos < len && rx_byte_ok(prog, in, s[pos])) {
+        memcpy(tmp, caps, (size_t)ncap * sizeof(size_t));
+        if (!rx_add_thread(prog, nlist, clist->thr_pc[i] + 1, tmp, ncap, s, start, len, pos + 1)) return -1;
+      }
+    }
+    if (pos >= len) break;
+    RxThreads *sw = clist;
+    clist = nlist;
+    nlist = sw;
+    nlist->n = nlist->thr_n = 0;
+  }
+  return matched;
+}
+
+// ---- Lazy DFA --------------------------------------------------------------
+
+static void rx_dfa_clear(RxDfa *d) {
+  d->len = 0;
+  d->inst_len = 0;
+  d->next_len = 0;
+  d->mem = 0;
+  d->start = -1;
+  for (size_t i = 0; i < d->table_cap; i++) d->table[i] = -1;
+}
+
+static int rx_dfa_init(RxProg *prog) {
+  RxDfa *d = &prog->dfa;
+  if (d->ready) return 1;
+  size_t n = (size_t)prog->len;
+  d->stack = (int *)malloc((2 * n + 2) * sizeof(int));
+  d->sparse = (int *)calloc(n, sizeof(int));
+  d->dense = (int *)calloc(n, sizeof(int));
+  d->out_sparse = (int *)calloc(n, sizeof(int));
+  d->out = (int *)calloc(n, sizeof(int));
+  d->table_cap = 1024;
+  d->table = (int *)malloc(d->table_cap * sizeof(int));
+  if (!d->stack || !d->sparse || !d->dense || !d->out_sparse || !d->out || !d->table) return 0;
+  rx_dfa_clear(d);
+  d->ready = 1;
+  return 1;
+}
+
+static uint32_t rx_dfa_hash(int flags, const int *pcs, int n) {
+  uint32_t h = 2166136261u ^ (uint32_t)flags;
+  for (int i = 0; i < n; i++) {
+    h ^= (uint32_t)pcs[i];
+    h *= 16777619u;
+  }
+  return h;
+}
+
+static int rx_int_cmp(const void *a, const void *b) {
+  int x = *(const int *)a;
+  int y = *(const int *)b;
+  return x < y ? -1 : (x > y ? 1 : 0);
+}
+
+static int rx_dfa_grow_table(RxDfa *d) {
+  size_t ncap = d->table_cap * 2;
+  int *nt = (int *)malloc(ncap * sizeof(int));
+  if (!nt) return 0;
+  for (size_t i = 0; i < ncap; i++) nt[i] = -1;
+  for (size_t s = 0; s < d->len; s++) {
+    size_t slot = d->states[s].hash & (ncap - 1);
+    while (nt[slot] >= 0) slot = (slot + 1) & (ncap - 1);
+    nt[slot] = (int)s;
+  }
+  free(d->table);
+  d->table = nt;
+  d->table_cap = ncap;
+  return 1;
+}
+
+// Finds or adds the state for a sorted pc set. Returns its index,
+// RX_DFA_FULL over the memory budget, or RX_DFA_OOM.
+static int rx_dfa_state(RxProg *prog, int flags, const int *pcs, int n) {
+  RxDfa *d = &prog->dfa;
+  uint32_t h = rx_dfa_hash(flags, pcs, n);
+  size_t slot = h & (d->table_cap - 1);
+  while (d->table[slot] >= 0) {
+    const RxDState *st = &d->states[d->table[slot]];
+    if (st->hash == h && st->flags == flags && st->n == n && memcmp(d->insts + st->inst_off, pcs, (size_t)n * sizeof(int)) == 0) {
+      return d->table[slot];
+    }
+    slot = (slot + 1) & (d->table_cap - 1);
+  }
+  size_t width = (size_t)prog->nclasses + 1;
+  size_t cost = sizeof(RxDState) + (size_t)n * sizeof(int) + width * sizeof(int32_t) + 2 * sizeof(int);
+  if (d->mem + cost > RX_DFA_MAX_MEM) return RX_DFA_FULL;
+  if (d->len == d->cap) {
+    size_t ncap = d->cap ? d->cap * 2 : 16;
+    RxDState *ns = (RxDState *)realloc(d->states, ncap * sizeof(RxDState));
+    if (!ns) return RX_DFA_OOM;
+    d->states = ns;
+    d->cap = ncap;
+  }
+  if (d->inst_len + (size_t)n > d->inst_cap) {
+    size_t ncap = d->inst_cap ? d->inst_cap : 256;
+    while (ncap < d->inst_len + (size_t)n) ncap *= 2;
+    int *ni = (int *)realloc(d->insts, ncap * sizeof(int));
+    if (!ni) return RX_DFA_OOM;
+    d->insts = ni;
+    d->inst_cap = ncap;
+  }
+  if (d->next_len + width > d->next_cap) {
+    size_t ncap = d->next_cap ? d->next_cap : 1024;
+    while (ncap < d->next_len + width) ncap *= 2;
+    int32_t *nn = (int32_t *)realloc(d->next, ncap * sizeof(int32_t));
+    if (!nn) return RX_DFA_OOM;
+    d->next = nn;
+    d->next_cap = ncap;
+  }
+  if ((d->len + 1) * 2 > d->table_cap && !rx_dfa_grow_table(d)) return RX_DFA_OOM;
+  RxDState *st = &d->states[d->len];
+  st->hash = h;
+  st->flags = flags;
+  st->n = n;
+  st->inst_off = d->inst_len;
+  st->next_off = d->next_len;
+  memcpy(d->insts + d->inst_len, pcs, (size_t)n * sizeof(int));
+  d->inst_len += (size_t)n;
+  for (size_t k = 0; k < width; k++) d->next[d->next_len + k] = RX_DFA_UNKNOWN;
+  d->next_len += width;
+  d->mem += cost;
+  slot = h & (d->table_cap - 1);
+  while (d->table[slot] >= 0) slot = (slot + 1) & (d->table_cap - 1);
+  d->table[slot] = (int)d->len;
+  return (int)d->len++;
+}
+
+// Steps state `si` over byte `b` (-1 for the end of text): the empty closure
+// of its pending pcs is taken with `b` as lookahead, then the pcs that
+// accept `b` advance. Reaching MATCH ends the search with a match.
+static int rx_dfa_step(RxProg *prog, int si, int b) {
+  RxDfa *d = &prog->dfa;
+  const RxDState *st = &d->states[si];
+  int flags = st->flags;
+  int prev = (flags & RX_DF_START) ? -1 : ((flags & RX_DF_NL) ? '\n' : ((flags & RX_DF_WORD) ? 'a' : 0));
+  int n = 0;
+  int out_n = 0;
+  int sp = 0;
+  for (int k = st->n - 1; k >= 0; k--) d->stack[sp++] = d->insts[st->inst_off + (size_t)k];
+  if (!prog->anchored && !(flags & RX_DF_START)) d->stack[sp++] = 0;
+  while (sp > 0) {
+    int pc = d->stack[--sp];
+    for (;;) {
+      int k = d->sparse[pc];
+      if (k < n && d->dense[k] == pc) break;
+      d->sparse[pc] = n;
+      d->dense[n++] = pc;
+      const RxInst *in = &prog->insts[pc];
+      if (in->op == RX_OP_MATCH) return RX_DFA_MATCH;
+      if (in->op == RX_OP_JMP) {
+        pc = in->x;
+      } else if (in->op == RX_OP_SPLIT) {
+        d->stack[sp++] = in->y;
+        pc = in->x;
+      } else if (in->op == RX_OP_SAVE) {
+        pc += 1;
+      } else if (in->op == RX_OP_ASSERT) {
+        if (!rx_assert_ok(in->x, prev, b)) break;
+        pc += 1;
+      } else {
+        if (in->op != RX_OP_FAIL && b >= 0 && rx_byte_ok(prog, in, (uint8_t)b)) {
+          int t = pc + 1;
+          int j = d->out_sparse[t];
+          if (!(j < out_n && d->out[j] == t)) {
+            d->out_sparse[t] = out_n;
+            d->out[out_n++] = t;
+          }
+        }
+        break;
+      }
+    }
+  }
+  if (b < 0 || (out_n == 0 && prog->anchored)) return RX_DFA_DEAD;
+  qsort(d->out, (size_t)out_n, sizeof(int), rx_int_cmp);
+  int nflags = b == '\n' ? RX_DF_NL : (rx_is_word_byte(b) ? RX_DF_WORD : 0);
+  return rx_dfa_state(prog, nflags, d->out, out_n);
+}
+
+// State with nothing pending after byte `b`, where an unanchored search
+// resumes after skipping ahead.
+static int rx_dfa_restart(RxProg *prog, int b) {
+  int none = 0;
+  int flags = b == '\n' ? RX_DF_NL : (rx_is_word_byte(b) ? RX_DF_WORD : 0);
+  return rx_dfa_state(prog, flags, &none, 0);
+}
+
+// Answers whether a match starts at or after `start`: 1 or 0, or -1 when the
+// cache keeps overflowing and the caller should fall back to the VM.
+static int rx_dfa_search(RxProg *prog, const uint8_t *s, size_t len, size_t start) {
+  if (!rx_dfa_init(prog)) return -1;
+  RxDfa *d = &prog->dfa;
+  int flushes = 0;
+  if (d->start < 0) {
+    int zero = 0;
+    int si = rx_dfa_state(prog, RX_DF_START, &zero, 1);
+    if (si == RX_DFA_FULL) {
+      rx_dfa_clear(d);
+      si = rx_dfa_state(prog, RX_DF_START, &zero, 1);
+    }
+    if (si < 0) return -1;
+    d->start = si;
+  }
+  int cur = d->start;
+  int skip = rx_can_skip(prog);
+  for (size_t pos = start;; pos++) {
+    if (skip && (pos == start || d->states[cur].n == 0)) {
+      size_t next = rx_next_candidate(prog, s, len, pos);
+      if (next == RX_UNSET) return 0;
+      if (next > pos) {
+        pos = next;
+        cur = rx_dfa_restart(prog, s[pos - 1]);
+        if (cur < 0) return -1;
+      }
+    }
+    int b = pos < len ? s[pos] : -1;
+    size_t slot = d->states[cur].next_off + (b < 0 ? (size_t)prog->nclasses : prog->byte_class[b]);
+    int nx = d->next[slot];
+    if (nx == RX_DFA_UNKNOWN) {
+      nx = rx_dfa_step(prog, cur, b);
+      while (nx == RX_DFA_FULL) {
+        if (++flushes > RX_DFA_MAX_FLUSH) return -1;
+        // Keep the current state, drop everything else.
+        const RxDState *st = &d->states[cur];
+        int flags = st->flags;
+        int n = st->n;
+        int *keep = (int *)malloc(((size_t)n + 1) * sizeof(int));
+        if (!keep) return -1;
+        memcpy(keep, d->insts + st->inst_off, (size_t)n * sizeof(int));
+        rx_dfa_clear(d);
+        cur = rx_dfa_state(prog, flags, keep, n);
+        free(keep);
+        if (cur < 0) return -1;
+        nx = rx_dfa_step(prog, cur, b);
+      }
+      if (nx == RX_DFA_OOM) return -1;
+      slot = d->states[cur].next_off + (b < 0 ? (size_t)prog->nclasses : prog->byte_class[b]);
+      d->next[slot] = nx;
+    }
+    if (nx == RX_DFA_MATCH) return 1;
+    if (nx == RX_DFA_DEAD) return 0;
+    cur = nx;
+  }
+}
+
+static void rx_prog_free(RxProg *prog) {
+  if (!prog) return;
+  free(prog->insts);
+  free(prog->sets);
+  free(prog->prefix);
+  free(prog->needle);
+  rx_threads_free(&prog->vm.a);
+  rx_threads_free(&prog->vm.b);
+  free(prog->vm.stack);
+  free(prog->vm.tmp);
+  RxDfa *d = &prog->dfa;
+  free(d->states);
+  free(d->insts);
+  free(d->next);
+  free(d->table);
+  free(d->stack);
+  free(d->sparse);
+  free(d->dense);
+  free(d->out_sparse);
+  free(d->out);
+  free(prog);
+}
+
+// ---- Pattern store ---------------------------------------------------------
+
+// Entries kept per context. The least recently used one is freed past this
+// count; a RegExp value whose entry was freed is rebuilt from its `_pattern`
+// and `_flags` fields on next use.
+#define RX_CACHE_MAX 64
+#define RX_GEN_MASK 0x7FFFFFFFu
+
+static void entry_free(RegexEntry *e) {
+  rx_prog_free(e->prog);
+  free(e->caps);
+  free(e->pattern);
+  free(e);
+}
+
+static void store_free(void *data) {
+  RegexStore *st = (RegexStore *)data;
+  if (!st) return;
+  for (size_t i = 0; i < st->len; i++) {
+    if (st->slots[i].entry) entry_free(st->slots[i].entry);
+  }
+  free(st->slots);
+  free(st->index);
+  free(st);
+}
+
+static RegexStore *store_get(PS_Context *ctx) {
+  RegexStore *st = (RegexStore *)ps_ctx_get_module_data(ctx, "RegExp");
+  if (st) return st;
+  st = (RegexStore *)calloc(1, sizeof(RegexStore));
+  if (!st) return NULL;
+  if (ps_ctx_set_module_data(ctx, "RegExp", st, store_free) != PS_OK) {
+    free(st);
+    return NULL;
+  }
+  return st;
+}
+
+static uint32_t store_hash(const char *pattern, size_t len, const char *flags) {
+  uint32_t h = 2166136261u;
+  for (size_t i = 0; i < len; i++) h = (h ^ (uint8_t)pattern[i]) * 16777619u;
+  for (const char *f = flags; *f; f++) h = (h ^ (uint8_t)*f) * 16777619u;
+  return h;
+}
+
+static int64_t store_handle(const RegexEntry *e) {
+  return ((int64_t)e->gen << 32) | (int64_t)(e->slot + 1);
+}
+
+static RegexEntry *store_find(RegexStore *st, int64_t id) {
+  uint64_t slot = (uint64_t)id & 0xFFFFFFFFu;
+  uint32_t gen = (uint32_t)((uint64_t)id >> 32);
+  if (slot == 0 || slot > st->len) return NULL;
+  RegexSlot *s = &st->slots[slot - 1];
+  return s->entry && s->gen == gen ? s->entry : NULL;
+}
+
+static RegexEntry *store_lookup(RegexStore *st, const char *pattern, size_t len, const char *flags, uint32_t h) {
+  if (st->index_cap == 0) return NULL;
+  size_t mask = st->index_cap - 1;
+  for (size_t i = h & mask;; i = (i + 1) & mask) {
+    uint32_t slot = st->index[i];
+    if (slot == 0) return NULL;
+    RegexEntry *e = st->slots[slot - 1].entry;
+    if (e && e->hash == h && e->pattern_len == len && strcmp(e->flags, flags) == 0 && memcmp(e->pattern, pattern, len) == 0) return e;
+  }
+}
+
+static void store_index_put(RegexStore *st, RegexEntry *e) {
+  size_t mask = st->index_cap - 1;
+  size_t i = e->hash & mask;
+  while (st->index[i] != 0) i = (i + 1) & mask;
+  st->index[i] = (uint32_t)(e->slot + 1);
+}
+
+// Rebuilds the index at `cap` slots (after a growth or a removal).
+static int store_index_rebuild(RegexStore *st, size_t cap) {
+  uint32_t *n = (uint32_t *)calloc(cap, sizeof(uint32_t));
+  if (!n) return 0;
+  free(st->index);
+  st->index = n;
+  st->index_cap = cap;
+  for (size_t i = 0; i < st->len; i++) {
+    if (st->slots[i].entry) store_index_put(st, st->slots[i].entry);
+  }
+  return 1;
+}
+
+// New entry for (pattern, flags), without an automaton yet. Takes a free slot
+// when there is one.
+static RegexEntry *store_add(RegexStore *st, const char *pattern, size_t len, const char *flags, uint32_t h) {
+  if ((st->live + 1) * 4 > st->index_cap * 3 && !store_index_rebuild(st, st->index_cap == 0 ? 16 : st->index_cap * 2)) return NULL;
+  if (!st->free_head && st->len == st->cap) {
+    if (st->len >= UINT32_MAX - 1) return NULL;
+    size_t ncap = st->cap == 0 ? 8 : st->cap * 2;
+    RegexSlot *n = (RegexSlot *)realloc(st->slots, sizeof(RegexSlot) * ncap);
+    if (!n) return NULL;
+    st->slots = n;
+    st->cap = ncap;
+  }
+  RegexEntry *e = (RegexEntry *)calloc(1, sizeof(RegexEntry));
+  char *pat = (char *)malloc(len + 1);
+  if (!e || !pat) {
+    free(e);
+    free(pat);
+    return NULL;
+  }
+  memcpy(pat, pattern, len);
+  pat[len] = '\0';
+  e->pattern = pat;
+  e->pattern_len = len;
+  memcpy(e->flags, flags, sizeof(e->flags));
+  e->hash = h;
+  RegexSlot *s = NULL;
+  if (st->free_head) {
+    e->slot = st->free_head - 1;
+    s = &st->slots[e->slot];
+    st->free_head = s->next_free;
+  } else {
+    e->slot = st->len++;
+    s = &st->slots[e->slot];
+    s->gen = 0;
+  }
+  s->entry = e;
+  s->next_free = 0;
+  e->gen = s->gen;
+  st->live += 1;
+  store_index_put(st, e);
+  return e;
+}
+
+static void store_unlink(RegexStore *st, RegexEntry *e) {
+  if (e->lru_prev) e->lru_prev->lru_next = e->lru_next;
+  else st->lru_head = e->lru_next;
+  if (e->lru_next) e->lru_next->lru_prev = e->lru_prev;
+  else st->lru_tail = e->lru_prev;
+  e->lru_prev = e->lru_next = NULL;
+}
+
+static void store_push_front(RegexStore *st, RegexEntry *e) {
+  e->lru_prev = NULL;
+  e->lru_next = st->lru_head;
+  if (st->lru_head) st->lru_head->lru_prev = e;
+  st->lru_head = e;
+  if (!st->lru_tail) st->lru_tail = e;
+}
+
+// Frees `e` and puts its slot on the free list under the next generation.
+static void store_remove(RegexStore *st, RegexEntry *e) {
+  RegexSlot *s = &st->slots[e->slot];
+  store_unlink(st, e);
+  s->entry = NULL;
+  s->gen = (s->gen + 1) & RX_GEN_MASK;
+  s->next_free = st->free_head;
+  st->free_head = e->slot + 1;
+  st->live -= 1;
+  entry_free(e);
+}
+
+// Gives `e` its automaton and frees the least recently used entries past
+// RX_CACHE_MAX (never `e` itself).
+static void store_attach(RegexStore *st, RegexEntry *e, RxProg *prog, size_t *caps) {
+  e->prog = prog;
+  e->caps = caps;
+  store_push_front(st, e);
+  int removed = 0;
+  while (st->live > RX_CACHE_MAX && st->lru_tail && st->lru_tail != e) {
+    store_remove(st, st->lru_tail);
+    removed = 1;
+  }
+  // Linear probing has no cheap deletion: the (small) index is rebuilt. On
+  // failure the old one stays, whose stale slots fail the compare.
+  if (removed) store_index_rebuild(st, st->index_cap);
+}
+
+// Makes `e` the most recently used entry.
+static void store_use(RegexStore *st, RegexEntry *e) {
+  if (st->lru_head != e) {
+    store_unlink(st, e);
+    store_push_front(st, e);
+  }
+}
+
+// Entry for (pattern, flags): the cached one, or a new one compiled now.
+static PS_Status store_intern(PS_Context *ctx, RegexStore *st, const char *pattern, size_t pattern_len, const char *flags, RegexEntry **out) {
+  // The same (pattern, flags) yields the same handle while cached, so
+  // compiling in a loop reuses the automaton instead of building a new one.
+  uint32_t h = store_hash(pattern, pattern_len, flags);
+  RegexEntry *e = store_lookup(st, pattern, pattern_len, flags, h);
+  if (e) {
+    store_use(st, e);
+    *out = e;
+    return PS_OK;
+  }
+  char err[160] = {0};
+  int err_kind = RX_ERR_NONE;
+  RxProg *prog = rx_compile(pattern, pattern_len, flags, err, sizeof(err), &err_kind);
+  if (!prog) {
+    if (err_kind == RX_ERR_SYNTAX) return rx_syntax(ctx, err);
+    if (err_kind == RX_ERR_LIMIT) return rx_limit(ctx, err);
+    return rx_throw(ctx, PS_ERR_OOM, "RegExpLimit", "out of memory");
+  }
+  size_t *caps = (size_t *)malloc((size_t)prog->ncap * sizeof(size_t));
+  e = caps ? store_add(st, pattern, pattern_len, flags, h) : NULL;
+  if (!e) {
+    free(caps);
+    rx_prog_free(prog);
+    return rx_throw(ctx, PS_ERR_OOM, "RegExpLimit", "out of memory");
+  }
+  store_attach(st, e, prog, caps);
+  *out = e;
+  return PS_OK;
+}
+
+// ---- Module API ------------------------------------------------------------
+
+typedef struct {
+  size_t start_b;
+  size_t end_b;
+  size_t start_g;
+  size_t end_g;
+} RxSpan;
+
+static int normalize_flags(PS_Context *ctx, const char *in, size_t len, char out[4]) {
   int has_i = 0, has_m = 0, has_s = 0;
   for (size_t i = 0; i < len; i++) {
     char c = in[i];
@@ -335,125 +2138,17 @@ static int normalize_flags(PS_Context *ctx, const char *in, size_t len, char out
   if (has_m) out[w++] = 'm';
   if (has_s) out[w++] = 's';
   out[w] = '\0';
-  int cflags = REG_EXTENDED;
-  if (has_i) cflags |= REG_ICASE;
-#ifdef REG_NEWLINE
-  if (has_m) cflags |= REG_NEWLINE;
-#endif
-  (void)has_s;
-  *out_cflags = cflags;
   return PS_OK;
 }
 
-static int convert_pattern_to_posix(const char *in, size_t len, char **out, int map[100], int *logical_groups, char *err, size_t err_cap) {
-  size_t cap = len + 16;
-  char *buf = (char *)malloc(cap);
-  if (!buf) return 0;
-  size_t w = 0;
-  int phys = 0;
-  int logical = 0;
-  int in_class = 0;
-  for (size_t i = 0; i < len; i++) {
-    char c = in[i];
-    if (c == '\\') {
-      if (!in_class && i + 1 < len) {
-        const char *mapped = NULL;
-        char next = in[i + 1];
-        if (next == 'd') mapped = "[0-9]";
-        else if (next == 'D') mapped = "[^0-9]";
-        else if (next == 'w') mapped = "[A-Za-z0-9_]";
-        else if (next == 'W') mapped = "[^A-Za-z0-9_]";
-        else if (next == 's') mapped = "[ \t\r\n\f\v]";
-        else if (next == 'S') mapped = "[^ \t\r\n\f\v]";
-        if (mapped) {
-          size_t ml = strlen(mapped);
-          if (w + ml + 1 >= cap) {
-            size_t ncap = cap;
-            while (w + ml + 1 >= ncap) ncap *= 2;
-            char *nb = (char *)realloc(buf, ncap);
-            if (!nb) {
-              free(buf);
-              return 0;
-            }
-            buf = nb;
-            cap = ncap;
-          }
-          memcpy(buf + w, mapped, ml);
-          w += ml;
-          i += 1;
-          continue;
-        }
-      }
-      if (w + 2 >= cap) {
-        size_t ncap = cap * 2;
-        char *nb = (char *)realloc(buf, ncap);
-        if (!nb) {
-          free(buf);
-          return 0;
-        }
-        buf = nb;
-        cap = ncap;
-      }
-      buf[w++] = c;
-      if (i + 1 < len) {
-        buf[w++] = in[i + 1];
-        i += 1;
-      }
-      continue;
-    }
-    if (!in_class && c == '[') in_class = 1;
-    else if (in_class && c == ']') in_class = 0;
-
-    if (!in_class && c == '(' && i + 2 < len && in[i + 1] == '?' && in[i + 2] == ':') {
-      phys += 1;
-      if (w + 1 >= cap) {
-        cap *= 2;
-        char *nb = (char *)realloc(buf, cap);
-        if (!nb) {
-          free(buf);
-          return 0;
-        }
-        buf = nb;
-      }
-      buf[w++] = '(';
-      i += 2;
-      continue;
-    }
-
-    if (!in_class && c == '(') {
-      phys += 1;
-      logical += 1;
-      if (logical >= 100) {
-        snprintf(err, err_cap, "too many capturing groups (max 99)");
-        free(buf);
-        return 0;
-      }
-      map[logical] = phys;
-    }
-
-    if (w + 1 >= cap) {
-      cap *= 2;
-      char *nb = (char *)realloc(buf, cap);
-      if (!nb) {
-        free(buf);
-        return 0;
-      }
-      buf = nb;
-    }
-    buf[w++] = c;
-  }
-  if (w + 1 >= cap) {
-    char *nb = (char *)realloc(buf, w + 1);
-    if (!nb) {
-      free(buf);
-      return 0;
-    }
-    buf = nb;
+static PS_Status obj_set_owned(PS_Context *ctx, PS_Value *obj, const char *key, PS_Value *v) {
+  if (!obj || !v) return PS_ERR;
+  if (ps_object_set_str(ctx, obj, key, strlen(key), v) != PS_OK) {
+    ps_value_release(v);
+    return PS_ERR;
   }
-  buf[w] = '\0';
-  *out = buf;
-  *logical_groups = logical;
-  return 1;
+  ps_value_release(v);
+  return PS_OK;
 }
 
 static PS_Status regex_from_obj(PS_Context *ctx, PS_Value *obj, RegexEntry **out_entry) {
@@ -464,20 +2159,27 @@ static PS_Status regex_from_obj(PS_Context *ctx, PS_Value *obj, RegexEntry **out
   PS_Value *v = ps_object_get_str(ctx, obj, "_rid", 4);
   if (!v || ps_typeof(v) != PS_T_INT) return rx_throw(ctx, PS_ERR_TYPE, "RegExpRange", "invalid RegExp handle");
   int64_t id64 = ps_as_int(v);
-  if (id64 <= 0 || id64 > INT_MAX) return rx_throw(ctx, PS_ERR_TYPE, "RegExpRange", "invalid RegExp handle");
-  RegexEntry *e = store_find((int)id64);
-  if (!e) return rx_throw(ctx, PS_ERR_TYPE, "RegExpRange", "unknown RegExp handle");
-  *out_entry = e;
-  return PS_OK;
-}
-
-static PS_Status obj_set_owned(PS_Context *ctx, PS_Value *obj, const char *key, PS_Value *v) {
-  if (!obj || !v) return PS_ERR;
-  if (ps_object_set_str(ctx, obj, key, strlen(key), v) != PS_OK) {
-    ps_value_release(v);
-    return PS_ERR;
+  if (id64 <= 0) return rx_throw(ctx, PS_ERR_TYPE, "RegExpRange", "invalid RegExp handle");
+  RegexStore *st = (RegexStore *)ps_ctx_get_module_data(ctx, "RegExp");
+  RegexEntry *e = st ? store_find(st, id64) : NULL;
+  if (e) {
+    store_use(st, e);
+    *out_entry = e;
+    return PS_OK;
   }
-  ps_value_release(v);
+  // Stale handle: its entry was freed. The value still carries its pattern
+  // and flags, so the entry is rebuilt and the handle updated.
+  PS_Value *pat = ps_object_get_str(ctx, obj, "_pattern", 8);
+  PS_Value *fl = ps_object_get_str(ctx, obj, "_flags", 6);
+  if (!st || !pat || ps_typeof(pat) != PS_T_STRING || !fl || ps_typeof(fl) != PS_T_STRING) {
+    return rx_throw(ctx, PS_ERR_TYPE, "RegExpRange", "unknown RegExp handle");
+  }
+  char norm_flags[4];
+  if (normalize_flags(ctx, ps_string_ptr(fl), ps_string_len(fl), norm_flags) != PS_OK) return PS_ERR;
+  if (store_intern(ctx, st, ps_string_ptr(pat), ps_string_len(pat), norm_flags, &e) != PS_OK) return PS_ERR;
+  PS_Value *v_id = ps_make_int(ctx, store_handle(e));
+  if (!v_id || obj_set_owned(ctx, obj, "_rid", v_id) != PS_OK) return PS_ERR;
+  *out_entry = e;
   return PS_OK;
 }
 
@@ -517,167 +2219,93 @@ static PS_Status make_empty_match(PS_Context *ctx, PS_Value **out) {
   return st;
 }
 
-static PS_Value *make_utf8_string_slice(PS_Context *ctx, const char *s, size_t a, size_t b) {
-  if (b < a) b = a;
-  return ps_make_string_utf8(ctx, s + a, b - a);
-}
-
-static int resolve_capture_index(const RegexEntry *e, int logical_idx) {
-  if (logical_idx < 0) return -1;
-  if (logical_idx == 0) return 0;
-  if (!e || logical_idx > e->logical_groups || logical_idx >= 100) return -1;
-  return e->logical_to_phys[logical_idx];
-}
-
-static PS_Status run_find(PS_Context *ctx, RegexEntry *e, const char *input, size_t input_len, const GlyphIndex *idx, size_t start_glyph, PS_Value **out_match) {
-  (void)input_len;
-  size_t start_byte = glyph_to_byte_pos(idx, start_glyph);
-  size_t nmatch = (size_t)e->re.re_nsub + 1;
-  regmatch_t *pm = (regmatch_t *)calloc(nmatch, sizeof(regmatch_t));
-  if (!pm) return rx_throw(ctx, PS_ERR_OOM, "RegExpLimit", "out of memory");
-
-  int rc = regexec(&e->re, input + start_byte, nmatch, pm, 0);
-  if (rc == REG_NOMATCH) {
-    free(pm);
-    return make_empty_match(ctx, out_match);
-  }
-  if (rc != 0) {
-    char errbuf[256];
-    regerror(rc, &e->re, errbuf, sizeof(errbuf));
-    free(pm);
-    return rx_throw(ctx, PS_ERR_INTERNAL, "RegExpLimit", errbuf);
-  }
-
-  if (pm[0].rm_so < 0 || pm[0].rm_eo < 0) {
-    free(pm);
-    return make_empty_match(ctx, out_match);
-  }
-
-  size_t m0s = start_byte + (size_t)pm[0].rm_so;
-  size_t m0e = start_byte + (size_t)pm[0].rm_eo;
-  int64_t g0s = (int64_t)byte_to_glyph_pos(idx, m0s);
-  int64_t g0e = (int64_t)byte_to_glyph_pos(idx, m0e);
-
-  PS_Value *groups = ps_make_list(ctx);
-  if (!groups) {
-    free(pm);
-    return PS_ERR;
+// Runs one search from byte `start_b` (glyph `start_g`). The DFA rejects
+// inputs without a match before the VM is asked for positions; captures are
+// left in e->caps (only group 0 unless `groups`). Returns 1 on a match, 0
+// otherwise, -1 after throwing.
+static int rx_search(PS_Context *ctx, RegexEntry *e, const char *input, size_t input_len, size_t start_b, size_t start_g, int groups, RxSpan *span) {
+  const uint8_t *s = (const uint8_t *)input;
+  if (rx_needle_missing(e->prog, s, input_len, start_b)) return 0;
+  int found = rx_dfa_search(e->prog, s, input_len, start_b);
+  if (found != 0) found = rx_vm_search(e->prog, s, input_len, start_b, groups ? e->prog->ncap : 2, e->caps);
+  if (found < 0) {
+    rx_throw(ctx, PS_ERR_OOM, "RegExpLimit", "out of memory");
+    return -1;
   }
+  if (!found) return 0;
+  span->start_b = e->caps[0];
+  span->end_b = e->caps[1];
+  span->start_g = start_g + utf8_glyphs_between(s, start_b, span->start_b);
+  span->end_g = span->start_g + utf8_glyphs_between(s, span->start_b, span->end_b);
+  return 1;
+}
 
-  PS_Value *whole = make_utf8_string_slice(ctx, input, m0s, m0e);
-  if (!whole || ps_list_push(ctx, groups, whole) != PS_OK) {
-    if (whole) ps_value_release(whole);
-    ps_value_release(groups);
-    free(pm);
+// The group strings are not built here: `groups` holds the byte spans of the
+// captures (int64_t start/end pairs, -1 when the group did not participate)
+// and `_input` the input string, and the VM slices the strings on the first
+// groups() call. findAll over many matches then costs no string per group.
+static PS_Status rx_make_match(PS_Context *ctx, RegexEntry *e, PS_Value *input, const RxSpan *span, PS_Value **out) {
+  size_t n = 2 * ((size_t)e->prog->groups + 1);
+  int64_t spans[2 * (RX_MAX_GROUPS + 1)];
+  for (size_t k = 0; k < n; k++) spans[k] = e->caps[k] == RX_UNSET ? -1 : (int64_t)e->caps[k];
+  PS_Value *groups = ps_make_bytes(ctx, (const uint8_t *)spans, n * sizeof(int64_t));
+  if (!groups) return PS_ERR;
+  PS_Status st = make_match_obj(ctx, 1, (int64_t)span->start_g, (int64_t)span->end_g, groups, out);
+  ps_value_release(groups);
+  if (st != PS_OK) return PS_ERR;
+  if (obj_set_owned(ctx, *out, "_input", ps_value_retain(input)) != PS_OK) {
+    ps_value_release(*out);
+    *out = NULL;
     return PS_ERR;
   }
-  ps_value_release(whole);
+  return PS_OK;
+}
 
-  for (int li = 1; li <= e->logical_groups; li++) {
-    int pi = resolve_capture_index(e, li);
-    PS_Value *part = NULL;
-    if (pi >= 0 && (size_t)pi < nmatch && pm[pi].rm_so >= 0 && pm[pi].rm_eo >= 0) {
-      size_t bs = start_byte + (size_t)pm[pi].rm_so;
-      size_t be = start_byte + (size_t)pm[pi].rm_eo;
-      part = make_utf8_string_slice(ctx, input, bs, be);
-    } else {
-      part = ps_make_string_utf8(ctx, "", 0);
-    }
-    if (!part || ps_list_push(ctx, groups, part) != PS_OK) {
-      if (part) ps_value_release(part);
-      ps_value_release(groups);
-      free(pm);
-      return PS_ERR;
-    }
-    ps_value_release(part);
+static PS_Status append_bytes(char **buf, size_t *len, size_t *cap, const char *src, size_t src_len) {
+  if (*len + src_len > *cap) {
+    size_t ncap = *cap;
+    while (*len + src_len > ncap) ncap *= 2;
+    char *nb = (char *)realloc(*buf, ncap);
+    if (!nb) return PS_ERR;
+    *buf = nb;
+    *cap = ncap;
   }
-
-  PS_Status st = make_match_obj(ctx, 1, g0s, g0e, groups, out_match);
-  ps_value_release(groups);
-  free(pm);
-  return st;
+  memcpy(*buf + *len, src, src_len);
+  *len += src_len;
+  return PS_OK;
 }
 
-static PS_Status replacement_expand(PS_Context *ctx, const char *replacement, size_t replacement_len, PS_Value *groups, char **out, size_t *out_len) {
-  size_t cap = replacement_len + 32;
-  char *buf = (char *)malloc(cap);
-  if (!buf) return rx_throw(ctx, PS_ERR_OOM, "RegExpLimit", "out of memory");
-  size_t w = 0;
-  size_t glen = ps_list_len(groups);
-  for (size_t i = 0; i < replacement_len; i++) {
-    char c = replacement[i];
-    if (c != '$') {
-      if (w + 1 > cap) {
-        cap *= 2;
-        char *nb = (char *)realloc(buf, cap);
-        if (!nb) {
-          free(buf);
-          return rx_throw(ctx, PS_ERR_OOM, "RegExpLimit", "out of memory");
-        }
-        buf = nb;
-      }
-      buf[w++] = c;
-      continue;
-    }
-
+// Appends `replacement` with $0..$99 expanded from the current captures.
+static PS_Status replacement_expand(RegexEntry *e, const char *input, const char *replacement, size_t replacement_len, char **buf, size_t *w, size_t *cap) {
+  size_t i = 0;
+  while (i < replacement_len) {
+    const char *dollar = (const char *)memchr(replacement + i, '$', replacement_len - i);
+    size_t lit_end = dollar ? (size_t)(dollar - replacement) : replacement_len;
+    if (append_bytes(buf, w, cap, replacement + i, lit_end - i) != PS_OK) return PS_ERR;
+    i = lit_end;
+    if (i >= replacement_len) break;
     if (i + 1 < replacement_len && replacement[i + 1] == '$') {
-      if (w + 1 > cap) {
-        cap *= 2;
-        char *nb = (char *)realloc(buf, cap);
-        if (!nb) {
-          free(buf);
-          return rx_throw(ctx, PS_ERR_OOM, "RegExpLimit", "out of memory");
-        }
-        buf = nb;
-      }
-      buf[w++] = '$';
-      i += 1;
+      if (append_bytes(buf, w, cap, "$", 1) != PS_OK) return PS_ERR;
+      i += 2;
       continue;
     }
-
     if (i + 1 >= replacement_len || !isdigit((unsigned char)replacement[i + 1])) {
-      if (w + 1 > cap) {
-        cap *= 2;
-        char *nb = (char *)realloc(buf, cap);
-        if (!nb) {
-          free(buf);
-          return rx_throw(ctx, PS_ERR_OOM, "RegExpLimit", "out of memory");
-        }
-        buf = nb;
-      }
-      buf[w++] = '$';
+      if (append_bytes(buf, w, cap, "$", 1) != PS_OK) return PS_ERR;
+      i += 1;
       continue;
     }
-
     int idx = replacement[i + 1] - '0';
-    i += 1;
-    if (i + 1 < replacement_len && isdigit((unsigned char)replacement[i + 1])) {
-      idx = idx * 10 + (replacement[i + 1] - '0');
+    i += 2;
+    if (i < replacement_len && isdigit((unsigned char)replacement[i])) {
+      idx = idx * 10 + (replacement[i] - '0');
       i += 1;
     }
-
-    if (idx < 0 || (size_t)idx >= glen) continue;
-    PS_Value *gv = ps_list_get(ctx, groups, (size_t)idx);
-    if (!gv || ps_typeof(gv) != PS_T_STRING) continue;
-    const char *gs = ps_string_ptr(gv);
-    size_t gs_len = ps_string_len(gv);
-    if (w + gs_len > cap) {
-      size_t ncap = cap;
-      while (w + gs_len > ncap) ncap *= 2;
-      char *nb = (char *)realloc(buf, ncap);
-      if (!nb) {
-        free(buf);
-        return rx_throw(ctx, PS_ERR_OOM, "RegExpLimit", "out of memory");
-      }
-      buf = nb;
-      cap = ncap;
-    }
-    memcpy(buf + w, gs, gs_len);
-    w += gs_len;
+    if (idx > e->prog->groups) continue;
+    size_t a = e->caps[2 * idx];
+    size_t b = e->caps[2 * idx + 1];
+    if (a == RX_UNSET || b == RX_UNSET || b < a) continue;
+    if (append_bytes(buf, w, cap, input + a, b - a) != PS_OK) return PS_ERR;
   }
-
-  *out = buf;
-  *out_len = w;
   return PS_OK;
 }
 
@@ -690,43 +2318,14 @@ static PS_Status mod_compile(PS_Context *ctx, int argc, PS_Value **argv, PS_Valu
 
   if (!utf8_validate(pattern, pattern_len, NULL)) return rx_syntax(ctx, "pattern must be valid UTF-8");
   if (!utf8_validate(flags, flags_len, NULL)) return rx_syntax(ctx, "flags must be valid UTF-8");
-  if (has_forbidden_meta(pattern, pattern_len)) return rx_syntax(ctx, "forbidden metasyntax (backreference/lookaround)");
-
-  char synerr[160];
-  if (!validate_basic_syntax(pattern, pattern_len, synerr, sizeof(synerr))) return rx_syntax(ctx, synerr);
-
-  RegexEntry *e = store_add();
-  if (!e) return rx_throw(ctx, PS_ERR_OOM, "RegExpLimit", "out of memory");
-
-  int cflags = 0;
-  if (normalize_flags(ctx, flags, flags_len, e->flags, &cflags) != PS_OK) {
-    e->valid = 0;
-    return PS_ERR;
-  }
-  e->cflags = cflags;
-
-  char conv_err[160] = {0};
-  if (!convert_pattern_to_posix(pattern, pattern_len, &e->pattern_posix, e->logical_to_phys, &e->logical_groups, conv_err, sizeof(conv_err))) {
-    e->valid = 0;
-    if (conv_err[0]) return rx_limit(ctx, conv_err);
-    return rx_throw(ctx, PS_ERR_OOM, "RegExpLimit", "out of memory");
-  }
 
-  e->pattern = (char *)malloc(pattern_len + 1);
-  if (!e->pattern) {
-    e->valid = 0;
-    return rx_throw(ctx, PS_ERR_OOM, "RegExpLimit", "out of memory");
-  }
-  memcpy(e->pattern, pattern, pattern_len);
-  e->pattern[pattern_len] = '\0';
+  char norm_flags[4];
+  if (normalize_flags(ctx, flags, flags_len, norm_flags) != PS_OK) return PS_ERR;
 
-  int rc = regcomp(&e->re, e->pattern_posix, cflags);
-  if (rc != 0) {
-    char errbuf[256];
-    regerror(rc, &e->re, errbuf, sizeof(errbuf));
-    e->valid = 0;
-    return rx_syntax(ctx, errbuf);
-  }
+  RegexStore *st = store_get(ctx);
+  if (!st) return rx_throw(ctx, PS_ERR_OOM, "RegExpLimit", "out of memory");
+  RegexEntry *e = NULL;
+  if (store_intern(ctx, st, pattern, pattern_len, norm_flags, &e) != PS_OK) return PS_ERR;
 
   PS_Value *obj = ps_make_object(ctx);
   if (!obj) return PS_ERR;
@@ -735,8 +2334,8 @@ static PS_Status mod_compile(PS_Context *ctx, int argc, PS_Value **argv, PS_Valu
     return PS_ERR;
   }
 
-  PS_Value *v_id = ps_make_int(ctx, e->id);
-  PS_Value *v_pat = ps_make_string_utf8(ctx, e->pattern, strlen(e->pattern));
+  PS_Value *v_id = ps_make_int(ctx, store_handle(e));
+  PS_Value *v_pat = ps_make_string_utf8(ctx, e->pattern, pattern_len);
   PS_Value *v_flags = ps_make_string_utf8(ctx, e->flags, strlen(e->flags));
   if (!v_id || !v_pat || !v_flags) {
     if (v_id) ps_value_release(v_id);
@@ -756,6 +2355,16 @@ static PS_Status mod_compile(PS_Context *ctx, int argc, PS_Value **argv, PS_Valu
   return PS_OK;
 }
 
+// Validates the input and turns the glyph `start` into a byte offset.
+static PS_Status rx_prepare_input(PS_Context *ctx, const char *input, size_t input_len, int64_t start, size_t *out_glyphs, size_t *out_start_b) {
+  size_t glyphs = 0;
+  if (!utf8_validate(input, input_len, &glyphs)) return rx_throw(ctx, PS_ERR_UTF8, "RegExpSyntax", "input must be valid UTF-8");
+  if (start < 0 || (uint64_t)start > glyphs) return rx_range(ctx, "start out of range");
+  *out_glyphs = glyphs;
+  *out_start_b = utf8_skip_glyphs((const uint8_t *)input, input_len, 0, (size_t)start);
+  return PS_OK;
+}
+
 static PS_Status mod_test(PS_Context *ctx, int argc, PS_Value **argv, PS_Value **out) {
   (void)argc;
   RegexEntry *e = NULL;
@@ -768,21 +2377,14 @@ static PS_Status mod_test(PS_Context *ctx, int argc, PS_Value **argv, PS_Value *
   int64_t start = 0;
   if (get_int_arg(ctx, argv[2], &start) != PS_OK) return PS_ERR;
 
-  GlyphIndex idx;
-  if (!glyph_index_build(input, input_len, &idx)) return rx_throw(ctx, PS_ERR_UTF8, "RegExpSyntax", "input must be valid UTF-8");
-  if (start < 0 || (size_t)start > idx.glyph_count) {
-    glyph_index_free(&idx);
-    return rx_range(ctx, "start out of range");
-  }
+  size_t glyphs = 0, start_b = 0;
+  if (rx_prepare_input(ctx, input, input_len, start, &glyphs, &start_b) != PS_OK) return PS_ERR;
 
-  PS_Value *m = NULL;
-  PS_Status st = run_find(ctx, e, input, input_len, &idx, (size_t)start, &m);
-  glyph_index_free(&idx);
-  if (st != PS_OK) return PS_ERR;
-  PS_Value *ok = ps_object_get_str(ctx, m, "ok", 2);
-  int b = (ok && ps_typeof(ok) == PS_T_BOOL) ? ps_as_bool(ok) : 0;
-  ps_value_release(m);
-  *out = ps_make_bool(ctx, b);
+  int found = 0;
+  if (!rx_needle_missing(e->prog, (const uint8_t *)input, input_len, start_b)) found = rx_dfa_search(e->prog, (const uint8_t *)input, input_len, start_b);
+  if (found < 0) found = rx_vm_search(e->prog, (const uint8_t *)input, input_len, start_b, 2, e->caps);
+  if (found < 0) return rx_throw(ctx, PS_ERR_OOM, "RegExpLimit", "out of memory");
+  *out = ps_make_bool(ctx, found);
   return *out ? PS_OK : PS_ERR;
 }
 
@@ -798,30 +2400,14 @@ static PS_Status mod_find(PS_Context *ctx, int argc, PS_Value **argv, PS_Value *
   int64_t start = 0;
   if (get_int_arg(ctx, argv[2], &start) != PS_OK) return PS_ERR;
 
-  GlyphIndex idx;
-  if (!glyph_index_build(input, input_len, &idx)) return rx_throw(ctx, PS_ERR_UTF8, "RegExpSyntax", "input must be valid UTF-8");
-  if (start < 0 || (size_t)start > idx.glyph_count) {
-    glyph_index_free(&idx);
-    return rx_range(ctx, "start out of range");
-  }
-
-  PS_Status st = run_find(ctx, e, input, input_len, &idx, (size_t)start, out);
-  glyph_index_free(&idx);
-  return st;
-}
+  size_t glyphs = 0, start_b = 0;
+  if (rx_prepare_input(ctx, input, input_len, start, &glyphs, &start_b) != PS_OK) return PS_ERR;
 
-static PS_Status get_match_span(PS_Context *ctx, PS_Value *m, int64_t *out_start, int64_t *out_end, int *out_ok, PS_Value **out_groups) {
-  PS_Value *ok = ps_object_get_str(ctx, m, "ok", 2);
-  PS_Value *st = ps_object_get_str(ctx, m, "start", 5);
-  PS_Value *en = ps_object_get_str(ctx, m, "end", 3);
-  PS_Value *gr = ps_object_get_str(ctx, m, "groups", 6);
-  if (!ok || !st || !en || !gr) return PS_ERR;
-  if (ps_typeof(ok) != PS_T_BOOL || ps_typeof(st) != PS_T_INT || ps_typeof(en) != PS_T_INT || ps_typeof(gr) != PS_T_LIST) return PS_ERR;
-  *out_ok = ps_as_bool(ok) ? 1 : 0;
-  *out_start = ps_as_int(st);
-  *out_end = ps_as_int(en);
-  *out_groups = gr;
-  return PS_OK;
+  RxSpan span;
+  int found = rx_search(ctx, e, input, input_len, start_b, (size_t)start, 1, &span);
+  if (found < 0) return PS_ERR;
+  if (!found) return make_empty_match(ctx, out);
+  return rx_make_match(ctx, e, argv[1], &span, out);
 }
 
 static PS_Status mod_find_all(PS_Context *ctx, int argc, PS_Value **argv, PS_Value **out) {
@@ -838,195 +2424,175 @@ static PS_Status mod_find_all(PS_Context *ctx, int argc, PS_Value **argv, PS_Val
   if (get_int_arg(ctx, argv[2], &start) != PS_OK) return PS_ERR;
   if (get_int_arg(ctx, argv[3], &max) != PS_OK) return PS_ERR;
 
-  GlyphIndex idx;
-  if (!glyph_index_build(input, input_len, &idx)) return rx_throw(ctx, PS_ERR_UTF8, "RegExpSyntax", "input must be valid UTF-8");
-  if (start < 0 || (size_t)start > idx.glyph_count) {
-    glyph_index_free(&idx);
-    return rx_range(ctx, "start out of range");
-  }
-  if (max < -1) {
-    glyph_index_free(&idx);
-    return rx_range(ctx, "max out of range");
-  }
+  size_t glyphs = 0, cur_b = 0;
+  if (rx_prepare_input(ctx, input, input_len, start, &glyphs, &cur_b) != PS_OK) return PS_ERR;
+  if (max < -1) return rx_range(ctx, "max out of range");
 
   PS_Value *list = ps_make_list(ctx);
-  if (!list) {
-    glyph_index_free(&idx);
-    return PS_ERR;
-  }
+  if (!list) return PS_ERR;
   if (max == 0) {
-    glyph_index_free(&idx);
     *out = list;
     return PS_OK;
   }
 
   size_t cur = (size_t)start;
   int64_t produced = 0;
-  while (cur <= idx.glyph_count) {
-    PS_Value *m = NULL;
-    if (run_find(ctx, e, input, input_len, &idx, cur, &m) != PS_OK) {
+  while (cur <= glyphs) {
+    RxSpan span;
+    int found = rx_search(ctx, e, input, input_len, cur_b, cur, 1, &span);
+    if (found < 0) {
       ps_value_release(list);
-      glyph_index_free(&idx);
       return PS_ERR;
     }
-    int ok = 0;
-    int64_t ms = 0, me = 0;
-    PS_Value *groups = NULL;
-    if (get_match_span(ctx, m, &ms, &me, &ok, &groups) != PS_OK) {
-      ps_value_release(m);
+    if (!found) break;
+    PS_Value *m = NULL;
+    if (rx_make_match(ctx, e, argv[1], &span, &m) != PS_OK) {
       ps_value_release(list);
-      glyph_index_free(&idx);
       return PS_ERR;
     }
-    if (!ok) {
-      ps_value_release(m);
-      break;
-    }
     if (ps_list_push(ctx, list, m) != PS_OK) {
       ps_value_release(m);
       ps_value_release(list);
-      glyph_index_free(&idx);
       return PS_ERR;
     }
     ps_value_release(m);
     produced += 1;
     if (max > 0 && produced >= max) break;
-    if (me <= ms) {
-      if ((size_t)me >= idx.glyph_count) break;
-      cur = (size_t)me + 1;
+    if (span.end_g <= span.start_g) {
+      if (span.end_g >= glyphs) break;
+      cur = span.end_g + 1;
+      cur_b = utf8_skip_glyphs((const uint8_t *)input, input_len, span.end_b, 1);
     } else {
-      cur = (size_t)me;
+      cur = span.end_g;
+      cur_b = span.end_b;
     }
   }
 
-  glyph_index_free(&idx);
   *out = list;
   return PS_OK;
 }
 
-static PS_Status append_bytes(char **buf, size_t *len, size_t *cap, const char *src, size_t src_len) {
-  if (*len + src_len > *cap) {
-    size_t ncap = *cap;
-    while (*len + src_len > ncap) ncap *= 2;
-    char *nb = (char *)realloc(*buf, ncap);
-    if (!nb) return PS_ERR;
-    *buf = nb;
-    *cap = ncap;
+// findAll without match objects: a flat list of glyph start/end pairs.
+static PS_Status mod_find_all_spans(PS_Context *ctx, int argc, PS_Value **argv, PS_Value **out) {
+  (void)argc;
+  RegexEntry *e = NULL;
+  if (regex_from_obj(ctx, argv[0], &e) != PS_OK) return PS_ERR;
+
+  const char *input = NULL;
+  size_t input_len = 0;
+  if (get_string_arg(ctx, argv[1], &input, &input_len) != PS_OK) return PS_ERR;
+
+  int64_t start = 0;
+  int64_t max = 0;
+  if (get_int_arg(ctx, argv[2], &start) != PS_OK) return PS_ERR;
+  if (get_int_arg(ctx, argv[3], &max) != PS_OK) return PS_ERR;
+
+  size_t glyphs = 0, cur_b = 0;
+  if (rx_prepare_input(ctx, input, input_len, start, &glyphs, &cur_b) != PS_OK) return PS_ERR;
+  if (max < -1) return rx_range(ctx, "max out of range");
+
+  PS_Value *list = ps_make_list(ctx);
+  if (!list) return PS_ERR;
+  if (max == 0) {
+    *out = list;
+    return PS_OK;
   }
-  memcpy(*buf + *len, src, src_len);
-  *len += src_len;
+
+  size_t cur = (size_t)start;
+  int64_t produced = 0;
+  while (cur <= glyphs) {
+    RxSpan span;
+    int found = rx_search(ctx, e, input, input_len, cur_b, cur, 0, &span);
+    if (found < 0) {
+      ps_value_release(list);
+      return PS_ERR;
+    }
+    if (!found) break;
+    PS_Value *a = ps_make_int(ctx, (int64_t)span.start_g);
+    PS_Value *b = a ? ps_make_int(ctx, (int64_t)span.end_g) : NULL;
+    if (!b || ps_list_push(ctx, list, a) != PS_OK || ps_list_push(ctx, list, b) != PS_OK) {
+      if (a) ps_value_release(a);
+      if (b) ps_value_release(b);
+      ps_value_release(list);
+      return PS_ERR;
+    }
+    ps_value_release(a);
+    ps_value_release(b);
+    produced += 1;
+    if (max > 0 && produced >= max) break;
+    if (span.end_g <= span.start_g) {
+      if (span.end_g >= glyphs) break;
+      cur = span.end_g + 1;
+      cur_b = utf8_skip_glyphs((const uint8_t *)input, input_len, span.end_b, 1);
+    } else {
+      cur = span.end_g;
+      cur_b = span.end_b;
+    }
+  }
+
+  *out = list;
   return PS_OK;
 }
 
-static PS_Status replace_impl(PS_Context *ctx, RegexEntry *e, const char *input, size_t input_len, size_t start_glyph, const char *replacement, size_t replacement_len, int64_t max, int replace_all, PS_Value **out) {
-  GlyphIndex idx;
-  if (!glyph_index_build(input, input_len, &idx)) return rx_throw(ctx, PS_ERR_UTF8, "RegExpSyntax", "input must be valid UTF-8");
-
+static PS_Status replace_impl(PS_Context *ctx, RegexEntry *e, const char *input, size_t input_len, size_t glyphs, size_t start_glyph, size_t start_b, const char *replacement, size_t replacement_len, int64_t max, int replace_all, PS_Value **out) {
   size_t cap = input_len + replacement_len + 32;
   char *buf = (char *)malloc(cap);
-  if (!buf) {
-    glyph_index_free(&idx);
-    return rx_throw(ctx, PS_ERR_OOM, "RegExpLimit", "out of memory");
-  }
+  if (!buf) return rx_throw(ctx, PS_ERR_OOM, "RegExpLimit", "out of memory");
   size_t w = 0;
 
   size_t cursor_g = start_glyph;
-  size_t cursor_b = glyph_to_byte_pos(&idx, start_glyph);
+  size_t cursor_b = start_b;
   if (append_bytes(&buf, &w, &cap, input, cursor_b) != PS_OK) {
     free(buf);
-    glyph_index_free(&idx);
     return rx_throw(ctx, PS_ERR_OOM, "RegExpLimit", "out of memory");
   }
 
+  // Without `$`, the replacement is copied as is and only the bounds of each
+  // match are needed: the VM then tracks no group.
+  int constant = memchr(replacement, '$', replacement_len) == NULL;
   int64_t done = 0;
-  while (cursor_g <= idx.glyph_count) {
-    PS_Value *m = NULL;
-    if (run_find(ctx, e, input, input_len, &idx, cursor_g, &m) != PS_OK) {
-      free(buf);
-      glyph_index_free(&idx);
-      return PS_ERR;
-    }
-
-    int ok = 0;
-    int64_t ms = 0, me = 0;
-    PS_Value *groups = NULL;
-    if (get_match_span(ctx, m, &ms, &me, &ok, &groups) != PS_OK) {
-      ps_value_release(m);
+  while (cursor_g <= glyphs) {
+    RxSpan span;
+    int found = rx_search(ctx, e, input, input_len, cursor_b, cursor_g, !constant, &span);
+    if (found < 0) {
       free(buf);
-      glyph_index_free(&idx);
       return PS_ERR;
     }
-    if (!ok) {
-      ps_value_release(m);
-      break;
-    }
-
-    size_t mbs = glyph_to_byte_pos(&idx, (size_t)ms);
-    size_t mbe = glyph_to_byte_pos(&idx, (size_t)me);
-    if (mbs < cursor_b) mbs = cursor_b;
-
-    if (append_bytes(&buf, &w, &cap, input + cursor_b, mbs - cursor_b) != PS_OK) {
-      ps_value_release(m);
-      free(buf);
-      glyph_index_free(&idx);
-      return rx_throw(ctx, PS_ERR_OOM, "RegExpLimit", "out of memory");
-    }
+    if (!found) break;
 
-    char *exp = NULL;
-    size_t exp_len = 0;
-    if (replacement_expand(ctx, replacement, replacement_len, groups, &exp, &exp_len) != PS_OK) {
-      ps_value_release(m);
+    if (append_bytes(&buf, &w, &cap, input + cursor_b, span.start_b - cursor_b) != PS_OK ||
+        (constant ? append_bytes(&buf, &w, &cap, replacement, replacement_len)
+                  : replacement_expand(e, input, replacement, replacement_len, &buf, &w, &cap)) != PS_OK) {
       free(buf);
-      glyph_index_free(&idx);
-      return PS_ERR;
-    }
-    PS_Status ap = append_bytes(&buf, &w, &cap, exp, exp_len);
-    free(exp);
-    if (ap != PS_OK) {
-      ps_value_release(m);
-      free(buf);
-      glyph_index_free(&idx);
       return rx_throw(ctx, PS_ERR_OOM, "RegExpLimit", "out of memory");
     }
 
     done += 1;
-    cursor_b = mbe;
-    if (!replace_all || (max > 0 && done >= max)) {
-      ps_value_release(m);
-      break;
-    }
-    if (me <= ms) {
-      if ((size_t)me >= idx.glyph_count) {
-        ps_value_release(m);
-        break;
-      }
-      size_t next_g = (size_t)me + 1;
-      size_t next_b = glyph_to_byte_pos(&idx, next_g);
+    cursor_b = span.end_b;
+    if (!replace_all || (max > 0 && done >= max)) break;
+    if (span.end_g <= span.start_g) {
+      if (span.end_g >= glyphs) break;
+      size_t next_b = utf8_skip_glyphs((const uint8_t *)input, input_len, cursor_b, 1);
       if (append_bytes(&buf, &w, &cap, input + cursor_b, next_b - cursor_b) != PS_OK) {
-        ps_value_release(m);
         free(buf);
-        glyph_index_free(&idx);
         return rx_throw(ctx, PS_ERR_OOM, "RegExpLimit", "out of memory");
       }
-      cursor_g = next_g;
+      cursor_g = span.end_g + 1;
       cursor_b = next_b;
     } else {
-      cursor_g = (size_t)me;
+      cursor_g = span.end_g;
     }
-    ps_value_release(m);
   }
 
   if (cursor_b < input_len) {
     if (append_bytes(&buf, &w, &cap, input + cursor_b, input_len - cursor_b) != PS_OK) {
       free(buf);
-      glyph_index_free(&idx);
       return rx_throw(ctx, PS_ERR_OOM, "RegExpLimit", "out of memory");
     }
   }
 
   PS_Value *res = ps_make_string_utf8(ctx, buf, w);
   free(buf);
-  glyph_index_free(&idx);
   if (!res) return PS_ERR;
   *out = res;
   return PS_OK;
@@ -1043,11 +2609,10 @@ static PS_Status mod_replace_first(PS_Context *ctx, int argc, PS_Value **argv, P
   if (get_string_arg(ctx, argv[2], &replacement, &replacement_len) != PS_OK) return PS_ERR;
   if (get_int_arg(ctx, argv[3], &start) != PS_OK) return PS_ERR;
 
-  size_t glyphs = 0;
-  if (!utf8_validate(input, input_len, &glyphs)) return rx_throw(ctx, PS_ERR_UTF8, "RegExpSyntax", "input must be valid UTF-8");
-  if (start < 0 || (size_t)start > glyphs) return rx_range(ctx, "start out of range");
+  size_t glyphs = 0, start_b = 0;
+  if (rx_prepare_input(ctx, input, input_len, start, &glyphs, &start_b) != PS_OK) return PS_ERR;
 
-  return replace_impl(ctx, e, input, input_len, (size_t)start, replacement, replacement_len, 1, 0, out);
+  return replace_impl(ctx, e, input, input_len, glyphs, (size_t)start, start_b, replacement, replacement_len, 1, 0, out);
 }
 
 static PS_Status mod_replace_all(PS_Context *ctx, int argc, PS_Value **argv, PS_Value **out) {
@@ -1062,15 +2627,14 @@ static PS_Status mod_replace_all(PS_Context *ctx, int argc, PS_Value **argv, PS_
   if (get_int_arg(ctx, argv[3], &start) != PS_OK) return PS_ERR;
   if (get_int_arg(ctx, argv[4], &max) != PS_OK) return PS_ERR;
 
-  size_t glyphs = 0;
-  if (!utf8_validate(input, input_len, &glyphs)) return rx_throw(ctx, PS_ERR_UTF8, "RegExpSyntax", "input must be valid UTF-8");
-  if (start < 0 || (size_t)start > glyphs) return rx_range(ctx, "start out of range");
+  size_t glyphs = 0, start_b = 0;
+  if (rx_prepare_input(ctx, input, input_len, start, &glyphs, &start_b) != PS_OK) return PS_ERR;
   if (max < -1) return rx_range(ctx, "max out of range");
   if (max == 0) {
     *out = ps_make_string_utf8(ctx, input, input_len);
     return *out ? PS_OK : PS_ERR;
   }
-  return replace_impl(ctx, e, input, input_len, (size_t)start, replacement, replacement_len, max, 1, out);
+  return replace_impl(ctx, e, input, input_len, glyphs, (size_t)start, start_b, replacement, replacement_len, max, 1, out);
 }
 
 static PS_Status mod_split(PS_Context *ctx, int argc, PS_Value **argv, PS_Value **out) {
@@ -1086,94 +2650,50 @@ static PS_Status mod_split(PS_Context *ctx, int argc, PS_Value **argv, PS_Value
   if (get_int_arg(ctx, argv[2], &start) != PS_OK) return PS_ERR;
   if (get_int_arg(ctx, argv[3], &max_parts) != PS_OK) return PS_ERR;
 
-  GlyphIndex idx;
-  if (!glyph_index_build(input, input_len, &idx)) return rx_throw(ctx, PS_ERR_UTF8, "RegExpSyntax", "input must be valid UTF-8");
-  if (start < 0 || (size_t)start > idx.glyph_count) {
-    glyph_index_free(&idx);
-    return rx_range(ctx, "start out of range");
-  }
-  if (max_parts < -1) {
-    glyph_index_free(&idx);
-    return rx_range(ctx, "maxParts out of range");
-  }
+  size_t glyphs = 0, cur_b = 0;
+  if (rx_prepare_input(ctx, input, input_len, start, &glyphs, &cur_b) != PS_OK) return PS_ERR;
+  if (max_parts < -1) return rx_range(ctx, "maxParts out of range");
 
   PS_Value *list = ps_make_list(ctx);
-  if (!list) {
-    glyph_index_free(&idx);
-    return PS_ERR;
-  }
+  if (!list) return PS_ERR;
   if (max_parts == 0) {
-    glyph_index_free(&idx);
     *out = list;
     return PS_OK;
   }
 
   size_t cur = (size_t)start;
-  size_t cur_b = glyph_to_byte_pos(&idx, cur);
   int64_t parts = 0;
-
-  if (max_parts == 1) {
-    PS_Value *tail = ps_make_string_utf8(ctx, input + cur_b, input_len - cur_b);
-    if (!tail || ps_list_push(ctx, list, tail) != PS_OK) {
-      if (tail) ps_value_release(tail);
-      ps_value_release(list);
-      glyph_index_free(&idx);
-      return PS_ERR;
-    }
-    ps_value_release(tail);
-    glyph_index_free(&idx);
-    *out = list;
-    return PS_OK;
-  }
-
   int64_t limit = (max_parts < 0) ? INT64_MAX : max_parts;
-  while (cur <= idx.glyph_count && parts + 1 < limit) {
-    PS_Value *m = NULL;
-    if (run_find(ctx, e, input, input_len, &idx, cur, &m) != PS_OK) {
-      ps_value_release(list);
-      glyph_index_free(&idx);
-      return PS_ERR;
-    }
-    int ok = 0;
-    int64_t ms = 0, me = 0;
-    PS_Value *groups = NULL;
-    if (get_match_span(ctx, m, &ms, &me, &ok, &groups) != PS_OK) {
-      ps_value_release(m);
+  while (cur <= glyphs && parts + 1 < limit) {
+    RxSpan span;
+    int found = rx_search(ctx, e, input, input_len, cur_b, cur, 0, &span);
+    if (found < 0) {
       ps_value_release(list);
-      glyph_index_free(&idx);
       return PS_ERR;
     }
-    if (!ok) {
-      ps_value_release(m);
-      break;
-    }
+    if (!found) break;
 
-    size_t mbs = glyph_to_byte_pos(&idx, (size_t)ms);
-    PS_Value *part = ps_make_string_utf8(ctx, input + cur_b, mbs - cur_b);
+    PS_Value *part = ps_make_string_utf8(ctx, input + cur_b, span.start_b - cur_b);
     if (!part || ps_list_push(ctx, list, part) != PS_OK) {
       if (part) ps_value_release(part);
-      ps_value_release(m);
       ps_value_release(list);
-      glyph_index_free(&idx);
       return PS_ERR;
     }
     ps_value_release(part);
     parts += 1;
 
-    if (me <= ms) {
-      if ((size_t)me >= idx.glyph_count) {
-        cur = (size_t)me;
-        cur_b = glyph_to_byte_pos(&idx, cur);
-        ps_value_release(m);
+    if (span.end_g <= span.start_g) {
+      if (span.end_g >= glyphs) {
+        cur = span.end_g;
+        cur_b = span.end_b;
         break;
       }
-      cur = (size_t)me + 1;
-      cur_b = glyph_to_byte_pos(&idx, cur);
+      cur = span.end_g + 1;
+      cur_b = utf8_skip_glyphs((const uint8_t *)input, input_len, span.end_b, 1);
     } else {
-      cur = (size_t)me;
-      cur_b = glyph_to_byte_pos(&idx, cur);
+      cur = span.end_g;
+      cur_b = span.end_b;
     }
-    ps_value_release(m);
   }
 
   if (parts < limit) {
@@ -1181,13 +2701,11 @@ static PS_Status mod_split(PS_Context *ctx, int argc, PS_Value **argv, PS_Value
     if (!tail || ps_list_push(ctx, list, tail) != PS_OK) {
       if (tail) ps_value_release(tail);
       ps_value_release(list);
-      glyph_index_free(&idx);
       return PS_ERR;
     }
     ps_value_release(tail);
   }
 
-  glyph_index_free(&idx);
   *out = list;
   return PS_OK;
 }
@@ -1212,6 +2730,7 @@ static const PS_TypeTag params_compile[] = {PS_T_STRING, PS_T_STRING};
 static const PS_TypeTag params_test[] = {PS_T_OBJECT, PS_T_STRING, PS_T_INT};
 static const PS_TypeTag params_find[] = {PS_T_OBJECT, PS_T_STRING, PS_T_INT};
 static const PS_TypeTag params_find_all[] = {PS_T_OBJECT, PS_T_STRING, PS_T_INT, PS_T_INT};
+static const PS_TypeTag params_find_all_spans[] = {PS_T_OBJECT, PS_T_STRING, PS_T_INT, PS_T_INT};
 static const PS_TypeTag params_replace_first[] = {PS_T_OBJECT, PS_T_STRING, PS_T_STRING, PS_T_INT};
 static const PS_TypeTag params_replace_all[] = {PS_T_OBJECT, PS_T_STRING, PS_T_STRING, PS_T_INT, PS_T_INT};
 static const PS_TypeTag params_split[] = {PS_T_OBJECT, PS_T_STRING, PS_T_INT, PS_T_INT};
@@ -1226,6 +2745,7 @@ PS_Status ps_module_init(PS_Context *ctx, PS_Module *out) {
     {.name = "test", .fn = mod_test, .arity = 3, .ret_type = PS_T_BOOL, .param_types = params_test, .flags = 0},
     {.name = "find", .fn = mod_find, .arity = 3, .ret_type = PS_T_OBJECT, .param_types = params_find, .flags = 0},
     {.name = "findAll", .fn = mod_find_all, .arity = 4, .ret_type = PS_T_LIST, .param_types = params_find_all, .flags = 0},
+    {.name = "findAllSpans", .fn = mod_find_all_spans, .arity = 4, .ret_type = PS_T_LIST, .param_types = params_find_all_spans, .flags = 0},
     {.name = "replaceFirst", .fn = mod_replace_first, .arity = 4, .ret_type = PS_T_STRING, .param_types = params_replace_first, .flags = 0},
     {.name = "replaceAll", .fn = mod_replace_all, .arity = 5, .ret_type = PS_T_STRING, .param_types = params_replace_all, .flags = 0},
     {.name = "split", .fn = mod_split, .arity = 4, .ret_type = PS_T_LIST, .param_types = params_split, .flags = 0},
@@ -14,6 +14,7 @@
 #include "ps_object.h"
 #include "ps_runtime.h"
 #include "ps_string.h"
+#include "ps_vm_internal.h"
 
 PS_TypeTag ps_typeof(PS_Value *v) {
   if (!v) return PS_T_VOID;
@@ -41,6 +42,7 @@ PS_TypeTag ps_typeof(PS_Value *v) {
     case PS_V_GROUP:
       return PS_T_GROUP;
     case PS_V_EXCEPTION:
+    case PS_V_JSON:
       return PS_T_OBJECT;
     case PS_V_FILE:
       return PS_T_FILE;
@@ -50,40 +52,35 @@ PS_TypeTag ps_typeof(PS_Value *v) {
 }
 
 PS_Value *ps_make_bool(PS_Context *ctx, int value) {
-  (void)ctx;
-  PS_Value *v = ps_value_alloc(PS_V_BOOL);
+  PS_Value *v = ps_value_alloc(ctx, PS_V_BOOL);
   if (!v) return NULL;
   v->as.bool_v = value ? 1 : 0;
   return v;
 }
 
 PS_Value *ps_make_int(PS_Context *ctx, int64_t value) {
-  (void)ctx;
-  PS_Value *v = ps_value_alloc(PS_V_INT);
+  PS_Value *v = ps_value_alloc(ctx, PS_V_INT);
   if (!v) return NULL;
   v->as.int_v = value;
   return v;
 }
 
 PS_Value *ps_make_float(PS_Context *ctx, double value) {
-  (void)ctx;
-  PS_Value *v = ps_value_alloc(PS_V_FLOAT);
+  PS_Value *v = ps_value_alloc(ctx, PS_V_FLOAT);
   if (!v) return NULL;
   v->as.float_v = value;
   return v;
 }
 
 PS_Value *ps_make_byte(PS_Context *ctx, uint8_t value) {
-  (void)ctx;
-  PS_Value *v = ps_value_alloc(PS_V_BYTE);
+  PS_Value *v = ps_value_alloc(ctx, PS_V_BYTE);
   if (!v) return NULL;
   v->as.byte_v = value;
   return v;
 }
 
 PS_Value *ps_make_glyph(PS_Context *ctx, uint32_t value) {
-  (void)ctx;
-  PS_Value *v = ps_value_alloc(PS_V_GLYPH);
+  PS_Value *v = ps_value_alloc(ctx, PS_V_GLYPH);
   if (!v) return NULL;
   v->as.glyph_v = value;
   return v;
@@ -93,12 +90,21 @@ PS_Value *ps_make_string_utf8(PS_Context *ctx, const char *utf8, size_t len) {
   return ps_string_from_utf8(ctx, utf8, len);
 }
 
+PS_Value *ps_make_string_utf8_owned(PS_Context *ctx, char *utf8, size_t len) {
+  if (!utf8) return ps_string_from_utf8(ctx, "", 0);
+  return ps_string_adopt_utf8(ctx, utf8, len);
+}
+
 PS_Value *ps_make_bytes(PS_Context *ctx, const uint8_t *bytes, size_t len) {
-  PS_Value *v = ps_value_alloc(PS_V_BYTES);
+  PS_Value *v = ps_value_alloc(ctx, PS_V_BYTES);
   if (!v) {
     ps_throw_diag(ctx, PS_ERR_OOM, "out of memory", "byte buffer allocation failed", "available memory");
     return NULL;
   }
+  if (!ps_heap_reserve(ctx, len)) {
+    ps_value_release(v);
+    return NULL;
+  }
   v->as.bytes_v.ptr = (uint8_t *)malloc(len);
   if (!v->as.bytes_v.ptr && len > 0) {
     ps_value_release(v);
@@ -107,6 +113,7 @@ PS_Value *ps_make_bytes(PS_Context *ctx, const uint8_t *bytes, size_t len) {
   }
   if (len > 0) memcpy(v->as.bytes_v.ptr, bytes, len);
   v->as.bytes_v.len = len;
+  ps_heap_charge(ctx, PS_HEAP_BYTES, (int64_t)len);
   return v;
 }
 
@@ -119,7 +126,7 @@ PS_Value *ps_make_object(PS_Context *ctx) { return ps_object_new(ctx); }
 PS_Value *ps_make_file(PS_Context *ctx, FILE *fp, uint32_t flags, const char *path) {
   (void)ctx;
   if (!fp) return NULL;
-  PS_Value *v = ps_value_alloc(PS_V_FILE);
+  PS_Value *v = ps_value_alloc(ctx, PS_V_FILE);
   if (!v) return NULL;
   v->as.file_v.fp = fp;
   v->as.file_v.flags = flags;
@@ -129,6 +136,58 @@ PS_Value *ps_make_file(PS_Context *ctx, FILE *fp, uint32_t flags, const char *pa
   return v;
 }
 
+PS_Status ps_file_write(PS_Context *ctx, PS_Value *file, const void *data, size_t len) {
+  if (!file || file->tag != PS_V_FILE) {
+    ps_throw_diag(ctx, PS_ERR_TYPE, "invalid argument", file ? "non-file value" : "null", "File");
+    return PS_ERR;
+  }
+  PS_File *f = &file->as.file_v;
+  if (f->closed || !f->fp) {
+    ps_throw_typed(ctx, PS_ERR_INTERNAL, "FileClosedException", "file is closed");
+    return PS_ERR;
+  }
+  if (!(f->flags & (PS_FILE_WRITE | PS_FILE_APPEND))) {
+    ps_throw_typed(ctx, PS_ERR_INTERNAL, "WriteFailureException", "file not writable");
+    return PS_ERR;
+  }
+  const char *p = (const char *)data;
+  size_t off = 0;
+  while (off < len) {
+    size_t n = fwrite(p + off, 1, len - off, f->fp);
+    if (n == 0 || ferror(f->fp)) {
+      ps_throw_typed(ctx, PS_ERR_INTERNAL, "WriteFailureException", "write failed");
+      return PS_ERR;
+    }
+    off += n;
+  }
+  return PS_OK;
+}
+
+PS_Status ps_file_read(PS_Context *ctx, PS_Value *file, void *buf, size_t cap, size_t *out_len) {
+  if (out_len) *out_len = 0;
+  if (!file || file->tag != PS_V_FILE) {
+    ps_throw_diag(ctx, PS_ERR_TYPE, "invalid argument", file ? "non-file value" : "null", "File");
+    return PS_ERR;
+  }
+  PS_File *f = &file->as.file_v;
+  if (f->closed || !f->fp) {
+    ps_throw_typed(ctx, PS_ERR_INTERNAL, "FileClosedException", "file is closed");
+    return PS_ERR;
+  }
+  if (!(f->flags & PS_FILE_READ)) {
+    ps_throw_typed(ctx, PS_ERR_INTERNAL, "ReadFailureException", "file not readable");
+    return PS_ERR;
+  }
+  size_t n = cap > 0 ? fread(buf, 1, cap, f->fp) : 0;
+  if (n == 0 && ferror(f->fp)) {
+    clearerr(f->fp);
+    ps_throw_typed(ctx, PS_ERR_INTERNAL, "ReadFailureException", "read failed");
+    return PS_ERR;
+  }
+  if (out_len) *out_len = n;
+  return PS_OK;
+}
+
 PS_Status ps_object_set_proto_name(PS_Context *ctx, PS_Value *obj, const char *name) {
   if (!obj || obj->tag != PS_V_OBJECT) {
     ps_throw_diag(ctx, PS_ERR_TYPE, "invalid object prototype assignment", obj ? "non-object value" : "null", "object");
@@ -137,6 +196,100 @@ PS_Status ps_object_set_proto_name(PS_Context *ctx, PS_Value *obj, const char *n
   return ps_object_set_proto_name_internal(ctx, obj, name) ? PS_OK : PS_ERR;
 }
 
+static const PS_IR_Proto *api_find_proto(PS_Context *ctx, const char *proto) {
+  if (!ctx || !ctx->current_module || !proto) return NULL;
+  return ps_ir_find_proto(ctx->current_module, proto);
+}
+
+int ps_proto_field_count(PS_Context *ctx, const char *proto, size_t *out_count) {
+  if (out_count) *out_count = 0;
+  const PS_IR_Proto *p = api_find_proto(ctx, proto);
+  if (!p) return 0;
+  size_t n = 0;
+  for (size_t depth = 0; p && depth < 256; depth++) {
+    n += p->field_count;
+    p = p->parent ? api_find_proto(ctx, p->parent) : NULL;
+  }
+  if (out_count) *out_count = n;
+  return 1;
+}
+
+int ps_proto_field_at(PS_Context *ctx, const char *proto, size_t index, const char **out_name,
+                      const char **out_type) {
+  const PS_IR_Proto *chain[256];
+  size_t depth = 0;
+  for (const PS_IR_Proto *p = api_find_proto(ctx, proto); p && depth < 256;
+       p = p->parent ? api_find_proto(ctx, p->parent) : NULL) {
+    chain[depth++] = p;
+  }
+  // Root first: a child's fields follow the ones it inherits.
+  while (depth > 0) {
+    const PS_IR_Proto *p = chain[--depth];
+    if (index < p->field_count) {
+      if (out_name) *out_name = p->fields[index].name;
+      if (out_type) *out_type = p->fields[index].type;
+      return 1;
+    }
+    index -= p->field_count;
+  }
+  return 0;
+}
+
+PS_Value *ps_make_json_null(PS_Context *ctx) {
+  PS_Value *v = ps_value_alloc(ctx, PS_V_JSON);
+  if (!v) return NULL;
+  v->as.json_v.kind = PS_JSON_KIND_NULL;
+  return v;
+}
+
+PS_Value *ps_make_json_bool(PS_Context *ctx, int value) {
+  PS_Value *v = ps_value_alloc(ctx, PS_V_JSON);
+  if (!v) return NULL;
+  v->as.json_v.kind = PS_JSON_KIND_BOOL;
+  v->as.json_v.as.bool_v = value ? 1 : 0;
+  return v;
+}
+
+PS_Value *ps_make_json_number(PS_Context *ctx, double value) {
+  PS_Value *v = ps_value_alloc(ctx, PS_V_JSON);
+  if (!v) return NULL;
+  v->as.json_v.kind = PS_JSON_KIND_NUMBER;
+  v->as.json_v.as.number_v = value;
+  return v;
+}
+
+PS_Value *ps_make_json(PS_Context *ctx, PS_JsonKind kind, PS_Value *payload) {
+  PS_ValueTag want = kind == PS_JSON_KIND_STRING ? PS_V_STRING : kind == PS_JSON_KIND_ARRAY ? PS_V_LIST : PS_V_MAP;
+  if (kind < PS_JSON_KIND_STRING || kind > PS_JSON_KIND_OBJECT || !payload || payload->tag != want) {
+    ps_throw_diag(ctx, PS_ERR_TYPE, "invalid JSON payload", payload ? "mismatched value" : "null", "string, list or map");
+    return NULL;
+  }
+  PS_Value *v = ps_value_alloc(ctx, PS_V_JSON);
+  if (!v) return NULL;
+  v->as.json_v.kind = kind;
+  v->as.json_v.as.ref = ps_value_retain(payload);
+  return v;
+}
+
+int ps_json_kind(PS_Value *v, PS_JsonKind *out_kind) {
+  if (!v || v->tag != PS_V_JSON) return 0;
+  if (out_kind) *out_kind = v->as.json_v.kind;
+  return 1;
+}
+
+int ps_json_bool(PS_Value *v) {
+  return v && v->tag == PS_V_JSON && v->as.json_v.kind == PS_JSON_KIND_BOOL ? v->as.json_v.as.bool_v : 0;
+}
+
+double ps_json_number(PS_Value *v) {
+  return v && v->tag == PS_V_JSON && v->as.json_v.kind == PS_JSON_KIND_NUMBER ? v->as.json_v.as.number_v : 0.0;
+}
+
+PS_Value *ps_json_payload(PS_Value *v) {
+  if (!v || v->tag != PS_V_JSON || v->as.json_v.kind < PS_JSON_KIND_STRING) return NULL;
+  return v->as.json_v.as.ref;
+}
+
 int ps_as_bool(PS_Value *v) { return v ? v->as.bool_v : 0; }
 int64_t ps_as_int(PS_Value *v) { return v ? v->as.int_v : 0; }
 double ps_as_float(PS_Value *v) { return v ? v->as.float_v : 0.0; }
@@ -213,7 +366,7 @@ PS_Status ps_throw_exception(PS_Context *ctx, const char *type, const char *mess
     ps_value_release(ctx->last_exception);
     ctx->last_exception = NULL;
   }
-  PS_Value *ex = ps_value_alloc(PS_V_EXCEPTION);
+  PS_Value *ex = ps_value_alloc(ctx, PS_V_EXCEPTION);
   if (!ex) {
     ps_throw_diag(ctx, PS_ERR_OOM, "out of memory", "exception allocation failed", "available memory");
     return PS_ERR;
@@ -221,15 +374,13 @@ PS_Status ps_throw_exception(PS_Context *ctx, const char *type, const char *mess
   ex->as.exc_v.is_runtime = 0;
   ex->as.exc_v.type_name = type ? strdup(type) : NULL;
   ex->as.exc_v.parent_name = strdup("Exception");
-  ex->as.exc_v.fields = ps_object_new(ctx);
-  ex->as.exc_v.file = ps_make_string_utf8(ctx, "", 0);
   ex->as.exc_v.line = 1;
   ex->as.exc_v.column = 1;
   ex->as.exc_v.message = ps_make_string_utf8(ctx, message ? message : "", message ? strlen(message) : 0);
   ex->as.exc_v.cause = NULL;
   ex->as.exc_v.code = NULL;
   ex->as.exc_v.category = NULL;
-  if (!ex->as.exc_v.parent_name || !ex->as.exc_v.fields || !ex->as.exc_v.file || !ex->as.exc_v.message) {
+  if (!ex->as.exc_v.parent_name || !ex->as.exc_v.message) {
     ps_value_release(ex);
     ps_throw_diag(ctx, PS_ERR_OOM, "out of memory", "exception allocation failed", "available memory");
     return PS_ERR;
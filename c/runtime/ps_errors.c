@@ -1,34 +1,86 @@
+#include <stdlib.h>
 #include <string.h>
 
 #include "ps_errors.h"
 #include "ps_runtime.h"
 #include "../diag.h"
 
+// Bounded copy that tolerates `src` aliasing `dst` (callers may pass back
+// ps_last_error_message).
+static void error_slot_copy(char *dst, size_t cap, const char *src) {
+  size_t n = src ? strlen(src) : 0;
+  if (n >= cap) n = cap - 1;
+  if (n) memmove(dst, src, n);
+  dst[n] = '\0';
+}
+
+static void error_reset(PS_Error *err, PS_ErrorCode code) {
+  err->code = code;
+  err->diag = PS_RDIAG_UNRESOLVED;
+  err->exc_type[0] = '\0';
+  err->body = 0;
+  err->formatted = 1;
+}
+
+// Native modules tag typed failures as "<ns>:<ExceptionType>:<message>".
+static void error_split_typed(PS_Error *err) {
+  const char *msg = err->message;
+  size_t ns = 0;
+  if (strncmp(msg, "sys:", 4) == 0) ns = 4;
+  else if (strncmp(msg, "fs:", 3) == 0 || strncmp(msg, "io:", 3) == 0) ns = 3;
+  if (!ns) return;
+  const char *sep = strchr(msg + ns, ':');
+  if (!sep || sep == msg + ns) return;
+  size_t len = (size_t)(sep - (msg + ns));
+  if (len >= sizeof(err->exc_type)) return;
+  memcpy(err->exc_type, msg + ns, len);
+  err->exc_type[len] = '\0';
+  err->body = (size_t)(sep + 1 - msg);
+}
+
 void ps_error_set(PS_Context *ctx, PS_ErrorCode code, const char *msg) {
   if (!ctx) return;
-  ctx->last_error.code = code;
-  if (msg) {
-    strncpy(ctx->last_error.message, msg, sizeof(ctx->last_error.message) - 1);
-    ctx->last_error.message[sizeof(ctx->last_error.message) - 1] = '\0';
-  } else {
-    ctx->last_error.message[0] = '\0';
-  }
+  PS_Error *err = &ctx->last_error;
+  error_slot_copy(err->message, sizeof(err->message), msg);
+  error_reset(err, code);
+  error_split_typed(err);
 }
 
 void ps_error_clear(PS_Context *ctx) {
   if (!ctx) return;
-  ctx->last_error.code = PS_ERR_NONE;
+  error_reset(&ctx->last_error, PS_ERR_NONE);
   ctx->last_error.message[0] = '\0';
 }
 
+const char *ps_error_message(PS_Error *err) {
+  if (!err->formatted) {
+    ps_format_diag(err->message, sizeof(err->message), err->short_msg, err->got, err->expected);
+    err->formatted = 1;
+  }
+  return err->message;
+}
+
 void ps_format_diag(char *out, size_t out_sz, const char *short_msg, const char *got, const char *expected) {
   ps_diag_format(out, out_sz, PS_DIAG_TEMPLATE_RUNTIME, short_msg, got, expected);
 }
 
 void ps_throw_diag(PS_Context *ctx, PS_ErrorCode code, const char *short_msg, const char *got, const char *expected) {
-  char buf[256];
-  ps_format_diag(buf, sizeof(buf), short_msg, got, expected);
-  ps_throw(ctx, code, buf);
+  if (!ctx) return;
+  PS_Error *err = &ctx->last_error;
+  // Arguments may point into the previous record's text: copy before resetting.
+  error_slot_copy(err->short_msg, sizeof(err->short_msg), short_msg);
+  error_slot_copy(err->got, sizeof(err->got), got);
+  error_slot_copy(err->expected, sizeof(err->expected), expected);
+  error_reset(err, code);
+  err->formatted = 0;
+}
+
+void ps_throw_typed(PS_Context *ctx, PS_ErrorCode code, const char *exc_type, const char *msg) {
+  if (!ctx) return;
+  PS_Error *err = &ctx->last_error;
+  error_slot_copy(err->message, sizeof(err->message), msg);
+  error_reset(err, code);
+  error_slot_copy(err->exc_type, sizeof(err->exc_type), exc_type && *exc_type ? exc_type : "IOException");
 }
 
 static int msg_has(const char *msg, const char *needle) {
@@ -36,82 +88,122 @@ static int msg_has(const char *msg, const char *needle) {
   return strstr(msg, needle) != NULL;
 }
 
-const char *ps_runtime_category(PS_ErrorCode code, const char *msg, const char **out_code) {
-  if (!out_code) return NULL;
-  *out_code = NULL;
+static PS_RuntimeDiag runtime_diag_classify(PS_ErrorCode code, const char *msg) {
   if (code == PS_ERR_IMPORT) {
-    *out_code = "R1010";
-    return "RUNTIME_MODULE_ERROR";
+    return PS_RDIAG_MODULE_ERROR;
   }
   if (code == PS_ERR_RANGE) {
     if (msg_has(msg, "invalid argument")) {
-      *out_code = "R1009";
-      return "RUNTIME_INVALID_ARGUMENT";
+      return PS_RDIAG_INVALID_ARGUMENT;
     }
     if (msg_has(msg, "int overflow")) {
-      *out_code = "R1001";
-      return "RUNTIME_INT_OVERFLOW";
+      return PS_RDIAG_INT_OVERFLOW;
     }
     if (msg_has(msg, "index out of bounds") || msg_has(msg, "string index out of bounds")) {
-      *out_code = "R1002";
-      return "RUNTIME_INDEX_OOB";
+      return PS_RDIAG_INDEX_OOB;
     }
     if (msg_has(msg, "missing key")) {
-      *out_code = "R1003";
-      return "RUNTIME_MISSING_KEY";
+      return PS_RDIAG_MISSING_KEY;
     }
     if (msg_has(msg, "division by zero")) {
-      *out_code = "R1004";
-      return "RUNTIME_DIVIDE_BY_ZERO";
+      return PS_RDIAG_DIVIDE_BY_ZERO;
     }
     if (msg_has(msg, "invalid shift")) {
-      *out_code = "R1005";
-      return "RUNTIME_SHIFT_RANGE";
+      return PS_RDIAG_SHIFT_RANGE;
     }
     if (msg_has(msg, "pop on empty list")) {
-      *out_code = "R1006";
-      return "RUNTIME_EMPTY_POP";
+      return PS_RDIAG_EMPTY_POP;
     }
     if (msg_has(msg, "byte out of range")) {
-      *out_code = "R1008";
-      return "RUNTIME_BYTE_RANGE";
+      return PS_RDIAG_BYTE_RANGE;
     }
     if (msg_has(msg, "view invalidated")) {
-      *out_code = "R1012";
-      return "RUNTIME_VIEW_INVALID";
+      return PS_RDIAG_VIEW_INVALID;
     }
     if (msg_has(msg, "file") || msg_has(msg, "read") || msg_has(msg, "write") || msg_has(msg, "seek") ||
         msg_has(msg, "tell") || msg_has(msg, "stream") || msg_has(msg, "open")) {
-      *out_code = "R1010";
-      return "RUNTIME_IO_ERROR";
+      return PS_RDIAG_IO_ERROR;
     }
   }
   if (code == PS_ERR_UTF8) {
-    *out_code = "R1007";
-    return "RUNTIME_INVALID_UTF8";
+    return PS_RDIAG_INVALID_UTF8;
   }
   if (code == PS_ERR_TYPE) {
     if (msg_has(msg, "clone not supported for builtin handle")) {
-      *out_code = "R1013";
-      return "RUNTIME_CLONE_NOT_SUPPORTED";
+      return PS_RDIAG_CLONE_NOT_SUPPORTED;
     }
     if (msg_has(msg, "Json") || msg_has(msg, "JSON")) {
-      *out_code = "R1010";
-      return "RUNTIME_JSON_ERROR";
+      return PS_RDIAG_JSON_ERROR;
     }
     if (msg_has(msg, "file") || msg_has(msg, "read") || msg_has(msg, "write") || msg_has(msg, "seek") ||
         msg_has(msg, "tell") || msg_has(msg, "stream") || msg_has(msg, "open")) {
-      *out_code = "R1010";
-      return "RUNTIME_IO_ERROR";
+      return PS_RDIAG_IO_ERROR;
     }
-    *out_code = "R1010";
-    return "RUNTIME_TYPE_ERROR";
+    return PS_RDIAG_TYPE_ERROR;
+  }
+  if (code == PS_ERR_OOM) {
+    return PS_RDIAG_OUT_OF_MEMORY;
   }
   if (code == PS_ERR_INTERNAL) {
     if (msg_has(msg, "read failed") || msg_has(msg, "write failed") || msg_has(msg, "tell failed")) {
-      *out_code = "R1010";
-      return "RUNTIME_IO_ERROR";
+      return PS_RDIAG_IO_ERROR;
     }
   }
-  return NULL;
+  return PS_RDIAG_NONE;
+}
+
+static const struct {
+  const char *code;
+  const char *category;
+} RUNTIME_DIAGS[] = {
+    [PS_RDIAG_UNRESOLVED] = {NULL, NULL},
+    [PS_RDIAG_NONE] = {NULL, NULL},
+    [PS_RDIAG_MODULE_ERROR] = {"R1010", "RUNTIME_MODULE_ERROR"},
+    [PS_RDIAG_INVALID_ARGUMENT] = {"R1009", "RUNTIME_INVALID_ARGUMENT"},
+    [PS_RDIAG_INT_OVERFLOW] = {"R1001", "RUNTIME_INT_OVERFLOW"},
+    [PS_RDIAG_INDEX_OOB] = {"R1002", "RUNTIME_INDEX_OOB"},
+    [PS_RDIAG_MISSING_KEY] = {"R1003", "RUNTIME_MISSING_KEY"},
+    [PS_RDIAG_DIVIDE_BY_ZERO] = {"R1004", "RUNTIME_DIVIDE_BY_ZERO"},
+    [PS_RDIAG_SHIFT_RANGE] = {"R1005", "RUNTIME_SHIFT_RANGE"},
+    [PS_RDIAG_EMPTY_POP] = {"R1006", "RUNTIME_EMPTY_POP"},
+    [PS_RDIAG_BYTE_RANGE] = {"R1008", "RUNTIME_BYTE_RANGE"},
+    [PS_RDIAG_VIEW_INVALID] = {"R1012", "RUNTIME_VIEW_INVALID"},
+    [PS_RDIAG_IO_ERROR] = {"R1010", "RUNTIME_IO_ERROR"},
+    [PS_RDIAG_INVALID_UTF8] = {"R1007", "RUNTIME_INVALID_UTF8"},
+    [PS_RDIAG_CLONE_NOT_SUPPORTED] = {"R1013", "RUNTIME_CLONE_NOT_SUPPORTED"},
+    [PS_RDIAG_JSON_ERROR] = {"R1010", "RUNTIME_JSON_ERROR"},
+    [PS_RDIAG_TYPE_ERROR] = {"R1010", "RUNTIME_TYPE_ERROR"},
+    [PS_RDIAG_OUT_OF_MEMORY] = {"R1014", "RUNTIME_OUT_OF_MEMORY"},
+};
+
+const char *ps_runtime_diag_code(PS_RuntimeDiag diag) { return RUNTIME_DIAGS[diag].code; }
+
+const char *ps_runtime_diag_category(PS_RuntimeDiag diag) { return RUNTIME_DIAGS[diag].category; }
+
+const char *ps_runtime_category(PS_ErrorCode code, const char *msg, const char **out_code) {
+  if (!out_code) return NULL;
+  PS_RuntimeDiag diag = runtime_diag_classify(code, msg);
+  *out_code = RUNTIME_DIAGS[diag].code;
+  return RUNTIME_DIAGS[diag].category;
+}
+
+PS_RuntimeDiag ps_error_diag(PS_Error *err) {
+  if (err->diag == PS_RDIAG_UNRESOLVED) err->diag = runtime_diag_classify(err->code, ps_error_message(err));
+  return err->diag;
+}
+
+void ps_exception_resolve(PS_Context *ctx, PS_Value *ex) {
+  if (!ex || ex->tag != PS_V_EXCEPTION) return;
+  if (!ex->as.exc_v.file) ex->as.exc_v.file = ps_make_string_utf8(ctx, "", 0);
+  if (!ex->as.exc_v.pending) return;
+  PS_Error *err = ex->as.exc_v.pending;
+  ex->as.exc_v.pending = NULL;
+  const char *msg = ps_error_message(err);
+  PS_RuntimeDiag diag = ps_error_diag(err);
+  const char *code = RUNTIME_DIAGS[diag].code;
+  const char *category = RUNTIME_DIAGS[diag].category;
+  if (!ex->as.exc_v.message) ex->as.exc_v.message = ps_make_string_utf8(ctx, msg, strlen(msg));
+  if (!ex->as.exc_v.code && code) ex->as.exc_v.code = ps_make_string_utf8(ctx, code, strlen(code));
+  if (!ex->as.exc_v.category && category) ex->as.exc_v.category = ps_make_string_utf8(ctx, category, strlen(category));
+  free(err);
 }
@@ -1,24 +1,75 @@
 #ifndef PS_ERRORS_H
 #define PS_ERRORS_H
 
+#include <stddef.h>
+
 #include "ps/ps_api.h"
 
-typedef struct {
+// Canonical runtime diagnostic (Rxxxx code + category) of an error record.
+typedef enum {
+  PS_RDIAG_UNRESOLVED = 0, // not classified yet
+  PS_RDIAG_NONE,           // no canonical mapping
+  PS_RDIAG_MODULE_ERROR,
+  PS_RDIAG_INVALID_ARGUMENT,
+  PS_RDIAG_INT_OVERFLOW,
+  PS_RDIAG_INDEX_OOB,
+  PS_RDIAG_MISSING_KEY,
+  PS_RDIAG_DIVIDE_BY_ZERO,
+  PS_RDIAG_SHIFT_RANGE,
+  PS_RDIAG_EMPTY_POP,
+  PS_RDIAG_BYTE_RANGE,
+  PS_RDIAG_VIEW_INVALID,
+  PS_RDIAG_IO_ERROR,
+  PS_RDIAG_INVALID_UTF8,
+  PS_RDIAG_CLONE_NOT_SUPPORTED,
+  PS_RDIAG_JSON_ERROR,
+  PS_RDIAG_TYPE_ERROR,
+  PS_RDIAG_OUT_OF_MEMORY
+} PS_RuntimeDiag;
+
+// Structured error record. ps_throw_diag only stores its arguments; the text
+// ("<short>. got <got>; expected <expected>") and the diagnostic are derived
+// on first read, so errors caught by the script never pay for them.
+typedef struct PS_Error {
   PS_ErrorCode code;
+  PS_RuntimeDiag diag;
+  char exc_type[64]; // runtime exception prototype for typed errors ("" otherwise)
+  size_t body;       // offset of the exception message in `message` (typed errors)
+  int formatted;     // `message` is up to date
+  char short_msg[256];
+  char got[256];
+  char expected[256];
   char message[256];
 } PS_Error;
 
 void ps_error_set(PS_Context *ctx, PS_ErrorCode code, const char *msg);
 void ps_error_clear(PS_Context *ctx);
 
+// Formatted text of the record (built on first call).
+const char *ps_error_message(PS_Error *err);
+// Canonical diagnostic of the record (classified on first call).
+PS_RuntimeDiag ps_error_diag(PS_Error *err);
+// Rxxxx code / category name of a diagnostic (NULL for NONE/UNRESOLVED).
+const char *ps_runtime_diag_code(PS_RuntimeDiag diag);
+const char *ps_runtime_diag_category(PS_RuntimeDiag diag);
+
 // Build a normative diagnostic message with got/expected details.
 // Format: "<short>. got <got>; expected <expected>"
 void ps_format_diag(char *out, size_t out_sz, const char *short_msg, const char *got, const char *expected);
 void ps_throw_diag(PS_Context *ctx, PS_ErrorCode code, const char *short_msg, const char *got, const char *expected);
+// Raise a runtime exception of prototype `exc_type` (child of RuntimeException).
+// Native modules get the same effect through ps_throw with a
+// "<ns>:<ExceptionType>:<message>" text (ns = sys, fs or io).
+void ps_throw_typed(PS_Context *ctx, PS_ErrorCode code, const char *exc_type, const char *msg);
 
 // Runtime diagnostic mapping (best-effort).
 // Returns category string or NULL if no mapping exists.
 // If non-NULL, out_code is set to the canonical Rxxxx code.
 const char *ps_runtime_category(PS_ErrorCode code, const char *msg, const char **out_code);
 
+// Builds the lazily created fields of an exception: file, and the
+// message/code/category of a runtime exception whose error record is still
+// pending. Call before reading those fields directly.
+void ps_exception_resolve(PS_Context *ctx, PS_Value *ex);
+
 #endif // PS_ERRORS_H
@@ -1,18 +1,59 @@
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "ps_runtime.h"
 #include "ps_modules.h"
+#include "ps_profile.h"
+
+static PS_Heap g_process_heap;
+static PS_Heap *g_process_heaps[1] = {&g_process_heap};
+PS_Heap **ps_heaps = g_process_heaps;
+static size_t g_heaps_cap = 1;
+
+// Gives the heap a slot in ps_heaps: the first one left by a destroyed
+// context, else a new one. Values only hold 16 bits of it.
+static int heap_register(PS_Heap *h) {
+  size_t id = 1;
+  while (id < g_heaps_cap && ps_heaps[id] != &g_process_heap) id++;
+  if (id == g_heaps_cap) {
+    if (g_heaps_cap > UINT16_MAX) return 0;
+    size_t cap = g_heaps_cap * 2;
+    if (cap > (size_t)UINT16_MAX + 1) cap = (size_t)UINT16_MAX + 1;
+    PS_Heap **n = (PS_Heap **)malloc(cap * sizeof(PS_Heap *));
+    if (!n) return 0;
+    memcpy(n, ps_heaps, g_heaps_cap * sizeof(PS_Heap *));
+    for (size_t i = g_heaps_cap; i < cap; i++) n[i] = &g_process_heap;
+    if (ps_heaps != g_process_heaps) free(ps_heaps);
+    ps_heaps = n;
+    g_heaps_cap = cap;
+  }
+  ps_heaps[id] = h;
+  h->id = (uint16_t)id;
+  return 1;
+}
 
 PS_Context *ps_ctx_create(void) {
   PS_Context *ctx = (PS_Context *)calloc(1, sizeof(PS_Context));
   if (!ctx) return NULL;
+  if (!heap_register(&ctx->heap)) {
+    free(ctx);
+    return NULL;
+  }
   ctx->handles.items = NULL;
   ctx->handles.len = 0;
   ctx->handles.cap = 0;
-  ctx->last_error.code = PS_ERR_NONE;
-  ctx->last_error.message[0] = '\0';
+  ps_error_clear(ctx);
   ctx->trace = 0;
   ctx->trace_ir = 0;
+  ctx->no_fuse = 0;
+  ctx->profile = NULL;
+  ctx->sampler = NULL;
+  ctx->module_load_ns = 0;
+  ctx->modules_loaded = 0;
+  ctx->module_data = NULL;
+  ctx->module_data_len = 0;
+  ctx->module_data_cap = 0;
   ctx->eof_value = NULL;
   ctx->stdin_value = NULL;
   ctx->stdout_value = NULL;
@@ -24,9 +65,12 @@ PS_Context *ps_ctx_create(void) {
 
 void ps_ctx_destroy(PS_Context *ctx) {
   if (!ctx) return;
+  ctx->heap.free_budget = 0;
+  ps_value_drain(0);
   while (ctx->handles.len > 0) {
     ps_handle_pop(ctx);
   }
+  ps_module_data_free(ctx);
   if (ctx->modules) {
     for (size_t i = 0; i < ctx->module_count; i++) {
       if (ctx->modules[i].lib) {
@@ -44,10 +88,120 @@ void ps_ctx_destroy(PS_Context *ctx) {
   if (ctx->stdout_value) ps_value_release(ctx->stdout_value);
   if (ctx->stderr_value) ps_value_release(ctx->stderr_value);
   if (ctx->last_exception) ps_value_release(ctx->last_exception);
+  if (ctx->exc_file) ps_value_release(ctx->exc_file);
+  // Garbage cycles, and headers of buffered roots freed since the last pass.
+  while (ctx->heap.gc_roots_len && ps_value_collect_cycles(&ctx->heap) > 0) {
+  }
+  for (size_t i = 0; i < ctx->heap.gc_roots_len; i++) {
+    PS_Value *v = ctx->heap.gc_roots[i];
+    v->gc_flags = 0;
+    if (v->refcount <= 0) free(v);
+  }
+  free(ctx->heap.gc_roots);
+  ctx->heap.gc_roots = NULL;
+  ctx->heap.gc_roots_len = 0;
+  ps_profile_destroy(ctx->profile);
+  ps_sampler_destroy(ctx->sampler);
   free(ctx->handles.items);
+  ps_census_destroy(ctx->heap.census);
+  ctx->heap.census = NULL;
+  // Values that outlive the context are refunded to the process heap.
+  ps_heaps[ctx->heap.id] = &g_process_heap;
   free(ctx);
 }
 
+// Allowance past the limit once it has been hit, so that the exception can be
+// built and handlers can run (and release memory) before the next failure.
+static size_t heap_headroom(const PS_Heap *h) { return h->max_bytes / 16 + 64 * 1024; }
+
+int ps_heap_admit(PS_Context *ctx, size_t bytes) {
+  PS_Heap *h = &ctx->heap;
+  int64_t need = h->live_bytes + (int64_t)bytes;
+  if (need <= (int64_t)h->max_bytes) return 1;
+  // Values queued for deferred destruction are not live.
+  if (ps_value_pending() && ps_value_drain(0)) need = h->live_bytes + (int64_t)bytes;
+  if (need <= (int64_t)h->max_bytes) return 1;
+  if (h->tripped && need <= (int64_t)(h->max_bytes + heap_headroom(h))) return 1;
+  h->tripped = 1;
+  char got[64];
+  char expected[64];
+  snprintf(got, sizeof(got), "%lld bytes", (long long)need);
+  snprintf(expected, sizeof(expected), "at most %zu bytes", h->max_bytes);
+  ps_throw_diag(ctx, PS_ERR_OOM, "memory limit exceeded", got, expected);
+  return 0;
+}
+
+int ps_heap_check(PS_Context *ctx) {
+  PS_Heap *h = &ctx->heap;
+  if (h->live_bytes <= (int64_t)h->max_bytes) {
+    // The headroom is withdrawn once the handlers have released memory.
+    if (h->tripped && h->live_bytes + (int64_t)heap_headroom(h) <= (int64_t)h->max_bytes) h->tripped = 0;
+    return 1;
+  }
+  return ps_heap_admit(ctx, 0);
+}
+
+static size_t heap_count(int64_t n) { return n > 0 ? (size_t)n : 0; }
+
+void ps_heap_stats(PS_Context *ctx, PS_HeapStats *out) {
+  if (!out) return;
+  memset(out, 0, sizeof(*out));
+  if (!ctx) return;
+  const PS_Heap *h = &ctx->heap;
+  out->live_values = heap_count(h->live_values);
+  out->peak_values = heap_count(h->peak_values);
+  out->live_bytes = heap_count(h->live_bytes);
+  out->peak_bytes = heap_count(h->peak_bytes);
+  out->max_bytes = h->max_bytes;
+  out->value_bytes = heap_count(h->bytes[PS_HEAP_VALUES]);
+  out->string_bytes = heap_count(h->bytes[PS_HEAP_STRINGS]);
+  out->bytes_bytes = heap_count(h->bytes[PS_HEAP_BYTES]);
+  out->list_bytes = heap_count(h->bytes[PS_HEAP_LISTS]);
+  out->object_bytes = heap_count(h->bytes[PS_HEAP_OBJECTS]);
+  out->map_bytes = heap_count(h->bytes[PS_HEAP_MAPS]);
+  out->gc_runs = (size_t)h->gc_runs;
+  out->gc_collected = (size_t)h->gc_collected;
+  for (int tag = 0; tag <= PS_V_VOID; tag++) {
+    PS_Value probe;
+    probe.tag = (PS_ValueTag)tag;
+    out->values_by_type[ps_typeof(&probe)] += heap_count(h->values[tag]);
+  }
+}
+
+void ps_heap_set_limit(PS_Context *ctx, size_t max_bytes) {
+  if (!ctx) return;
+  ctx->heap.max_bytes = max_bytes;
+  ctx->heap.tripped = 0;
+}
+
+// A pass may walk everything reachable from the buffered roots, up to the
+// whole live graph: spacing passes by at least the number of live values keeps
+// the collector's total work linear in the number of allocations.
+static void gc_schedule(PS_Heap *h) {
+  uint64_t gap = h->gc_threshold;
+  if (h->live_values > 0 && (uint64_t)h->live_values > gap) gap = (uint64_t)h->live_values;
+  h->gc_next = ps_value_alloc_total() + gap;
+}
+
+void ps_heap_set_gc(PS_Context *ctx, size_t threshold) {
+  if (!ctx) return;
+  ctx->heap.gc_threshold = threshold;
+  gc_schedule(&ctx->heap);
+}
+
+void ps_heap_set_free_budget(PS_Context *ctx, size_t values_per_poll) {
+  if (!ctx) return;
+  ctx->heap.free_budget = values_per_poll;
+  if (!values_per_poll) ps_value_drain(0);
+}
+
+size_t ps_heap_collect(PS_Context *ctx) {
+  if (!ctx) return 0;
+  size_t freed = ps_value_collect_cycles(&ctx->heap);
+  gc_schedule(&ctx->heap);
+  return freed;
+}
+
 void ps_handle_push(PS_Context *ctx, PS_Value *v) {
   if (!ctx || !v) return;
   if (ctx->handles.len == ctx->handles.cap) {
@@ -74,7 +228,7 @@ PS_ErrorCode ps_last_error_code(PS_Context *ctx) {
 
 const char *ps_last_error_message(PS_Context *ctx) {
   if (!ctx) return "internal error";
-  return ctx->last_error.message;
+  return ps_error_message(&ctx->last_error);
 }
 
 void ps_clear_error(PS_Context *ctx) { ps_error_clear(ctx); }
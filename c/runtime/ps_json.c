@@ -1,16 +1,85 @@
 #include <ctype.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 
 #include "ps_json.h"
 
+// Nodes, child arrays and object indexes are bump-allocated from chunks owned by the
+// root; the whole tree is released at once by ps_json_free.
+#define PS_JSON_CHUNK_SIZE 65536
+#define PS_JSON_ALIGN 16
+
+typedef struct PS_JsonChunk {
+  struct PS_JsonChunk *next;
+  size_t used;
+  size_t cap;
+} PS_JsonChunk;
+
+struct PS_JsonArena {
+  PS_JsonChunk *head;
+  char *owned_src;
+};
+
 typedef struct {
-  const char *src;
+  char *src;
   size_t len;
   size_t pos;
   const char *err;
+  PS_JsonArena *arena;
+  // Scratch stack for children of the arrays/objects being parsed; each container is
+  // copied into the arena with its exact size once closed.
+  void **stack;
+  size_t stack_len;
+  size_t stack_cap;
 } PS_JsonParser;
 
+static size_t chunk_header_size(void) {
+  return (sizeof(PS_JsonChunk) + PS_JSON_ALIGN - 1) & ~(size_t)(PS_JSON_ALIGN - 1);
+}
+
+static void *arena_alloc(PS_JsonArena *a, size_t n) {
+  n = (n + PS_JSON_ALIGN - 1) & ~(size_t)(PS_JSON_ALIGN - 1);
+  if (n == 0) n = PS_JSON_ALIGN;
+  PS_JsonChunk *c = a->head;
+  if (!c || c->cap - c->used < n) {
+    size_t cap = n > PS_JSON_CHUNK_SIZE ? n : PS_JSON_CHUNK_SIZE;
+    c = (PS_JsonChunk *)malloc(chunk_header_size() + cap);
+    if (!c) return NULL;
+    c->used = 0;
+    c->cap = cap;
+    c->next = a->head;
+    a->head = c;
+  }
+  void *p = (char *)c + chunk_header_size() + c->used;
+  c->used += n;
+  return p;
+}
+
+static void arena_destroy(PS_JsonArena *a) {
+  if (!a) return;
+  PS_JsonChunk *c = a->head;
+  while (c) {
+    PS_JsonChunk *next = c->next;
+    free(c);
+    c = next;
+  }
+  free(a->owned_src);
+  free(a);
+}
+
+static int stack_push(PS_JsonParser *p, void *v) {
+  if (p->stack_len == p->stack_cap) {
+    size_t cap = p->stack_cap ? p->stack_cap * 2 : 64;
+    void **ns = (void **)realloc(p->stack, sizeof(void *) * cap);
+    if (!ns) return 0;
+    p->stack = ns;
+    p->stack_cap = cap;
+  }
+  p->stack[p->stack_len++] = v;
+  return 1;
+}
+
 static void skip_ws(PS_JsonParser *p) {
   while (p->pos < p->len && isspace((unsigned char)p->src[p->pos])) p->pos++;
 }
@@ -27,109 +96,156 @@ static int match(PS_JsonParser *p, const char *kw) {
 
 static PS_JsonValue *parse_value(PS_JsonParser *p);
 
-static char *parse_string(PS_JsonParser *p) {
-  if (p->src[p->pos] != '"') return NULL;
+static int parse_hex4(PS_JsonParser *p, uint32_t *out) {
+  if (p->pos + 4 > p->len) return 0;
+  uint32_t cp = 0;
+  for (int i = 0; i < 4; i++) {
+    char h = p->src[p->pos++];
+    cp <<= 4;
+    if (h >= '0' && h <= '9') cp |= (uint32_t)(h - '0');
+    else if (h >= 'a' && h <= 'f') cp |= (uint32_t)(10 + h - 'a');
+    else if (h >= 'A' && h <= 'F') cp |= (uint32_t)(10 + h - 'A');
+    else return 0;
+  }
+  *out = cp;
+  return 1;
+}
+
+static size_t put_utf8(char *dst, uint32_t cp) {
+  if (cp <= 0x7F) {
+    dst[0] = (char)cp;
+    return 1;
+  }
+  if (cp <= 0x7FF) {
+    dst[0] = (char)(0xC0 | (cp >> 6));
+    dst[1] = (char)(0x80 | (cp & 0x3F));
+    return 2;
+  }
+  if (cp <= 0xFFFF) {
+    dst[0] = (char)(0xE0 | (cp >> 12));
+    dst[1] = (char)(0x80 | ((cp >> 6) & 0x3F));
+    dst[2] = (char)(0x80 | (cp & 0x3F));
+    return 3;
+  }
+  dst[0] = (char)(0xF0 | (cp >> 18));
+  dst[1] = (char)(0x80 | ((cp >> 12) & 0x3F));
+  dst[2] = (char)(0x80 | ((cp >> 6) & 0x3F));
+  dst[3] = (char)(0x80 | (cp & 0x3F));
+  return 4;
+}
+
+// Decodes the string in place: escape sequences never expand, so the decoded bytes
+// always fit behind the read position and the closing quote becomes the terminator.
+// Strings without escapes are returned as-is, pointing into the source buffer.
+static char *parse_string(PS_JsonParser *p, size_t *out_len) {
+  if (p->pos >= p->len || p->src[p->pos] != '"') return NULL;
   p->pos++;
-  size_t cap = 64;
-  char *buf = (char *)malloc(cap);
-  if (!buf) return NULL;
-  size_t out = 0;
-#define ENSURE_CAP(extra) \
-  do { \
-    if (out + (extra) + 1 > cap) { \
-      while (out + (extra) + 1 > cap) cap *= 2; \
-      char *nb = (char *)realloc(buf, cap); \
-      if (!nb) { free(buf); return NULL; } \
-      buf = nb; \
-    } \
-  } while (0)
+  char *start = p->src + p->pos;
+  while (p->pos < p->len) {
+    char c = p->src[p->pos];
+    if (c == '"' || c == '\\') break;
+    p->pos++;
+  }
+  size_t out = p->pos;
   while (p->pos < p->len) {
     char c = p->src[p->pos++];
-    if (c == '"') break;
-    if (c == '\\') {
-      if (p->pos >= p->len) break;
-      char e = p->src[p->pos++];
-      switch (e) {
-        case '"':
-        case '\\':
-        case '/':
-          ENSURE_CAP(1);
-          buf[out++] = e;
-          break;
-        case 'b':
-          ENSURE_CAP(1);
-          buf[out++] = '\b';
-          break;
-        case 'f':
-          ENSURE_CAP(1);
-          buf[out++] = '\f';
-          break;
-        case 'n':
-          ENSURE_CAP(1);
-          buf[out++] = '\n';
-          break;
-        case 'r':
-          ENSURE_CAP(1);
-          buf[out++] = '\r';
-          break;
-        case 't':
-          ENSURE_CAP(1);
-          buf[out++] = '\t';
-          break;
-        case 'u':
-          // Minimal: copy as-is, no UTF-16 decoding (IR uses ASCII keys).
-          if (p->pos + 4 <= p->len) {
-            ENSURE_CAP(1);
-            buf[out++] = '?';
-            p->pos += 4;
+    if (c == '"') {
+      p->src[out] = '\0';
+      if (out_len) *out_len = (size_t)(p->src + out - start);
+      return start;
+    }
+    if (c != '\\') {
+      p->src[out++] = c;
+      continue;
+    }
+    if (p->pos >= p->len) break;
+    char e = p->src[p->pos++];
+    switch (e) {
+      case 'b': p->src[out++] = '\b'; break;
+      case 'f': p->src[out++] = '\f'; break;
+      case 'n': p->src[out++] = '\n'; break;
+      case 'r': p->src[out++] = '\r'; break;
+      case 't': p->src[out++] = '\t'; break;
+      case 'u': {
+        uint32_t cp = 0;
+        if (!parse_hex4(p, &cp)) {
+          p->err = "invalid string escape";
+          return NULL;
+        }
+        if (cp >= 0xD800 && cp <= 0xDBFF && p->pos + 6 <= p->len && p->src[p->pos] == '\\' &&
+            p->src[p->pos + 1] == 'u') {
+          size_t save = p->pos;
+          uint32_t lo = 0;
+          p->pos += 2;
+          if (parse_hex4(p, &lo) && lo >= 0xDC00 && lo <= 0xDFFF) {
+            cp = 0x10000 + (((cp - 0xD800) << 10) | (lo - 0xDC00));
+          } else {
+            p->pos = save;
           }
-          break;
-        default:
-          ENSURE_CAP(1);
-          buf[out++] = e;
-          break;
+        }
+        out += put_utf8(p->src + out, cp);
+        break;
       }
-    } else {
-      ENSURE_CAP(1);
-      buf[out++] = c;
+      default:
+        p->src[out++] = e;
+        break;
     }
   }
-  buf[out] = '\0';
-#undef ENSURE_CAP
-  return buf;
+  p->err = "invalid string";
+  return NULL;
 }
 
-static PS_JsonValue *make_value(PS_JsonType t) {
-  PS_JsonValue *v = (PS_JsonValue *)calloc(1, sizeof(PS_JsonValue));
+static PS_JsonValue *make_value(PS_JsonParser *p, PS_JsonType t) {
+  PS_JsonValue *v = (PS_JsonValue *)arena_alloc(p->arena, sizeof(PS_JsonValue));
   if (!v) return NULL;
+  memset(v, 0, sizeof(*v));
   v->type = t;
   return v;
 }
 
+static uint32_t key_hash(const char *s) {
+  uint32_t h = 2166136261u;
+  while (*s) {
+    h ^= (unsigned char)*s++;
+    h *= 16777619u;
+  }
+  return h;
+}
+
+static int build_index(PS_JsonParser *p, PS_JsonValue *obj) {
+  size_t n = obj->as.object_v.len;
+  size_t cap = 16;
+  while (cap < n * 2) cap *= 2;
+  uint32_t *slots = (uint32_t *)arena_alloc(p->arena, sizeof(uint32_t) * cap);
+  if (!slots) return 0;
+  memset(slots, 0, sizeof(uint32_t) * cap);
+  for (size_t i = 0; i < n; i++) {
+    const char *key = obj->as.object_v.keys[i];
+    size_t s = key_hash(key) & (cap - 1);
+    while (slots[s] && strcmp(obj->as.object_v.keys[slots[s] - 1], key) != 0) s = (s + 1) & (cap - 1);
+    // Duplicate keys keep the first occurrence, like the linear lookup.
+    if (!slots[s]) slots[s] = (uint32_t)(i + 1);
+  }
+  obj->as.object_v.index = slots;
+  obj->as.object_v.index_cap = cap;
+  return 1;
+}
+
 static PS_JsonValue *parse_array(PS_JsonParser *p) {
   if (p->src[p->pos] != '[') return NULL;
   p->pos++;
   skip_ws(p);
-  PS_JsonValue *arr = make_value(PS_JSON_ARRAY);
+  PS_JsonValue *arr = make_value(p, PS_JSON_ARRAY);
   if (!arr) return NULL;
-  arr->as.array_v.items = NULL;
-  arr->as.array_v.len = 0;
   if (p->pos < p->len && p->src[p->pos] == ']') {
     p->pos++;
     return arr;
   }
+  size_t base = p->stack_len;
   while (p->pos < p->len) {
     skip_ws(p);
     PS_JsonValue *item = parse_value(p);
-    if (!item) break;
-    size_t n = arr->as.array_v.len + 1;
-    PS_JsonValue **items = (PS_JsonValue **)realloc(arr->as.array_v.items, sizeof(PS_JsonValue *) * n);
-    if (!items) {
-      ps_json_free(item);
-      break;
-    }
-    arr->as.array_v.items = items;
-    arr->as.array_v.items[arr->as.array_v.len++] = item;
+    if (!item || !stack_push(p, item)) break;
     skip_ws(p);
     if (p->pos < p->len && p->src[p->pos] == ',') {
       p->pos++;
@@ -137,11 +253,19 @@ static PS_JsonValue *parse_array(PS_JsonParser *p) {
     }
     if (p->pos < p->len && p->src[p->pos] == ']') {
       p->pos++;
+      size_t n = p->stack_len - base;
+      PS_JsonValue **items = (PS_JsonValue **)arena_alloc(p->arena, sizeof(PS_JsonValue *) * n);
+      if (!items) break;
+      memcpy(items, p->stack + base, sizeof(PS_JsonValue *) * n);
+      p->stack_len = base;
+      arr->as.array_v.items = items;
+      arr->as.array_v.len = n;
       return arr;
     }
+    break;
   }
-  p->err = "invalid array";
-  ps_json_free(arr);
+  p->stack_len = base;
+  if (!p->err) p->err = "invalid array";
   return NULL;
 }
 
@@ -149,44 +273,23 @@ static PS_JsonValue *parse_object(PS_JsonParser *p) {
   if (p->src[p->pos] != '{') return NULL;
   p->pos++;
   skip_ws(p);
-  PS_JsonValue *obj = make_value(PS_JSON_OBJECT);
+  PS_JsonValue *obj = make_value(p, PS_JSON_OBJECT);
   if (!obj) return NULL;
-  obj->as.object_v.keys = NULL;
-  obj->as.object_v.values = NULL;
-  obj->as.object_v.len = 0;
   if (p->pos < p->len && p->src[p->pos] == '}') {
     p->pos++;
     return obj;
   }
+  size_t base = p->stack_len;
   while (p->pos < p->len) {
     skip_ws(p);
-    char *key = parse_string(p);
+    char *key = parse_string(p, NULL);
     if (!key) break;
     skip_ws(p);
-    if (p->pos >= p->len || p->src[p->pos] != ':') {
-      free(key);
-      break;
-    }
+    if (p->pos >= p->len || p->src[p->pos] != ':') break;
     p->pos++;
     skip_ws(p);
     PS_JsonValue *val = parse_value(p);
-    if (!val) {
-      free(key);
-      break;
-    }
-    size_t n = obj->as.object_v.len + 1;
-    char **keys = (char **)realloc(obj->as.object_v.keys, sizeof(char *) * n);
-    PS_JsonValue **vals = (PS_JsonValue **)realloc(obj->as.object_v.values, sizeof(PS_JsonValue *) * n);
-    if (!keys || !vals) {
-      free(key);
-      ps_json_free(val);
-      break;
-    }
-    obj->as.object_v.keys = keys;
-    obj->as.object_v.values = vals;
-    obj->as.object_v.keys[obj->as.object_v.len] = key;
-    obj->as.object_v.values[obj->as.object_v.len] = val;
-    obj->as.object_v.len += 1;
+    if (!val || !stack_push(p, key) || !stack_push(p, val)) break;
     skip_ws(p);
     if (p->pos < p->len && p->src[p->pos] == ',') {
       p->pos++;
@@ -194,11 +297,25 @@ static PS_JsonValue *parse_object(PS_JsonParser *p) {
     }
     if (p->pos < p->len && p->src[p->pos] == '}') {
       p->pos++;
+      size_t n = (p->stack_len - base) / 2;
+      char **keys = (char **)arena_alloc(p->arena, sizeof(char *) * n);
+      PS_JsonValue **vals = (PS_JsonValue **)arena_alloc(p->arena, sizeof(PS_JsonValue *) * n);
+      if (!keys || !vals) break;
+      for (size_t i = 0; i < n; i++) {
+        keys[i] = (char *)p->stack[base + i * 2];
+        vals[i] = (PS_JsonValue *)p->stack[base + i * 2 + 1];
+      }
+      p->stack_len = base;
+      obj->as.object_v.keys = keys;
+      obj->as.object_v.values = vals;
+      obj->as.object_v.len = n;
+      if (n >= PS_JSON_INDEX_MIN && !build_index(p, obj)) break;
       return obj;
     }
+    break;
   }
-  p->err = "invalid object";
-  ps_json_free(obj);
+  p->stack_len = base;
+  if (!p->err) p->err = "invalid object";
   return NULL;
 }
 
@@ -212,17 +329,21 @@ static PS_JsonValue *parse_number(PS_JsonParser *p) {
   }
   if (p->pos < p->len && (p->src[p->pos] == 'e' || p->src[p->pos] == 'E')) {
     p->pos++;
-    if (p->src[p->pos] == '+' || p->src[p->pos] == '-') p->pos++;
+    if (p->pos < p->len && (p->src[p->pos] == '+' || p->src[p->pos] == '-')) p->pos++;
     while (p->pos < p->len && isdigit((unsigned char)p->src[p->pos])) p->pos++;
   }
   size_t n = p->pos - start;
-  char *tmp = (char *)malloc(n + 1);
-  if (!tmp) return NULL;
+  char small[64];
+  char *tmp = small;
+  if (n >= sizeof(small)) {
+    tmp = (char *)malloc(n + 1);
+    if (!tmp) return NULL;
+  }
   memcpy(tmp, p->src + start, n);
   tmp[n] = '\0';
   double v = strtod(tmp, NULL);
-  free(tmp);
-  PS_JsonValue *val = make_value(PS_JSON_NUMBER);
+  if (tmp != small) free(tmp);
+  PS_JsonValue *val = make_value(p, PS_JSON_NUMBER);
   if (!val) return NULL;
   val->as.num_v = v;
   return val;
@@ -233,72 +354,92 @@ static PS_JsonValue *parse_value(PS_JsonParser *p) {
   if (p->pos >= p->len) return NULL;
   char c = p->src[p->pos];
   if (c == '"') {
-    char *s = parse_string(p);
+    size_t n = 0;
+    char *s = parse_string(p, &n);
     if (!s) return NULL;
-    PS_JsonValue *v = make_value(PS_JSON_STRING);
-    if (!v) {
-      free(s);
-      return NULL;
-    }
+    PS_JsonValue *v = make_value(p, PS_JSON_STRING);
+    if (!v) return NULL;
     v->as.str_v = s;
+    v->str_len = n;
     return v;
   }
   if (c == '{') return parse_object(p);
   if (c == '[') return parse_array(p);
   if (match(p, "true")) {
-    PS_JsonValue *v = make_value(PS_JSON_BOOL);
+    PS_JsonValue *v = make_value(p, PS_JSON_BOOL);
     if (!v) return NULL;
     v->as.bool_v = 1;
     return v;
   }
   if (match(p, "false")) {
-    PS_JsonValue *v = make_value(PS_JSON_BOOL);
+    PS_JsonValue *v = make_value(p, PS_JSON_BOOL);
     if (!v) return NULL;
     v->as.bool_v = 0;
     return v;
   }
-  if (match(p, "null")) return make_value(PS_JSON_NULL);
+  if (match(p, "null")) return make_value(p, PS_JSON_NULL);
   if (c == '-' || isdigit((unsigned char)c)) return parse_number(p);
   return NULL;
 }
 
-PS_JsonValue *ps_json_parse(const char *src, size_t len, const char **err) {
-  PS_JsonParser p = {src, len, 0, NULL};
+static PS_JsonValue *parse_with_arena(PS_JsonArena *arena, char *src, size_t len, const char **err) {
+  PS_JsonParser p;
+  memset(&p, 0, sizeof(p));
+  p.src = src;
+  p.len = len;
+  p.arena = arena;
   PS_JsonValue *v = parse_value(&p);
+  free(p.stack);
   if (!v || p.err) {
     if (err) *err = p.err ? p.err : "invalid json";
-    ps_json_free(v);
+    arena_destroy(arena);
     return NULL;
   }
+  v->arena = arena;
   return v;
 }
 
+PS_JsonValue *ps_json_parse(const char *src, size_t len, const char **err) {
+  PS_JsonArena *arena = (PS_JsonArena *)calloc(1, sizeof(PS_JsonArena));
+  char *copy = (char *)malloc(len + 1);
+  if (!arena || !copy) {
+    free(arena);
+    free(copy);
+    if (err) *err = "out of memory";
+    return NULL;
+  }
+  if (len) memcpy(copy, src, len);
+  copy[len] = '\0';
+  arena->owned_src = copy;
+  return parse_with_arena(arena, copy, len, err);
+}
+
+PS_JsonValue *ps_json_parse_insitu(char *src, size_t len, const char **err) {
+  PS_JsonArena *arena = (PS_JsonArena *)calloc(1, sizeof(PS_JsonArena));
+  if (!arena) {
+    if (err) *err = "out of memory";
+    return NULL;
+  }
+  return parse_with_arena(arena, src, len, err);
+}
+
 void ps_json_free(PS_JsonValue *v) {
   if (!v) return;
-  switch (v->type) {
-    case PS_JSON_STRING:
-      free(v->as.str_v);
-      break;
-    case PS_JSON_ARRAY:
-      for (size_t i = 0; i < v->as.array_v.len; i++) ps_json_free(v->as.array_v.items[i]);
-      free(v->as.array_v.items);
-      break;
-    case PS_JSON_OBJECT:
-      for (size_t i = 0; i < v->as.object_v.len; i++) {
-        free(v->as.object_v.keys[i]);
-        ps_json_free(v->as.object_v.values[i]);
-      }
-      free(v->as.object_v.keys);
-      free(v->as.object_v.values);
-      break;
-    default:
-      break;
-  }
-  free(v);
+  arena_destroy(v->arena);
 }
 
 PS_JsonValue *ps_json_obj_get(PS_JsonValue *obj, const char *key) {
   if (!obj || obj->type != PS_JSON_OBJECT) return NULL;
+  if (obj->as.object_v.index) {
+    size_t mask = obj->as.object_v.index_cap - 1;
+    size_t s = key_hash(key) & mask;
+    while (obj->as.object_v.index[s]) {
+      uint32_t i = obj->as.object_v.index[s] - 1;
+      if (strcmp(obj->as.object_v.keys[i], key) == 0) return obj->as.object_v.values[i];
+      s = (s + 1) & mask;
+    }
+    return NULL;
+  }
   for (size_t i = 0; i < obj->as.object_v.len; i++) {
     if (strcmp(obj->as.object_v.keys[i], key) == 0) return obj->as.object_v.values[i];
   }
@@ -2,6 +2,7 @@
 #define PS_JSON_H
 
 #include <stddef.h>
+#include <stdint.h>
 
 typedef enum {
   PS_JSON_NULL,
@@ -13,6 +14,10 @@ typedef enum {
 } PS_JsonType;
 
 typedef struct PS_JsonValue PS_JsonValue;
+typedef struct PS_JsonArena PS_JsonArena;
+
+// Objects with at least this many keys get a hash index for ps_json_obj_get.
+#define PS_JSON_INDEX_MIN 8
 
 struct PS_JsonValue {
   PS_JsonType type;
@@ -28,11 +33,22 @@ struct PS_JsonValue {
       char **keys;
       PS_JsonValue **values;
       size_t len;
+      uint32_t *index; // open addressing, slot = key position + 1 (NULL below PS_JSON_INDEX_MIN)
+      size_t index_cap;
     } object_v;
   } as;
+  size_t str_len;      // byte length of str_v (strings only)
+  PS_JsonArena *arena; // set on the root only; owns every node and string of the tree
 };
 
+// Nodes and strings are bump-allocated in an arena owned by the returned root.
+// The source is copied once and strings are decoded in place inside that copy,
+// so the caller may free `src` right after the call.
 PS_JsonValue *ps_json_parse(const char *src, size_t len, const char **err);
+// Zero-copy variant: strings are decoded in place inside `src` and point into it.
+// `src` is modified and must outlive the returned tree.
+PS_JsonValue *ps_json_parse_insitu(char *src, size_t len, const char **err);
+// Releases the whole tree; only valid on a root returned by a parse function.
 void ps_json_free(PS_JsonValue *v);
 PS_JsonValue *ps_json_obj_get(PS_JsonValue *obj, const char *key);
 
@@ -9,20 +9,25 @@
 
 #include "ps_list.h"
 
-static int ensure_cap(PS_List *l, size_t need) {
+static int ensure_cap(PS_Context *ctx, PS_List *l, size_t need) {
   if (need <= l->cap) return 1;
   size_t new_cap = l->cap == 0 ? 8 : l->cap * 2;
   while (new_cap < need) new_cap *= 2;
+  size_t grow = sizeof(PS_Value *) * (new_cap - l->cap);
+  if (!ps_heap_reserve(ctx, grow)) return 0;
   PS_Value **n = (PS_Value **)realloc(l->items, sizeof(PS_Value *) * new_cap);
-  if (!n) return 0;
+  if (!n) {
+    ps_throw_diag(ctx, PS_ERR_OOM, "out of memory", "list allocation failed", "available memory");
+    return 0;
+  }
+  ps_heap_charge(ctx, PS_HEAP_LISTS, (int64_t)grow);
   l->items = n;
   l->cap = new_cap;
   return 1;
 }
 
 PS_Value *ps_list_new(PS_Context *ctx) {
-  (void)ctx;
-  PS_Value *v = ps_value_alloc(PS_V_LIST);
+  PS_Value *v = ps_value_alloc(ctx, PS_V_LIST);
   if (!v) return NULL;
   v->as.list_v.items = NULL;
   v->as.list_v.len = 0;
@@ -72,20 +77,23 @@ int ps_list_set_internal(PS_Context *ctx, PS_Value *list, size_t index, PS_Value
   return 1;
 }
 
-int ps_list_push_internal(PS_Context *ctx, PS_Value *list, PS_Value *value) {
+int ps_list_push_owned_internal(PS_Context *ctx, PS_Value *list, PS_Value *value) {
   if (!list || list->tag != PS_V_LIST) {
     ps_throw_diag(ctx, PS_ERR_TYPE, "invalid list push", "non-list value", "list");
     return 0;
   }
-  if (!ensure_cap(&list->as.list_v, list->as.list_v.len + 1)) {
-  ps_throw_diag(ctx, PS_ERR_OOM, "out of memory", "list allocation failed", "available memory");
-  return 0;
-}
-  list->as.list_v.items[list->as.list_v.len++] = ps_value_retain(value);
+  if (!ensure_cap(ctx, &list->as.list_v, list->as.list_v.len + 1)) return 0;
+  list->as.list_v.items[list->as.list_v.len++] = value;
   list->as.list_v.version += 1;
   return 1;
 }
 
+int ps_list_push_internal(PS_Context *ctx, PS_Value *list, PS_Value *value) {
+  if (!ps_list_push_owned_internal(ctx, list, value)) return 0;
+  ps_value_retain(value);
+  return 1;
+}
+
 const char *ps_list_type_name_internal(PS_Value *list) {
   if (!list || list->tag != PS_V_LIST) return NULL;
   return list->as.list_v.type_name;
@@ -94,13 +102,8 @@ const char *ps_list_type_name_internal(PS_Value *list) {
 int ps_list_set_type_name_internal(PS_Context *ctx, PS_Value *list, const char *name) {
   (void)ctx;
   if (!list || list->tag != PS_V_LIST) return 0;
-  if (list->as.list_v.type_name) {
-    free(list->as.list_v.type_name);
-    list->as.list_v.type_name = NULL;
-  }
-  if (name) {
-    list->as.list_v.type_name = strdup(name);
-    if (!list->as.list_v.type_name) return 0;
-  }
+  const char *interned = name ? ps_intern(name) : NULL;
+  if (name && !interned) return 0;
+  list->as.list_v.type_name = interned;
   return 1;
 }
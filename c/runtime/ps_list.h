@@ -8,6 +8,8 @@ size_t ps_list_len_internal(PS_Value *list);
 PS_Value *ps_list_get_internal(PS_Context *ctx, PS_Value *list, size_t index);
 int ps_list_set_internal(PS_Context *ctx, PS_Value *list, size_t index, PS_Value *value);
 int ps_list_push_internal(PS_Context *ctx, PS_Value *list, PS_Value *value);
+// Like ps_list_push_internal but takes over the caller's reference on success.
+int ps_list_push_owned_internal(PS_Context *ctx, PS_Value *list, PS_Value *value);
 const char *ps_list_type_name_internal(PS_Value *list);
 int ps_list_set_type_name_internal(PS_Context *ctx, PS_Value *list, const char *name);
 
@@ -23,6 +23,7 @@ static const char *value_type_name(PS_Value *v) {
     case PS_V_LIST: return "list";
     case PS_V_MAP: return "map";
     case PS_V_OBJECT: return "object";
+    case PS_V_JSON: return "object";
     case PS_V_VIEW: return "view";
     case PS_V_EXCEPTION: return "Exception";
     case PS_V_GROUP: return "group";
@@ -98,8 +99,16 @@ static size_t hash_value(PS_Value *v) {
       return (size_t)v->as.byte_v * 2654435761u;
     case PS_V_GLYPH:
       return (size_t)v->as.glyph_v * 2654435761u;
-    case PS_V_STRING:
-      return ps_utf8_glyph_len((const uint8_t *)v->as.string_v.ptr, v->as.string_v.len) ^ (size_t)v->as.string_v.len;
+    case PS_V_STRING: {
+      // FNV-1a over the bytes: keys of a map often share their length.
+      uint64_t h = 1469598103934665603ULL;
+      const unsigned char *p = (const unsigned char *)v->as.string_v.ptr;
+      for (size_t i = 0; i < v->as.string_v.len; i++) {
+        h ^= p[i];
+        h *= 1099511628211ULL;
+      }
+      return (size_t)h;
+    }
     default:
       return (size_t)(uintptr_t)v;
   }
@@ -125,10 +134,12 @@ static int value_equals(PS_Value *a, PS_Value *b) {
   }
 }
 
-static int ensure_cap(PS_Map *m, size_t need) {
+static int ensure_cap(PS_Context *ctx, PS_Map *m, size_t need) {
   if (m->cap >= need * 2) return 1;
   size_t new_cap = m->cap == 0 ? 8 : m->cap * 2;
   while (new_cap < need * 2) new_cap *= 2;
+  size_t grow = PS_MAP_SLOT_BYTES * (new_cap - m->cap);
+  if (!ps_heap_reserve(ctx, grow)) return 0;
   PS_Value **nkeys = (PS_Value **)calloc(new_cap, sizeof(PS_Value *));
   PS_Value **nvals = (PS_Value **)calloc(new_cap, sizeof(PS_Value *));
   uint8_t *nused = (uint8_t *)calloc(new_cap, sizeof(uint8_t));
@@ -136,8 +147,10 @@ static int ensure_cap(PS_Map *m, size_t need) {
     free(nkeys);
     free(nvals);
     free(nused);
+    ps_throw_diag(ctx, PS_ERR_OOM, "out of memory", "map allocation failed", "available memory");
     return 0;
   }
+  ps_heap_charge(ctx, PS_HEAP_MAPS, (int64_t)grow);
   for (size_t i = 0; i < m->cap; i++) {
     if (!m->used[i] || m->used[i] == 2) continue;
     PS_Value *k = m->keys[i];
@@ -158,20 +171,25 @@ static int ensure_cap(PS_Map *m, size_t need) {
   return 1;
 }
 
-static int ensure_order_cap(PS_Map *m, size_t need) {
+static int ensure_order_cap(PS_Context *ctx, PS_Map *m, size_t need) {
   if (m->order_cap >= need) return 1;
   size_t new_cap = m->order_cap == 0 ? 8 : m->order_cap * 2;
   while (new_cap < need) new_cap *= 2;
+  size_t grow = sizeof(PS_Value *) * (new_cap - m->order_cap);
+  if (!ps_heap_reserve(ctx, grow)) return 0;
   PS_Value **norder = (PS_Value **)realloc(m->order, sizeof(PS_Value *) * new_cap);
-  if (!norder) return 0;
+  if (!norder) {
+    ps_throw_diag(ctx, PS_ERR_OOM, "out of memory", "map allocation failed", "available memory");
+    return 0;
+  }
+  ps_heap_charge(ctx, PS_HEAP_MAPS, (int64_t)grow);
   m->order = norder;
   m->order_cap = new_cap;
   return 1;
 }
 
 PS_Value *ps_map_new(PS_Context *ctx) {
-  (void)ctx;
-  PS_Value *v = ps_value_alloc(PS_V_MAP);
+  PS_Value *v = ps_value_alloc(ctx, PS_V_MAP);
   if (!v) return NULL;
   v->as.map_v.keys = NULL;
   v->as.map_v.values = NULL;
@@ -241,10 +259,7 @@ int ps_map_set(PS_Context *ctx, PS_Value *map, PS_Value *key, PS_Value *value) {
     return 0;
   }
   PS_Map *m = &map->as.map_v;
-  if (!ensure_cap(m, m->len + 1)) {
-    ps_throw_diag(ctx, PS_ERR_OOM, "out of memory", "map allocation failed", "available memory");
-    return 0;
-  }
+  if (!ensure_cap(ctx, m, m->len + 1)) return 0;
   size_t h = hash_value(key);
   size_t idx = h & (m->cap - 1);
   size_t tomb = (size_t)-1;
@@ -261,10 +276,7 @@ int ps_map_set(PS_Context *ctx, PS_Value *map, PS_Value *key, PS_Value *value) {
   m->used[idx] = 1;
   m->keys[idx] = ps_value_retain(key);
   m->values[idx] = ps_value_retain(value);
-  if (!ensure_order_cap(m, m->order_len + 1)) {
-    ps_throw_diag(ctx, PS_ERR_OOM, "out of memory", "map allocation failed", "available memory");
-    return 0;
-  }
+  if (!ensure_order_cap(ctx, m, m->order_len + 1)) return 0;
   m->order[m->order_len++] = m->keys[idx];
   m->len += 1;
   return 1;
@@ -344,13 +356,8 @@ const char *ps_map_type_name_internal(PS_Value *map) {
 int ps_map_set_type_name_internal(PS_Context *ctx, PS_Value *map, const char *name) {
   (void)ctx;
   if (!map || map->tag != PS_V_MAP) return 0;
-  if (map->as.map_v.type_name) {
-    free(map->as.map_v.type_name);
-    map->as.map_v.type_name = NULL;
-  }
-  if (name) {
-    map->as.map_v.type_name = strdup(name);
-    if (!map->as.map_v.type_name) return 0;
-  }
+  const char *interned = name ? ps_intern(name) : NULL;
+  if (name && !interned) return 0;
+  map->as.map_v.type_name = interned;
   return 1;
 }
@@ -7,6 +7,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
 #include "ps_modules.h"
 #include "ps_errors.h"
@@ -104,8 +105,7 @@ static PS_Status try_load_from_dir(PS_Context *ctx, const char *module_name, con
   return PS_OK;
 }
 
-PS_Status ps_module_load(PS_Context *ctx, const char *module_name) {
-  if (module_record_exists(ctx, module_name)) return PS_OK;
+static PS_Status module_load(PS_Context *ctx, const char *module_name) {
 #ifdef PS_WASM
   PS_Status (*init_fn)(PS_Context *, PS_Module *) = NULL;
   if (strcmp(module_name, "Debug") == 0) init_fn = ps_module_init_Debug;
@@ -191,6 +191,17 @@ PS_Status ps_module_load(PS_Context *ctx, const char *module_name) {
 #endif
 }
 
+PS_Status ps_module_load(PS_Context *ctx, const char *module_name) {
+  if (module_record_exists(ctx, module_name)) return PS_OK;
+  struct timespec t0, t1;
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+  PS_Status st = module_load(ctx, module_name);
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+  ctx->module_load_ns += (uint64_t)((t1.tv_sec - t0.tv_sec) * 1000000000ll + (t1.tv_nsec - t0.tv_nsec));
+  if (st == PS_OK) ctx->modules_loaded += 1;
+  return st;
+}
+
 const PS_NativeFnDesc *ps_module_find_fn(PS_Context *ctx, const char *module_name, const char *fn_name) {
   if (!module_name || !fn_name) return NULL;
   if (ps_module_load(ctx, module_name) != PS_OK) return NULL;
@@ -204,3 +215,53 @@ const PS_NativeFnDesc *ps_module_find_fn(PS_Context *ctx, const char *module_nam
   ps_throw_diag(ctx, PS_ERR_IMPORT, "symbol not found", "module or symbol", "available module/symbol");
   return NULL;
 }
+
+PS_Status ps_ctx_set_module_data(PS_Context *ctx, const char *key, void *data, PS_ModuleDataFreeFn free_fn) {
+  if (!ctx || !key) return PS_ERR;
+  for (size_t i = 0; i < ctx->module_data_len; i++) {
+    if (strcmp(ctx->module_data[i].key, key) == 0) {
+      ctx->module_data[i].data = data;
+      ctx->module_data[i].free_fn = free_fn;
+      return PS_OK;
+    }
+  }
+  if (ctx->module_data_len == ctx->module_data_cap) {
+    size_t new_cap = ctx->module_data_cap == 0 ? 4 : ctx->module_data_cap * 2;
+    PS_ModuleData *n = (PS_ModuleData *)realloc(ctx->module_data, sizeof(PS_ModuleData) * new_cap);
+    if (!n) {
+      ps_throw_diag(ctx, PS_ERR_OOM, "out of memory", "module data allocation failed", "available memory");
+      return PS_ERR;
+    }
+    ctx->module_data = n;
+    ctx->module_data_cap = new_cap;
+  }
+  char *k = strdup(key);
+  if (!k) {
+    ps_throw_diag(ctx, PS_ERR_OOM, "out of memory", "module data allocation failed", "available memory");
+    return PS_ERR;
+  }
+  ctx->module_data[ctx->module_data_len].key = k;
+  ctx->module_data[ctx->module_data_len].data = data;
+  ctx->module_data[ctx->module_data_len].free_fn = free_fn;
+  ctx->module_data_len += 1;
+  return PS_OK;
+}
+
+void *ps_ctx_get_module_data(PS_Context *ctx, const char *key) {
+  if (!ctx || !key) return NULL;
+  for (size_t i = 0; i < ctx->module_data_len; i++) {
+    if (strcmp(ctx->module_data[i].key, key) == 0) return ctx->module_data[i].data;
+  }
+  return NULL;
+}
+
+void ps_module_data_free(PS_Context *ctx) {
+  for (size_t i = 0; i < ctx->module_data_len; i++) {
+    if (ctx->module_data[i].free_fn && ctx->module_data[i].data) ctx->module_data[i].free_fn(ctx->module_data[i].data);
+    free(ctx->module_data[i].key);
+  }
+  free(ctx->module_data);
+  ctx->module_data = NULL;
+  ctx->module_data_len = 0;
+  ctx->module_data_cap = 0;
+}
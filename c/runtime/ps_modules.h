@@ -9,7 +9,15 @@ typedef struct PS_ModuleRecord {
   PS_DynLib *lib;
 } PS_ModuleRecord;
 
+typedef struct PS_ModuleData {
+  char *key;
+  void *data;
+  PS_ModuleDataFreeFn free_fn;
+} PS_ModuleData;
+
 PS_Status ps_module_load(PS_Context *ctx, const char *module_name);
 const PS_NativeFnDesc *ps_module_find_fn(PS_Context *ctx, const char *module_name, const char *fn_name);
+// Runs the free callbacks of the module data of a context (ps_ctx_destroy).
+void ps_module_data_free(PS_Context *ctx);
 
 #endif // PS_MODULES_H
@@ -24,6 +24,7 @@ static const char *value_type_name(PS_Value *v) {
     case PS_V_LIST: return "list";
     case PS_V_MAP: return "map";
     case PS_V_OBJECT: return "object";
+    case PS_V_JSON: return "object";
     case PS_V_VIEW: return "view";
     case PS_V_EXCEPTION: return "Exception";
     case PS_V_GROUP: return "group";
@@ -40,10 +41,12 @@ static uint64_t hash_bytes(const char *s, size_t len) {
   return h;
 }
 
-static int ensure_cap(PS_Object *o, size_t need) {
+static int ensure_cap(PS_Context *ctx, PS_Object *o, size_t need) {
   if (o->cap >= need) return 1;
   size_t new_cap = o->cap == 0 ? 8 : o->cap * 2;
   while (new_cap < need * 2) new_cap *= 2;
+  size_t grow = PS_OBJECT_SLOT_BYTES * (new_cap - o->cap);
+  if (!ps_heap_reserve(ctx, grow)) return 0;
   PS_String *nkeys = (PS_String *)calloc(new_cap, sizeof(PS_String));
   PS_Value **nvals = (PS_Value **)calloc(new_cap, sizeof(PS_Value *));
   uint8_t *nused = (uint8_t *)calloc(new_cap, sizeof(uint8_t));
@@ -51,8 +54,10 @@ static int ensure_cap(PS_Object *o, size_t need) {
     free(nkeys);
     free(nvals);
     free(nused);
+    ps_throw_diag(ctx, PS_ERR_OOM, "out of memory", "object allocation failed", "available memory");
     return 0;
   }
+  ps_heap_charge(ctx, PS_HEAP_OBJECTS, (int64_t)grow);
   for (size_t i = 0; i < o->cap; i++) {
     if (!o->used[i]) continue;
     PS_String k = o->keys[i];
@@ -74,8 +79,7 @@ static int ensure_cap(PS_Object *o, size_t need) {
 }
 
 PS_Value *ps_object_new(PS_Context *ctx) {
-  (void)ctx;
-  PS_Value *v = ps_value_alloc(PS_V_OBJECT);
+  PS_Value *v = ps_value_alloc(ctx, PS_V_OBJECT);
   if (!v) return NULL;
   v->as.object_v.keys = NULL;
   v->as.object_v.values = NULL;
@@ -114,10 +118,7 @@ int ps_object_set_str_internal(PS_Context *ctx, PS_Value *obj, const char *key,
     return 0;
   }
   PS_Object *o = &obj->as.object_v;
-  if (!ensure_cap(o, o->len + 1)) {
-    ps_throw_diag(ctx, PS_ERR_OOM, "out of memory", "object allocation failed", "available memory");
-    return 0;
-  }
+  if (!ensure_cap(ctx, o, o->len + 1)) return 0;
   uint64_t h = hash_bytes(key, key_len);
   size_t idx = (size_t)h & (o->cap - 1);
   while (o->used[idx]) {
@@ -129,12 +130,14 @@ int ps_object_set_str_internal(PS_Context *ctx, PS_Value *obj, const char *key,
     }
     idx = (idx + 1) & (o->cap - 1);
   }
+  if (!ps_heap_reserve(ctx, key_len + 1)) return 0;
   o->used[idx] = 1;
   o->keys[idx].ptr = (char *)malloc(key_len + 1);
   if (!o->keys[idx].ptr && key_len > 0) {
     ps_throw_diag(ctx, PS_ERR_OOM, "out of memory", "object key allocation failed", "available memory");
     return 0;
   }
+  ps_heap_charge(ctx, PS_HEAP_OBJECTS, (int64_t)(key_len + 1));
   memcpy(o->keys[idx].ptr, key, key_len);
   o->keys[idx].ptr[key_len] = '\0';
   o->keys[idx].len = key_len;
@@ -195,13 +198,8 @@ const char *ps_object_proto_name_internal(PS_Value *obj) {
 int ps_object_set_proto_name_internal(PS_Context *ctx, PS_Value *obj, const char *name) {
   (void)ctx;
   if (!obj || obj->tag != PS_V_OBJECT) return 0;
-  if (obj->as.object_v.proto_name) {
-    free(obj->as.object_v.proto_name);
-    obj->as.object_v.proto_name = NULL;
-  }
-  if (name) {
-    obj->as.object_v.proto_name = strdup(name);
-    if (!obj->as.object_v.proto_name) return 0;
-  }
+  const char *interned = name ? ps_intern(name) : NULL;
+  if (name && !interned) return 0;
+  obj->as.object_v.proto_name = interned;
   return 1;
 }
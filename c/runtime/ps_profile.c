@@ -0,0 +1,1079 @@
+#ifndef _POSIX_C_SOURCE
+#define _POSIX_C_SOURCE 200809L
+#endif
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <errno.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <time.h>
+
+#include "ps_profile.h"
+#include "ps_runtime.h"
+
+#define PS_PROFILE_MAX_OPS 128
+#define PS_PROFILE_TEXT_ROWS 20
+
+typedef struct {
+  char *name;
+  uint64_t hash;
+  uint64_t count;
+  uint64_t incl_ns;
+  uint64_t excl_ns;
+  uint32_t active; // activations currently on the profiler stack
+} PS_ProfileEntry;
+
+// Name -> entry table (open addressing, slot = entry position + 1).
+typedef struct {
+  PS_ProfileEntry *items;
+  size_t len;
+  size_t cap;
+  uint32_t *index;
+  size_t index_cap;
+} PS_ProfileTable;
+
+typedef struct {
+  size_t fn;
+  uint64_t start_ns;
+  uint64_t child_ns;
+} PS_ProfileFrame;
+
+struct PS_Profile {
+  uint64_t start_ns;
+  uint64_t op_total;
+  uint64_t ops[PS_PROFILE_MAX_OPS];
+  const char *op_names[PS_PROFILE_MAX_OPS];
+  PS_ProfileTable fns;
+  PS_ProfileTable builtins;
+  PS_ProfileTable sites;
+  PS_ProfileFrame *stack;
+  size_t depth;
+  size_t stack_cap;
+  // Calls entered without a frame (out of memory), innermost on top: their
+  // leaves pop nothing, and calls nested in them are not recorded.
+  size_t skipped;
+  // Allocation attribution: values allocated since `alloc_mark` belong to the
+  // current site (entry position + 1, 0 before the first located instruction).
+  uint64_t alloc_mark;
+  size_t site;
+  const char *site_file;
+  int site_line;
+};
+
+static uint64_t now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static uint64_t hash_name(const char *s) {
+  uint64_t h = 1469598103934665603ull;
+  for (; *s; s++) {
+    h ^= (unsigned char)*s;
+    h *= 1099511628211ull;
+  }
+  return h;
+}
+
+static int table_grow_index(PS_ProfileTable *t) {
+  size_t cap = t->index_cap ? t->index_cap * 2 : 64;
+  uint32_t *index = (uint32_t *)calloc(cap, sizeof(uint32_t));
+  if (!index) return 0;
+  for (size_t i = 0; i < t->len; i++) {
+    size_t slot = (size_t)t->items[i].hash & (cap - 1);
+    while (index[slot]) slot = (slot + 1) & (cap - 1);
+    index[slot] = (uint32_t)(i + 1);
+  }
+  free(t->index);
+  t->index = index;
+  t->index_cap = cap;
+  return 1;
+}
+
+// Returns the entry position + 1, creating the entry on first use (0 on OOM).
+static size_t table_intern(PS_ProfileTable *t, const char *name) {
+  uint64_t h = hash_name(name);
+  if (t->index_cap) {
+    size_t slot = (size_t)h & (t->index_cap - 1);
+    while (t->index[slot]) {
+      PS_ProfileEntry *e = &t->items[t->index[slot] - 1];
+      if (e->hash == h && strcmp(e->name, name) == 0) return t->index[slot];
+      slot = (slot + 1) & (t->index_cap - 1);
+    }
+  }
+  if ((t->len + 1) * 2 > t->index_cap && !table_grow_index(t)) return 0;
+  if (t->len == t->cap) {
+    size_t cap = t->cap ? t->cap * 2 : 32;
+    PS_ProfileEntry *items = (PS_ProfileEntry *)realloc(t->items, cap * sizeof(PS_ProfileEntry));
+    if (!items) return 0;
+    t->items = items;
+    t->cap = cap;
+  }
+  char *copy = strdup(name);
+  if (!copy) return 0;
+  PS_ProfileEntry *e = &t->items[t->len];
+  memset(e, 0, sizeof(*e));
+  e->name = copy;
+  e->hash = h;
+  t->len += 1;
+  size_t slot = (size_t)h & (t->index_cap - 1);
+  while (t->index[slot]) slot = (slot + 1) & (t->index_cap - 1);
+  t->index[slot] = (uint32_t)t->len;
+  return t->len;
+}
+
+static void table_free(PS_ProfileTable *t) {
+  for (size_t i = 0; i < t->len; i++) free(t->items[i].name);
+  free(t->items);
+  free(t->index);
+  memset(t, 0, sizeof(*t));
+}
+
+PS_Profile *ps_profile_create(void) {
+  PS_Profile *p = (PS_Profile *)calloc(1, sizeof(PS_Profile));
+  if (!p) return NULL;
+  p->start_ns = now_ns();
+  p->alloc_mark = ps_value_alloc_total();
+  return p;
+}
+
+void ps_profile_destroy(PS_Profile *p) {
+  if (!p) return;
+  table_free(&p->fns);
+  table_free(&p->builtins);
+  table_free(&p->sites);
+  free(p->stack);
+  free(p);
+}
+
+void ps_profile_op(PS_Profile *p, int op, const char *op_name) {
+  p->op_total += 1;
+  if (op < 0 || op >= PS_PROFILE_MAX_OPS) return;
+  p->ops[op] += 1;
+  p->op_names[op] = op_name;
+}
+
+static void flush_allocs(PS_Profile *p) {
+  uint64_t total = ps_value_alloc_total();
+  if (total == p->alloc_mark) return;
+  if (p->site) p->sites.items[p->site - 1].count += total - p->alloc_mark;
+  p->alloc_mark = total;
+}
+
+void ps_profile_site(PS_Profile *p, const char *file, int line) {
+  flush_allocs(p);
+  if (file == p->site_file && line == p->site_line && p->site) return;
+  char key[512];
+  snprintf(key, sizeof(key), "%s:%d", file ? file : "<unknown>", line);
+  p->site = table_intern(&p->sites, key);
+  p->site_file = file;
+  p->site_line = line;
+}
+
+void ps_profile_builtin(PS_Profile *p, const char *owner, const char *name) {
+  char key[256];
+  snprintf(key, sizeof(key), "%s.%s", owner ? owner : "?", name ? name : "?");
+  size_t e = table_intern(&p->builtins, key);
+  if (e) p->builtins.items[e - 1].count += 1;
+}
+
+void ps_profile_enter(PS_Profile *p, const char *fn) {
+  if (p->skipped) {
+    p->skipped += 1;
+    return;
+  }
+  size_t e = table_intern(&p->fns, fn ? fn : "<anonymous>");
+  if (!e) {
+    p->skipped = 1;
+    return;
+  }
+  if (p->depth == p->stack_cap) {
+    size_t cap = p->stack_cap ? p->stack_cap * 2 : 64;
+    PS_ProfileFrame *stack = (PS_ProfileFrame *)realloc(p->stack, cap * sizeof(PS_ProfileFrame));
+    if (!stack) {
+      p->skipped = 1;
+      return;
+    }
+    p->stack = stack;
+    p->stack_cap = cap;
+  }
+  PS_ProfileEntry *en = &p->fns.items[e - 1];
+  en->count += 1;
+  en->active += 1;
+  PS_ProfileFrame *fr = &p->stack[p->depth++];
+  fr->fn = e - 1;
+  fr->start_ns = now_ns();
+  fr->child_ns = 0;
+}
+
+void ps_profile_leave(PS_Profile *p) {
+  if (p->skipped) {
+    p->skipped -= 1;
+    return;
+  }
+  if (p->depth == 0) return;
+  PS_ProfileFrame *fr = &p->stack[--p->depth];
+  uint64_t elapsed = now_ns() - fr->start_ns;
+  PS_ProfileEntry *en = &p->fns.items[fr->fn];
+  en->excl_ns += elapsed > fr->child_ns ? elapsed - fr->child_ns : 0;
+  if (en->active == 1) en->incl_ns += elapsed;
+  en->active -= 1;
+  if (p->depth > 0) p->stack[p->depth - 1].child_ns += elapsed;
+}
+
+typedef struct {
+  const char *name;
+  uint64_t count;
+  uint64_t incl_ns;
+  uint64_t excl_ns;
+} PS_ProfileRow;
+
+static int row_by_time(const void *a, const void *b) {
+  const PS_ProfileRow *x = (const PS_ProfileRow *)a;
+  const PS_ProfileRow *y = (const PS_ProfileRow *)b;
+  if (x->excl_ns != y->excl_ns) return x->excl_ns < y->excl_ns ? 1 : -1;
+  if (x->count != y->count) return x->count < y->count ? 1 : -1;
+  return strcmp(x->name, y->name);
+}
+
+static int row_by_count(const void *a, const void *b) {
+  const PS_ProfileRow *x = (const PS_ProfileRow *)a;
+  const PS_ProfileRow *y = (const PS_ProfileRow *)b;
+  if (x->count != y->count) return x->count < y->count ? 1 : -1;
+  return strcmp(x->name, y->name);
+}
+
+static PS_ProfileRow *table_rows(const PS_ProfileTable *t, int by_time, size_t *out_len) {
+  *out_len = 0;
+  PS_ProfileRow *rows = (PS_ProfileRow *)calloc(t->len ? t->len : 1, sizeof(PS_ProfileRow));
+  if (!rows) return NULL;
+  size_t n = 0;
+  for (size_t i = 0; i < t->len; i++) {
+    if (!t->items[i].count) continue;
+    rows[n].name = t->items[i].name;
+    rows[n].count = t->items[i].count;
+    rows[n].incl_ns = t->items[i].incl_ns;
+    rows[n].excl_ns = t->items[i].excl_ns;
+    n++;
+  }
+  qsort(rows, n, sizeof(PS_ProfileRow), by_time ? row_by_time : row_by_count);
+  *out_len = n;
+  return rows;
+}
+
+static PS_ProfileRow *op_rows(const PS_Profile *p, size_t *out_len) {
+  *out_len = 0;
+  PS_ProfileRow *rows = (PS_ProfileRow *)calloc(PS_PROFILE_MAX_OPS, sizeof(PS_ProfileRow));
+  if (!rows) return NULL;
+  size_t n = 0;
+  for (size_t i = 0; i < PS_PROFILE_MAX_OPS; i++) {
+    if (!p->ops[i]) continue;
+    rows[n].name = p->op_names[i] ? p->op_names[i] : "unknown";
+    rows[n].count = p->ops[i];
+    n++;
+  }
+  qsort(rows, n, sizeof(PS_ProfileRow), row_by_count);
+  *out_len = n;
+  return rows;
+}
+
+static double ms(uint64_t ns) {
+  return (double)ns / 1e6;
+}
+
+static void report_counts(FILE *out, const char *title, PS_ProfileRow *rows, size_t n) {
+  fprintf(out, "%s:\n", title);
+  if (n == 0) fprintf(out, "  (none)\n");
+  for (size_t i = 0; i < n && i < PS_PROFILE_TEXT_ROWS; i++) {
+    fprintf(out, "  %12llu  %s\n", (unsigned long long)rows[i].count, rows[i].name);
+  }
+  if (n > PS_PROFILE_TEXT_ROWS) fprintf(out, "  ... %zu more\n", n - PS_PROFILE_TEXT_ROWS);
+}
+
+void ps_profile_report(PS_Profile *p, FILE *out) {
+  if (!p || !out) return;
+  flush_allocs(p);
+  size_t fn_n = 0, op_n = 0, bi_n = 0, site_n = 0;
+  PS_ProfileRow *fns = table_rows(&p->fns, 1, &fn_n);
+  PS_ProfileRow *ops = op_rows(p, &op_n);
+  PS_ProfileRow *bis = table_rows(&p->builtins, 0, &bi_n);
+  PS_ProfileRow *sites = table_rows(&p->sites, 0, &site_n);
+  uint64_t allocs = 0;
+  for (size_t i = 0; i < site_n; i++) allocs += sites[i].count;
+  fprintf(out, "profile: %.2f ms, %llu instructions, %llu allocations\n", ms(now_ns() - p->start_ns),
+          (unsigned long long)p->op_total, (unsigned long long)allocs);
+  fprintf(out, "functions (by exclusive time):\n");
+  fprintf(out, "  %12s  %12s  %12s  %s\n", "calls", "incl ms", "excl ms", "function");
+  if (fn_n == 0) fprintf(out, "  (none)\n");
+  for (size_t i = 0; fns && i < fn_n && i < PS_PROFILE_TEXT_ROWS; i++) {
+    fprintf(out, "  %12llu  %12.3f  %12.3f  %s\n", (unsigned long long)fns[i].count, ms(fns[i].incl_ns),
+            ms(fns[i].excl_ns), fns[i].name);
+  }
+  if (fn_n > PS_PROFILE_TEXT_ROWS) fprintf(out, "  ... %zu more\n", fn_n - PS_PROFILE_TEXT_ROWS);
+  if (ops) report_counts(out, "opcodes", ops, op_n);
+  if (bis) report_counts(out, "builtin calls", bis, bi_n);
+  if (sites) report_counts(out, "allocation sites", sites, site_n);
+  free(fns);
+  free(ops);
+  free(bis);
+  free(sites);
+}
+
+static void json_string(FILE *out, const char *s) {
+  fputc('"', out);
+  for (const unsigned char *c = (const unsigned char *)s; *c; c++) {
+    if (*c == '"' || *c == '\\') fprintf(out, "\\%c", *c);
+    else if (*c < 0x20) fprintf(out, "\\u%04x", *c);
+    else fputc(*c, out);
+  }
+  fputc('"', out);
+}
+
+static void json_counts(FILE *out, const char *key, const char *count_key, PS_ProfileRow *rows, size_t n) {
+  fprintf(out, ",\"%s\":[", key);
+  for (size_t i = 0; rows && i < n; i++) {
+    fprintf(out, "%s{\"name\":", i ? "," : "");
+    json_string(out, rows[i].name);
+    fprintf(out, ",\"%s\":%llu}", count_key, (unsigned long long)rows[i].count);
+  }
+  fputc(']', out);
+}
+
+void ps_profile_write_json(PS_Profile *p, FILE *out) {
+  if (!p || !out) return;
+  flush_allocs(p);
+  size_t fn_n = 0, op_n = 0, bi_n = 0, site_n = 0;
+  PS_ProfileRow *fns = table_rows(&p->fns, 1, &fn_n);
+  PS_ProfileRow *ops = op_rows(p, &op_n);
+  PS_ProfileRow *bis = table_rows(&p->builtins, 0, &bi_n);
+  PS_ProfileRow *sites = table_rows(&p->sites, 0, &site_n);
+  fprintf(out, "{\"total_ms\":%.3f,\"instructions\":%llu,\"functions\":[", ms(now_ns() - p->start_ns),
+          (unsigned long long)p->op_total);
+  for (size_t i = 0; fns && i < fn_n; i++) {
+    fprintf(out, "%s{\"name\":", i ? "," : "");
+    json_string(out, fns[i].name);
+    fprintf(out, ",\"calls\":%llu,\"inclusive_ms\":%.3f,\"exclusive_ms\":%.3f}", (unsigned long long)fns[i].count,
+            ms(fns[i].incl_ns), ms(fns[i].excl_ns));
+  }
+  fputc(']', out);
+  json_counts(out, "opcodes", "count", ops, op_n);
+  json_counts(out, "builtins", "calls", bis, bi_n);
+  json_counts(out, "allocations", "count", sites, site_n);
+  fprintf(out, "}\n");
+  free(fns);
+  free(ops);
+  free(bis);
+  free(sites);
+}
+
+// ---- Sampling profiler ----
+
+#define PS_SAMPLE_INTERVAL_US 1000
+#define PS_SAMPLE_STACK_MAX 4096 // shadow stack frames (deeper frames are not recorded)
+#define PS_SAMPLE_FRAMES 64      // frames kept per sample: the outermost ones and the leaf
+#define PS_SAMPLE_RING 512       // power of two
+
+typedef struct {
+  uint64_t ts_ns;
+  uint32_t depth;
+  uint32_t truncated; // frames were dropped between frames[depth - 2] and the leaf
+  PS_SampleFrame frames[PS_SAMPLE_FRAMES];
+} PS_SampleRecord;
+
+// Call tree node. fn_key/file_key point into the IR module and are only
+// compared while it is loaded; fn and label are owned copies.
+typedef struct {
+  size_t parent; // node position + 1, 0 for a root frame
+  const char *fn_key;
+  const char *file_key;
+  int line;
+  uint64_t hash;
+  char *fn;
+  char *label;
+  uint64_t self; // samples whose leaf is this node
+} PS_SampleNode;
+
+typedef struct {
+  uint64_t ts_ns;
+  size_t node;
+} PS_SamplePoint;
+
+struct PS_Sampler {
+  PS_SampleFrame *stack;
+  volatile size_t depth;
+  PS_SampleRecord *ring;
+  atomic_size_t head; // advanced by the signal handler only
+  atomic_size_t tail; // advanced by sampler_drain only
+  atomic_ulong dropped;
+  uint64_t start_ns;
+  int running;
+  struct sigaction old_action;
+  PS_SampleNode *nodes;
+  size_t node_len;
+  size_t node_cap;
+  uint32_t *index; // open addressing, slot = node position + 1
+  size_t index_cap;
+  PS_SamplePoint *samples;
+  size_t sample_len;
+  size_t sample_cap;
+};
+
+// SIGPROF handlers cannot take a context argument.
+static PS_Sampler *volatile g_sampler = NULL;
+
+PS_Sampler *ps_sampler_create(void) {
+  PS_Sampler *s = (PS_Sampler *)calloc(1, sizeof(PS_Sampler));
+  if (!s) return NULL;
+  s->stack = (PS_SampleFrame *)calloc(PS_SAMPLE_STACK_MAX, sizeof(PS_SampleFrame));
+  s->ring = (PS_SampleRecord *)calloc(PS_SAMPLE_RING, sizeof(PS_SampleRecord));
+  if (!s->stack || !s->ring) {
+    free(s->stack);
+    free(s->ring);
+    free(s);
+    return NULL;
+  }
+  atomic_init(&s->head, 0);
+  atomic_init(&s->tail, 0);
+  atomic_init(&s->dropped, 0);
+  s->start_ns = now_ns();
+  return s;
+}
+
+void ps_sampler_destroy(PS_Sampler *s) {
+  if (!s) return;
+  ps_sampler_stop(s);
+  for (size_t i = 0; i < s->node_len; i++) {
+    free(s->nodes[i].fn);
+    free(s->nodes[i].label);
+  }
+  free(s->nodes);
+  free(s->index);
+  free(s->samples);
+  free(s->ring);
+  free(s->stack);
+  free(s);
+}
+
+// Async-signal-safe: only reads the shadow stack and fills a free ring slot.
+static void sampler_on_sigprof(int sig) {
+  (void)sig;
+  PS_Sampler *s = g_sampler;
+  if (!s) return;
+  int saved_errno = errno;
+  size_t head = atomic_load_explicit(&s->head, memory_order_relaxed);
+  size_t tail = atomic_load_explicit(&s->tail, memory_order_acquire);
+  if (head - tail >= PS_SAMPLE_RING) {
+    atomic_fetch_add_explicit(&s->dropped, 1, memory_order_relaxed);
+    errno = saved_errno;
+    return;
+  }
+  PS_SampleRecord *r = &s->ring[head & (PS_SAMPLE_RING - 1)];
+  size_t depth = s->depth;
+  size_t avail = depth < PS_SAMPLE_STACK_MAX ? depth : PS_SAMPLE_STACK_MAX;
+  size_t n = avail < PS_SAMPLE_FRAMES ? avail : PS_SAMPLE_FRAMES;
+  for (size_t i = 0; i + 1 < n; i++) r->frames[i] = s->stack[i];
+  if (n > 0) r->frames[n - 1] = s->stack[avail - 1];
+  r->depth = (uint32_t)n;
+  r->truncated = depth > n;
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  r->ts_ns = (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+  atomic_store_explicit(&s->head, head + 1, memory_order_release);
+  errno = saved_errno;
+}
+
+static uint64_t hash_frame(size_t parent, const char *fn, const char *file, int line) {
+  uint64_t h = (fn ? hash_name(fn) : 0) ^ ((file ? hash_name(file) : 0) * 31);
+  uint64_t parts[2] = {(uint64_t)parent, (uint64_t)(uint32_t)line};
+  for (size_t i = 0; i < 2; i++) {
+    h ^= parts[i];
+    h *= 1099511628211ull;
+    h ^= h >> 29;
+  }
+  return h;
+}
+
+static int same_name(const char *a, const char *b) {
+  if (a == b) return 1;
+  return a && b && strcmp(a, b) == 0;
+}
+
+static int sampler_grow_index(PS_Sampler *s) {
+  size_t cap = s->index_cap ? s->index_cap * 2 : 256;
+  uint32_t *index = (uint32_t *)calloc(cap, sizeof(uint32_t));
+  if (!index) return 0;
+  for (size_t i = 0; i < s->node_len; i++) {
+    size_t slot = (size_t)s->nodes[i].hash & (cap - 1);
+    while (index[slot]) slot = (slot + 1) & (cap - 1);
+    index[slot] = (uint32_t)(i + 1);
+  }
+  free(s->index);
+  s->index = index;
+  s->index_cap = cap;
+  return 1;
+}
+
+// Returns the node position + 1 of frame (fn, file, line) under `parent` (0 on OOM).
+static size_t sampler_node(PS_Sampler *s, size_t parent, const char *fn, const char *file, int line) {
+  uint64_t h = hash_frame(parent, fn, file, line);
+  if (s->index_cap) {
+    size_t slot = (size_t)h & (s->index_cap - 1);
+    while (s->index[slot]) {
+      PS_SampleNode *n = &s->nodes[s->index[slot] - 1];
+      if (n->hash == h && n->parent == parent && n->line == line && same_name(n->fn_key, fn) &&
+          same_name(n->file_key, file)) {
+        return s->index[slot];
+      }
+      slot = (slot + 1) & (s->index_cap - 1);
+    }
+  }
+  if ((s->node_len + 1) * 2 > s->index_cap && !sampler_grow_index(s)) return 0;
+  if (s->node_len == s->node_cap) {
+    size_t cap = s->node_cap ? s->node_cap * 2 : 64;
+    PS_SampleNode *nodes = (PS_SampleNode *)realloc(s->nodes, cap * sizeof(PS_SampleNode));
+    if (!nodes) return 0;
+    s->nodes = nodes;
+    s->node_cap = cap;
+  }
+  char label[512];
+  const char *name = line < 0 ? "[...]" : (fn ? fn : "<anonymous>");
+  if (file && line > 0) snprintf(label, sizeof(label), "%s (%s:%d)", name, file, line);
+  else snprintf(label, sizeof(label), "%s", name);
+  // ';' separates frames in the folded format.
+  for (char *c = label; *c; c++) {
+    if (*c == ';') *c = ':';
+  }
+  PS_SampleNode *n = &s->nodes[s->node_len];
+  memset(n, 0, sizeof(*n));
+  n->fn = strdup(name);
+  n->label = strdup(label);
+  if (!n->fn || !n->label) {
+    free(n->fn);
+    free(n->label);
+    return 0;
+  }
+  n->parent = parent;
+  n->fn_key = fn;
+  n->file_key = file;
+  n->line = line;
+  n->hash = h;
+  s->node_len += 1;
+  size_t slot = (size_t)h & (s->index_cap - 1);
+  while (s->index[slot]) slot = (slot + 1) & (s->index_cap - 1);
+  s->index[slot] = (uint32_t)s->node_len;
+  return s->node_len;
+}
+
+static void sampler_drain(PS_Sampler *s) {
+  size_t head = atomic_load_explicit(&s->head, memory_order_acquire);
+  size_t tail = atomic_load_explicit(&s->tail, memory_order_relaxed);
+  for (; tail != head; tail++) {
+    const PS_SampleRecord *r = &s->ring[tail & (PS_SAMPLE_RING - 1)];
+    if (r->depth == 0) continue;
+    size_t node = 0;
+    for (size_t i = 0; i < r->depth; i++) {
+      if (r->truncated && i + 1 == r->depth) {
+        node = sampler_node(s, node, NULL, NULL, -1);
+        if (!node) break;
+      }
+      const PS_SampleFrame *fr = &r->frames[i];
+      node = sampler_node(s, node, fr->fn, fr->file, fr->line);
+      if (!node) break;
+    }
+    if (!node) continue;
+    if (s->sample_len == s->sample_cap) {
+      size_t cap = s->sample_cap ? s->sample_cap * 2 : 1024;
+      PS_SamplePoint *samples = (PS_SamplePoint *)realloc(s->samples, cap * sizeof(PS_SamplePoint));
+      if (!samples) continue;
+      s->samples = samples;
+      s->sample_cap = cap;
+    }
+    s->samples[s->sample_len].ts_ns = r->ts_ns;
+    s->samples[s->sample_len].node = node;
+    s->sample_len += 1;
+    s->nodes[node - 1].self += 1;
+  }
+  atomic_store_explicit(&s->tail, tail, memory_order_release);
+}
+
+int ps_sampler_start(PS_Sampler *s) {
+#ifdef __EMSCRIPTEN__
+  (void)s;
+  return 0;
+#else
+  if (!s || s->running || g_sampler) return 0;
+  struct sigaction sa;
+  memset(&sa, 0, sizeof(sa));
+  sa.sa_handler = sampler_on_sigprof;
+  sa.sa_flags = SA_RESTART;
+  sigemptyset(&sa.sa_mask);
+  g_sampler = s;
+  if (sigaction(SIGPROF, &sa, &s->old_action) != 0) {
+    g_sampler = NULL;
+    return 0;
+  }
+  struct itimerval it;
+  it.it_interval.tv_sec = 0;
+  it.it_interval.tv_usec = PS_SAMPLE_INTERVAL_US;
+  it.it_value = it.it_interval;
+  if (setitimer(ITIMER_PROF, &it, NULL) != 0) {
+    sigaction(SIGPROF, &s->old_action, NULL);
+    g_sampler = NULL;
+    return 0;
+  }
+  s->running = 1;
+  return 1;
+#endif
+}
+
+void ps_sampler_stop(PS_Sampler *s) {
+  if (!s || !s->running) return;
+#ifndef __EMSCRIPTEN__
+  struct itimerval it;
+  memset(&it, 0, sizeof(it));
+  setitimer(ITIMER_PROF, &it, NULL);
+  sigaction(SIGPROF, &s->old_action, NULL);
+#endif
+  g_sampler = NULL;
+  s->running = 0;
+  sampler_drain(s);
+}
+
+volatile PS_SampleFrame *ps_sampler_push(PS_Sampler *s, const char *fn) {
+  size_t depth = s->depth;
+  volatile PS_SampleFrame *fr = NULL;
+  if (depth < PS_SAMPLE_STACK_MAX) {
+    fr = &s->stack[depth];
+    fr->fn = fn;
+    fr->file = NULL;
+    fr->line = 0;
+  }
+  atomic_signal_fence(memory_order_release);
+  s->depth = depth + 1;
+  return fr;
+}
+
+void ps_sampler_pop(PS_Sampler *s) {
+  if (s->depth > 0) s->depth = s->depth - 1;
+  ps_sampler_poll(s);
+}
+
+volatile PS_SampleFrame *ps_sampler_top(PS_Sampler *s) {
+  size_t depth = s->depth;
+  if (depth == 0 || depth > PS_SAMPLE_STACK_MAX) return NULL;
+  return &s->stack[depth - 1];
+}
+
+void ps_sampler_poll(PS_Sampler *s) {
+  size_t head = atomic_load_explicit(&s->head, memory_order_acquire);
+  size_t tail = atomic_load_explicit(&s->tail, memory_order_relaxed);
+  if (head - tail >= PS_SAMPLE_RING / 2) sampler_drain(s);
+}
+
+static void write_path(FILE *out, const PS_Sampler *s, size_t node) {
+  const PS_SampleNode *n = &s->nodes[node - 1];
+  if (n->parent) {
+    write_path(out, s, n->parent);
+    fputc(';', out);
+  }
+  fputs(n->label, out);
+}
+
+void ps_sampler_write_folded(PS_Sampler *s, FILE *out) {
+  if (!s || !out) return;
+  sampler_drain(s);
+  for (size_t i = 0; i < s->node_len; i++) {
+    if (!s->nodes[i].self) continue;
+    write_path(out, s, i + 1);
+    fprintf(out, " %llu\n", (unsigned long long)s->nodes[i].self);
+  }
+}
+
+typedef struct {
+  const char *fn;
+  uint64_t start_ns;
+} PS_TraceSpan;
+
+static void write_span(FILE *out, const PS_Sampler *s, const PS_TraceSpan *sp, uint64_t end_ns) {
+  fprintf(out, ",\n{\"name\":");
+  json_string(out, sp->fn);
+  fprintf(out, ",\"cat\":\"ps\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":%.3f,\"dur\":%.3f}",
+          (double)(sp->start_ns - s->start_ns) / 1e3, (double)(end_ns - sp->start_ns) / 1e3);
+}
+
+void ps_sampler_write_chrome(PS_Sampler *s, FILE *out) {
+  if (!s || !out) return;
+  sampler_drain(s);
+  fprintf(out, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+  fprintf(out, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"ps\"}}");
+  // Consecutive samples sharing a stack prefix extend the same spans.
+  PS_TraceSpan *open = NULL;
+  size_t open_len = 0;
+  size_t open_cap = 0;
+  const PS_SampleNode **path = NULL;
+  size_t path_cap = 0;
+  uint64_t last_ns = s->start_ns;
+  for (size_t i = 0; i < s->sample_len; i++) {
+    size_t depth = 0;
+    for (size_t n = s->samples[i].node; n; n = s->nodes[n - 1].parent) depth++;
+    if (depth > path_cap || depth > open_cap) {
+      size_t cap = depth * 2;
+      const PS_SampleNode **np = (const PS_SampleNode **)realloc(path, cap * sizeof(*path));
+      if (np) path = np;
+      PS_TraceSpan *no = (PS_TraceSpan *)realloc(open, cap * sizeof(*open));
+      if (no) open = no;
+      if (!np || !no) break;
+      path_cap = open_cap = cap;
+    }
+    size_t k = depth;
+    for (size_t n = s->samples[i].node; n; n = s->nodes[n - 1].parent) path[--k] = &s->nodes[n - 1];
+    uint64_t ts = s->samples[i].ts_ns;
+    size_t keep = 0;
+    while (keep < open_len && keep < depth && strcmp(open[keep].fn, path[keep]->fn) == 0) keep++;
+    while (open_len > keep) {
+      open_len--;
+      write_span(out, s, &open[open_len], ts);
+    }
+    for (; open_len < depth; open_len++) {
+      open[open_len].fn = path[open_len]->fn;
+      open[open_len].start_ns = ts;
+    }
+    last_ns = ts;
+  }
+  while (open_len > 0) {
+    open_len--;
+    write_span(out, s, &open[open_len], last_ns + (uint64_t)PS_SAMPLE_INTERVAL_US * 1000ull);
+  }
+  fprintf(out, "\n],\"otherData\":{\"samples\":%llu,\"dropped\":%llu,\"interval_us\":%d}}\n",
+          (unsigned long long)s->sample_len, (unsigned long long)atomic_load(&s->dropped), PS_SAMPLE_INTERVAL_US);
+  free(open);
+  free(path);
+}
+
+// ---- Heap census ----
+
+// Live values are kept in an open-addressing table keyed by
+// address (linear probing, backward-shift deletion); file names are copied so
+// that reports outlive the IR module.
+typedef struct {
+  PS_Value *v;
+  uint32_t file; // index in PS_Census.files
+  int line;
+  uint8_t state;   // report walk: 0 new, 1 open, 2 done
+  size_t retained; // report walk result
+} CensusEntry;
+
+struct PS_Census {
+  CensusEntry *slots;
+  size_t cap;
+  size_t len;
+  char **files;
+  size_t file_count;
+  size_t file_cap;
+  uint32_t cur_file;
+  int cur_line;
+};
+
+static size_t census_hash(const PS_Value *v) {
+  uint64_t x = (uint64_t)(uintptr_t)v;
+  x ^= x >> 33;
+  x *= 0xff51afd7ed558ccdULL;
+  x ^= x >> 33;
+  return (size_t)x;
+}
+
+static int census_grow(PS_Census *c) {
+  size_t ncap = c->cap ? c->cap * 2 : 1024;
+  CensusEntry *n = (CensusEntry *)calloc(ncap, sizeof(CensusEntry));
+  if (!n) return 0;
+  for (size_t i = 0; i < c->cap; i++) {
+    if (!c->slots[i].v) continue;
+    size_t j = census_hash(c->slots[i].v) & (ncap - 1);
+    while (n[j].v) j = (j + 1) & (ncap - 1);
+    n[j] = c->slots[i];
+  }
+  free(c->slots);
+  c->slots = n;
+  c->cap = ncap;
+  return 1;
+}
+
+static CensusEntry *census_find(PS_Census *c, const PS_Value *v) {
+  if (!c->cap) return NULL;
+  size_t i = census_hash(v) & (c->cap - 1);
+  while (c->slots[i].v) {
+    if (c->slots[i].v == v) return &c->slots[i];
+    i = (i + 1) & (c->cap - 1);
+  }
+  return NULL;
+}
+
+PS_Census *ps_census_create(void) {
+  PS_Census *c = (PS_Census *)calloc(1, sizeof(PS_Census));
+  if (!c) return NULL;
+  // File 0 is the site of values allocated outside any located instruction.
+  c->files = (char **)malloc(sizeof(char *) * 8);
+  c->file_cap = 8;
+  if (c->files) c->files[0] = strdup("<runtime>");
+  if (!c->files || !c->files[0]) {
+    free(c->files);
+    free(c);
+    return NULL;
+  }
+  c->file_count = 1;
+  return c;
+}
+
+void ps_census_destroy(PS_Census *c) {
+  if (!c) return;
+  for (size_t i = 0; i < c->file_count; i++) free(c->files[i]);
+  free(c->files);
+  free(c->slots);
+  free(c);
+}
+
+void ps_census_site(PS_Census *c, const char *file, int line) {
+  c->cur_line = line;
+  if (!file || !*file) {
+    c->cur_file = 0;
+    return;
+  }
+  // Instructions carry their own copy of the file name: compare contents.
+  if (strcmp(c->files[c->cur_file], file) == 0) return;
+  for (size_t i = 1; i < c->file_count; i++) {
+    if (strcmp(c->files[i], file) == 0) {
+      c->cur_file = (uint32_t)i;
+      return;
+    }
+  }
+  if (c->file_count == c->file_cap) {
+    char **n = (char **)realloc(c->files, sizeof(char *) * c->file_cap * 2);
+    if (!n) return;
+    c->files = n;
+    c->file_cap *= 2;
+  }
+  char *copy = strdup(file);
+  if (!copy) return;
+  c->files[c->file_count] = copy;
+  c->cur_file = (uint32_t)c->file_count++;
+}
+
+void ps_census_track(PS_Census *c, PS_Value *v) {
+  if ((c->len + 1) * 2 > c->cap && !census_grow(c)) return;
+  size_t i = census_hash(v) & (c->cap - 1);
+  while (c->slots[i].v) i = (i + 1) & (c->cap - 1);
+  c->slots[i].v = v;
+  c->slots[i].file = c->cur_file;
+  c->slots[i].line = c->cur_line;
+  c->len += 1;
+}
+
+void ps_census_untrack(PS_Census *c, PS_Value *v) {
+  CensusEntry *e = census_find(c, v);
+  if (!e) return;
+  size_t i = (size_t)(e - c->slots);
+  size_t j = i;
+  for (;;) {
+    j = (j + 1) & (c->cap - 1);
+    if (!c->slots[j].v) break;
+    size_t home = census_hash(c->slots[j].v) & (c->cap - 1);
+    // Move j back into the hole unless its home lies in (i, j].
+    if (i <= j ? (home <= i || home > j) : (home <= i && home > j)) {
+      c->slots[i] = c->slots[j];
+      i = j;
+    }
+  }
+  memset(&c->slots[i], 0, sizeof(CensusEntry));
+  c->len -= 1;
+}
+
+typedef struct {
+  PS_Census *c;
+  size_t *stack;
+  size_t len;
+  size_t cap;
+  size_t sum;
+  int oom;
+} CensusWalk;
+
+// Children owned exclusively by their parent (refcount 1) belong to its
+// retained size.
+static CensusEntry *census_owned(CensusWalk *w, PS_Value *child) {
+  return child->refcount == 1 ? census_find(w->c, child) : NULL;
+}
+
+static void census_walk_open(CensusWalk *w, size_t slot) {
+  if (w->len == w->cap) {
+    size_t ncap = w->cap ? w->cap * 2 : 256;
+    size_t *n = (size_t *)realloc(w->stack, sizeof(size_t) * ncap);
+    if (!n) {
+      w->oom = 1;
+      return;
+    }
+    w->stack = n;
+    w->cap = ncap;
+  }
+  w->stack[w->len++] = slot;
+}
+
+static void census_walk_push(PS_Value **slot, void *ud) {
+  CensusWalk *w = (CensusWalk *)ud;
+  CensusEntry *e = census_owned(w, *slot);
+  if (e && e->state == 0) census_walk_open(w, (size_t)(e - w->c->slots));
+}
+
+static void census_walk_sum(PS_Value **slot, void *ud) {
+  CensusWalk *w = (CensusWalk *)ud;
+  CensusEntry *e = census_owned(w, *slot);
+  if (e && e->state == 2) w->sum += e->retained;
+}
+
+// Post-order walk, memoized per entry; an edge back to a value still open
+// (ownership cycle) is not followed.
+static int census_retained(PS_Census *c) {
+  CensusWalk w = {c, NULL, 0, 0, 0, 0};
+  for (size_t i = 0; i < c->cap; i++) c->slots[i].state = 0;
+  for (size_t i = 0; i < c->cap && !w.oom; i++) {
+    if (!c->slots[i].v || c->slots[i].state != 0) continue;
+    census_walk_open(&w, i);
+    while (w.len > 0 && !w.oom) {
+      CensusEntry *e = &c->slots[w.stack[w.len - 1]];
+      if (e->state == 0) {
+        e->state = 1;
+        e->retained = sizeof(PS_Value) + ps_value_payload_bytes(e->v);
+        ps_value_children(e->v, census_walk_push, &w);
+        continue;
+      }
+      w.len -= 1;
+      if (e->state == 1) {
+        w.sum = 0;
+        ps_value_children(e->v, census_walk_sum, &w);
+        e->retained += w.sum;
+        e->state = 2;
+      }
+    }
+  }
+  free(w.stack);
+  return !w.oom;
+}
+
+static const char *census_type_name(const PS_Value *v) {
+  switch (v->tag) {
+    case PS_V_BOOL: return "bool";
+    case PS_V_INT: return "int";
+    case PS_V_FLOAT: return "float";
+    case PS_V_BYTE: return "byte";
+    case PS_V_GLYPH: return "glyph";
+    case PS_V_STRING: return "string";
+    case PS_V_BYTES: return "bytes";
+    case PS_V_LIST: return v->as.list_v.type_name ? v->as.list_v.type_name : "list";
+    case PS_V_OBJECT: return v->as.object_v.proto_name ? v->as.object_v.proto_name : "object";
+    case PS_V_MAP: return v->as.map_v.type_name ? v->as.map_v.type_name : "map";
+    case PS_V_VIEW: return v->as.view_v.type_name ? v->as.view_v.type_name : "view";
+    case PS_V_JSON: return "JSONValue";
+    case PS_V_ITER: return "iterator";
+    case PS_V_FILE: return "file";
+    case PS_V_EXCEPTION: return v->as.exc_v.type_name ? v->as.exc_v.type_name : "Exception";
+    case PS_V_GROUP: return "group";
+    default: return "void";
+  }
+}
+
+typedef struct {
+  uint32_t file;
+  int line;
+  const char *type;
+  uint64_t count;
+  uint64_t bytes;
+  uint64_t retained;
+} CensusGroup;
+
+static int census_cmp_site(const void *a, const void *b) {
+  const CensusEntry *x = *(const CensusEntry *const *)a;
+  const CensusEntry *y = *(const CensusEntry *const *)b;
+  if (x->file != y->file) return x->file < y->file ? -1 : 1;
+  if (x->line != y->line) return x->line < y->line ? -1 : 1;
+  return strcmp(census_type_name(x->v), census_type_name(y->v));
+}
+
+static int census_cmp_bytes(const void *a, const void *b) {
+  const CensusGroup *x = (const CensusGroup *)a;
+  const CensusGroup *y = (const CensusGroup *)b;
+  if (x->retained != y->retained) return x->retained > y->retained ? -1 : 1;
+  if (x->count != y->count) return x->count > y->count ? -1 : 1;
+  return 0;
+}
+
+// Groups sorted by retained size (NULL when empty or out of memory).
+static CensusGroup *census_groups(PS_Census *c, size_t *out_n) {
+  *out_n = 0;
+  if (c->len == 0 || !census_retained(c)) return NULL;
+  CensusEntry **order = (CensusEntry **)malloc(sizeof(CensusEntry *) * c->len);
+  CensusGroup *groups = (CensusGroup *)calloc(c->len, sizeof(CensusGroup));
+  if (!order || !groups) {
+    free(order);
+    free(groups);
+    return NULL;
+  }
+  size_t n = 0;
+  for (size_t i = 0; i < c->cap; i++) {
+    if (c->slots[i].v) order[n++] = &c->slots[i];
+  }
+  qsort(order, n, sizeof(CensusEntry *), census_cmp_site);
+  size_t g = 0;
+  for (size_t i = 0; i < n; i++) {
+    const CensusEntry *e = order[i];
+    if (i == 0 || census_cmp_site(&order[i - 1], &order[i]) != 0) {
+      groups[g].file = e->file;
+      groups[g].line = e->line;
+      groups[g].type = census_type_name(e->v);
+      g += 1;
+    }
+    CensusGroup *cur = &groups[g - 1];
+    cur->count += 1;
+    cur->bytes += sizeof(PS_Value) + ps_value_payload_bytes(e->v);
+    cur->retained += e->retained;
+  }
+  free(order);
+  qsort(groups, g, sizeof(CensusGroup), census_cmp_bytes);
+  *out_n = g;
+  return groups;
+}
+
+void ps_census_write(PS_Census *c, FILE *out, int json) {
+  if (!c || !out) return;
+  size_t n = 0;
+  CensusGroup *groups = census_groups(c, &n);
+  uint64_t bytes = 0;
+  for (size_t i = 0; i < n; i++) bytes += groups[i].bytes;
+  if (json) {
+    fprintf(out, "{\"live_values\":%llu,\"live_bytes\":%llu,\"sites\":[", (unsigned long long)c->len,
+            (unsigned long long)bytes);
+    for (size_t i = 0; i < n; i++) {
+      fprintf(out, "%s{\"file\":", i ? "," : "");
+      json_string(out, c->files[groups[i].file]);
+      fprintf(out, ",\"line\":%d,\"type\":", groups[i].line);
+      json_string(out, groups[i].type);
+      fprintf(out, ",\"count\":%llu,\"bytes\":%llu,\"retained\":%llu}", (unsigned long long)groups[i].count,
+              (unsigned long long)groups[i].bytes, (unsigned long long)groups[i].retained);
+    }
+    fprintf(out, "]}\n");
+    free(groups);
+    return;
+  }
+  fprintf(out, "heap: %llu live values, %llu bytes\n", (unsigned long long)c->len, (unsigned long long)bytes);
+  fprintf(out, "live values by allocation site (by retained size):\n");
+  fprintf(out, "  %12s  %12s  %12s  %-24s  %s\n", "count", "bytes", "retained", "type", "site");
+  if (n == 0) fprintf(out, "  (none)\n");
+  for (size_t i = 0; i < n && i < PS_PROFILE_TEXT_ROWS; i++) {
+    fprintf(out, "  %12llu  %12llu  %12llu  %-24s  %s:%d\n", (unsigned long long)groups[i].count,
+            (unsigned long long)groups[i].bytes, (unsigned long long)groups[i].retained, groups[i].type,
+            c->files[groups[i].file], groups[i].line);
+  }
+  if (n > PS_PROFILE_TEXT_ROWS) fprintf(out, "  ... %zu more\n", n - PS_PROFILE_TEXT_ROWS);
+  free(groups);
+}
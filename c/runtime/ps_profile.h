@@ -0,0 +1,83 @@
+#ifndef PS_PROFILE_H
+#define PS_PROFILE_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+// Built-in VM profiler (`ps run --profile`). Hung off PS_Context; every hook is
+// skipped by the VM when ctx->profile is NULL.
+typedef struct PS_Profile PS_Profile;
+
+PS_Profile *ps_profile_create(void);
+void ps_profile_destroy(PS_Profile *p);
+
+// One executed VM instruction (fused or generic opcode `op`, name `op_name`).
+void ps_profile_op(PS_Profile *p, int op, const char *op_name);
+// Location of the instruction being executed; values allocated from here on are
+// charged to this call site.
+void ps_profile_site(PS_Profile *p, const char *file, int line);
+// One builtin method or native module call ("list.push", "Math.sqrt").
+void ps_profile_builtin(PS_Profile *p, const char *owner, const char *name);
+
+// IR function frames. Inclusive time counts recursive activations once;
+// exclusive time excludes callees.
+void ps_profile_enter(PS_Profile *p, const char *fn);
+void ps_profile_leave(PS_Profile *p);
+
+// Sorted text report, or the same data as JSON.
+void ps_profile_report(PS_Profile *p, FILE *out);
+void ps_profile_write_json(PS_Profile *p, FILE *out);
+
+// Sampling profiler (`ps run --sample-profile=<file>`). A SIGPROF timer
+// snapshots a shadow stack of ProtoScript frames maintained by the VM into a
+// lock-free ring buffer; samples are aggregated outside the signal handler.
+typedef struct PS_Sampler PS_Sampler;
+
+// Shadow stack frame: function and current location (written by the VM, read
+// by the signal handler).
+typedef struct {
+  const char *fn;
+  const char *file;
+  int line;
+} PS_SampleFrame;
+
+PS_Sampler *ps_sampler_create(void);
+void ps_sampler_destroy(PS_Sampler *s);
+
+// Arms/disarms the timer. Stopping drains the ring buffer, so it must happen
+// while the IR module whose names are on the stack is still loaded.
+int ps_sampler_start(PS_Sampler *s);
+void ps_sampler_stop(PS_Sampler *s);
+
+// VM hooks. push returns the new top frame (NULL above the shadow stack
+// capacity); poll drains the ring buffer once it is half full.
+volatile PS_SampleFrame *ps_sampler_push(PS_Sampler *s, const char *fn);
+void ps_sampler_pop(PS_Sampler *s);
+volatile PS_SampleFrame *ps_sampler_top(PS_Sampler *s);
+void ps_sampler_poll(PS_Sampler *s);
+
+// Flamegraph folded stacks ("main;f (file:line);g (file:line) <count>"), or
+// Chrome trace event JSON (complete events rebuilt from the sample sequence).
+void ps_sampler_write_folded(PS_Sampler *s, FILE *out);
+void ps_sampler_write_chrome(PS_Sampler *s, FILE *out);
+
+// Heap census (`ps run --heap-report`, Debug.heapSnapshot). Hung off the
+// context heap (PS_Heap.census): every live value is tagged with the file:line
+// of the instruction that allocated it, as set by the VM through
+// ps_census_site.
+struct PS_Value;
+typedef struct PS_Census PS_Census;
+
+PS_Census *ps_census_create(void);
+void ps_census_destroy(PS_Census *c);
+
+void ps_census_site(PS_Census *c, const char *file, int line);
+void ps_census_track(PS_Census *c, struct PS_Value *v);
+void ps_census_untrack(PS_Census *c, struct PS_Value *v);
+
+// Live values grouped by allocation site and type with their size and retained
+// size (the value plus what it owns exclusively, i.e. through references whose
+// refcount is 1). Text table, or JSON.
+void ps_census_write(PS_Census *c, FILE *out, int json);
+
+#endif // PS_PROFILE_H
@@ -6,6 +6,9 @@
 #include "ps_value_impl.h"
 
 struct PS_IR_Module;
+struct PS_Profile;
+struct PS_Sampler;
+struct PS_Census;
 
 typedef struct {
   PS_Value **items;
@@ -13,25 +16,148 @@ typedef struct {
   size_t cap;
 } PS_HandleStack;
 
+// Payload kinds of the heap accounting. Sizes are the bytes the runtime asks
+// from malloc (value headers, string/bytes buffers, container tables), not the
+// allocator overhead.
+typedef enum {
+  PS_HEAP_VALUES,
+  PS_HEAP_STRINGS,
+  PS_HEAP_BYTES,
+  PS_HEAP_LISTS,
+  PS_HEAP_OBJECTS,
+  PS_HEAP_MAPS,
+  PS_HEAP_KIND_COUNT
+} PS_HeapKind;
+
+// Bytes per hash table slot (keys, values, used flags).
+#define PS_OBJECT_SLOT_BYTES (sizeof(PS_String) + sizeof(PS_Value *) + 1)
+#define PS_MAP_SLOT_BYTES (2 * sizeof(PS_Value *) + 1)
+
+// Heap accounting of a context (Debug.heapStats, --max-heap). Every value
+// records its owning heap, which is refunded when the value is destroyed.
+// Counters are signed: payload growth is charged to the context doing it,
+// which only differs from the owner for values shared between contexts.
+typedef struct {
+  uint16_t id;                   // index in ps_heaps, stored in the values it owns
+  int64_t values[PS_V_VOID + 1]; // live values by tag
+  int64_t bytes[PS_HEAP_KIND_COUNT];
+  int64_t live_values;
+  int64_t peak_values;
+  int64_t live_bytes;
+  int64_t peak_bytes;
+  size_t max_bytes; // hard limit, 0 = unlimited
+  int tripped;      // limit exceeded: handlers run with some headroom
+  struct PS_Census *census; // allocation-site tracking (--heap-report), NULL when disabled
+  // Backup cycle collector (--gc-cycles): containers whose refcount dropped to
+  // a nonzero value are buffered as possible roots of garbage cycles.
+  PS_Value **gc_roots;
+  size_t gc_roots_len;
+  size_t gc_roots_cap;
+  size_t gc_threshold; // minimum allocations between two collections, 0 = disabled
+  uint64_t gc_next;    // ps_value_alloc_total() at which the next collection is due
+  uint64_t gc_runs;
+  uint64_t gc_collected;
+  // Deferred destruction (--free-budget): values whose refcount reaches zero
+  // are queued and destroyed at most `free_budget` per VM block boundary (plus
+  // one per allocation). 0 = destroyed at once.
+  size_t free_budget;
+} PS_Heap;
+
 struct PS_Context {
   PS_HandleStack handles;
   PS_Error last_error;
   int trace;
   int trace_ir;
+  int no_fuse;
+  struct PS_Profile *profile; // VM profiler (--profile), NULL when disabled
+  struct PS_Sampler *sampler; // sampling profiler (--sample-profile), NULL when disabled
+  uint64_t module_load_ns;    // time spent loading native modules (--time)
+  size_t modules_loaded;
+  PS_Heap heap;
   struct PS_ModuleRecord *modules;
   size_t module_count;
   size_t module_cap;
+  struct PS_ModuleData *module_data; // per-context state of native modules
+  size_t module_data_len;
+  size_t module_data_cap;
   PS_Value *eof_value;
   PS_Value *stdin_value;
   PS_Value *stdout_value;
   PS_Value *stderr_value;
   PS_Value *last_exception;
+  PS_Value *exc_file; // last exception location file, shared between exceptions
   struct PS_IR_Module *current_module;
 };
 
-PS_Value *ps_value_alloc(PS_ValueTag tag);
+// New value owned by ctx's heap (the process heap when ctx is NULL).
+PS_Value *ps_value_alloc(PS_Context *ctx, PS_ValueTag tag);
+// Destroys a value whose refcount reached zero. Its children are released
+// through a worklist (no recursion); with a free budget the destruction is
+// queued for ps_value_drain.
 void ps_value_free(PS_Value *v);
+// Destroys queued values, at most `budget` of them (0 = all); returns how many.
+size_t ps_value_drain(size_t budget);
+// Number of values queued for destruction.
+size_t ps_value_pending(void);
 PS_Value *ps_value_retain(PS_Value *v);
 void ps_value_release(PS_Value *v);
+// Calls fn on each reference slot held by a value (list items, object fields,
+// map keys and values, view/iterator source, exception fields).
+void ps_value_children(PS_Value *v, void (*fn)(PS_Value **slot, void *ud), void *ud);
+// Synchronous trial-deletion pass over the buffered possible roots of `h`;
+// returns the number of values freed. Only safe where no unretained value
+// pointer is held (VM block boundaries, teardown).
+size_t ps_value_collect_cycles(PS_Heap *h);
+// Number of values allocated so far by the process (profiler attribution),
+// and the highest number of values alive at once.
+uint64_t ps_value_alloc_total(void);
+uint64_t ps_value_live_peak(void);
+// Process-wide table of type and prototype names ("list<int>", "Point"). The
+// returned copy is shared and never freed, so two interned names are equal
+// iff their pointers are. NULL on allocation failure.
+const char *ps_intern(const char *s);
+// Interned copy of s if it exists (no insertion), NULL otherwise.
+const char *ps_intern_lookup(const char *s);
+
+// Heaps of the live contexts, indexed by PS_Value.heap_id. Slot 0 is the
+// process-wide heap, which also takes over the slot of a destroyed context.
+extern PS_Heap **ps_heaps;
+
+static inline void ps_heap_add(PS_Heap *h, PS_HeapKind kind, int64_t bytes) {
+  h->bytes[kind] += bytes;
+  h->live_bytes += bytes;
+  if (h->live_bytes > h->peak_bytes) h->peak_bytes = h->live_bytes;
+}
+
+// Charges payload growth to the context that allocates it (the heap checked by
+// ps_heap_reserve); ps_value_free refunds the value's owning heap.
+static inline void ps_heap_charge(PS_Context *ctx, PS_HeapKind kind, int64_t bytes) {
+  ps_heap_add(ctx ? &ctx->heap : ps_heaps[0], kind, bytes);
+}
+
+// Payload bytes owned by a value (buffers, tables, object keys; header
+// excluded) and the heap kind they are charged to.
+size_t ps_value_payload_bytes(const PS_Value *v);
+PS_HeapKind ps_value_heap_kind(const PS_Value *v);
+
+// Slow path of ps_heap_reserve: throws R1014 "memory limit exceeded" and
+// returns 0 unless the bytes fit in the headroom granted after a first failure.
+int ps_heap_admit(PS_Context *ctx, size_t bytes);
+// VM poll (between blocks): catches limits exceeded by value headers alone.
+int ps_heap_check(PS_Context *ctx);
+
+// VM poll (between blocks): runs the cycle collector once it is due.
+static inline void ps_heap_poll_gc(PS_Context *ctx) {
+  PS_Heap *h = &ctx->heap;
+  if (ps_value_alloc_total() >= h->gc_next) ps_heap_collect(ctx);
+}
+
+// Called before a payload allocation of `bytes`; 0 when the context memory
+// limit would be exceeded (the error is set).
+static inline int ps_heap_reserve(PS_Context *ctx, size_t bytes) {
+  if (!ctx || !ctx->heap.max_bytes) return 1;
+  if (ctx->heap.live_bytes + (int64_t)bytes <= (int64_t)ctx->heap.max_bytes) return 1;
+  return ps_heap_admit(ctx, bytes);
+}
 
 #endif // PS_RUNTIME_H
@@ -4,6 +4,21 @@
 #include "ps_string.h"
 #include "ps_list.h"
 
+// Buffer of a new string value: `len` bytes plus the terminator, charged to
+// the heap. The length is set right away so that releasing the value on an
+// error path refunds exactly what was charged.
+static int string_alloc(PS_Context *ctx, PS_Value *v, size_t len) {
+  if (!ps_heap_reserve(ctx, len + 1)) return 0;
+  v->as.string_v.ptr = (char *)malloc(len + 1);
+  if (!v->as.string_v.ptr) {
+    ps_throw_diag(ctx, PS_ERR_OOM, "out of memory", "allocation failed", "available memory");
+    return 0;
+  }
+  v->as.string_v.len = len;
+  ps_heap_charge(ctx, PS_HEAP_STRINGS, (int64_t)(len + 1));
+  return 1;
+}
+
 static int is_ascii_space(char c) {
   return c == ' ' || c == '\t' || c == '\n' || c == '\r';
 }
@@ -57,6 +72,14 @@ int ps_utf8_validate(const uint8_t *s, size_t len) {
   size_t i = 0;
   uint32_t cp = 0;
   while (i < len) {
+    // ASCII runs are skipped 8 bytes at a time.
+    while (i + 8 <= len) {
+      uint64_t w;
+      memcpy(&w, s + i, sizeof(w));
+      if (w & 0x8080808080808080ULL) break;
+      i += 8;
+    }
+    if (i >= len) break;
     int r = utf8_next(s, len, &i, &cp);
     if (r <= 0) return 0;
   }
@@ -93,15 +116,13 @@ PS_Value *ps_string_from_utf8(PS_Context *ctx, const char *s, size_t len) {
     ps_throw_diag(ctx, PS_ERR_UTF8, "invalid UTF-8 sequence", "byte stream", "valid UTF-8");
     return NULL;
   }
-  PS_Value *v = ps_value_alloc(PS_V_STRING);
+  PS_Value *v = ps_value_alloc(ctx, PS_V_STRING);
   if (!v) {
     ps_throw_diag(ctx, PS_ERR_OOM, "out of memory", "allocation failed", "available memory");
     return NULL;
   }
-  v->as.string_v.ptr = (char *)malloc(len + 1);
-  if (!v->as.string_v.ptr && len > 0) {
+  if (!string_alloc(ctx, v, len)) {
     ps_value_release(v);
-    ps_throw_diag(ctx, PS_ERR_OOM, "out of memory", "allocation failed", "available memory");
     return NULL;
   }
   if (len > 0) memcpy(v->as.string_v.ptr, s, len);
@@ -110,17 +131,37 @@ PS_Value *ps_string_from_utf8(PS_Context *ctx, const char *s, size_t len) {
   return v;
 }
 
+PS_Value *ps_string_adopt_utf8(PS_Context *ctx, char *buf, size_t len) {
+  PS_Value *v = ps_value_alloc(ctx, PS_V_STRING);
+  if (!v) {
+    free(buf);
+    ps_throw_diag(ctx, PS_ERR_OOM, "out of memory", "allocation failed", "available memory");
+    return NULL;
+  }
+  if (!ps_heap_reserve(ctx, len + 1)) {
+    free(buf);
+    ps_value_release(v);
+    return NULL;
+  }
+  // Builders over-allocate: give the slack back (in place for large blocks).
+  char *p = (char *)realloc(buf, len + 1);
+  if (p) buf = p;
+  buf[len] = '\0';
+  v->as.string_v.ptr = buf;
+  v->as.string_v.len = len;
+  ps_heap_charge(ctx, PS_HEAP_STRINGS, (int64_t)(len + 1));
+  return v;
+}
+
 PS_Value *ps_string_concat(PS_Context *ctx, PS_Value *a, PS_Value *b) {
   size_t len = a->as.string_v.len + b->as.string_v.len;
-  PS_Value *v = ps_value_alloc(PS_V_STRING);
+  PS_Value *v = ps_value_alloc(ctx, PS_V_STRING);
   if (!v) {
     ps_throw_diag(ctx, PS_ERR_OOM, "out of memory", "allocation failed", "available memory");
     return NULL;
   }
-  v->as.string_v.ptr = (char *)malloc(len + 1);
-  if (!v->as.string_v.ptr && len > 0) {
+  if (!string_alloc(ctx, v, len)) {
     ps_value_release(v);
-    ps_throw_diag(ctx, PS_ERR_OOM, "out of memory", "allocation failed", "available memory");
     return NULL;
   }
   memcpy(v->as.string_v.ptr, a->as.string_v.ptr, a->as.string_v.len);
@@ -249,15 +290,13 @@ PS_Value *ps_string_replace(PS_Context *ctx, PS_Value *s, PS_Value *from, PS_Val
   if (!pos) return ps_string_from_utf8(ctx, h, s->as.string_v.len);
   size_t pre = (size_t)(pos - h);
   size_t new_len = pre + to->as.string_v.len + (s->as.string_v.len - pre - from->as.string_v.len);
-  PS_Value *v = ps_value_alloc(PS_V_STRING);
+  PS_Value *v = ps_value_alloc(ctx, PS_V_STRING);
   if (!v) {
     ps_throw_diag(ctx, PS_ERR_OOM, "out of memory", "allocation failed", "available memory");
     return NULL;
   }
-  v->as.string_v.ptr = (char *)malloc(new_len + 1);
-  if (!v->as.string_v.ptr && new_len > 0) {
+  if (!string_alloc(ctx, v, new_len)) {
     ps_value_release(v);
-    ps_throw_diag(ctx, PS_ERR_OOM, "out of memory", "allocation failed", "available memory");
     return NULL;
   }
   memcpy(v->as.string_v.ptr, h, pre);
@@ -300,15 +339,13 @@ PS_Value *ps_string_replace_all(PS_Context *ctx, PS_Value *s, PS_Value *from, PS
   } else {
     new_len -= count * (from->as.string_v.len - to->as.string_v.len);
   }
-  PS_Value *v = ps_value_alloc(PS_V_STRING);
+  PS_Value *v = ps_value_alloc(ctx, PS_V_STRING);
   if (!v) {
     ps_throw_diag(ctx, PS_ERR_OOM, "out of memory", "allocation failed", "available memory");
     return NULL;
   }
-  v->as.string_v.ptr = (char *)malloc(new_len + 1);
-  if (!v->as.string_v.ptr && new_len > 0) {
+  if (!string_alloc(ctx, v, new_len)) {
     ps_value_release(v);
-    ps_throw_diag(ctx, PS_ERR_OOM, "out of memory", "allocation failed", "available memory");
     return NULL;
   }
   size_t out = 0;
@@ -368,15 +405,13 @@ PS_Value *ps_string_repeat(PS_Context *ctx, PS_Value *s, int64_t count) {
   if (count == 0 || s->as.string_v.len == 0) return ps_string_from_utf8(ctx, "", 0);
   size_t rep = (size_t)count;
   size_t new_len = s->as.string_v.len * rep;
-  PS_Value *v = ps_value_alloc(PS_V_STRING);
+  PS_Value *v = ps_value_alloc(ctx, PS_V_STRING);
   if (!v) {
     ps_throw_diag(ctx, PS_ERR_OOM, "out of memory", "allocation failed", "available memory");
     return NULL;
   }
-  v->as.string_v.ptr = (char *)malloc(new_len + 1);
-  if (!v->as.string_v.ptr && new_len > 0) {
+  if (!string_alloc(ctx, v, new_len)) {
     ps_value_release(v);
-    ps_throw_diag(ctx, PS_ERR_OOM, "out of memory", "allocation failed", "available memory");
     return NULL;
   }
   for (size_t i = 0; i < rep; i += 1) {
@@ -414,15 +449,13 @@ static PS_Value *ps_string_pad_impl(PS_Context *ctx, PS_Value *s, int64_t target
   }
   size_t fill_bytes = full * pad->as.string_v.len + rem_bytes;
   size_t out_len = fill_bytes + s->as.string_v.len;
-  PS_Value *v = ps_value_alloc(PS_V_STRING);
+  PS_Value *v = ps_value_alloc(ctx, PS_V_STRING);
   if (!v) {
     ps_throw_diag(ctx, PS_ERR_OOM, "out of memory", "allocation failed", "available memory");
     return NULL;
   }
-  v->as.string_v.ptr = (char *)malloc(out_len + 1);
-  if (!v->as.string_v.ptr && out_len > 0) {
+  if (!string_alloc(ctx, v, out_len)) {
     ps_value_release(v);
-    ps_throw_diag(ctx, PS_ERR_OOM, "out of memory", "allocation failed", "available memory");
     return NULL;
   }
   size_t off = 0;
@@ -463,16 +496,14 @@ PS_Value *ps_string_pad_end(PS_Context *ctx, PS_Value *s, int64_t target_len, PS
 }
 
 PS_Value *ps_string_to_upper(PS_Context *ctx, PS_Value *s) {
-  PS_Value *v = ps_value_alloc(PS_V_STRING);
+  PS_Value *v = ps_value_alloc(ctx, PS_V_STRING);
   if (!v) {
     ps_throw_diag(ctx, PS_ERR_OOM, "out of memory", "allocation failed", "available memory");
     return NULL;
   }
   size_t len = s->as.string_v.len;
-  v->as.string_v.ptr = (char *)malloc(len + 1);
-  if (!v->as.string_v.ptr && len > 0) {
+  if (!string_alloc(ctx, v, len)) {
     ps_value_release(v);
-    ps_throw_diag(ctx, PS_ERR_OOM, "out of memory", "allocation failed", "available memory");
     return NULL;
   }
   for (size_t i = 0; i < len; i++) {
@@ -486,16 +517,14 @@ PS_Value *ps_string_to_upper(PS_Context *ctx, PS_Value *s) {
 }
 
 PS_Value *ps_string_to_lower(PS_Context *ctx, PS_Value *s) {
-  PS_Value *v = ps_value_alloc(PS_V_STRING);
+  PS_Value *v = ps_value_alloc(ctx, PS_V_STRING);
   if (!v) {
     ps_throw_diag(ctx, PS_ERR_OOM, "out of memory", "allocation failed", "available memory");
     return NULL;
   }
   size_t len = s->as.string_v.len;
-  v->as.string_v.ptr = (char *)malloc(len + 1);
-  if (!v->as.string_v.ptr && len > 0) {
+  if (!string_alloc(ctx, v, len)) {
     ps_value_release(v);
-    ps_throw_diag(ctx, PS_ERR_OOM, "out of memory", "allocation failed", "available memory");
     return NULL;
   }
   for (size_t i = 0; i < len; i++) {
@@ -512,7 +541,7 @@ PS_Value *ps_string_split(PS_Context *ctx, PS_Value *s, PS_Value *sep) {
   const char *h = s->as.string_v.ptr;
   const char *needle = sep->as.string_v.ptr;
   size_t nlen = sep->as.string_v.len;
-  PS_Value *list = ps_value_alloc(PS_V_LIST);
+  PS_Value *list = ps_value_alloc(ctx, PS_V_LIST);
   if (!list) {
     ps_throw_diag(ctx, PS_ERR_OOM, "out of memory", "allocation failed", "available memory");
     return NULL;
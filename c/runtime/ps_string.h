@@ -11,6 +11,9 @@ size_t ps_utf8_glyph_len(const uint8_t *s, size_t len);
 uint32_t ps_utf8_glyph_at(const uint8_t *s, size_t len, size_t index);
 
 PS_Value *ps_string_from_utf8(PS_Context *ctx, const char *s, size_t len);
+// Takes ownership of `buf` (malloc'd, at least len + 1 bytes, valid UTF-8 not
+// checked again) as the buffer of a new string; freed on failure.
+PS_Value *ps_string_adopt_utf8(PS_Context *ctx, char *buf, size_t len);
 PS_Value *ps_string_concat(PS_Context *ctx, PS_Value *a, PS_Value *b);
 PS_Value *ps_string_substring(PS_Context *ctx, PS_Value *s, int64_t start, int64_t length);
 int64_t ps_string_index_of(PS_Value *hay, PS_Value *needle);
@@ -1,15 +1,110 @@
+#ifndef _POSIX_C_SOURCE
+#define _POSIX_C_SOURCE 200809L
+#endif
 #include <stdlib.h>
 #include <string.h>
 
+#include "ps_profile.h"
 #include "ps_runtime.h"
 
 static void ps_list_free(PS_List *l);
 static void ps_object_free(PS_Object *o);
 static void ps_map_free(PS_Map *m);
+static void gc_possible_root(PS_Heap *h, PS_Value *v);
+static void value_destroy(PS_Value *v);
 
-PS_Value *ps_value_alloc(PS_ValueTag tag) {
+// Cycle collector colors (PS_Value.gc_color) and flags (PS_Value.gc_flags).
+enum { GC_BLACK = 0, GC_GRAY, GC_WHITE, GC_PURPLE, GC_PENDING, GC_GARBAGE };
+#define GC_BUFFERED 1 // in the heap root buffer
+#define GC_FREED 2    // released while buffered: the collector frees the header
+
+static uint64_t g_value_allocs = 0;
+static uint64_t g_value_live = 0;
+static uint64_t g_value_peak = 0;
+
+// Values whose refcount reached zero, not destroyed yet. Destroying a value
+// releases its children onto this worklist instead of recursing, so that
+// freeing a long chain runs in constant C stack.
+static PS_Value **g_dying = NULL;
+static size_t g_dying_len = 0;
+static size_t g_dying_cap = 0;
+static int g_draining = 0;
+
+uint64_t ps_value_alloc_total(void) {
+  return g_value_allocs;
+}
+
+uint64_t ps_value_live_peak(void) {
+  return g_value_peak;
+}
+
+// Interned type and prototype names: open addressing on an FNV-1a hash. The
+// table and its strings live until exit, as values and loaded IR modules only
+// borrow them.
+static const char **g_names = NULL;
+static size_t g_names_cap = 0;
+static size_t g_names_len = 0;
+
+static uint64_t name_hash(const char *s) {
+  uint64_t h = 1469598103934665603ULL;
+  for (const unsigned char *p = (const unsigned char *)s; *p; p++) {
+    h ^= *p;
+    h *= 1099511628211ULL;
+  }
+  return h;
+}
+
+static const char **name_slot(const char *s) {
+  size_t mask = g_names_cap - 1;
+  size_t i = (size_t)name_hash(s) & mask;
+  while (g_names[i] && strcmp(g_names[i], s) != 0) i = (i + 1) & mask;
+  return &g_names[i];
+}
+
+const char *ps_intern_lookup(const char *s) {
+  if (!s || !g_names) return NULL;
+  return *name_slot(s);
+}
+
+const char *ps_intern(const char *s) {
+  if (!s) return NULL;
+  if ((g_names_len + 1) * 2 > g_names_cap) {
+    size_t cap = g_names_cap ? g_names_cap * 2 : 256;
+    const char **names = (const char **)calloc(cap, sizeof(*names));
+    if (!names) return NULL;
+    const char **old = g_names;
+    size_t old_cap = g_names_cap;
+    g_names = names;
+    g_names_cap = cap;
+    for (size_t i = 0; i < old_cap; i++) {
+      if (old[i]) *name_slot(old[i]) = old[i];
+    }
+    free((void *)old);
+  }
+  const char **slot = name_slot(s);
+  if (!*slot) {
+    char *copy = strdup(s);
+    if (!copy) return NULL;
+    *slot = copy;
+    g_names_len += 1;
+  }
+  return *slot;
+}
+
+PS_Value *ps_value_alloc(PS_Context *ctx, PS_ValueTag tag) {
   PS_Value *v = (PS_Value *)calloc(1, sizeof(PS_Value));
   if (!v) return NULL;
+  g_value_allocs += 1;
+  if (++g_value_live > g_value_peak) g_value_peak = g_value_live;
+  PS_Heap *h = ctx ? &ctx->heap : ps_heaps[0];
+  v->heap_id = h->id;
+  // Deferred destruction is paced by allocation: the backlog cannot outgrow
+  // the program.
+  if (h->free_budget && g_dying_len) ps_value_drain(1);
+  h->values[tag] += 1;
+  if (++h->live_values > h->peak_values) h->peak_values = h->live_values;
+  ps_heap_add(h, PS_HEAP_VALUES, (int64_t)sizeof(PS_Value));
+  if (h->census) ps_census_track(h->census, v);
   v->tag = tag;
   v->refcount = 1;
   return v;
@@ -24,12 +119,102 @@ PS_Value *ps_value_retain(PS_Value *v) {
 void ps_value_release(PS_Value *v) {
   if (!v) return;
   v->refcount -= 1;
-  if (v->refcount > 0) return;
+  if (v->refcount > 0) {
+    PS_Heap *h = ps_heaps[v->heap_id];
+    if (h->gc_threshold && v->gc_color != GC_PURPLE) gc_possible_root(h, v);
+    return;
+  }
   ps_value_free(v);
 }
 
+PS_HeapKind ps_value_heap_kind(const PS_Value *v) {
+  switch (v->tag) {
+    case PS_V_STRING: return PS_HEAP_STRINGS;
+    case PS_V_BYTES: return PS_HEAP_BYTES;
+    case PS_V_LIST: return PS_HEAP_LISTS;
+    case PS_V_OBJECT: return PS_HEAP_OBJECTS;
+    case PS_V_MAP: return PS_HEAP_MAPS;
+    default: return PS_HEAP_VALUES;
+  }
+}
+
+size_t ps_value_payload_bytes(const PS_Value *v) {
+  switch (v->tag) {
+    case PS_V_STRING:
+      return v->as.string_v.ptr ? v->as.string_v.len + 1 : 0;
+    case PS_V_BYTES:
+      return v->as.bytes_v.ptr ? v->as.bytes_v.len : 0;
+    case PS_V_LIST:
+      return v->as.list_v.cap * sizeof(PS_Value *);
+    case PS_V_OBJECT: {
+      const PS_Object *o = &v->as.object_v;
+      size_t n = o->cap * PS_OBJECT_SLOT_BYTES;
+      for (size_t i = 0; i < o->cap; i++) {
+        if (o->used[i] && o->keys[i].ptr) n += o->keys[i].len + 1;
+      }
+      return n;
+    }
+    case PS_V_MAP:
+      return v->as.map_v.cap * PS_MAP_SLOT_BYTES + v->as.map_v.order_cap * sizeof(PS_Value *);
+    default:
+      return 0;
+  }
+}
+
+static int dying_push(PS_Value *v) {
+  if (g_dying_len == g_dying_cap) {
+    size_t ncap = g_dying_cap ? g_dying_cap * 2 : 256;
+    PS_Value **n = (PS_Value **)realloc(g_dying, ncap * sizeof(PS_Value *));
+    if (!n) return 0;
+    g_dying = n;
+    g_dying_cap = ncap;
+  }
+  g_dying[g_dying_len++] = v;
+  return 1;
+}
+
+size_t ps_value_drain(size_t budget) {
+  if (g_draining) return 0;
+  g_draining = 1;
+  size_t n = 0;
+  while (g_dying_len && (!budget || n < budget)) {
+    value_destroy(g_dying[--g_dying_len]);
+    n += 1;
+  }
+  g_draining = 0;
+  // Give back the worklist of a large teardown.
+  if (!g_dying_len && g_dying_cap > 4096) {
+    free(g_dying);
+    g_dying = NULL;
+    g_dying_cap = 0;
+  }
+  return n;
+}
+
+size_t ps_value_pending(void) {
+  return g_dying_len;
+}
+
 void ps_value_free(PS_Value *v) {
   if (!v) return;
+  // Files are closed at once: flushing is observable.
+  if (v->tag == PS_V_FILE || !dying_push(v)) {
+    value_destroy(v);
+    return;
+  }
+  if (g_draining || ps_heaps[v->heap_id]->free_budget) return;
+  ps_value_drain(0);
+}
+
+static void value_destroy(PS_Value *v) {
+  g_value_live -= 1;
+  PS_Heap *h = ps_heaps[v->heap_id];
+  if (h->census) ps_census_untrack(h->census, v);
+  h->values[v->tag] -= 1;
+  h->live_values -= 1;
+  ps_heap_add(h, PS_HEAP_VALUES, -(int64_t)sizeof(PS_Value));
+  size_t payload = ps_value_payload_bytes(v);
+  if (payload) ps_heap_add(h, ps_value_heap_kind(v), -(int64_t)payload);
   switch (v->tag) {
     case PS_V_STRING:
       free(v->as.string_v.ptr);
@@ -47,7 +232,6 @@ void ps_value_free(PS_Value *v) {
       ps_map_free(&v->as.map_v);
       break;
     case PS_V_VIEW:
-      if (v->as.view_v.type_name) free(v->as.view_v.type_name);
       if (v->as.view_v.source) ps_value_release(v->as.view_v.source);
       break;
     case PS_V_ITER:
@@ -60,20 +244,31 @@ void ps_value_free(PS_Value *v) {
       if (v->as.file_v.path) free(v->as.file_v.path);
       break;
     case PS_V_EXCEPTION:
-      free(v->as.exc_v.type_name);
-      free(v->as.exc_v.parent_name);
+      if (!v->as.exc_v.static_names) {
+        free(v->as.exc_v.type_name);
+        free(v->as.exc_v.parent_name);
+      }
       if (v->as.exc_v.fields) ps_value_release(v->as.exc_v.fields);
       if (v->as.exc_v.file) ps_value_release(v->as.exc_v.file);
       if (v->as.exc_v.message) ps_value_release(v->as.exc_v.message);
       if (v->as.exc_v.cause) ps_value_release(v->as.exc_v.cause);
       if (v->as.exc_v.code) ps_value_release(v->as.exc_v.code);
       if (v->as.exc_v.category) ps_value_release(v->as.exc_v.category);
+      free(v->as.exc_v.pending);
       break;
     case PS_V_GROUP:
       break;
+    case PS_V_JSON:
+      if (v->as.json_v.kind >= PS_JSON_KIND_STRING) ps_value_release(v->as.json_v.as.ref);
+      break;
     default:
       break;
   }
+  v->gc_color = GC_BLACK;
+  if (v->gc_flags & GC_BUFFERED) {
+    v->gc_flags |= GC_FREED;
+    return;
+  }
   free(v);
 }
 
@@ -88,7 +283,6 @@ static void ps_list_free(PS_List *l) {
   l->items = NULL;
   l->len = 0;
   l->cap = 0;
-  if (l->type_name) free(l->type_name);
   l->type_name = NULL;
 }
 
@@ -110,7 +304,6 @@ static void ps_object_free(PS_Object *o) {
   o->used = NULL;
   o->cap = 0;
   o->len = 0;
-  if (o->proto_name) free(o->proto_name);
   o->proto_name = NULL;
 }
 
@@ -136,6 +329,232 @@ static void ps_map_free(PS_Map *m) {
   m->len = 0;
   m->order_len = 0;
   m->order_cap = 0;
-  if (m->type_name) free(m->type_name);
   m->type_name = NULL;
 }
+
+void ps_value_children(PS_Value *v, void (*fn)(PS_Value **slot, void *ud), void *ud) {
+  switch (v->tag) {
+    case PS_V_LIST:
+      for (size_t i = 0; i < v->as.list_v.len; i++) {
+        if (v->as.list_v.items[i]) fn(&v->as.list_v.items[i], ud);
+      }
+      break;
+    case PS_V_OBJECT:
+      for (size_t i = 0; i < v->as.object_v.cap; i++) {
+        if (v->as.object_v.used[i] && v->as.object_v.values[i]) fn(&v->as.object_v.values[i], ud);
+      }
+      break;
+    case PS_V_MAP:
+      for (size_t i = 0; i < v->as.map_v.cap; i++) {
+        if (v->as.map_v.used[i] != 1) continue;
+        if (v->as.map_v.keys[i]) fn(&v->as.map_v.keys[i], ud);
+        if (v->as.map_v.values[i]) fn(&v->as.map_v.values[i], ud);
+      }
+      break;
+    case PS_V_VIEW:
+      if (v->as.view_v.source) fn(&v->as.view_v.source, ud);
+      break;
+    case PS_V_ITER:
+      if (v->as.iter_v.source) fn(&v->as.iter_v.source, ud);
+      break;
+    case PS_V_EXCEPTION: {
+      PS_Value **refs[] = {&v->as.exc_v.fields, &v->as.exc_v.file, &v->as.exc_v.message,
+                           &v->as.exc_v.cause,  &v->as.exc_v.code, &v->as.exc_v.category};
+      for (size_t i = 0; i < sizeof(refs) / sizeof(refs[0]); i++) {
+        if (*refs[i]) fn(refs[i], ud);
+      }
+      break;
+    }
+    case PS_V_JSON:
+      if (v->as.json_v.kind >= PS_JSON_KIND_STRING) fn(&v->as.json_v.as.ref, ud);
+      break;
+    default:
+      break;
+  }
+}
+
+// ---- Cycle collection ----
+// Synchronous trial deletion (Bacon & Rajan, "Concurrent Cycle Collection in
+// Reference Counted Systems", 2001). A container whose refcount drops to a
+// nonzero value may have lost the last outside reference to a cycle: it is
+// colored purple and buffered. A collection subtracts the references internal
+// to the subgraph reachable from the buffered roots (gray); nodes that keep a
+// positive count are referenced from outside and restored with everything they
+// reach (black), the rest is garbage (white).
+// Scalars and strings cannot close a cycle and are not walked.
+
+static int gc_container(const PS_Value *v) {
+  switch (v->tag) {
+    case PS_V_LIST:
+    case PS_V_OBJECT:
+    case PS_V_MAP:
+    case PS_V_VIEW:
+    case PS_V_ITER:
+    case PS_V_EXCEPTION:
+      return 1;
+    case PS_V_JSON:
+      return v->as.json_v.kind >= PS_JSON_KIND_ARRAY;
+    default:
+      return 0;
+  }
+}
+
+static void gc_possible_root(PS_Heap *h, PS_Value *v) {
+  if (!gc_container(v)) return;
+  v->gc_color = GC_PURPLE;
+  if (v->gc_flags & GC_BUFFERED) return;
+  if (h->gc_roots_len == h->gc_roots_cap) {
+    size_t ncap = h->gc_roots_cap ? h->gc_roots_cap * 2 : 256;
+    PS_Value **n = (PS_Value **)realloc(h->gc_roots, ncap * sizeof(PS_Value *));
+    if (!n) return; // not buffered: a cycle through v stays uncollected
+    h->gc_roots = n;
+    h->gc_roots_cap = ncap;
+  }
+  v->gc_flags |= GC_BUFFERED;
+  h->gc_roots[h->gc_roots_len++] = v;
+}
+
+// Every phase pushes a value at most once (its color changes when pushed), and
+// scan nests at most one black walk per value, so the stack never holds more
+// than twice the number of live values.
+typedef struct {
+  PS_Value **items;
+  size_t len;
+} GcStack;
+
+static void gc_mark_gray_child(PS_Value **slot, void *ud) {
+  GcStack *st = (GcStack *)ud;
+  PS_Value *c = *slot;
+  if (!gc_container(c)) return;
+  c->refcount -= 1;
+  if (c->gc_color != GC_GRAY) {
+    c->gc_color = GC_GRAY;
+    st->items[st->len++] = c;
+  }
+}
+
+static void gc_mark_gray(GcStack *st, PS_Value *root) {
+  if (root->gc_color == GC_GRAY) return;
+  root->gc_color = GC_GRAY;
+  st->items[st->len++] = root;
+  while (st->len) ps_value_children(st->items[--st->len], gc_mark_gray_child, st);
+}
+
+static void gc_scan_black_child(PS_Value **slot, void *ud) {
+  GcStack *st = (GcStack *)ud;
+  PS_Value *c = *slot;
+  if (!gc_container(c)) return;
+  c->refcount += 1;
+  if (c->gc_color != GC_BLACK) {
+    c->gc_color = GC_BLACK;
+    st->items[st->len++] = c;
+  }
+}
+
+// Restores the counts of everything reachable from v, on top of the stack.
+static void gc_scan_black(GcStack *st, PS_Value *v) {
+  size_t base = st->len;
+  v->gc_color = GC_BLACK;
+  st->items[st->len++] = v;
+  while (st->len > base) ps_value_children(st->items[--st->len], gc_scan_black_child, st);
+}
+
+static void gc_scan_child(PS_Value **slot, void *ud) {
+  GcStack *st = (GcStack *)ud;
+  PS_Value *c = *slot;
+  if (!gc_container(c) || c->gc_color != GC_GRAY) return;
+  c->gc_color = GC_PENDING;
+  st->items[st->len++] = c;
+}
+
+static void gc_scan(GcStack *st, PS_Value *root) {
+  if (root->gc_color != GC_GRAY) return;
+  root->gc_color = GC_PENDING;
+  st->items[st->len++] = root;
+  while (st->len) {
+    PS_Value *v = st->items[--st->len];
+    if (v->gc_color != GC_PENDING) continue; // reached by a black walk meanwhile
+    if (v->refcount > 0) {
+      gc_scan_black(st, v);
+    } else {
+      v->gc_color = GC_WHITE;
+      ps_value_children(v, gc_scan_child, st);
+    }
+  }
+}
+
+static void gc_collect_white_child(PS_Value **slot, void *ud) {
+  GcStack *garbage = (GcStack *)ud;
+  PS_Value *c = *slot;
+  if (!gc_container(c) || c->gc_color != GC_WHITE) return;
+  c->gc_color = GC_GARBAGE;
+  garbage->items[garbage->len++] = c;
+}
+
+// References between garbage values are dropped (all of them are freed);
+// references out of the garbage were subtracted by the trial deletion and are
+// restored, so that freeing releases them normally.
+static void gc_detach_child(PS_Value **slot, void *ud) {
+  (void)ud;
+  PS_Value *c = *slot;
+  if (!gc_container(c)) return;
+  if (c->gc_color == GC_GARBAGE) {
+    *slot = NULL;
+  } else {
+    c->refcount += 1;
+  }
+}
+
+size_t ps_value_collect_cycles(PS_Heap *h) {
+  if (!h->gc_roots_len) return 0;
+  GcStack st;
+  st.len = 0;
+  st.items = (PS_Value **)malloc((2 * g_value_live + 1) * sizeof(PS_Value *));
+  if (!st.items) return 0; // roots stay buffered for the next attempt
+  // Values released from here on are buffered for the next collection.
+  PS_Value **roots = h->gc_roots;
+  size_t n = h->gc_roots_len;
+  h->gc_roots = NULL;
+  h->gc_roots_len = 0;
+  h->gc_roots_cap = 0;
+
+  size_t kept = 0;
+  for (size_t i = 0; i < n; i++) {
+    PS_Value *v = roots[i];
+    if (v->gc_flags & GC_FREED) {
+      free(v);
+      continue;
+    }
+    if (v->refcount <= 0) {
+      v->gc_flags &= (uint8_t)~GC_BUFFERED; // queued for destruction
+      continue;
+    }
+    if (v->gc_color == GC_PURPLE) {
+      gc_mark_gray(&st, v);
+      roots[kept++] = v;
+    } else {
+      v->gc_flags &= (uint8_t)~GC_BUFFERED;
+    }
+  }
+  for (size_t i = 0; i < kept; i++) gc_scan(&st, roots[i]);
+
+  // The stack is reused as the garbage list (breadth-first from the roots).
+  GcStack garbage = {st.items, 0};
+  for (size_t i = 0; i < kept; i++) {
+    PS_Value *v = roots[i];
+    v->gc_flags &= (uint8_t)~GC_BUFFERED;
+    if (v->gc_color != GC_WHITE) continue;
+    v->gc_color = GC_GARBAGE;
+    size_t head = garbage.len;
+    garbage.items[garbage.len++] = v;
+    for (; head < garbage.len; head++) ps_value_children(garbage.items[head], gc_collect_white_child, &garbage);
+  }
+  free(roots);
+
+  for (size_t i = 0; i < garbage.len; i++) ps_value_children(garbage.items[i], gc_detach_child, NULL);
+  for (size_t i = 0; i < garbage.len; i++) ps_value_free(garbage.items[i]);
+  h->gc_runs += 1;
+  h->gc_collected += garbage.len;
+  free(st.items);
+  return garbage.len;
+}
@@ -26,6 +26,7 @@ typedef enum {
   PS_V_FILE,
   PS_V_EXCEPTION,
   PS_V_GROUP,
+  PS_V_JSON,
   PS_V_VOID
 } PS_ValueTag;
 
@@ -44,7 +45,7 @@ typedef struct {
   size_t len;
   size_t cap;
   uint64_t version;
-  char *type_name;
+  const char *type_name; // interned (ps_intern)
 } PS_List;
 
 typedef struct {
@@ -53,7 +54,7 @@ typedef struct {
   uint8_t *used;
   size_t cap;
   size_t len;
-  char *proto_name;
+  const char *proto_name; // interned (ps_intern)
 } PS_Object;
 
 typedef struct {
@@ -65,7 +66,7 @@ typedef struct {
   PS_Value **order;
   size_t order_len;
   size_t order_cap;
-  char *type_name;
+  const char *type_name; // interned (ps_intern)
 } PS_Map;
 
 typedef struct {
@@ -75,7 +76,7 @@ typedef struct {
   size_t len;
   int readonly;
   uint64_t version;
-  char *type_name;
+  const char *type_name; // interned (ps_intern)
 } PS_View;
 
 typedef struct {
@@ -86,22 +87,34 @@ typedef struct {
 
 typedef struct {
   int is_runtime;
+  int static_names; // type_name/parent_name are string literals (not freed)
   char *type_name;
   char *parent_name;
-  PS_Value *fields;
-  PS_Value *file;
+  PS_Value *fields; // created on first custom field store
+  PS_Value *file;   // NULL reads as ""
   int64_t line;
   int64_t column;
   PS_Value *message;
   PS_Value *cause;
   PS_Value *code;
   PS_Value *category;
+  struct PS_Error *pending; // runtime error record not yet turned into message/code/category
 } PS_Exception;
 
 typedef struct {
   const PS_IR_Group *group;
 } PS_GroupDescriptor;
 
+// JSONValue node (ps_make_json*): payload by kind, `ref` is retained.
+typedef struct {
+  PS_JsonKind kind;
+  union {
+    int bool_v;
+    double number_v;
+    PS_Value *ref;
+  } as;
+} PS_JsonNode;
+
 typedef struct {
   FILE *fp;
   uint32_t flags;
@@ -111,6 +124,9 @@ typedef struct {
 
 struct PS_Value {
   PS_ValueTag tag;
+  uint8_t gc_color; // cycle collector state (--gc-cycles), see ps_value.c
+  uint8_t gc_flags;
+  uint16_t heap_id; // owning heap (ps_heaps), charged and refunded for this value
   int64_t refcount;
   union {
     int bool_v;
@@ -128,6 +144,7 @@ struct PS_Value {
     PS_File file_v;
     PS_Exception exc_v;
     PS_GroupDescriptor group_v;
+    PS_JsonNode json_v;
   } as;
 };
 
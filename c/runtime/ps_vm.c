@@ -16,6 +16,7 @@
 #include "ps_map.h"
 #include "ps_modules.h"
 #include "ps_object.h"
+#include "ps_profile.h"
 #include "ps_string.h"
 #include "ps_vm.h"
 #include "ps_vm_internal.h"
@@ -174,6 +175,7 @@ static const char *value_type_name(PS_Value *v) {
     case PS_V_LIST: return "list";
     case PS_V_MAP: return "map";
     case PS_V_OBJECT: return "object";
+    case PS_V_JSON: return "object";
     case PS_V_VIEW: return "view";
     case PS_V_EXCEPTION: return "Exception";
     case PS_V_GROUP: return "group";
@@ -282,11 +284,153 @@ static int glyph_to_utf8(uint32_t g, uint8_t out[4], size_t *out_len) {
   return 0;
 }
 
+// Opcodes are decoded from the IR `op` string once at load time. The typed
+// variants after IR_OP_GENERIC_COUNT are produced by specialize_function from
+// the static types carried by the IR; each keeps a cheap tag guard and falls
+// back to its generic op when the guard fails. Superinstructions (after the
+// typed ops) are installed by fuse_function into IRInstr.fused on the first
+// instruction of the sequence they replace; the original instructions stay in
+// place so a failed guard simply resumes the unfused sequence.
+typedef enum {
+  IR_OP_UNKNOWN = 0,
+  IR_OP_NOP,
+  IR_OP_VAR_DECL,
+  IR_OP_CONST,
+  IR_OP_PUSH_HANDLER,
+  IR_OP_POP_HANDLER,
+  IR_OP_GET_EXCEPTION,
+  IR_OP_RETHROW,
+  IR_OP_EXCEPTION_IS,
+  IR_OP_LOAD_VAR,
+  IR_OP_STORE_VAR,
+  IR_OP_COPY,
+  IR_OP_MEMBER_GET,
+  IR_OP_MEMBER_SET,
+  IR_OP_MAKE_OBJECT,
+  IR_OP_CHECK_DIV_ZERO,
+  IR_OP_CHECK_INT_OVERFLOW_UNARY_MINUS,
+  IR_OP_CHECK_INT_OVERFLOW,
+  IR_OP_CHECK_SHIFT_RANGE,
+  IR_OP_CHECK_INDEX_BOUNDS,
+  IR_OP_CHECK_VIEW_BOUNDS,
+  IR_OP_CHECK_MAP_HAS_KEY,
+  IR_OP_BIN_OP,
+  IR_OP_UNARY_OP,
+  IR_OP_SELECT,
+  IR_OP_MAKE_LIST,
+  IR_OP_MAKE_MAP,
+  IR_OP_MAKE_VIEW,
+  IR_OP_INDEX_GET,
+  IR_OP_INDEX_SET,
+  IR_OP_ITER_BEGIN,
+  IR_OP_BRANCH_ITER_HAS_NEXT,
+  IR_OP_ITER_NEXT,
+  IR_OP_CALL_STATIC,
+  IR_OP_CALL_METHOD_STATIC,
+  IR_OP_CALL_BUILTIN_PRINT,
+  IR_OP_CALL_BUILTIN_TOSTRING,
+  IR_OP_JUMP,
+  IR_OP_BRANCH_IF,
+  IR_OP_RET,
+  IR_OP_RET_VOID,
+  IR_OP_THROW,
+  IR_OP_GENERIC_COUNT,
+  IR_OP_ADD_I64 = IR_OP_GENERIC_COUNT,
+  IR_OP_SUB_I64,
+  IR_OP_MUL_I64,
+  IR_OP_EQ_I64,
+  IR_OP_NE_I64,
+  IR_OP_LT_I64,
+  IR_OP_LE_I64,
+  IR_OP_GT_I64,
+  IR_OP_GE_I64,
+  IR_OP_ADD_F64,
+  IR_OP_SUB_F64,
+  IR_OP_MUL_F64,
+  IR_OP_DIV_F64,
+  IR_OP_LT_F64,
+  IR_OP_LE_F64,
+  IR_OP_GT_F64,
+  IR_OP_GE_F64,
+  IR_OP_CHECK_ADD_I64,
+  IR_OP_CHECK_SUB_I64,
+  IR_OP_LIST_GET,
+  IR_OP_MAP_GET_STR,
+  IR_OP_BRANCH_ITER_HAS_NEXT_LIST,
+  IR_OP_ITER_NEXT_LIST,
+  IR_OP_STRING_LEN,
+  IR_OP_LIST_LEN,
+  IR_OP_LIST_PUSH,
+  IR_OP_INC_LOCAL_CHECKED,
+  IR_OP_ADD_LOCAL_CHECKED,
+  IR_OP_SUB_LOCAL_CHECKED,
+  IR_OP_CMP_BRANCH_EQ_I64,
+  IR_OP_CMP_BRANCH_NE_I64,
+  IR_OP_CMP_BRANCH_LT_I64,
+  IR_OP_CMP_BRANCH_LE_I64,
+  IR_OP_CMP_BRANCH_GT_I64,
+  IR_OP_CMP_BRANCH_GE_I64,
+  IR_OP_FOR_OF_LIST_NEXT,
+  IR_OP_COUNT
+} IROp;
+
+static const char *const IR_OP_NAMES[IR_OP_COUNT] = {
+  "unknown", "nop", "var_decl", "const", "push_handler", "pop_handler", "get_exception", "rethrow",
+  "exception_is", "load_var", "store_var", "copy", "member_get", "member_set", "make_object",
+  "check_div_zero", "check_int_overflow_unary_minus", "check_int_overflow", "check_shift_range",
+  "check_index_bounds", "check_view_bounds", "check_map_has_key", "bin_op", "unary_op", "select",
+  "make_list", "make_map", "make_view", "index_get", "index_set", "iter_begin", "branch_iter_has_next",
+  "iter_next", "call_static", "call_method_static", "call_builtin_print", "call_builtin_tostring", "jump",
+  "branch_if", "ret", "ret_void", "throw",
+  "add_i64", "sub_i64", "mul_i64", "eq_i64", "ne_i64", "lt_i64", "le_i64", "gt_i64", "ge_i64",
+  "add_f64", "sub_f64", "mul_f64", "div_f64", "lt_f64", "le_f64", "gt_f64", "ge_f64",
+  "check_add_i64", "check_sub_i64", "list_get", "map_get_str", "branch_iter_has_next_list",
+  "iter_next_list", "string_len", "list_len", "list_push",
+  "inc_local_checked", "add_local_checked", "sub_local_checked", "cmp_branch_eq_i64", "cmp_branch_ne_i64",
+  "cmp_branch_lt_i64", "cmp_branch_le_i64", "cmp_branch_gt_i64", "cmp_branch_ge_i64", "for_of_list_next",
+};
+
+typedef enum {
+  IR_BIN_NONE = 0,
+  IR_BIN_ADD,
+  IR_BIN_SUB,
+  IR_BIN_MUL,
+  IR_BIN_DIV,
+  IR_BIN_MOD,
+  IR_BIN_SHL,
+  IR_BIN_SHR,
+  IR_BIN_AND,
+  IR_BIN_OR,
+  IR_BIN_XOR,
+  IR_BIN_EQ,
+  IR_BIN_NE,
+  IR_BIN_LT,
+  IR_BIN_LE,
+  IR_BIN_GT,
+  IR_BIN_GE,
+  IR_BIN_LOGICAL_AND,
+  IR_BIN_LOGICAL_OR
+} IRBinOp;
+
 typedef struct {
   char *op;
+  IROp opcode;
+  IRBinOp binop;
+  size_t target_block;
+  size_t then_block;
+  size_t else_block;
+  IROp fused;        // superinstruction starting here (IR_OP_UNKNOWN if none)
+  size_t fused_len;  // instructions covered by `fused`, including this one
+  int64_t imm;       // immediate operand of `fused`
+  const char *aux;   // borrowed name operand of `fused`
+  const char **kills; // temps dead after this instruction (borrowed names)
+  size_t kill_count;
+  int move_src;       // value operand dies here: move it instead of retaining
+  size_t tail_fn;     // `return f(...)`: index + 1 of the callee in the module (0 if not a tail call)
+  size_t handler;     // innermost active exception handler block: index + 1 (0 if none)
   char *dst;
   char *name;
-  char *type;
+  const char *type; // interned
   char *value;
   char *literalType;
   char *left;
@@ -314,7 +458,7 @@ typedef struct {
   char *shift;
   int width;
   char *method;
-  char *proto;
+  const char *proto; // interned
   char *file;
   int line;
   int col;
@@ -337,11 +481,11 @@ typedef struct {
 typedef struct {
   char *name;
   char **params;
-  char **param_types;
+  const char **param_types; // interned
   size_t param_count;
   int variadic;
   size_t variadic_index;
-  char *ret_type;
+  const char *ret_type; // interned
   IRBlock *blocks;
   size_t block_count;
 } IRFunction;
@@ -397,72 +541,144 @@ static int expect_arity(PS_Context *ctx, IRInstr *ins, size_t min, size_t max) {
 }
 
 static void ps_throw_io(PS_Context *ctx, const char *type, const char *msg) {
-  char buf[256];
-  const char *t = type ? type : "IOException";
-  const char *m = msg ? msg : "";
-  snprintf(buf, sizeof(buf), "io:%s:%s", t, m);
-  ps_throw(ctx, PS_ERR_INTERNAL, buf);
-}
-
-static int read_utf8_glyph_stream(PS_Context *ctx, FILE *fp, uint8_t out[4], size_t *out_len) {
-  int c0 = fgetc(fp);
-  if (c0 == EOF) return 0;
-  uint8_t b0 = (uint8_t)c0;
-  if (b0 == 0) {
-    ps_throw_io(ctx, "Utf8DecodeException", "invalid UTF-8 sequence");
-    return -1;
+  ps_throw_typed(ctx, PS_ERR_INTERNAL, type ? type : "IOException", msg ? msg : "");
+}
+
+#define PS_UTF8_READ_CHUNK 65536
+
+// Length of a UTF-8 sequence from its lead byte, 0 for a byte that cannot
+// start one (continuation, 0xF8..0xFF, or NUL which text files reject).
+static size_t utf8_lead_len(uint8_t b0) {
+  if (b0 == 0) return 0;
+  if (b0 < 0x80) return 1;
+  if ((b0 & 0xE0) == 0xC0) return 2;
+  if ((b0 & 0xF0) == 0xE0) return 3;
+  if ((b0 & 0xF8) == 0xF0) return 4;
+  return 0;
+}
+
+// Counts complete glyphs in p[0..len), stopping after max_glyphs. Returns the
+// bytes consumed; an incomplete sequence at the end is left unconsumed for the
+// caller to complete with the next chunk. *invalid is set on a bad sequence.
+static size_t utf8_scan_glyphs(const uint8_t *p, size_t len, size_t max_glyphs, size_t *glyphs, int *invalid) {
+  size_t i = 0;
+  size_t n = *glyphs;
+  while (i < len && n < max_glyphs) {
+    // ASCII runs are the common case: take 8 bytes at once when none has the
+    // high bit set and none is NUL.
+    while (i + 8 <= len && max_glyphs - n >= 8) {
+      uint64_t v;
+      memcpy(&v, p + i, 8);
+      if ((v | ((v - 0x0101010101010101ULL) & ~v)) & 0x8080808080808080ULL) break;
+      i += 8;
+      n += 8;
+    }
+    if (i >= len || n >= max_glyphs) break;
+    uint8_t b0 = p[i];
+    size_t glen = utf8_lead_len(b0);
+    if (glen == 0) {
+      *invalid = 1;
+      break;
+    }
+    if (glen == 1) {
+      i += 1;
+      n += 1;
+      continue;
+    }
+    uint32_t cp = (uint32_t)(b0 & (0x7F >> glen));
+    size_t k = 1;
+    for (; k < glen && i + k < len; k++) {
+      uint8_t bk = p[i + k];
+      if ((bk & 0xC0) != 0x80) {
+        *invalid = 1;
+        break;
+      }
+      cp = (cp << 6) | (uint32_t)(bk & 0x3F);
+    }
+    if (*invalid || k < glen) break;
+    if ((glen == 2 && cp < 0x80) || (glen == 3 && cp < 0x800) ||
+        (glen == 4 && (cp < 0x10000 || cp > 0x10FFFF))) {
+      *invalid = 1;
+      break;
+    }
+    i += glen;
+    n += 1;
   }
-  size_t len = 0;
-  uint32_t cp = 0;
-  if (b0 < 0x80) {
-    len = 1;
-    cp = b0;
-  } else if ((b0 & 0xE0) == 0xC0) {
-    len = 2;
-    cp = (uint32_t)(b0 & 0x1F);
-  } else if ((b0 & 0xF0) == 0xE0) {
-    len = 3;
-    cp = (uint32_t)(b0 & 0x0F);
-  } else if ((b0 & 0xF8) == 0xF0) {
-    len = 4;
-    cp = (uint32_t)(b0 & 0x07);
-  } else {
-    ps_throw_io(ctx, "Utf8DecodeException", "invalid UTF-8 sequence");
+  *glyphs = n;
+  return i;
+}
+
+// Reads up to max_glyphs glyphs (and at most max_bytes bytes) from fp, in
+// blocks. Every glyph is at least one byte, so a block never asks for more
+// bytes than glyphs still wanted: the stream is never read past the last
+// glyph returned, which keeps stdin and other unseekable streams exact. A
+// sequence split across two blocks is carried over to the next one.
+// The block buffer holds at most max_glyphs bytes plus a carried sequence
+// (3 bytes), so a short read does not allocate a full block.
+// When out is non-NULL the bytes are appended to *out (capacity *out_cap),
+// always leaving room for a terminator.
+// Returns 1 on success, 0 when max_bytes ends inside a glyph, -1 after
+// throwing.
+static int read_utf8_glyphs(PS_Context *ctx, FILE *fp, size_t max_glyphs, size_t max_bytes, uint8_t **out, size_t *out_cap,
+                            size_t *out_glyphs, size_t *out_bytes) {
+  size_t chunk_size = PS_UTF8_READ_CHUNK;
+  if (max_glyphs < chunk_size - 3) chunk_size = max_glyphs + 3;
+  uint8_t *chunk = (uint8_t *)malloc(chunk_size);
+  if (!chunk) {
+    ps_throw_diag(ctx, PS_ERR_OOM, "out of memory", "read buffer allocation failed", "available memory");
     return -1;
   }
-  out[0] = b0;
-  for (size_t i = 1; i < len; i++) {
-    int ci = fgetc(fp);
-    if (ci == EOF) {
-      ps_throw_io(ctx, "Utf8DecodeException", "invalid UTF-8 sequence");
-      return -1;
+  size_t glyphs = 0;
+  size_t bytes = 0;
+  size_t carry = 0;
+  int rc = 1;
+  while (glyphs < max_glyphs && bytes + carry < max_bytes) {
+    size_t ask = chunk_size - carry;
+    if (ask > max_glyphs - glyphs) ask = max_glyphs - glyphs;
+    if (ask > max_bytes - bytes - carry) ask = max_bytes - bytes - carry;
+    size_t got = fread(chunk + carry, 1, ask, fp);
+    if (got == 0) {
+      if (ferror(fp)) {
+        ps_throw_io(ctx, "ReadFailureException", "read failed");
+        rc = -1;
+      } else if (carry > 0) {
+        ps_throw_io(ctx, "Utf8DecodeException", "invalid UTF-8 sequence");
+        rc = -1;
+      }
+      break;
     }
-    uint8_t bi = (uint8_t)ci;
-    if ((bi & 0xC0) != 0x80) {
+    size_t avail = carry + got;
+    int invalid = 0;
+    size_t used = utf8_scan_glyphs(chunk, avail, max_glyphs, &glyphs, &invalid);
+    if (invalid) {
       ps_throw_io(ctx, "Utf8DecodeException", "invalid UTF-8 sequence");
-      return -1;
+      rc = -1;
+      break;
     }
-    if (bi == 0) {
-      ps_throw_io(ctx, "Utf8DecodeException", "invalid UTF-8 sequence");
-      return -1;
+    if (out && used > 0) {
+      if (bytes + used + 1 > *out_cap) {
+        size_t cap = *out_cap ? *out_cap : 16;
+        while (cap < bytes + used + 1) cap *= 2;
+        uint8_t *nbuf = (uint8_t *)realloc(*out, cap);
+        if (!nbuf) {
+          ps_throw_diag(ctx, PS_ERR_OOM, "out of memory", "read buffer allocation failed", "available memory");
+          rc = -1;
+          break;
+        }
+        *out = nbuf;
+        *out_cap = cap;
+      }
+      memcpy(*out + bytes, chunk, used);
     }
-    out[i] = bi;
-    cp = (cp << 6) | (uint32_t)(bi & 0x3F);
+    bytes += used;
+    carry = avail - used;
+    if (carry > 0) memmove(chunk, chunk + used, carry);
   }
-  if (len == 2 && cp < 0x80) {
-    ps_throw_io(ctx, "Utf8DecodeException", "invalid UTF-8 sequence");
-    return -1;
-  }
-  if (len == 3 && cp < 0x800) {
-    ps_throw_io(ctx, "Utf8DecodeException", "invalid UTF-8 sequence");
-    return -1;
-  }
-  if (len == 4 && (cp < 0x10000 || cp > 0x10FFFF)) {
-    ps_throw_io(ctx, "Utf8DecodeException", "invalid UTF-8 sequence");
-    return -1;
-  }
-  *out_len = len;
-  return 1;
+  if (rc == 1 && carry > 0) rc = 0;
+  free(chunk);
+  *out_glyphs = glyphs;
+  *out_bytes = bytes;
+  return rc;
 }
 
 static int64_t file_size_bytes(PS_Context *ctx, PS_File *f) {
@@ -485,83 +701,42 @@ static int64_t file_tell_bytes(PS_Context *ctx, PS_File *f) {
 static int64_t file_size_glyphs(PS_Context *ctx, PS_File *f) {
   long cur = ftell(f->fp);
   fseek(f->fp, 0, SEEK_SET);
-  int64_t count = 0;
-  while (1) {
-    uint8_t g[4];
-    size_t glen = 0;
-    int r = read_utf8_glyph_stream(ctx, f->fp, g, &glen);
-    if (r == 0) break;
-    if (r < 0) {
-      if (cur >= 0) fseek(f->fp, cur, SEEK_SET);
-      return -1;
-    }
-    count += 1;
-  }
+  size_t count = 0;
+  size_t bytes = 0;
+  int r = read_utf8_glyphs(ctx, f->fp, SIZE_MAX, SIZE_MAX, NULL, NULL, &count, &bytes);
   if (cur >= 0) fseek(f->fp, cur, SEEK_SET);
-  return count;
+  if (r < 0) return -1;
+  return (int64_t)count;
 }
 
 static int64_t file_tell_glyphs(PS_Context *ctx, PS_File *f) {
   long cur = ftell(f->fp);
   if (cur < 0) return -1;
+  if (cur == 0) return 0;
   fseek(f->fp, 0, SEEK_SET);
-  int64_t count = 0;
-  long pos = 0;
-  if (cur == 0) {
-    fseek(f->fp, cur, SEEK_SET);
-    return 0;
-  }
-  while (1) {
-    uint8_t g[4];
-    size_t glen = 0;
-    int r = read_utf8_glyph_stream(ctx, f->fp, g, &glen);
-    if (r == 0) break;
-    if (r < 0) {
-      fseek(f->fp, cur, SEEK_SET);
-      return -1;
-    }
-    pos += (long)glen;
-    count += 1;
-    if (pos == cur) {
-      fseek(f->fp, cur, SEEK_SET);
-      return count;
-    }
-    if (pos > cur) break;
-  }
+  size_t count = 0;
+  size_t bytes = 0;
+  int r = read_utf8_glyphs(ctx, f->fp, SIZE_MAX, (size_t)cur, NULL, NULL, &count, &bytes);
   fseek(f->fp, cur, SEEK_SET);
+  if (r < 0) return -1;
+  if (r == 1 && bytes == (size_t)cur) return (int64_t)count;
   ps_throw_io(ctx, "InvalidGlyphPositionException", "invalid tell position");
   return -1;
 }
 
 static int file_seek_glyphs(PS_Context *ctx, PS_File *f, int64_t pos) {
   if (pos < 0) {
-    char got[64];
-    snprintf(got, sizeof(got), "%lld", (long long)pos);
     ps_throw_io(ctx, "InvalidArgumentException", "invalid seek position");
     return 0;
   }
   fseek(f->fp, 0, SEEK_SET);
   if (pos == 0) return 1;
-  int64_t count = 0;
-  long byte_pos = 0;
-  while (1) {
-    uint8_t g[4];
-    size_t glen = 0;
-    int r = read_utf8_glyph_stream(ctx, f->fp, g, &glen);
-    if (r == 0) break;
-    if (r < 0) return 0;
-    count += 1;
-    byte_pos += (long)glen;
-    if (count == pos) {
-      fseek(f->fp, byte_pos, SEEK_SET);
-      return 1;
-    }
-  }
-  {
-    char got[64];
-    snprintf(got, sizeof(got), "%lld", (long long)pos);
-    ps_throw_io(ctx, "InvalidGlyphPositionException", "seek out of range");
-  }
+  size_t count = 0;
+  size_t bytes = 0;
+  int r = read_utf8_glyphs(ctx, f->fp, (size_t)pos, SIZE_MAX, NULL, NULL, &count, &bytes);
+  if (r < 0) return 0;
+  if ((int64_t)count == pos) return 1;
+  ps_throw_io(ctx, "InvalidGlyphPositionException", "seek out of range");
   return 0;
 }
 
@@ -577,6 +752,15 @@ static void bindings_free(PS_Bindings *b) {
   b->cap = 0;
 }
 
+// Drops every binding but keeps the storage for reuse by the same frame.
+static void bindings_reset(PS_Bindings *b) {
+  for (size_t i = 0; i < b->len; i++) {
+    free(b->items[i].name);
+    if (b->items[i].value) ps_value_release(b->items[i].value);
+  }
+  b->len = 0;
+}
+
 static PS_Value *bindings_get(PS_Bindings *b, const char *name) {
   for (size_t i = 0; i < b->len; i++) {
     if (strcmp(b->items[i].name, name) == 0) return b->items[i].value;
@@ -584,38 +768,65 @@ static PS_Value *bindings_get(PS_Bindings *b, const char *name) {
   return NULL;
 }
 
-static void bindings_set(PS_Bindings *b, const char *name, PS_Value *v) {
+// Binds `v` under `name`, taking over the caller's reference.
+static void bindings_set_owned(PS_Bindings *b, const char *name, PS_Value *v) {
   for (size_t i = 0; i < b->len; i++) {
     if (strcmp(b->items[i].name, name) == 0) {
       if (b->items[i].value) ps_value_release(b->items[i].value);
-      b->items[i].value = v ? ps_value_retain(v) : NULL;
+      b->items[i].value = v;
       return;
     }
   }
   if (b->len == b->cap) {
     size_t new_cap = b->cap == 0 ? 16 : b->cap * 2;
     PS_Binding *n = (PS_Binding *)realloc(b->items, sizeof(PS_Binding) * new_cap);
-    if (!n) return;
+    if (!n) {
+      if (v) ps_value_release(v);
+      return;
+    }
     b->items = n;
     b->cap = new_cap;
   }
   b->items[b->len].name = strdup(name);
-  b->items[b->len].value = v ? ps_value_retain(v) : NULL;
+  b->items[b->len].value = v;
   b->len += 1;
 }
 
+static void bindings_set(PS_Bindings *b, const char *name, PS_Value *v) {
+  bindings_set_owned(b, name, v ? ps_value_retain(v) : NULL);
+}
+
+// Unbinds `name` and hands its reference to the caller (NULL if unbound).
+static PS_Value *bindings_take(PS_Bindings *b, const char *name) {
+  for (size_t i = 0; i < b->len; i++) {
+    if (strcmp(b->items[i].name, name) == 0) {
+      PS_Value *v = b->items[i].value;
+      b->items[i].value = NULL;
+      return v;
+    }
+  }
+  return NULL;
+}
+
+static void bindings_clear(PS_Bindings *b, const char *name) {
+  PS_Value *v = bindings_take(b, name);
+  if (v) ps_value_release(v);
+}
+
 static char *dup_json_string(PS_JsonValue *v) {
   if (!v || v->type != PS_JSON_STRING) return NULL;
   return strdup(v->as.str_v);
 }
 
-static char *parse_type_name(PS_JsonValue *v) {
+static const char *intern_json_string(PS_JsonValue *v) {
+  if (!v || v->type != PS_JSON_STRING) return NULL;
+  return ps_intern(v->as.str_v);
+}
+
+static const char *parse_type_name(PS_JsonValue *v) {
   if (!v) return NULL;
-  if (v->type == PS_JSON_STRING) return strdup(v->as.str_v);
-  if (v->type == PS_JSON_OBJECT) {
-    PS_JsonValue *n = ps_json_obj_get(v, "name");
-    if (n && n->type == PS_JSON_STRING) return strdup(n->as.str_v);
-  }
+  if (v->type == PS_JSON_STRING) return ps_intern(v->as.str_v);
+  if (v->type == PS_JSON_OBJECT) return intern_json_string(ps_json_obj_get(v, "name"));
   return NULL;
 }
 
@@ -633,10 +844,10 @@ static char *dup_trimmed_range(const char *start, size_t len) {
   return out;
 }
 
-static char *extract_generic_inner(const char *type_name) {
-  if (!type_name) return NULL;
+static int generic_inner_range(const char *type_name, const char **out, size_t *out_len) {
+  if (!type_name) return 0;
   const char *lt = strchr(type_name, '<');
-  if (!lt) return NULL;
+  if (!lt) return 0;
   const char *p = lt + 1;
   int depth = 0;
   while (*p) {
@@ -647,17 +858,59 @@ static char *extract_generic_inner(const char *type_name) {
     }
     p += 1;
   }
-  if (*p != '>') return NULL;
-  return dup_trimmed_range(lt + 1, (size_t)(p - (lt + 1)));
+  if (*p != '>') return 0;
+  const char *start = lt + 1;
+  while (start < p && (*start == ' ' || *start == '\t' || *start == '\n' || *start == '\r')) start += 1;
+  while (p > start && (p[-1] == ' ' || p[-1] == '\t' || p[-1] == '\n' || p[-1] == '\r')) p -= 1;
+  *out = start;
+  *out_len = (size_t)(p - start);
+  return 1;
+}
+
+static char *extract_generic_inner(const char *type_name) {
+  const char *inner = NULL;
+  size_t len = 0;
+  if (!generic_inner_range(type_name, &inner, &len)) return NULL;
+  return dup_trimmed_range(inner, len);
 }
 
-static char *make_view_type_name(const char *kind, const char *inner) {
-  if (!kind || !inner) return NULL;
-  size_t len = strlen(kind) + 2 + strlen(inner) + 1;
-  char *out = (char *)calloc(len, 1);
+// Interned "kind<inner>" name of a slice ("view<int>").
+static const char *intern_view_type_name(const char *kind, const char *inner, size_t inner_len) {
+  char buf[256];
+  int n = snprintf(buf, sizeof(buf), "%s<%.*s>", kind, (int)inner_len, inner);
+  if (n < 0) return NULL;
+  if ((size_t)n < sizeof(buf)) return ps_intern(buf);
+  char *out = (char *)malloc((size_t)n + 1);
   if (!out) return NULL;
-  snprintf(out, len, "%s<%s>", kind, inner);
-  return out;
+  snprintf(out, (size_t)n + 1, "%s<%.*s>", kind, (int)inner_len, inner);
+  const char *name = ps_intern(out);
+  free(out);
+  return name;
+}
+
+static IROp decode_op(const char *op) {
+  if (!op) return IR_OP_UNKNOWN;
+  for (int i = 1; i < IR_OP_GENERIC_COUNT; i++) {
+    if (strcmp(IR_OP_NAMES[i], op) == 0) return (IROp)i;
+  }
+  return IR_OP_UNKNOWN;
+}
+
+static IRBinOp decode_binop(const char *op) {
+  static const struct {
+    const char *text;
+    IRBinOp op;
+  } table[] = {
+    {"+", IR_BIN_ADD}, {"-", IR_BIN_SUB}, {"*", IR_BIN_MUL}, {"/", IR_BIN_DIV}, {"%", IR_BIN_MOD},
+    {"<<", IR_BIN_SHL}, {">>", IR_BIN_SHR}, {"&", IR_BIN_AND}, {"|", IR_BIN_OR}, {"^", IR_BIN_XOR},
+    {"==", IR_BIN_EQ}, {"!=", IR_BIN_NE}, {"<", IR_BIN_LT}, {"<=", IR_BIN_LE}, {">", IR_BIN_GT},
+    {">=", IR_BIN_GE}, {"&&", IR_BIN_LOGICAL_AND}, {"||", IR_BIN_LOGICAL_OR},
+  };
+  if (!op) return IR_BIN_NONE;
+  for (size_t i = 0; i < sizeof(table) / sizeof(table[0]); i++) {
+    if (strcmp(table[i].text, op) == 0) return table[i].op;
+  }
+  return IR_BIN_NONE;
 }
 
 static IRInstr parse_instr(PS_JsonValue *obj) {
@@ -676,6 +929,8 @@ static IRInstr parse_instr(PS_JsonValue *obj) {
   ins.left = dup_json_string(ps_json_obj_get(obj, "left"));
   ins.right = dup_json_string(ps_json_obj_get(obj, "right"));
   ins.operator = dup_json_string(ps_json_obj_get(obj, "operator"));
+  ins.opcode = decode_op(ins.op);
+  ins.binop = decode_binop(ins.operator);
   ins.cond = dup_json_string(ps_json_obj_get(obj, "cond"));
   ins.then_label = dup_json_string(ps_json_obj_get(obj, "then"));
   ins.else_label = dup_json_string(ps_json_obj_get(obj, "else"));
@@ -699,7 +954,7 @@ static IRInstr parse_instr(PS_JsonValue *obj) {
   PS_JsonValue *w = ps_json_obj_get(obj, "width");
   if (w && w->type == PS_JSON_NUMBER) ins.width = (int)w->as.num_v;
   ins.method = dup_json_string(ps_json_obj_get(obj, "method"));
-  ins.proto = dup_json_string(ps_json_obj_get(obj, "proto"));
+  ins.proto = intern_json_string(ps_json_obj_get(obj, "proto"));
   ins.file = dup_json_string(ps_json_obj_get(obj, "file"));
   PS_JsonValue *ln = ps_json_obj_get(obj, "line");
   if (ln && ln->type == PS_JSON_NUMBER) ins.line = (int)ln->as.num_v;
@@ -734,10 +989,10 @@ static IRInstr parse_instr(PS_JsonValue *obj) {
 }
 
 static void free_instr(IRInstr *i) {
+  free((void *)i->kills);
   free(i->op);
   free(i->dst);
   free(i->name);
-  free(i->type);
   free(i->value);
   free(i->literalType);
   free(i->left);
@@ -764,7 +1019,6 @@ static void free_instr(IRInstr *i) {
   free(i->elseValue);
   free(i->shift);
   free(i->method);
-  free(i->proto);
   free(i->file);
   if (i->args) {
     for (size_t j = 0; j < i->arg_count; j++) free(i->args[j]);
@@ -779,113 +1033,939 @@ static void free_instr(IRInstr *i) {
   free(i->pairs);
 }
 
-PS_IR_Module *ps_ir_load_json(PS_Context *ctx, const char *json, size_t len) {
-  (void)ctx;
-  const char *err = NULL;
-  PS_JsonValue *root = ps_json_parse(json, len, &err);
-  if (!root) {
-    ps_throw_diag(ctx, PS_ERR_INTERNAL, "invalid IR", err ? err : "parse failed", "valid IR JSON");
-    return NULL;
+// ---------------------------------------------------------------------------
+// Load-time specialization: static types carried by the IR (load_var/const/
+// make_list annotations) are propagated through temps, then generic ops whose
+// operand types are fully known are rewritten to typed opcodes.
+// ---------------------------------------------------------------------------
+
+static size_t find_block(IRFunction *f, const char *label);
+static IRFunction *find_fn(PS_IR_Module *m, const char *name);
+
+typedef struct {
+  const char *name;
+  const char *type;
+} IRTypeSlot;
+
+typedef struct {
+  IRTypeSlot *slots;
+  size_t cap;
+  char **owned;
+  size_t owned_len;
+  size_t owned_cap;
+} IRTypeEnv;
+
+static const char IR_TYPE_CONFLICT[] = "<conflict>";
+
+static uint32_t ir_name_hash(const char *s) {
+  uint32_t h = 2166136261u;
+  while (*s) {
+    h ^= (uint8_t)*s++;
+    h *= 16777619u;
   }
-  PS_JsonValue *module = ps_json_obj_get(root, "module");
-  PS_JsonValue *functions = module ? ps_json_obj_get(module, "functions") : NULL;
-  if (!functions || functions->type != PS_JSON_ARRAY) {
-    ps_json_free(root);
-    ps_throw_diag(ctx, PS_ERR_INTERNAL, "invalid IR", "missing functions", "valid IR JSON");
-    return NULL;
+  return h;
+}
+
+static int type_env_init(IRTypeEnv *env, size_t names) {
+  memset(env, 0, sizeof(*env));
+  size_t cap = 16;
+  while (cap < names * 2) cap *= 2;
+  env->slots = (IRTypeSlot *)calloc(cap, sizeof(IRTypeSlot));
+  if (!env->slots) return 0;
+  env->cap = cap;
+  return 1;
+}
+
+static void type_env_free(IRTypeEnv *env) {
+  for (size_t i = 0; i < env->owned_len; i++) free(env->owned[i]);
+  free(env->owned);
+  free(env->slots);
+}
+
+// Keeps derived type names (element/value types) alive for the whole pass.
+static const char *type_env_own(IRTypeEnv *env, char *s) {
+  if (!s) return NULL;
+  if (env->owned_len == env->owned_cap) {
+    size_t nc = env->owned_cap == 0 ? 8 : env->owned_cap * 2;
+    char **n = (char **)realloc(env->owned, sizeof(char *) * nc);
+    if (!n) {
+      free(s);
+      return NULL;
+    }
+    env->owned = n;
+    env->owned_cap = nc;
   }
-  PS_IR_Module *m = (PS_IR_Module *)calloc(1, sizeof(PS_IR_Module));
-  if (!m) {
-    ps_json_free(root);
-    ps_throw_diag(ctx, PS_ERR_OOM, "out of memory", "IR module allocation failed", "available memory");
-    return NULL;
+  env->owned[env->owned_len++] = s;
+  return s;
+}
+
+static IRTypeSlot *type_env_slot(IRTypeEnv *env, const char *name) {
+  size_t mask = env->cap - 1;
+  size_t i = ir_name_hash(name) & mask;
+  while (env->slots[i].name && strcmp(env->slots[i].name, name) != 0) i = (i + 1) & mask;
+  return &env->slots[i];
+}
+
+static const char *type_env_get(IRTypeEnv *env, const char *name) {
+  if (!name) return NULL;
+  IRTypeSlot *s = type_env_slot(env, name);
+  if (!s->name || s->type == IR_TYPE_CONFLICT) return NULL;
+  return s->type;
+}
+
+// A name seen with two different static types is never specialized.
+static void type_env_put(IRTypeEnv *env, const char *name, const char *type) {
+  if (!name || !type || strcmp(type, "unknown") == 0) return;
+  IRTypeSlot *s = type_env_slot(env, name);
+  if (!s->name) {
+    s->name = name;
+    s->type = type;
+  } else if (s->type != IR_TYPE_CONFLICT && strcmp(s->type, type) != 0) {
+    s->type = IR_TYPE_CONFLICT;
   }
-  PS_JsonValue *protos = module ? ps_json_obj_get(module, "prototypes") : NULL;
-  if (protos && protos->type == PS_JSON_ARRAY) {
-    m->proto_count = protos->as.array_v.len;
-    m->protos = (PS_IR_Proto *)calloc(m->proto_count, sizeof(PS_IR_Proto));
-    if (!m->protos) {
-      free(m);
-      ps_json_free(root);
-      ps_throw_diag(ctx, PS_ERR_OOM, "out of memory", "IR prototype allocation failed", "available memory");
+}
+
+static int type_is(const char *t, const char *name) { return t && strcmp(t, name) == 0; }
+
+static int type_has_kind(const char *t, const char *kind) {
+  size_t n = strlen(kind);
+  return t && strncmp(t, kind, n) == 0 && t[n] == '<';
+}
+
+// Splits "map<K,V>" into its key and value type names.
+static int split_map_type(IRTypeEnv *env, const char *t, const char **key, const char **val) {
+  char *inner = extract_generic_inner(t);
+  if (!inner) return 0;
+  int depth = 0;
+  char *comma = NULL;
+  for (char *p = inner; *p; p++) {
+    if (*p == '<') depth += 1;
+    else if (*p == '>') depth -= 1;
+    else if (*p == ',' && depth == 0) {
+      comma = p;
+      break;
+    }
+  }
+  if (!comma) {
+    free(inner);
+    return 0;
+  }
+  *key = type_env_own(env, dup_trimmed_range(inner, (size_t)(comma - inner)));
+  *val = type_env_own(env, dup_trimmed_range(comma + 1, strlen(comma + 1)));
+  free(inner);
+  return *key && *val;
+}
+
+static const char *infer_bin_op_type(const IRInstr *ins, const char *lt, const char *rt) {
+  switch (ins->binop) {
+    case IR_BIN_EQ:
+    case IR_BIN_NE:
+    case IR_BIN_LT:
+    case IR_BIN_LE:
+    case IR_BIN_GT:
+    case IR_BIN_GE:
+    case IR_BIN_LOGICAL_AND:
+    case IR_BIN_LOGICAL_OR:
+      return "bool";
+    case IR_BIN_NONE:
       return NULL;
+    default:
+      break;
+  }
+  if (type_is(lt, "int") && type_is(rt, "int")) return "int";
+  if (type_is(lt, "float") && type_is(rt, "float")) return "float";
+  return NULL;
+}
+
+static void infer_instr_type(IRTypeEnv *env, IRTypeEnv *iters, const IRInstr *ins) {
+  switch (ins->opcode) {
+    case IR_OP_CONST:
+      type_env_put(env, ins->dst, ins->literalType);
+      break;
+    case IR_OP_LOAD_VAR:
+      type_env_put(env, ins->dst, ins->type);
+      break;
+    case IR_OP_COPY:
+      type_env_put(env, ins->dst, type_env_get(env, ins->src));
+      break;
+    case IR_OP_BIN_OP:
+      type_env_put(env, ins->dst, infer_bin_op_type(ins, type_env_get(env, ins->left), type_env_get(env, ins->right)));
+      break;
+    case IR_OP_UNARY_OP: {
+      const char *st = type_env_get(env, ins->src);
+      if (ins->operator && strcmp(ins->operator, "!") == 0) type_env_put(env, ins->dst, "bool");
+      else if (type_is(st, "int") || type_is(st, "float")) type_env_put(env, ins->dst, st);
+      break;
     }
-    for (size_t pi = 0; pi < m->proto_count; pi++) {
-      PS_JsonValue *p = protos->as.array_v.items[pi];
-      m->protos[pi].name = dup_json_string(ps_json_obj_get(p, "name"));
-      m->protos[pi].parent = dup_json_string(ps_json_obj_get(p, "parent"));
-      PS_JsonValue *ps = ps_json_obj_get(p, "sealed");
-      if (ps && ps->type == PS_JSON_BOOL) m->protos[pi].is_sealed = ps->as.bool_v ? 1 : 0;
-      PS_JsonValue *fields = ps_json_obj_get(p, "fields");
-      if (fields && fields->type == PS_JSON_ARRAY) {
-        m->protos[pi].field_count = fields->as.array_v.len;
-        m->protos[pi].fields = (void *)calloc(m->protos[pi].field_count, sizeof(*m->protos[pi].fields));
-        if (!m->protos[pi].fields && m->protos[pi].field_count > 0) {
-          ps_json_free(root);
-          ps_throw_diag(ctx, PS_ERR_OOM, "out of memory", "IR prototype fields allocation failed", "available memory");
-          ps_ir_free(m);
-          return NULL;
-        }
-        for (size_t fi = 0; fi < m->protos[pi].field_count; fi++) {
-          PS_JsonValue *f = fields->as.array_v.items[fi];
-          m->protos[pi].fields[fi].name = dup_json_string(ps_json_obj_get(f, "name"));
-          m->protos[pi].fields[fi].type = parse_type_name(ps_json_obj_get(f, "type"));
-        }
+    case IR_OP_CALL_BUILTIN_TOSTRING:
+      type_env_put(env, ins->dst, "string");
+      break;
+    case IR_OP_MAKE_LIST:
+    case IR_OP_MAKE_MAP:
+      type_env_put(env, ins->dst, ins->type);
+      break;
+    case IR_OP_INDEX_GET: {
+      const char *tt = type_env_get(env, ins->target);
+      if (type_has_kind(tt, "list")) {
+        type_env_put(env, ins->dst, type_env_own(env, extract_generic_inner(tt)));
+      } else if (type_is(tt, "string")) {
+        type_env_put(env, ins->dst, "glyph");
+      } else if (type_has_kind(tt, "map")) {
+        const char *kt = NULL;
+        const char *vt = NULL;
+        if (split_map_type(env, tt, &kt, &vt)) type_env_put(env, ins->dst, vt);
       }
-      PS_JsonValue *methods = ps_json_obj_get(p, "methods");
-      if (methods && methods->type == PS_JSON_ARRAY) {
-        m->protos[pi].method_count = methods->as.array_v.len;
-        m->protos[pi].methods = (void *)calloc(m->protos[pi].method_count, sizeof(*m->protos[pi].methods));
-        if (!m->protos[pi].methods && m->protos[pi].method_count > 0) {
-          ps_json_free(root);
-          ps_throw_diag(ctx, PS_ERR_OOM, "out of memory", "IR prototype methods allocation failed", "available memory");
-          ps_ir_free(m);
-          return NULL;
-        }
-        for (size_t mi = 0; mi < m->protos[pi].method_count; mi++) {
-          PS_JsonValue *md = methods->as.array_v.items[mi];
-          m->protos[pi].methods[mi].name = dup_json_string(ps_json_obj_get(md, "name"));
-          m->protos[pi].methods[mi].ret_type = parse_type_name(ps_json_obj_get(md, "returnType"));
-          PS_JsonValue *params = ps_json_obj_get(md, "params");
-          if (params && params->type == PS_JSON_ARRAY) {
-            m->protos[pi].methods[mi].param_count = params->as.array_v.len;
-            m->protos[pi].methods[mi].params = (void *)calloc(m->protos[pi].methods[mi].param_count, sizeof(*m->protos[pi].methods[mi].params));
-            if (!m->protos[pi].methods[mi].params && m->protos[pi].methods[mi].param_count > 0) {
-              ps_json_free(root);
-              ps_throw_diag(ctx, PS_ERR_OOM, "out of memory", "IR prototype method params allocation failed", "available memory");
-              ps_ir_free(m);
-              return NULL;
-            }
-            for (size_t pj = 0; pj < m->protos[pi].methods[mi].param_count; pj++) {
-              PS_JsonValue *pv = params->as.array_v.items[pj];
-              m->protos[pi].methods[mi].params[pj].name = dup_json_string(ps_json_obj_get(pv, "name"));
-              m->protos[pi].methods[mi].params[pj].type = parse_type_name(ps_json_obj_get(pv, "type"));
-              PS_JsonValue *v = ps_json_obj_get(pv, "variadic");
-              if (v && v->type == PS_JSON_BOOL && v->as.bool_v) m->protos[pi].methods[mi].params[pj].variadic = 1;
-            }
-          }
+      break;
+    }
+    case IR_OP_ITER_BEGIN:
+      type_env_put(iters, ins->dst, type_env_get(env, ins->source));
+      break;
+    case IR_OP_ITER_NEXT: {
+      const char *st = type_env_get(iters, ins->iter);
+      if (type_has_kind(st, "list")) type_env_put(env, ins->dst, type_env_own(env, extract_generic_inner(st)));
+      break;
+    }
+    case IR_OP_CALL_METHOD_STATIC: {
+      const char *rt = type_env_get(env, ins->receiver);
+      if (ins->method && (type_is(rt, "string") || type_has_kind(rt, "list"))) {
+        if (strcmp(ins->method, "length") == 0 || (type_has_kind(rt, "list") && strcmp(ins->method, "push") == 0)) {
+          type_env_put(env, ins->dst, "int");
         }
       }
+      break;
     }
+    default:
+      break;
   }
-  PS_JsonValue *groups = module ? ps_json_obj_get(module, "groups") : NULL;
-  if (groups && groups->type == PS_JSON_ARRAY) {
-    m->group_count = groups->as.array_v.len;
-    if (m->group_count > 0) {
-      m->groups = (PS_IR_Group *)calloc(m->group_count, sizeof(PS_IR_Group));
-      if (!m->groups) {
-        ps_json_free(root);
-        ps_throw_diag(ctx, PS_ERR_OOM, "out of memory", "IR group allocation failed", "available memory");
-        ps_ir_free(m);
-        return NULL;
+}
+
+static IROp specialize_bin_op(IRBinOp op, const char *lt, const char *rt) {
+  if (type_is(lt, "int") && type_is(rt, "int")) {
+    switch (op) {
+      case IR_BIN_ADD: return IR_OP_ADD_I64;
+      case IR_BIN_SUB: return IR_OP_SUB_I64;
+      case IR_BIN_MUL: return IR_OP_MUL_I64;
+      case IR_BIN_EQ: return IR_OP_EQ_I64;
+      case IR_BIN_NE: return IR_OP_NE_I64;
+      case IR_BIN_LT: return IR_OP_LT_I64;
+      case IR_BIN_LE: return IR_OP_LE_I64;
+      case IR_BIN_GT: return IR_OP_GT_I64;
+      case IR_BIN_GE: return IR_OP_GE_I64;
+      default: return IR_OP_BIN_OP;
+    }
+  }
+  if (type_is(lt, "float") && type_is(rt, "float")) {
+    switch (op) {
+      case IR_BIN_ADD: return IR_OP_ADD_F64;
+      case IR_BIN_SUB: return IR_OP_SUB_F64;
+      case IR_BIN_MUL: return IR_OP_MUL_F64;
+      case IR_BIN_DIV: return IR_OP_DIV_F64;
+      case IR_BIN_LT: return IR_OP_LT_F64;
+      case IR_BIN_LE: return IR_OP_LE_F64;
+      case IR_BIN_GT: return IR_OP_GT_F64;
+      case IR_BIN_GE: return IR_OP_GE_F64;
+      default: return IR_OP_BIN_OP;
+    }
+  }
+  return IR_OP_BIN_OP;
+}
+
+static void specialize_instr(IRTypeEnv *env, IRTypeEnv *iters, IRInstr *ins) {
+  switch (ins->opcode) {
+    case IR_OP_BIN_OP:
+      ins->opcode = specialize_bin_op(ins->binop, type_env_get(env, ins->left), type_env_get(env, ins->right));
+      break;
+    case IR_OP_CHECK_INT_OVERFLOW:
+      if (type_is(type_env_get(env, ins->left), "int") && type_is(type_env_get(env, ins->right), "int")) {
+        if (ins->binop == IR_BIN_ADD) ins->opcode = IR_OP_CHECK_ADD_I64;
+        else if (ins->binop == IR_BIN_SUB) ins->opcode = IR_OP_CHECK_SUB_I64;
       }
-      for (size_t gi = 0; gi < m->group_count; gi++) {
-        PS_JsonValue *g = groups->as.array_v.items[gi];
-        m->groups[gi].name = dup_json_string(ps_json_obj_get(g, "name"));
-        m->groups[gi].base_type = parse_type_name(ps_json_obj_get(g, "baseType"));
-        PS_JsonValue *members = ps_json_obj_get(g, "members");
-        if (members && members->type == PS_JSON_ARRAY) {
-          m->groups[gi].member_count = members->as.array_v.len;
+      break;
+    case IR_OP_INDEX_GET: {
+      const char *tt = type_env_get(env, ins->target);
+      const char *it = type_env_get(env, ins->index);
+      if (type_has_kind(tt, "list") && type_is(it, "int")) {
+        ins->opcode = IR_OP_LIST_GET;
+      } else if (type_has_kind(tt, "map") && type_is(it, "string")) {
+        const char *kt = NULL;
+        const char *vt = NULL;
+        if (split_map_type(env, tt, &kt, &vt) && type_is(kt, "string")) ins->opcode = IR_OP_MAP_GET_STR;
+      }
+      break;
+    }
+    case IR_OP_BRANCH_ITER_HAS_NEXT:
+      if (type_has_kind(type_env_get(iters, ins->iter), "list")) ins->opcode = IR_OP_BRANCH_ITER_HAS_NEXT_LIST;
+      break;
+    case IR_OP_ITER_NEXT:
+      if (type_has_kind(type_env_get(iters, ins->iter), "list")) ins->opcode = IR_OP_ITER_NEXT_LIST;
+      break;
+    case IR_OP_CALL_METHOD_STATIC: {
+      const char *rt = type_env_get(env, ins->receiver);
+      if (!ins->method) break;
+      if (type_is(rt, "string") && ins->arg_count == 0 && strcmp(ins->method, "length") == 0) {
+        ins->opcode = IR_OP_STRING_LEN;
+      } else if (type_has_kind(rt, "list")) {
+        if (ins->arg_count == 0 && strcmp(ins->method, "length") == 0) ins->opcode = IR_OP_LIST_LEN;
+        else if (ins->arg_count == 1 && strcmp(ins->method, "push") == 0) ins->opcode = IR_OP_LIST_PUSH;
+      }
+      break;
+    }
+    default:
+      break;
+  }
+}
+
+static void specialize_function(IRFunction *f) {
+  size_t total = 0;
+  for (size_t bi = 0; bi < f->block_count; bi++) {
+    IRBlock *b = &f->blocks[bi];
+    total += b->instr_count;
+    for (size_t ii = 0; ii < b->instr_count; ii++) {
+      IRInstr *ins = &b->instrs[ii];
+      if ((ins->opcode == IR_OP_JUMP || ins->opcode == IR_OP_PUSH_HANDLER) && ins->target) {
+        ins->target_block = find_block(f, ins->target);
+      }
+      if (ins->then_label) ins->then_block = find_block(f, ins->then_label);
+      if (ins->else_label) ins->else_block = find_block(f, ins->else_label);
+    }
+  }
+  IRTypeEnv env;
+  IRTypeEnv iters;
+  if (!type_env_init(&env, total)) return;
+  if (!type_env_init(&iters, total)) {
+    type_env_free(&env);
+    return;
+  }
+  // Temps are defined before use in block order except across loop back-edges;
+  // a second sweep picks those up.
+  for (int pass = 0; pass < 2; pass++) {
+    for (size_t bi = 0; bi < f->block_count; bi++) {
+      IRBlock *b = &f->blocks[bi];
+      for (size_t ii = 0; ii < b->instr_count; ii++) infer_instr_type(&env, &iters, &b->instrs[ii]);
+    }
+  }
+  for (size_t bi = 0; bi < f->block_count; bi++) {
+    IRBlock *b = &f->blocks[bi];
+    for (size_t ii = 0; ii < b->instr_count; ii++) specialize_instr(&env, &iters, &b->instrs[ii]);
+  }
+  type_env_free(&iters);
+  type_env_free(&env);
+}
+
+// ---------------------------------------------------------------------------
+// Peephole fusion of the regular sequences produced by IR lowering. Runs after
+// specialize_function so it only has to match typed opcodes. Temps written by a
+// fused sequence are skipped at runtime, so each one must have no reader
+// outside the sequence.
+// ---------------------------------------------------------------------------
+
+static int64_t parse_int_literal(const char *raw);
+
+// Name-keyed table over temps of one function (open addressing, never full).
+typedef struct {
+  const char *name;
+  size_t value;
+} IRNameSlot;
+
+typedef struct {
+  IRNameSlot *slots;
+  size_t cap;
+} IRNameTable;
+
+static int name_table_init(IRNameTable *t, size_t names) {
+  t->cap = 16;
+  while (t->cap < names * 2) t->cap *= 2;
+  t->slots = (IRNameSlot *)calloc(t->cap, sizeof(IRNameSlot));
+  return t->slots != NULL;
+}
+
+static IRNameSlot *name_table_slot(IRNameTable *t, const char *name) {
+  size_t mask = t->cap - 1;
+  size_t i = ir_name_hash(name) & mask;
+  while (t->slots[i].name && strcmp(t->slots[i].name, name) != 0) i = (i + 1) & mask;
+  return &t->slots[i];
+}
+
+static int is_temp_name(const char *name) { return name && name[0] == '%'; }
+
+// Calls fn for every temp read by ins (operands only, not dst).
+static void instr_for_each_temp_use(const IRInstr *ins, void (*fn)(void *, const char *), void *ud) {
+  const char *operands[] = {ins->value, ins->left,   ins->right,  ins->cond,     ins->target,    ins->index,
+                            ins->src,   ins->iter,   ins->source, ins->offset,   ins->len,       ins->receiver,
+                            ins->divisor, ins->map, ins->key,    ins->thenValue, ins->elseValue, ins->shift};
+  for (size_t i = 0; i < sizeof(operands) / sizeof(operands[0]); i++) {
+    if (is_temp_name(operands[i])) fn(ud, operands[i]);
+  }
+  for (size_t i = 0; i < ins->arg_count; i++) {
+    if (is_temp_name(ins->args[i])) fn(ud, ins->args[i]);
+  }
+  for (size_t i = 0; i < ins->pair_count; i++) {
+    if (is_temp_name(ins->pairs[i].key)) fn(ud, ins->pairs[i].key);
+    if (is_temp_name(ins->pairs[i].value)) fn(ud, ins->pairs[i].value);
+  }
+}
+
+static void count_temp_ref(void *ud, const char *name) {
+  (void)name;
+  *(size_t *)ud += 1;
+}
+
+// Upper bound on the distinct temps of f, used to size name tables.
+static size_t function_temp_refs(IRFunction *f) {
+  size_t n = 0;
+  for (size_t bi = 0; bi < f->block_count; bi++) {
+    IRBlock *b = &f->blocks[bi];
+    for (size_t ii = 0; ii < b->instr_count; ii++) {
+      if (is_temp_name(b->instrs[ii].dst)) n += 1;
+      instr_for_each_temp_use(&b->instrs[ii], count_temp_ref, &n);
+    }
+  }
+  return n;
+}
+
+static void use_counts_add(void *ud, const char *name) {
+  IRNameSlot *s = name_table_slot((IRNameTable *)ud, name);
+  s->name = name;
+  s->value += 1;
+}
+
+static size_t use_counts_get(IRNameTable *uc, const char *name) {
+  if (!name) return 0;
+  IRNameSlot *s = name_table_slot(uc, name);
+  return s->name ? s->value : 0;
+}
+
+static int name_eq(const char *a, const char *b) { return a && b && strcmp(a, b) == 0; }
+
+// load_var x; (const k | load_var y); check_{add,sub}_i64; {add,sub}_i64; store_var x
+static int fuse_local_update(IRNameTable *uc, IRInstr *ins, size_t avail) {
+  if (avail < 5 || ins->opcode != IR_OP_LOAD_VAR) return 0;
+  IRInstr *rhs = ins + 1;
+  IRInstr *chk = ins + 2;
+  IRInstr *op = ins + 3;
+  IRInstr *st = ins + 4;
+  int is_add = chk->opcode == IR_OP_CHECK_ADD_I64 && op->opcode == IR_OP_ADD_I64;
+  int is_sub = chk->opcode == IR_OP_CHECK_SUB_I64 && op->opcode == IR_OP_SUB_I64;
+  if (!is_add && !is_sub) return 0;
+  if (!name_eq(chk->left, ins->dst) || !name_eq(chk->right, rhs->dst)) return 0;
+  if (!name_eq(op->left, ins->dst) || !name_eq(op->right, rhs->dst)) return 0;
+  if (st->opcode != IR_OP_STORE_VAR || !name_eq(st->name, ins->name) || !name_eq(st->src, op->dst)) return 0;
+  if (use_counts_get(uc, ins->dst) != 2 || use_counts_get(uc, rhs->dst) != 2 || use_counts_get(uc, op->dst) != 1) return 0;
+  if (rhs->opcode == IR_OP_CONST && type_is(rhs->literalType, "int")) {
+    int64_t k = parse_int_literal(rhs->value);
+    if (is_sub && k == INT64_MIN) return 0;
+    ins->fused = IR_OP_INC_LOCAL_CHECKED;
+    ins->imm = is_sub ? -k : k;
+  } else if (rhs->opcode == IR_OP_LOAD_VAR && rhs->name) {
+    ins->fused = is_add ? IR_OP_ADD_LOCAL_CHECKED : IR_OP_SUB_LOCAL_CHECKED;
+    ins->aux = rhs->name;
+  } else {
+    return 0;
+  }
+  ins->fused_len = 5;
+  return 1;
+}
+
+// {eq,ne,lt,le,gt,ge}_i64 %c; branch_if %c
+static int fuse_cmp_branch(IRNameTable *uc, IRInstr *ins, size_t avail) {
+  static const IROp map[][2] = {
+    {IR_OP_EQ_I64, IR_OP_CMP_BRANCH_EQ_I64}, {IR_OP_NE_I64, IR_OP_CMP_BRANCH_NE_I64},
+    {IR_OP_LT_I64, IR_OP_CMP_BRANCH_LT_I64}, {IR_OP_LE_I64, IR_OP_CMP_BRANCH_LE_I64},
+    {IR_OP_GT_I64, IR_OP_CMP_BRANCH_GT_I64}, {IR_OP_GE_I64, IR_OP_CMP_BRANCH_GE_I64},
+  };
+  if (avail < 2) return 0;
+  IRInstr *br = ins + 1;
+  if (br->opcode != IR_OP_BRANCH_IF || !name_eq(br->cond, ins->dst) || use_counts_get(uc, ins->dst) != 1) return 0;
+  for (size_t i = 0; i < sizeof(map) / sizeof(map[0]); i++) {
+    if (ins->opcode != map[i][0]) continue;
+    ins->fused = map[i][1];
+    ins->fused_len = 2;
+    ins->then_block = br->then_block;
+    ins->else_block = br->else_block;
+    return 1;
+  }
+  return 0;
+}
+
+// branch_iter_has_next_list %it -> body whose first instruction is iter_next_list %it
+static int fuse_for_of_list(IRFunction *f, IRInstr *ins) {
+  if (ins->opcode != IR_OP_BRANCH_ITER_HAS_NEXT_LIST || ins->then_block >= f->block_count) return 0;
+  IRBlock *body = &f->blocks[ins->then_block];
+  if (body->instr_count == 0) return 0;
+  IRInstr *next = &body->instrs[0];
+  if (next->opcode != IR_OP_ITER_NEXT_LIST || !name_eq(next->iter, ins->iter) || !next->dst) return 0;
+  ins->fused = IR_OP_FOR_OF_LIST_NEXT;
+  ins->fused_len = 1;
+  ins->aux = next->dst;
+  return 1;
+}
+
+static void fuse_function(IRFunction *f) {
+  IRNameTable uc;
+  if (!name_table_init(&uc, function_temp_refs(f))) return;
+  for (size_t bi = 0; bi < f->block_count; bi++) {
+    IRBlock *b = &f->blocks[bi];
+    for (size_t ii = 0; ii < b->instr_count; ii++) instr_for_each_temp_use(&b->instrs[ii], use_counts_add, &uc);
+  }
+  for (size_t bi = 0; bi < f->block_count; bi++) {
+    IRBlock *b = &f->blocks[bi];
+    for (size_t ii = 0; ii < b->instr_count; ii++) {
+      IRInstr *ins = &b->instrs[ii];
+      size_t avail = b->instr_count - ii;
+      if (fuse_local_update(&uc, ins, avail) || fuse_cmp_branch(&uc, ins, avail)) {
+        ii += ins->fused_len - 1;
+        continue;
+      }
+      fuse_for_of_list(f, ins);
+    }
+  }
+  free(uc.slots);
+}
+
+// ---------------------------------------------------------------------------
+// Liveness: a backward dataflow pass over the block graph records, on each
+// instruction, the temps that are dead once it has executed (last read, or a
+// def nobody reads). The VM unbinds them before the next instruction runs, so
+// intermediates do not stay alive until the function returns. A store_var or
+// list push whose value operand dies there moves the reference instead.
+// ---------------------------------------------------------------------------
+
+typedef struct {
+  IRNameTable index; // temp name -> bit + 1
+  size_t bits;
+  size_t words;
+  uint64_t *handler_live; // live-in of every handler block
+} IRLiveness;
+
+static void live_index_add(void *ud, const char *name) {
+  IRLiveness *lv = (IRLiveness *)ud;
+  IRNameSlot *s = name_table_slot(&lv->index, name);
+  if (s->name) return;
+  s->name = name;
+  s->value = ++lv->bits;
+}
+
+static size_t live_bit(IRLiveness *lv, const char *name) {
+  IRNameSlot *s = name_table_slot(&lv->index, name);
+  return s->name ? s->value - 1 : 0;
+}
+
+typedef struct {
+  IRLiveness *lv;
+  uint64_t *set;
+} IRLiveSetRef;
+
+static void live_set_use(void *ud, const char *name) {
+  IRLiveSetRef *r = (IRLiveSetRef *)ud;
+  size_t bit = live_bit(r->lv, name);
+  r->set[bit / 64] |= (uint64_t)1 << (bit % 64);
+}
+
+static int live_test(IRLiveness *lv, const uint64_t *set, const char *name) {
+  size_t bit = live_bit(lv, name);
+  return (set[bit / 64] >> (bit % 64)) & 1;
+}
+
+static void live_clear(IRLiveness *lv, uint64_t *set, const char *name) {
+  size_t bit = live_bit(lv, name);
+  set[bit / 64] &= ~((uint64_t)1 << (bit % 64));
+}
+
+static void live_or(uint64_t *dst, const uint64_t *src, size_t words) {
+  for (size_t w = 0; w < words; w++) dst[w] |= src[w];
+}
+
+static int is_terminator(IROp op) {
+  switch (op) {
+    case IR_OP_JUMP:
+    case IR_OP_BRANCH_IF:
+    case IR_OP_BRANCH_ITER_HAS_NEXT:
+    case IR_OP_BRANCH_ITER_HAS_NEXT_LIST:
+    case IR_OP_RET:
+    case IR_OP_RET_VOID:
+    case IR_OP_THROW:
+    case IR_OP_RETHROW:
+      return 1;
+    default:
+      return 0;
+  }
+}
+
+// Live set right after ins executes: successors for terminators, otherwise the
+// set flowing back from the next instruction. Temps read by a handler stay live
+// everywhere since any instruction may raise.
+static void live_after(IRLiveness *lv, IRFunction *f, const uint64_t *live_in, const IRInstr *ins, uint64_t *live) {
+  if (is_terminator(ins->opcode)) {
+    memset(live, 0, lv->words * sizeof(uint64_t));
+    if (ins->opcode == IR_OP_JUMP) {
+      if (ins->target_block < f->block_count) live_or(live, live_in + ins->target_block * lv->words, lv->words);
+    } else if (ins->then_label || ins->else_label) {
+      if (ins->then_block < f->block_count) live_or(live, live_in + ins->then_block * lv->words, lv->words);
+      if (ins->else_block < f->block_count) live_or(live, live_in + ins->else_block * lv->words, lv->words);
+    }
+  }
+  live_or(live, lv->handler_live, lv->words);
+}
+
+static void live_step(IRLiveness *lv, const IRInstr *ins, uint64_t *live) {
+  if (is_temp_name(ins->dst)) live_clear(lv, live, ins->dst);
+  IRLiveSetRef r = {lv, live};
+  instr_for_each_temp_use(ins, live_set_use, &r);
+}
+
+static void live_block_entry(IRLiveness *lv, IRFunction *f, const uint64_t *live_in, size_t bi, uint64_t *live) {
+  IRBlock *b = &f->blocks[bi];
+  memset(live, 0, lv->words * sizeof(uint64_t));
+  if (bi + 1 < f->block_count) live_or(live, live_in + (bi + 1) * lv->words, lv->words);
+  for (size_t ii = b->instr_count; ii-- > 0;) {
+    live_after(lv, f, live_in, &b->instrs[ii], live);
+    live_step(lv, &b->instrs[ii], live);
+  }
+}
+
+typedef struct {
+  IRLiveness *lv;
+  const uint64_t *live;
+  IRInstr *ins;
+  size_t cap;
+} IRKillCollector;
+
+static void kill_collect(void *ud, const char *name) {
+  IRKillCollector *kc = (IRKillCollector *)ud;
+  IRInstr *ins = kc->ins;
+  if (live_test(kc->lv, kc->live, name)) return;
+  for (size_t k = 0; k < ins->kill_count; k++) {
+    if (strcmp(ins->kills[k], name) == 0) return;
+  }
+  if (ins->kill_count == kc->cap) {
+    size_t nc = kc->cap == 0 ? 4 : kc->cap * 2;
+    const char **n = (const char **)realloc((void *)ins->kills, sizeof(char *) * nc);
+    if (!n) return;
+    ins->kills = n;
+    kc->cap = nc;
+  }
+  ins->kills[ins->kill_count++] = name;
+}
+
+static int instr_kills(const IRInstr *ins, const char *name) {
+  for (size_t k = 0; k < ins->kill_count; k++) {
+    if (strcmp(ins->kills[k], name) == 0) return 1;
+  }
+  return 0;
+}
+
+static void liveness_function(IRFunction *f) {
+  IRLiveness lv;
+  memset(&lv, 0, sizeof(lv));
+  if (!name_table_init(&lv.index, function_temp_refs(f))) return;
+  for (size_t bi = 0; bi < f->block_count; bi++) {
+    IRBlock *b = &f->blocks[bi];
+    for (size_t ii = 0; ii < b->instr_count; ii++) {
+      if (is_temp_name(b->instrs[ii].dst)) live_index_add(&lv, b->instrs[ii].dst);
+      instr_for_each_temp_use(&b->instrs[ii], live_index_add, &lv);
+    }
+  }
+  lv.words = (lv.bits + 63) / 64;
+  if (lv.words == 0 || f->block_count == 0) {
+    free(lv.index.slots);
+    return;
+  }
+  uint64_t *live_in = (uint64_t *)calloc(f->block_count * lv.words, sizeof(uint64_t));
+  uint64_t *live = (uint64_t *)calloc(lv.words, sizeof(uint64_t));
+  lv.handler_live = (uint64_t *)calloc(lv.words, sizeof(uint64_t));
+  unsigned char *is_handler = (unsigned char *)calloc(f->block_count, 1);
+  if (!live_in || !live || !lv.handler_live || !is_handler) goto done;
+  for (size_t bi = 0; bi < f->block_count; bi++) {
+    IRBlock *b = &f->blocks[bi];
+    for (size_t ii = 0; ii < b->instr_count; ii++) {
+      IRInstr *ins = &b->instrs[ii];
+      if (ins->opcode == IR_OP_PUSH_HANDLER && ins->target) {
+        size_t h = find_block(f, ins->target);
+        if (h < f->block_count) is_handler[h] = 1;
+      }
+    }
+  }
+  for (int changed = 1; changed;) {
+    changed = 0;
+    for (size_t bi = f->block_count; bi-- > 0;) {
+      live_block_entry(&lv, f, live_in, bi, live);
+      uint64_t *in = live_in + bi * lv.words;
+      if (memcmp(in, live, lv.words * sizeof(uint64_t)) != 0) {
+        memcpy(in, live, lv.words * sizeof(uint64_t));
+        changed = 1;
+      }
+      if (is_handler[bi]) {
+        for (size_t w = 0; w < lv.words; w++) {
+          if ((lv.handler_live[w] | in[w]) != lv.handler_live[w]) {
+            lv.handler_live[w] |= in[w];
+            changed = 1;
+          }
+        }
+      }
+    }
+  }
+  for (size_t bi = 0; bi < f->block_count; bi++) {
+    IRBlock *b = &f->blocks[bi];
+    memset(live, 0, lv.words * sizeof(uint64_t));
+    if (bi + 1 < f->block_count) live_or(live, live_in + (bi + 1) * lv.words, lv.words);
+    for (size_t ii = b->instr_count; ii-- > 0;) {
+      IRInstr *ins = &b->instrs[ii];
+      live_after(&lv, f, live_in, ins, live);
+      IRKillCollector kc = {&lv, live, ins, 0};
+      if (is_temp_name(ins->dst)) kill_collect(&kc, ins->dst);
+      instr_for_each_temp_use(ins, kill_collect, &kc);
+      live_step(&lv, ins, live);
+      if (ins->opcode == IR_OP_STORE_VAR && is_temp_name(ins->src) && instr_kills(ins, ins->src)) {
+        ins->move_src = 1;
+      } else if ((ins->opcode == IR_OP_LIST_PUSH || ins->opcode == IR_OP_CALL_METHOD_STATIC) && ins->method &&
+                 strcmp(ins->method, "push") == 0 && ins->arg_count == 1 && is_temp_name(ins->args[0]) &&
+                 !name_eq(ins->args[0], ins->receiver) && instr_kills(ins, ins->args[0])) {
+        ins->move_src = 1;
+      }
+    }
+  }
+done:
+  free(is_handler);
+  free(lv.handler_live);
+  free(live);
+  free(live_in);
+  free(lv.index.slots);
+}
+
+// Static exception handlers. try/catch lowers to push_handler/pop_handler
+// around lexically nested regions, so the handler stack at each instruction
+// is known at load time: raise jumps to `ins->handler` and entering a try
+// costs nothing at run time. Paths leaving a region without pop_handler
+// (break/continue out of a try) meet at the longest common prefix, i.e. the
+// stack of the enclosing code.
+typedef struct {
+  size_t *stacks; // block_count rows of `depth` entries
+  size_t *lens;
+  unsigned char *seen;
+  size_t depth;
+} IRHandlerFlow;
+
+static int handler_flow_merge(IRHandlerFlow *hf, size_t bi, const size_t *stack, size_t len) {
+  size_t *row = hf->stacks + bi * hf->depth;
+  if (!hf->seen[bi]) {
+    hf->seen[bi] = 1;
+    memcpy(row, stack, len * sizeof(size_t));
+    hf->lens[bi] = len;
+    return 1;
+  }
+  size_t n = 0;
+  while (n < hf->lens[bi] && n < len && row[n] == stack[n]) n++;
+  if (n == hf->lens[bi]) return 0;
+  hf->lens[bi] = n;
+  return 1;
+}
+
+// Runs block `bi` from its entry stack; with `assign`, records the innermost
+// handler on each instruction. Returns 1 if a successor's entry stack changed.
+static int handler_flow_block(IRHandlerFlow *hf, IRFunction *f, size_t bi, size_t *stack, int assign) {
+  IRBlock *b = &f->blocks[bi];
+  size_t len = hf->lens[bi];
+  int changed = 0;
+  memcpy(stack, hf->stacks + bi * hf->depth, len * sizeof(size_t));
+  for (size_t ii = 0; ii < b->instr_count; ii++) {
+    IRInstr *ins = &b->instrs[ii];
+    if (assign) ins->handler = len ? stack[len - 1] + 1 : 0;
+    switch (ins->opcode) {
+      case IR_OP_PUSH_HANDLER:
+        if (ins->target_block < f->block_count) {
+          changed |= handler_flow_merge(hf, ins->target_block, stack, len);
+          if (len < hf->depth) stack[len++] = ins->target_block;
+        }
+        break;
+      case IR_OP_POP_HANDLER:
+        if (len) len--;
+        break;
+      case IR_OP_JUMP:
+        if (ins->target_block < f->block_count) changed |= handler_flow_merge(hf, ins->target_block, stack, len);
+        return changed;
+      case IR_OP_BRANCH_IF:
+      case IR_OP_BRANCH_ITER_HAS_NEXT:
+      case IR_OP_BRANCH_ITER_HAS_NEXT_LIST:
+        if (ins->then_block < f->block_count) changed |= handler_flow_merge(hf, ins->then_block, stack, len);
+        if (ins->else_block < f->block_count) changed |= handler_flow_merge(hf, ins->else_block, stack, len);
+        return changed;
+      default:
+        if (is_terminator(ins->opcode)) return changed;
+        break;
+    }
+  }
+  if (bi + 1 < f->block_count) changed |= handler_flow_merge(hf, bi + 1, stack, len);
+  return changed;
+}
+
+static int handlers_function(IRFunction *f) {
+  IRHandlerFlow hf;
+  memset(&hf, 0, sizeof(hf));
+  for (size_t bi = 0; bi < f->block_count; bi++) {
+    for (size_t ii = 0; ii < f->blocks[bi].instr_count; ii++) {
+      if (f->blocks[bi].instrs[ii].opcode == IR_OP_PUSH_HANDLER) hf.depth += 1;
+    }
+  }
+  if (hf.depth == 0 || f->block_count == 0) return 1;
+  hf.stacks = (size_t *)malloc(f->block_count * hf.depth * sizeof(size_t));
+  hf.lens = (size_t *)calloc(f->block_count, sizeof(size_t));
+  hf.seen = (unsigned char *)calloc(f->block_count, 1);
+  size_t *stack = (size_t *)malloc(hf.depth * sizeof(size_t));
+  int ok = hf.stacks && hf.lens && hf.seen && stack;
+  if (ok) {
+    hf.seen[0] = 1;
+    for (int changed = 1; changed;) {
+      changed = 0;
+      for (size_t bi = 0; bi < f->block_count; bi++) {
+        if (hf.seen[bi]) changed |= handler_flow_block(&hf, f, bi, stack, 0);
+      }
+    }
+    for (size_t bi = 0; bi < f->block_count; bi++) {
+      if (hf.seen[bi]) handler_flow_block(&hf, f, bi, stack, 1);
+    }
+  }
+  free(stack);
+  free(hf.seen);
+  free(hf.lens);
+  free(hf.stacks);
+  return ok;
+}
+
+// Synthetic `<Proto>.__clone_static` function emitted for `Proto.clone()`.
+static int is_clone_static(const char *name) {
+  static const char suffix[] = ".__clone_static";
+  size_t len = name ? strlen(name) : 0;
+  return len > sizeof(suffix) - 1 && strcmp(name + len - (sizeof(suffix) - 1), suffix) == 0;
+}
+
+// `call_static` whose result is returned right away by the next instruction.
+// Only non-variadic IR callees qualify: a variadic view borrows the argument
+// array, and `__clone_static` keeps its builtin-handle check in exec_call_static.
+static void mark_tail_calls(PS_IR_Module *m) {
+  for (size_t fi = 0; fi < m->fn_count; fi++) {
+    IRFunction *f = &m->fns[fi];
+    for (size_t bi = 0; bi < f->block_count; bi++) {
+      IRBlock *b = &f->blocks[bi];
+      for (size_t ii = 0; ii + 1 < b->instr_count; ii++) {
+        IRInstr *ins = &b->instrs[ii];
+        IRInstr *next = &b->instrs[ii + 1];
+        if (ins->opcode != IR_OP_CALL_STATIC || !ins->callee || !ins->dst) continue;
+        if (next->opcode != IR_OP_RET || !name_eq(next->value, ins->dst)) continue;
+        if (is_clone_static(ins->callee)) continue;
+        IRFunction *fn = find_fn(m, ins->callee);
+        if (!fn || fn->variadic) continue;
+        ins->tail_fn = (size_t)(fn - m->fns) + 1;
+      }
+    }
+  }
+}
+
+// Builds the module from a parsed IR tree and releases the tree. Nothing in the
+// module points into the tree, so the JSON source may go right after the call.
+static PS_IR_Module *ir_load_tree(PS_Context *ctx, PS_JsonValue *root, const char *err) {
+  if (!root) {
+    ps_throw_diag(ctx, PS_ERR_INTERNAL, "invalid IR", err ? err : "parse failed", "valid IR JSON");
+    return NULL;
+  }
+  PS_JsonValue *module = ps_json_obj_get(root, "module");
+  PS_JsonValue *functions = module ? ps_json_obj_get(module, "functions") : NULL;
+  if (!functions || functions->type != PS_JSON_ARRAY) {
+    ps_json_free(root);
+    ps_throw_diag(ctx, PS_ERR_INTERNAL, "invalid IR", "missing functions", "valid IR JSON");
+    return NULL;
+  }
+  PS_IR_Module *m = (PS_IR_Module *)calloc(1, sizeof(PS_IR_Module));
+  if (!m) {
+    ps_json_free(root);
+    ps_throw_diag(ctx, PS_ERR_OOM, "out of memory", "IR module allocation failed", "available memory");
+    return NULL;
+  }
+  PS_JsonValue *protos = module ? ps_json_obj_get(module, "prototypes") : NULL;
+  if (protos && protos->type == PS_JSON_ARRAY) {
+    m->proto_count = protos->as.array_v.len;
+    m->protos = (PS_IR_Proto *)calloc(m->proto_count, sizeof(PS_IR_Proto));
+    if (!m->protos) {
+      free(m);
+      ps_json_free(root);
+      ps_throw_diag(ctx, PS_ERR_OOM, "out of memory", "IR prototype allocation failed", "available memory");
+      return NULL;
+    }
+    for (size_t pi = 0; pi < m->proto_count; pi++) {
+      PS_JsonValue *p = protos->as.array_v.items[pi];
+      m->protos[pi].name = intern_json_string(ps_json_obj_get(p, "name"));
+      m->protos[pi].parent = intern_json_string(ps_json_obj_get(p, "parent"));
+      PS_JsonValue *ps = ps_json_obj_get(p, "sealed");
+      if (ps && ps->type == PS_JSON_BOOL) m->protos[pi].is_sealed = ps->as.bool_v ? 1 : 0;
+      PS_JsonValue *fields = ps_json_obj_get(p, "fields");
+      if (fields && fields->type == PS_JSON_ARRAY) {
+        m->protos[pi].field_count = fields->as.array_v.len;
+        m->protos[pi].fields = (void *)calloc(m->protos[pi].field_count, sizeof(*m->protos[pi].fields));
+        if (!m->protos[pi].fields && m->protos[pi].field_count > 0) {
+          ps_json_free(root);
+          ps_throw_diag(ctx, PS_ERR_OOM, "out of memory", "IR prototype fields allocation failed", "available memory");
+          ps_ir_free(m);
+          return NULL;
+        }
+        for (size_t fi = 0; fi < m->protos[pi].field_count; fi++) {
+          PS_JsonValue *f = fields->as.array_v.items[fi];
+          m->protos[pi].fields[fi].name = dup_json_string(ps_json_obj_get(f, "name"));
+          m->protos[pi].fields[fi].type = parse_type_name(ps_json_obj_get(f, "type"));
+        }
+      }
+      PS_JsonValue *methods = ps_json_obj_get(p, "methods");
+      if (methods && methods->type == PS_JSON_ARRAY) {
+        m->protos[pi].method_count = methods->as.array_v.len;
+        m->protos[pi].methods = (void *)calloc(m->protos[pi].method_count, sizeof(*m->protos[pi].methods));
+        if (!m->protos[pi].methods && m->protos[pi].method_count > 0) {
+          ps_json_free(root);
+          ps_throw_diag(ctx, PS_ERR_OOM, "out of memory", "IR prototype methods allocation failed", "available memory");
+          ps_ir_free(m);
+          return NULL;
+        }
+        for (size_t mi = 0; mi < m->protos[pi].method_count; mi++) {
+          PS_JsonValue *md = methods->as.array_v.items[mi];
+          m->protos[pi].methods[mi].name = dup_json_string(ps_json_obj_get(md, "name"));
+          m->protos[pi].methods[mi].ret_type = parse_type_name(ps_json_obj_get(md, "returnType"));
+          PS_JsonValue *params = ps_json_obj_get(md, "params");
+          if (params && params->type == PS_JSON_ARRAY) {
+            m->protos[pi].methods[mi].param_count = params->as.array_v.len;
+            m->protos[pi].methods[mi].params = (void *)calloc(m->protos[pi].methods[mi].param_count, sizeof(*m->protos[pi].methods[mi].params));
+            if (!m->protos[pi].methods[mi].params && m->protos[pi].methods[mi].param_count > 0) {
+              ps_json_free(root);
+              ps_throw_diag(ctx, PS_ERR_OOM, "out of memory", "IR prototype method params allocation failed", "available memory");
+              ps_ir_free(m);
+              return NULL;
+            }
+            for (size_t pj = 0; pj < m->protos[pi].methods[mi].param_count; pj++) {
+              PS_JsonValue *pv = params->as.array_v.items[pj];
+              m->protos[pi].methods[mi].params[pj].name = dup_json_string(ps_json_obj_get(pv, "name"));
+              m->protos[pi].methods[mi].params[pj].type = parse_type_name(ps_json_obj_get(pv, "type"));
+              PS_JsonValue *v = ps_json_obj_get(pv, "variadic");
+              if (v && v->type == PS_JSON_BOOL && v->as.bool_v) m->protos[pi].methods[mi].params[pj].variadic = 1;
+            }
+          }
+        }
+      }
+    }
+  }
+  PS_JsonValue *groups = module ? ps_json_obj_get(module, "groups") : NULL;
+  if (groups && groups->type == PS_JSON_ARRAY) {
+    m->group_count = groups->as.array_v.len;
+    if (m->group_count > 0) {
+      m->groups = (PS_IR_Group *)calloc(m->group_count, sizeof(PS_IR_Group));
+      if (!m->groups) {
+        ps_json_free(root);
+        ps_throw_diag(ctx, PS_ERR_OOM, "out of memory", "IR group allocation failed", "available memory");
+        ps_ir_free(m);
+        return NULL;
+      }
+      for (size_t gi = 0; gi < m->group_count; gi++) {
+        PS_JsonValue *g = groups->as.array_v.items[gi];
+        m->groups[gi].name = dup_json_string(ps_json_obj_get(g, "name"));
+        m->groups[gi].base_type = parse_type_name(ps_json_obj_get(g, "baseType"));
+        PS_JsonValue *members = ps_json_obj_get(g, "members");
+        if (members && members->type == PS_JSON_ARRAY) {
+          m->groups[gi].member_count = members->as.array_v.len;
           if (m->groups[gi].member_count > 0) {
             m->groups[gi].members = (PS_IR_GroupMember *)calloc(m->groups[gi].member_count, sizeof(PS_IR_GroupMember));
             if (!m->groups[gi].members) {
@@ -908,13 +1988,7 @@ PS_IR_Module *ps_ir_load_json(PS_Context *ctx, const char *json, size_t len) {
   m->fn_count = functions->as.array_v.len;
   m->fns = (IRFunction *)calloc(m->fn_count, sizeof(IRFunction));
   if (!m->fns) {
-    if (m->protos) {
-      for (size_t pi = 0; pi < m->proto_count; pi++) {
-        free(m->protos[pi].name);
-        free(m->protos[pi].parent);
-      }
-      free(m->protos);
-    }
+    free(m->protos);
     free(m);
     ps_json_free(root);
     ps_throw_diag(ctx, PS_ERR_OOM, "out of memory", "IR function allocation failed", "available memory");
@@ -927,7 +2001,7 @@ PS_IR_Module *ps_ir_load_json(PS_Context *ctx, const char *json, size_t len) {
     if (params && params->type == PS_JSON_ARRAY) {
       m->fns[fi].param_count = params->as.array_v.len;
       m->fns[fi].params = (char **)calloc(m->fns[fi].param_count, sizeof(char *));
-      m->fns[fi].param_types = (char **)calloc(m->fns[fi].param_count, sizeof(char *));
+      m->fns[fi].param_types = (const char **)calloc(m->fns[fi].param_count, sizeof(char *));
       for (size_t i = 0; i < m->fns[fi].param_count; i++) {
         PS_JsonValue *p = params->as.array_v.items[i];
         PS_JsonValue *pn = ps_json_obj_get(p, "name");
@@ -942,7 +2016,7 @@ PS_IR_Module *ps_ir_load_json(PS_Context *ctx, const char *json, size_t len) {
       }
     }
     PS_JsonValue *ret = ps_json_obj_get(f, "returnType");
-    m->fns[fi].ret_type = dup_json_string(ret ? ps_json_obj_get(ret, "name") : NULL);
+    m->fns[fi].ret_type = intern_json_string(ret ? ps_json_obj_get(ret, "name") : NULL);
     PS_JsonValue *blocks = ps_json_obj_get(f, "blocks");
     if (blocks && blocks->type == PS_JSON_ARRAY) {
       m->fns[fi].block_count = blocks->as.array_v.len;
@@ -960,11 +2034,42 @@ PS_IR_Module *ps_ir_load_json(PS_Context *ctx, const char *json, size_t len) {
         }
       }
     }
+    specialize_function(&m->fns[fi]);
+    if (!ctx->no_fuse) fuse_function(&m->fns[fi]);
+    liveness_function(&m->fns[fi]);
+    if (!handlers_function(&m->fns[fi])) {
+      ps_ir_free(m);
+      ps_json_free(root);
+      ps_throw_diag(ctx, PS_ERR_OOM, "out of memory", "IR handler table allocation failed", "available memory");
+      return NULL;
+    }
   }
+  mark_tail_calls(m);
   ps_json_free(root);
   return m;
 }
 
+PS_IR_Module *ps_ir_load_json(PS_Context *ctx, const char *json, size_t len) {
+  const char *err = NULL;
+  PS_JsonValue *root = ps_json_parse(json, len, &err);
+  return ir_load_tree(ctx, root, err);
+}
+
+PS_IR_Module *ps_ir_load_json_insitu(PS_Context *ctx, char *json, size_t len) {
+  const char *err = NULL;
+  PS_JsonValue *root = ps_json_parse_insitu(json, len, &err);
+  return ir_load_tree(ctx, root, err);
+}
+
+size_t ps_ir_instr_count(const PS_IR_Module *m) {
+  size_t n = 0;
+  if (!m) return 0;
+  for (size_t fi = 0; fi < m->fn_count; fi++) {
+    for (size_t bi = 0; bi < m->fns[fi].block_count; bi++) n += m->fns[fi].blocks[bi].instr_count;
+  }
+  return n;
+}
+
 void ps_ir_free(PS_IR_Module *m) {
   if (!m) return;
   for (size_t fi = 0; fi < m->fn_count; fi++) {
@@ -974,11 +2079,7 @@ void ps_ir_free(PS_IR_Module *m) {
       for (size_t i = 0; i < f->param_count; i++) free(f->params[i]);
       free(f->params);
     }
-    if (f->param_types) {
-      for (size_t i = 0; i < f->param_count; i++) free(f->param_types[i]);
-      free(f->param_types);
-    }
-    free(f->ret_type);
+    free((void *)f->param_types);
     if (f->blocks) {
       for (size_t bi = 0; bi < f->block_count; bi++) {
         IRBlock *b = &f->blocks[bi];
@@ -992,23 +2093,18 @@ void ps_ir_free(PS_IR_Module *m) {
   free(m->fns);
   if (m->protos) {
     for (size_t pi = 0; pi < m->proto_count; pi++) {
-      free(m->protos[pi].name);
-      free(m->protos[pi].parent);
       if (m->protos[pi].fields) {
         for (size_t fi = 0; fi < m->protos[pi].field_count; fi++) {
           free(m->protos[pi].fields[fi].name);
-          free(m->protos[pi].fields[fi].type);
         }
         free(m->protos[pi].fields);
       }
       if (m->protos[pi].methods) {
         for (size_t mi = 0; mi < m->protos[pi].method_count; mi++) {
           free(m->protos[pi].methods[mi].name);
-          free(m->protos[pi].methods[mi].ret_type);
           if (m->protos[pi].methods[mi].params) {
             for (size_t pj = 0; pj < m->protos[pi].methods[mi].param_count; pj++) {
               free(m->protos[pi].methods[mi].params[pj].name);
-              free(m->protos[pi].methods[mi].params[pj].type);
             }
             free(m->protos[pi].methods[mi].params);
           }
@@ -1021,7 +2117,6 @@ void ps_ir_free(PS_IR_Module *m) {
   if (m->groups) {
     for (size_t gi = 0; gi < m->group_count; gi++) {
       free(m->groups[gi].name);
-      free(m->groups[gi].base_type);
       if (m->groups[gi].members) {
         for (size_t mi = 0; mi < m->groups[gi].member_count; mi++) {
           free(m->groups[gi].members[mi].name);
@@ -1104,7 +2199,7 @@ static PS_Value *value_from_literal(PS_Context *ctx, const char *literalType, PS
       ps_throw_diag(ctx, PS_ERR_INTERNAL, "invalid group literal", name, "known group name");
       return NULL;
     }
-    PS_Value *v = ps_value_alloc(PS_V_GROUP);
+    PS_Value *v = ps_value_alloc(ctx, PS_V_GROUP);
     if (!v) {
       ps_throw_diag(ctx, PS_ERR_OOM, "out of memory", "group descriptor allocation failed", "available memory");
       return NULL;
@@ -1114,7 +2209,7 @@ static PS_Value *value_from_literal(PS_Context *ctx, const char *literalType, PS
   }
   if (strcmp(literalType, "eof") == 0) {
     if (!ctx->eof_value) {
-      PS_Value *v = ps_value_alloc(PS_V_OBJECT);
+      PS_Value *v = ps_value_alloc(ctx, PS_V_OBJECT);
       if (!v) {
         ps_throw_diag(ctx, PS_ERR_OOM, "out of memory", "EOF value allocation failed", "available memory");
         return NULL;
@@ -1225,12 +2320,10 @@ static int compare_values(PS_Value *a, PS_Value *b, PS_ValueTag tag, int *out_cm
 
 static const char *proto_parent_name(PS_IR_Module *m, const char *name);
 
+static PS_IR_Proto *proto_find_meta(PS_IR_Module *m, const char *name);
+
 static int proto_exists(PS_IR_Module *m, const char *name) {
-  if (!m || !name) return 0;
-  for (size_t i = 0; i < m->proto_count; i++) {
-    if (m->protos[i].name && strcmp(m->protos[i].name, name) == 0) return 1;
-  }
-  return 0;
+  return proto_find_meta(m, name) != NULL;
 }
 
 static int resolve_compareto_callee(PS_IR_Module *m, const char *proto, char *out, size_t out_len) {
@@ -1302,7 +2395,7 @@ static int list_sort_values(PS_Context *ctx, PS_IR_Module *m, PS_Value **items,
 static PS_Value *make_exception(PS_Context *ctx, const char *type_name, const char *parent_name, int is_runtime,
                                 const char *file, int64_t line, int64_t column,
                                 const char *message, PS_Value *cause, const char *code, const char *category) {
-  PS_Value *ex = ps_value_alloc(PS_V_EXCEPTION);
+  PS_Value *ex = ps_value_alloc(ctx, PS_V_EXCEPTION);
   if (!ex) {
     ps_throw_diag(ctx, PS_ERR_OOM, "out of memory", "exception allocation failed", "available memory");
     return NULL;
@@ -1310,131 +2403,118 @@ static PS_Value *make_exception(PS_Context *ctx, const char *type_name, const ch
   ex->as.exc_v.is_runtime = is_runtime ? 1 : 0;
   ex->as.exc_v.type_name = type_name ? strdup(type_name) : NULL;
   ex->as.exc_v.parent_name = parent_name ? strdup(parent_name) : NULL;
-  ex->as.exc_v.fields = ps_object_new(ctx);
-  if (!ex->as.exc_v.fields) {
-    ps_value_release(ex);
-    ps_throw_diag(ctx, PS_ERR_OOM, "out of memory", "exception fields allocation failed", "available memory");
-    return NULL;
-  }
-  ex->as.exc_v.file = ps_make_string_utf8(ctx, file ? file : "", file ? strlen(file) : 0);
+  ex->as.exc_v.file = file && *file ? ps_make_string_utf8(ctx, file, strlen(file)) : NULL;
   ex->as.exc_v.line = line;
   ex->as.exc_v.column = column;
-  ex->as.exc_v.message = ps_make_string_utf8(ctx, message ? message : "", message ? strlen(message) : 0);
+  ex->as.exc_v.message = message ? ps_make_string_utf8(ctx, message, strlen(message)) : NULL;
   ex->as.exc_v.cause = cause ? ps_value_retain(cause) : NULL;
   ex->as.exc_v.code = code ? ps_make_string_utf8(ctx, code, strlen(code)) : NULL;
   ex->as.exc_v.category = category ? ps_make_string_utf8(ctx, category, strlen(category)) : NULL;
-  if (!ex->as.exc_v.file || !ex->as.exc_v.message || (code && !ex->as.exc_v.code) || (category && !ex->as.exc_v.category)) {
+  if ((file && *file && !ex->as.exc_v.file) || (message && !ex->as.exc_v.message) || (code && !ex->as.exc_v.code) || (category && !ex->as.exc_v.category)) {
     ps_value_release(ex);
     return NULL;
   }
   return ex;
 }
 
+// The error record moves into the exception as-is: message, code and category
+// are only built if something reads them (ps_exception_resolve).
 static PS_Value *make_runtime_exception_from_error(PS_Context *ctx) {
-  const char *msg = ps_last_error_message(ctx);
-  if (msg && strncmp(msg, "sys:", 4) == 0) {
-    const char *type = msg + 4;
-    const char *sep = strchr(type, ':');
-    if (sep && sep > type) {
-      size_t len = (size_t)(sep - type);
-      char type_buf[128];
-      if (len < sizeof(type_buf)) {
-        memcpy(type_buf, type, len);
-        type_buf[len] = '\0';
-        const char *body = sep + 1;
-        return make_exception(ctx, type_buf, "RuntimeException", 1, "", 1, 1, body, NULL, NULL, NULL);
-      }
-    }
+  PS_Error *err = &ctx->last_error;
+  if (err->exc_type[0]) {
+    return make_exception(ctx, err->exc_type, "RuntimeException", 1, "", 1, 1, ps_error_message(err) + err->body, NULL, NULL, NULL);
   }
-  if (msg && strncmp(msg, "fs:", 3) == 0) {
-    const char *type = msg + 3;
-    const char *sep = strchr(type, ':');
-    if (sep && sep > type) {
-      size_t len = (size_t)(sep - type);
-      char type_buf[128];
-      if (len < sizeof(type_buf)) {
-        memcpy(type_buf, type, len);
-        type_buf[len] = '\0';
-        const char *body = sep + 1;
-        return make_exception(ctx, type_buf, "RuntimeException", 1, "", 1, 1, body, NULL, NULL, NULL);
-      }
-    }
+  PS_Error *pending = (PS_Error *)malloc(sizeof(PS_Error));
+  if (!pending) {
+    const char *code = NULL;
+    const char *category = ps_runtime_category(err->code, ps_error_message(err), &code);
+    return make_exception(ctx, "RuntimeException", "Exception", 1, "", 1, 1, ps_error_message(err), NULL, code, category);
   }
-  if (msg && strncmp(msg, "io:", 3) == 0) {
-    const char *type = msg + 3;
-    const char *sep = strchr(type, ':');
-    if (sep && sep > type) {
-      size_t len = (size_t)(sep - type);
-      char type_buf[128];
-      if (len < sizeof(type_buf)) {
-        memcpy(type_buf, type, len);
-        type_buf[len] = '\0';
-        const char *body = sep + 1;
-        return make_exception(ctx, type_buf, "RuntimeException", 1, "", 1, 1, body, NULL, NULL, NULL);
-      }
-    }
+  memcpy(pending, err, sizeof(PS_Error));
+  PS_Value *ex = ps_value_alloc(ctx, PS_V_EXCEPTION);
+  if (!ex) {
+    free(pending);
+    ps_throw_diag(ctx, PS_ERR_OOM, "out of memory", "exception allocation failed", "available memory");
+    return NULL;
   }
-  const char *code = NULL;
-  const char *category = ps_runtime_category(ps_last_error_code(ctx), msg, &code);
-  return make_exception(ctx, "RuntimeException", "Exception", 1, "", 1, 1, msg, NULL, code, category);
+  ex->as.exc_v.is_runtime = 1;
+  ex->as.exc_v.static_names = 1;
+  ex->as.exc_v.type_name = (char *)"RuntimeException";
+  ex->as.exc_v.parent_name = (char *)"Exception";
+  ex->as.exc_v.line = 1;
+  ex->as.exc_v.column = 1;
+  ex->as.exc_v.pending = pending;
+  return ex;
 }
 
 static void set_exception_location(PS_Context *ctx, PS_Value *v, const char *file, int line, int col) {
   if (!v || v->tag != PS_V_EXCEPTION) return;
   ps_diag_normalize_loc(&line, &col);
   const char *fname = file ? file : "";
-  PS_Value *f = ps_make_string_utf8(ctx, fname, strlen(fname));
+  size_t flen = strlen(fname);
+  // Exceptions raised from the same source file share one string value.
+  PS_Value *f = ctx->exc_file;
+  if (!f || f->as.string_v.len != flen || memcmp(f->as.string_v.ptr, fname, flen) != 0) {
+    f = ps_make_string_utf8(ctx, fname, flen);
+    if (f) {
+      if (ctx->exc_file) ps_value_release(ctx->exc_file);
+      ctx->exc_file = f;
+    }
+  }
   if (f) {
     if (v->as.exc_v.file) ps_value_release(v->as.exc_v.file);
-    v->as.exc_v.file = f;
+    v->as.exc_v.file = ps_value_retain(f);
   }
   v->as.exc_v.line = line;
   v->as.exc_v.column = col;
 }
 
-static PS_IR_Proto *proto_find_meta(PS_IR_Module *m, const char *name) {
-  if (!m || !name) return NULL;
+// Prototype by interned name (object proto_name, IR names): pointer equality.
+static PS_IR_Proto *proto_find_id(PS_IR_Module *m, const char *id) {
+  if (!m || !id) return NULL;
   for (size_t i = 0; i < m->proto_count; i++) {
-    if (m->protos[i].name && strcmp(m->protos[i].name, name) == 0) return &m->protos[i];
+    if (m->protos[i].name == id) return &m->protos[i];
   }
   return NULL;
 }
 
-static const char *proto_field_type_meta(PS_IR_Module *m, const char *proto_name, const char *field_name) {
-  if (!m || !proto_name || !field_name) return NULL;
-  PS_IR_Proto *p = proto_find_meta(m, proto_name);
+// Prototype by any name: a name that was never interned names no prototype.
+static PS_IR_Proto *proto_find_meta(PS_IR_Module *m, const char *name) {
+  return proto_find_id(m, ps_intern_lookup(name));
+}
+
+static const char *proto_field_type_meta(PS_IR_Module *m, const char *proto_id, const char *field_name) {
+  if (!m || !proto_id || !field_name) return NULL;
+  PS_IR_Proto *p = proto_find_id(m, proto_id);
   while (p) {
     for (size_t i = 0; i < p->field_count; i++) {
       if (p->fields[i].name && strcmp(p->fields[i].name, field_name) == 0) return p->fields[i].type;
     }
     if (!p->parent) break;
-    p = proto_find_meta(m, p->parent);
+    p = proto_find_id(m, p->parent);
   }
   return NULL;
 }
 
+// Type hints come from the IR and are interned already.
 static void apply_runtime_type_hint(PS_Context *ctx, PS_Value *v, const char *type_name) {
   if (!ctx || !v || !type_name || !*type_name) return;
   if (v->tag == PS_V_LIST) {
-    if (!ps_list_type_name_internal(v)) ps_list_set_type_name_internal(ctx, v, type_name);
+    if (!v->as.list_v.type_name) v->as.list_v.type_name = type_name;
     return;
   }
   if (v->tag == PS_V_MAP) {
-    if (!ps_map_type_name_internal(v)) ps_map_set_type_name_internal(ctx, v, type_name);
+    if (!v->as.map_v.type_name) v->as.map_v.type_name = type_name;
     return;
   }
   if (v->tag == PS_V_VIEW) {
-    if (!v->as.view_v.type_name) v->as.view_v.type_name = strdup(type_name);
+    if (!v->as.view_v.type_name) v->as.view_v.type_name = type_name;
     return;
   }
 }
 
 const PS_IR_Proto *ps_ir_find_proto(const PS_IR_Module *m, const char *name) {
-  if (!m || !name) return NULL;
-  for (size_t i = 0; i < m->proto_count; i++) {
-    if (m->protos[i].name && strcmp(m->protos[i].name, name) == 0) return &m->protos[i];
-  }
-  return NULL;
+  return proto_find_meta((PS_IR_Module *)m, name);
 }
 
 const PS_IR_Group *ps_ir_find_group(const PS_IR_Module *m, const char *name) {
@@ -1486,32 +2566,105 @@ static int proto_declares_method_meta(PS_IR_Module *m, const char *proto_name, c
   return 0;
 }
 
+// Subtyping between interned names: walks the parent chain by pointer.
+static int proto_is_subtype_id(PS_IR_Module *m, const char *child, const char *parent) {
+  if (!child || !parent) return 0;
+  if (child == parent) return 1;
+  PS_IR_Proto *p = proto_find_id(m, child);
+  for (size_t depth = 0; p && p->parent && depth < 64; depth++) {
+    if (p->parent == parent) return 1;
+    p = proto_find_id(m, p->parent);
+  }
+  return 0;
+}
+
 static int proto_is_subtype_meta(PS_IR_Module *m, const char *child, const char *parent) {
   if (!child || !parent) return 0;
-  if (strcmp(child, parent) == 0) return 1;
-  const char *cur = child;
-  for (size_t depth = 0; depth < 64; depth++) {
-    const char *par = proto_parent_name(m, cur);
-    if (!par) break;
-    if (strcmp(par, parent) == 0) return 1;
-    cur = par;
+  const char *child_id = ps_intern_lookup(child);
+  const char *parent_id = ps_intern_lookup(parent);
+  if (!child_id || !parent_id) return strcmp(child, parent) == 0;
+  return proto_is_subtype_id(m, child_id, parent_id);
+}
+
+// Builtin prototypes the VM tests objects against, interned on first use.
+enum {
+  PN_TEXT_FILE,
+  PN_BINARY_FILE,
+  PN_DIR,
+  PN_WALKER,
+  PN_JSON_READER,
+  PN_REGEXP,
+  PN_PATH_INFO,
+  PN_PATH_ENTRY,
+  PN_REGEXP_MATCH,
+  PN_PROCESS_EVENT,
+  PN_PROCESS_RESULT,
+  PN_CIVIL_DATE_TIME,
+  PN_EXCEPTION,
+  PN_RUNTIME_EXCEPTION,
+  PN_COUNT
+};
+
+static const char *const BUILTIN_PROTO_NAMES[PN_COUNT] = {
+  "TextFile", "BinaryFile", "Dir", "Walker", "JSONReader", "RegExp", "PathInfo", "PathEntry",
+  "RegExpMatch", "ProcessEvent", "ProcessResult", "CivilDateTime", "Exception", "RuntimeException",
+};
+
+static const char *g_builtin_protos[PN_COUNT];
+
+static const char *builtin_proto(int pn) {
+  if (!g_builtin_protos[pn]) g_builtin_protos[pn] = ps_intern(BUILTIN_PROTO_NAMES[pn]);
+  return g_builtin_protos[pn];
+}
+
+// The handle prototypes are tested in order, PN_TEXT_FILE to PN_PROCESS_RESULT.
+static const char *noncloneable_builtin_handle_base(PS_IR_Module *m, const char *proto_id) {
+  if (!m || !proto_id || !*proto_id) return NULL;
+  for (int pn = PN_TEXT_FILE; pn <= PN_PROCESS_RESULT; pn++) {
+    if (proto_is_subtype_id(m, proto_id, builtin_proto(pn))) return BUILTIN_PROTO_NAMES[pn];
+  }
+  return NULL;
+}
+
+// The RegExp module leaves the groups of a match as byte spans into the input
+// (`groups` is a bytes value of int64_t start/end pairs, -1 for a group that
+// did not participate, and `_input` the input string); the strings are sliced
+// on the first groups() call.
+static int regexp_match_groups(PS_Context *ctx, PS_Value *match) {
+  PS_Value *spans = ps_object_get_str_internal(ctx, match, "groups", 6);
+  if (!spans || spans->tag != PS_V_BYTES) return 1;
+  PS_Value *input = ps_object_get_str_internal(ctx, match, "_input", 6);
+  if (!input || input->tag != PS_V_STRING) {
+    ps_throw_diag(ctx, PS_ERR_TYPE, "missing builtin field", "_input", "initialized builtin object");
+    return 0;
+  }
+  PS_Value *list = ps_list_new(ctx);
+  if (!list) return 0;
+  size_t n = spans->as.bytes_v.len / (2 * sizeof(int64_t));
+  for (size_t g = 0; g < n; g++) {
+    int64_t ab[2];
+    memcpy(ab, spans->as.bytes_v.ptr + g * sizeof(ab), sizeof(ab));
+    size_t a = 0, b = 0;
+    if (ab[0] >= 0 && ab[1] >= ab[0] && (uint64_t)ab[1] <= input->as.string_v.len) {
+      a = (size_t)ab[0];
+      b = (size_t)ab[1];
+    }
+    PS_Value *part = ps_string_from_utf8(ctx, input->as.string_v.ptr + a, b - a);
+    if (!part || !ps_list_push_owned_internal(ctx, list, part)) {
+      if (part) ps_value_release(part);
+      ps_value_release(list);
+      return 0;
+    }
   }
-  return 0;
-}
-
-static const char *noncloneable_builtin_handle_base(PS_IR_Module *m, const char *proto_name) {
-  if (!m || !proto_name || !*proto_name) return NULL;
-  if (proto_is_subtype_meta(m, proto_name, "TextFile")) return "TextFile";
-  if (proto_is_subtype_meta(m, proto_name, "BinaryFile")) return "BinaryFile";
-  if (proto_is_subtype_meta(m, proto_name, "Dir")) return "Dir";
-  if (proto_is_subtype_meta(m, proto_name, "Walker")) return "Walker";
-  if (proto_is_subtype_meta(m, proto_name, "RegExp")) return "RegExp";
-  if (proto_is_subtype_meta(m, proto_name, "PathInfo")) return "PathInfo";
-  if (proto_is_subtype_meta(m, proto_name, "PathEntry")) return "PathEntry";
-  if (proto_is_subtype_meta(m, proto_name, "RegExpMatch")) return "RegExpMatch";
-  if (proto_is_subtype_meta(m, proto_name, "ProcessEvent")) return "ProcessEvent";
-  if (proto_is_subtype_meta(m, proto_name, "ProcessResult")) return "ProcessResult";
-  return NULL;
+  int ok = ps_object_set_str_internal(ctx, match, "groups", 6, list);
+  ps_value_release(list);
+  if (!ok) return 0;
+  // The input is no longer needed once the strings exist.
+  PS_Value *none = ps_make_bool(ctx, 0);
+  if (!none) return 0;
+  ok = ps_object_set_str_internal(ctx, match, "_input", 6, none);
+  ps_value_release(none);
+  return ok;
 }
 
 static const char *noncloneable_builtin_handle_base_from_object_shape(PS_Context *ctx, PS_Value *obj) {
@@ -1547,6 +2700,7 @@ static PS_Value *exception_get_field(PS_Context *ctx, PS_Value *v, const char *n
     ps_throw_diag(ctx, PS_ERR_TYPE, "invalid exception access", got, "Exception");
     return NULL;
   }
+  ps_exception_resolve(ctx, v);
   if (strcmp(name, "file") == 0) return v->as.exc_v.file ? ps_value_retain(v->as.exc_v.file) : ps_make_string_utf8(ctx, "", 0);
   if (strcmp(name, "line") == 0) return ps_make_int(ctx, v->as.exc_v.line);
   if (strcmp(name, "column") == 0) return ps_make_int(ctx, v->as.exc_v.column);
@@ -1577,15 +2731,9 @@ static PS_Value *map_first_key(PS_Value *map) {
 
 static int exec_function(PS_Context *ctx, PS_IR_Module *m, IRFunction *f, PS_Value **args, size_t argc, PS_Value **out);
 
-static int json_value_kind_runtime(PS_Context *ctx, PS_Value *v, const char **kind, PS_Value **out_val) {
-  if (!v || v->tag != PS_V_OBJECT) return 0;
-  const char *kkey = "__json_kind";
-  const char *vkey = "__json_value";
-  PS_Value *k = ps_object_get_str_internal(ctx, v, kkey, strlen(kkey));
-  if (!k || k->tag != PS_V_STRING) return 0;
-  if (kind) *kind = k->as.string_v.ptr;
-  if (out_val) *out_val = ps_object_get_str_internal(ctx, v, vkey, strlen(vkey));
-  return 1;
+static const char *json_kind_name(PS_JsonKind kind) {
+  static const char *const names[] = {"null", "bool", "number", "string", "array", "object"};
+  return (unsigned)kind <= PS_JSON_KIND_OBJECT ? names[kind] : "unknown";
 }
 
 static int module_is_std(const char *name) {
@@ -1606,7 +2754,7 @@ static int exec_call_static(PS_Context *ctx, PS_IR_Module *m, const char *callee
       if (proto_len < sizeof(proto_name)) {
         memcpy(proto_name, callee, proto_len);
         proto_name[proto_len] = '\0';
-        const char *handle_base = noncloneable_builtin_handle_base(m, proto_name);
+        const char *handle_base = noncloneable_builtin_handle_base(m, ps_intern_lookup(proto_name));
         if (handle_base && !proto_declares_method_meta(m, proto_name, "clone")) {
           char msg[256];
           snprintf(msg, sizeof(msg), "clone not supported for builtin handle %s", handle_base);
@@ -1631,6 +2779,7 @@ static int exec_call_static(PS_Context *ctx, PS_IR_Module *m, const char *callee
       symbol[sizeof(symbol) - 1] = '\0';
       const PS_NativeFnDesc *desc = ps_module_find_fn(ctx, module, symbol);
       if (!desc) return 1;
+      if (ctx->profile) ps_profile_builtin(ctx->profile, module, symbol);
       PS_Value *ret = NULL;
       PS_Status st = desc->fn(ctx, (int)argc, args, &ret);
       if (st != PS_OK) {
@@ -1656,15 +2805,14 @@ static int exec_call_static(PS_Context *ctx, PS_IR_Module *m, const char *callee
   return 1;
 }
 
-static int exec_function(PS_Context *ctx, PS_IR_Module *m, IRFunction *f, PS_Value **args, size_t argc, PS_Value **out) {
+static int exec_frame(PS_Context *ctx, PS_IR_Module *m, IRFunction *f, PS_Value **args, size_t argc, PS_Value **out) {
+  PS_Profile *prof = ctx->profile;
+  PS_Sampler *samp = ctx->sampler;
+  volatile PS_SampleFrame *sframe = samp ? ps_sampler_top(samp) : NULL;
+  // Synthetic clone bodies keep the site of the `clone()` call.
+  PS_Census *census = ctx->heap.census && !is_clone_static(f->name) ? ctx->heap.census : NULL;
   PS_Bindings vars = {0};
   PS_Bindings temps = {0};
-  typedef struct {
-    const char *handler;
-  } TryFrame;
-  TryFrame *tries = NULL;
-  size_t try_len = 0;
-  size_t try_cap = 0;
   PS_Value *last_exception = NULL;
   const char *cur_file = NULL;
   int cur_line = 0;
@@ -1674,7 +2822,7 @@ static int exec_function(PS_Context *ctx, PS_IR_Module *m, IRFunction *f, PS_Val
     bindings_set(&vars, f->params[i], args[i]);
   }
   if (f->variadic && f->variadic_index < f->param_count) {
-    PS_Value *view = ps_value_alloc(PS_V_VIEW);
+    PS_Value *view = ps_value_alloc(ctx, PS_V_VIEW);
     if (!view) {
       bindings_free(&vars);
       bindings_free(&temps);
@@ -1686,1042 +2834,1757 @@ static int exec_function(PS_Context *ctx, PS_IR_Module *m, IRFunction *f, PS_Val
     view->as.view_v.len = argc - fixed;
     view->as.view_v.readonly = 1;
     view->as.view_v.version = 0;
-    view->as.view_v.type_name = NULL;
-    if (f->param_types && f->param_types[f->variadic_index]) {
-      view->as.view_v.type_name = strdup(f->param_types[f->variadic_index]);
-    }
+    view->as.view_v.type_name = f->param_types ? f->param_types[f->variadic_index] : NULL;
     bindings_set(&vars, f->params[f->variadic_index], view);
     ps_value_release(view);
   }
   size_t block_idx = 0;
   size_t ip = 0;
+  size_t entry_ip = 0;
+  const IRInstr *pending_kills = NULL;
   while (block_idx < f->block_count) {
     IRBlock *b = &f->blocks[block_idx];
-    for (ip = 0; ip < b->instr_count; ip++) {
+    ip = entry_ip;
+    entry_ip = 0;
+    for (; ip < b->instr_count; ip++) {
       IRInstr *ins = &b->instrs[ip];
+      if (pending_kills) {
+        for (size_t k = 0; k < pending_kills->kill_count; k++) bindings_clear(&temps, pending_kills->kills[k]);
+        pending_kills = NULL;
+      }
       if (ins->file || ins->line || ins->col) {
         cur_file = ins->file;
         cur_line = ins->line;
         cur_col = ins->col;
+        if (sframe) {
+          sframe->file = cur_file;
+          sframe->line = cur_line;
+        }
+        if (census) ps_census_site(census, cur_file, cur_line);
       }
       if (!ins->op) continue;
+      if (ins->kill_count) pending_kills = ins;
+      IROp op = ins->fused != IR_OP_UNKNOWN ? ins->fused : ins->opcode;
       if (ctx->trace) fprintf(stderr, "[trace] %s\n", ins->op);
-      if (ctx->trace_ir) fprintf(stderr, "[ir] %s\n", ins->op);
-      if (strcmp(ins->op, "nop") == 0) continue;
-      if (strcmp(ins->op, "var_decl") == 0) {
-        PS_Value *def = default_value_for_type(ctx, ins->type);
-        bindings_set(&vars, ins->name, def);
-        if (def) ps_value_release(def);
-        continue;
-      }
-      if (strcmp(ins->op, "const") == 0) {
-        PS_Value *v = value_from_literal(ctx, ins->literalType, NULL, ins->value);
-        if (!v) goto raise;
-        bindings_set(&temps, ins->dst, v);
-        ps_value_release(v);
-        continue;
-      }
-      if (strcmp(ins->op, "push_handler") == 0) {
-        if (try_len == try_cap) {
-          size_t nc = try_cap == 0 ? 4 : try_cap * 2;
-          TryFrame *nt = (TryFrame *)realloc(tries, sizeof(TryFrame) * nc);
-          if (!nt) {
-            ps_throw_diag(ctx, PS_ERR_OOM, "out of memory", "try handler allocation failed", "available memory");
-            goto raise;
-          }
-          tries = nt;
-          try_cap = nc;
+      if (ctx->trace_ir) fprintf(stderr, "[ir] %s\n", op != IR_OP_UNKNOWN ? IR_OP_NAMES[op] : ins->op);
+      if (prof) {
+        ps_profile_op(prof, (int)op, op != IR_OP_UNKNOWN ? IR_OP_NAMES[op] : "unknown");
+        ps_profile_site(prof, cur_file, cur_line);
+        if (ins->method && ins->receiver) {
+          ps_profile_builtin(prof, value_type_name(get_value(&temps, &vars, ins->receiver)), ins->method);
         }
-        tries[try_len++].handler = ins->target;
-        continue;
-      }
-      if (strcmp(ins->op, "pop_handler") == 0) {
-        if (try_len > 0) try_len -= 1;
-        continue;
       }
-      if (strcmp(ins->op, "get_exception") == 0) {
-        if (!last_exception) {
-          last_exception = make_runtime_exception_from_error(ctx);
-          if (!last_exception) goto raise;
+    dispatch:
+      switch (op) {
+        case IR_OP_NOP:
+          continue;
+        case IR_OP_VAR_DECL: {
+          PS_Value *def = default_value_for_type(ctx, ins->type);
+          bindings_set(&vars, ins->name, def);
+          if (def) ps_value_release(def);
+          continue;
         }
-        bindings_set(&temps, ins->dst, last_exception);
-        continue;
-      }
-      if (strcmp(ins->op, "rethrow") == 0) {
-        if (!last_exception) {
-          ps_throw_diag(ctx, PS_ERR_INTERNAL, "invalid rethrow", "no active exception", "active exception");
+        case IR_OP_CONST: {
+          PS_Value *v = value_from_literal(ctx, ins->literalType, NULL, ins->value);
+          if (!v) goto raise;
+          bindings_set(&temps, ins->dst, v);
+          ps_value_release(v);
+          continue;
         }
-        goto raise;
-      }
-      if (strcmp(ins->op, "exception_is") == 0) {
-        PS_Value *v = get_value(&temps, &vars, ins->value);
-        int ok = exception_matches(m, v, ins->type);
-        PS_Value *b = ps_make_bool(ctx, ok);
-        if (!b) goto raise;
-        bindings_set(&temps, ins->dst, b);
-        ps_value_release(b);
-        continue;
-      }
-      if (strcmp(ins->op, "load_var") == 0) {
-        PS_Value *v = bindings_get(&vars, ins->name);
-        apply_runtime_type_hint(ctx, v, ins->type);
-        bindings_set(&temps, ins->dst, v);
-        continue;
-      }
-      if (strcmp(ins->op, "store_var") == 0) {
-        PS_Value *v = get_value(&temps, &vars, ins->src);
-        bindings_set(&vars, ins->name, v);
-        continue;
-      }
-      if (strcmp(ins->op, "copy") == 0) {
-        PS_Value *v = get_value(&temps, &vars, ins->src);
-        bindings_set(&temps, ins->dst, v);
-        continue;
-      }
-      if (strcmp(ins->op, "member_get") == 0) {
-        PS_Value *recv = get_value(&temps, &vars, ins->target);
-        if (recv && recv->tag == PS_V_EXCEPTION) {
-          PS_Value *field = exception_get_field(ctx, recv, ins->name);
-          if (!field && ps_last_error_code(ctx) != PS_ERR_NONE) goto raise;
-          bindings_set(&temps, ins->dst, field);
-          if (field) ps_value_release(field);
+        case IR_OP_PUSH_HANDLER:
+        case IR_OP_POP_HANDLER:
+          // Handler ranges are resolved at load time (handlers_function).
+          continue;
+        case IR_OP_GET_EXCEPTION: {
+          if (!last_exception) {
+            last_exception = make_runtime_exception_from_error(ctx);
+            if (!last_exception) goto raise;
+          }
+          bindings_set(&temps, ins->dst, last_exception);
           continue;
         }
-        if (recv && recv->tag == PS_V_OBJECT) {
-          PS_Value *field = ps_object_get_str_internal(ctx, recv, ins->name ? ins->name : "", ins->name ? strlen(ins->name) : 0);
-          const char *hint = NULL;
-          if (field) {
-            const char *proto_name = ps_object_proto_name_internal(recv);
-            hint = proto_field_type_meta(m, proto_name, ins->name ? ins->name : "");
+        case IR_OP_RETHROW: {
+          if (!last_exception) {
+            ps_throw_diag(ctx, PS_ERR_INTERNAL, "invalid rethrow", "no active exception", "active exception");
           }
-          apply_runtime_type_hint(ctx, field, hint);
-          bindings_set(&temps, ins->dst, field);
+          goto raise;
+        }
+        case IR_OP_EXCEPTION_IS: {
+          PS_Value *v = get_value(&temps, &vars, ins->value);
+          int ok = exception_matches(m, v, ins->type);
+          PS_Value *b = ps_make_bool(ctx, ok);
+          if (!b) goto raise;
+          bindings_set(&temps, ins->dst, b);
+          ps_value_release(b);
           continue;
         }
-        {
-          char got[64];
-          snprintf(got, sizeof(got), "%s", value_type_name(recv));
-          ps_throw_diag(ctx, PS_ERR_TYPE, "member access on non-object", got, "object");
+        case IR_OP_LOAD_VAR: {
+          PS_Value *v = bindings_get(&vars, ins->name);
+          apply_runtime_type_hint(ctx, v, ins->type);
+          bindings_set(&temps, ins->dst, v);
+          continue;
         }
-        goto raise;
-      }
-      if (strcmp(ins->op, "member_set") == 0) {
-        PS_Value *recv = get_value(&temps, &vars, ins->target);
-        PS_Value *val = get_value(&temps, &vars, ins->src);
-        if (recv && recv->tag == PS_V_EXCEPTION) {
-          if (strcmp(ins->name, "file") == 0) {
-            if (recv->as.exc_v.file) ps_value_release(recv->as.exc_v.file);
-            recv->as.exc_v.file = val ? ps_value_retain(val) : ps_make_string_utf8(ctx, "", 0);
-            continue;
-          }
-          if (strcmp(ins->name, "line") == 0) {
-            recv->as.exc_v.line = val && val->tag == PS_V_INT ? val->as.int_v : recv->as.exc_v.line;
-            continue;
+        case IR_OP_STORE_VAR: {
+          if (ins->move_src) {
+            PS_Value *moved = bindings_take(&temps, ins->src);
+            if (moved) {
+              bindings_set_owned(&vars, ins->name, moved);
+              continue;
+            }
           }
-          if (strcmp(ins->name, "column") == 0) {
-            recv->as.exc_v.column = val && val->tag == PS_V_INT ? val->as.int_v : recv->as.exc_v.column;
+          PS_Value *v = get_value(&temps, &vars, ins->src);
+          bindings_set(&vars, ins->name, v);
+          continue;
+        }
+        case IR_OP_COPY: {
+          PS_Value *v = get_value(&temps, &vars, ins->src);
+          bindings_set(&temps, ins->dst, v);
+          continue;
+        }
+        case IR_OP_MEMBER_GET: {
+          PS_Value *recv = get_value(&temps, &vars, ins->target);
+          if (recv && recv->tag == PS_V_EXCEPTION) {
+            PS_Value *field = exception_get_field(ctx, recv, ins->name);
+            if (!field && ps_last_error_code(ctx) != PS_ERR_NONE) goto raise;
+            bindings_set(&temps, ins->dst, field);
+            if (field) ps_value_release(field);
             continue;
           }
-          if (strcmp(ins->name, "message") == 0) {
-            if (recv->as.exc_v.message) ps_value_release(recv->as.exc_v.message);
-            recv->as.exc_v.message = val ? ps_value_retain(val) : ps_make_string_utf8(ctx, "", 0);
+          if (recv && recv->tag == PS_V_OBJECT) {
+            PS_Value *field = ps_object_get_str_internal(ctx, recv, ins->name ? ins->name : "", ins->name ? strlen(ins->name) : 0);
+            const char *hint = NULL;
+            if (field) {
+              const char *proto_name = ps_object_proto_name_internal(recv);
+              hint = proto_field_type_meta(m, proto_name, ins->name ? ins->name : "");
+            }
+            apply_runtime_type_hint(ctx, field, hint);
+            bindings_set(&temps, ins->dst, field);
             continue;
           }
-          if (strcmp(ins->name, "cause") == 0) {
-            if (recv->as.exc_v.cause) ps_value_release(recv->as.exc_v.cause);
-            recv->as.exc_v.cause = val ? ps_value_retain(val) : NULL;
-            continue;
+          {
+            char got[64];
+            snprintf(got, sizeof(got), "%s", value_type_name(recv));
+            ps_throw_diag(ctx, PS_ERR_TYPE, "member access on non-object", got, "object");
           }
-          if (strcmp(ins->name, "code") == 0) {
-            if (recv->as.exc_v.code) ps_value_release(recv->as.exc_v.code);
-            recv->as.exc_v.code = val ? ps_value_retain(val) : ps_make_string_utf8(ctx, "", 0);
+          goto raise;
+        }
+        case IR_OP_MEMBER_SET: {
+          PS_Value *recv = get_value(&temps, &vars, ins->target);
+          PS_Value *val = get_value(&temps, &vars, ins->src);
+          if (recv && recv->tag == PS_V_EXCEPTION) {
+            ps_exception_resolve(ctx, recv);
+            if (strcmp(ins->name, "file") == 0) {
+              if (recv->as.exc_v.file) ps_value_release(recv->as.exc_v.file);
+              recv->as.exc_v.file = val ? ps_value_retain(val) : ps_make_string_utf8(ctx, "", 0);
+              continue;
+            }
+            if (strcmp(ins->name, "line") == 0) {
+              recv->as.exc_v.line = val && val->tag == PS_V_INT ? val->as.int_v : recv->as.exc_v.line;
+              continue;
+            }
+            if (strcmp(ins->name, "column") == 0) {
+              recv->as.exc_v.column = val && val->tag == PS_V_INT ? val->as.int_v : recv->as.exc_v.column;
+              continue;
+            }
+            if (strcmp(ins->name, "message") == 0) {
+              if (recv->as.exc_v.message) ps_value_release(recv->as.exc_v.message);
+              recv->as.exc_v.message = val ? ps_value_retain(val) : ps_make_string_utf8(ctx, "", 0);
+              continue;
+            }
+            if (strcmp(ins->name, "cause") == 0) {
+              if (recv->as.exc_v.cause) ps_value_release(recv->as.exc_v.cause);
+              recv->as.exc_v.cause = val ? ps_value_retain(val) : NULL;
+              continue;
+            }
+            if (strcmp(ins->name, "code") == 0) {
+              if (recv->as.exc_v.code) ps_value_release(recv->as.exc_v.code);
+              recv->as.exc_v.code = val ? ps_value_retain(val) : ps_make_string_utf8(ctx, "", 0);
+              continue;
+            }
+            if (strcmp(ins->name, "category") == 0) {
+              if (recv->as.exc_v.category) ps_value_release(recv->as.exc_v.category);
+              recv->as.exc_v.category = val ? ps_value_retain(val) : ps_make_string_utf8(ctx, "", 0);
+              continue;
+            }
+            if (!recv->as.exc_v.fields) {
+              recv->as.exc_v.fields = ps_object_new(ctx);
+              if (!recv->as.exc_v.fields) goto raise;
+            }
+            if (!ps_object_set_str_internal(ctx, recv->as.exc_v.fields, ins->name ? ins->name : "", ins->name ? strlen(ins->name) : 0, val)) {
+              goto raise;
+            }
             continue;
           }
-          if (strcmp(ins->name, "category") == 0) {
-            if (recv->as.exc_v.category) ps_value_release(recv->as.exc_v.category);
-            recv->as.exc_v.category = val ? ps_value_retain(val) : ps_make_string_utf8(ctx, "", 0);
+          if (recv && recv->tag == PS_V_OBJECT) {
+            if (!ps_object_set_str_internal(ctx, recv, ins->name ? ins->name : "", ins->name ? strlen(ins->name) : 0, val)) {
+              goto raise;
+            }
             continue;
           }
-          if (!recv->as.exc_v.fields) {
-            recv->as.exc_v.fields = ps_object_new(ctx);
-            if (!recv->as.exc_v.fields) goto raise;
+          {
+            char got[64];
+            snprintf(got, sizeof(got), "%s", value_type_name(recv));
+            ps_throw_diag(ctx, PS_ERR_TYPE, "member assignment on non-object", got, "object");
           }
-          if (!ps_object_set_str_internal(ctx, recv->as.exc_v.fields, ins->name ? ins->name : "", ins->name ? strlen(ins->name) : 0, val)) {
-            goto raise;
+          goto raise;
+        }
+        case IR_OP_MAKE_OBJECT: {
+          if (ins->proto && proto_is_subtype_id(m, ins->proto, builtin_proto(PN_EXCEPTION))) {
+            int is_rt = proto_is_subtype_id(m, ins->proto, builtin_proto(PN_RUNTIME_EXCEPTION));
+            PS_IR_Proto *meta = proto_find_id(m, ins->proto);
+            const char *parent = meta ? meta->parent : NULL;
+            PS_Value *ex = make_exception(ctx, ins->proto, parent, is_rt, "", 1, 1, "", NULL,
+                                          is_rt ? "" : NULL, is_rt ? "" : NULL);
+            if (!ex) goto raise;
+            bindings_set(&temps, ins->dst, ex);
+            ps_value_release(ex);
+          } else {
+            PS_Value *obj = ps_object_new(ctx);
+            if (!obj) goto raise;
+            obj->as.object_v.proto_name = ins->proto;
+            bindings_set(&temps, ins->dst, obj);
+            ps_value_release(obj);
           }
           continue;
         }
-        if (recv && recv->tag == PS_V_OBJECT) {
-          if (!ps_object_set_str_internal(ctx, recv, ins->name ? ins->name : "", ins->name ? strlen(ins->name) : 0, val)) {
+        case IR_OP_CHECK_DIV_ZERO: {
+          PS_Value *v = get_value(&temps, &vars, ins->divisor);
+          if (v && v->tag == PS_V_INT && v->as.int_v == 0) {
+            ps_throw_diag(ctx, PS_ERR_RANGE, "division by zero", "0", "non-zero divisor");
             goto raise;
           }
           continue;
         }
-        {
-          char got[64];
-          snprintf(got, sizeof(got), "%s", value_type_name(recv));
-          ps_throw_diag(ctx, PS_ERR_TYPE, "member assignment on non-object", got, "object");
-        }
-        goto raise;
-      }
-      if (strcmp(ins->op, "make_object") == 0) {
-        if (ins->proto && proto_is_subtype_meta(m, ins->proto, "Exception")) {
-          int is_rt = proto_is_subtype_meta(m, ins->proto, "RuntimeException");
-          const char *parent = proto_parent_name(m, ins->proto);
-          PS_Value *ex = make_exception(ctx, ins->proto, parent, is_rt, "", 1, 1, "", NULL,
-                                        is_rt ? "" : NULL, is_rt ? "" : NULL);
-          if (!ex) goto raise;
-          bindings_set(&temps, ins->dst, ex);
-          ps_value_release(ex);
-        } else {
-          PS_Value *obj = ps_object_new(ctx);
-          if (!obj) goto raise;
-          if (ins->proto) ps_object_set_proto_name_internal(ctx, obj, ins->proto);
-          bindings_set(&temps, ins->dst, obj);
-          ps_value_release(obj);
-        }
-        continue;
-      }
-      if (strcmp(ins->op, "check_div_zero") == 0) {
-        PS_Value *v = get_value(&temps, &vars, ins->divisor);
-        if (v && v->tag == PS_V_INT && v->as.int_v == 0) {
-          ps_throw_diag(ctx, PS_ERR_RANGE, "division by zero", "0", "non-zero divisor");
-          goto raise;
-        }
-        continue;
-      }
-      if (strcmp(ins->op, "check_int_overflow_unary_minus") == 0) {
-        PS_Value *v = get_value(&temps, &vars, ins->value);
-        if (v && v->tag == PS_V_INT && v->as.int_v == INT64_MIN) {
-          ps_throw_diag(ctx, PS_ERR_RANGE, "int overflow", "value", "value within int range");
-          goto raise;
-        }
-        continue;
-      }
-      if (strcmp(ins->op, "check_int_overflow") == 0) {
-        PS_Value *l = get_value(&temps, &vars, ins->left);
-        PS_Value *r = get_value(&temps, &vars, ins->right);
-        if (!l || !r) goto raise;
-        int64_t a = l->as.int_v;
-        int64_t b = r->as.int_v;
-        if (strcmp(ins->operator, "+") == 0) {
-          if ((b > 0 && a > INT64_MAX - b) || (b < 0 && a < INT64_MIN - b)) {
-            ps_throw_diag(ctx, PS_ERR_RANGE, "int overflow", "value", "value within int range");
-            goto raise;
-          }
-        } else if (strcmp(ins->operator, "-") == 0) {
-          if ((b < 0 && a > INT64_MAX + b) || (b > 0 && a < INT64_MIN + b)) {
+        case IR_OP_CHECK_INT_OVERFLOW_UNARY_MINUS: {
+          PS_Value *v = get_value(&temps, &vars, ins->value);
+          if (v && v->tag == PS_V_INT && v->as.int_v == INT64_MIN) {
             ps_throw_diag(ctx, PS_ERR_RANGE, "int overflow", "value", "value within int range");
             goto raise;
           }
-        } else if (strcmp(ins->operator, "*") == 0) {
-          if (a != 0 && b != 0) {
-            if (a == -1 && b == INT64_MIN) {
+          continue;
+        }
+        case IR_OP_CHECK_INT_OVERFLOW:
+        check_int_overflow_generic: {
+          PS_Value *l = get_value(&temps, &vars, ins->left);
+          PS_Value *r = get_value(&temps, &vars, ins->right);
+          if (!l || !r) goto raise;
+          int64_t a = l->as.int_v;
+          int64_t b = r->as.int_v;
+          if (ins->binop == IR_BIN_ADD) {
+            if ((b > 0 && a > INT64_MAX - b) || (b < 0 && a < INT64_MIN - b)) {
               ps_throw_diag(ctx, PS_ERR_RANGE, "int overflow", "value", "value within int range");
               goto raise;
             }
-            if (b == -1 && a == INT64_MIN) {
+          } else if (ins->binop == IR_BIN_SUB) {
+            if ((b < 0 && a > INT64_MAX + b) || (b > 0 && a < INT64_MIN + b)) {
               ps_throw_diag(ctx, PS_ERR_RANGE, "int overflow", "value", "value within int range");
               goto raise;
             }
-            if (llabs(a) > INT64_MAX / llabs(b)) {
-              ps_throw_diag(ctx, PS_ERR_RANGE, "int overflow", "value", "value within int range");
-              goto raise;
+          } else if (ins->binop == IR_BIN_MUL) {
+            if (a != 0 && b != 0) {
+              if (a == -1 && b == INT64_MIN) {
+                ps_throw_diag(ctx, PS_ERR_RANGE, "int overflow", "value", "value within int range");
+                goto raise;
+              }
+              if (b == -1 && a == INT64_MIN) {
+                ps_throw_diag(ctx, PS_ERR_RANGE, "int overflow", "value", "value within int range");
+                goto raise;
+              }
+              if (llabs(a) > INT64_MAX / llabs(b)) {
+                ps_throw_diag(ctx, PS_ERR_RANGE, "int overflow", "value", "value within int range");
+                goto raise;
+              }
             }
           }
+          continue;
         }
-        continue;
-      }
-      if (strcmp(ins->op, "check_shift_range") == 0) {
-        PS_Value *s = get_value(&temps, &vars, ins->shift);
-        int64_t sh = s ? s->as.int_v : 0;
-        if (sh < 0 || sh >= (int64_t)ins->width) {
-          char got[32];
-          char expected[64];
-          snprintf(got, sizeof(got), "%lld", (long long)sh);
-          snprintf(expected, sizeof(expected), "0..%d", ins->width - 1);
-          ps_throw_diag(ctx, PS_ERR_RANGE, "invalid shift", got, expected);
-          goto raise;
-        }
-        continue;
-      }
-      if (strcmp(ins->op, "check_index_bounds") == 0) {
-        PS_Value *t = get_value(&temps, &vars, ins->target);
-        PS_Value *i = get_value(&temps, &vars, ins->index);
-        if (!t || !i) goto raise;
-        size_t idx = (size_t)i->as.int_v;
-        size_t len = 0;
-        if (t->tag == PS_V_LIST) len = t->as.list_v.len;
-        else if (t->tag == PS_V_STRING) len = ps_utf8_glyph_len((const uint8_t *)t->as.string_v.ptr, t->as.string_v.len);
-        else if (t->tag == PS_V_VIEW) len = t->as.view_v.len;
-        if (idx >= len) {
-          char got[64];
-          snprintf(got, sizeof(got), "%zu", idx);
-          ps_throw_diag(ctx, PS_ERR_RANGE, "index out of bounds", got, "index within bounds");
-          goto raise;
-        }
-        continue;
-      }
-      if (strcmp(ins->op, "check_view_bounds") == 0) {
-        PS_Value *t = get_value(&temps, &vars, ins->target);
-        PS_Value *o = get_value(&temps, &vars, ins->offset);
-        PS_Value *l = get_value(&temps, &vars, ins->len);
-        if (!t || !o || !l) goto raise;
-        int64_t off = o->as.int_v;
-        int64_t ln = l->as.int_v;
-        if (off < 0 || ln < 0) {
-          ps_throw_diag(ctx, PS_ERR_RANGE, "index out of bounds", "offset/length", "within source");
-          goto raise;
-        }
-        size_t total = 0;
-        if (t->tag == PS_V_LIST) total = t->as.list_v.len;
-        else if (t->tag == PS_V_STRING) total = ps_utf8_glyph_len((const uint8_t *)t->as.string_v.ptr, t->as.string_v.len);
-        else if (t->tag == PS_V_VIEW) total = t->as.view_v.len;
-        if ((uint64_t)off + (uint64_t)ln > total) {
-          ps_throw_diag(ctx, PS_ERR_RANGE, "index out of bounds", "offset/length", "within source");
-          goto raise;
-        }
-        continue;
-      }
-      if (strcmp(ins->op, "check_map_has_key") == 0) {
-        PS_Value *mval = get_value(&temps, &vars, ins->map);
-        PS_Value *k = get_value(&temps, &vars, ins->key);
-        if (!ps_map_has_key(ctx, mval, k)) {
-          char got[128];
-          format_value_short(k, got, sizeof(got));
-          ps_throw_diag(ctx, PS_ERR_RANGE, "missing key", got, "present key");
-          goto raise;
-        }
-        continue;
-      }
-      if (strcmp(ins->op, "bin_op") == 0) {
-        PS_Value *l = get_value(&temps, &vars, ins->left);
-        PS_Value *r = get_value(&temps, &vars, ins->right);
-        if (!l || !r) goto raise;
-        int is_numeric = (l->tag == PS_V_INT || l->tag == PS_V_BYTE || l->tag == PS_V_FLOAT) &&
-                         (r->tag == PS_V_INT || r->tag == PS_V_BYTE || r->tag == PS_V_FLOAT);
-        int is_float = (l->tag == PS_V_FLOAT || r->tag == PS_V_FLOAT);
-        int64_t li = (l->tag == PS_V_BYTE) ? (int64_t)l->as.byte_v : l->as.int_v;
-        int64_t ri = (r->tag == PS_V_BYTE) ? (int64_t)r->as.byte_v : r->as.int_v;
-        double lf = (l->tag == PS_V_FLOAT) ? l->as.float_v : (double)li;
-        double rf = (r->tag == PS_V_FLOAT) ? r->as.float_v : (double)ri;
-        PS_Value *res = NULL;
-        if (strcmp(ins->operator, "+") == 0) {
-          if (!is_numeric) {
-            if (l->tag == PS_V_GLYPH || r->tag == PS_V_GLYPH) {
-              ps_throw_diag(ctx, PS_ERR_TYPE, "invalid glyph operation", "value", "compatible type");
-            } else {
-              char got[96];
-              snprintf(got, sizeof(got), "%s + %s", value_type_name(l), value_type_name(r));
-              ps_throw_diag(ctx, PS_ERR_TYPE, "invalid operand types", got, "numeric operands");
-            }
-            goto raise;
-          }
-          res = is_float ? ps_make_float(ctx, lf + rf) : ps_make_int(ctx, li + ri);
-        } else if (strcmp(ins->operator, "-") == 0) {
-          if (!is_numeric) {
-            if (l->tag == PS_V_GLYPH || r->tag == PS_V_GLYPH) {
-              ps_throw_diag(ctx, PS_ERR_TYPE, "invalid glyph operation", "value", "compatible type");
-            } else {
-              char got[96];
-              snprintf(got, sizeof(got), "%s - %s", value_type_name(l), value_type_name(r));
-              ps_throw_diag(ctx, PS_ERR_TYPE, "invalid operand types", got, "numeric operands");
-            }
-            goto raise;
-          }
-          res = is_float ? ps_make_float(ctx, lf - rf) : ps_make_int(ctx, li - ri);
-        } else if (strcmp(ins->operator, "*") == 0) {
-          if (!is_numeric) {
-            if (l->tag == PS_V_GLYPH || r->tag == PS_V_GLYPH) {
-              ps_throw_diag(ctx, PS_ERR_TYPE, "invalid glyph operation", "value", "compatible type");
-            } else {
-              char got[96];
-              snprintf(got, sizeof(got), "%s * %s", value_type_name(l), value_type_name(r));
-              ps_throw_diag(ctx, PS_ERR_TYPE, "invalid operand types", got, "numeric operands");
-            }
-            goto raise;
-          }
-          res = is_float ? ps_make_float(ctx, lf * rf) : ps_make_int(ctx, li * ri);
-        } else if (strcmp(ins->operator, "/") == 0) {
-          if (!is_numeric) {
-            if (l->tag == PS_V_GLYPH || r->tag == PS_V_GLYPH) {
-              ps_throw_diag(ctx, PS_ERR_TYPE, "invalid glyph operation", "value", "compatible type");
-            } else {
-              char got[96];
-              snprintf(got, sizeof(got), "%s / %s", value_type_name(l), value_type_name(r));
-              ps_throw_diag(ctx, PS_ERR_TYPE, "invalid operand types", got, "numeric operands");
-            }
-            goto raise;
-          }
-          res = is_float ? ps_make_float(ctx, lf / rf) : ps_make_int(ctx, li / ri);
-        } else if (strcmp(ins->operator, "%") == 0) {
-          if (!is_numeric || is_float) {
-            char got[96];
-            snprintf(got, sizeof(got), "%s %% %s", value_type_name(l), value_type_name(r));
-            ps_throw_diag(ctx, PS_ERR_TYPE, "invalid operand types", got, "int operands");
-            goto raise;
-          }
-          res = ps_make_int(ctx, li % ri);
-        } else if (strcmp(ins->operator, "<<") == 0) {
-          if (!is_numeric || is_float) {
-            char got[96];
-            snprintf(got, sizeof(got), "%s << %s", value_type_name(l), value_type_name(r));
-            ps_throw_diag(ctx, PS_ERR_TYPE, "invalid operand types", got, "int operands");
-            goto raise;
-          }
-          res = ps_make_int(ctx, li << ri);
-        } else if (strcmp(ins->operator, ">>") == 0) {
-          if (!is_numeric || is_float) {
-            char got[96];
-            snprintf(got, sizeof(got), "%s >> %s", value_type_name(l), value_type_name(r));
-            ps_throw_diag(ctx, PS_ERR_TYPE, "invalid operand types", got, "int operands");
-            goto raise;
-          }
-          res = ps_make_int(ctx, li >> ri);
-        } else if (strcmp(ins->operator, "&") == 0) {
-          if (!is_numeric || is_float) {
-            char got[96];
-            snprintf(got, sizeof(got), "%s & %s", value_type_name(l), value_type_name(r));
-            ps_throw_diag(ctx, PS_ERR_TYPE, "invalid operand types", got, "int operands");
-            goto raise;
-          }
-          res = ps_make_int(ctx, li & ri);
-        } else if (strcmp(ins->operator, "|") == 0) {
-          if (!is_numeric || is_float) {
-            char got[96];
-            snprintf(got, sizeof(got), "%s | %s", value_type_name(l), value_type_name(r));
-            ps_throw_diag(ctx, PS_ERR_TYPE, "invalid operand types", got, "int operands");
-            goto raise;
-          }
-          res = ps_make_int(ctx, li | ri);
-        } else if (strcmp(ins->operator, "^") == 0) {
-          if (!is_numeric || is_float) {
-            char got[96];
-            snprintf(got, sizeof(got), "%s ^ %s", value_type_name(l), value_type_name(r));
-            ps_throw_diag(ctx, PS_ERR_TYPE, "invalid operand types", got, "int operands");
+        case IR_OP_CHECK_SHIFT_RANGE: {
+          PS_Value *s = get_value(&temps, &vars, ins->shift);
+          int64_t sh = s ? s->as.int_v : 0;
+          if (sh < 0 || sh >= (int64_t)ins->width) {
+            char got[32];
+            char expected[64];
+            snprintf(got, sizeof(got), "%lld", (long long)sh);
+            snprintf(expected, sizeof(expected), "0..%d", ins->width - 1);
+            ps_throw_diag(ctx, PS_ERR_RANGE, "invalid shift", got, expected);
             goto raise;
           }
-          res = ps_make_int(ctx, li ^ ri);
-        }
-        else if (strcmp(ins->operator, "==") == 0) res = ps_make_bool(ctx, is_float ? (lf == rf) : values_equal(l, r));
-        else if (strcmp(ins->operator, "!=") == 0) res = ps_make_bool(ctx, is_float ? (lf != rf) : !values_equal(l, r));
-        else if (strcmp(ins->operator, "<") == 0) res = ps_make_bool(ctx, is_float ? (lf < rf) : (li < ri));
-        else if (strcmp(ins->operator, "<=") == 0) res = ps_make_bool(ctx, is_float ? (lf <= rf) : (li <= ri));
-        else if (strcmp(ins->operator, ">") == 0) res = ps_make_bool(ctx, is_float ? (lf > rf) : (li > ri));
-        else if (strcmp(ins->operator, ">=") == 0) res = ps_make_bool(ctx, is_float ? (lf >= rf) : (li >= ri));
-        else if (strcmp(ins->operator, "&&") == 0) res = ps_make_bool(ctx, is_truthy(l) && is_truthy(r));
-        else if (strcmp(ins->operator, "||") == 0) res = ps_make_bool(ctx, is_truthy(l) || is_truthy(r));
-        if (!res) goto raise;
-        bindings_set(&temps, ins->dst, res);
-        ps_value_release(res);
-        continue;
-      }
-      if (strcmp(ins->op, "unary_op") == 0) {
-        PS_Value *v = get_value(&temps, &vars, ins->src);
-        PS_Value *res = NULL;
-        if (strcmp(ins->operator, "!") == 0) {
-          res = ps_make_bool(ctx, !is_truthy(v));
-        } else if (strcmp(ins->operator, "-") == 0) {
-          if (v->tag == PS_V_INT) res = ps_make_int(ctx, -v->as.int_v);
-          else if (v->tag == PS_V_BYTE) res = ps_make_int(ctx, -(int64_t)v->as.byte_v);
-          else if (v->tag == PS_V_FLOAT) res = ps_make_float(ctx, -v->as.float_v);
-        } else if (strcmp(ins->operator, "~") == 0) {
-          if (v->tag == PS_V_INT) res = ps_make_int(ctx, ~v->as.int_v);
-          else if (v->tag == PS_V_BYTE) res = ps_make_int(ctx, ~(int64_t)v->as.byte_v);
-          else if (v->tag == PS_V_GLYPH) {
-            ps_throw_diag(ctx, PS_ERR_TYPE, "invalid glyph operation", "value", "compatible type");
-            goto raise;
-          }
-        }
-        if (!res) goto raise;
-        bindings_set(&temps, ins->dst, res);
-        ps_value_release(res);
-        continue;
-      }
-      if (strcmp(ins->op, "select") == 0) {
-        PS_Value *c = get_value(&temps, &vars, ins->cond);
-        PS_Value *tv = get_value(&temps, &vars, ins->thenValue);
-        PS_Value *ev = get_value(&temps, &vars, ins->elseValue);
-        bindings_set(&temps, ins->dst, is_truthy(c) ? tv : ev);
-        continue;
-      }
-      if (strcmp(ins->op, "make_list") == 0) {
-        PS_Value *list = ps_list_new(ctx);
-        if (ins->type) ps_list_set_type_name_internal(ctx, list, ins->type);
-        for (size_t i = 0; i < ins->arg_count; i++) {
-          PS_Value *it = get_value(&temps, &vars, ins->args[i]);
-          ps_list_push_internal(ctx, list, it);
-        }
-        bindings_set(&temps, ins->dst, list);
-        ps_value_release(list);
-        continue;
-      }
-      if (strcmp(ins->op, "make_map") == 0) {
-        PS_Value *map = ps_map_new(ctx);
-        if (ins->type) ps_map_set_type_name_internal(ctx, map, ins->type);
-        for (size_t i = 0; i < ins->pair_count; i++) {
-          PS_Value *k = get_value(&temps, &vars, ins->pairs[i].key);
-          PS_Value *v = get_value(&temps, &vars, ins->pairs[i].value);
-          ps_map_set(ctx, map, k, v);
-        }
-        bindings_set(&temps, ins->dst, map);
-        ps_value_release(map);
-        continue;
-      }
-      if (strcmp(ins->op, "make_view") == 0) {
-        PS_Value *src = get_value(&temps, &vars, ins->source);
-        PS_Value *o = get_value(&temps, &vars, ins->offset);
-        PS_Value *l = get_value(&temps, &vars, ins->len);
-        if (!src || !o || !l) goto raise;
-        int64_t off = o->as.int_v;
-        int64_t ln = l->as.int_v;
-        if (off < 0 || ln < 0) {
-          ps_throw_diag(ctx, PS_ERR_RANGE, "index out of bounds", "offset/length", "within source");
-          goto raise;
+          continue;
         }
-        PS_Value *base = src;
-        PS_Value **borrowed = NULL;
-        size_t base_off = 0;
-        int readonly = ins->readonly;
-        if (src->tag == PS_V_VIEW) {
-          base = src->as.view_v.source;
-          borrowed = src->as.view_v.borrowed_items;
-          base_off = src->as.view_v.offset;
-          if (src->as.view_v.readonly) readonly = 1;
-        }
-        PS_Value *v = ps_value_alloc(PS_V_VIEW);
-        if (!v) goto raise;
-        v->as.view_v.source = base ? ps_value_retain(base) : NULL;
-        v->as.view_v.borrowed_items = borrowed;
-        v->as.view_v.offset = base_off + (size_t)off;
-        v->as.view_v.len = (size_t)ln;
-        v->as.view_v.readonly = readonly;
-        v->as.view_v.type_name = NULL;
-        if (ins->kind) {
-          const char *kind = ins->kind;
-          char *inner = NULL;
-          if (base && base->tag == PS_V_LIST) {
-            const char *list_t = ps_list_type_name_internal(base);
-            inner = extract_generic_inner(list_t);
-          } else if (src->tag == PS_V_VIEW) {
-            inner = extract_generic_inner(src->as.view_v.type_name);
-          } else if (base && base->tag == PS_V_STRING) {
-            inner = strdup("glyph");
-          } else if (borrowed) {
-            inner = strdup("unknown");
-          }
-          if (!inner) inner = strdup("unknown");
-          v->as.view_v.type_name = make_view_type_name(kind, inner);
-          free(inner);
-        }
-        if (base && base->tag == PS_V_LIST) v->as.view_v.version = base->as.list_v.version;
-        else v->as.view_v.version = 0;
-        bindings_set(&temps, ins->dst, v);
-        ps_value_release(v);
-        continue;
-      }
-      if (strcmp(ins->op, "index_get") == 0) {
-        PS_Value *t = get_value(&temps, &vars, ins->target);
-        PS_Value *i = get_value(&temps, &vars, ins->index);
-        if (!t || !i) goto raise;
-        PS_Value *res = NULL;
-        if (t->tag == PS_V_LIST) res = ps_list_get_internal(ctx, t, (size_t)i->as.int_v);
-        else if (t->tag == PS_V_STRING) {
-          uint32_t g = ps_utf8_glyph_at((const uint8_t *)t->as.string_v.ptr, t->as.string_v.len, (size_t)i->as.int_v);
-          res = ps_make_glyph(ctx, g);
-        } else if (t->tag == PS_V_MAP) res = ps_map_get(ctx, t, i);
-        else if (t->tag == PS_V_VIEW) {
-          if (!view_is_valid(t)) {
-            ps_throw_diag(ctx, PS_ERR_RANGE, "view invalidated", "invalidated view", "valid view");
+        case IR_OP_CHECK_INDEX_BOUNDS: {
+          PS_Value *t = get_value(&temps, &vars, ins->target);
+          PS_Value *i = get_value(&temps, &vars, ins->index);
+          if (!t || !i) goto raise;
+          size_t idx = (size_t)i->as.int_v;
+          size_t len = 0;
+          if (t->tag == PS_V_LIST) len = t->as.list_v.len;
+          else if (t->tag == PS_V_STRING) len = ps_utf8_glyph_len((const uint8_t *)t->as.string_v.ptr, t->as.string_v.len);
+          else if (t->tag == PS_V_VIEW) len = t->as.view_v.len;
+          if (idx >= len) {
+            char got[64];
+            snprintf(got, sizeof(got), "%zu", idx);
+            ps_throw_diag(ctx, PS_ERR_RANGE, "index out of bounds", got, "index within bounds");
             goto raise;
           }
-          size_t idx = t->as.view_v.offset + (size_t)i->as.int_v;
-          PS_Value *src = t->as.view_v.source;
-          if (src && src->tag == PS_V_LIST) res = ps_list_get_internal(ctx, src, idx);
-          else if (src && src->tag == PS_V_STRING) {
-            uint32_t g = ps_utf8_glyph_at((const uint8_t *)src->as.string_v.ptr, src->as.string_v.len, idx);
-            res = ps_make_glyph(ctx, g);
-          } else if (!src && t->as.view_v.borrowed_items) {
-            res = t->as.view_v.borrowed_items[idx];
-          }
+          continue;
         }
-        if (!res) goto raise;
-        bindings_set(&temps, ins->dst, res);
-        continue;
-      }
-      if (strcmp(ins->op, "index_set") == 0) {
-        PS_Value *t = get_value(&temps, &vars, ins->target);
-        PS_Value *i = get_value(&temps, &vars, ins->index);
-        PS_Value *v = get_value(&temps, &vars, ins->src);
-        if (t->tag == PS_V_LIST) {
-          if (!ps_list_set_internal(ctx, t, (size_t)i->as.int_v, v)) goto raise;
-        } else if (t->tag == PS_V_MAP) {
-          if (!ps_map_set(ctx, t, i, v)) goto raise;
-        } else if (t->tag == PS_V_VIEW) {
-          if (!view_is_valid(t)) {
-            ps_throw_diag(ctx, PS_ERR_RANGE, "view invalidated", "invalidated view", "valid view");
+        case IR_OP_CHECK_VIEW_BOUNDS: {
+          PS_Value *t = get_value(&temps, &vars, ins->target);
+          PS_Value *o = get_value(&temps, &vars, ins->offset);
+          PS_Value *l = get_value(&temps, &vars, ins->len);
+          if (!t || !o || !l) goto raise;
+          int64_t off = o->as.int_v;
+          int64_t ln = l->as.int_v;
+          if (off < 0 || ln < 0) {
+            ps_throw_diag(ctx, PS_ERR_RANGE, "index out of bounds", "offset/length", "within source");
             goto raise;
           }
-          if (t->as.view_v.readonly) {
-            ps_throw_diag(ctx, PS_ERR_TYPE, "cannot assign through view", "view value", "mutable list");
+          size_t total = 0;
+          if (t->tag == PS_V_LIST) total = t->as.list_v.len;
+          else if (t->tag == PS_V_STRING) total = ps_utf8_glyph_len((const uint8_t *)t->as.string_v.ptr, t->as.string_v.len);
+          else if (t->tag == PS_V_VIEW) total = t->as.view_v.len;
+          if ((uint64_t)off + (uint64_t)ln > total) {
+            ps_throw_diag(ctx, PS_ERR_RANGE, "index out of bounds", "offset/length", "within source");
             goto raise;
           }
-          size_t idx = t->as.view_v.offset + (size_t)i->as.int_v;
-          PS_Value *src = t->as.view_v.source;
-          if (src && src->tag == PS_V_LIST) {
-            if (!ps_list_set_internal(ctx, src, idx, v)) goto raise;
-          } else {
-            {
-              char got[64];
-              format_value_short(src, got, sizeof(got));
-              ps_throw_diag(ctx, PS_ERR_TYPE, "invalid view target", got, "list");
-            }
+          continue;
+        }
+        case IR_OP_CHECK_MAP_HAS_KEY: {
+          PS_Value *mval = get_value(&temps, &vars, ins->map);
+          PS_Value *k = get_value(&temps, &vars, ins->key);
+          if (!ps_map_has_key(ctx, mval, k)) {
+            char got[128];
+            format_value_short(k, got, sizeof(got));
+            ps_throw_diag(ctx, PS_ERR_RANGE, "missing key", got, "present key");
             goto raise;
           }
+          continue;
         }
-        continue;
-      }
-      if (strcmp(ins->op, "iter_begin") == 0) {
-        PS_Value *src = get_value(&temps, &vars, ins->source);
-        PS_Value *it = ps_value_alloc(PS_V_ITER);
-        if (!it) goto raise;
-        it->as.iter_v.source = ps_value_retain(src);
-        it->as.iter_v.index = 0;
-        it->as.iter_v.mode = (ins->mode && strcmp(ins->mode, "in") == 0) ? 1 : 0;
-        bindings_set(&temps, ins->dst, it);
-        ps_value_release(it);
-        continue;
-      }
-      if (strcmp(ins->op, "branch_iter_has_next") == 0) {
-        PS_Value *it = get_value(&temps, &vars, ins->iter);
-        size_t has = 0;
-        if (it && it->tag == PS_V_ITER) {
-          PS_Value *src = it->as.iter_v.source;
-          if (src->tag == PS_V_LIST) has = it->as.iter_v.index < src->as.list_v.len;
-          else if (src->tag == PS_V_MAP) has = it->as.iter_v.index < src->as.map_v.len;
-          else if (src->tag == PS_V_STRING) {
-            size_t gl = ps_utf8_glyph_len((const uint8_t *)src->as.string_v.ptr, src->as.string_v.len);
-            has = it->as.iter_v.index < gl;
-          } else if (src->tag == PS_V_VIEW) {
-            if (!view_is_valid(src)) {
-              ps_throw_diag(ctx, PS_ERR_RANGE, "view invalidated", "invalidated view", "valid view");
+        case IR_OP_BIN_OP:
+        bin_op_generic: {
+          PS_Value *l = get_value(&temps, &vars, ins->left);
+          PS_Value *r = get_value(&temps, &vars, ins->right);
+          if (!l || !r) goto raise;
+          int is_numeric = (l->tag == PS_V_INT || l->tag == PS_V_BYTE || l->tag == PS_V_FLOAT) &&
+                           (r->tag == PS_V_INT || r->tag == PS_V_BYTE || r->tag == PS_V_FLOAT);
+          int is_float = (l->tag == PS_V_FLOAT || r->tag == PS_V_FLOAT);
+          int64_t li = (l->tag == PS_V_BYTE) ? (int64_t)l->as.byte_v : l->as.int_v;
+          int64_t ri = (r->tag == PS_V_BYTE) ? (int64_t)r->as.byte_v : r->as.int_v;
+          double lf = (l->tag == PS_V_FLOAT) ? l->as.float_v : (double)li;
+          double rf = (r->tag == PS_V_FLOAT) ? r->as.float_v : (double)ri;
+          PS_Value *res = NULL;
+          if (ins->binop == IR_BIN_ADD) {
+            if (!is_numeric) {
+              if (l->tag == PS_V_GLYPH || r->tag == PS_V_GLYPH) {
+                ps_throw_diag(ctx, PS_ERR_TYPE, "invalid glyph operation", "value", "compatible type");
+              } else {
+                char got[96];
+                snprintf(got, sizeof(got), "%s + %s", value_type_name(l), value_type_name(r));
+                ps_throw_diag(ctx, PS_ERR_TYPE, "invalid operand types", got, "numeric operands");
+              }
               goto raise;
             }
-            has = it->as.iter_v.index < src->as.view_v.len;
-          }
-        }
-        block_idx = find_block(f, has ? ins->then_label : ins->else_label);
-        goto next_block;
-      }
-      if (strcmp(ins->op, "iter_next") == 0) {
-        PS_Value *it = get_value(&temps, &vars, ins->iter);
-        PS_Value *res = NULL;
-        if (it && it->tag == PS_V_ITER) {
-          PS_Value *src = it->as.iter_v.source;
-          size_t idx = it->as.iter_v.index++;
-          if (src->tag == PS_V_LIST) res = src->as.list_v.items[idx];
-          else if (src->tag == PS_V_STRING) {
-            uint32_t g = ps_utf8_glyph_at((const uint8_t *)src->as.string_v.ptr, src->as.string_v.len, idx);
-            res = ps_make_glyph(ctx, g);
-          } else if (src->tag == PS_V_MAP) {
-            PS_Map *m = &src->as.map_v;
-            if (idx < m->order_len) {
-              PS_Value *k = m->order[idx];
-              if (it->as.iter_v.mode) res = k;
-              else res = ps_map_get(ctx, src, k);
-            }
-          } else if (src->tag == PS_V_VIEW) {
-            if (!view_is_valid(src)) {
-              ps_throw_diag(ctx, PS_ERR_RANGE, "view invalidated", "invalidated view", "valid view");
+            res = is_float ? ps_make_float(ctx, lf + rf) : ps_make_int(ctx, li + ri);
+          } else if (ins->binop == IR_BIN_SUB) {
+            if (!is_numeric) {
+              if (l->tag == PS_V_GLYPH || r->tag == PS_V_GLYPH) {
+                ps_throw_diag(ctx, PS_ERR_TYPE, "invalid glyph operation", "value", "compatible type");
+              } else {
+                char got[96];
+                snprintf(got, sizeof(got), "%s - %s", value_type_name(l), value_type_name(r));
+                ps_throw_diag(ctx, PS_ERR_TYPE, "invalid operand types", got, "numeric operands");
+              }
               goto raise;
             }
-            size_t vidx = src->as.view_v.offset + idx;
-            PS_Value *base = src->as.view_v.source;
-            if (base && base->tag == PS_V_LIST) res = base->as.list_v.items[vidx];
-            else if (base && base->tag == PS_V_STRING) {
-              uint32_t g = ps_utf8_glyph_at((const uint8_t *)base->as.string_v.ptr, base->as.string_v.len, vidx);
-              res = ps_make_glyph(ctx, g);
-            } else if (!base && src->as.view_v.borrowed_items) {
-              res = src->as.view_v.borrowed_items[vidx];
+            res = is_float ? ps_make_float(ctx, lf - rf) : ps_make_int(ctx, li - ri);
+          } else if (ins->binop == IR_BIN_MUL) {
+            if (!is_numeric) {
+              if (l->tag == PS_V_GLYPH || r->tag == PS_V_GLYPH) {
+                ps_throw_diag(ctx, PS_ERR_TYPE, "invalid glyph operation", "value", "compatible type");
+              } else {
+                char got[96];
+                snprintf(got, sizeof(got), "%s * %s", value_type_name(l), value_type_name(r));
+                ps_throw_diag(ctx, PS_ERR_TYPE, "invalid operand types", got, "numeric operands");
+              }
+              goto raise;
+            }
+            res = is_float ? ps_make_float(ctx, lf * rf) : ps_make_int(ctx, li * ri);
+          } else if (ins->binop == IR_BIN_DIV) {
+            if (!is_numeric) {
+              if (l->tag == PS_V_GLYPH || r->tag == PS_V_GLYPH) {
+                ps_throw_diag(ctx, PS_ERR_TYPE, "invalid glyph operation", "value", "compatible type");
+              } else {
+                char got[96];
+                snprintf(got, sizeof(got), "%s / %s", value_type_name(l), value_type_name(r));
+                ps_throw_diag(ctx, PS_ERR_TYPE, "invalid operand types", got, "numeric operands");
+              }
+              goto raise;
+            }
+            res = is_float ? ps_make_float(ctx, lf / rf) : ps_make_int(ctx, li / ri);
+          } else if (ins->binop == IR_BIN_MOD) {
+            if (!is_numeric || is_float) {
+              char got[96];
+              snprintf(got, sizeof(got), "%s %% %s", value_type_name(l), value_type_name(r));
+              ps_throw_diag(ctx, PS_ERR_TYPE, "invalid operand types", got, "int operands");
+              goto raise;
+            }
+            res = ps_make_int(ctx, li % ri);
+          } else if (ins->binop == IR_BIN_SHL) {
+            if (!is_numeric || is_float) {
+              char got[96];
+              snprintf(got, sizeof(got), "%s << %s", value_type_name(l), value_type_name(r));
+              ps_throw_diag(ctx, PS_ERR_TYPE, "invalid operand types", got, "int operands");
+              goto raise;
+            }
+            res = ps_make_int(ctx, li << ri);
+          } else if (ins->binop == IR_BIN_SHR) {
+            if (!is_numeric || is_float) {
+              char got[96];
+              snprintf(got, sizeof(got), "%s >> %s", value_type_name(l), value_type_name(r));
+              ps_throw_diag(ctx, PS_ERR_TYPE, "invalid operand types", got, "int operands");
+              goto raise;
+            }
+            res = ps_make_int(ctx, li >> ri);
+          } else if (ins->binop == IR_BIN_AND) {
+            if (!is_numeric || is_float) {
+              char got[96];
+              snprintf(got, sizeof(got), "%s & %s", value_type_name(l), value_type_name(r));
+              ps_throw_diag(ctx, PS_ERR_TYPE, "invalid operand types", got, "int operands");
+              goto raise;
+            }
+            res = ps_make_int(ctx, li & ri);
+          } else if (ins->binop == IR_BIN_OR) {
+            if (!is_numeric || is_float) {
+              char got[96];
+              snprintf(got, sizeof(got), "%s | %s", value_type_name(l), value_type_name(r));
+              ps_throw_diag(ctx, PS_ERR_TYPE, "invalid operand types", got, "int operands");
+              goto raise;
+            }
+            res = ps_make_int(ctx, li | ri);
+          } else if (ins->binop == IR_BIN_XOR) {
+            if (!is_numeric || is_float) {
+              char got[96];
+              snprintf(got, sizeof(got), "%s ^ %s", value_type_name(l), value_type_name(r));
+              ps_throw_diag(ctx, PS_ERR_TYPE, "invalid operand types", got, "int operands");
+              goto raise;
             }
+            res = ps_make_int(ctx, li ^ ri);
           }
+          else if (ins->binop == IR_BIN_EQ) res = ps_make_bool(ctx, is_float ? (lf == rf) : values_equal(l, r));
+          else if (ins->binop == IR_BIN_NE) res = ps_make_bool(ctx, is_float ? (lf != rf) : !values_equal(l, r));
+          else if (ins->binop == IR_BIN_LT) res = ps_make_bool(ctx, is_float ? (lf < rf) : (li < ri));
+          else if (ins->binop == IR_BIN_LE) res = ps_make_bool(ctx, is_float ? (lf <= rf) : (li <= ri));
+          else if (ins->binop == IR_BIN_GT) res = ps_make_bool(ctx, is_float ? (lf > rf) : (li > ri));
+          else if (ins->binop == IR_BIN_GE) res = ps_make_bool(ctx, is_float ? (lf >= rf) : (li >= ri));
+          else if (ins->binop == IR_BIN_LOGICAL_AND) res = ps_make_bool(ctx, is_truthy(l) && is_truthy(r));
+          else if (ins->binop == IR_BIN_LOGICAL_OR) res = ps_make_bool(ctx, is_truthy(l) || is_truthy(r));
+          if (!res) goto raise;
+          bindings_set(&temps, ins->dst, res);
+          ps_value_release(res);
+          continue;
         }
-        if (!res) goto raise;
-        bindings_set(&temps, ins->dst, res);
-        continue;
-      }
-      if (strcmp(ins->op, "call_static") == 0) {
-        PS_Value *ret = NULL;
-        PS_Value **argv = NULL;
-        if (ins->arg_count > 0) {
-          argv = (PS_Value **)calloc(ins->arg_count, sizeof(PS_Value *));
-          for (size_t i = 0; i < ins->arg_count; i++) argv[i] = get_value(&temps, &vars, ins->args[i]);
-        }
-        if (exec_call_static(ctx, m, ins->callee, argv, ins->arg_count, &ret) != 0) {
-          if (ctx->last_exception) {
-            if (last_exception) ps_value_release(last_exception);
-            last_exception = ps_value_retain(ctx->last_exception);
-            ps_value_release(ctx->last_exception);
-            ctx->last_exception = NULL;
+        case IR_OP_UNARY_OP: {
+          PS_Value *v = get_value(&temps, &vars, ins->src);
+          PS_Value *res = NULL;
+          if (strcmp(ins->operator, "!") == 0) {
+            res = ps_make_bool(ctx, !is_truthy(v));
+          } else if (strcmp(ins->operator, "-") == 0) {
+            if (v->tag == PS_V_INT) res = ps_make_int(ctx, -v->as.int_v);
+            else if (v->tag == PS_V_BYTE) res = ps_make_int(ctx, -(int64_t)v->as.byte_v);
+            else if (v->tag == PS_V_FLOAT) res = ps_make_float(ctx, -v->as.float_v);
+          } else if (strcmp(ins->operator, "~") == 0) {
+            if (v->tag == PS_V_INT) res = ps_make_int(ctx, ~v->as.int_v);
+            else if (v->tag == PS_V_BYTE) res = ps_make_int(ctx, ~(int64_t)v->as.byte_v);
+            else if (v->tag == PS_V_GLYPH) {
+              ps_throw_diag(ctx, PS_ERR_TYPE, "invalid glyph operation", "value", "compatible type");
+              goto raise;
+            }
           }
-          free(argv);
-          goto raise;
+          if (!res) goto raise;
+          bindings_set(&temps, ins->dst, res);
+          ps_value_release(res);
+          continue;
         }
-        free(argv);
-        if (ins->dst) {
-          bindings_set(&temps, ins->dst, ret);
-          if (ret) ps_value_release(ret);
+        case IR_OP_SELECT: {
+          PS_Value *c = get_value(&temps, &vars, ins->cond);
+          PS_Value *tv = get_value(&temps, &vars, ins->thenValue);
+          PS_Value *ev = get_value(&temps, &vars, ins->elseValue);
+          bindings_set(&temps, ins->dst, is_truthy(c) ? tv : ev);
+          continue;
         }
-        continue;
-      }
-      if (strcmp(ins->op, "call_method_static") == 0) {
-        PS_Value *recv = get_value(&temps, &vars, ins->receiver);
-        if (!recv) goto raise;
-        const char *json_kind = NULL;
-        PS_Value *json_val = NULL;
-        if (json_value_kind_runtime(ctx, recv, &json_kind, &json_val)) {
-          if (strcmp(ins->method, "isNull") == 0) {
-            if (!expect_arity(ctx, ins, 0, 0)) goto raise;
-            PS_Value *b = ps_make_bool(ctx, json_kind && strcmp(json_kind, "null") == 0);
-            if (!b) goto raise;
-            bindings_set(&temps, ins->dst, b);
-            ps_value_release(b);
-            continue;
-          }
-          if (strcmp(ins->method, "isBool") == 0) {
-            if (!expect_arity(ctx, ins, 0, 0)) goto raise;
-            PS_Value *b = ps_make_bool(ctx, json_kind && strcmp(json_kind, "bool") == 0);
-            if (!b) goto raise;
-            bindings_set(&temps, ins->dst, b);
-            ps_value_release(b);
-            continue;
+        case IR_OP_MAKE_LIST: {
+          PS_Value *list = ps_list_new(ctx);
+          list->as.list_v.type_name = ins->type;
+          for (size_t i = 0; i < ins->arg_count; i++) {
+            PS_Value *it = get_value(&temps, &vars, ins->args[i]);
+            ps_list_push_internal(ctx, list, it);
           }
-          if (strcmp(ins->method, "isNumber") == 0) {
-            if (!expect_arity(ctx, ins, 0, 0)) goto raise;
-            PS_Value *b = ps_make_bool(ctx, json_kind && strcmp(json_kind, "number") == 0);
-            if (!b) goto raise;
-            bindings_set(&temps, ins->dst, b);
-            ps_value_release(b);
-            continue;
+          bindings_set(&temps, ins->dst, list);
+          ps_value_release(list);
+          continue;
+        }
+        case IR_OP_MAKE_MAP: {
+          PS_Value *map = ps_map_new(ctx);
+          map->as.map_v.type_name = ins->type;
+          for (size_t i = 0; i < ins->pair_count; i++) {
+            PS_Value *k = get_value(&temps, &vars, ins->pairs[i].key);
+            PS_Value *v = get_value(&temps, &vars, ins->pairs[i].value);
+            ps_map_set(ctx, map, k, v);
           }
-          if (strcmp(ins->method, "isString") == 0) {
-            if (!expect_arity(ctx, ins, 0, 0)) goto raise;
-            PS_Value *b = ps_make_bool(ctx, json_kind && strcmp(json_kind, "string") == 0);
-            if (!b) goto raise;
-            bindings_set(&temps, ins->dst, b);
-            ps_value_release(b);
-            continue;
+          bindings_set(&temps, ins->dst, map);
+          ps_value_release(map);
+          continue;
+        }
+        case IR_OP_MAKE_VIEW: {
+          PS_Value *src = get_value(&temps, &vars, ins->source);
+          PS_Value *o = get_value(&temps, &vars, ins->offset);
+          PS_Value *l = get_value(&temps, &vars, ins->len);
+          if (!src || !o || !l) goto raise;
+          int64_t off = o->as.int_v;
+          int64_t ln = l->as.int_v;
+          if (off < 0 || ln < 0) {
+            ps_throw_diag(ctx, PS_ERR_RANGE, "index out of bounds", "offset/length", "within source");
+            goto raise;
           }
-          if (strcmp(ins->method, "isArray") == 0) {
-            if (!expect_arity(ctx, ins, 0, 0)) goto raise;
-            PS_Value *b = ps_make_bool(ctx, json_kind && strcmp(json_kind, "array") == 0);
-            if (!b) goto raise;
-            bindings_set(&temps, ins->dst, b);
-            ps_value_release(b);
-            continue;
+          PS_Value *base = src;
+          PS_Value **borrowed = NULL;
+          size_t base_off = 0;
+          int readonly = ins->readonly;
+          if (src->tag == PS_V_VIEW) {
+            base = src->as.view_v.source;
+            borrowed = src->as.view_v.borrowed_items;
+            base_off = src->as.view_v.offset;
+            if (src->as.view_v.readonly) readonly = 1;
           }
-          if (strcmp(ins->method, "isObject") == 0) {
-            if (!expect_arity(ctx, ins, 0, 0)) goto raise;
-            PS_Value *b = ps_make_bool(ctx, json_kind && strcmp(json_kind, "object") == 0);
-            if (!b) goto raise;
-            bindings_set(&temps, ins->dst, b);
-            ps_value_release(b);
-            continue;
+          PS_Value *v = ps_value_alloc(ctx, PS_V_VIEW);
+          if (!v) goto raise;
+          v->as.view_v.source = base ? ps_value_retain(base) : NULL;
+          v->as.view_v.borrowed_items = borrowed;
+          v->as.view_v.offset = base_off + (size_t)off;
+          v->as.view_v.len = (size_t)ln;
+          v->as.view_v.readonly = readonly;
+          v->as.view_v.type_name = NULL;
+          if (ins->kind) {
+            const char *inner = NULL;
+            size_t inner_len = 0;
+            if (base && base->tag == PS_V_LIST) {
+              generic_inner_range(base->as.list_v.type_name, &inner, &inner_len);
+            } else if (src->tag == PS_V_VIEW) {
+              generic_inner_range(src->as.view_v.type_name, &inner, &inner_len);
+            } else if (base && base->tag == PS_V_STRING) {
+              inner = "glyph";
+              inner_len = 5;
+            }
+            if (!inner) {
+              inner = "unknown";
+              inner_len = 7;
+            }
+            v->as.view_v.type_name = intern_view_type_name(ins->kind, inner, inner_len);
           }
-          if (strcmp(ins->method, "asBool") == 0) {
-            if (!expect_arity(ctx, ins, 0, 0)) goto raise;
-            if (!json_kind || strcmp(json_kind, "bool") != 0 || !json_val || json_val->tag != PS_V_BOOL) {
-              const char *got = json_kind ? json_kind : value_type_name(json_val);
-              ps_throw_diag(ctx, PS_ERR_TYPE, "invalid JsonBool access", got, "JsonBool");
+          if (base && base->tag == PS_V_LIST) v->as.view_v.version = base->as.list_v.version;
+          else v->as.view_v.version = 0;
+          bindings_set(&temps, ins->dst, v);
+          ps_value_release(v);
+          continue;
+        }
+        case IR_OP_INDEX_GET:
+        index_get_generic: {
+          PS_Value *t = get_value(&temps, &vars, ins->target);
+          PS_Value *i = get_value(&temps, &vars, ins->index);
+          if (!t || !i) goto raise;
+          PS_Value *res = NULL;
+          if (t->tag == PS_V_LIST) res = ps_list_get_internal(ctx, t, (size_t)i->as.int_v);
+          else if (t->tag == PS_V_STRING) {
+            uint32_t g = ps_utf8_glyph_at((const uint8_t *)t->as.string_v.ptr, t->as.string_v.len, (size_t)i->as.int_v);
+            res = ps_make_glyph(ctx, g);
+          } else if (t->tag == PS_V_MAP) res = ps_map_get(ctx, t, i);
+          else if (t->tag == PS_V_VIEW) {
+            if (!view_is_valid(t)) {
+              ps_throw_diag(ctx, PS_ERR_RANGE, "view invalidated", "invalidated view", "valid view");
               goto raise;
             }
-            bindings_set(&temps, ins->dst, json_val);
-            continue;
+            size_t idx = t->as.view_v.offset + (size_t)i->as.int_v;
+            PS_Value *src = t->as.view_v.source;
+            if (src && src->tag == PS_V_LIST) res = ps_list_get_internal(ctx, src, idx);
+            else if (src && src->tag == PS_V_STRING) {
+              uint32_t g = ps_utf8_glyph_at((const uint8_t *)src->as.string_v.ptr, src->as.string_v.len, idx);
+              res = ps_make_glyph(ctx, g);
+            } else if (!src && t->as.view_v.borrowed_items) {
+              res = t->as.view_v.borrowed_items[idx];
+            }
           }
-          if (strcmp(ins->method, "asNumber") == 0) {
-            if (!expect_arity(ctx, ins, 0, 0)) goto raise;
-            if (!json_kind || strcmp(json_kind, "number") != 0 || !json_val || json_val->tag != PS_V_FLOAT) {
-              const char *got = json_kind ? json_kind : value_type_name(json_val);
-              ps_throw_diag(ctx, PS_ERR_TYPE, "invalid JsonNumber access", got, "JsonNumber");
+          if (!res) goto raise;
+          bindings_set(&temps, ins->dst, res);
+          continue;
+        }
+        case IR_OP_INDEX_SET: {
+          PS_Value *t = get_value(&temps, &vars, ins->target);
+          PS_Value *i = get_value(&temps, &vars, ins->index);
+          PS_Value *v = get_value(&temps, &vars, ins->src);
+          if (t->tag == PS_V_LIST) {
+            if (!ps_list_set_internal(ctx, t, (size_t)i->as.int_v, v)) goto raise;
+          } else if (t->tag == PS_V_MAP) {
+            if (!ps_map_set(ctx, t, i, v)) goto raise;
+          } else if (t->tag == PS_V_VIEW) {
+            if (!view_is_valid(t)) {
+              ps_throw_diag(ctx, PS_ERR_RANGE, "view invalidated", "invalidated view", "valid view");
               goto raise;
             }
-            bindings_set(&temps, ins->dst, json_val);
-            continue;
-          }
-          if (strcmp(ins->method, "asString") == 0) {
-            if (!expect_arity(ctx, ins, 0, 0)) goto raise;
-            if (!json_kind || strcmp(json_kind, "string") != 0 || !json_val || json_val->tag != PS_V_STRING) {
-              const char *got = json_kind ? json_kind : value_type_name(json_val);
-              ps_throw_diag(ctx, PS_ERR_TYPE, "invalid JsonString access", got, "JsonString");
+            if (t->as.view_v.readonly) {
+              ps_throw_diag(ctx, PS_ERR_TYPE, "cannot assign through view", "view value", "mutable list");
               goto raise;
             }
-            bindings_set(&temps, ins->dst, json_val);
-            continue;
-          }
-          if (strcmp(ins->method, "asArray") == 0) {
-            if (!expect_arity(ctx, ins, 0, 0)) goto raise;
-            if (!json_kind || strcmp(json_kind, "array") != 0 || !json_val || json_val->tag != PS_V_LIST) {
-              const char *got = json_kind ? json_kind : value_type_name(json_val);
-              ps_throw_diag(ctx, PS_ERR_TYPE, "invalid JsonArray access", got, "JsonArray");
+            size_t idx = t->as.view_v.offset + (size_t)i->as.int_v;
+            PS_Value *src = t->as.view_v.source;
+            if (src && src->tag == PS_V_LIST) {
+              if (!ps_list_set_internal(ctx, src, idx, v)) goto raise;
+            } else {
+              {
+                char got[64];
+                format_value_short(src, got, sizeof(got));
+                ps_throw_diag(ctx, PS_ERR_TYPE, "invalid view target", got, "list");
+              }
               goto raise;
             }
-            bindings_set(&temps, ins->dst, json_val);
-            continue;
           }
-          if (strcmp(ins->method, "asObject") == 0) {
-            if (!expect_arity(ctx, ins, 0, 0)) goto raise;
-            if (!json_kind || strcmp(json_kind, "object") != 0 || !json_val || json_val->tag != PS_V_MAP) {
-              const char *got = json_kind ? json_kind : value_type_name(json_val);
-              ps_throw_diag(ctx, PS_ERR_TYPE, "invalid JsonObject access", got, "JsonObject");
-              goto raise;
+          continue;
+        }
+        case IR_OP_ITER_BEGIN: {
+          PS_Value *src = get_value(&temps, &vars, ins->source);
+          PS_Value *it = ps_value_alloc(ctx, PS_V_ITER);
+          if (!it) goto raise;
+          it->as.iter_v.source = ps_value_retain(src);
+          it->as.iter_v.index = 0;
+          it->as.iter_v.mode = (ins->mode && strcmp(ins->mode, "in") == 0) ? 1 : 0;
+          bindings_set(&temps, ins->dst, it);
+          ps_value_release(it);
+          continue;
+        }
+        case IR_OP_BRANCH_ITER_HAS_NEXT:
+        branch_iter_has_next_generic: {
+          PS_Value *it = get_value(&temps, &vars, ins->iter);
+          size_t has = 0;
+          if (it && it->tag == PS_V_ITER) {
+            PS_Value *src = it->as.iter_v.source;
+            if (src->tag == PS_V_LIST) has = it->as.iter_v.index < src->as.list_v.len;
+            else if (src->tag == PS_V_MAP) has = it->as.iter_v.index < src->as.map_v.len;
+            else if (src->tag == PS_V_STRING) {
+              size_t gl = ps_utf8_glyph_len((const uint8_t *)src->as.string_v.ptr, src->as.string_v.len);
+              has = it->as.iter_v.index < gl;
+            } else if (src->tag == PS_V_VIEW) {
+              if (!view_is_valid(src)) {
+                ps_throw_diag(ctx, PS_ERR_RANGE, "view invalidated", "invalidated view", "valid view");
+                goto raise;
+              }
+              has = it->as.iter_v.index < src->as.view_v.len;
             }
-            bindings_set(&temps, ins->dst, json_val);
-            continue;
           }
+          block_idx = has ? ins->then_block : ins->else_block;
+          goto next_block;
         }
-        if (recv->tag == PS_V_FILE) {
-          PS_File *f = &recv->as.file_v;
-          const int can_read = (f->flags & PS_FILE_READ) != 0;
-          const int can_write = (f->flags & (PS_FILE_WRITE | PS_FILE_APPEND)) != 0;
-          const int is_binary = (f->flags & PS_FILE_BINARY) != 0;
-          if (strcmp(ins->method, "clone") == 0) {
-            if (!expect_arity(ctx, ins, 0, 0)) goto raise;
-            ps_throw(ctx, PS_ERR_TYPE, is_binary ? "clone not supported for builtin handle BinaryFile"
-                                                 : "clone not supported for builtin handle TextFile");
-            goto raise;
+        case IR_OP_ITER_NEXT:
+        iter_next_generic: {
+          PS_Value *it = get_value(&temps, &vars, ins->iter);
+          PS_Value *res = NULL;
+          if (it && it->tag == PS_V_ITER) {
+            PS_Value *src = it->as.iter_v.source;
+            size_t idx = it->as.iter_v.index++;
+            if (src->tag == PS_V_LIST) res = src->as.list_v.items[idx];
+            else if (src->tag == PS_V_STRING) {
+              uint32_t g = ps_utf8_glyph_at((const uint8_t *)src->as.string_v.ptr, src->as.string_v.len, idx);
+              res = ps_make_glyph(ctx, g);
+            } else if (src->tag == PS_V_MAP) {
+              PS_Map *m = &src->as.map_v;
+              if (idx < m->order_len) {
+                PS_Value *k = m->order[idx];
+                if (it->as.iter_v.mode) res = k;
+                else res = ps_map_get(ctx, src, k);
+              }
+            } else if (src->tag == PS_V_VIEW) {
+              if (!view_is_valid(src)) {
+                ps_throw_diag(ctx, PS_ERR_RANGE, "view invalidated", "invalidated view", "valid view");
+                goto raise;
+              }
+              size_t vidx = src->as.view_v.offset + idx;
+              PS_Value *base = src->as.view_v.source;
+              if (base && base->tag == PS_V_LIST) res = base->as.list_v.items[vidx];
+              else if (base && base->tag == PS_V_STRING) {
+                uint32_t g = ps_utf8_glyph_at((const uint8_t *)base->as.string_v.ptr, base->as.string_v.len, vidx);
+                res = ps_make_glyph(ctx, g);
+              } else if (!base && src->as.view_v.borrowed_items) {
+                res = src->as.view_v.borrowed_items[vidx];
+              }
+            }
           }
-          if (strcmp(ins->method, "close") == 0) {
-            if (!expect_arity(ctx, ins, 0, 0)) goto raise;
-            if (f->flags & PS_FILE_STD) {
-              ps_throw_io(ctx, "StandardStreamCloseException", "cannot close standard stream");
-              goto raise;
+          if (!res) goto raise;
+          bindings_set(&temps, ins->dst, res);
+          continue;
+        }
+        case IR_OP_CALL_STATIC: {
+          PS_Value *ret = NULL;
+          PS_Value **argv = NULL;
+          if (ins->arg_count > 0) {
+            argv = (PS_Value **)calloc(ins->arg_count, sizeof(PS_Value *));
+            for (size_t i = 0; i < ins->arg_count; i++) argv[i] = get_value(&temps, &vars, ins->args[i]);
+          }
+          if (ins->tail_fn && !ins->handler) {
+            // Tail call: the callee's result is ours, so run it in this frame
+            // instead of nesting exec_function. Outside any try region nothing
+            // of the current frame is observable once the call starts.
+            for (size_t i = 0; i < ins->arg_count; i++) {
+              if (argv[i]) ps_value_retain(argv[i]);
             }
-            if (!f->closed && f->fp) {
-              fclose(f->fp);
-              f->closed = 1;
-              if (!(f->flags & PS_FILE_STD) && f->path) {
-                free(f->path);
-                f->path = NULL;
-              }
+            bindings_reset(&temps);
+            bindings_reset(&vars);
+            if (last_exception) {
+              ps_value_release(last_exception);
+              last_exception = NULL;
             }
-            continue;
+            // A fresh frame has no location until its first located instruction.
+            cur_file = NULL;
+            cur_line = 0;
+            cur_col = 0;
+            pending_kills = NULL;
+            f = &m->fns[ins->tail_fn - 1];
+            if (prof) {
+              ps_profile_leave(prof);
+              ps_profile_enter(prof, f->name);
+            }
+            if (samp) {
+              ps_sampler_pop(samp);
+              sframe = ps_sampler_push(samp, f->name);
+            }
+            for (size_t i = 0; i < ins->arg_count; i++) {
+              if (i < f->param_count) bindings_set_owned(&vars, f->params[i], argv[i]);
+              else if (argv[i]) ps_value_release(argv[i]);
+            }
+            free(argv);
+            block_idx = 0;
+            goto next_block;
           }
-          if (f->closed || !f->fp) {
-            ps_throw_io(ctx, "FileClosedException", "file is closed");
+          if (exec_call_static(ctx, m, ins->callee, argv, ins->arg_count, &ret) != 0) {
+            if (ctx->last_exception) {
+              if (last_exception) ps_value_release(last_exception);
+              last_exception = ps_value_retain(ctx->last_exception);
+              ps_value_release(ctx->last_exception);
+              ctx->last_exception = NULL;
+            }
+            free(argv);
             goto raise;
           }
-          if (strcmp(ins->method, "name") == 0) {
-            if (!expect_arity(ctx, ins, 0, 0)) goto raise;
-            const char *p = f->path ? f->path : "";
-            PS_Value *s = ps_make_string_utf8(ctx, p, strlen(p));
-            if (!s) goto raise;
-            bindings_set(&temps, ins->dst, s);
-            ps_value_release(s);
-            continue;
+          free(argv);
+          if (ins->dst) {
+            bindings_set(&temps, ins->dst, ret);
+            if (ret) ps_value_release(ret);
           }
-          if (strcmp(ins->method, "tell") == 0) {
-            if (!expect_arity(ctx, ins, 0, 0)) goto raise;
-            if (is_binary) {
-              int64_t pos = file_tell_bytes(ctx, f);
-              if (pos < 0) {
-                ps_throw_io(ctx, "ReadFailureException", "tell failed");
-                goto raise;
+          continue;
+        }
+        case IR_OP_CALL_METHOD_STATIC:
+        call_method_generic: {
+          PS_Value *recv = get_value(&temps, &vars, ins->receiver);
+          if (!recv) goto raise;
+          if (recv->tag == PS_V_JSON) {
+            // JSONValue: is<Kind>() tests the node kind, as<Kind>() returns its payload.
+            static const char *const json_is[] = {"isNull", "isBool", "isNumber", "isString", "isArray", "isObject"};
+            static const char *const json_as[] = {NULL, "asBool", "asNumber", "asString", "asArray", "asObject"};
+            static const char *const json_sub[] = {NULL, "JsonBool", "JsonNumber", "JsonString", "JsonArray", "JsonObject"};
+            PS_JsonKind json_kind = recv->as.json_v.kind;
+            int matched = 0;
+            for (int k = PS_JSON_KIND_NULL; k <= PS_JSON_KIND_OBJECT && !matched; k++) {
+              if (strcmp(ins->method, json_is[k]) == 0) {
+                matched = 1;
+                if (!expect_arity(ctx, ins, 0, 0)) goto raise;
+                PS_Value *b = ps_make_bool(ctx, json_kind == (PS_JsonKind)k);
+                if (!b) goto raise;
+                bindings_set(&temps, ins->dst, b);
+                ps_value_release(b);
+              } else if (json_as[k] && strcmp(ins->method, json_as[k]) == 0) {
+                matched = 1;
+                if (!expect_arity(ctx, ins, 0, 0)) goto raise;
+                if (json_kind != (PS_JsonKind)k) {
+                  char short_msg[64];
+                  snprintf(short_msg, sizeof(short_msg), "invalid %s access", json_sub[k]);
+                  ps_throw_diag(ctx, PS_ERR_TYPE, short_msg, json_kind_name(json_kind), json_sub[k]);
+                  goto raise;
+                }
+                if (json_kind == PS_JSON_KIND_BOOL || json_kind == PS_JSON_KIND_NUMBER) {
+                  PS_Value *v = json_kind == PS_JSON_KIND_BOOL ? ps_make_bool(ctx, recv->as.json_v.as.bool_v)
+                                                               : ps_make_float(ctx, recv->as.json_v.as.number_v);
+                  if (!v) goto raise;
+                  bindings_set(&temps, ins->dst, v);
+                  ps_value_release(v);
+                } else {
+                  bindings_set(&temps, ins->dst, recv->as.json_v.as.ref);
+                }
               }
-              PS_Value *iv = ps_make_int(ctx, pos);
-              bindings_set(&temps, ins->dst, iv);
-              ps_value_release(iv);
-            } else {
-              int64_t pos = file_tell_glyphs(ctx, f);
-              if (pos < 0) goto raise;
-              PS_Value *iv = ps_make_int(ctx, pos);
-              bindings_set(&temps, ins->dst, iv);
-              ps_value_release(iv);
             }
-            continue;
-          }
-          if (strcmp(ins->method, "size") == 0) {
-            if (!expect_arity(ctx, ins, 0, 0)) goto raise;
-            if (is_binary) {
-              int64_t sz = file_size_bytes(ctx, f);
-              PS_Value *iv = ps_make_int(ctx, sz);
-              bindings_set(&temps, ins->dst, iv);
-              ps_value_release(iv);
-            } else {
-              int64_t sz = file_size_glyphs(ctx, f);
-              if (sz < 0) goto raise;
-              PS_Value *iv = ps_make_int(ctx, sz);
-              bindings_set(&temps, ins->dst, iv);
-              ps_value_release(iv);
+            if (matched) continue;
+            if (strcmp(ins->method, "clone") == 0) {
+              // Same as JSONValue.clone(): an instance without a JSON payload.
+              if (!expect_arity(ctx, ins, 0, 0)) goto raise;
+              PS_Value *ret = NULL;
+              if (exec_call_static(ctx, m, "JSONValue.__clone_static", NULL, 0, &ret) != 0) goto raise;
+              bindings_set(&temps, ins->dst, ret);
+              if (ret) ps_value_release(ret);
+              continue;
             }
-            continue;
+            char got[96];
+            snprintf(got, sizeof(got), "%s", ins->method ? ins->method : "<unknown>");
+            ps_throw_diag(ctx, PS_ERR_TYPE, "unknown method", got, "valid object/prototype method");
+            goto raise;
           }
-          if (strcmp(ins->method, "seek") == 0) {
-            if (!expect_arity(ctx, ins, 1, 1)) goto raise;
-            PS_Value *sv = get_value(&temps, &vars, ins->args[0]);
-            if (!sv || sv->tag != PS_V_INT) {
-              char got[64];
-              snprintf(got, sizeof(got), "%s", value_type_name(sv));
-              ps_throw_io(ctx, "InvalidArgumentException", "invalid seek position");
+          if (recv->tag == PS_V_FILE) {
+            PS_File *f = &recv->as.file_v;
+            const int can_read = (f->flags & PS_FILE_READ) != 0;
+            const int can_write = (f->flags & (PS_FILE_WRITE | PS_FILE_APPEND)) != 0;
+            const int is_binary = (f->flags & PS_FILE_BINARY) != 0;
+            if (strcmp(ins->method, "clone") == 0) {
+              if (!expect_arity(ctx, ins, 0, 0)) goto raise;
+              ps_throw(ctx, PS_ERR_TYPE, is_binary ? "clone not supported for builtin handle BinaryFile"
+                                                   : "clone not supported for builtin handle TextFile");
               goto raise;
             }
-            if (is_binary) {
-              int64_t pos = sv->as.int_v;
-              if (pos < 0 || pos > file_size_bytes(ctx, f)) {
-                char got[64];
-                snprintf(got, sizeof(got), "%lld", (long long)pos);
-                ps_throw_io(ctx, "InvalidArgumentException", "seek out of range");
+            if (strcmp(ins->method, "close") == 0) {
+              if (!expect_arity(ctx, ins, 0, 0)) goto raise;
+              if (f->flags & PS_FILE_STD) {
+                ps_throw_io(ctx, "StandardStreamCloseException", "cannot close standard stream");
                 goto raise;
               }
-              fseek(f->fp, (long)pos, SEEK_SET);
-            } else {
-              if (!file_seek_glyphs(ctx, f, sv->as.int_v)) goto raise;
+              if (!f->closed && f->fp) {
+                fclose(f->fp);
+                f->closed = 1;
+                if (!(f->flags & PS_FILE_STD) && f->path) {
+                  free(f->path);
+                  f->path = NULL;
+                }
+              }
+              continue;
             }
-            continue;
-          }
-          if (strcmp(ins->method, "read") == 0) {
-            if (!expect_arity(ctx, ins, 1, 1)) goto raise;
-            if (!can_read) {
-              ps_throw_io(ctx, "ReadFailureException", "file not readable");
+            if (f->closed || !f->fp) {
+              ps_throw_io(ctx, "FileClosedException", "file is closed");
               goto raise;
             }
-            PS_Value *sv = get_value(&temps, &vars, ins->args[0]);
-            if (!sv || sv->tag != PS_V_INT) {
-              char got[64];
-              snprintf(got, sizeof(got), "%s", value_type_name(sv));
-              ps_throw_io(ctx, "InvalidArgumentException", "invalid read size");
-              goto raise;
+            if (strcmp(ins->method, "name") == 0) {
+              if (!expect_arity(ctx, ins, 0, 0)) goto raise;
+              const char *p = f->path ? f->path : "";
+              PS_Value *s = ps_make_string_utf8(ctx, p, strlen(p));
+              if (!s) goto raise;
+              bindings_set(&temps, ins->dst, s);
+              ps_value_release(s);
+              continue;
             }
-            if (sv->as.int_v <= 0) {
-              char got[64];
-              snprintf(got, sizeof(got), "%lld", (long long)sv->as.int_v);
-              ps_throw_io(ctx, "InvalidArgumentException", "invalid read size");
-              goto raise;
+            if (strcmp(ins->method, "tell") == 0) {
+              if (!expect_arity(ctx, ins, 0, 0)) goto raise;
+              if (is_binary) {
+                int64_t pos = file_tell_bytes(ctx, f);
+                if (pos < 0) {
+                  ps_throw_io(ctx, "ReadFailureException", "tell failed");
+                  goto raise;
+                }
+                PS_Value *iv = ps_make_int(ctx, pos);
+                bindings_set(&temps, ins->dst, iv);
+                ps_value_release(iv);
+              } else {
+                int64_t pos = file_tell_glyphs(ctx, f);
+                if (pos < 0) goto raise;
+                PS_Value *iv = ps_make_int(ctx, pos);
+                bindings_set(&temps, ins->dst, iv);
+                ps_value_release(iv);
+              }
+              continue;
+            }
+            if (strcmp(ins->method, "size") == 0) {
+              if (!expect_arity(ctx, ins, 0, 0)) goto raise;
+              if (is_binary) {
+                int64_t sz = file_size_bytes(ctx, f);
+                PS_Value *iv = ps_make_int(ctx, sz);
+                bindings_set(&temps, ins->dst, iv);
+                ps_value_release(iv);
+              } else {
+                int64_t sz = file_size_glyphs(ctx, f);
+                if (sz < 0) goto raise;
+                PS_Value *iv = ps_make_int(ctx, sz);
+                bindings_set(&temps, ins->dst, iv);
+                ps_value_release(iv);
+              }
+              continue;
+            }
+            if (strcmp(ins->method, "seek") == 0) {
+              if (!expect_arity(ctx, ins, 1, 1)) goto raise;
+              PS_Value *sv = get_value(&temps, &vars, ins->args[0]);
+              if (!sv || sv->tag != PS_V_INT) {
+                char got[64];
+                snprintf(got, sizeof(got), "%s", value_type_name(sv));
+                ps_throw_io(ctx, "InvalidArgumentException", "invalid seek position");
+                goto raise;
+              }
+              if (is_binary) {
+                int64_t pos = sv->as.int_v;
+                if (pos < 0 || pos > file_size_bytes(ctx, f)) {
+                  char got[64];
+                  snprintf(got, sizeof(got), "%lld", (long long)pos);
+                  ps_throw_io(ctx, "InvalidArgumentException", "seek out of range");
+                  goto raise;
+                }
+                fseek(f->fp, (long)pos, SEEK_SET);
+              } else {
+                if (!file_seek_glyphs(ctx, f, sv->as.int_v)) goto raise;
+              }
+              continue;
             }
-            size_t want = (size_t)sv->as.int_v;
-            if (is_binary) {
-              uint8_t *buf = (uint8_t *)malloc(want);
-              if (!buf) {
-                ps_throw_diag(ctx, PS_ERR_OOM, "out of memory", "read buffer allocation failed", "available memory");
+            if (strcmp(ins->method, "read") == 0) {
+              if (!expect_arity(ctx, ins, 1, 1)) goto raise;
+              if (!can_read) {
+                ps_throw_io(ctx, "ReadFailureException", "file not readable");
                 goto raise;
               }
-              size_t n = fread(buf, 1, want, f->fp);
-              if (ferror(f->fp)) {
-                free(buf);
-                ps_throw_io(ctx, "ReadFailureException", "read failed");
+              PS_Value *sv = get_value(&temps, &vars, ins->args[0]);
+              if (!sv || sv->tag != PS_V_INT) {
+                char got[64];
+                snprintf(got, sizeof(got), "%s", value_type_name(sv));
+                ps_throw_io(ctx, "InvalidArgumentException", "invalid read size");
                 goto raise;
               }
-              if (n == 0) {
-                free(buf);
+              if (sv->as.int_v <= 0) {
+                char got[64];
+                snprintf(got, sizeof(got), "%lld", (long long)sv->as.int_v);
+                ps_throw_io(ctx, "InvalidArgumentException", "invalid read size");
+                goto raise;
+              }
+              size_t want = (size_t)sv->as.int_v;
+              if (is_binary) {
+                uint8_t *buf = (uint8_t *)malloc(want);
+                if (!buf) {
+                  ps_throw_diag(ctx, PS_ERR_OOM, "out of memory", "read buffer allocation failed", "available memory");
+                  goto raise;
+                }
+                size_t n = fread(buf, 1, want, f->fp);
+                if (ferror(f->fp)) {
+                  free(buf);
+                  ps_throw_io(ctx, "ReadFailureException", "read failed");
+                  goto raise;
+                }
+                if (n == 0) {
+                  free(buf);
+                  PS_Value *list = ps_list_new(ctx);
+                  bindings_set(&temps, ins->dst, list);
+                  ps_value_release(list);
+                  continue;
+                }
                 PS_Value *list = ps_list_new(ctx);
+                for (size_t i = 0; i < n; i++) {
+                  PS_Value *bv = ps_make_byte(ctx, buf[i]);
+                  ps_list_push_internal(ctx, list, bv);
+                  ps_value_release(bv);
+                }
+                free(buf);
                 bindings_set(&temps, ins->dst, list);
                 ps_value_release(list);
-                continue;
-              }
-              PS_Value *list = ps_list_new(ctx);
-              for (size_t i = 0; i < n; i++) {
-                PS_Value *bv = ps_make_byte(ctx, buf[i]);
-                ps_list_push_internal(ctx, list, bv);
-                ps_value_release(bv);
+              } else {
+                uint8_t *buf = NULL;
+                size_t cap = 0;
+                size_t len = 0;
+                size_t glyphs = 0;
+                if (read_utf8_glyphs(ctx, f->fp, want, SIZE_MAX, &buf, &cap, &glyphs, &len) < 0) {
+                  free(buf);
+                  goto raise;
+                }
+                if (len == 0) {
+                  free(buf);
+                  PS_Value *s = ps_make_string_utf8(ctx, "", 0);
+                  if (!s) goto raise;
+                  bindings_set(&temps, ins->dst, s);
+                  ps_value_release(s);
+                  continue;
+                }
+                // Already validated while reading: adopt the buffer as is.
+                PS_Value *s = ps_make_string_utf8_owned(ctx, (char *)buf, len);
+                if (!s) goto raise;
+                bindings_set(&temps, ins->dst, s);
+                ps_value_release(s);
               }
-              free(buf);
-              bindings_set(&temps, ins->dst, list);
-              ps_value_release(list);
-            } else {
-              size_t cap = want * 4;
-              if (cap < 16) cap = 16;
-              uint8_t *buf = (uint8_t *)malloc(cap);
-              if (!buf) {
-                ps_throw_diag(ctx, PS_ERR_OOM, "out of memory", "read buffer allocation failed", "available memory");
+              continue;
+            }
+            if (strcmp(ins->method, "write") == 0) {
+              if (!expect_arity(ctx, ins, 1, 1)) goto raise;
+              if (!can_write) {
+                ps_throw_io(ctx, "WriteFailureException", "file not writable");
                 goto raise;
               }
-              size_t len = 0;
-              for (size_t i = 0; i < want; i++) {
-                uint8_t g[4];
-                size_t glen = 0;
-                int r = read_utf8_glyph_stream(ctx, f->fp, g, &glen);
-                if (r == 0) break;
-                if (r < 0) {
-                  free(buf);
+              PS_Value *arg = get_value(&temps, &vars, ins->args[0]);
+              if (!arg) goto raise;
+              if (!is_binary) {
+                if (arg->tag != PS_V_STRING) {
+                  char got[64];
+                  snprintf(got, sizeof(got), "%s", value_type_name(arg));
+                  ps_throw_io(ctx, "InvalidArgumentException", "invalid write value");
+                  goto raise;
+                }
+                if (arg->as.string_v.len > 0) {
+                  long start = ftell(f->fp);
+                  size_t off = 0;
+                  while (off < arg->as.string_v.len) {
+                    size_t n = fwrite(arg->as.string_v.ptr + off, 1, arg->as.string_v.len - off, f->fp);
+                    if (n == 0 || ferror(f->fp)) {
+                      if (start >= 0) fseek(f->fp, start, SEEK_SET);
+                      ps_throw_io(ctx, "WriteFailureException", "write failed");
+                      goto raise;
+                    }
+                    off += n;
+                  }
+                }
+              } else {
+                if (arg->tag != PS_V_LIST) {
+                  char got[64];
+                  snprintf(got, sizeof(got), "%s", value_type_name(arg));
+                  ps_throw_io(ctx, "InvalidArgumentException", "invalid write value");
+                  goto raise;
+                }
+                size_t n = arg->as.list_v.len;
+                uint8_t *buf = (uint8_t *)malloc(n);
+                if (!buf && n > 0) {
+                  ps_throw_diag(ctx, PS_ERR_OOM, "out of memory", "write buffer allocation failed", "available memory");
                   goto raise;
                 }
-                if (len + glen > cap) {
-                  cap *= 2;
-                  uint8_t *nbuf = (uint8_t *)realloc(buf, cap);
-                  if (!nbuf) {
+                for (size_t i = 0; i < n; i++) {
+                  PS_Value *it = arg->as.list_v.items[i];
+                  if (!it || (it->tag != PS_V_INT && it->tag != PS_V_BYTE)) {
                     free(buf);
-                    ps_throw_diag(ctx, PS_ERR_OOM, "out of memory", "read buffer allocation failed", "available memory");
+                    {
+                      char got[64];
+                      snprintf(got, sizeof(got), "%s", value_type_name(it));
+                      ps_throw_io(ctx, "InvalidArgumentException", "invalid byte value");
+                    }
+                    goto raise;
+                  }
+                  int64_t v = (it->tag == PS_V_BYTE) ? it->as.byte_v : it->as.int_v;
+                  if (v < 0 || v > 255) {
+                    free(buf);
+                    {
+                      char got[32];
+                      snprintf(got, sizeof(got), "%lld", (long long)v);
+                      ps_throw_io(ctx, "InvalidArgumentException", "invalid byte value");
+                    }
                     goto raise;
                   }
-                  buf = nbuf;
+                  buf[i] = (uint8_t)v;
+                }
+                if (n > 0) {
+                  long start = ftell(f->fp);
+                  size_t off = 0;
+                  while (off < n) {
+                    size_t wn = fwrite(buf + off, 1, n - off, f->fp);
+                    if (wn == 0 || ferror(f->fp)) {
+                      if (start >= 0) fseek(f->fp, start, SEEK_SET);
+                      free(buf);
+                      ps_throw_io(ctx, "WriteFailureException", "write failed");
+                      goto raise;
+                    }
+                    off += wn;
+                  }
                 }
-                memcpy(buf + len, g, glen);
-                len += glen;
-              }
-              if (len == 0) {
                 free(buf);
-                PS_Value *s = ps_make_string_utf8(ctx, "", 0);
-                if (!s) goto raise;
-                bindings_set(&temps, ins->dst, s);
-                ps_value_release(s);
-                continue;
               }
-              PS_Value *s = ps_make_string_utf8(ctx, (const char *)buf, len);
-              free(buf);
-              if (!s) goto raise;
-              bindings_set(&temps, ins->dst, s);
-              ps_value_release(s);
+              continue;
             }
-            continue;
+            {
+              char got[96];
+              snprintf(got, sizeof(got), "%s", ins->method ? ins->method : "<unknown>");
+              ps_throw_diag(ctx, PS_ERR_TYPE, "unknown method", got, "valid file method");
+            }
+            goto raise;
+          }
+          if (recv->tag == PS_V_OBJECT) {
+            if (strcmp(ins->method, "clone") == 0) {
+              if (!expect_arity(ctx, ins, 0, 0)) goto raise;
+              const char *proto_name = ps_object_proto_name_internal(recv);
+              if (!proto_name || !*proto_name) {
+                const char *shape_base = noncloneable_builtin_handle_base_from_object_shape(ctx, recv);
+                if (shape_base) {
+                  char msg[256];
+                  snprintf(msg, sizeof(msg), "clone not supported for builtin handle %s", shape_base);
+                  ps_throw(ctx, PS_ERR_TYPE, msg);
+                  goto raise;
+                }
+                ps_throw_diag(ctx, PS_ERR_TYPE, "clone expects prototype or instance receiver", "value", "prototype or instance");
+                goto raise;
+              }
+              const char *handle_base = noncloneable_builtin_handle_base(m, proto_name);
+              if (handle_base) {
+                char msg[256];
+                snprintf(msg, sizeof(msg), "clone not supported for builtin handle %s", handle_base);
+                ps_throw(ctx, PS_ERR_TYPE, msg);
+                goto raise;
+              }
+              char callee[256];
+              snprintf(callee, sizeof(callee), "%s.__clone_static", proto_name);
+              PS_Value *ret = NULL;
+              if (exec_call_static(ctx, m, callee, NULL, 0, &ret) != 0) goto raise;
+              bindings_set(&temps, ins->dst, ret);
+              if (ret) ps_value_release(ret);
+              continue;
+            }
+            {
+              const char *proto_name = ps_object_proto_name_internal(recv);
+              const char *method = ins->method ? ins->method : "";
+              int is_process_result = proto_is_subtype_id(m, proto_name, builtin_proto(PN_PROCESS_RESULT));
+              int is_process_event = proto_is_subtype_id(m, proto_name, builtin_proto(PN_PROCESS_EVENT));
+              int is_regexp_match = proto_is_subtype_id(m, proto_name, builtin_proto(PN_REGEXP_MATCH));
+              int is_path_info = proto_is_subtype_id(m, proto_name, builtin_proto(PN_PATH_INFO));
+              int is_path_entry = proto_is_subtype_id(m, proto_name, builtin_proto(PN_PATH_ENTRY));
+              int is_civil = proto_is_subtype_id(m, proto_name, builtin_proto(PN_CIVIL_DATE_TIME));
+                if (!is_civil) {
+                  PS_Value *vy = ps_object_get_str_internal(ctx, recv, "year", 4);
+                  PS_Value *vmo = ps_object_get_str_internal(ctx, recv, "month", 5);
+                  PS_Value *vd = ps_object_get_str_internal(ctx, recv, "day", 3);
+                  if (vy && vmo && vd) is_civil = 1;
+                }
+                if (!is_process_result) {
+                  PS_Value *vcode = ps_object_get_str_internal(ctx, recv, "exitCode", 8);
+                  PS_Value *vevents = ps_object_get_str_internal(ctx, recv, "events", 6);
+                  if (vcode && vevents) is_process_result = 1;
+                }
+                if (!is_process_event) {
+                  PS_Value *vstream = ps_object_get_str_internal(ctx, recv, "stream", 6);
+                  PS_Value *vdata = ps_object_get_str_internal(ctx, recv, "data", 4);
+                  if (vstream && vdata) is_process_event = 1;
+                }
+                if (!is_regexp_match) {
+                  PS_Value *vok = ps_object_get_str_internal(ctx, recv, "ok", 2);
+                  PS_Value *vstart = ps_object_get_str_internal(ctx, recv, "start", 5);
+                  PS_Value *vend = ps_object_get_str_internal(ctx, recv, "end", 3);
+                  PS_Value *vgroups = ps_object_get_str_internal(ctx, recv, "groups", 6);
+                  if (vok && vstart && vend && vgroups) is_regexp_match = 1;
+                }
+                if (is_process_result || is_process_event || is_regexp_match || is_path_info || is_path_entry || is_civil) {
+                  if (is_process_result || is_process_event || is_regexp_match || is_path_info || is_path_entry || is_civil) {
+                    if ((is_civil && (strcmp(method, "setYear") == 0 || strcmp(method, "setMonth") == 0 ||
+                                      strcmp(method, "setDay") == 0 || strcmp(method, "setHour") == 0 ||
+                                      strcmp(method, "setMinute") == 0 || strcmp(method, "setSecond") == 0 ||
+                                      strcmp(method, "setMillisecond") == 0))) {
+                      if (!expect_arity(ctx, ins, 1, 1)) goto raise;
+                      PS_Value *arg = get_value(&temps, &vars, ins->args[0]);
+                      if (!arg || arg->tag != PS_V_INT) {
+                        char got[64];
+                        snprintf(got, sizeof(got), "%s", value_type_name(arg));
+                        ps_throw_diag(ctx, PS_ERR_TYPE, "invalid CivilDateTime setter argument", got, "int");
+                        goto raise;
+                      }
+                      const char *field = NULL;
+                      if (strcmp(method, "setYear") == 0) field = "year";
+                      else if (strcmp(method, "setMonth") == 0) field = "month";
+                      else if (strcmp(method, "setDay") == 0) field = "day";
+                      else if (strcmp(method, "setHour") == 0) field = "hour";
+                      else if (strcmp(method, "setMinute") == 0) field = "minute";
+                      else if (strcmp(method, "setSecond") == 0) field = "second";
+                      else if (strcmp(method, "setMillisecond") == 0) field = "millisecond";
+                      if (!field || !ps_object_set_str_internal(ctx, recv, field, strlen(field), arg)) goto raise;
+                      continue;
+                    }
+                    if (!expect_arity(ctx, ins, 0, 0)) goto raise;
+                    const char *field = NULL;
+                    if (is_process_result) {
+                      if (strcmp(method, "exitCode") == 0) field = "exitCode";
+                      else if (strcmp(method, "events") == 0) field = "events";
+                    } else if (is_process_event) {
+                      if (strcmp(method, "stream") == 0) field = "stream";
+                      else if (strcmp(method, "data") == 0) field = "data";
+                    } else if (is_regexp_match) {
+                      if (strcmp(method, "ok") == 0) field = "ok";
+                      else if (strcmp(method, "start") == 0) field = "start";
+                      else if (strcmp(method, "end") == 0) field = "end";
+                      else if (strcmp(method, "groups") == 0) field = "groups";
+                    } else if (is_path_info) {
+                      if (strcmp(method, "dirname") == 0) field = "dirname";
+                      else if (strcmp(method, "basename") == 0) field = "basename";
+                      else if (strcmp(method, "filename") == 0) field = "filename";
+                      else if (strcmp(method, "extension") == 0) field = "extension";
+                    } else if (is_path_entry) {
+                      if (strcmp(method, "path") == 0) field = "path";
+                      else if (strcmp(method, "name") == 0) field = "name";
+                      else if (strcmp(method, "depth") == 0) field = "depth";
+                      else if (strcmp(method, "isDir") == 0) field = "isDir";
+                      else if (strcmp(method, "isFile") == 0) field = "isFile";
+                      else if (strcmp(method, "isSymlink") == 0) field = "isSymlink";
+                    } else if (is_civil) {
+                      if (strcmp(method, "year") == 0) field = "year";
+                      else if (strcmp(method, "month") == 0) field = "month";
+                      else if (strcmp(method, "day") == 0) field = "day";
+                      else if (strcmp(method, "hour") == 0) field = "hour";
+                      else if (strcmp(method, "minute") == 0) field = "minute";
+                      else if (strcmp(method, "second") == 0) field = "second";
+                      else if (strcmp(method, "millisecond") == 0) field = "millisecond";
+                    }
+                    if (is_regexp_match && field && strcmp(field, "groups") == 0 && !regexp_match_groups(ctx, recv)) goto raise;
+                    if (field) {
+                      PS_Value *v = ps_object_get_str_internal(ctx, recv, field, strlen(field));
+                      if (!v) {
+                        ps_throw_diag(ctx, PS_ERR_TYPE, "missing builtin field", field, "initialized builtin object");
+                        goto raise;
+                      }
+                      bindings_set(&temps, ins->dst, v);
+                      continue;
+                    }
+                  }
+                }
+            }
+            char got[96];
+            snprintf(got, sizeof(got), "%s", ins->method ? ins->method : "<unknown>");
+            ps_throw_diag(ctx, PS_ERR_TYPE, "unknown method", got, "valid object/prototype method");
+            goto raise;
           }
-          if (strcmp(ins->method, "write") == 0) {
-            if (!expect_arity(ctx, ins, 1, 1)) goto raise;
-            if (!can_write) {
-              ps_throw_io(ctx, "WriteFailureException", "file not writable");
+          if (recv->tag == PS_V_INT) {
+            if (strcmp(ins->method, "toInt") == 0) {
+              if (!expect_arity(ctx, ins, 0, 0)) goto raise;
+              PS_Value *i = ps_make_int(ctx, recv->as.int_v);
+              bindings_set(&temps, ins->dst, i);
+              ps_value_release(i);
+            } else if (strcmp(ins->method, "toByte") == 0) {
+              if (!expect_arity(ctx, ins, 0, 0)) goto raise;
+              int64_t v = recv->as.int_v;
+              if (v < 0 || v > 255) {
+                ps_throw_diag(ctx, PS_ERR_RANGE, "byte out of range", "value", "0..255");
+                goto raise;
+              }
+              PS_Value *b = ps_make_byte(ctx, (uint8_t)v);
+              bindings_set(&temps, ins->dst, b);
+              ps_value_release(b);
+            } else if (strcmp(ins->method, "toFloat") == 0) {
+              if (!expect_arity(ctx, ins, 0, 0)) goto raise;
+              PS_Value *f = ps_make_float(ctx, (double)recv->as.int_v);
+              bindings_set(&temps, ins->dst, f);
+              ps_value_release(f);
+            } else if (strcmp(ins->method, "toBytes") == 0) {
+              if (!expect_arity(ctx, ins, 0, 0)) goto raise;
+              uint8_t buf[8];
+              memcpy(buf, &recv->as.int_v, 8);
+              PS_Value *list = bytes_to_list(ctx, buf, 8);
+              if (!list) goto raise;
+              bindings_set(&temps, ins->dst, list);
+              ps_value_release(list);
+            } else if (strcmp(ins->method, "abs") == 0) {
+              if (!expect_arity(ctx, ins, 0, 0)) goto raise;
+              if (recv->as.int_v == INT64_MIN) {
+                ps_throw_diag(ctx, PS_ERR_RANGE, "int overflow", "value", "value within int range");
+                goto raise;
+              }
+              int64_t v = recv->as.int_v < 0 ? -recv->as.int_v : recv->as.int_v;
+              PS_Value *i = ps_make_int(ctx, v);
+              bindings_set(&temps, ins->dst, i);
+              ps_value_release(i);
+            } else if (strcmp(ins->method, "sign") == 0) {
+              if (!expect_arity(ctx, ins, 0, 0)) goto raise;
+              int64_t v = recv->as.int_v == 0 ? 0 : (recv->as.int_v > 0 ? 1 : -1);
+              PS_Value *i = ps_make_int(ctx, v);
+              bindings_set(&temps, ins->dst, i);
+              ps_value_release(i);
+            } else {
+              char got[96];
+              snprintf(got, sizeof(got), "%s", ins->method ? ins->method : "<unknown>");
+              ps_throw_diag(ctx, PS_ERR_TYPE, "unknown method", got, "valid int method");
+              goto raise;
+            }
+          } else if (recv->tag == PS_V_BYTE) {
+            if (strcmp(ins->method, "toInt") == 0) {
+              if (!expect_arity(ctx, ins, 0, 0)) goto raise;
+              PS_Value *i = ps_make_int(ctx, (int64_t)recv->as.byte_v);
+              bindings_set(&temps, ins->dst, i);
+              ps_value_release(i);
+            } else if (strcmp(ins->method, "toFloat") == 0) {
+              if (!expect_arity(ctx, ins, 0, 0)) goto raise;
+              PS_Value *f = ps_make_float(ctx, (double)recv->as.byte_v);
+              bindings_set(&temps, ins->dst, f);
+              ps_value_release(f);
+            } else {
+              char got[96];
+              snprintf(got, sizeof(got), "%s", ins->method ? ins->method : "<unknown>");
+              ps_throw_diag(ctx, PS_ERR_TYPE, "unknown method", got, "valid byte method");
               goto raise;
             }
-            PS_Value *arg = get_value(&temps, &vars, ins->args[0]);
-            if (!arg) goto raise;
-            if (!is_binary) {
-              if (arg->tag != PS_V_STRING) {
+          } else if (recv->tag == PS_V_FLOAT) {
+            if (strcmp(ins->method, "toInt") == 0) {
+              if (!expect_arity(ctx, ins, 0, 0)) goto raise;
+              double v = recv->as.float_v;
+              if (!isfinite(v)) {
                 char got[64];
-                snprintf(got, sizeof(got), "%s", value_type_name(arg));
-                ps_throw_io(ctx, "InvalidArgumentException", "invalid write value");
+                if (isnan(v)) snprintf(got, sizeof(got), "NaN");
+                else if (v > 0) snprintf(got, sizeof(got), "Infinity");
+                else snprintf(got, sizeof(got), "-Infinity");
+                ps_throw_diag(ctx, PS_ERR_TYPE, "invalid float to int", got, "finite float");
                 goto raise;
               }
-              if (arg->as.string_v.len > 0) {
-                long start = ftell(f->fp);
-                size_t off = 0;
-                while (off < arg->as.string_v.len) {
-                  size_t n = fwrite(arg->as.string_v.ptr + off, 1, arg->as.string_v.len - off, f->fp);
-                  if (n == 0 || ferror(f->fp)) {
-                    if (start >= 0) fseek(f->fp, start, SEEK_SET);
-                    ps_throw_io(ctx, "WriteFailureException", "write failed");
-                    goto raise;
-                  }
-                  off += n;
+              if (v > (double)INT64_MAX || v < (double)INT64_MIN) {
+                ps_throw_diag(ctx, PS_ERR_RANGE, "int overflow", "value", "value within int range");
+                goto raise;
+              }
+              int64_t i64 = (int64_t)trunc(v);
+              PS_Value *i = ps_make_int(ctx, i64);
+              bindings_set(&temps, ins->dst, i);
+              ps_value_release(i);
+            } else if (strcmp(ins->method, "toBytes") == 0) {
+              if (!expect_arity(ctx, ins, 0, 0)) goto raise;
+              uint8_t buf[8];
+              memcpy(buf, &recv->as.float_v, 8);
+              PS_Value *list = bytes_to_list(ctx, buf, 8);
+              if (!list) goto raise;
+              bindings_set(&temps, ins->dst, list);
+              ps_value_release(list);
+            } else if (strcmp(ins->method, "abs") == 0) {
+              if (!expect_arity(ctx, ins, 0, 0)) goto raise;
+              PS_Value *f = ps_make_float(ctx, fabs(recv->as.float_v));
+              bindings_set(&temps, ins->dst, f);
+              ps_value_release(f);
+            } else if (strcmp(ins->method, "isNaN") == 0) {
+              if (!expect_arity(ctx, ins, 0, 0)) goto raise;
+              PS_Value *b = ps_make_bool(ctx, isnan(recv->as.float_v) ? 1 : 0);
+              bindings_set(&temps, ins->dst, b);
+              ps_value_release(b);
+            } else if (strcmp(ins->method, "isInfinite") == 0) {
+              if (!expect_arity(ctx, ins, 0, 0)) goto raise;
+              PS_Value *b = ps_make_bool(ctx, isinf(recv->as.float_v) ? 1 : 0);
+              bindings_set(&temps, ins->dst, b);
+              ps_value_release(b);
+            } else if (strcmp(ins->method, "isFinite") == 0) {
+              if (!expect_arity(ctx, ins, 0, 0)) goto raise;
+              PS_Value *b = ps_make_bool(ctx, isfinite(recv->as.float_v) ? 1 : 0);
+              bindings_set(&temps, ins->dst, b);
+              ps_value_release(b);
+            } else {
+              char got[96];
+              snprintf(got, sizeof(got), "%s", ins->method ? ins->method : "<unknown>");
+              ps_throw_diag(ctx, PS_ERR_TYPE, "unknown method", got, "valid float method");
+              goto raise;
+            }
+          } else if (recv->tag == PS_V_GLYPH) {
+            if (strcmp(ins->method, "isLetter") == 0) {
+              if (!expect_arity(ctx, ins, 0, 0)) goto raise;
+              PS_Value *b = ps_make_bool(ctx, glyph_is_letter(recv->as.glyph_v));
+              bindings_set(&temps, ins->dst, b);
+              ps_value_release(b);
+            } else if (strcmp(ins->method, "isDigit") == 0) {
+              if (!expect_arity(ctx, ins, 0, 0)) goto raise;
+              PS_Value *b = ps_make_bool(ctx, glyph_is_digit(recv->as.glyph_v));
+              bindings_set(&temps, ins->dst, b);
+              ps_value_release(b);
+            } else if (strcmp(ins->method, "isWhitespace") == 0) {
+              if (!expect_arity(ctx, ins, 0, 0)) goto raise;
+              PS_Value *b = ps_make_bool(ctx, glyph_is_whitespace(recv->as.glyph_v));
+              bindings_set(&temps, ins->dst, b);
+              ps_value_release(b);
+            } else if (strcmp(ins->method, "isUpper") == 0) {
+              if (!expect_arity(ctx, ins, 0, 0)) goto raise;
+              PS_Value *b = ps_make_bool(ctx, glyph_is_upper(recv->as.glyph_v));
+              bindings_set(&temps, ins->dst, b);
+              ps_value_release(b);
+            } else if (strcmp(ins->method, "isLower") == 0) {
+              if (!expect_arity(ctx, ins, 0, 0)) goto raise;
+              PS_Value *b = ps_make_bool(ctx, glyph_is_lower(recv->as.glyph_v));
+              bindings_set(&temps, ins->dst, b);
+              ps_value_release(b);
+            } else if (strcmp(ins->method, "toUpper") == 0) {
+              if (!expect_arity(ctx, ins, 0, 0)) goto raise;
+              PS_Value *g = ps_make_glyph(ctx, glyph_to_upper(recv->as.glyph_v));
+              bindings_set(&temps, ins->dst, g);
+              ps_value_release(g);
+            } else if (strcmp(ins->method, "toLower") == 0) {
+              if (!expect_arity(ctx, ins, 0, 0)) goto raise;
+              PS_Value *g = ps_make_glyph(ctx, glyph_to_lower(recv->as.glyph_v));
+              bindings_set(&temps, ins->dst, g);
+              ps_value_release(g);
+            } else if (strcmp(ins->method, "toInt") == 0) {
+              if (!expect_arity(ctx, ins, 0, 0)) goto raise;
+              PS_Value *i = ps_make_int(ctx, (int64_t)recv->as.glyph_v);
+              bindings_set(&temps, ins->dst, i);
+              ps_value_release(i);
+            } else if (strcmp(ins->method, "toUtf8Bytes") == 0) {
+              if (!expect_arity(ctx, ins, 0, 0)) goto raise;
+              uint8_t buf[4];
+              size_t n = 0;
+              if (!glyph_to_utf8(recv->as.glyph_v, buf, &n)) {
+                char got[64];
+                snprintf(got, sizeof(got), "U+%04X", (unsigned)recv->as.glyph_v);
+                ps_throw_diag(ctx, PS_ERR_UTF8, "invalid UTF-8", got, "valid Unicode scalar");
+                goto raise;
+              }
+              PS_Value *list = bytes_to_list(ctx, buf, n);
+              if (!list) goto raise;
+              bindings_set(&temps, ins->dst, list);
+              ps_value_release(list);
+            } else {
+              char got[96];
+              snprintf(got, sizeof(got), "%s", ins->method ? ins->method : "<unknown>");
+              ps_throw_diag(ctx, PS_ERR_TYPE, "unknown method", got, "valid glyph method");
+              goto raise;
+            }
+          } else if (recv->tag == PS_V_STRING) {
+            if (strcmp(ins->method, "length") == 0) {
+              if (!expect_arity(ctx, ins, 0, 0)) goto raise;
+              size_t gl = ps_utf8_glyph_len((const uint8_t *)recv->as.string_v.ptr, recv->as.string_v.len);
+              PS_Value *v = ps_make_int(ctx, (int64_t)gl);
+              bindings_set(&temps, ins->dst, v);
+              ps_value_release(v);
+            } else if (strcmp(ins->method, "isEmpty") == 0) {
+              if (!expect_arity(ctx, ins, 0, 0)) goto raise;
+              size_t gl = ps_utf8_glyph_len((const uint8_t *)recv->as.string_v.ptr, recv->as.string_v.len);
+              PS_Value *v = ps_make_bool(ctx, gl == 0);
+              bindings_set(&temps, ins->dst, v);
+              ps_value_release(v);
+            } else if (strcmp(ins->method, "toInt") == 0) {
+              if (!expect_arity(ctx, ins, 0, 0)) goto raise;
+              int64_t iv = 0;
+              if (!parse_int_strict(ctx, recv->as.string_v.ptr, recv->as.string_v.len, &iv)) goto raise;
+              PS_Value *v = ps_make_int(ctx, iv);
+              bindings_set(&temps, ins->dst, v);
+              ps_value_release(v);
+            } else if (strcmp(ins->method, "toFloat") == 0) {
+              if (!expect_arity(ctx, ins, 0, 0)) goto raise;
+              double fv = 0.0;
+              if (!parse_float_strict(ctx, recv->as.string_v.ptr, recv->as.string_v.len, &fv)) goto raise;
+              PS_Value *v = ps_make_float(ctx, fv);
+              bindings_set(&temps, ins->dst, v);
+              ps_value_release(v);
+            } else if (strcmp(ins->method, "subString") == 0) {
+              if (!expect_arity(ctx, ins, 2, 2)) goto raise;
+              PS_Value *a = get_value(&temps, &vars, ins->args[0]);
+              PS_Value *b = get_value(&temps, &vars, ins->args[1]);
+              PS_Value *v = ps_string_substring(ctx, recv, a->as.int_v, b->as.int_v);
+              if (!v) goto raise;
+              bindings_set(&temps, ins->dst, v);
+              ps_value_release(v);
+            } else if (strcmp(ins->method, "indexOf") == 0) {
+              if (!expect_arity(ctx, ins, 1, 1)) goto raise;
+              PS_Value *needle = get_value(&temps, &vars, ins->args[0]);
+              int64_t idx = ps_string_index_of(recv, needle);
+              PS_Value *v = ps_make_int(ctx, idx);
+              bindings_set(&temps, ins->dst, v);
+              ps_value_release(v);
+            } else if (strcmp(ins->method, "contains") == 0) {
+              if (!expect_arity(ctx, ins, 1, 1)) goto raise;
+              PS_Value *needle = get_value(&temps, &vars, ins->args[0]);
+              PS_Value *v = ps_make_bool(ctx, ps_string_contains(recv, needle));
+              bindings_set(&temps, ins->dst, v);
+              ps_value_release(v);
+            } else if (strcmp(ins->method, "lastIndexOf") == 0) {
+              if (!expect_arity(ctx, ins, 1, 1)) goto raise;
+              PS_Value *needle = get_value(&temps, &vars, ins->args[0]);
+              int64_t idx = ps_string_last_index_of(recv, needle);
+              PS_Value *v = ps_make_int(ctx, idx);
+              bindings_set(&temps, ins->dst, v);
+              ps_value_release(v);
+            } else if (strcmp(ins->method, "startsWith") == 0) {
+              if (!expect_arity(ctx, ins, 1, 1)) goto raise;
+              PS_Value *p = get_value(&temps, &vars, ins->args[0]);
+              PS_Value *v = ps_make_bool(ctx, ps_string_starts_with(recv, p));
+              bindings_set(&temps, ins->dst, v);
+              ps_value_release(v);
+            } else if (strcmp(ins->method, "endsWith") == 0) {
+              if (!expect_arity(ctx, ins, 1, 1)) goto raise;
+              PS_Value *p = get_value(&temps, &vars, ins->args[0]);
+              PS_Value *v = ps_make_bool(ctx, ps_string_ends_with(recv, p));
+              bindings_set(&temps, ins->dst, v);
+              ps_value_release(v);
+            } else if (strcmp(ins->method, "split") == 0) {
+              if (!expect_arity(ctx, ins, 1, 1)) goto raise;
+              PS_Value *sep = get_value(&temps, &vars, ins->args[0]);
+              PS_Value *v = ps_string_split(ctx, recv, sep);
+              if (!v) goto raise;
+              bindings_set(&temps, ins->dst, v);
+              ps_value_release(v);
+            } else if (strcmp(ins->method, "trim") == 0) {
+              if (!expect_arity(ctx, ins, 0, 0)) goto raise;
+              PS_Value *v = ps_string_trim(ctx, recv, 0);
+              if (!v) goto raise;
+              bindings_set(&temps, ins->dst, v);
+              ps_value_release(v);
+            } else if (strcmp(ins->method, "trimStart") == 0) {
+              if (!expect_arity(ctx, ins, 0, 0)) goto raise;
+              PS_Value *v = ps_string_trim(ctx, recv, 1);
+              if (!v) goto raise;
+              bindings_set(&temps, ins->dst, v);
+              ps_value_release(v);
+            } else if (strcmp(ins->method, "trimEnd") == 0) {
+              if (!expect_arity(ctx, ins, 0, 0)) goto raise;
+              PS_Value *v = ps_string_trim(ctx, recv, 2);
+              if (!v) goto raise;
+              bindings_set(&temps, ins->dst, v);
+              ps_value_release(v);
+            } else if (strcmp(ins->method, "replace") == 0) {
+              if (!expect_arity(ctx, ins, 2, 2)) goto raise;
+              PS_Value *a = get_value(&temps, &vars, ins->args[0]);
+              PS_Value *b = get_value(&temps, &vars, ins->args[1]);
+              PS_Value *v = ps_string_replace(ctx, recv, a, b);
+              if (!v) goto raise;
+              bindings_set(&temps, ins->dst, v);
+              ps_value_release(v);
+            } else if (strcmp(ins->method, "replaceAll") == 0) {
+              if (!expect_arity(ctx, ins, 2, 2)) goto raise;
+              PS_Value *a = get_value(&temps, &vars, ins->args[0]);
+              PS_Value *b = get_value(&temps, &vars, ins->args[1]);
+              PS_Value *v = ps_string_replace_all(ctx, recv, a, b);
+              if (!v) goto raise;
+              bindings_set(&temps, ins->dst, v);
+              ps_value_release(v);
+            } else if (strcmp(ins->method, "glyphAt") == 0) {
+              if (!expect_arity(ctx, ins, 1, 1)) goto raise;
+              PS_Value *a = get_value(&temps, &vars, ins->args[0]);
+              PS_Value *v = ps_string_glyph_at(ctx, recv, a->as.int_v);
+              if (!v) goto raise;
+              bindings_set(&temps, ins->dst, v);
+              ps_value_release(v);
+            } else if (strcmp(ins->method, "repeat") == 0) {
+              if (!expect_arity(ctx, ins, 1, 1)) goto raise;
+              PS_Value *a = get_value(&temps, &vars, ins->args[0]);
+              PS_Value *v = ps_string_repeat(ctx, recv, a->as.int_v);
+              if (!v) goto raise;
+              bindings_set(&temps, ins->dst, v);
+              ps_value_release(v);
+            } else if (strcmp(ins->method, "padStart") == 0) {
+              if (!expect_arity(ctx, ins, 2, 2)) goto raise;
+              PS_Value *a = get_value(&temps, &vars, ins->args[0]);
+              PS_Value *b = get_value(&temps, &vars, ins->args[1]);
+              PS_Value *v = ps_string_pad_start(ctx, recv, a->as.int_v, b);
+              if (!v) goto raise;
+              bindings_set(&temps, ins->dst, v);
+              ps_value_release(v);
+            } else if (strcmp(ins->method, "padEnd") == 0) {
+              if (!expect_arity(ctx, ins, 2, 2)) goto raise;
+              PS_Value *a = get_value(&temps, &vars, ins->args[0]);
+              PS_Value *b = get_value(&temps, &vars, ins->args[1]);
+              PS_Value *v = ps_string_pad_end(ctx, recv, a->as.int_v, b);
+              if (!v) goto raise;
+              bindings_set(&temps, ins->dst, v);
+              ps_value_release(v);
+            } else if (strcmp(ins->method, "toUpper") == 0) {
+              if (!expect_arity(ctx, ins, 0, 0)) goto raise;
+              PS_Value *v = ps_string_to_upper(ctx, recv);
+              bindings_set(&temps, ins->dst, v);
+              ps_value_release(v);
+            } else if (strcmp(ins->method, "toLower") == 0) {
+              if (!expect_arity(ctx, ins, 0, 0)) goto raise;
+              PS_Value *v = ps_string_to_lower(ctx, recv);
+              bindings_set(&temps, ins->dst, v);
+              ps_value_release(v);
+            } else if (strcmp(ins->method, "toUtf8Bytes") == 0) {
+              if (!expect_arity(ctx, ins, 0, 0)) goto raise;
+              PS_Value *list = bytes_to_list(ctx, (const uint8_t *)recv->as.string_v.ptr, recv->as.string_v.len);
+              if (!list) goto raise;
+              bindings_set(&temps, ins->dst, list);
+              ps_value_release(list);
+            } else if (strcmp(ins->method, "concat") == 0) {
+              if (!expect_arity(ctx, ins, 1, 1)) goto raise;
+              PS_Value *b = NULL;
+              if (ins->arg_count > 0) b = get_value(&temps, &vars, ins->args[0]);
+              if (!b || b->tag != PS_V_STRING) {
+                char got[64];
+                snprintf(got, sizeof(got), "%s", value_type_name(b));
+                ps_throw_diag(ctx, PS_ERR_TYPE, "invalid concat argument", got, "string");
+                goto raise;
+              }
+              PS_Value *v = ps_string_concat(ctx, recv, b);
+              if (!v) goto raise;
+              bindings_set(&temps, ins->dst, v);
+              ps_value_release(v);
+            } else {
+              char got[96];
+              snprintf(got, sizeof(got), "%s", ins->method ? ins->method : "<unknown>");
+              ps_throw_diag(ctx, PS_ERR_TYPE, "unknown method", got, "valid string method");
+              goto raise;
+            }
+          } else if (recv->tag == PS_V_LIST) {
+            if (strcmp(ins->method, "length") == 0) {
+              if (!expect_arity(ctx, ins, 0, 0)) goto raise;
+              PS_Value *v = ps_make_int(ctx, (int64_t)recv->as.list_v.len);
+              bindings_set(&temps, ins->dst, v);
+              ps_value_release(v);
+            } else if (strcmp(ins->method, "isEmpty") == 0) {
+              if (!expect_arity(ctx, ins, 0, 0)) goto raise;
+              PS_Value *v = ps_make_bool(ctx, recv->as.list_v.len == 0);
+              bindings_set(&temps, ins->dst, v);
+              ps_value_release(v);
+            } else if (strcmp(ins->method, "removeLast") == 0) {
+              if (!expect_arity(ctx, ins, 0, 0)) goto raise;
+              if (recv->as.list_v.len == 0) {
+                ps_throw_diag(ctx, PS_ERR_RANGE, "pop on empty list", "empty list", "non-empty list");
+                goto raise;
+              }
+              recv->as.list_v.len -= 1;
+              recv->as.list_v.version += 1;
+            } else if (strcmp(ins->method, "pop") == 0) {
+              if (!expect_arity(ctx, ins, 0, 0)) goto raise;
+              if (recv->as.list_v.len == 0) {
+                ps_throw_diag(ctx, PS_ERR_RANGE, "pop on empty list", "empty list", "non-empty list");
+                goto raise;
+              }
+              PS_Value *v = recv->as.list_v.items[recv->as.list_v.len - 1];
+              recv->as.list_v.len -= 1;
+              recv->as.list_v.version += 1;
+              bindings_set(&temps, ins->dst, v);
+            } else if (strcmp(ins->method, "push") == 0) {
+              if (!expect_arity(ctx, ins, 1, 1)) goto raise;
+              PS_Value *v = get_value(&temps, &vars, ins->args[0]);
+              if (!ps_list_push_internal(ctx, recv, v)) goto raise;
+              PS_Value *rv = ps_make_int(ctx, (int64_t)recv->as.list_v.len);
+              bindings_set(&temps, ins->dst, rv);
+              ps_value_release(rv);
+            } else if (strcmp(ins->method, "contains") == 0) {
+              if (!expect_arity(ctx, ins, 1, 1)) goto raise;
+              PS_Value *needle = get_value(&temps, &vars, ins->args[0]);
+              int found = 0;
+              for (size_t i = 0; i < recv->as.list_v.len; i++) {
+                if (values_equal(recv->as.list_v.items[i], needle)) {
+                  found = 1;
+                  break;
+                }
+              }
+              PS_Value *v = ps_make_bool(ctx, found);
+              bindings_set(&temps, ins->dst, v);
+              ps_value_release(v);
+            } else if (strcmp(ins->method, "reverse") == 0) {
+              if (!expect_arity(ctx, ins, 0, 0)) goto raise;
+              size_t n = recv->as.list_v.len;
+              for (size_t i = 0; i < n / 2; i++) {
+                size_t j = n - 1 - i;
+                PS_Value *tmp = recv->as.list_v.items[i];
+                recv->as.list_v.items[i] = recv->as.list_v.items[j];
+                recv->as.list_v.items[j] = tmp;
+              }
+              PS_Value *v = ps_make_int(ctx, (int64_t)recv->as.list_v.len);
+              bindings_set(&temps, ins->dst, v);
+              ps_value_release(v);
+            } else if (strcmp(ins->method, "sort") == 0) {
+              if (!expect_arity(ctx, ins, 0, 0)) goto raise;
+              size_t n = recv->as.list_v.len;
+              const char *elem_t = ins->type;
+              PS_ValueTag tag = PS_V_VOID;
+              const char *cmp_callee = NULL;
+              char cmp_buf[256];
+              if (!elem_t || elem_t[0] == '\0') {
+                ps_throw_diag(ctx, PS_ERR_TYPE, "list element not comparable", "unknown", "int|float|byte|string|prototype");
+                goto raise;
+              }
+              if (strcmp(elem_t, "int") == 0) tag = PS_V_INT;
+              else if (strcmp(elem_t, "float") == 0) tag = PS_V_FLOAT;
+              else if (strcmp(elem_t, "byte") == 0) tag = PS_V_BYTE;
+              else if (strcmp(elem_t, "string") == 0) tag = PS_V_STRING;
+              else if (proto_exists(m, elem_t)) {
+                tag = PS_V_OBJECT;
+                if (!resolve_compareto_callee(m, elem_t, cmp_buf, sizeof(cmp_buf))) {
+                  ps_throw_diag(ctx, PS_ERR_TYPE, "list element not comparable", elem_t, "compareTo(T other) : int");
+                  goto raise;
+                }
+                cmp_callee = cmp_buf;
+              } else {
+                ps_throw_diag(ctx, PS_ERR_TYPE, "list element not comparable", elem_t, "int|float|byte|string|prototype");
+                goto raise;
+              }
+              for (size_t i = 0; i < n; i++) {
+                PS_Value *it = recv->as.list_v.items[i];
+                if (!it || it->tag != tag) {
+                  char got[64];
+                  snprintf(got, sizeof(got), "%s", value_type_name(it));
+                  ps_throw_diag(ctx, PS_ERR_TYPE, "list element not comparable", got, elem_t);
+                  goto raise;
+                }
+              }
+              if (n > 1) {
+                if (!list_sort_values(ctx, m, recv->as.list_v.items, n, tag, cmp_callee)) goto raise;
+              }
+              PS_Value *v = ps_make_int(ctx, (int64_t)recv->as.list_v.len);
+              bindings_set(&temps, ins->dst, v);
+              ps_value_release(v);
+            } else if (strcmp(ins->method, "join") == 0) {
+              if (!expect_arity(ctx, ins, 1, 1)) goto raise;
+              size_t n = recv->as.list_v.len;
+              PS_Value *sepv = get_value(&temps, &vars, ins->args[0]);
+              if (sepv && sepv->tag != PS_V_STRING) {
+                char got[64];
+                snprintf(got, sizeof(got), "%s", value_type_name(sepv));
+                ps_throw_diag(ctx, PS_ERR_TYPE, "invalid join separator", got, "string");
+                goto raise;
+              }
+              size_t sep_len = sepv ? sepv->as.string_v.len : 0;
+              size_t total = 0;
+              for (size_t i = 0; i < n; i++) {
+                PS_Value *it = recv->as.list_v.items[i];
+                if (!it || it->tag != PS_V_STRING) {
+                  char got[64];
+                  snprintf(got, sizeof(got), "%s", value_type_name(it));
+                  ps_throw_diag(ctx, PS_ERR_TYPE, "invalid join list element", got, "string");
+                  goto raise;
+                }
+                total += it->as.string_v.len;
+              }
+              if (n > 1) total += sep_len * (n - 1);
+              char *buf = (char *)malloc(total + 1);
+              if (!buf && total > 0) {
+                ps_throw_diag(ctx, PS_ERR_OOM, "out of memory", "join buffer allocation failed", "available memory");
+                goto raise;
+              }
+              size_t off = 0;
+              for (size_t i = 0; i < n; i++) {
+                if (i > 0 && sep_len > 0) {
+                  memcpy(buf + off, sepv->as.string_v.ptr, sep_len);
+                  off += sep_len;
+                }
+                if (recv->as.list_v.items[i]->as.string_v.len > 0) {
+                  memcpy(buf + off, recv->as.list_v.items[i]->as.string_v.ptr, recv->as.list_v.items[i]->as.string_v.len);
+                  off += recv->as.list_v.items[i]->as.string_v.len;
+                }
+              }
+              if (buf) buf[off] = '\0';
+              PS_Value *out = ps_make_string_utf8(ctx, buf ? buf : "", off);
+              if (buf) free(buf);
+              if (!out) goto raise;
+              bindings_set(&temps, ins->dst, out);
+              ps_value_release(out);
+            } else if (strcmp(ins->method, "concat") == 0) {
+              if (!expect_arity(ctx, ins, 0, 0)) goto raise;
+              size_t n = recv->as.list_v.len;
+              size_t total = 0;
+              for (size_t i = 0; i < n; i++) {
+                PS_Value *it = recv->as.list_v.items[i];
+                if (!it || it->tag != PS_V_STRING) {
+                  char got[64];
+                  snprintf(got, sizeof(got), "%s", value_type_name(it));
+                  ps_throw_diag(ctx, PS_ERR_TYPE, "invalid concat list element", got, "string");
+                  goto raise;
                 }
+                total += it->as.string_v.len;
               }
-            } else {
-              if (arg->tag != PS_V_LIST) {
-                char got[64];
-                snprintf(got, sizeof(got), "%s", value_type_name(arg));
-                ps_throw_io(ctx, "InvalidArgumentException", "invalid write value");
+              char *buf = (char *)malloc(total + 1);
+              if (!buf && total > 0) {
+                ps_throw_diag(ctx, PS_ERR_OOM, "out of memory", "concat buffer allocation failed", "available memory");
                 goto raise;
               }
-              size_t n = arg->as.list_v.len;
+              size_t off = 0;
+              for (size_t i = 0; i < n; i++) {
+                if (recv->as.list_v.items[i]->as.string_v.len > 0) {
+                  memcpy(buf + off, recv->as.list_v.items[i]->as.string_v.ptr, recv->as.list_v.items[i]->as.string_v.len);
+                  off += recv->as.list_v.items[i]->as.string_v.len;
+                }
+              }
+              if (buf) buf[off] = '\0';
+              PS_Value *out = ps_make_string_utf8(ctx, buf ? buf : "", off);
+              if (buf) free(buf);
+              if (!out) goto raise;
+              bindings_set(&temps, ins->dst, out);
+              ps_value_release(out);
+            } else if (strcmp(ins->method, "toUtf8String") == 0) {
+              if (!expect_arity(ctx, ins, 0, 0)) goto raise;
+              size_t n = recv->as.list_v.len;
               uint8_t *buf = (uint8_t *)malloc(n);
               if (!buf && n > 0) {
-                ps_throw_diag(ctx, PS_ERR_OOM, "out of memory", "write buffer allocation failed", "available memory");
+                ps_throw_diag(ctx, PS_ERR_OOM, "out of memory", "UTF-8 buffer allocation failed", "available memory");
                 goto raise;
               }
               for (size_t i = 0; i < n; i++) {
-                PS_Value *it = arg->as.list_v.items[i];
-                if (!it || (it->tag != PS_V_INT && it->tag != PS_V_BYTE)) {
+                PS_Value *it = recv->as.list_v.items[i];
+                if (!it || (it->tag != PS_V_BYTE && it->tag != PS_V_INT)) {
                   free(buf);
                   {
                     char got[64];
                     snprintf(got, sizeof(got), "%s", value_type_name(it));
-                    ps_throw_io(ctx, "InvalidArgumentException", "invalid byte value");
+                    ps_throw_diag(ctx, PS_ERR_TYPE, "invalid byte list element", got, "byte or int");
                   }
                   goto raise;
                 }
@@ -2731,977 +4594,496 @@ static int exec_function(PS_Context *ctx, PS_IR_Module *m, IRFunction *f, PS_Val
                   {
                     char got[32];
                     snprintf(got, sizeof(got), "%lld", (long long)v);
-                    ps_throw_io(ctx, "InvalidArgumentException", "invalid byte value");
+                    ps_throw_diag(ctx, PS_ERR_RANGE, "byte out of range", got, "0..255");
                   }
                   goto raise;
                 }
                 buf[i] = (uint8_t)v;
               }
-              if (n > 0) {
-                long start = ftell(f->fp);
-                size_t off = 0;
-                while (off < n) {
-                  size_t wn = fwrite(buf + off, 1, n - off, f->fp);
-                  if (wn == 0 || ferror(f->fp)) {
-                    if (start >= 0) fseek(f->fp, start, SEEK_SET);
-                    free(buf);
-                    ps_throw_io(ctx, "WriteFailureException", "write failed");
-                    goto raise;
-                  }
-                  off += wn;
-                }
-              }
+              PS_Value *s = ps_make_string_utf8(ctx, (const char *)buf, n);
               free(buf);
-            }
-            continue;
-          }
-          {
-            char got[96];
-            snprintf(got, sizeof(got), "%s", ins->method ? ins->method : "<unknown>");
-            ps_throw_diag(ctx, PS_ERR_TYPE, "unknown method", got, "valid file method");
-          }
-          goto raise;
-        }
-        if (recv->tag == PS_V_OBJECT) {
-          if (strcmp(ins->method, "clone") == 0) {
-            if (!expect_arity(ctx, ins, 0, 0)) goto raise;
-            const char *proto_name = ps_object_proto_name_internal(recv);
-            if (!proto_name || !*proto_name) {
-              const char *shape_base = noncloneable_builtin_handle_base_from_object_shape(ctx, recv);
-              if (shape_base) {
-                char msg[256];
-                snprintf(msg, sizeof(msg), "clone not supported for builtin handle %s", shape_base);
-                ps_throw(ctx, PS_ERR_TYPE, msg);
-                goto raise;
-              }
-              ps_throw_diag(ctx, PS_ERR_TYPE, "clone expects prototype or instance receiver", "value", "prototype or instance");
-              goto raise;
-            }
-            const char *handle_base = noncloneable_builtin_handle_base(m, proto_name);
-            if (handle_base) {
-              char msg[256];
-              snprintf(msg, sizeof(msg), "clone not supported for builtin handle %s", handle_base);
-              ps_throw(ctx, PS_ERR_TYPE, msg);
+              if (!s) goto raise;
+              bindings_set(&temps, ins->dst, s);
+              ps_value_release(s);
+            } else {
+              char got[96];
+              snprintf(got, sizeof(got), "%s", ins->method ? ins->method : "<unknown>");
+              ps_throw_diag(ctx, PS_ERR_TYPE, "unknown method", got, "valid list method");
               goto raise;
             }
-            char callee[256];
-            snprintf(callee, sizeof(callee), "%s.__clone_static", proto_name);
-            PS_Value *ret = NULL;
-            if (exec_call_static(ctx, m, callee, NULL, 0, &ret) != 0) goto raise;
-            bindings_set(&temps, ins->dst, ret);
-            if (ret) ps_value_release(ret);
-            continue;
-          }
-          {
-            const char *proto_name = ps_object_proto_name_internal(recv);
-            const char *method = ins->method ? ins->method : "";
-            int is_process_result = (proto_name && strcmp(proto_name, "ProcessResult") == 0) || (proto_name && *proto_name && proto_is_subtype_meta(m, proto_name, "ProcessResult"));
-            int is_process_event = (proto_name && strcmp(proto_name, "ProcessEvent") == 0) || (proto_name && *proto_name && proto_is_subtype_meta(m, proto_name, "ProcessEvent"));
-            int is_regexp_match = (proto_name && strcmp(proto_name, "RegExpMatch") == 0) || (proto_name && *proto_name && proto_is_subtype_meta(m, proto_name, "RegExpMatch"));
-            int is_path_info = (proto_name && strcmp(proto_name, "PathInfo") == 0) || (proto_name && *proto_name && proto_is_subtype_meta(m, proto_name, "PathInfo"));
-            int is_path_entry = (proto_name && strcmp(proto_name, "PathEntry") == 0) || (proto_name && *proto_name && proto_is_subtype_meta(m, proto_name, "PathEntry"));
-            int is_civil = (proto_name && strcmp(proto_name, "CivilDateTime") == 0) || (proto_name && *proto_name && proto_is_subtype_meta(m, proto_name, "CivilDateTime"));
-              if (!is_civil) {
-                PS_Value *vy = ps_object_get_str_internal(ctx, recv, "year", 4);
-                PS_Value *vmo = ps_object_get_str_internal(ctx, recv, "month", 5);
-                PS_Value *vd = ps_object_get_str_internal(ctx, recv, "day", 3);
-                if (vy && vmo && vd) is_civil = 1;
-              }
-              if (!is_process_result) {
-                PS_Value *vcode = ps_object_get_str_internal(ctx, recv, "exitCode", 8);
-                PS_Value *vevents = ps_object_get_str_internal(ctx, recv, "events", 6);
-                if (vcode && vevents) is_process_result = 1;
+          } else if (recv->tag == PS_V_MAP) {
+            if (strcmp(ins->method, "length") == 0) {
+              if (!expect_arity(ctx, ins, 0, 0)) goto raise;
+              PS_Value *v = ps_make_int(ctx, (int64_t)recv->as.map_v.len);
+              bindings_set(&temps, ins->dst, v);
+              ps_value_release(v);
+            } else if (strcmp(ins->method, "isEmpty") == 0) {
+              if (!expect_arity(ctx, ins, 0, 0)) goto raise;
+              PS_Value *v = ps_make_bool(ctx, recv->as.map_v.len == 0);
+              bindings_set(&temps, ins->dst, v);
+              ps_value_release(v);
+            } else if (strcmp(ins->method, "containsKey") == 0) {
+              if (!expect_arity(ctx, ins, 1, 1)) goto raise;
+              PS_Value *key = get_value(&temps, &vars, ins->args[0]);
+              if (recv->as.map_v.len > 0) {
+                PS_Value *first = map_first_key(recv);
+                if (first && key && first->tag != key->tag) {
+                  char got[64];
+                  char expected[64];
+                  snprintf(got, sizeof(got), "%s", value_type_name(key));
+                  snprintf(expected, sizeof(expected), "key of type %s", value_type_name(first));
+                  ps_throw_diag(ctx, PS_ERR_TYPE, "map key type mismatch", got, expected);
+                  goto raise;
+                }
               }
-              if (!is_process_event) {
-                PS_Value *vstream = ps_object_get_str_internal(ctx, recv, "stream", 6);
-                PS_Value *vdata = ps_object_get_str_internal(ctx, recv, "data", 4);
-                if (vstream && vdata) is_process_event = 1;
+              int ok = ps_map_has_key(ctx, recv, key);
+              if (ps_last_error_code(ctx) != PS_ERR_NONE) goto raise;
+              PS_Value *v = ps_make_bool(ctx, ok);
+              bindings_set(&temps, ins->dst, v);
+              ps_value_release(v);
+            } else if (strcmp(ins->method, "remove") == 0) {
+              if (!expect_arity(ctx, ins, 1, 1)) goto raise;
+              PS_Value *key = get_value(&temps, &vars, ins->args[0]);
+              if (recv->as.map_v.len > 0) {
+                PS_Value *first = map_first_key(recv);
+                if (first && key && first->tag != key->tag) {
+                  char got[64];
+                  char expected[64];
+                  snprintf(got, sizeof(got), "%s", value_type_name(key));
+                  snprintf(expected, sizeof(expected), "key of type %s", value_type_name(first));
+                  ps_throw_diag(ctx, PS_ERR_TYPE, "map key type mismatch", got, expected);
+                  goto raise;
+                }
               }
-              if (!is_regexp_match) {
-                PS_Value *vok = ps_object_get_str_internal(ctx, recv, "ok", 2);
-                PS_Value *vstart = ps_object_get_str_internal(ctx, recv, "start", 5);
-                PS_Value *vend = ps_object_get_str_internal(ctx, recv, "end", 3);
-                PS_Value *vgroups = ps_object_get_str_internal(ctx, recv, "groups", 6);
-                if (vok && vstart && vend && vgroups) is_regexp_match = 1;
+              int ok = ps_map_remove(ctx, recv, key);
+              if (ps_last_error_code(ctx) != PS_ERR_NONE) goto raise;
+              PS_Value *v = ps_make_bool(ctx, ok);
+              bindings_set(&temps, ins->dst, v);
+              ps_value_release(v);
+            } else if (strcmp(ins->method, "keys") == 0) {
+              if (!expect_arity(ctx, ins, 0, 0)) goto raise;
+              PS_Value *out = ps_list_new(ctx);
+              if (!out) goto raise;
+              PS_Map *m = &recv->as.map_v;
+              for (size_t i = 0; i < m->order_len; i++) {
+                if (!ps_list_push_internal(ctx, out, m->order[i])) {
+                  ps_value_release(out);
+                  goto raise;
+                }
               }
-              if (is_process_result || is_process_event || is_regexp_match || is_path_info || is_path_entry || is_civil) {
-                if (is_process_result || is_process_event || is_regexp_match || is_path_info || is_path_entry || is_civil) {
-                  if ((is_civil && (strcmp(method, "setYear") == 0 || strcmp(method, "setMonth") == 0 ||
-                                    strcmp(method, "setDay") == 0 || strcmp(method, "setHour") == 0 ||
-                                    strcmp(method, "setMinute") == 0 || strcmp(method, "setSecond") == 0 ||
-                                    strcmp(method, "setMillisecond") == 0))) {
-                    if (!expect_arity(ctx, ins, 1, 1)) goto raise;
-                    PS_Value *arg = get_value(&temps, &vars, ins->args[0]);
-                    if (!arg || arg->tag != PS_V_INT) {
-                      char got[64];
-                      snprintf(got, sizeof(got), "%s", value_type_name(arg));
-                      ps_throw_diag(ctx, PS_ERR_TYPE, "invalid CivilDateTime setter argument", got, "int");
-                      goto raise;
-                    }
-                    const char *field = NULL;
-                    if (strcmp(method, "setYear") == 0) field = "year";
-                    else if (strcmp(method, "setMonth") == 0) field = "month";
-                    else if (strcmp(method, "setDay") == 0) field = "day";
-                    else if (strcmp(method, "setHour") == 0) field = "hour";
-                    else if (strcmp(method, "setMinute") == 0) field = "minute";
-                    else if (strcmp(method, "setSecond") == 0) field = "second";
-                    else if (strcmp(method, "setMillisecond") == 0) field = "millisecond";
-                    if (!field || !ps_object_set_str_internal(ctx, recv, field, strlen(field), arg)) goto raise;
-                    continue;
-                  }
-                  if (!expect_arity(ctx, ins, 0, 0)) goto raise;
-                  const char *field = NULL;
-                  if (is_process_result) {
-                    if (strcmp(method, "exitCode") == 0) field = "exitCode";
-                    else if (strcmp(method, "events") == 0) field = "events";
-                  } else if (is_process_event) {
-                    if (strcmp(method, "stream") == 0) field = "stream";
-                    else if (strcmp(method, "data") == 0) field = "data";
-                  } else if (is_regexp_match) {
-                    if (strcmp(method, "ok") == 0) field = "ok";
-                    else if (strcmp(method, "start") == 0) field = "start";
-                    else if (strcmp(method, "end") == 0) field = "end";
-                    else if (strcmp(method, "groups") == 0) field = "groups";
-                  } else if (is_path_info) {
-                    if (strcmp(method, "dirname") == 0) field = "dirname";
-                    else if (strcmp(method, "basename") == 0) field = "basename";
-                    else if (strcmp(method, "filename") == 0) field = "filename";
-                    else if (strcmp(method, "extension") == 0) field = "extension";
-                  } else if (is_path_entry) {
-                    if (strcmp(method, "path") == 0) field = "path";
-                    else if (strcmp(method, "name") == 0) field = "name";
-                    else if (strcmp(method, "depth") == 0) field = "depth";
-                    else if (strcmp(method, "isDir") == 0) field = "isDir";
-                    else if (strcmp(method, "isFile") == 0) field = "isFile";
-                    else if (strcmp(method, "isSymlink") == 0) field = "isSymlink";
-                  } else if (is_civil) {
-                    if (strcmp(method, "year") == 0) field = "year";
-                    else if (strcmp(method, "month") == 0) field = "month";
-                    else if (strcmp(method, "day") == 0) field = "day";
-                    else if (strcmp(method, "hour") == 0) field = "hour";
-                    else if (strcmp(method, "minute") == 0) field = "minute";
-                    else if (strcmp(method, "second") == 0) field = "second";
-                    else if (strcmp(method, "millisecond") == 0) field = "millisecond";
-                  }
-                  if (field) {
-                    PS_Value *v = ps_object_get_str_internal(ctx, recv, field, strlen(field));
-                    if (!v) {
-                      ps_throw_diag(ctx, PS_ERR_TYPE, "missing builtin field", field, "initialized builtin object");
-                      goto raise;
-                    }
-                    bindings_set(&temps, ins->dst, v);
-                    continue;
-                  }
+              bindings_set(&temps, ins->dst, out);
+              ps_value_release(out);
+            } else if (strcmp(ins->method, "values") == 0) {
+              if (!expect_arity(ctx, ins, 0, 0)) goto raise;
+              PS_Value *out = ps_list_new(ctx);
+              if (!out) goto raise;
+              PS_Map *m = &recv->as.map_v;
+              for (size_t i = 0; i < m->order_len; i++) {
+                PS_Value *v = ps_map_get(ctx, recv, m->order[i]);
+                if (ps_last_error_code(ctx) != PS_ERR_NONE) {
+                  ps_value_release(out);
+                  goto raise;
+                }
+                if (!ps_list_push_internal(ctx, out, v)) {
+                  ps_value_release(out);
+                  goto raise;
                 }
               }
-          }
-          char got[96];
-          snprintf(got, sizeof(got), "%s", ins->method ? ins->method : "<unknown>");
-          ps_throw_diag(ctx, PS_ERR_TYPE, "unknown method", got, "valid object/prototype method");
-          goto raise;
-        }
-        if (recv->tag == PS_V_INT) {
-          if (strcmp(ins->method, "toInt") == 0) {
-            if (!expect_arity(ctx, ins, 0, 0)) goto raise;
-            PS_Value *i = ps_make_int(ctx, recv->as.int_v);
-            bindings_set(&temps, ins->dst, i);
-            ps_value_release(i);
-          } else if (strcmp(ins->method, "toByte") == 0) {
-            if (!expect_arity(ctx, ins, 0, 0)) goto raise;
-            int64_t v = recv->as.int_v;
-            if (v < 0 || v > 255) {
-              ps_throw_diag(ctx, PS_ERR_RANGE, "byte out of range", "value", "0..255");
+              bindings_set(&temps, ins->dst, out);
+              ps_value_release(out);
+            } else {
+              char got[96];
+              snprintf(got, sizeof(got), "%s", ins->method ? ins->method : "<unknown>");
+              ps_throw_diag(ctx, PS_ERR_TYPE, "unknown method", got, "valid map method");
               goto raise;
             }
-            PS_Value *b = ps_make_byte(ctx, (uint8_t)v);
-            bindings_set(&temps, ins->dst, b);
-            ps_value_release(b);
-          } else if (strcmp(ins->method, "toFloat") == 0) {
-            if (!expect_arity(ctx, ins, 0, 0)) goto raise;
-            PS_Value *f = ps_make_float(ctx, (double)recv->as.int_v);
-            bindings_set(&temps, ins->dst, f);
-            ps_value_release(f);
-          } else if (strcmp(ins->method, "toBytes") == 0) {
-            if (!expect_arity(ctx, ins, 0, 0)) goto raise;
-            uint8_t buf[8];
-            memcpy(buf, &recv->as.int_v, 8);
-            PS_Value *list = bytes_to_list(ctx, buf, 8);
-            if (!list) goto raise;
-            bindings_set(&temps, ins->dst, list);
-            ps_value_release(list);
-          } else if (strcmp(ins->method, "abs") == 0) {
-            if (!expect_arity(ctx, ins, 0, 0)) goto raise;
-            if (recv->as.int_v == INT64_MIN) {
-              ps_throw_diag(ctx, PS_ERR_RANGE, "int overflow", "value", "value within int range");
+          } else if (recv->tag == PS_V_VIEW) {
+            if (strcmp(ins->method, "length") == 0) {
+              if (!expect_arity(ctx, ins, 0, 0)) goto raise;
+              if (!view_is_valid(recv)) {
+                ps_throw_diag(ctx, PS_ERR_RANGE, "view invalidated", "invalidated view", "valid view");
+                goto raise;
+              }
+              PS_Value *v = ps_make_int(ctx, (int64_t)recv->as.view_v.len);
+              bindings_set(&temps, ins->dst, v);
+              ps_value_release(v);
+            } else if (strcmp(ins->method, "isEmpty") == 0) {
+              if (!expect_arity(ctx, ins, 0, 0)) goto raise;
+              if (!view_is_valid(recv)) {
+                ps_throw_diag(ctx, PS_ERR_RANGE, "view invalidated", "invalidated view", "valid view");
+                goto raise;
+              }
+              PS_Value *v = ps_make_bool(ctx, recv->as.view_v.len == 0);
+              bindings_set(&temps, ins->dst, v);
+              ps_value_release(v);
+            } else {
+              char got[96];
+              snprintf(got, sizeof(got), "%s", ins->method ? ins->method : "<unknown>");
+              ps_throw_diag(ctx, PS_ERR_TYPE, "unknown method", got, "valid view method");
               goto raise;
             }
-            int64_t v = recv->as.int_v < 0 ? -recv->as.int_v : recv->as.int_v;
-            PS_Value *i = ps_make_int(ctx, v);
-            bindings_set(&temps, ins->dst, i);
-            ps_value_release(i);
-          } else if (strcmp(ins->method, "sign") == 0) {
-            if (!expect_arity(ctx, ins, 0, 0)) goto raise;
-            int64_t v = recv->as.int_v == 0 ? 0 : (recv->as.int_v > 0 ? 1 : -1);
-            PS_Value *i = ps_make_int(ctx, v);
-            bindings_set(&temps, ins->dst, i);
-            ps_value_release(i);
-          } else {
-            char got[96];
-            snprintf(got, sizeof(got), "%s", ins->method ? ins->method : "<unknown>");
-            ps_throw_diag(ctx, PS_ERR_TYPE, "unknown method", got, "valid int method");
-            goto raise;
-          }
-        } else if (recv->tag == PS_V_BYTE) {
-          if (strcmp(ins->method, "toInt") == 0) {
-            if (!expect_arity(ctx, ins, 0, 0)) goto raise;
-            PS_Value *i = ps_make_int(ctx, (int64_t)recv->as.byte_v);
-            bindings_set(&temps, ins->dst, i);
-            ps_value_release(i);
-          } else if (strcmp(ins->method, "toFloat") == 0) {
-            if (!expect_arity(ctx, ins, 0, 0)) goto raise;
-            PS_Value *f = ps_make_float(ctx, (double)recv->as.byte_v);
-            bindings_set(&temps, ins->dst, f);
-            ps_value_release(f);
-          } else {
-            char got[96];
-            snprintf(got, sizeof(got), "%s", ins->method ? ins->method : "<unknown>");
-            ps_throw_diag(ctx, PS_ERR_TYPE, "unknown method", got, "valid byte method");
-            goto raise;
-          }
-        } else if (recv->tag == PS_V_FLOAT) {
-          if (strcmp(ins->method, "toInt") == 0) {
-            if (!expect_arity(ctx, ins, 0, 0)) goto raise;
-            double v = recv->as.float_v;
-            if (!isfinite(v)) {
-              char got[64];
-              if (isnan(v)) snprintf(got, sizeof(got), "NaN");
-              else if (v > 0) snprintf(got, sizeof(got), "Infinity");
-              else snprintf(got, sizeof(got), "-Infinity");
-              ps_throw_diag(ctx, PS_ERR_TYPE, "invalid float to int", got, "finite float");
+          } else if (recv->tag == PS_V_BYTES) {
+            if (strcmp(ins->method, "toUtf8String") == 0) {
+              if (!expect_arity(ctx, ins, 0, 0)) goto raise;
+              PS_Value *v = ps_bytes_to_utf8_string(ctx, recv);
+              if (!v) goto raise;
+              bindings_set(&temps, ins->dst, v);
+              ps_value_release(v);
+            } else {
+              char got[96];
+              snprintf(got, sizeof(got), "%s", ins->method ? ins->method : "<unknown>");
+              ps_throw_diag(ctx, PS_ERR_TYPE, "unknown method", got, "valid bytes method");
               goto raise;
             }
-            if (v > (double)INT64_MAX || v < (double)INT64_MIN) {
-              ps_throw_diag(ctx, PS_ERR_RANGE, "int overflow", "value", "value within int range");
-              goto raise;
+          }
+          continue;
+        }
+        case IR_OP_CALL_BUILTIN_PRINT: {
+          if (ins->arg_count > 0) {
+            PS_Value *v = get_value(&temps, &vars, ins->args[0]);
+            if (v && v->tag == PS_V_STRING) {
+              fwrite(v->as.string_v.ptr, 1, v->as.string_v.len, stdout);
+              fputc('\n', stdout);
             }
-            int64_t i64 = (int64_t)trunc(v);
-            PS_Value *i = ps_make_int(ctx, i64);
-            bindings_set(&temps, ins->dst, i);
-            ps_value_release(i);
-          } else if (strcmp(ins->method, "toBytes") == 0) {
-            if (!expect_arity(ctx, ins, 0, 0)) goto raise;
-            uint8_t buf[8];
-            memcpy(buf, &recv->as.float_v, 8);
-            PS_Value *list = bytes_to_list(ctx, buf, 8);
-            if (!list) goto raise;
-            bindings_set(&temps, ins->dst, list);
-            ps_value_release(list);
-          } else if (strcmp(ins->method, "abs") == 0) {
-            if (!expect_arity(ctx, ins, 0, 0)) goto raise;
-            PS_Value *f = ps_make_float(ctx, fabs(recv->as.float_v));
-            bindings_set(&temps, ins->dst, f);
-            ps_value_release(f);
-          } else if (strcmp(ins->method, "isNaN") == 0) {
-            if (!expect_arity(ctx, ins, 0, 0)) goto raise;
-            PS_Value *b = ps_make_bool(ctx, isnan(recv->as.float_v) ? 1 : 0);
-            bindings_set(&temps, ins->dst, b);
-            ps_value_release(b);
-          } else if (strcmp(ins->method, "isInfinite") == 0) {
-            if (!expect_arity(ctx, ins, 0, 0)) goto raise;
-            PS_Value *b = ps_make_bool(ctx, isinf(recv->as.float_v) ? 1 : 0);
-            bindings_set(&temps, ins->dst, b);
-            ps_value_release(b);
-          } else if (strcmp(ins->method, "isFinite") == 0) {
-            if (!expect_arity(ctx, ins, 0, 0)) goto raise;
-            PS_Value *b = ps_make_bool(ctx, isfinite(recv->as.float_v) ? 1 : 0);
-            bindings_set(&temps, ins->dst, b);
-            ps_value_release(b);
           } else {
-            char got[96];
-            snprintf(got, sizeof(got), "%s", ins->method ? ins->method : "<unknown>");
-            ps_throw_diag(ctx, PS_ERR_TYPE, "unknown method", got, "valid float method");
-            goto raise;
+            fputc('\n', stdout);
           }
-        } else if (recv->tag == PS_V_GLYPH) {
-          if (strcmp(ins->method, "isLetter") == 0) {
-            if (!expect_arity(ctx, ins, 0, 0)) goto raise;
-            PS_Value *b = ps_make_bool(ctx, glyph_is_letter(recv->as.glyph_v));
-            bindings_set(&temps, ins->dst, b);
-            ps_value_release(b);
-          } else if (strcmp(ins->method, "isDigit") == 0) {
-            if (!expect_arity(ctx, ins, 0, 0)) goto raise;
-            PS_Value *b = ps_make_bool(ctx, glyph_is_digit(recv->as.glyph_v));
-            bindings_set(&temps, ins->dst, b);
-            ps_value_release(b);
-          } else if (strcmp(ins->method, "isWhitespace") == 0) {
-            if (!expect_arity(ctx, ins, 0, 0)) goto raise;
-            PS_Value *b = ps_make_bool(ctx, glyph_is_whitespace(recv->as.glyph_v));
-            bindings_set(&temps, ins->dst, b);
-            ps_value_release(b);
-          } else if (strcmp(ins->method, "isUpper") == 0) {
-            if (!expect_arity(ctx, ins, 0, 0)) goto raise;
-            PS_Value *b = ps_make_bool(ctx, glyph_is_upper(recv->as.glyph_v));
-            bindings_set(&temps, ins->dst, b);
-            ps_value_release(b);
-          } else if (strcmp(ins->method, "isLower") == 0) {
-            if (!expect_arity(ctx, ins, 0, 0)) goto raise;
-            PS_Value *b = ps_make_bool(ctx, glyph_is_lower(recv->as.glyph_v));
-            bindings_set(&temps, ins->dst, b);
-            ps_value_release(b);
-          } else if (strcmp(ins->method, "toUpper") == 0) {
-            if (!expect_arity(ctx, ins, 0, 0)) goto raise;
-            PS_Value *g = ps_make_glyph(ctx, glyph_to_upper(recv->as.glyph_v));
-            bindings_set(&temps, ins->dst, g);
-            ps_value_release(g);
-          } else if (strcmp(ins->method, "toLower") == 0) {
-            if (!expect_arity(ctx, ins, 0, 0)) goto raise;
-            PS_Value *g = ps_make_glyph(ctx, glyph_to_lower(recv->as.glyph_v));
-            bindings_set(&temps, ins->dst, g);
-            ps_value_release(g);
-          } else if (strcmp(ins->method, "toInt") == 0) {
-            if (!expect_arity(ctx, ins, 0, 0)) goto raise;
-            PS_Value *i = ps_make_int(ctx, (int64_t)recv->as.glyph_v);
-            bindings_set(&temps, ins->dst, i);
-            ps_value_release(i);
-          } else if (strcmp(ins->method, "toUtf8Bytes") == 0) {
-            if (!expect_arity(ctx, ins, 0, 0)) goto raise;
+          continue;
+        }
+        case IR_OP_CALL_BUILTIN_TOSTRING: {
+          PS_Value *v = get_value(&temps, &vars, ins->value);
+          PS_Value *s = NULL;
+          if (v->tag == PS_V_STRING) s = ps_value_retain(v);
+          else if (v->tag == PS_V_INT) {
+            char buf[64];
+            snprintf(buf, sizeof(buf), "%lld", (long long)v->as.int_v);
+            s = ps_make_string_utf8(ctx, buf, strlen(buf));
+          } else if (v->tag == PS_V_BYTE) {
+            char buf[64];
+            snprintf(buf, sizeof(buf), "%u", (unsigned)v->as.byte_v);
+            s = ps_make_string_utf8(ctx, buf, strlen(buf));
+          } else if (v->tag == PS_V_GLYPH) {
             uint8_t buf[4];
             size_t n = 0;
-            if (!glyph_to_utf8(recv->as.glyph_v, buf, &n)) {
+            if (!glyph_to_utf8(v->as.glyph_v, buf, &n)) {
               char got[64];
-              snprintf(got, sizeof(got), "U+%04X", (unsigned)recv->as.glyph_v);
+              snprintf(got, sizeof(got), "U+%04X", (unsigned)v->as.glyph_v);
               ps_throw_diag(ctx, PS_ERR_UTF8, "invalid UTF-8", got, "valid Unicode scalar");
               goto raise;
             }
-            PS_Value *list = bytes_to_list(ctx, buf, n);
-            if (!list) goto raise;
-            bindings_set(&temps, ins->dst, list);
-            ps_value_release(list);
+            s = ps_make_string_utf8(ctx, (const char *)buf, n);
+          } else if (v->tag == PS_V_FLOAT) {
+            char buf[64];
+            format_float_shortest(v->as.float_v, buf, sizeof(buf));
+            s = ps_make_string_utf8(ctx, buf, strlen(buf));
+          } else if (v->tag == PS_V_BOOL) {
+            const char *t = v->as.bool_v ? "true" : "false";
+            s = ps_make_string_utf8(ctx, t, strlen(t));
           } else {
-            char got[96];
-            snprintf(got, sizeof(got), "%s", ins->method ? ins->method : "<unknown>");
-            ps_throw_diag(ctx, PS_ERR_TYPE, "unknown method", got, "valid glyph method");
+            s = ps_make_string_utf8(ctx, "<value>", 7);
+          }
+          bindings_set(&temps, ins->dst, s);
+          ps_value_release(s);
+          continue;
+        }
+        case IR_OP_JUMP: {
+          block_idx = ins->target_block;
+          goto next_block;
+        }
+        case IR_OP_BRANCH_IF: {
+          PS_Value *c = get_value(&temps, &vars, ins->cond);
+          block_idx = is_truthy(c) ? ins->then_block : ins->else_block;
+          goto next_block;
+        }
+        case IR_OP_RET: {
+          PS_Value *v = get_value(&temps, &vars, ins->value);
+          if (out) *out = v ? ps_value_retain(v) : NULL;
+          bindings_free(&temps);
+          bindings_free(&vars);
+          if (last_exception) ps_value_release(last_exception);
+          return 0;
+        }
+        case IR_OP_RET_VOID: {
+          bindings_free(&temps);
+          bindings_free(&vars);
+          if (last_exception) ps_value_release(last_exception);
+          return 0;
+        }
+        case IR_OP_THROW: {
+          PS_Value *v = get_value(&temps, &vars, ins->value);
+          if (!v || v->tag != PS_V_EXCEPTION) {
+            char got[64];
+            snprintf(got, sizeof(got), "%s", value_type_name(v));
+            ps_throw_diag(ctx, PS_ERR_TYPE, "throw expects Exception", got, "Exception");
             goto raise;
           }
-        } else if (recv->tag == PS_V_STRING) {
-          if (strcmp(ins->method, "length") == 0) {
-            if (!expect_arity(ctx, ins, 0, 0)) goto raise;
-            size_t gl = ps_utf8_glyph_len((const uint8_t *)recv->as.string_v.ptr, recv->as.string_v.len);
-            PS_Value *v = ps_make_int(ctx, (int64_t)gl);
-            bindings_set(&temps, ins->dst, v);
-            ps_value_release(v);
-          } else if (strcmp(ins->method, "isEmpty") == 0) {
-            if (!expect_arity(ctx, ins, 0, 0)) goto raise;
-            size_t gl = ps_utf8_glyph_len((const uint8_t *)recv->as.string_v.ptr, recv->as.string_v.len);
-            PS_Value *v = ps_make_bool(ctx, gl == 0);
-            bindings_set(&temps, ins->dst, v);
-            ps_value_release(v);
-          } else if (strcmp(ins->method, "toInt") == 0) {
-            if (!expect_arity(ctx, ins, 0, 0)) goto raise;
-            int64_t iv = 0;
-            if (!parse_int_strict(ctx, recv->as.string_v.ptr, recv->as.string_v.len, &iv)) goto raise;
-            PS_Value *v = ps_make_int(ctx, iv);
-            bindings_set(&temps, ins->dst, v);
-            ps_value_release(v);
-          } else if (strcmp(ins->method, "toFloat") == 0) {
-            if (!expect_arity(ctx, ins, 0, 0)) goto raise;
-            double fv = 0.0;
-            if (!parse_float_strict(ctx, recv->as.string_v.ptr, recv->as.string_v.len, &fv)) goto raise;
-            PS_Value *v = ps_make_float(ctx, fv);
-            bindings_set(&temps, ins->dst, v);
-            ps_value_release(v);
-          } else if (strcmp(ins->method, "subString") == 0) {
-            if (!expect_arity(ctx, ins, 2, 2)) goto raise;
-            PS_Value *a = get_value(&temps, &vars, ins->args[0]);
-            PS_Value *b = get_value(&temps, &vars, ins->args[1]);
-            PS_Value *v = ps_string_substring(ctx, recv, a->as.int_v, b->as.int_v);
-            if (!v) goto raise;
-            bindings_set(&temps, ins->dst, v);
-            ps_value_release(v);
-          } else if (strcmp(ins->method, "indexOf") == 0) {
-            if (!expect_arity(ctx, ins, 1, 1)) goto raise;
-            PS_Value *needle = get_value(&temps, &vars, ins->args[0]);
-            int64_t idx = ps_string_index_of(recv, needle);
-            PS_Value *v = ps_make_int(ctx, idx);
-            bindings_set(&temps, ins->dst, v);
-            ps_value_release(v);
-          } else if (strcmp(ins->method, "contains") == 0) {
-            if (!expect_arity(ctx, ins, 1, 1)) goto raise;
-            PS_Value *needle = get_value(&temps, &vars, ins->args[0]);
-            PS_Value *v = ps_make_bool(ctx, ps_string_contains(recv, needle));
-            bindings_set(&temps, ins->dst, v);
-            ps_value_release(v);
-          } else if (strcmp(ins->method, "lastIndexOf") == 0) {
-            if (!expect_arity(ctx, ins, 1, 1)) goto raise;
-            PS_Value *needle = get_value(&temps, &vars, ins->args[0]);
-            int64_t idx = ps_string_last_index_of(recv, needle);
-            PS_Value *v = ps_make_int(ctx, idx);
-            bindings_set(&temps, ins->dst, v);
-            ps_value_release(v);
-          } else if (strcmp(ins->method, "startsWith") == 0) {
-            if (!expect_arity(ctx, ins, 1, 1)) goto raise;
-            PS_Value *p = get_value(&temps, &vars, ins->args[0]);
-            PS_Value *v = ps_make_bool(ctx, ps_string_starts_with(recv, p));
-            bindings_set(&temps, ins->dst, v);
-            ps_value_release(v);
-          } else if (strcmp(ins->method, "endsWith") == 0) {
-            if (!expect_arity(ctx, ins, 1, 1)) goto raise;
-            PS_Value *p = get_value(&temps, &vars, ins->args[0]);
-            PS_Value *v = ps_make_bool(ctx, ps_string_ends_with(recv, p));
-            bindings_set(&temps, ins->dst, v);
-            ps_value_release(v);
-          } else if (strcmp(ins->method, "split") == 0) {
-            if (!expect_arity(ctx, ins, 1, 1)) goto raise;
-            PS_Value *sep = get_value(&temps, &vars, ins->args[0]);
-            PS_Value *v = ps_string_split(ctx, recv, sep);
-            if (!v) goto raise;
-            bindings_set(&temps, ins->dst, v);
-            ps_value_release(v);
-          } else if (strcmp(ins->method, "trim") == 0) {
-            if (!expect_arity(ctx, ins, 0, 0)) goto raise;
-            PS_Value *v = ps_string_trim(ctx, recv, 0);
-            if (!v) goto raise;
-            bindings_set(&temps, ins->dst, v);
-            ps_value_release(v);
-          } else if (strcmp(ins->method, "trimStart") == 0) {
-            if (!expect_arity(ctx, ins, 0, 0)) goto raise;
-            PS_Value *v = ps_string_trim(ctx, recv, 1);
-            if (!v) goto raise;
-            bindings_set(&temps, ins->dst, v);
-            ps_value_release(v);
-          } else if (strcmp(ins->method, "trimEnd") == 0) {
-            if (!expect_arity(ctx, ins, 0, 0)) goto raise;
-            PS_Value *v = ps_string_trim(ctx, recv, 2);
-            if (!v) goto raise;
-            bindings_set(&temps, ins->dst, v);
-            ps_value_release(v);
-          } else if (strcmp(ins->method, "replace") == 0) {
-            if (!expect_arity(ctx, ins, 2, 2)) goto raise;
-            PS_Value *a = get_value(&temps, &vars, ins->args[0]);
-            PS_Value *b = get_value(&temps, &vars, ins->args[1]);
-            PS_Value *v = ps_string_replace(ctx, recv, a, b);
-            if (!v) goto raise;
-            bindings_set(&temps, ins->dst, v);
-            ps_value_release(v);
-          } else if (strcmp(ins->method, "replaceAll") == 0) {
-            if (!expect_arity(ctx, ins, 2, 2)) goto raise;
-            PS_Value *a = get_value(&temps, &vars, ins->args[0]);
-            PS_Value *b = get_value(&temps, &vars, ins->args[1]);
-            PS_Value *v = ps_string_replace_all(ctx, recv, a, b);
-            if (!v) goto raise;
-            bindings_set(&temps, ins->dst, v);
-            ps_value_release(v);
-          } else if (strcmp(ins->method, "glyphAt") == 0) {
-            if (!expect_arity(ctx, ins, 1, 1)) goto raise;
-            PS_Value *a = get_value(&temps, &vars, ins->args[0]);
-            PS_Value *v = ps_string_glyph_at(ctx, recv, a->as.int_v);
-            if (!v) goto raise;
-            bindings_set(&temps, ins->dst, v);
-            ps_value_release(v);
-          } else if (strcmp(ins->method, "repeat") == 0) {
-            if (!expect_arity(ctx, ins, 1, 1)) goto raise;
-            PS_Value *a = get_value(&temps, &vars, ins->args[0]);
-            PS_Value *v = ps_string_repeat(ctx, recv, a->as.int_v);
-            if (!v) goto raise;
-            bindings_set(&temps, ins->dst, v);
-            ps_value_release(v);
-          } else if (strcmp(ins->method, "padStart") == 0) {
-            if (!expect_arity(ctx, ins, 2, 2)) goto raise;
-            PS_Value *a = get_value(&temps, &vars, ins->args[0]);
-            PS_Value *b = get_value(&temps, &vars, ins->args[1]);
-            PS_Value *v = ps_string_pad_start(ctx, recv, a->as.int_v, b);
-            if (!v) goto raise;
-            bindings_set(&temps, ins->dst, v);
-            ps_value_release(v);
-          } else if (strcmp(ins->method, "padEnd") == 0) {
-            if (!expect_arity(ctx, ins, 2, 2)) goto raise;
-            PS_Value *a = get_value(&temps, &vars, ins->args[0]);
-            PS_Value *b = get_value(&temps, &vars, ins->args[1]);
-            PS_Value *v = ps_string_pad_end(ctx, recv, a->as.int_v, b);
-            if (!v) goto raise;
-            bindings_set(&temps, ins->dst, v);
-            ps_value_release(v);
-          } else if (strcmp(ins->method, "toUpper") == 0) {
-            if (!expect_arity(ctx, ins, 0, 0)) goto raise;
-            PS_Value *v = ps_string_to_upper(ctx, recv);
-            bindings_set(&temps, ins->dst, v);
-            ps_value_release(v);
-          } else if (strcmp(ins->method, "toLower") == 0) {
-            if (!expect_arity(ctx, ins, 0, 0)) goto raise;
-            PS_Value *v = ps_string_to_lower(ctx, recv);
-            bindings_set(&temps, ins->dst, v);
-            ps_value_release(v);
-          } else if (strcmp(ins->method, "toUtf8Bytes") == 0) {
-            if (!expect_arity(ctx, ins, 0, 0)) goto raise;
-            PS_Value *list = bytes_to_list(ctx, (const uint8_t *)recv->as.string_v.ptr, recv->as.string_v.len);
-            if (!list) goto raise;
-            bindings_set(&temps, ins->dst, list);
-            ps_value_release(list);
-          } else if (strcmp(ins->method, "concat") == 0) {
-            if (!expect_arity(ctx, ins, 1, 1)) goto raise;
-            PS_Value *b = NULL;
-            if (ins->arg_count > 0) b = get_value(&temps, &vars, ins->args[0]);
-            if (!b || b->tag != PS_V_STRING) {
-              char got[64];
-              snprintf(got, sizeof(got), "%s", value_type_name(b));
-              ps_throw_diag(ctx, PS_ERR_TYPE, "invalid concat argument", got, "string");
-              goto raise;
-            }
-            PS_Value *v = ps_string_concat(ctx, recv, b);
-            if (!v) goto raise;
-            bindings_set(&temps, ins->dst, v);
-            ps_value_release(v);
-          } else {
-            char got[96];
-            snprintf(got, sizeof(got), "%s", ins->method ? ins->method : "<unknown>");
-            ps_throw_diag(ctx, PS_ERR_TYPE, "unknown method", got, "valid string method");
+          if (ins->file || ins->line || ins->col) {
+            set_exception_location(ctx, v, ins->file, ins->line, ins->col);
+          }
+          if (last_exception) ps_value_release(last_exception);
+          last_exception = ps_value_retain(v);
+          goto raise;
+        }
+        case IR_OP_ADD_I64:
+        case IR_OP_SUB_I64:
+        case IR_OP_MUL_I64: {
+          PS_Value *l = get_value(&temps, &vars, ins->left);
+          PS_Value *r = get_value(&temps, &vars, ins->right);
+          if (!l || !r || l->tag != PS_V_INT || r->tag != PS_V_INT) goto bin_op_generic;
+          // Overflow is rejected by the preceding check op; wrap instead of UB.
+          uint64_t a = (uint64_t)l->as.int_v;
+          uint64_t b = (uint64_t)r->as.int_v;
+          uint64_t v = ins->opcode == IR_OP_ADD_I64 ? a + b : ins->opcode == IR_OP_SUB_I64 ? a - b : a * b;
+          PS_Value *res = ps_make_int(ctx, (int64_t)v);
+          if (!res) goto raise;
+          bindings_set(&temps, ins->dst, res);
+          ps_value_release(res);
+          continue;
+        }
+        case IR_OP_EQ_I64:
+        case IR_OP_NE_I64:
+        case IR_OP_LT_I64:
+        case IR_OP_LE_I64:
+        case IR_OP_GT_I64:
+        case IR_OP_GE_I64: {
+          PS_Value *l = get_value(&temps, &vars, ins->left);
+          PS_Value *r = get_value(&temps, &vars, ins->right);
+          if (!l || !r || l->tag != PS_V_INT || r->tag != PS_V_INT) goto bin_op_generic;
+          int64_t a = l->as.int_v;
+          int64_t b = r->as.int_v;
+          int c = 0;
+          switch (ins->opcode) {
+            case IR_OP_EQ_I64: c = a == b; break;
+            case IR_OP_NE_I64: c = a != b; break;
+            case IR_OP_LT_I64: c = a < b; break;
+            case IR_OP_LE_I64: c = a <= b; break;
+            case IR_OP_GT_I64: c = a > b; break;
+            default: c = a >= b; break;
+          }
+          PS_Value *res = ps_make_bool(ctx, c);
+          if (!res) goto raise;
+          bindings_set(&temps, ins->dst, res);
+          ps_value_release(res);
+          continue;
+        }
+        case IR_OP_ADD_F64:
+        case IR_OP_SUB_F64:
+        case IR_OP_MUL_F64:
+        case IR_OP_DIV_F64:
+        case IR_OP_LT_F64:
+        case IR_OP_LE_F64:
+        case IR_OP_GT_F64:
+        case IR_OP_GE_F64: {
+          PS_Value *l = get_value(&temps, &vars, ins->left);
+          PS_Value *r = get_value(&temps, &vars, ins->right);
+          if (!l || !r || l->tag != PS_V_FLOAT || r->tag != PS_V_FLOAT) goto bin_op_generic;
+          double a = l->as.float_v;
+          double b = r->as.float_v;
+          PS_Value *res = NULL;
+          switch (ins->opcode) {
+            case IR_OP_ADD_F64: res = ps_make_float(ctx, a + b); break;
+            case IR_OP_SUB_F64: res = ps_make_float(ctx, a - b); break;
+            case IR_OP_MUL_F64: res = ps_make_float(ctx, a * b); break;
+            case IR_OP_DIV_F64: res = ps_make_float(ctx, a / b); break;
+            case IR_OP_LT_F64: res = ps_make_bool(ctx, a < b); break;
+            case IR_OP_LE_F64: res = ps_make_bool(ctx, a <= b); break;
+            case IR_OP_GT_F64: res = ps_make_bool(ctx, a > b); break;
+            default: res = ps_make_bool(ctx, a >= b); break;
+          }
+          if (!res) goto raise;
+          bindings_set(&temps, ins->dst, res);
+          ps_value_release(res);
+          continue;
+        }
+        case IR_OP_CHECK_ADD_I64:
+        case IR_OP_CHECK_SUB_I64: {
+          PS_Value *l = get_value(&temps, &vars, ins->left);
+          PS_Value *r = get_value(&temps, &vars, ins->right);
+          if (!l || !r || l->tag != PS_V_INT || r->tag != PS_V_INT) goto check_int_overflow_generic;
+          int64_t a = l->as.int_v;
+          int64_t b = r->as.int_v;
+          int overflow = ins->opcode == IR_OP_CHECK_ADD_I64
+                             ? ((b > 0 && a > INT64_MAX - b) || (b < 0 && a < INT64_MIN - b))
+                             : ((b < 0 && a > INT64_MAX + b) || (b > 0 && a < INT64_MIN + b));
+          if (overflow) {
+            ps_throw_diag(ctx, PS_ERR_RANGE, "int overflow", "value", "value within int range");
             goto raise;
           }
-        } else if (recv->tag == PS_V_LIST) {
-          if (strcmp(ins->method, "length") == 0) {
-            if (!expect_arity(ctx, ins, 0, 0)) goto raise;
-            PS_Value *v = ps_make_int(ctx, (int64_t)recv->as.list_v.len);
-            bindings_set(&temps, ins->dst, v);
-            ps_value_release(v);
-          } else if (strcmp(ins->method, "isEmpty") == 0) {
-            if (!expect_arity(ctx, ins, 0, 0)) goto raise;
-            PS_Value *v = ps_make_bool(ctx, recv->as.list_v.len == 0);
-            bindings_set(&temps, ins->dst, v);
-            ps_value_release(v);
-          } else if (strcmp(ins->method, "removeLast") == 0) {
-            if (!expect_arity(ctx, ins, 0, 0)) goto raise;
-            if (recv->as.list_v.len == 0) {
-              ps_throw_diag(ctx, PS_ERR_RANGE, "pop on empty list", "empty list", "non-empty list");
-              goto raise;
-            }
-            recv->as.list_v.len -= 1;
-            recv->as.list_v.version += 1;
-          } else if (strcmp(ins->method, "pop") == 0) {
-            if (!expect_arity(ctx, ins, 0, 0)) goto raise;
-            if (recv->as.list_v.len == 0) {
-              ps_throw_diag(ctx, PS_ERR_RANGE, "pop on empty list", "empty list", "non-empty list");
-              goto raise;
-            }
-            PS_Value *v = recv->as.list_v.items[recv->as.list_v.len - 1];
-            recv->as.list_v.len -= 1;
-            recv->as.list_v.version += 1;
-            bindings_set(&temps, ins->dst, v);
-          } else if (strcmp(ins->method, "push") == 0) {
-            if (!expect_arity(ctx, ins, 1, 1)) goto raise;
-            PS_Value *v = get_value(&temps, &vars, ins->args[0]);
-            if (!ps_list_push_internal(ctx, recv, v)) goto raise;
-            PS_Value *rv = ps_make_int(ctx, (int64_t)recv->as.list_v.len);
-            bindings_set(&temps, ins->dst, rv);
-            ps_value_release(rv);
-          } else if (strcmp(ins->method, "contains") == 0) {
-            if (!expect_arity(ctx, ins, 1, 1)) goto raise;
-            PS_Value *needle = get_value(&temps, &vars, ins->args[0]);
-            int found = 0;
-            for (size_t i = 0; i < recv->as.list_v.len; i++) {
-              if (values_equal(recv->as.list_v.items[i], needle)) {
-                found = 1;
-                break;
-              }
-            }
-            PS_Value *v = ps_make_bool(ctx, found);
-            bindings_set(&temps, ins->dst, v);
-            ps_value_release(v);
-          } else if (strcmp(ins->method, "reverse") == 0) {
-            if (!expect_arity(ctx, ins, 0, 0)) goto raise;
-            size_t n = recv->as.list_v.len;
-            for (size_t i = 0; i < n / 2; i++) {
-              size_t j = n - 1 - i;
-              PS_Value *tmp = recv->as.list_v.items[i];
-              recv->as.list_v.items[i] = recv->as.list_v.items[j];
-              recv->as.list_v.items[j] = tmp;
-            }
-            PS_Value *v = ps_make_int(ctx, (int64_t)recv->as.list_v.len);
-            bindings_set(&temps, ins->dst, v);
-            ps_value_release(v);
-          } else if (strcmp(ins->method, "sort") == 0) {
-            if (!expect_arity(ctx, ins, 0, 0)) goto raise;
-            size_t n = recv->as.list_v.len;
-            const char *elem_t = ins->type;
-            PS_ValueTag tag = PS_V_VOID;
-            const char *cmp_callee = NULL;
-            char cmp_buf[256];
-            if (!elem_t || elem_t[0] == '\0') {
-              ps_throw_diag(ctx, PS_ERR_TYPE, "list element not comparable", "unknown", "int|float|byte|string|prototype");
-              goto raise;
-            }
-            if (strcmp(elem_t, "int") == 0) tag = PS_V_INT;
-            else if (strcmp(elem_t, "float") == 0) tag = PS_V_FLOAT;
-            else if (strcmp(elem_t, "byte") == 0) tag = PS_V_BYTE;
-            else if (strcmp(elem_t, "string") == 0) tag = PS_V_STRING;
-            else if (proto_exists(m, elem_t)) {
-              tag = PS_V_OBJECT;
-              if (!resolve_compareto_callee(m, elem_t, cmp_buf, sizeof(cmp_buf))) {
-                ps_throw_diag(ctx, PS_ERR_TYPE, "list element not comparable", elem_t, "compareTo(T other) : int");
-                goto raise;
-              }
-              cmp_callee = cmp_buf;
-            } else {
-              ps_throw_diag(ctx, PS_ERR_TYPE, "list element not comparable", elem_t, "int|float|byte|string|prototype");
-              goto raise;
-            }
-            for (size_t i = 0; i < n; i++) {
-              PS_Value *it = recv->as.list_v.items[i];
-              if (!it || it->tag != tag) {
-                char got[64];
-                snprintf(got, sizeof(got), "%s", value_type_name(it));
-                ps_throw_diag(ctx, PS_ERR_TYPE, "list element not comparable", got, elem_t);
-                goto raise;
-              }
-            }
-            if (n > 1) {
-              if (!list_sort_values(ctx, m, recv->as.list_v.items, n, tag, cmp_callee)) goto raise;
-            }
-            PS_Value *v = ps_make_int(ctx, (int64_t)recv->as.list_v.len);
-            bindings_set(&temps, ins->dst, v);
-            ps_value_release(v);
-          } else if (strcmp(ins->method, "join") == 0) {
-            if (!expect_arity(ctx, ins, 1, 1)) goto raise;
-            size_t n = recv->as.list_v.len;
-            PS_Value *sepv = get_value(&temps, &vars, ins->args[0]);
-            if (sepv && sepv->tag != PS_V_STRING) {
-              char got[64];
-              snprintf(got, sizeof(got), "%s", value_type_name(sepv));
-              ps_throw_diag(ctx, PS_ERR_TYPE, "invalid join separator", got, "string");
-              goto raise;
-            }
-            size_t sep_len = sepv ? sepv->as.string_v.len : 0;
-            size_t total = 0;
-            for (size_t i = 0; i < n; i++) {
-              PS_Value *it = recv->as.list_v.items[i];
-              if (!it || it->tag != PS_V_STRING) {
-                char got[64];
-                snprintf(got, sizeof(got), "%s", value_type_name(it));
-                ps_throw_diag(ctx, PS_ERR_TYPE, "invalid join list element", got, "string");
-                goto raise;
-              }
-              total += it->as.string_v.len;
-            }
-            if (n > 1) total += sep_len * (n - 1);
-            char *buf = (char *)malloc(total + 1);
-            if (!buf && total > 0) {
-              ps_throw_diag(ctx, PS_ERR_OOM, "out of memory", "join buffer allocation failed", "available memory");
-              goto raise;
-            }
-            size_t off = 0;
-            for (size_t i = 0; i < n; i++) {
-              if (i > 0 && sep_len > 0) {
-                memcpy(buf + off, sepv->as.string_v.ptr, sep_len);
-                off += sep_len;
-              }
-              if (recv->as.list_v.items[i]->as.string_v.len > 0) {
-                memcpy(buf + off, recv->as.list_v.items[i]->as.string_v.ptr, recv->as.list_v.items[i]->as.string_v.len);
-                off += recv->as.list_v.items[i]->as.string_v.len;
-              }
-            }
-            if (buf) buf[off] = '\0';
-            PS_Value *out = ps_make_string_utf8(ctx, buf ? buf : "", off);
-            if (buf) free(buf);
-            if (!out) goto raise;
-            bindings_set(&temps, ins->dst, out);
-            ps_value_release(out);
-          } else if (strcmp(ins->method, "concat") == 0) {
-            if (!expect_arity(ctx, ins, 0, 0)) goto raise;
-            size_t n = recv->as.list_v.len;
-            size_t total = 0;
-            for (size_t i = 0; i < n; i++) {
-              PS_Value *it = recv->as.list_v.items[i];
-              if (!it || it->tag != PS_V_STRING) {
-                char got[64];
-                snprintf(got, sizeof(got), "%s", value_type_name(it));
-                ps_throw_diag(ctx, PS_ERR_TYPE, "invalid concat list element", got, "string");
-                goto raise;
-              }
-              total += it->as.string_v.len;
-            }
-            char *buf = (char *)malloc(total + 1);
-            if (!buf && total > 0) {
-              ps_throw_diag(ctx, PS_ERR_OOM, "out of memory", "concat buffer allocation failed", "available memory");
-              goto raise;
-            }
-            size_t off = 0;
-            for (size_t i = 0; i < n; i++) {
-              if (recv->as.list_v.items[i]->as.string_v.len > 0) {
-                memcpy(buf + off, recv->as.list_v.items[i]->as.string_v.ptr, recv->as.list_v.items[i]->as.string_v.len);
-                off += recv->as.list_v.items[i]->as.string_v.len;
-              }
-            }
-            if (buf) buf[off] = '\0';
-            PS_Value *out = ps_make_string_utf8(ctx, buf ? buf : "", off);
-            if (buf) free(buf);
-            if (!out) goto raise;
-            bindings_set(&temps, ins->dst, out);
-            ps_value_release(out);
-          } else if (strcmp(ins->method, "toUtf8String") == 0) {
-            if (!expect_arity(ctx, ins, 0, 0)) goto raise;
-            size_t n = recv->as.list_v.len;
-            uint8_t *buf = (uint8_t *)malloc(n);
-            if (!buf && n > 0) {
-              ps_throw_diag(ctx, PS_ERR_OOM, "out of memory", "UTF-8 buffer allocation failed", "available memory");
+          continue;
+        }
+        case IR_OP_LIST_GET: {
+          PS_Value *t = get_value(&temps, &vars, ins->target);
+          PS_Value *i = get_value(&temps, &vars, ins->index);
+          if (!t || !i || t->tag != PS_V_LIST || i->tag != PS_V_INT) goto index_get_generic;
+          PS_Value *res = ps_list_get_internal(ctx, t, (size_t)i->as.int_v);
+          if (!res) goto raise;
+          bindings_set(&temps, ins->dst, res);
+          continue;
+        }
+        case IR_OP_MAP_GET_STR: {
+          PS_Value *t = get_value(&temps, &vars, ins->target);
+          PS_Value *k = get_value(&temps, &vars, ins->index);
+          if (!t || !k || t->tag != PS_V_MAP || k->tag != PS_V_STRING) goto index_get_generic;
+          PS_Value *res = ps_map_get(ctx, t, k);
+          if (!res) goto raise;
+          bindings_set(&temps, ins->dst, res);
+          continue;
+        }
+        case IR_OP_BRANCH_ITER_HAS_NEXT_LIST: {
+          PS_Value *it = get_value(&temps, &vars, ins->iter);
+          if (!it || it->tag != PS_V_ITER || it->as.iter_v.source->tag != PS_V_LIST) goto branch_iter_has_next_generic;
+          block_idx = it->as.iter_v.index < it->as.iter_v.source->as.list_v.len ? ins->then_block : ins->else_block;
+          goto next_block;
+        }
+        case IR_OP_ITER_NEXT_LIST: {
+          PS_Value *it = get_value(&temps, &vars, ins->iter);
+          if (!it || it->tag != PS_V_ITER || it->as.iter_v.source->tag != PS_V_LIST) goto iter_next_generic;
+          PS_Value *res = it->as.iter_v.source->as.list_v.items[it->as.iter_v.index++];
+          if (!res) goto raise;
+          bindings_set(&temps, ins->dst, res);
+          continue;
+        }
+        case IR_OP_STRING_LEN: {
+          PS_Value *recv = get_value(&temps, &vars, ins->receiver);
+          if (!recv || recv->tag != PS_V_STRING) goto call_method_generic;
+          size_t gl = ps_utf8_glyph_len((const uint8_t *)recv->as.string_v.ptr, recv->as.string_v.len);
+          PS_Value *v = ps_make_int(ctx, (int64_t)gl);
+          if (!v) goto raise;
+          bindings_set(&temps, ins->dst, v);
+          ps_value_release(v);
+          continue;
+        }
+        case IR_OP_LIST_LEN: {
+          PS_Value *recv = get_value(&temps, &vars, ins->receiver);
+          if (!recv || recv->tag != PS_V_LIST) goto call_method_generic;
+          PS_Value *v = ps_make_int(ctx, (int64_t)recv->as.list_v.len);
+          if (!v) goto raise;
+          bindings_set(&temps, ins->dst, v);
+          ps_value_release(v);
+          continue;
+        }
+        case IR_OP_LIST_PUSH: {
+          PS_Value *recv = get_value(&temps, &vars, ins->receiver);
+          if (!recv || recv->tag != PS_V_LIST) goto call_method_generic;
+          PS_Value *moved = ins->move_src ? bindings_take(&temps, ins->args[0]) : NULL;
+          if (moved) {
+            if (!ps_list_push_owned_internal(ctx, recv, moved)) {
+              ps_value_release(moved);
               goto raise;
             }
-            for (size_t i = 0; i < n; i++) {
-              PS_Value *it = recv->as.list_v.items[i];
-              if (!it || (it->tag != PS_V_BYTE && it->tag != PS_V_INT)) {
-                free(buf);
-                {
-                  char got[64];
-                  snprintf(got, sizeof(got), "%s", value_type_name(it));
-                  ps_throw_diag(ctx, PS_ERR_TYPE, "invalid byte list element", got, "byte or int");
-                }
-                goto raise;
-              }
-              int64_t v = (it->tag == PS_V_BYTE) ? it->as.byte_v : it->as.int_v;
-              if (v < 0 || v > 255) {
-                free(buf);
-                {
-                  char got[32];
-                  snprintf(got, sizeof(got), "%lld", (long long)v);
-                  ps_throw_diag(ctx, PS_ERR_RANGE, "byte out of range", got, "0..255");
-                }
-                goto raise;
-              }
-              buf[i] = (uint8_t)v;
-            }
-            PS_Value *s = ps_make_string_utf8(ctx, (const char *)buf, n);
-            free(buf);
-            if (!s) goto raise;
-            bindings_set(&temps, ins->dst, s);
-            ps_value_release(s);
-          } else {
-            char got[96];
-            snprintf(got, sizeof(got), "%s", ins->method ? ins->method : "<unknown>");
-            ps_throw_diag(ctx, PS_ERR_TYPE, "unknown method", got, "valid list method");
+          } else if (!ps_list_push_internal(ctx, recv, get_value(&temps, &vars, ins->args[0]))) {
             goto raise;
           }
-        } else if (recv->tag == PS_V_MAP) {
-          if (strcmp(ins->method, "length") == 0) {
-            if (!expect_arity(ctx, ins, 0, 0)) goto raise;
-            PS_Value *v = ps_make_int(ctx, (int64_t)recv->as.map_v.len);
-            bindings_set(&temps, ins->dst, v);
-            ps_value_release(v);
-          } else if (strcmp(ins->method, "isEmpty") == 0) {
-            if (!expect_arity(ctx, ins, 0, 0)) goto raise;
-            PS_Value *v = ps_make_bool(ctx, recv->as.map_v.len == 0);
-            bindings_set(&temps, ins->dst, v);
-            ps_value_release(v);
-          } else if (strcmp(ins->method, "containsKey") == 0) {
-            if (!expect_arity(ctx, ins, 1, 1)) goto raise;
-            PS_Value *key = get_value(&temps, &vars, ins->args[0]);
-            if (recv->as.map_v.len > 0) {
-              PS_Value *first = map_first_key(recv);
-              if (first && key && first->tag != key->tag) {
-                char got[64];
-                char expected[64];
-                snprintf(got, sizeof(got), "%s", value_type_name(key));
-                snprintf(expected, sizeof(expected), "key of type %s", value_type_name(first));
-                ps_throw_diag(ctx, PS_ERR_TYPE, "map key type mismatch", got, expected);
-                goto raise;
-              }
-            }
-            int ok = ps_map_has_key(ctx, recv, key);
-            if (ps_last_error_code(ctx) != PS_ERR_NONE) goto raise;
-            PS_Value *v = ps_make_bool(ctx, ok);
-            bindings_set(&temps, ins->dst, v);
-            ps_value_release(v);
-          } else if (strcmp(ins->method, "remove") == 0) {
-            if (!expect_arity(ctx, ins, 1, 1)) goto raise;
-            PS_Value *key = get_value(&temps, &vars, ins->args[0]);
-            if (recv->as.map_v.len > 0) {
-              PS_Value *first = map_first_key(recv);
-              if (first && key && first->tag != key->tag) {
-                char got[64];
-                char expected[64];
-                snprintf(got, sizeof(got), "%s", value_type_name(key));
-                snprintf(expected, sizeof(expected), "key of type %s", value_type_name(first));
-                ps_throw_diag(ctx, PS_ERR_TYPE, "map key type mismatch", got, expected);
-                goto raise;
-              }
-            }
-            int ok = ps_map_remove(ctx, recv, key);
-            if (ps_last_error_code(ctx) != PS_ERR_NONE) goto raise;
-            PS_Value *v = ps_make_bool(ctx, ok);
-            bindings_set(&temps, ins->dst, v);
-            ps_value_release(v);
-          } else if (strcmp(ins->method, "keys") == 0) {
-            if (!expect_arity(ctx, ins, 0, 0)) goto raise;
-            PS_Value *out = ps_list_new(ctx);
-            if (!out) goto raise;
-            PS_Map *m = &recv->as.map_v;
-            for (size_t i = 0; i < m->order_len; i++) {
-              if (!ps_list_push_internal(ctx, out, m->order[i])) {
-                ps_value_release(out);
-                goto raise;
-              }
-            }
-            bindings_set(&temps, ins->dst, out);
-            ps_value_release(out);
-          } else if (strcmp(ins->method, "values") == 0) {
-            if (!expect_arity(ctx, ins, 0, 0)) goto raise;
-            PS_Value *out = ps_list_new(ctx);
-            if (!out) goto raise;
-            PS_Map *m = &recv->as.map_v;
-            for (size_t i = 0; i < m->order_len; i++) {
-              PS_Value *v = ps_map_get(ctx, recv, m->order[i]);
-              if (ps_last_error_code(ctx) != PS_ERR_NONE) {
-                ps_value_release(out);
-                goto raise;
-              }
-              if (!ps_list_push_internal(ctx, out, v)) {
-                ps_value_release(out);
-                goto raise;
-              }
-            }
-            bindings_set(&temps, ins->dst, out);
-            ps_value_release(out);
-          } else {
-            char got[96];
-            snprintf(got, sizeof(got), "%s", ins->method ? ins->method : "<unknown>");
-            ps_throw_diag(ctx, PS_ERR_TYPE, "unknown method", got, "valid map method");
-            goto raise;
+          PS_Value *rv = ps_make_int(ctx, (int64_t)recv->as.list_v.len);
+          if (!rv) goto raise;
+          bindings_set(&temps, ins->dst, rv);
+          ps_value_release(rv);
+          continue;
+        }
+        case IR_OP_INC_LOCAL_CHECKED:
+        case IR_OP_ADD_LOCAL_CHECKED:
+        case IR_OP_SUB_LOCAL_CHECKED: {
+          // On a guard miss or an overflow, run the original sequence so the
+          // error is raised by its own check instruction.
+          PS_Value *v = bindings_get(&vars, ins->name);
+          if (!v || v->tag != PS_V_INT) {
+            op = ins->opcode;
+            goto dispatch;
           }
-        } else if (recv->tag == PS_V_VIEW) {
-          if (strcmp(ins->method, "length") == 0) {
-            if (!expect_arity(ctx, ins, 0, 0)) goto raise;
-            if (!view_is_valid(recv)) {
-              ps_throw_diag(ctx, PS_ERR_RANGE, "view invalidated", "invalidated view", "valid view");
-              goto raise;
-            }
-            PS_Value *v = ps_make_int(ctx, (int64_t)recv->as.view_v.len);
-            bindings_set(&temps, ins->dst, v);
-            ps_value_release(v);
-          } else if (strcmp(ins->method, "isEmpty") == 0) {
-            if (!expect_arity(ctx, ins, 0, 0)) goto raise;
-            if (!view_is_valid(recv)) {
-              ps_throw_diag(ctx, PS_ERR_RANGE, "view invalidated", "invalidated view", "valid view");
-              goto raise;
+          int64_t a = v->as.int_v;
+          int64_t d = ins->imm;
+          int sub = 0;
+          if (op != IR_OP_INC_LOCAL_CHECKED) {
+            PS_Value *rv = bindings_get(&vars, ins->aux);
+            if (!rv || rv->tag != PS_V_INT) {
+              op = ins->opcode;
+              goto dispatch;
             }
-            PS_Value *v = ps_make_bool(ctx, recv->as.view_v.len == 0);
-            bindings_set(&temps, ins->dst, v);
-            ps_value_release(v);
-          } else {
-            char got[96];
-            snprintf(got, sizeof(got), "%s", ins->method ? ins->method : "<unknown>");
-            ps_throw_diag(ctx, PS_ERR_TYPE, "unknown method", got, "valid view method");
-            goto raise;
+            d = rv->as.int_v;
+            sub = op == IR_OP_SUB_LOCAL_CHECKED;
           }
-        } else if (recv->tag == PS_V_BYTES) {
-          if (strcmp(ins->method, "toUtf8String") == 0) {
-            if (!expect_arity(ctx, ins, 0, 0)) goto raise;
-            PS_Value *v = ps_bytes_to_utf8_string(ctx, recv);
-            if (!v) goto raise;
-            bindings_set(&temps, ins->dst, v);
-            ps_value_release(v);
-          } else {
-            char got[96];
-            snprintf(got, sizeof(got), "%s", ins->method ? ins->method : "<unknown>");
-            ps_throw_diag(ctx, PS_ERR_TYPE, "unknown method", got, "valid bytes method");
-            goto raise;
+          int overflow = sub ? ((d < 0 && a > INT64_MAX + d) || (d > 0 && a < INT64_MIN + d))
+                             : ((d > 0 && a > INT64_MAX - d) || (d < 0 && a < INT64_MIN - d));
+          if (overflow) {
+            op = ins->opcode;
+            goto dispatch;
           }
+          PS_Value *res = ps_make_int(ctx, sub ? a - d : a + d);
+          if (!res) goto raise;
+          bindings_set(&vars, ins->name, res);
+          ps_value_release(res);
+          ip += ins->fused_len - 1;
+          continue;
         }
-        continue;
-      }
-      if (strcmp(ins->op, "call_builtin_print") == 0) {
-        if (ins->arg_count > 0) {
-          PS_Value *v = get_value(&temps, &vars, ins->args[0]);
-          if (v && v->tag == PS_V_STRING) {
-            fwrite(v->as.string_v.ptr, 1, v->as.string_v.len, stdout);
-            fputc('\n', stdout);
+        case IR_OP_CMP_BRANCH_EQ_I64:
+        case IR_OP_CMP_BRANCH_NE_I64:
+        case IR_OP_CMP_BRANCH_LT_I64:
+        case IR_OP_CMP_BRANCH_LE_I64:
+        case IR_OP_CMP_BRANCH_GT_I64:
+        case IR_OP_CMP_BRANCH_GE_I64: {
+          PS_Value *l = get_value(&temps, &vars, ins->left);
+          PS_Value *r = get_value(&temps, &vars, ins->right);
+          if (!l || !r || l->tag != PS_V_INT || r->tag != PS_V_INT) {
+            op = ins->opcode;
+            goto dispatch;
           }
-        } else {
-          fputc('\n', stdout);
-        }
-        continue;
-      }
-      if (strcmp(ins->op, "call_builtin_tostring") == 0) {
-        PS_Value *v = get_value(&temps, &vars, ins->value);
-        PS_Value *s = NULL;
-        if (v->tag == PS_V_STRING) s = ps_value_retain(v);
-        else if (v->tag == PS_V_INT) {
-          char buf[64];
-          snprintf(buf, sizeof(buf), "%lld", (long long)v->as.int_v);
-          s = ps_make_string_utf8(ctx, buf, strlen(buf));
-        } else if (v->tag == PS_V_BYTE) {
-          char buf[64];
-          snprintf(buf, sizeof(buf), "%u", (unsigned)v->as.byte_v);
-          s = ps_make_string_utf8(ctx, buf, strlen(buf));
-        } else if (v->tag == PS_V_GLYPH) {
-          uint8_t buf[4];
-          size_t n = 0;
-          if (!glyph_to_utf8(v->as.glyph_v, buf, &n)) {
-            char got[64];
-            snprintf(got, sizeof(got), "U+%04X", (unsigned)v->as.glyph_v);
-            ps_throw_diag(ctx, PS_ERR_UTF8, "invalid UTF-8", got, "valid Unicode scalar");
-            goto raise;
+          int64_t a = l->as.int_v;
+          int64_t b = r->as.int_v;
+          int c = 0;
+          switch (op) {
+            case IR_OP_CMP_BRANCH_EQ_I64: c = a == b; break;
+            case IR_OP_CMP_BRANCH_NE_I64: c = a != b; break;
+            case IR_OP_CMP_BRANCH_LT_I64: c = a < b; break;
+            case IR_OP_CMP_BRANCH_LE_I64: c = a <= b; break;
+            case IR_OP_CMP_BRANCH_GT_I64: c = a > b; break;
+            default: c = a >= b; break;
           }
-          s = ps_make_string_utf8(ctx, (const char *)buf, n);
-        } else if (v->tag == PS_V_FLOAT) {
-          char buf[64];
-          format_float_shortest(v->as.float_v, buf, sizeof(buf));
-          s = ps_make_string_utf8(ctx, buf, strlen(buf));
-        } else if (v->tag == PS_V_BOOL) {
-          const char *t = v->as.bool_v ? "true" : "false";
-          s = ps_make_string_utf8(ctx, t, strlen(t));
-        } else {
-          s = ps_make_string_utf8(ctx, "<value>", 7);
-        }
-        bindings_set(&temps, ins->dst, s);
-        ps_value_release(s);
-        continue;
-      }
-      if (strcmp(ins->op, "jump") == 0) {
-        block_idx = find_block(f, ins->target);
-        goto next_block;
-      }
-      if (strcmp(ins->op, "branch_if") == 0) {
-        PS_Value *c = get_value(&temps, &vars, ins->cond);
-        block_idx = find_block(f, is_truthy(c) ? ins->then_label : ins->else_label);
-        goto next_block;
-      }
-      if (strcmp(ins->op, "ret") == 0) {
-        PS_Value *v = get_value(&temps, &vars, ins->value);
-        if (out) *out = v ? ps_value_retain(v) : NULL;
-        bindings_free(&temps);
-        bindings_free(&vars);
-        if (last_exception) ps_value_release(last_exception);
-        free(tries);
-        return 0;
-      }
-      if (strcmp(ins->op, "ret_void") == 0) {
-        bindings_free(&temps);
-        bindings_free(&vars);
-        if (last_exception) ps_value_release(last_exception);
-        free(tries);
-        return 0;
-      }
-      if (strcmp(ins->op, "throw") == 0) {
-        PS_Value *v = get_value(&temps, &vars, ins->value);
-        if (!v || v->tag != PS_V_EXCEPTION) {
-          char got[64];
-          snprintf(got, sizeof(got), "%s", value_type_name(v));
-          ps_throw_diag(ctx, PS_ERR_TYPE, "throw expects Exception", got, "Exception");
-          goto raise;
+          block_idx = c ? ins->then_block : ins->else_block;
+          goto next_block;
         }
-        if (ins->file || ins->line || ins->col) {
-          set_exception_location(ctx, v, ins->file, ins->line, ins->col);
+        case IR_OP_FOR_OF_LIST_NEXT: {
+          PS_Value *it = get_value(&temps, &vars, ins->iter);
+          if (!it || it->tag != PS_V_ITER || it->as.iter_v.source->tag != PS_V_LIST) {
+            op = ins->opcode;
+            goto dispatch;
+          }
+          PS_Value *src = it->as.iter_v.source;
+          if (it->as.iter_v.index >= src->as.list_v.len) {
+            block_idx = ins->else_block;
+            goto next_block;
+          }
+          PS_Value *item = src->as.list_v.items[it->as.iter_v.index];
+          if (!item) {
+            op = ins->opcode;
+            goto dispatch;
+          }
+          it->as.iter_v.index += 1;
+          bindings_set(&temps, ins->aux, item);
+          // The body's leading iter_next_list has been done here.
+          block_idx = ins->then_block;
+          entry_ip = 1;
+          goto next_block;
         }
-        if (last_exception) ps_value_release(last_exception);
-        last_exception = ps_value_retain(v);
-        goto raise;
+        default:
+          break;
       }
     }
     block_idx += 1;
   next_block:
+    if (samp) ps_sampler_poll(samp);
+    if (ctx->heap.free_budget) ps_value_drain(ctx->heap.free_budget);
+    if (ctx->heap.gc_threshold) ps_heap_poll_gc(ctx);
+    if (ctx->heap.max_bytes && !ps_heap_check(ctx)) {
+      // Raised at the entry of the next block, under its handler.
+      ip = 0;
+      entry_ip = 0;
+      goto raise;
+    }
     continue;
   }
   bindings_free(&temps);
   bindings_free(&vars);
   if (last_exception) ps_value_release(last_exception);
-  free(tries);
   return 0;
 
 raise:
@@ -3722,12 +5104,14 @@ raise:
       set_exception_location(ctx, last_exception, cur_file, cur_line, cur_col);
     }
   }
-  if (try_len > 0) {
-    const char *handler = tries[try_len - 1].handler;
-    try_len -= 1;
-    ps_clear_error(ctx);
-    block_idx = find_block(f, handler);
-    if (block_idx < f->block_count) goto next_block;
+  {
+    const IRBlock *rb = block_idx < f->block_count ? &f->blocks[block_idx] : NULL;
+    size_t handler = rb && ip < rb->instr_count ? rb->instrs[ip].handler : 0;
+    if (handler) {
+      ps_clear_error(ctx);
+      block_idx = handler - 1;
+      goto next_block;
+    }
   }
   goto error;
 
@@ -3740,10 +5124,20 @@ error:
   bindings_free(&temps);
   bindings_free(&vars);
   if (last_exception) ps_value_release(last_exception);
-  free(tries);
   return 1;
 }
 
+static int exec_function(PS_Context *ctx, PS_IR_Module *m, IRFunction *f, PS_Value **args, size_t argc, PS_Value **out) {
+  PS_Profile *prof = ctx->profile;
+  PS_Sampler *samp = ctx->sampler;
+  if (prof) ps_profile_enter(prof, f->name);
+  if (samp) ps_sampler_push(samp, f->name);
+  int rc = exec_frame(ctx, m, f, args, argc, out);
+  if (samp) ps_sampler_pop(samp);
+  if (prof) ps_profile_leave(prof);
+  return rc;
+}
+
 int ps_vm_run_main(PS_Context *ctx, PS_IR_Module *m, PS_Value **args, size_t argc, PS_Value **out) {
   if (ctx->last_exception) {
     ps_value_release(ctx->last_exception);
@@ -3763,12 +5157,11 @@ int ps_vm_run_main(PS_Context *ctx, PS_IR_Module *m, PS_Value **args, size_t arg
     ctx->current_module = NULL;
     return 1;
   }
-  if (main_fn->param_count == 1) {
-    int rc = exec_function(ctx, m, main_fn, args, argc, out);
-    ctx->current_module = NULL;
-    return rc;
-  }
-  int rc = exec_function(ctx, m, main_fn, NULL, 0, out);
+  // The sampler is drained before returning: its samples name IR strings of `m`.
+  if (ctx->sampler) ps_sampler_start(ctx->sampler);
+  int rc = main_fn->param_count == 1 ? exec_function(ctx, m, main_fn, args, argc, out)
+                                     : exec_function(ctx, m, main_fn, NULL, 0, out);
+  if (ctx->sampler) ps_sampler_stop(ctx->sampler);
   ctx->current_module = NULL;
   return rc;
 }
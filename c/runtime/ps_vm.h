@@ -6,7 +6,11 @@
 typedef struct PS_IR_Module PS_IR_Module;
 
 PS_IR_Module *ps_ir_load_json(PS_Context *ctx, const char *json, size_t len);
+// Same, but parses `json` in place (it is clobbered); the caller frees it after the call.
+PS_IR_Module *ps_ir_load_json_insitu(PS_Context *ctx, char *json, size_t len);
 void ps_ir_free(PS_IR_Module *m);
+// Number of IR instructions in the loaded module.
+size_t ps_ir_instr_count(const PS_IR_Module *m);
 
 // Execute module entry function "main". Returns 0 on success, non-zero on runtime error.
 int ps_vm_run_main(PS_Context *ctx, PS_IR_Module *m, PS_Value **args, size_t argc, PS_Value **out);
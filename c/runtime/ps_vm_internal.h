@@ -5,14 +5,16 @@
 
 #include "ps_vm.h"
 
+// Type and prototype names of the IR are interned (ps_intern) at load: they
+// are shared with the values built from them and compared by pointer.
 typedef struct {
   char *name;
-  char *type;
+  const char *type;
 } PS_IR_Field;
 
 typedef struct {
   char *name;
-  char *type;
+  const char *type;
   int variadic;
 } PS_IR_Param;
 
@@ -20,7 +22,7 @@ typedef struct {
   char *name;
   PS_IR_Param *params;
   size_t param_count;
-  char *ret_type;
+  const char *ret_type;
 } PS_IR_Method;
 
 typedef struct PS_IR_GroupMember {
@@ -31,14 +33,14 @@ typedef struct PS_IR_GroupMember {
 
 typedef struct PS_IR_Group {
   char *name;
-  char *base_type;
+  const char *base_type;
   PS_IR_GroupMember *members;
   size_t member_count;
 } PS_IR_Group;
 
 typedef struct {
-  char *name;
-  char *parent;
+  const char *name;
+  const char *parent;
   PS_IR_Field *fields;
   size_t field_count;
   PS_IR_Method *methods;
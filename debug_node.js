@@ -48,6 +48,10 @@ function isFsWalker(v) {
   return v && v.__fs_walker === true;
 }
 
+function isJsonReader(v) {
+  return v && v.__json_reader === true;
+}
+
 function unmapKey(k) {
   if (typeof k !== "string") return k;
   if (k.startsWith("i:")) return BigInt(k.slice(2));
@@ -111,6 +115,7 @@ function inferTypeOfValue(v) {
   if (isBinaryFile(v)) return "BinaryFile";
   if (isFsDir(v)) return "Dir";
   if (isFsWalker(v)) return "Walker";
+  if (isJsonReader(v)) return "JSONReader";
   if (isObjectInstance(v)) return v.__proto || "object";
   return "unknown";
 }
@@ -289,7 +294,8 @@ function dump(value, opts = {}) {
       isTextFile(v) ||
       isBinaryFile(v) ||
       isFsDir(v) ||
-      isFsWalker(v)
+      isFsWalker(v) ||
+      isJsonReader(v)
     );
   };
 
@@ -451,6 +457,10 @@ function dump(value, opts = {}) {
       write("object<Walker>");
       return;
     }
+    if (isJsonReader(v)) {
+      write("object<JSONReader>");
+      return;
+    }
     dumpScalar(v, expectedType);
   };
 
@@ -595,7 +605,8 @@ function dump(value, opts = {}) {
       isTextFile(v) ||
       isBinaryFile(v) ||
       isFsDir(v) ||
-      isFsWalker(v)
+      isFsWalker(v) ||
+      isJsonReader(v)
     ) {
       const protoName = isJsonValue(v)
         ? "JSONValue"
@@ -609,7 +620,9 @@ function dump(value, opts = {}) {
                 ? "BinaryFile"
                 : isFsDir(v)
                   ? "Dir"
-                  : "Walker";
+                  : isFsWalker(v)
+                    ? "Walker"
+                    : "JSONReader";
       write(`object<${protoName}> {`);
       if (depth >= maxDepth) {
         write("\n");
@@ -131,6 +131,51 @@ PS_Status ps_module_init(PS_Context *ctx, PS_Module *out);
 PS_Context *ps_ctx_create(void);
 void ps_ctx_destroy(PS_Context *ctx);
 
+// Per-context state of a native module, stored under `key` (the module name
+// by convention). `free_fn` (optional) runs at ps_ctx_destroy, before module
+// libraries are closed. Setting a key again replaces the pointer; the previous
+// one is not freed. ps_ctx_get_module_data returns NULL for an unknown key.
+typedef void (*PS_ModuleDataFreeFn)(void *data);
+PS_Status ps_ctx_set_module_data(PS_Context *ctx, const char *key, void *data, PS_ModuleDataFreeFn free_fn);
+void *ps_ctx_get_module_data(PS_Context *ctx, const char *key);
+
+// Heap accounting of a context: live values and the bytes the runtime asked
+// from malloc for them (value headers, string/bytes buffers, container
+// tables). Each value is charged to the context that created it.
+typedef struct {
+  size_t live_values;
+  size_t peak_values;
+  size_t live_bytes;
+  size_t peak_bytes;
+  size_t max_bytes; // memory limit, 0 = unlimited
+  size_t value_bytes;
+  size_t string_bytes;
+  size_t bytes_bytes;
+  size_t list_bytes;
+  size_t object_bytes;
+  size_t map_bytes;
+  size_t values_by_type[PS_T_VOID + 1]; // by ps_typeof(); PS_T_VOID: views, iterators
+  size_t gc_runs;      // cycle collections so far
+  size_t gc_collected; // values freed by the cycle collector
+} PS_HeapStats;
+
+void ps_heap_stats(PS_Context *ctx, PS_HeapStats *out);
+// Hard memory limit in bytes (0 = unlimited). Allocations past it raise a
+// catchable out-of-memory runtime error (R1014 RUNTIME_OUT_OF_MEMORY).
+void ps_heap_set_limit(PS_Context *ctx, size_t max_bytes);
+// Backup cycle collector for reference cycles through lists, maps and objects
+// (0 = disabled). When enabled, a collection runs between VM blocks once
+// max(`threshold`, live values) values have been allocated since the previous
+// one, and at context teardown.
+void ps_heap_set_gc(PS_Context *ctx, size_t threshold);
+// Immediate cycle collection; returns the number of values freed.
+size_t ps_heap_collect(PS_Context *ctx);
+// Deferred destruction: values whose refcount drops to zero are destroyed at
+// most `values_per_poll` at a time between VM blocks (and one per allocation),
+// which bounds the pause of releasing a large structure. 0 (the default)
+// destroys them at once; switching back to 0 destroys the backlog.
+void ps_heap_set_free_budget(PS_Context *ctx, size_t values_per_poll);
+
 // Error handling (native modules).
 PS_ErrorCode ps_last_error_code(PS_Context *ctx);
 const char *ps_last_error_message(PS_Context *ctx);
@@ -157,12 +202,55 @@ PS_Value *ps_make_float(PS_Context *ctx, double value);
 PS_Value *ps_make_byte(PS_Context *ctx, uint8_t value);
 PS_Value *ps_make_glyph(PS_Context *ctx, uint32_t value);
 PS_Value *ps_make_string_utf8(PS_Context *ctx, const char *utf8, size_t len);
+// Same, taking ownership of `utf8`: a malloc'd buffer of at least len + 1
+// bytes that becomes the string buffer without a copy. The content must already
+// be valid UTF-8 (it is not checked again); the buffer is freed on failure.
+PS_Value *ps_make_string_utf8_owned(PS_Context *ctx, char *utf8, size_t len);
 PS_Value *ps_make_bytes(PS_Context *ctx, const uint8_t *bytes, size_t len);
 PS_Value *ps_make_list(PS_Context *ctx);
 PS_Value *ps_make_map(PS_Context *ctx);
 PS_Value *ps_make_object(PS_Context *ctx);
 PS_Value *ps_make_file(PS_Context *ctx, FILE *fp, uint32_t flags, const char *path);
 PS_Status ps_object_set_proto_name(PS_Context *ctx, PS_Value *obj, const char *name);
+// Field layout of a prototype of the running program: fields in declaration
+// order, inherited fields first. Types are spelled as in the IR (for example
+// "list < int >"; spaces are not significant). Both return 0 when `proto`
+// names no prototype of the program or `index` is out of range.
+int ps_proto_field_count(PS_Context *ctx, const char *proto, size_t *out_count);
+int ps_proto_field_at(PS_Context *ctx, const char *proto, size_t index, const char **out_name,
+                      const char **out_type);
+// Writes `len` bytes at the current position of a writable File (UTF-8 text
+// for a TextFile). Raises the io exceptions of File.write (FileClosedException,
+// WriteFailureException).
+PS_Status ps_file_write(PS_Context *ctx, PS_Value *file, const void *data, size_t len);
+// Reads up to `cap` raw bytes from the current position of a readable File;
+// *out_len is 0 at end of file. Raises the io exceptions of File.read.
+PS_Status ps_file_read(PS_Context *ctx, PS_Value *file, void *buf, size_t cap, size_t *out_len);
+
+// JSON values (JSONValue). A JSON node is a compact native value: its kind
+// and payload, no object table. Bools and numbers are stored inline; strings,
+// arrays (list<JSONValue>) and objects (map<string,JSONValue>) are retained.
+// ps_typeof reports PS_T_OBJECT.
+typedef enum {
+  PS_JSON_KIND_NULL,
+  PS_JSON_KIND_BOOL,
+  PS_JSON_KIND_NUMBER,
+  PS_JSON_KIND_STRING,
+  PS_JSON_KIND_ARRAY,
+  PS_JSON_KIND_OBJECT
+} PS_JsonKind;
+
+PS_Value *ps_make_json_null(PS_Context *ctx);
+PS_Value *ps_make_json_bool(PS_Context *ctx, int value);
+PS_Value *ps_make_json_number(PS_Context *ctx, double value);
+// kind STRING, ARRAY or OBJECT with a string, list or map payload (retained).
+PS_Value *ps_make_json(PS_Context *ctx, PS_JsonKind kind, PS_Value *payload);
+// 1 if v is a JSON node, its kind in *out_kind (optional).
+int ps_json_kind(PS_Value *v, PS_JsonKind *out_kind);
+int ps_json_bool(PS_Value *v);
+double ps_json_number(PS_Value *v);
+// String, list or map payload (borrowed), NULL for the other kinds.
+PS_Value *ps_json_payload(PS_Value *v);
 
 // Accessors (do not transfer ownership).
 int ps_as_bool(PS_Value *v);
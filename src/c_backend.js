@@ -108,6 +108,8 @@ function cScalarType(typeName) {
       return "ps_fs_dir*";
     case "Walker":
       return "ps_fs_walker*";
+    case "JSONReader":
+      return "ps_json_reader*";
     case "RegExp":
       return "RegExp*";
     case "RegExpMatch":
@@ -280,6 +282,14 @@ function inferTempTypes(ir, protoMap) {
                 set(i.dst, "PathEntry");
               } else if (i.callee === "Fs.__walker_close") {
                 set(i.dst, "void");
+              } else if (i.callee === "JSON.__reader_hasNext") {
+                set(i.dst, "bool");
+              } else if (i.callee === "JSON.__reader_next" || i.callee === "JSON.__reader_value") {
+                set(i.dst, "JSONValue");
+              } else if (i.callee === "JSON.__reader_nextEvent" || i.callee === "JSON.__reader_key") {
+                set(i.dst, "string");
+              } else if (i.callee === "JSON.__reader_close") {
+                set(i.dst, "void");
               } else if (fnRet.has(i.callee)) set(i.dst, fnRet.get(i.callee));
               else if (MODULE_RETURNS.has(i.callee)) set(i.dst, MODULE_RETURNS.get(i.callee));
               else if (i.callee === "Exception") set(i.dst, "Exception");
@@ -904,6 +914,7 @@ function emitRuntimeHelpers(protoMap) {
   }
   return [
     "static ps_exception ps_runtime_exception;",
+    "static char ps_runtime_exception_msg[1024];",
     "static ps_exception* ps_last_exception = NULL;",
     "static jmp_buf ps_try_stack[64];",
     "static int ps_try_len = 0;",
@@ -930,13 +941,20 @@ function emitRuntimeHelpers(protoMap) {
     "  if (ex->line <= 1) ex->line = ps_rt_line;",
     "  if (ex->column <= 1) ex->column = ps_rt_col;",
     "}",
+    "// Runtime messages are often formatted on the raiser's stack: keep a copy that",
+    "// outlives the longjmp to the handler.",
+    "static ps_string ps_runtime_message(const char* msg) {",
+    "  if (!msg) msg = \"\";",
+    "  if (msg != ps_runtime_exception_msg) snprintf(ps_runtime_exception_msg, sizeof(ps_runtime_exception_msg), \"%s\", msg);",
+    "  return ps_cstr(ps_runtime_exception_msg);",
+    "}",
     "static void ps_set_exception(const char* code, const char* category, const char* msg, int is_runtime) {",
     "  ps_runtime_exception.type = \"RuntimeException\";",
     "  ps_runtime_exception.parent = \"Exception\";",
     "  ps_runtime_exception.file = ps_cstr(ps_rt_file);",
     "  ps_runtime_exception.line = ps_rt_line;",
     "  ps_runtime_exception.column = ps_rt_col;",
-    "  ps_runtime_exception.message = ps_cstr(msg);",
+    "  ps_runtime_exception.message = ps_runtime_message(msg);",
     "  ps_runtime_exception.cause = NULL;",
     "  ps_runtime_exception.code = ps_cstr(code ? code : \"\");",
     "  ps_runtime_exception.category = ps_cstr(category ? category : \"\");",
@@ -949,7 +967,7 @@ function emitRuntimeHelpers(protoMap) {
     "  ps_runtime_exception.file = ps_cstr(ps_rt_file);",
     "  ps_runtime_exception.line = ps_rt_line;",
     "  ps_runtime_exception.column = ps_rt_col;",
-    "  ps_runtime_exception.message = ps_cstr(msg ? msg : \"\");",
+    "  ps_runtime_exception.message = ps_runtime_message(msg);",
     "  ps_runtime_exception.cause = NULL;",
     "  ps_runtime_exception.code = ps_cstr(\"\");",
     "  ps_runtime_exception.category = ps_cstr(\"\");",
@@ -1514,11 +1532,15 @@ function emitRuntimeHelpers(protoMap) {
     "static bool ps_json_is_string(ps_jsonvalue v) { return v.kind == PS_JSON_STRING; }",
     "static bool ps_json_is_array(ps_jsonvalue v) { return v.kind == PS_JSON_ARRAY; }",
     "static bool ps_json_is_object(ps_jsonvalue v) { return v.kind == PS_JSON_OBJECT; }",
-    "static bool ps_json_as_bool(ps_jsonvalue v) { if (v.kind != PS_JSON_BOOL) ps_panic(\"R1010\", \"RUNTIME_TYPE_ERROR\", \"not a bool\"); return v.b; }",
-    "static double ps_json_as_number(ps_jsonvalue v) { if (v.kind != PS_JSON_NUMBER) ps_panic(\"R1010\", \"RUNTIME_TYPE_ERROR\", \"not a number\"); return v.num; }",
-    "static ps_string ps_json_as_string(ps_jsonvalue v) { if (v.kind != PS_JSON_STRING) ps_panic(\"R1010\", \"RUNTIME_TYPE_ERROR\", \"not a string\"); return v.str; }",
-    "static ps_list_JSONValue ps_json_as_array(ps_jsonvalue v) { if (v.kind != PS_JSON_ARRAY) ps_panic(\"R1010\", \"RUNTIME_TYPE_ERROR\", \"not an array\"); return ps_json_array_snapshot(v.arr); }",
-    "static ps_map_string_JSONValue ps_json_as_object(ps_jsonvalue v) { if (v.kind != PS_JSON_OBJECT) ps_panic(\"R1010\", \"RUNTIME_TYPE_ERROR\", \"not an object\"); return ps_json_object_snapshot(v.obj); }",
+    "static const char* ps_json_kind_name(ps_jsonvalue v) {",
+    "  static const char* names[] = { \"null\", \"bool\", \"number\", \"string\", \"array\", \"object\" };",
+    "  return (unsigned)v.kind < 6 ? names[v.kind] : \"unknown\";",
+    "}",
+    "static bool ps_json_as_bool(ps_jsonvalue v) { if (v.kind != PS_JSON_BOOL) ps_panic_diag(\"R1010\", \"RUNTIME_JSON_ERROR\", \"invalid JsonBool access\", ps_json_kind_name(v), \"JsonBool\"); return v.b; }",
+    "static double ps_json_as_number(ps_jsonvalue v) { if (v.kind != PS_JSON_NUMBER) ps_panic_diag(\"R1010\", \"RUNTIME_JSON_ERROR\", \"invalid JsonNumber access\", ps_json_kind_name(v), \"JsonNumber\"); return v.num; }",
+    "static ps_string ps_json_as_string(ps_jsonvalue v) { if (v.kind != PS_JSON_STRING) ps_panic_diag(\"R1010\", \"RUNTIME_JSON_ERROR\", \"invalid JsonString access\", ps_json_kind_name(v), \"JsonString\"); return v.str; }",
+    "static ps_list_JSONValue ps_json_as_array(ps_jsonvalue v) { if (v.kind != PS_JSON_ARRAY) ps_panic_diag(\"R1010\", \"RUNTIME_JSON_ERROR\", \"invalid JsonArray access\", ps_json_kind_name(v), \"JsonArray\"); return ps_json_array_snapshot(v.arr); }",
+    "static ps_map_string_JSONValue ps_json_as_object(ps_jsonvalue v) { if (v.kind != PS_JSON_OBJECT) ps_panic_diag(\"R1010\", \"RUNTIME_JSON_ERROR\", \"invalid JsonObject access\", ps_json_kind_name(v), \"JsonObject\"); return ps_json_object_snapshot(v.obj); }",
     "static void ps_map_set_string_JSONValue(ps_map_string_JSONValue* m, ps_string key, ps_jsonvalue value);",
     "typedef struct { const char* s; size_t len; size_t i; } ps_json_parser;",
     "static void ps_json_skip_ws(ps_json_parser* p) {",
@@ -1680,13 +1702,23 @@ function emitRuntimeHelpers(protoMap) {
     "static ps_jsonvalue ps_json_parse_number(ps_json_parser* p, int* ok) {",
     "  size_t start = p->i;",
     "  if (p->s[p->i] == '-') p->i += 1;",
+    "  size_t int_start = p->i;",
     "  while (p->i < p->len && (p->s[p->i] >= '0' && p->s[p->i] <= '9')) p->i += 1;",
+    "  if (p->i == int_start || (p->s[int_start] == '0' && p->i - int_start > 1)) { *ok = 0; return JSON_null(); }",
     "  if (p->i < p->len && p->s[p->i] == '.') {",
     "    p->i += 1;",
+    "    size_t frac_start = p->i;",
+    "    while (p->i < p->len && (p->s[p->i] >= '0' && p->s[p->i] <= '9')) p->i += 1;",
+    "    if (p->i == frac_start) { *ok = 0; return JSON_null(); }",
+    "  }",
+    "  if (p->i < p->len && (p->s[p->i] == 'e' || p->s[p->i] == 'E')) {",
+    "    p->i += 1;",
+    "    if (p->i < p->len && (p->s[p->i] == '+' || p->s[p->i] == '-')) p->i += 1;",
+    "    size_t exp_start = p->i;",
     "    while (p->i < p->len && (p->s[p->i] >= '0' && p->s[p->i] <= '9')) p->i += 1;",
+    "    if (p->i == exp_start) { *ok = 0; return JSON_null(); }",
     "  }",
     "  size_t n = p->i - start;",
-    "  if (n == 0) { *ok = 0; return JSON_null(); }",
     "  char* buf = (char*)malloc(n + 1);",
     "  if (!buf) ps_panic(\"R1998\", \"RUNTIME_OOM\", \"out of memory\");",
     "  memcpy(buf, p->s + start, n);",
@@ -1742,6 +1774,31 @@ function emitRuntimeHelpers(protoMap) {
     "  return (ps_string){ b->ptr, b->len };",
     "}",
     "static ps_string JSON_encode(ps_jsonvalue v);",
+    "static void ps_json_encode_string(ps_buf* b, ps_string s) {",
+    "  ps_buf_append(b, \"\\\"\", 1);",
+    "  size_t run = 0;",
+    "  for (size_t i = 0; i < s.len; i += 1) {",
+    "    unsigned char c = (unsigned char)s.ptr[i];",
+    "    if (c >= 0x20 && c != '\"' && c != '\\\\') continue;",
+    "    ps_buf_append(b, s.ptr + run, i - run);",
+    "    run = i + 1;",
+    "    char esc[8];",
+    "    switch (c) {",
+    "      case '\"': ps_buf_append(b, \"\\\\\\\"\", 2); break;",
+    "      case '\\\\': ps_buf_append(b, \"\\\\\\\\\", 2); break;",
+    "      case '\\b': ps_buf_append(b, \"\\\\b\", 2); break;",
+    "      case '\\f': ps_buf_append(b, \"\\\\f\", 2); break;",
+    "      case '\\n': ps_buf_append(b, \"\\\\n\", 2); break;",
+    "      case '\\r': ps_buf_append(b, \"\\\\r\", 2); break;",
+    "      case '\\t': ps_buf_append(b, \"\\\\t\", 2); break;",
+    "      default:",
+    "        snprintf(esc, sizeof(esc), \"\\\\u%04x\", c);",
+    "        ps_buf_append(b, esc, 6);",
+    "    }",
+    "  }",
+    "  ps_buf_append(b, s.ptr + run, s.len - run);",
+    "  ps_buf_append(b, \"\\\"\", 1);",
+    "}",
     "static void ps_json_encode_value(ps_buf* b, ps_jsonvalue v) {",
     "  switch (v.kind) {",
     "    case PS_JSON_NULL: ps_buf_append(b, \"null\", 4); break;",
@@ -1753,12 +1810,7 @@ function emitRuntimeHelpers(protoMap) {
     "      ps_buf_append(b, buf, (size_t)n);",
     "      break;",
     "    }",
-    "    case PS_JSON_STRING: {",
-    "      ps_buf_append(b, \"\\\"\", 1);",
-    "      ps_buf_append(b, v.str.ptr, v.str.len);",
-    "      ps_buf_append(b, \"\\\"\", 1);",
-    "      break;",
-    "    }",
+    "    case PS_JSON_STRING: ps_json_encode_string(b, v.str); break;",
     "    case PS_JSON_ARRAY: {",
     "      ps_buf_append(b, \"[\", 1);",
     "      for (size_t i = 0; i < v.arr.len; i += 1) {",
@@ -1772,9 +1824,7 @@ function emitRuntimeHelpers(protoMap) {
     "      ps_buf_append(b, \"{\", 1);",
     "      for (size_t i = 0; i < v.obj.len; i += 1) {",
     "        if (i) ps_buf_append(b, \",\", 1);",
-    "        ps_buf_append(b, \"\\\"\", 1);",
-    "        ps_buf_append(b, v.obj.keys[i].ptr, v.obj.keys[i].len);",
-    "        ps_buf_append(b, \"\\\"\", 1);",
+    "        ps_json_encode_string(b, v.obj.keys[i]);",
     "        ps_buf_append(b, \":\", 1);",
     "        ps_json_encode_value(b, v.obj.values[i]);",
     "      }",
@@ -1788,6 +1838,380 @@ function emitRuntimeHelpers(protoMap) {
     "  ps_json_encode_value(&b, v);",
     "  return ps_buf_to_string(&b);",
     "}",
+    "static void JSON_encodeTo(ps_file* f, ps_jsonvalue v) {",
+    "  ps_file_check_open(f);",
+    "  if (!f->writable) ps_raise_runtime_typed(\"WriteFailureException\", \"file not writable\");",
+    "  ps_buf b = { NULL, 0, 0 };",
+    "  ps_json_encode_value(&b, v);",
+    "  ps_file_write_text(f, ps_buf_to_string(&b));",
+    "  free(b.ptr);",
+    "}",
+    "// JSONReader: pull parser over a TextFile read PS_JSON_READ_CHUNK bytes at a time,",
+    "// as in the other runtimes.",
+    "enum {",
+    "  PS_JR_DOC,",
+    "  PS_JR_DOC_END,",
+    "  PS_JR_VALUE,",
+    "  PS_JR_VALUE_OR_END,",
+    "  PS_JR_COLON,",
+    "  PS_JR_KEY_OR_END,",
+    "  PS_JR_KEY,",
+    "  PS_JR_COMMA_OR_END",
+    "};",
+    "enum { PS_JR_DOCUMENT, PS_JR_ARRAY, PS_JR_LINES };",
+    "enum { PS_JR_BEGIN_OBJECT, PS_JR_END_OBJECT, PS_JR_BEGIN_ARRAY, PS_JR_END_ARRAY, PS_JR_EV_KEY, PS_JR_EV_VALUE, PS_JR_EV_END };",
+    "static const char* ps_json_event_names[] = { \"beginObject\", \"endObject\", \"beginArray\", \"endArray\", \"key\", \"value\", \"end\" };",
+    "enum { PS_JSON_READ_CHUNK = 65536 };",
+    "typedef struct {",
+    "  ps_file* file;",
+    "  int mode;",
+    "  int expect;",
+    "  char* buf;",
+    "  size_t len;",
+    "  size_t pos;",
+    "  int eof;",
+    "  char* stack;",
+    "  size_t depth;",
+    "  size_t cap;",
+    "  ps_string key;",
+    "  int has_key;",
+    "  ps_jsonvalue value;",
+    "  int has_value;",
+    "  int failed;",
+    "  int closed;",
+    "} ps_json_reader;",
+    "static void ps_json_reader_release_input(ps_json_reader* r) {",
+    "  free(r->buf);",
+    "  free(r->stack);",
+    "  r->buf = NULL;",
+    "  r->stack = NULL;",
+    "  r->len = 0;",
+    "  r->pos = 0;",
+    "  r->depth = 0;",
+    "  r->cap = 0;",
+    "  r->eof = 1;",
+    "  r->file = NULL;",
+    "}",
+    "static void ps_json_reader_fail(ps_json_reader* r) {",
+    "  r->failed = 1;",
+    "  ps_json_reader_release_input(r);",
+    "  ps_panic_diag(\"R1010\", \"RUNTIME_JSON_ERROR\", \"invalid JSON\", \"JSON value\", \"expected JSON type\");",
+    "}",
+    "static int ps_json_reader_peek(ps_json_reader* r) {",
+    "  if (r->pos < r->len) return (unsigned char)r->buf[r->pos];",
+    "  if (r->eof) return -1;",
+    "  ps_file_check_open(r->file);",
+    "  if (!r->file->readable) ps_raise_runtime_typed(\"ReadFailureException\", \"file not readable\");",
+    "  size_t n = fread(r->buf, 1, PS_JSON_READ_CHUNK, r->file->fp);",
+    "  if (n == 0 && ferror(r->file->fp)) ps_raise_runtime_typed(\"ReadFailureException\", \"read failed\");",
+    "  r->pos = 0;",
+    "  r->len = n;",
+    "  if (n == 0) {",
+    "    r->eof = 1;",
+    "    return -1;",
+    "  }",
+    "  return (unsigned char)r->buf[0];",
+    "}",
+    "static int ps_json_reader_skip_ws(ps_json_reader* r) {",
+    "  int newlines = r->mode != PS_JR_LINES || r->expect == PS_JR_DOC;",
+    "  for (;;) {",
+    "    int c = ps_json_reader_peek(r);",
+    "    if (c == ' ' || c == '\\t' || c == '\\r' || (c == '\\n' && newlines)) {",
+    "      r->pos += 1;",
+    "      continue;",
+    "    }",
+    "    return c;",
+    "  }",
+    "}",
+    "static int ps_json_reader_is_delim(int c) {",
+    "  return c == '{' || c == '}' || c == '[' || c == ']' || c == ':' || c == ',' || c == '\"' || c == ' ' || c == '\\t' || c == '\\n' || c == '\\r';",
+    "}",
+    "static ps_jsonvalue ps_json_reader_string(ps_json_reader* r) {",
+    "  ps_buf tok = { NULL, 0, 0 };",
+    "  ps_buf_append(&tok, \"\\\"\", 1);",
+    "  r->pos += 1;",
+    "  int escaped = 0;",
+    "  for (;;) {",
+    "    if (ps_json_reader_peek(r) == -1) {",
+    "      free(tok.ptr);",
+    "      ps_json_reader_fail(r);",
+    "    }",
+    "    size_t i = r->pos;",
+    "    int closed = 0;",
+    "    for (; i < r->len; i += 1) {",
+    "      unsigned char b = (unsigned char)r->buf[i];",
+    "      if (escaped) escaped = 0;",
+    "      else if (b == '\\\\') escaped = 1;",
+    "      else if (b == '\"') {",
+    "        closed = 1;",
+    "        i += 1;",
+    "        break;",
+    "      } else if (b < 0x20) {",
+    "        free(tok.ptr);",
+    "        ps_json_reader_fail(r);",
+    "      }",
+    "    }",
+    "    ps_buf_append(&tok, r->buf + r->pos, i - r->pos);",
+    "    r->pos = i;",
+    "    if (closed) break;",
+    "  }",
+    "  ps_json_parser p = { tok.ptr, tok.len, 0 };",
+    "  int ok = 1;",
+    "  ps_jsonvalue v = ps_json_parse_string(&p, &ok);",
+    "  free(tok.ptr);",
+    "  if (!ok) ps_json_reader_fail(r);",
+    "  return v;",
+    "}",
+    "static ps_jsonvalue ps_json_reader_atom(ps_json_reader* r) {",
+    "  ps_buf tok = { NULL, 0, 0 };",
+    "  for (;;) {",
+    "    int c = ps_json_reader_peek(r);",
+    "    if (c == -1 || ps_json_reader_is_delim(c)) break;",
+    "    size_t end = r->pos;",
+    "    while (end < r->len && !ps_json_reader_is_delim((unsigned char)r->buf[end])) end += 1;",
+    "    ps_buf_append(&tok, r->buf + r->pos, end - r->pos);",
+    "    r->pos = end;",
+    "  }",
+    "  ps_json_parser p = { tok.ptr, tok.len, 0 };",
+    "  int ok = 1;",
+    "  ps_jsonvalue v = JSON_null();",
+    "  if (tok.len == 4 && memcmp(tok.ptr, \"true\", 4) == 0) v = JSON_bool(true);",
+    "  else if (tok.len == 5 && memcmp(tok.ptr, \"false\", 5) == 0) v = JSON_bool(false);",
+    "  else if (!(tok.len == 4 && memcmp(tok.ptr, \"null\", 4) == 0)) {",
+    "    v = ps_json_parse_number(&p, &ok);",
+    "    if (p.i != p.len) ok = 0;",
+    "  }",
+    "  free(tok.ptr);",
+    "  if (!ok) ps_json_reader_fail(r);",
+    "  return v;",
+    "}",
+    "static void ps_json_reader_after_value(ps_json_reader* r) {",
+    "  r->expect = r->depth > 0 ? PS_JR_COMMA_OR_END : PS_JR_DOC_END;",
+    "}",
+    "static int ps_json_reader_next_event(ps_json_reader* r) {",
+    "  r->has_key = 0;",
+    "  r->has_value = 0;",
+    "  if (r->failed) ps_json_reader_fail(r);",
+    "  for (;;) {",
+    "    int c = ps_json_reader_skip_ws(r);",
+    "    int closing = 0;",
+    "    switch (r->expect) {",
+    "      case PS_JR_DOC:",
+    "        if (c == -1) {",
+    "          if (r->mode != PS_JR_LINES) ps_json_reader_fail(r);",
+    "          ps_json_reader_release_input(r);",
+    "          return PS_JR_EV_END;",
+    "        }",
+    "        break;",
+    "      case PS_JR_DOC_END:",
+    "        if (c == -1) {",
+    "          ps_json_reader_release_input(r);",
+    "          return PS_JR_EV_END;",
+    "        }",
+    "        if (r->mode == PS_JR_LINES && c == '\\n') {",
+    "          r->pos += 1;",
+    "          r->expect = PS_JR_DOC;",
+    "          continue;",
+    "        }",
+    "        ps_json_reader_fail(r);",
+    "        break;",
+    "      case PS_JR_VALUE_OR_END:",
+    "        closing = c == ']';",
+    "        break;",
+    "      case PS_JR_COLON:",
+    "        if (c != ':') ps_json_reader_fail(r);",
+    "        r->pos += 1;",
+    "        r->expect = PS_JR_VALUE;",
+    "        continue;",
+    "      case PS_JR_KEY_OR_END:",
+    "      case PS_JR_KEY:",
+    "        if (r->expect == PS_JR_KEY_OR_END && c == '}') {",
+    "          closing = 1;",
+    "          break;",
+    "        }",
+    "        if (c != '\"') ps_json_reader_fail(r);",
+    "        r->key = ps_json_reader_string(r).str;",
+    "        r->has_key = 1;",
+    "        r->expect = PS_JR_COLON;",
+    "        return PS_JR_EV_KEY;",
+    "      case PS_JR_COMMA_OR_END:",
+    "        if (c == ',') {",
+    "          r->pos += 1;",
+    "          r->expect = r->stack[r->depth - 1] == '{' ? PS_JR_KEY : PS_JR_VALUE;",
+    "          continue;",
+    "        }",
+    "        closing = 1;",
+    "        break;",
+    "      default:",
+    "        break;",
+    "    }",
+    "    if (closing) {",
+    "      if (r->depth == 0 || c != (r->stack[r->depth - 1] == '{' ? '}' : ']')) ps_json_reader_fail(r);",
+    "      r->pos += 1;",
+    "      r->depth -= 1;",
+    "      ps_json_reader_after_value(r);",
+    "      return c == '}' ? PS_JR_END_OBJECT : PS_JR_END_ARRAY;",
+    "    }",
+    "    if (c == '{' || c == '[') {",
+    "      if (r->depth == r->cap) {",
+    "        r->cap = r->cap ? r->cap * 2 : 16;",
+    "        r->stack = (char*)realloc(r->stack, r->cap);",
+    "        if (!r->stack) ps_panic(\"R1998\", \"RUNTIME_OOM\", \"out of memory\");",
+    "      }",
+    "      r->stack[r->depth++] = (char)c;",
+    "      r->pos += 1;",
+    "      r->expect = c == '{' ? PS_JR_KEY_OR_END : PS_JR_VALUE_OR_END;",
+    "      return c == '{' ? PS_JR_BEGIN_OBJECT : PS_JR_BEGIN_ARRAY;",
+    "    }",
+    "    if (c == '\"') r->value = ps_json_reader_string(r);",
+    "    else if (c == -1 || ps_json_reader_is_delim(c)) ps_json_reader_fail(r);",
+    "    else r->value = ps_json_reader_atom(r);",
+    "    r->has_value = 1;",
+    "    ps_json_reader_after_value(r);",
+    "    return PS_JR_EV_VALUE;",
+    "  }",
+    "}",
+    "// True if a whole value can be read at the current position (the separator",
+    "// before it is consumed).",
+    "static bool ps_json_reader_has_value(ps_json_reader* r) {",
+    "  if (r->failed) ps_json_reader_fail(r);",
+    "  for (;;) {",
+    "    if (r->expect == PS_JR_VALUE) return true;",
+    "    if (r->expect == PS_JR_KEY || r->expect == PS_JR_KEY_OR_END) return false;",
+    "    int c = ps_json_reader_skip_ws(r);",
+    "    switch (r->expect) {",
+    "      case PS_JR_DOC:",
+    "        return c != -1 || r->mode != PS_JR_LINES;",
+    "      case PS_JR_DOC_END:",
+    "        if (c == -1) return false;",
+    "        if (r->mode == PS_JR_LINES && c == '\\n') {",
+    "          r->pos += 1;",
+    "          r->expect = PS_JR_DOC;",
+    "          continue;",
+    "        }",
+    "        ps_json_reader_fail(r);",
+    "        return false;",
+    "      case PS_JR_VALUE_OR_END:",
+    "        return c != ']';",
+    "      case PS_JR_COLON:",
+    "        if (c != ':') ps_json_reader_fail(r);",
+    "        r->pos += 1;",
+    "        r->expect = PS_JR_VALUE;",
+    "        return true;",
+    "      case PS_JR_COMMA_OR_END:",
+    "        if (c != ',' || r->stack[r->depth - 1] != '[') return false;",
+    "        r->pos += 1;",
+    "        r->expect = PS_JR_VALUE;",
+    "        return true;",
+    "      default:",
+    "        return false;",
+    "    }",
+    "  }",
+    "}",
+    "typedef struct {",
+    "  int is_object;",
+    "  ps_list_JSONValue items;",
+    "  ps_map_string_JSONValue members;",
+    "  ps_string key;",
+    "} ps_json_reader_frame;",
+    "static ps_jsonvalue ps_json_reader_read_value(ps_json_reader* r) {",
+    "  ps_json_reader_frame* frames = NULL;",
+    "  size_t len = 0;",
+    "  size_t cap = 0;",
+    "  for (;;) {",
+    "    int ev = ps_json_reader_next_event(r);",
+    "    ps_jsonvalue v;",
+    "    if (ev == PS_JR_BEGIN_OBJECT || ev == PS_JR_BEGIN_ARRAY) {",
+    "      if (len == cap) {",
+    "        cap = cap ? cap * 2 : 8;",
+    "        frames = (ps_json_reader_frame*)realloc(frames, sizeof(ps_json_reader_frame) * cap);",
+    "        if (!frames) ps_panic(\"R1998\", \"RUNTIME_OOM\", \"out of memory\");",
+    "      }",
+    "      ps_json_reader_frame f = { ev == PS_JR_BEGIN_OBJECT, { NULL, 0, 0, 0 }, { NULL, NULL, 0, 0 }, { NULL, 0 } };",
+    "      frames[len++] = f;",
+    "      continue;",
+    "    }",
+    "    if (ev == PS_JR_EV_KEY) {",
+    "      frames[len - 1].key = r->key;",
+    "      r->has_key = 0;",
+    "      continue;",
+    "    }",
+    "    if (ev == PS_JR_EV_VALUE) {",
+    "      v = r->value;",
+    "      r->has_value = 0;",
+    "    } else if (ev == PS_JR_EV_END || len == 0) {",
+    "      free(frames);",
+    "      ps_json_reader_fail(r);",
+    "      return JSON_null();",
+    "    } else {",
+    "      len -= 1;",
+    "      v = frames[len].is_object ? JSON_object(frames[len].members) : JSON_array(frames[len].items);",
+    "    }",
+    "    if (len == 0) {",
+    "      free(frames);",
+    "      return v;",
+    "    }",
+    "    ps_json_reader_frame* top = &frames[len - 1];",
+    "    if (top->is_object) {",
+    "      ps_map_set_string_JSONValue(&top->members, top->key, v);",
+    "    } else {",
+    "      if (top->items.len == top->items.cap) {",
+    "        size_t nc = (top->items.cap == 0) ? 4 : top->items.cap * 2;",
+    "        top->items.ptr = (ps_jsonvalue*)realloc(top->items.ptr, sizeof(ps_jsonvalue) * nc);",
+    "        if (!top->items.ptr) ps_panic(\"R1998\", \"RUNTIME_OOM\", \"out of memory\");",
+    "        top->items.cap = nc;",
+    "      }",
+    "      top->items.ptr[top->items.len++] = v;",
+    "    }",
+    "  }",
+    "}",
+    "static ps_json_reader* ps_json_reader_open(ps_file* f, int mode) {",
+    "  ps_json_reader* r = (ps_json_reader*)calloc(1, sizeof(ps_json_reader));",
+    "  if (!r) ps_panic(\"R1998\", \"RUNTIME_OOM\", \"out of memory\");",
+    "  r->buf = (char*)malloc(PS_JSON_READ_CHUNK);",
+    "  if (!r->buf) ps_panic(\"R1998\", \"RUNTIME_OOM\", \"out of memory\");",
+    "  r->file = f;",
+    "  r->mode = mode;",
+    "  r->expect = PS_JR_DOC;",
+    "  if (mode == PS_JR_ARRAY && ps_json_reader_next_event(r) != PS_JR_BEGIN_ARRAY) ps_json_reader_fail(r);",
+    "  return r;",
+    "}",
+    "static ps_json_reader* JSON_reader(ps_file* f) { return ps_json_reader_open(f, PS_JR_DOCUMENT); }",
+    "static ps_json_reader* JSON_readArray(ps_file* f) { return ps_json_reader_open(f, PS_JR_ARRAY); }",
+    "static ps_json_reader* JSON_readLines(ps_file* f) { return ps_json_reader_open(f, PS_JR_LINES); }",
+    "static void ps_json_reader_check_open(ps_json_reader* r) {",
+    "  if (!r || r->closed) ps_panic_diag(\"R1010\", \"RUNTIME_JSON_ERROR\", \"JSONReader is closed\", \"closed reader\", \"open reader\");",
+    "}",
+    "static bool JSON___reader_hasNext(ps_json_reader* r) {",
+    "  ps_json_reader_check_open(r);",
+    "  return ps_json_reader_has_value(r);",
+    "}",
+    "static ps_jsonvalue JSON___reader_next(ps_json_reader* r) {",
+    "  ps_json_reader_check_open(r);",
+    "  if (!ps_json_reader_has_value(r)) ps_panic_diag(\"R1010\", \"RUNTIME_JSON_ERROR\", \"no more JSON values\", \"end of values\", \"JSON value\");",
+    "  return ps_json_reader_read_value(r);",
+    "}",
+    "static ps_string JSON___reader_nextEvent(ps_json_reader* r) {",
+    "  ps_json_reader_check_open(r);",
+    "  return ps_cstr(ps_json_event_names[ps_json_reader_next_event(r)]);",
+    "}",
+    "static ps_string JSON___reader_key(ps_json_reader* r) {",
+    "  ps_json_reader_check_open(r);",
+    "  if (!r->has_key) ps_panic_diag(\"R1010\", \"RUNTIME_JSON_ERROR\", \"no current JSON key\", \"no key event\", \"key event\");",
+    "  return r->key;",
+    "}",
+    "static ps_jsonvalue JSON___reader_value(ps_json_reader* r) {",
+    "  ps_json_reader_check_open(r);",
+    "  if (!r->has_value) ps_panic_diag(\"R1010\", \"RUNTIME_JSON_ERROR\", \"no current JSON value\", \"no value event\", \"value event\");",
+    "  return r->value;",
+    "}",
+    "static void JSON___reader_close(ps_json_reader* r) {",
+    "  ps_json_reader_check_open(r);",
+    "  r->has_key = 0;",
+    "  r->has_value = 0;",
+    "  ps_json_reader_release_input(r);",
+    "  r->closed = 1;",
+    "}",
     "static ps_string JSON_encode_bool(bool b) { return JSON_encode(JSON_bool(b)); }",
     "static ps_string JSON_encode_number(double n) { return JSON_encode(JSON_number(n)); }",
     "static ps_string JSON_encode_string(ps_string s) { return JSON_encode(JSON_string(s)); }",
@@ -4180,6 +4604,39 @@ function emitRuntimeHelpers(protoMap) {
     "  }",
     "  return out;",
     "}",
+    "static void ps_rx_span_push(ps_list_int* l, int64_t v) {",
+    "  if (l->len >= l->cap) {",
+    "    size_t nc = l->cap == 0 ? 16 : l->cap * 2;",
+    "    int64_t* n = (int64_t*)realloc(l->ptr, sizeof(int64_t) * nc);",
+    "    if (!n) ps_panic(\"R1998\", \"RUNTIME_OOM\", \"out of memory\");",
+    "    l->ptr = n;",
+    "    l->cap = nc;",
+    "  }",
+    "  l->ptr[l->len++] = v;",
+    "  l->version += 1;",
+    "}",
+    "static ps_list_int RegExp_findAllSpans(RegExp* self, ps_string input, int64_t start, int64_t max) {",
+    "  size_t gl = ps_utf8_glyph_len(input);",
+    "  if (start < 0 || (size_t)start > gl) ps_rx_fail(\"RegExpRange\", \"start out of range\");",
+    "  if (max < -1) ps_rx_fail(\"RegExpRange\", \"max out of range\");",
+    "  ps_list_int out = { NULL, 0, 0, 0 };",
+    "  if (max == 0) return out;",
+    "  size_t cur = (size_t)start;",
+    "  int64_t produced = 0;",
+    "  while (cur <= gl) {",
+    "    RegExpMatch* m = RegExp_find(self, input, (int64_t)cur);",
+    "    if (!m->ok) break;",
+    "    ps_rx_span_push(&out, m->start);",
+    "    ps_rx_span_push(&out, m->end);",
+    "    produced += 1;",
+    "    if (max > 0 && produced >= max) break;",
+    "    if (m->end <= m->start) {",
+    "      if ((size_t)m->end >= gl) break;",
+    "      cur = (size_t)m->end + 1;",
+    "    } else cur = (size_t)m->end;",
+    "  }",
+    "  return out;",
+    "}",
     "static ps_list_string RegExp_split(RegExp* self, ps_string input, int64_t start, int64_t maxParts) {",
     "  size_t gl = ps_utf8_glyph_len(input);",
     "  if (start < 0 || (size_t)start > gl) ps_rx_fail(\"RegExpRange\", \"start out of range\");",
@@ -4300,6 +4757,9 @@ function emitInstr(i, fnInf, state) {
       out.push(`ps_check_shift_range(${n(i.shift)}, ${i.width});`);
       break;
     case "check_index_bounds":
+      // The frontend types `expr.asObject()[k]` as an index on an unknown
+      // target: a map target gets the missing-key check instead.
+      if (parseMapType(t(i.target))) return emitInstr({ ...i, op: "check_map_has_key", map: i.target, key: i.index }, fnInf, state);
       if (t(i.target) === "string") out.push(`ps_check_index_bounds(ps_utf8_glyph_len(${n(i.target)}), ${n(i.index)});`);
       else out.push(`ps_check_index_bounds(${n(i.target)}.len, ${n(i.index)});`);
       break;
@@ -4462,6 +4922,7 @@ function emitInstr(i, fnInf, state) {
           "BinaryFile",
           "Dir",
           "Walker",
+          "JSONReader",
           "RegExp",
           "PathInfo",
           "PathEntry",
@@ -5012,6 +5473,8 @@ function emitInstr(i, fnInf, state) {
           out.push(`${n(i.dst)} = (ps_fs_dir*)calloc(1, sizeof(ps_fs_dir));`);
         } else if (rt === "Walker") {
           out.push(`${n(i.dst)} = (ps_fs_walker*)calloc(1, sizeof(ps_fs_walker));`);
+        } else if (rt === "JSONReader") {
+          out.push(`${n(i.dst)} = (ps_json_reader*)calloc(1, sizeof(ps_json_reader));`);
         } else if (PROTO_MAP.has(rt)) {
           out.push(`${n(i.dst)} = (${rt}*)calloc(1, sizeof(${rt}));`);
           if (i.proto && isExceptionProto(PROTO_MAP, i.proto) && i.proto !== "Exception" && i.proto !== "RuntimeException") {
@@ -5062,9 +5525,11 @@ function emitInstr(i, fnInf, state) {
       }
       break;
     case "ret":
+      if (state?.tryBase) out.push("ps_try_len = ps_try_base;");
       out.push(`return ${maybeCastExpr(state?.returnType, t(i.value), n(i.value))};`);
       break;
     case "ret_void":
+      if (state?.tryBase) out.push("ps_try_len = ps_try_base;");
       out.push("return;");
       break;
     case "throw":
@@ -5163,6 +5628,43 @@ function emitLocPrelude(instr) {
   return `ps_set_runtime_site(${cStringLiteral(file)}, ${line}, ${col});`;
 }
 
+// Handler depth at the entry of each block, relative to the function's entry.
+// The IR leaves a try region by break, continue or return without pop_handler,
+// so paths meet at the shallowest depth, as in the C VM. Returns null when the
+// function has no try.
+function handlerDepths(blocks) {
+  if (!blocks.some((b) => b.instrs.some((i) => i.op === "push_handler"))) return null;
+  const index = new Map(blocks.map((b, k) => [b.label, k]));
+  const depth = new Map();
+  const work = [];
+  const reach = (label, d) => {
+    if (!index.has(label)) return;
+    const prev = depth.get(label);
+    if (prev !== undefined && prev <= d) return;
+    depth.set(label, d);
+    work.push(label);
+  };
+  if (blocks.length > 0) reach(blocks[0].label, 0);
+  while (work.length > 0) {
+    const b = blocks[index.get(work.pop())];
+    let d = depth.get(b.label);
+    for (const i of b.instrs) {
+      if (i.op === "push_handler") {
+        reach(i.target, d);
+        d += 1;
+      } else if (i.op === "pop_handler") {
+        d = Math.max(0, d - 1);
+      } else if (i.op === "jump") {
+        reach(i.target, d);
+      } else if (i.op === "branch_if" || i.op === "branch_iter_has_next") {
+        reach(i.then, d);
+        reach(i.else, d);
+      }
+    }
+  }
+  return depth;
+}
+
 function emitFunctionBody(fn, fnInf) {
   const out = [];
   const ret = fn.name === "main" ? "int" : cTypeFromName(fn.returnType.name);
@@ -5198,9 +5700,15 @@ function emitFunctionBody(fn, fnInf) {
       b.instrs = b.instrs.slice(0, idx + 1);
     }
   }
+  const tryDepth = handlerDepths(blocks);
+  if (tryDepth) {
+    out.push("  int ps_try_base = ps_try_len;");
+    emitState.tryBase = true;
+  }
   if (blocks.length > 0) out.push(`  goto ${blocks[0].label};`);
   for (const b of blocks) {
     out.push(`${b.label}:`);
+    if (tryDepth && tryDepth.has(b.label)) out.push(`  ps_try_len = ps_try_base + ${tryDepth.get(b.label)};`);
     for (const i of b.instrs) {
       const locPrelude = emitLocPrelude(i);
       if (locPrelude) out.push(`  ${locPrelude}`);
@@ -5209,6 +5717,7 @@ function emitFunctionBody(fn, fnInf) {
     }
     const last = b.instrs.length > 0 ? b.instrs[b.instrs.length - 1] : null;
     if (!last || !terminators.has(last.op)) {
+      if (tryDepth) out.push("  ps_try_len = ps_try_base;");
       out.push(`  ${defaultReturnLine}`);
     }
   }
@@ -113,6 +113,7 @@ function isValidRegistryType(s, allowVoid) {
     "TextFile",
     "BinaryFile",
     "JSONValue",
+    "JSONReader",
     "CivilDateTime",
     "PathInfo",
     "PathEntry",
@@ -274,8 +275,15 @@ class Lexer {
     return false;
   }
 
+  // `JSON.decodeAs<T>(...)`: the only call that takes an explicit type argument.
+  isTypeArgumentHead(tok) {
+    const prev = this.tokenBefore(tok);
+    return !!tok && tok.type === "id" && tok.value === "decodeAs" && !!prev && prev.type === "sym" && prev.value === ".";
+  }
+
   canOpenGenericList() {
     const last = this.lastToken();
+    if (this.isTypeArgumentHead(last)) return true;
     return this.isGenericTypeHeadToken(last) && this.isTypeContextBeforeGenericHead(last);
   }
 
@@ -1271,6 +1279,16 @@ class Parser {
         const d = this.eat("sym", ".");
         const name = this.parseMemberName();
         expr = { kind: "MemberExpr", target: expr, name, line: d.line, col: d.col };
+        if (name === "decodeAs" && this.at("sym", "<")) {
+          const end = this.scanTypeFrom(this.i + 1);
+          const close = end >= 0 ? this.tokens[end] : null;
+          const open = end >= 0 ? this.tokens[end + 1] : null;
+          if (close && close.type === "sym" && close.value === ">" && open && open.type === "sym" && open.value === "(") {
+            this.eat("sym", "<");
+            expr.typeArgs = [this.parseType()];
+            this.eat("sym", ">");
+          }
+        }
       } else if (this.at("sym", "++") || this.at("sym", "--")) {
         const op = this.eat("sym").value;
         expr = { kind: "PostfixExpr", op, expr, line: expr.line, col: expr.col };
@@ -1952,6 +1970,17 @@ class Analyzer {
       methods.set("close", makeBuiltinMethod("Walker", "close", [], "void"));
       this.prototypes.set("Walker", { decl, parent: "Object", fields: new Map(), methods, moduleFile: null, sealed: true });
     }
+    if (!this.prototypes.has("JSONReader")) {
+      const decl = { line: 1, col: 1 };
+      const methods = new Map();
+      methods.set("hasNext", makeBuiltinMethod("JSONReader", "hasNext", [], "bool"));
+      methods.set("next", makeBuiltinMethod("JSONReader", "next", [], "JSONValue"));
+      methods.set("nextEvent", makeBuiltinMethod("JSONReader", "nextEvent", [], "string"));
+      methods.set("key", makeBuiltinMethod("JSONReader", "key", [], "string"));
+      methods.set("value", makeBuiltinMethod("JSONReader", "value", [], "JSONValue"));
+      methods.set("close", makeBuiltinMethod("JSONReader", "close", [], "void"));
+      this.prototypes.set("JSONReader", { decl, parent: "Object", fields: new Map(), methods, moduleFile: null, sealed: true });
+    }
     if (!this.prototypes.has("ProcessEvent")) {
       const decl = { line: 1, col: 1 };
       const methods = new Map();
@@ -1982,6 +2011,7 @@ class Analyzer {
       methods.set("test", makeBuiltinMethod("RegExp", "test", ["string", "int"], "bool"));
       methods.set("find", makeBuiltinMethod("RegExp", "find", ["string", "int"], "RegExpMatch"));
       methods.set("findAll", makeBuiltinMethod("RegExp", "findAll", ["string", "int", "int"], "list<RegExpMatch>"));
+      methods.set("findAllSpans", makeBuiltinMethod("RegExp", "findAllSpans", ["string", "int", "int"], "list<int>"));
       methods.set("replaceFirst", makeBuiltinMethod("RegExp", "replaceFirst", ["string", "string", "int"], "string"));
       methods.set("replaceAll", makeBuiltinMethod("RegExp", "replaceAll", ["string", "string", "int", "int"], "string"));
       methods.set("split", makeBuiltinMethod("RegExp", "split", ["string", "int", "int"], "list<string>"));
@@ -2053,6 +2083,7 @@ class Analyzer {
         d.name === "RegExpMatch" ||
         d.name === "Dir" ||
         d.name === "Walker" ||
+        d.name === "JSONReader" ||
         timeExceptions.includes(d.name) ||
         ioExceptions.includes(d.name) ||
         fsExceptions.includes(d.name)
@@ -2296,6 +2327,32 @@ class Analyzer {
     return sameType(parentMethod.retType, overrideMethod.retType) || this.isSubtype(overrideMethod.retType, parentMethod.retType);
   }
 
+  // Targets of JSON.decodeAs: scalars, JSONValue, list<T>, map<string,T> and
+  // user prototypes whose fields (inherited ones included) are all decodable.
+  isJsonDecodableType(t, seen) {
+    if (!t) return false;
+    const name = typeToString(t);
+    if (["int", "float", "bool", "byte", "string", "JSONValue"].includes(name)) return true;
+    if (t.kind === "GenericType") {
+      if (t.name === "list") return this.isJsonDecodableType(t.args[0], seen);
+      if (t.name === "map") return typeToString(t.args[0]) === "string" && this.isJsonDecodableType(t.args[1], seen);
+      return false;
+    }
+    if (t.kind !== "NamedType") return false;
+    if (seen.has(name)) return true;
+    const proto = this.prototypes.get(name);
+    if (!proto || !proto.moduleFile || this.isSubtype(t, { kind: "NamedType", name: "Exception" })) return false;
+    seen.add(name);
+    for (let p = proto; p; p = this.prototypes.get(p.parent)) {
+      for (const raw of p.fields.values()) {
+        if (!this.isJsonDecodableType(raw && raw.type ? raw.type : raw, seen)) return false;
+      }
+      if (!p.parent || p.parent === "Object") break;
+      if (!this.prototypes.get(p.parent)?.moduleFile) return false;
+    }
+    return true;
+  }
+
   isSubtype(child, parent) {
     if (!child || !parent) return false;
     const cn = typeToString(child);
@@ -3192,6 +3249,10 @@ class Analyzer {
 
     if (expr.callee.kind === "MemberExpr") {
       const member = expr.callee;
+      if (member.typeArgs && !(member.target.kind === "Identifier" && this.namespaces.get(member.target.name)?.name === "JSON" && member.name === "decodeAs")) {
+        this.addDiag(expr, "E3001", "TYPE_MISMATCH_ASSIGNMENT", `unexpected type argument for '${member.name}'`);
+        return null;
+      }
       if (member.target.kind === "SuperExpr") {
         if (!this.currentProto) {
           this.addDiag(member, "E3210", "INVALID_SUPER_USAGE", "super is only valid inside prototype methods");
@@ -3267,6 +3328,18 @@ class Analyzer {
           if (expr.args.length !== fn.params.length) {
             this.addDiag(expr, "E1003", "ARITY_MISMATCH", `arity mismatch for '${member.name}'`);
           }
+          if (ns.name === "JSON" && member.name === "decodeAs") {
+            if (!member.typeArgs) {
+              this.addDiag(expr, "E3006", "MISSING_TYPE_CONTEXT", "JSON.decodeAs requires a type argument");
+              return null;
+            }
+            const target = member.typeArgs[0];
+            if (!this.isJsonDecodableType(target, new Set())) {
+              this.addDiag(expr, "E3001", "TYPE_MISMATCH_ASSIGNMENT", `cannot decode JSON into ${typeToString(target)}`);
+              return null;
+            }
+            return target;
+          }
           return fn.retType;
         }
       }
@@ -3285,6 +3358,12 @@ class Analyzer {
           if (name === "next") return { kind: "NamedType", name: "PathEntry" };
           if (name === "close") return prim("void");
         }
+        if (targetType.name === "JSONReader") {
+          if (name === "hasNext") return prim("bool");
+          if (name === "next" || name === "value") return { kind: "NamedType", name: "JSONValue" };
+          if (name === "nextEvent" || name === "key") return prim("string");
+          if (name === "close") return prim("void");
+        }
       }
       if (
         targetType.kind === "NamedType" &&
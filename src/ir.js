@@ -421,6 +421,11 @@ class IRBuilder {
         parent: "Object",
         fields: [],
       },
+      {
+        name: "JSONReader",
+        parent: "Object",
+        fields: [],
+      },
       {
         name: "ProcessEvent",
         parent: "Object",
@@ -719,6 +724,7 @@ class IRBuilder {
       "BinaryFile",
       "Dir",
       "Walker",
+      "JSONReader",
       "RegExp",
       "PathInfo",
       "PathEntry",
@@ -1658,6 +1664,20 @@ class IRBuilder {
             this.emit(lowered.block, { op: "call_static", dst, callee: `${ns}.clone`, args: [], variadic: false }, memberCallLoc(expr.callee, cloneCallLoc(expr.callee.target)));
             return { value: dst, type: { kind: "NamedType", name: ns }, block: lowered.block };
           }
+          if (ns === "JSON" && method === "decodeAs" && expr.callee.typeArgs) {
+            // The target type travels as a trailing string argument.
+            const target = expr.callee.typeArgs[0];
+            const typeTmp = this.nextTemp();
+            this.emit(lowered.block, { op: "const", dst: typeTmp, literalType: "string", value: typeToString(target) });
+            this.emit(lowered.block, {
+              op: "call_static",
+              dst,
+              callee: "JSON.decodeAs",
+              args: [...args.map((a) => a.value), typeTmp],
+              variadic: false,
+            }, memberCallLoc(expr.callee, dotLocFromTarget(expr.callee.target, expr.callee)));
+            return { value: dst, type: target, block: lowered.block };
+          }
           let variadic = false;
           let calleeOwner = ns;
           if (this.prototypes.has(ns)) {
@@ -1749,6 +1769,31 @@ class IRBuilder {
             return { value: dst, type: { kind: "PrimitiveType", name: "void" }, block: lowered.block };
           }
         }
+        if (rt === "JSONReader") {
+          const dst = this.nextTemp();
+          const helpers = {
+            hasNext: "__reader_hasNext",
+            next: "__reader_next",
+            nextEvent: "__reader_nextEvent",
+            key: "__reader_key",
+            value: "__reader_value",
+            close: "__reader_close",
+          };
+          const helper = Object.prototype.hasOwnProperty.call(helpers, method) ? helpers[method] : null;
+          if (helper) {
+            this.emit(lowered.block, {
+              op: "call_static",
+              dst,
+              callee: `JSON.${helper}`,
+              args: [recv.value, ...args.map((a) => a.value)],
+              variadic: false,
+            }, memberCallLoc(expr.callee, expr.callee));
+            if (method === "hasNext") return { value: dst, type: { kind: "PrimitiveType", name: "bool" }, block: lowered.block };
+            if (method === "next" || method === "value") return { value: dst, type: { kind: "NamedType", name: "JSONValue" }, block: lowered.block };
+            if (method === "nextEvent" || method === "key") return { value: dst, type: { kind: "PrimitiveType", name: "string" }, block: lowered.block };
+            return { value: dst, type: { kind: "PrimitiveType", name: "void" }, block: lowered.block };
+          }
+        }
       }
       if (
         recv.type &&
@@ -1971,6 +2016,7 @@ class IRBuilder {
       if (m.target.kind === "Identifier") {
         const ns = this.importNamespaces.get(m.target.name);
         if (ns) {
+          if (ns === "JSON" && m.name === "decodeAs" && m.typeArgs) return m.typeArgs[0];
           const ft = this.inferFileTypeFromIoOpen(expr);
           if (ft) return { kind: "NamedType", name: ft };
         }
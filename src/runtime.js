@@ -6,6 +6,7 @@ const debugNode = require("../debug_node");
 const crypto = require("crypto");
 const childProcess = require("child_process");
 const os = require("os");
+const v8 = require("v8");
 
 const INT64_MIN = -(2n ** 63n);
 const INT64_MAX = 2n ** 63n - 1n;
@@ -176,6 +177,20 @@ function buildPrototypeEnv(ast) {
       ["close", { name: "close", params: [], retType: { kind: "PrimitiveType", name: "void" } }],
     ]),
   });
+  protos.set("JSONReader", {
+    name: "JSONReader",
+    parent: "Object",
+    sealed: true,
+    fields: [],
+    methods: new Map([
+      ["hasNext", { name: "hasNext", params: [], retType: { kind: "PrimitiveType", name: "bool" } }],
+      ["next", { name: "next", params: [], retType: { kind: "NamedType", name: "JSONValue" } }],
+      ["nextEvent", { name: "nextEvent", params: [], retType: { kind: "PrimitiveType", name: "string" } }],
+      ["key", { name: "key", params: [], retType: { kind: "PrimitiveType", name: "string" } }],
+      ["value", { name: "value", params: [], retType: { kind: "NamedType", name: "JSONValue" } }],
+      ["close", { name: "close", params: [], retType: { kind: "PrimitiveType", name: "void" } }],
+    ]),
+  });
   protos.set("ProcessEvent", {
     name: "ProcessEvent",
     parent: "Object",
@@ -229,6 +244,7 @@ function buildPrototypeEnv(ast) {
       ["test", { name: "test", params: [{ type: { kind: "PrimitiveType", name: "string" } }, { type: { kind: "PrimitiveType", name: "int" } }], retType: { kind: "PrimitiveType", name: "bool" } }],
       ["find", { name: "find", params: [{ type: { kind: "PrimitiveType", name: "string" } }, { type: { kind: "PrimitiveType", name: "int" } }], retType: { kind: "NamedType", name: "RegExpMatch" } }],
       ["findAll", { name: "findAll", params: [{ type: { kind: "PrimitiveType", name: "string" } }, { type: { kind: "PrimitiveType", name: "int" } }, { type: { kind: "PrimitiveType", name: "int" } }], retType: { kind: "GenericType", name: "list", args: [{ kind: "NamedType", name: "RegExpMatch" }] } }],
+      ["findAllSpans", { name: "findAllSpans", params: [{ type: { kind: "PrimitiveType", name: "string" } }, { type: { kind: "PrimitiveType", name: "int" } }, { type: { kind: "PrimitiveType", name: "int" } }], retType: { kind: "GenericType", name: "list", args: [{ kind: "PrimitiveType", name: "int" }] } }],
       ["replaceFirst", { name: "replaceFirst", params: [{ type: { kind: "PrimitiveType", name: "string" } }, { type: { kind: "PrimitiveType", name: "string" } }, { type: { kind: "PrimitiveType", name: "int" } }], retType: { kind: "PrimitiveType", name: "string" } }],
       ["replaceAll", { name: "replaceAll", params: [{ type: { kind: "PrimitiveType", name: "string" } }, { type: { kind: "PrimitiveType", name: "string" } }, { type: { kind: "PrimitiveType", name: "int" } }, { type: { kind: "PrimitiveType", name: "int" } }], retType: { kind: "PrimitiveType", name: "string" } }],
       ["split", { name: "split", params: [{ type: { kind: "PrimitiveType", name: "string" } }, { type: { kind: "PrimitiveType", name: "int" } }, { type: { kind: "PrimitiveType", name: "int" } }], retType: { kind: "GenericType", name: "list", args: [{ kind: "PrimitiveType", name: "string" }] } }],
@@ -452,6 +468,7 @@ function objectCloneDefault(protos, receiver, hooks = null) {
     "BinaryFile",
     "Dir",
     "Walker",
+    "JSONReader",
     "RegExp",
     "PathInfo",
     "PathEntry",
@@ -1082,6 +1099,691 @@ function readByteAt(fd, pos, file, node) {
   }
 }
 
+// JSONReader (JSON.reader, JSON.readArray, JSON.readLines): pull parser over a
+// TextFile read JSON_READ_CHUNK bytes at a time. Besides the value built by
+// next(), it only keeps the current token and the stack of open containers.
+const JSON_READ_CHUNK = 65536;
+const JSON_EVENT_NAMES = ["beginObject", "endObject", "beginArray", "endArray", "key", "value", "end"];
+const JSON_ATOM_RE = /^-?(0|[1-9][0-9]*)(\.[0-9]+)?([eE][+-]?[0-9]+)?$/;
+
+function jsonReaderReleaseInput(r) {
+  r.buf = null;
+  r.len = 0;
+  r.pos = 0;
+  r.eof = true;
+  r.stack = [];
+  r.file = null;
+}
+
+function jsonReaderFail(r, where, message) {
+  r.failed = true;
+  jsonReaderReleaseInput(r);
+  throw new RuntimeError(rdiag(where.file, where.node, "R1010", "RUNTIME_JSON_ERROR", message || "invalid JSON"));
+}
+
+// Next input byte (not consumed), -1 at end of input.
+function jsonReaderPeek(r, where) {
+  if (r.pos < r.len) return r.buf[r.pos];
+  if (r.eof) return -1;
+  const f = r.file;
+  if (f.closed) throwIoException("FileClosedException", where.file, where.node, "file is closed");
+  if ((f.flags & PS_FILE_READ) === 0) throwIoException("ReadFailureException", where.file, where.node, "file not readable");
+  let n = 0;
+  try {
+    n = fs.readSync(f.fd, r.buf, 0, JSON_READ_CHUNK, f.isStd ? null : f.posBytes);
+  } catch {
+    throwIoException("ReadFailureException", where.file, where.node, "read failed");
+  }
+  if (!f.isStd) f.posBytes += n;
+  r.pos = 0;
+  r.len = n;
+  if (n === 0) {
+    r.eof = true;
+    return -1;
+  }
+  return r.buf[0];
+}
+
+// In JSON Lines mode a newline ends a document: it is only skipped between documents.
+function jsonReaderSkipWs(r, where) {
+  const newlines = r.mode !== "lines" || r.expect === "doc";
+  for (;;) {
+    const c = jsonReaderPeek(r, where);
+    if (c === 0x20 || c === 0x09 || c === 0x0d || (c === 0x0a && newlines)) {
+      r.pos += 1;
+      continue;
+    }
+    return c;
+  }
+}
+
+function jsonReaderIsDelim(c) {
+  return c === 0x7b || c === 0x7d || c === 0x5b || c === 0x5d || c === 0x3a || c === 0x2c || c === 0x22 ||
+    c === 0x20 || c === 0x09 || c === 0x0a || c === 0x0d;
+}
+
+function jsonReaderString(r, where) {
+  const parts = [];
+  let escaped = false;
+  for (;;) {
+    const c = jsonReaderPeek(r, where);
+    if (c === -1) jsonReaderFail(r, where);
+    let i = r.pos;
+    let closed = false;
+    for (; i < r.len; i += 1) {
+      const b = r.buf[i];
+      if (escaped) escaped = false;
+      else if (b === 0x5c) escaped = true;
+      else if (b === 0x22) {
+        closed = true;
+        break;
+      } else if (b < 0x20) jsonReaderFail(r, where);
+    }
+    parts.push(Buffer.from(r.buf.subarray(r.pos, i)));
+    r.pos = closed ? i + 1 : i;
+    if (closed) break;
+  }
+  let body = "";
+  try {
+    body = new TextDecoder("utf-8", { fatal: true }).decode(Buffer.concat(parts));
+    return JSON.parse(`"${body}"`);
+  } catch {
+    jsonReaderFail(r, where);
+  }
+  return "";
+}
+
+function jsonReaderAtom(r, where) {
+  let tok = "";
+  for (;;) {
+    const c = jsonReaderPeek(r, where);
+    if (c === -1 || jsonReaderIsDelim(c)) break;
+    let end = r.pos;
+    while (end < r.len && !jsonReaderIsDelim(r.buf[end])) end += 1;
+    tok += r.buf.toString("latin1", r.pos, end);
+    r.pos = end;
+  }
+  if (tok === "true") return makeJsonValue("bool", true);
+  if (tok === "false") return makeJsonValue("bool", false);
+  if (tok === "null") return makeJsonValue("null", null);
+  if (!JSON_ATOM_RE.test(tok)) jsonReaderFail(r, where);
+  return makeJsonValue("number", Number(tok));
+}
+
+function jsonReaderAfterValue(r) {
+  r.expect = r.stack.length > 0 ? "commaOrEnd" : "docEnd";
+}
+
+function jsonReaderNextEvent(r, where) {
+  r.key = null;
+  r.value = null;
+  if (r.failed) jsonReaderFail(r, where);
+  for (;;) {
+    const c = jsonReaderSkipWs(r, where);
+    let action = "value";
+    switch (r.expect) {
+      case "doc":
+        if (c === -1) {
+          // An empty JSON Lines input has no record; a document is required otherwise.
+          if (r.mode !== "lines") jsonReaderFail(r, where);
+          jsonReaderReleaseInput(r);
+          return "end";
+        }
+        r.docs += 1;
+        break;
+      case "docEnd":
+        if (c === -1) {
+          jsonReaderReleaseInput(r);
+          return "end";
+        }
+        if (r.mode === "lines" && c === 0x0a) {
+          r.pos += 1;
+          r.expect = "doc";
+          continue;
+        }
+        jsonReaderFail(r, where);
+        break;
+      case "value":
+        break;
+      case "valueOrEnd":
+        if (c === 0x5d) action = "close";
+        break;
+      case "colon":
+        if (c !== 0x3a) jsonReaderFail(r, where);
+        r.pos += 1;
+        r.expect = "value";
+        continue;
+      case "keyOrEnd":
+      case "key":
+        if (r.expect === "keyOrEnd" && c === 0x7d) {
+          action = "close";
+          break;
+        }
+        if (c !== 0x22) jsonReaderFail(r, where);
+        r.pos += 1;
+        r.key = jsonReaderString(r, where);
+        r.expect = "colon";
+        return "key";
+      case "commaOrEnd":
+        if (c === 0x2c) {
+          r.pos += 1;
+          r.expect = r.stack[r.stack.length - 1] === "{" ? "key" : "value";
+          continue;
+        }
+        action = "close";
+        break;
+      default:
+        break;
+    }
+    if (action === "close") {
+      const top = r.stack[r.stack.length - 1];
+      if (!top || c !== (top === "{" ? 0x7d : 0x5d)) jsonReaderFail(r, where);
+      r.pos += 1;
+      r.stack.pop();
+      jsonReaderAfterValue(r);
+      return c === 0x7d ? "endObject" : "endArray";
+    }
+    if (c === 0x7b || c === 0x5b) {
+      r.stack.push(c === 0x7b ? "{" : "[");
+      r.pos += 1;
+      r.expect = c === 0x7b ? "keyOrEnd" : "valueOrEnd";
+      return c === 0x7b ? "beginObject" : "beginArray";
+    }
+    if (c === 0x22) {
+      r.pos += 1;
+      r.value = makeJsonValue("string", jsonReaderString(r, where));
+    } else {
+      if (c === -1 || jsonReaderIsDelim(c)) jsonReaderFail(r, where);
+      r.value = jsonReaderAtom(r, where);
+    }
+    jsonReaderAfterValue(r);
+    return "value";
+  }
+}
+
+// True if a whole value can be read at the current position (the separator
+// before it is consumed); false at the end of the enclosing array, before an
+// object key, or at the end of input.
+function jsonReaderHasValue(r, where) {
+  if (r.failed) jsonReaderFail(r, where);
+  for (;;) {
+    if (r.expect === "value") return true;
+    if (r.expect === "key" || r.expect === "keyOrEnd") return false;
+    const c = jsonReaderSkipWs(r, where);
+    switch (r.expect) {
+      case "doc":
+        // A missing document is reported by next().
+        return c !== -1 || r.mode !== "lines";
+      case "docEnd":
+        if (c === -1) return false;
+        if (r.mode === "lines" && c === 0x0a) {
+          r.pos += 1;
+          r.expect = "doc";
+          continue;
+        }
+        jsonReaderFail(r, where);
+        return false;
+      case "valueOrEnd":
+        return c !== 0x5d;
+      case "colon":
+        if (c !== 0x3a) jsonReaderFail(r, where);
+        r.pos += 1;
+        r.expect = "value";
+        return true;
+      case "commaOrEnd":
+        if (c !== 0x2c || r.stack[r.stack.length - 1] !== "[") return false;
+        r.pos += 1;
+        r.expect = "value";
+        return true;
+      default:
+        return false;
+    }
+  }
+}
+
+function jsonReaderReadValue(r, where) {
+  const frames = [];
+  for (;;) {
+    const ev = jsonReaderNextEvent(r, where);
+    let v = null;
+    if (ev === "beginObject" || ev === "beginArray") {
+      frames.push({ isObject: ev === "beginObject", items: ev === "beginObject" ? new Map() : [], key: null });
+      continue;
+    }
+    if (ev === "key") {
+      if (frames.length === 0) jsonReaderFail(r, where);
+      frames[frames.length - 1].key = r.key;
+      r.key = null;
+      continue;
+    }
+    if (ev === "value") {
+      v = r.value;
+      r.value = null;
+    } else if (ev === "endObject" || ev === "endArray") {
+      if (frames.length === 0) jsonReaderFail(r, where);
+      const f = frames.pop();
+      v = f.isObject ? makeJsonValue("object", f.items) : makeJsonValue("array", makeList(f.items));
+    } else {
+      jsonReaderFail(r, where);
+    }
+    if (frames.length === 0) return v;
+    const top = frames[frames.length - 1];
+    if (top.isObject) top.items.set(mapKey(top.key), v);
+    else top.items.push(v);
+    top.key = null;
+  }
+}
+
+function makeJsonReader(f, mode, where) {
+  if (!(f instanceof IoFile)) {
+    throw new RuntimeError(rdiag(where.file, where.node, "R1010", "RUNTIME_JSON_ERROR", "JSON reader expects File"));
+  }
+  const r = {
+    __json_reader: true,
+    file: f,
+    mode,
+    expect: "doc",
+    buf: Buffer.alloc(JSON_READ_CHUNK),
+    len: 0,
+    pos: 0,
+    eof: false,
+    stack: [],
+    docs: 0,
+    key: null,
+    value: null,
+    failed: false,
+    closed: false,
+  };
+  if (mode === "array" && jsonReaderNextEvent(r, where) !== "beginArray") jsonReaderFail(r, where);
+  return r;
+}
+
+// JSON.decodeAs<T>(text): schema-directed decoding, the same algorithm as the
+// native module. Values are built straight from the text; a mismatch names
+// the JSON path of the offending value ($, .field, [index], ["key"]).
+const JSON_AS_SCALARS = new Set(["int", "float", "bool", "byte", "string"]);
+const JSON_AS_INT_MIN = -(2n ** 63n);
+const JSON_AS_INT_MAX = 2n ** 63n - 1n;
+const jsonSchemaCache = new WeakMap();
+
+function jsonSchemaFor(protos, t, cache) {
+  const name = typeNodeToRuntimeTypeName(t);
+  if (cache.has(name)) return cache.get(name);
+  const s = { kind: "proto", typeName: name, elem: null, fields: null, index: null };
+  cache.set(name, s);
+  if (t.kind === "GenericType" && (t.name === "list" || t.name === "map")) {
+    s.kind = t.name;
+    s.elem = jsonSchemaFor(protos, t.args[t.args.length - 1], cache);
+  } else if (JSON_AS_SCALARS.has(name)) {
+    s.kind = name;
+  } else if (name === "JSONValue") {
+    s.kind = "any";
+  } else {
+    s.fields = collectPrototypeFields(protos, name).map((f) => ({ name: f.name, isConst: !!f.isConst, schema: null, type: f.type }));
+    s.index = new Map(s.fields.map((f, i) => [f.name, i]));
+    for (const f of s.fields) f.schema = jsonSchemaFor(protos, f.type, cache);
+  }
+  return s;
+}
+
+function jsonPathText(path) {
+  if (!path) return "$";
+  const up = jsonPathText(path.up);
+  if (path.quoted) return `${up}["${path.key}"]`;
+  if (path.key !== null) return `${up}.${path.key}`;
+  return `${up}[${path.index}]`;
+}
+
+function jsonAsInvalid(d) {
+  throw new RuntimeError(rdiag(d.file, d.node, "R1010", "RUNTIME_JSON_ERROR", "invalid JSON"));
+}
+
+function jsonAsFail(d, what, path, got, expected) {
+  throw new RuntimeError(rdiag(d.file, d.node, "R1010", "RUNTIME_JSON_ERROR", diagMsg(`${what} at ${jsonPathText(path)}`, got, expected)));
+}
+
+function jsonAsMismatch(d, s, path) {
+  const c = d.text[d.pos];
+  let got = null;
+  if (c === '"') got = "string";
+  else if (c === "{") got = "object";
+  else if (c === "[") got = "array";
+  else if (c === "t" || c === "f") got = "bool";
+  else if (c === "n") got = "null";
+  else if (c === "-" || (c >= "0" && c <= "9")) got = "number";
+  if (!got) jsonAsInvalid(d);
+  jsonAsFail(d, "JSON type mismatch", path, got, s.typeName);
+}
+
+function jsonAsSkipWs(d) {
+  while (d.pos < d.text.length) {
+    const c = d.text[d.pos];
+    if (c !== " " && c !== "\t" && c !== "\n" && c !== "\r") break;
+    d.pos += 1;
+  }
+}
+
+function jsonAsMatch(d, kw) {
+  if (!d.text.startsWith(kw, d.pos)) return false;
+  d.pos += kw.length;
+  return true;
+}
+
+// Raw body of the string token at d.pos (escapes not decoded), or null.
+function jsonAsScanString(d) {
+  if (d.text[d.pos] !== '"') return null;
+  let i = d.pos + 1;
+  while (i < d.text.length) {
+    const c = d.text.charCodeAt(i);
+    if (c === 0x22 || c < 0x20) break;
+    i += c === 0x5c ? 2 : 1;
+  }
+  if (i >= d.text.length || d.text[i] !== '"') return null;
+  const body = d.text.slice(d.pos + 1, i);
+  d.pos = i + 1;
+  return body;
+}
+
+// Escapes accepted by the native decoder: no lone surrogate.
+function jsonAsEscapesValid(body) {
+  let i = body.indexOf("\\");
+  while (i >= 0) {
+    i += 1;
+    if (i >= body.length) return false;
+    const e = body[i++];
+    if (e === "u") {
+      if (!/^[0-9A-Fa-f]{4}$/.test(body.slice(i, i + 4))) return false;
+      const cp = parseInt(body.slice(i, i + 4), 16);
+      i += 4;
+      if (cp >= 0xdc00 && cp <= 0xdfff) return false;
+      if (cp >= 0xd800 && cp <= 0xdbff) {
+        if (body[i] !== "\\" || body[i + 1] !== "u" || !/^[0-9A-Fa-f]{4}$/.test(body.slice(i + 2, i + 6))) return false;
+        const lo = parseInt(body.slice(i + 2, i + 6), 16);
+        if (lo < 0xdc00 || lo > 0xdfff) return false;
+        i += 6;
+      }
+    } else if (!'"\\/bfnrt'.includes(e)) {
+      return false;
+    }
+    i = body.indexOf("\\", i);
+  }
+  return true;
+}
+
+function jsonAsString(d) {
+  const body = jsonAsScanString(d);
+  if (body === null) jsonAsInvalid(d);
+  if (!body.includes("\\")) return body;
+  if (!jsonAsEscapesValid(body)) jsonAsInvalid(d);
+  return JSON.parse(`"${body}"`);
+}
+
+// Number token at d.pos, or null when it does not follow the JSON grammar.
+function jsonAsNumberToken(d) {
+  const m = /-?(0|[1-9][0-9]*)(\.[0-9]+)?([eE][+-]?[0-9]+)?/y;
+  m.lastIndex = d.pos;
+  const r = m.exec(d.text);
+  if (!r) return null;
+  const tok = r[0];
+  const next = d.text[d.pos + tok.length];
+  // A fraction or exponent marker the grammar did not take is malformed.
+  if (next === "." || next === "e" || next === "E") return null;
+  d.pos += tok.length;
+  return { tok, integral: r[2] === undefined && r[3] === undefined };
+}
+
+function jsonAsSkipValue(d) {
+  jsonAsSkipWs(d);
+  const c = d.text[d.pos];
+  if (c === '"') {
+    const body = jsonAsScanString(d);
+    return body !== null && jsonAsEscapesValid(body);
+  }
+  if (c === "[" || c === "{") {
+    const close = c === "[" ? "]" : "}";
+    d.pos += 1;
+    jsonAsSkipWs(d);
+    if (d.text[d.pos] === close) {
+      d.pos += 1;
+      return true;
+    }
+    for (;;) {
+      if (c === "{") {
+        jsonAsSkipWs(d);
+        const key = jsonAsScanString(d);
+        if (key === null || !jsonAsEscapesValid(key)) return false;
+        jsonAsSkipWs(d);
+        if (d.text[d.pos] !== ":") return false;
+        d.pos += 1;
+      }
+      if (!jsonAsSkipValue(d)) return false;
+      jsonAsSkipWs(d);
+      if (d.text[d.pos] === ",") {
+        d.pos += 1;
+        continue;
+      }
+      if (d.text[d.pos] === close) {
+        d.pos += 1;
+        return true;
+      }
+      return false;
+    }
+  }
+  if (c === "t") return jsonAsMatch(d, "true");
+  if (c === "f") return jsonAsMatch(d, "false");
+  if (c === "n") return jsonAsMatch(d, "null");
+  return jsonAsNumberToken(d) !== null;
+}
+
+function jsonAsAny(d) {
+  jsonAsSkipWs(d);
+  const c = d.text[d.pos];
+  if (c === '"') return makeJsonValue("string", jsonAsString(d));
+  if (c === "[" || c === "{") {
+    const close = c === "[" ? "]" : "}";
+    const items = [];
+    const members = new Map();
+    d.pos += 1;
+    jsonAsSkipWs(d);
+    if (d.text[d.pos] === close) {
+      d.pos += 1;
+    } else {
+      for (;;) {
+        let key = null;
+        if (c === "{") {
+          jsonAsSkipWs(d);
+          key = jsonAsString(d);
+          jsonAsSkipWs(d);
+          if (d.text[d.pos] !== ":") jsonAsInvalid(d);
+          d.pos += 1;
+        }
+        const v = jsonAsAny(d);
+        if (c === "{") members.set(mapKey(key), v);
+        else items.push(v);
+        jsonAsSkipWs(d);
+        if (d.text[d.pos] === ",") {
+          d.pos += 1;
+          continue;
+        }
+        if (d.text[d.pos] === close) {
+          d.pos += 1;
+          break;
+        }
+        jsonAsInvalid(d);
+      }
+    }
+    return c === "[" ? makeJsonValue("array", makeList(items)) : makeJsonValue("object", members);
+  }
+  if (c === "t" && jsonAsMatch(d, "true")) return makeJsonValue("bool", true);
+  if (c === "f" && jsonAsMatch(d, "false")) return makeJsonValue("bool", false);
+  if (c === "n" && jsonAsMatch(d, "null")) return makeJsonValue("null", null);
+  const num = jsonAsNumberToken(d);
+  if (!num) jsonAsInvalid(d);
+  return makeJsonValue("number", Number(num.tok));
+}
+
+function jsonAsInteger(d, s, path) {
+  const num = jsonAsNumberToken(d);
+  if (!num) jsonAsInvalid(d);
+  if (!num.integral) jsonAsFail(d, "JSON type mismatch", path, "non-integer number", s.typeName);
+  const v = BigInt(num.tok);
+  const min = s.kind === "byte" ? 0n : JSON_AS_INT_MIN;
+  const max = s.kind === "byte" ? 255n : JSON_AS_INT_MAX;
+  if (v < min || v > max) jsonAsFail(d, "JSON type mismatch", path, "number out of range", s.typeName);
+  return v;
+}
+
+function jsonAsKey(d) {
+  jsonAsSkipWs(d);
+  const start = d.pos;
+  const body = jsonAsScanString(d);
+  if (body === null) jsonAsInvalid(d);
+  d.pos = start;
+  const key = jsonAsString(d);
+  jsonAsSkipWs(d);
+  if (d.text[d.pos] !== ":") jsonAsInvalid(d);
+  d.pos += 1;
+  return { raw: body, key };
+}
+
+function jsonAsValue(d, s, path) {
+  jsonAsSkipWs(d);
+  if (d.pos >= d.text.length) jsonAsInvalid(d);
+  const c = d.text[d.pos];
+  const number = c === "-" || (c >= "0" && c <= "9");
+  switch (s.kind) {
+    case "any":
+      return jsonAsAny(d);
+    case "int":
+    case "byte":
+      if (number) return jsonAsInteger(d, s, path);
+      break;
+    case "float":
+      if (number) {
+        const num = jsonAsNumberToken(d);
+        if (!num) jsonAsInvalid(d);
+        return Number(num.tok);
+      }
+      break;
+    case "bool":
+      if (c === "t") return jsonAsMatch(d, "true") ? true : jsonAsInvalid(d);
+      if (c === "f") return jsonAsMatch(d, "false") ? false : jsonAsInvalid(d);
+      break;
+    case "string":
+      if (c === '"') return jsonAsString(d);
+      break;
+    case "list":
+      if (c === "[") {
+        const items = [];
+        d.pos += 1;
+        jsonAsSkipWs(d);
+        if (d.text[d.pos] === "]") {
+          d.pos += 1;
+        } else {
+          for (let i = 0; ; i += 1) {
+            items.push(jsonAsValue(d, s.elem, { up: path, key: null, index: i, quoted: false }));
+            jsonAsSkipWs(d);
+            if (d.text[d.pos] === ",") {
+              d.pos += 1;
+              continue;
+            }
+            if (d.text[d.pos] === "]") {
+              d.pos += 1;
+              break;
+            }
+            jsonAsInvalid(d);
+          }
+        }
+        const list = makeList(items);
+        list.__type = s.typeName;
+        return list;
+      }
+      break;
+    case "map":
+      if (c === "{") {
+        const map = new Map();
+        map.__type = s.typeName;
+        d.pos += 1;
+        jsonAsSkipWs(d);
+        if (d.text[d.pos] === "}") {
+          d.pos += 1;
+          return map;
+        }
+        for (;;) {
+          const k = jsonAsKey(d);
+          map.set(mapKey(k.key), jsonAsValue(d, s.elem, { up: path, key: k.raw, index: 0, quoted: true }));
+          jsonAsSkipWs(d);
+          if (d.text[d.pos] === ",") {
+            d.pos += 1;
+            continue;
+          }
+          if (d.text[d.pos] === "}") {
+            d.pos += 1;
+            return map;
+          }
+          jsonAsInvalid(d);
+        }
+      }
+      break;
+    case "proto":
+      if (c === "{") {
+        const vals = new Array(s.fields.length).fill(undefined);
+        d.pos += 1;
+        jsonAsSkipWs(d);
+        if (d.text[d.pos] === "}") {
+          d.pos += 1;
+        } else {
+          for (;;) {
+            const k = jsonAsKey(d);
+            const idx = s.index.get(k.key);
+            if (idx !== undefined) {
+              const f = s.fields[idx];
+              vals[idx] = jsonAsValue(d, f.schema, { up: path, key: f.name, index: 0, quoted: false });
+            } else if (!jsonAsSkipValue(d)) {
+              jsonAsInvalid(d);
+            }
+            jsonAsSkipWs(d);
+            if (d.text[d.pos] === ",") {
+              d.pos += 1;
+              continue;
+            }
+            if (d.text[d.pos] === "}") {
+              d.pos += 1;
+              break;
+            }
+            jsonAsInvalid(d);
+          }
+        }
+        const obj = { __object: true, __proto: s.typeName, __fields: Object.create(null), __constFields: new Set() };
+        s.fields.forEach((f, i) => {
+          if (vals[i] === undefined) {
+            jsonAsFail(d, "missing JSON field", { up: path, key: f.name, index: 0, quoted: false }, "no member", f.schema.typeName);
+          }
+          obj.__fields[f.name] = vals[i];
+          if (f.isConst) obj.__constFields.add(f.name);
+        });
+        return obj;
+      }
+      break;
+    default:
+      break;
+  }
+  return jsonAsMismatch(d, s, path);
+}
+
+function jsonDecodeAs(text, target, protos, where) {
+  let cache = jsonSchemaCache.get(protos);
+  if (!cache) {
+    cache = new Map();
+    jsonSchemaCache.set(protos, cache);
+  }
+  const d = { text, pos: 0, file: where.file, node: where.node };
+  const v = jsonAsValue(d, jsonSchemaFor(protos, target, cache), null);
+  jsonAsSkipWs(d);
+  if (d.pos !== text.length) jsonAsInvalid(d);
+  return v;
+}
+
 function writeAllAtomic(fd, buffer, position, file, node) {
   const isStd = position === null || position === undefined;
   let origSize = null;
@@ -1492,6 +2194,31 @@ function buildModuleEnv(ast, file, hooks = null) {
     debugNode.dump(val, { protoEnv, groups: groupEnv });
     return null;
   });
+  let debugHeapPeak = 0n;
+  debugMod.functions.set("heapStats", () => {
+    // No per-value accounting here: only the V8 heap size is reported, the
+    // value counters stay at 0 (same keys as the C runtime).
+    const used = BigInt(process.memoryUsage().heapUsed);
+    if (used > debugHeapPeak) debugHeapPeak = used;
+    const keys = ["values", "peakValues", "bytes", "peakBytes", "maxBytes"];
+    for (const t of ["bool", "int", "float", "byte", "glyph", "string", "bytes", "list", "map", "object", "file", "group", "other"]) {
+      keys.push(`values.${t}`);
+    }
+    for (const k of ["values", "string", "bytes", "list", "map", "object"]) keys.push(`bytes.${k}`);
+    const m = new Map();
+    for (const k of keys) {
+      let v = 0n;
+      if (k === "bytes") v = used;
+      else if (k === "peakBytes") v = debugHeapPeak;
+      m.set(mapKey(k), v);
+    }
+    return m;
+  });
+  debugMod.functions.set("heapSnapshot", (p) => {
+    // No allocation-site census here: a V8 heap snapshot is written instead.
+    v8.writeHeapSnapshot(String(p));
+    return null;
+  });
 
   const fsMod = makeModule("Fs");
   const fsThrow = (type, node, message) => {
@@ -1908,6 +2635,20 @@ function buildModuleEnv(ast, file, hooks = null) {
 
   const jsonMod = makeModule("JSON");
   jsonMod.functions.set("encode", (v, node) => jsonEncodeValue(node, v));
+  jsonMod.functions.set("encodeTo", (f, v, node) => {
+    if (!(f instanceof IoFile)) jsonError(node, "encodeTo expects File");
+    if (f.closed) throwIoException("FileClosedException", file, node, "file is closed");
+    if ((f.flags & (PS_FILE_WRITE | PS_FILE_APPEND)) === 0) {
+      throwIoException("WriteFailureException", file, node, "file not writable");
+    }
+    const buf = Buffer.from(jsonEncodeValue(node, v), "utf8");
+    if (buf.length > 0) {
+      const startPos = f.posBytes;
+      writeAllAtomic(f.fd, buf, f.isStd ? null : startPos, file, node);
+      if (!f.isStd) f.posBytes = startPos + buf.length;
+    }
+    return null;
+  });
   jsonMod.functions.set("decode", (s, node) => {
     if (typeof s !== "string") jsonError(node, "decode expects string");
     try {
@@ -1917,6 +2658,12 @@ function buildModuleEnv(ast, file, hooks = null) {
       jsonError(node, "invalid JSON");
     }
   });
+  jsonMod.functions.set("decodeAs", (s, node) => {
+    if (typeof s !== "string") jsonError(node, "decodeAs expects string");
+    if (!node || !node.typeArgs) jsonError(node, "decodeAs expects a JSON target type");
+    const protos = hooks && hooks.protoEnv ? hooks.protoEnv : buildPrototypeEnv({ decls: [] });
+    return jsonDecodeAs(s, node.typeArgs[0], protos, { file, node });
+  });
   jsonMod.functions.set("isValid", (s, node) => {
     if (typeof s !== "string") jsonError(node, "isValid expects string");
     try {
@@ -1926,6 +2673,9 @@ function buildModuleEnv(ast, file, hooks = null) {
       return false;
     }
   });
+  jsonMod.functions.set("reader", (f, node) => makeJsonReader(f, "events", { file, node }));
+  jsonMod.functions.set("readArray", (f, node) => makeJsonReader(f, "array", { file, node }));
+  jsonMod.functions.set("readLines", (f, node) => makeJsonReader(f, "lines", { file, node }));
   jsonMod.functions.set("null", () => makeJsonValue("null", null));
   jsonMod.functions.set("bool", (b, node) => {
     if (typeof b !== "boolean") jsonError(node, "bool expects bool");
@@ -2669,13 +3419,110 @@ function buildModuleEnv(ast, file, hooks = null) {
   };
   const rxForbidden = (p) =>
     /(?:\(\?=|\(\?!|\(\?<=|\(\?<!|\\[1-9])/.test(p);
-  const rxTranslatePattern = (pattern) => {
+  // Patterns compile without the "u" flag, so an astral code point is a pair of
+  // UTF-16 units: outside a class it is grouped for quantifiers, and a class
+  // holding astral members becomes an alternation of surrogate sequences.
+  const rxHex = (u) => "\\u" + u.toString(16).toUpperCase().padStart(4, "0");
+  const rxUnitEscape = (cp) => {
+    if (cp < 0x10000) return rxHex(cp);
+    const v = cp - 0x10000;
+    return "(?:" + rxHex(0xd800 + (v >> 10)) + rxHex(0xdc00 + (v & 0x3ff)) + ")";
+  };
+  const rxBraceEscape = (pattern, i) => {
+    const close = pattern.indexOf("}", i + 3);
+    const digits = close > 0 ? pattern.slice(i + 3, close) : "";
+    const cp = /^[0-9A-Fa-f]{1,6}$/.test(digits) ? parseInt(digits, 16) : -1;
+    if (cp < 0 || cp > 0x10ffff || (cp >= 0xd800 && cp <= 0xdfff)) throw new SyntaxError("invalid escape");
+    return { cp, end: close };
+  };
+  const rxAstralRange = (lo, hi) => {
+    const hs = (cp) => 0xd800 + ((cp - 0x10000) >> 10);
+    const ls = (cp) => 0xdc00 + ((cp - 0x10000) & 0x3ff);
+    const unit = (a, b) => (a === b ? rxHex(a) : "[" + rxHex(a) + "-" + rxHex(b) + "]");
+    if (hs(lo) === hs(hi)) return [rxHex(hs(lo)) + unit(ls(lo), ls(hi))];
+    const out = [rxHex(hs(lo)) + unit(ls(lo), 0xdfff)];
+    if (hs(hi) - hs(lo) > 1) out.push(unit(hs(lo) + 1, hs(hi) - 1) + "[\\uDC00-\\uDFFF]");
+    out.push(rxHex(hs(hi)) + unit(0xdc00, ls(hi)));
+    return out;
+  };
+  const rxClassControl = { n: 0x0a, t: 0x09, r: 0x0d, f: 0x0c, v: 0x0b };
+  // Class starting at pattern[i] === "[": null when it has no astral member
+  // (plain translation applies), else { text, end } with end on the "]". A
+  // negated class never matches a lone surrogate, so a search cannot stop
+  // inside a pair.
+  const rxTranslateClass = (pattern, i) => {
+    let j = i + 1;
+    const neg = pattern[j] === "^";
+    if (neg) j += 1;
+    if (pattern[j] === "]") return null;
+    const item = () => {
+      const c = pattern[j];
+      if (c === "\\" && j + 1 < pattern.length) {
+        const nx = pattern[j + 1];
+        if (nx === "u" && pattern[j + 2] === "{") {
+          const e = rxBraceEscape(pattern, j);
+          j = e.end + 1;
+          return { cp: e.cp, text: rxHex(e.cp) };
+        }
+        j += 2;
+        if (rxClassControl[nx] !== undefined) return { cp: rxClassControl[nx], text: "\\" + nx };
+        if (!/[0-9A-Za-z]/.test(nx)) return { cp: nx.charCodeAt(0), text: "\\" + nx };
+        return { cp: -1, text: "\\" + nx };
+      }
+      const u = pattern.charCodeAt(j);
+      const u2 = pattern.charCodeAt(j + 1);
+      if (u >= 0xd800 && u <= 0xdbff && u2 >= 0xdc00 && u2 <= 0xdfff) {
+        j += 2;
+        const cp = 0x10000 + ((u - 0xd800) << 10) + (u2 - 0xdc00);
+        return { cp, text: "" };
+      }
+      j += 1;
+      return { cp: u, text: rxHex(u) };
+    };
+    let bmp = "";
+    const astral = [];
+    const add = (lo, hi) => {
+      if (lo < 0x10000) bmp += hi < 0x10000 ? (lo === hi ? rxHex(lo) : rxHex(lo) + "-" + rxHex(hi)) : rxHex(lo) + "-\\uFFFF";
+      if (hi >= 0x10000) astral.push(...rxAstralRange(Math.max(lo, 0x10000), hi));
+    };
+    while (j < pattern.length && pattern[j] !== "]") {
+      const a = item();
+      if (a.cp < 0) {
+        bmp += a.text;
+        continue;
+      }
+      if (pattern[j] === "-" && j + 1 < pattern.length && pattern[j + 1] !== "]") {
+        j += 1;
+        const b = item();
+        if (b.cp < 0) {
+          add(a.cp, a.cp);
+          bmp += "\\-" + b.text;
+        } else {
+          if (b.cp < a.cp) throw new SyntaxError("inverted range in class");
+          add(a.cp, b.cp);
+        }
+        continue;
+      }
+      add(a.cp, a.cp);
+    }
+    if (j >= pattern.length || astral.length === 0) return null;
+    const alts = astral.join("|");
+    if (neg) return { text: "(?:(?!" + alts + ")(?:[\\uD800-\\uDBFF][\\uDC00-\\uDFFF]|[^" + bmp + "\\uD800-\\uDFFF]))", end: j };
+    return { text: bmp ? "(?:[" + bmp + "]|" + alts + ")" : "(?:" + alts + ")", end: j };
+  };
+  const rxTranslatePattern = (pattern, dotAll) => {
     let out = "";
     let inClass = false;
     for (let i = 0; i < pattern.length; i += 1) {
       const ch = pattern[i];
       if (ch === "\\" && i + 1 < pattern.length) {
         const nx = pattern[i + 1];
+        if (nx === "u" && pattern[i + 2] === "{") {
+          const e = rxBraceEscape(pattern, i);
+          out += inClass ? rxHex(e.cp) : rxUnitEscape(e.cp);
+          i = e.end;
+          continue;
+        }
         if (!inClass) {
           if (nx === "d") {
             out += "[0-9]";
@@ -2712,8 +3559,24 @@ function buildModuleEnv(ast, file, hooks = null) {
         i += 1;
         continue;
       }
-      if (!inClass && ch === "[") inClass = true;
-      else if (inClass && ch === "]") inClass = false;
+      if (!inClass && ch === ".") {
+        out += dotAll ? "." : "[^\\n]";
+        continue;
+      }
+      if (!inClass && ch === "[") {
+        const cls = rxTranslateClass(pattern, i);
+        if (cls) {
+          out += cls.text;
+          i = cls.end;
+          continue;
+        }
+        inClass = true;
+      } else if (inClass && ch === "]") inClass = false;
+      else if (!inClass && /[\uD800-\uDBFF]/.test(ch) && /[\uDC00-\uDFFF]/.test(pattern[i + 1] || "")) {
+        out += "(?:" + ch + pattern[i + 1] + ")";
+        i += 1;
+        continue;
+      }
       out += ch;
     }
     return out;
@@ -2771,7 +3634,7 @@ function buildModuleEnv(ast, file, hooks = null) {
     }
     let re = null;
     try {
-      re = new RegExp(rxTranslatePattern(pattern), outFlags);
+      re = new RegExp(rxTranslatePattern(pattern, uniq.has("s")), outFlags);
     } catch (e) {
       rxThrow("RegExpSyntax", node, e && e.message ? String(e.message) : "invalid pattern");
     }
@@ -2801,6 +3664,28 @@ function buildModuleEnv(ast, file, hooks = null) {
     }
     return out;
   });
+  rxMod.functions.set("findAllSpans", (r, input, start, max, node) => {
+    const rr = rxEnsure(r, node);
+    const m = rxCheckMax(max, node, "max");
+    if (m < -1) rxThrow("RegExpRange", node, "max out of range");
+    const out = makeList([]);
+    if (m === 0) return out;
+    let cur = rxCheckRange(input, start, node);
+    const glyphs = Array.from(input).length;
+    let produced = 0;
+    while (cur <= glyphs) {
+      const one = rxFind(rr, input, BigInt(cur), node);
+      if (!one.__fields.ok) break;
+      out.push(one.__fields.start, one.__fields.end);
+      produced += 1;
+      if (m > 0 && produced >= m) break;
+      const a = Number(one.__fields.start);
+      const b = Number(one.__fields.end);
+      cur = b <= a ? b + 1 : b;
+    }
+    bumpList(out);
+    return out;
+  });
   rxMod.functions.set("replaceFirst", (r, input, replacement, start, node) => {
     const rr = rxEnsure(r, node);
     if (typeof input !== "string" || typeof replacement !== "string") rxThrow("RegExpRange", node, "invalid arguments");
@@ -3837,6 +4722,11 @@ function evalCall(expr, scope, functions, moduleEnv, protoEnv, file, callFunctio
             rdiag(file, m, "R1013", "RUNTIME_CLONE_NOT_SUPPORTED", "clone not supported for builtin handle Walker")
           );
         }
+        if (target && target.__json_reader) {
+          throw new RuntimeError(
+            rdiag(file, m, "R1013", "RUNTIME_CLONE_NOT_SUPPORTED", "clone not supported for builtin handle JSONReader")
+          );
+        }
         return objectCloneDefault(protoEnv, target, { scope, functions, moduleEnv, protoEnv, file, callFunction, node: m });
       }
       if (isObjectInstance(target) && target.__fields) {
@@ -3997,6 +4887,35 @@ function evalCall(expr, scope, functions, moduleEnv, protoEnv, file, callFunctio
         return null;
       }
     }
+    if (target && target.__json_reader) {
+      const reader = target;
+      const where = { file, node: m };
+      const jsonFail = (msg) => {
+        throw new RuntimeError(rdiag(file, m, "R1010", "RUNTIME_JSON_ERROR", msg));
+      };
+      if (reader.closed) jsonFail("JSONReader is closed. got closed reader; expected open reader");
+      if (m.name === "hasNext") return jsonReaderHasValue(reader, where);
+      if (m.name === "next") {
+        if (!jsonReaderHasValue(reader, where)) jsonFail("no more JSON values. got end of values; expected JSON value");
+        return jsonReaderReadValue(reader, where);
+      }
+      if (m.name === "nextEvent") return jsonReaderNextEvent(reader, where);
+      if (m.name === "key") {
+        if (reader.key === null) jsonFail("no current JSON key. got no key event; expected key event");
+        return reader.key;
+      }
+      if (m.name === "value") {
+        if (reader.value === null) jsonFail("no current JSON value. got no value event; expected value event");
+        return reader.value;
+      }
+      if (m.name === "close") {
+        reader.key = null;
+        reader.value = null;
+        jsonReaderReleaseInput(reader);
+        reader.closed = true;
+        return null;
+      }
+    }
     if (target && target.__fs_walker) {
       const walker = target;
       if (m.name === "clone") {
@@ -57,6 +57,7 @@ cc -std=c11 -Wall -Wextra -Werror -O2 -Dps_module_init=ps_module_init_JSON \
   "$ROOT_DIR/c/runtime/ps_map.c" \
   "$ROOT_DIR/c/runtime/ps_json.c" \
   "$ROOT_DIR/c/runtime/ps_modules.c" \
+  "$ROOT_DIR/c/runtime/ps_profile.c" \
   "$ROOT_DIR/c/runtime/ps_dynlib_posix.c" \
   "$ROOT_DIR/c/runtime/ps_vm.c" \
   "$ROOT_DIR/c/modules/debug.c" \
@@ -115,6 +116,7 @@ cc -std=c11 -Wall -Wextra -Werror -O2 -Dps_module_init=ps_module_init_Fs \
   "$ROOT_DIR/c/runtime/ps_map.c" \
   "$ROOT_DIR/c/runtime/ps_json.c" \
   "$ROOT_DIR/c/runtime/ps_modules.c" \
+  "$ROOT_DIR/c/runtime/ps_profile.c" \
   "$ROOT_DIR/c/runtime/ps_dynlib_posix.c" \
   "$ROOT_DIR/c/runtime/ps_vm.c" \
   "$ROOT_DIR/c/modules/debug.c" \
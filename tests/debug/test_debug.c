@@ -312,13 +312,13 @@ int main(void) {
   ps_list_push_internal(ctx, list_view_src, v11);
   ps_list_push_internal(ctx, list_view_src, v12);
   ps_list_push_internal(ctx, list_view_src, v13);
-  PS_Value *view = ps_value_alloc(PS_V_VIEW);
+  PS_Value *view = ps_value_alloc(ctx, PS_V_VIEW);
   view->as.view_v.source = ps_value_retain(list_view_src);
   view->as.view_v.offset = 1;
   view->as.view_v.len = 2;
   view->as.view_v.readonly = 1;
   view->as.view_v.version = list_view_src->as.list_v.version;
-  view->as.view_v.type_name = strdup("view<int>");
+  view->as.view_v.type_name = ps_intern("view<int>");
   debug_dump_value(ctx, &mod, view);
 
   PS_Value *list_large = ps_list_new(ctx);
@@ -369,7 +369,7 @@ int main(void) {
   fprintf(stderr, "-- groups --\n");
   PS_Value *group_val = ps_make_int(ctx, 65535);
   debug_dump_value(ctx, &mod, group_val);
-  PS_Value *group_type = ps_value_alloc(PS_V_GROUP);
+  PS_Value *group_type = ps_value_alloc(ctx, PS_V_GROUP);
   group_type->as.group_v.group = ps_ir_find_group(ir, "Color");
   debug_dump_value(ctx, &mod, group_type);
 
@@ -6,8 +6,13 @@
 
 #include "ps/ps_api.h"
 
-static const char *JSON_KIND_KEY = "__json_kind";
-static const char *JSON_VALUE_KEY = "__json_value";
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#define JSON_HAVE_AVX2 1
+#endif
 
 typedef struct {
   char *buf;
@@ -150,190 +155,181 @@ static size_t utf8_glyph_len_local(const uint8_t *s, size_t len) {
   return glyphs;
 }
 
-static PS_Value *json_make_value(PS_Context *ctx, const char *kind, PS_Value *value) {
-  PS_Value *obj = ps_make_object(ctx);
-  if (!obj) return NULL;
-  if (ps_object_set_proto_name(ctx, obj, "JSONValue") != PS_OK) {
-    ps_value_release(obj);
-    return NULL;
-  }
-  PS_Value *k = ps_make_string_utf8(ctx, kind, strlen(kind));
-  if (!k) {
-    ps_value_release(obj);
-    return NULL;
-  }
-  if (ps_object_set_str(ctx, obj, JSON_KIND_KEY, strlen(JSON_KIND_KEY), k) != PS_OK) {
-    ps_value_release(k);
-    ps_value_release(obj);
-    return NULL;
+// JSONValue string argument of decode/isValid: its payload.
+static PS_Value *json_string_payload(PS_Value *v) {
+  PS_JsonKind kind;
+  if (!ps_json_kind(v, &kind) || kind != PS_JSON_KIND_STRING) return NULL;
+  return ps_json_payload(v);
+}
+
+// Encoder output: the whole document in a growing buffer (encode), or a fixed
+// buffer flushed to a File each time it fills up (encodeTo), so that the
+// memory used does not depend on the size of the document.
+typedef struct {
+  PS_Context *ctx;
+  StrBuf sb;
+  PS_Value *file; // NULL: keep everything in sb
+} JsonOut;
+
+#define JSON_OUT_CHUNK 65536
+
+static void jo_init(JsonOut *o, PS_Context *ctx, PS_Value *file) {
+  o->ctx = ctx;
+  o->file = file;
+  sb_init(&o->sb);
+}
+
+static int jo_flush(JsonOut *o) {
+  if (o->sb.len == 0) return 1;
+  if (ps_file_write(o->ctx, o->file, o->sb.buf, o->sb.len) != PS_OK) return 0;
+  o->sb.len = 0;
+  return 1;
+}
+
+static int jo_append(JsonOut *o, const char *s, size_t n) {
+  if (o->file && o->sb.len + n > JSON_OUT_CHUNK) {
+    if (!jo_flush(o)) return 0;
+    if (n >= JSON_OUT_CHUNK) return ps_file_write(o->ctx, o->file, s, n) == PS_OK;
   }
-  ps_value_release(k);
-  if (value) {
-    if (ps_object_set_str(ctx, obj, JSON_VALUE_KEY, strlen(JSON_VALUE_KEY), value) != PS_OK) {
-      ps_value_release(obj);
-      return NULL;
-    }
+  if (!sb_append(&o->sb, s, n)) {
+    ps_throw(o->ctx, PS_ERR_OOM, "out of memory");
+    return 0;
   }
-  return obj;
+  return 1;
 }
 
-static int json_value_kind(PS_Context *ctx, PS_Value *v, const char **kind, PS_Value **out_val) {
-  if (!v || ps_typeof(v) != PS_T_OBJECT) return 0;
-  PS_Value *k = ps_object_get_str(ctx, v, JSON_KIND_KEY, strlen(JSON_KIND_KEY));
-  if (!k || ps_typeof(k) != PS_T_STRING) return 0;
-  if (kind) *kind = ps_string_ptr(k);
-  if (out_val) *out_val = ps_object_get_str(ctx, v, JSON_VALUE_KEY, strlen(JSON_VALUE_KEY));
-  return 1;
+static int jo_append_c(JsonOut *o, char c) {
+  if (o->sb.len + 1 < o->sb.cap && (!o->file || o->sb.len < JSON_OUT_CHUNK)) {
+    o->sb.buf[o->sb.len++] = c;
+    o->sb.buf[o->sb.len] = '\0';
+    return 1;
+  }
+  return jo_append(o, &c, 1);
 }
 
-static int json_encode_value(PS_Context *ctx, PS_Value *v, StrBuf *sb);
+static int json_encode_value(JsonOut *o, PS_Value *v);
 
-static int encode_string(PS_Context *ctx, const char *s, size_t len, StrBuf *sb) {
-  (void)ctx;
-  if (!sb_append_c(sb, '"')) return 0;
+// Runs of bytes that need no escape are appended at once.
+static int encode_string(JsonOut *o, const char *s, size_t len) {
+  if (!jo_append_c(o, '"')) return 0;
+  size_t run = 0;
   for (size_t i = 0; i < len; i++) {
     unsigned char c = (unsigned char)s[i];
+    if (c >= 0x20 && c != '"' && c != '\\') continue;
+    if (i > run && !jo_append(o, s + run, i - run)) return 0;
+    run = i + 1;
     switch (c) {
-      case '"': if (!sb_append(sb, "\\\"", 2)) return 0; break;
-      case '\\': if (!sb_append(sb, "\\\\", 2)) return 0; break;
-      case '\b': if (!sb_append(sb, "\\b", 2)) return 0; break;
-      case '\f': if (!sb_append(sb, "\\f", 2)) return 0; break;
-      case '\n': if (!sb_append(sb, "\\n", 2)) return 0; break;
-      case '\r': if (!sb_append(sb, "\\r", 2)) return 0; break;
-      case '\t': if (!sb_append(sb, "\\t", 2)) return 0; break;
-      default:
-        if (c < 0x20) {
-          char buf[7];
-          snprintf(buf, sizeof(buf), "\\u%04x", (unsigned)c);
-          if (!sb_append(sb, buf, 6)) return 0;
-        } else {
-          if (!sb_append_c(sb, (char)c)) return 0;
-        }
+      case '"': if (!jo_append(o, "\\\"", 2)) return 0; break;
+      case '\\': if (!jo_append(o, "\\\\", 2)) return 0; break;
+      case '\b': if (!jo_append(o, "\\b", 2)) return 0; break;
+      case '\f': if (!jo_append(o, "\\f", 2)) return 0; break;
+      case '\n': if (!jo_append(o, "\\n", 2)) return 0; break;
+      case '\r': if (!jo_append(o, "\\r", 2)) return 0; break;
+      case '\t': if (!jo_append(o, "\\t", 2)) return 0; break;
+      default: {
+        char buf[7];
+        snprintf(buf, sizeof(buf), "\\u%04x", (unsigned)c);
+        if (!jo_append(o, buf, 6)) return 0;
         break;
+      }
     }
   }
-  return sb_append_c(sb, '"');
+  if (len > run && !jo_append(o, s + run, len - run)) return 0;
+  return jo_append_c(o, '"');
 }
 
-static int encode_number(PS_Context *ctx, double v, StrBuf *sb) {
+static int encode_number(JsonOut *o, double v) {
   if (!isfinite(v)) {
-    ps_throw(ctx, PS_ERR_TYPE, "invalid JSON number. got JSON value; expected expected JSON type");
+    ps_throw(o->ctx, PS_ERR_TYPE, "invalid JSON number. got JSON value; expected expected JSON type");
     return 0;
   }
-  if (v == 0.0 && signbit(v)) return sb_append(sb, "-0", 2);
+  if (v == 0.0 && signbit(v)) return jo_append(o, "-0", 2);
   char buf[64];
   int n = snprintf(buf, sizeof(buf), "%.17g", v);
   if (n <= 0) return 0;
-  return sb_append(sb, buf, (size_t)n);
+  return jo_append(o, buf, (size_t)n);
 }
 
-static int encode_object(PS_Context *ctx, PS_Value *obj, StrBuf *sb) {
+static int encode_object(JsonOut *o, PS_Value *obj) {
   if (!obj || ps_typeof(obj) != PS_T_MAP) {
-    ps_throw(ctx, PS_ERR_TYPE, "object expects map<string,JSONValue>");
+    ps_throw(o->ctx, PS_ERR_TYPE, "object expects map<string,JSONValue>");
     return 0;
   }
   size_t len = ps_map_len(obj);
-  if (!sb_append_c(sb, '{')) return 0;
+  if (!jo_append_c(o, '{')) return 0;
   for (size_t i = 0; i < len; i++) {
     PS_Value *key = NULL;
     PS_Value *val = NULL;
-    if (ps_map_entry(ctx, obj, i, &key, &val) != PS_OK) return 0;
+    if (ps_map_entry(o->ctx, obj, i, &key, &val) != PS_OK) return 0;
     if (!key || ps_typeof(key) != PS_T_STRING) {
-      ps_throw(ctx, PS_ERR_TYPE, "object expects map<string,JSONValue>");
+      ps_throw(o->ctx, PS_ERR_TYPE, "object expects map<string,JSONValue>");
       return 0;
     }
-    if (i > 0 && !sb_append_c(sb, ',')) return 0;
-    if (!encode_string(ctx, ps_string_ptr(key), ps_string_len(key), sb)) return 0;
-    if (!sb_append_c(sb, ':')) return 0;
-    if (!json_encode_value(ctx, val, sb)) return 0;
+    if (i > 0 && !jo_append_c(o, ',')) return 0;
+    if (!encode_string(o, ps_string_ptr(key), ps_string_len(key))) return 0;
+    if (!jo_append_c(o, ':')) return 0;
+    if (!json_encode_value(o, val)) return 0;
+  }
+  return jo_append_c(o, '}');
+}
+
+static int encode_array(JsonOut *o, PS_Value *list) {
+  if (!jo_append_c(o, '[')) return 0;
+  size_t n = ps_list_len(list);
+  for (size_t i = 0; i < n; i++) {
+    PS_Value *item = ps_list_get(o->ctx, list, i);
+    if (!item) return 0;
+    if (i > 0 && !jo_append_c(o, ',')) return 0;
+    if (!json_encode_value(o, item)) return 0;
   }
-  return sb_append_c(sb, '}');
+  return jo_append_c(o, ']');
 }
 
-static int json_encode_value(PS_Context *ctx, PS_Value *v, StrBuf *sb) {
+static int json_encode_value(JsonOut *o, PS_Value *v) {
   if (!v) {
-    ps_throw(ctx, PS_ERR_TYPE, "null value");
+    ps_throw(o->ctx, PS_ERR_TYPE, "null value");
     return 0;
   }
-  const char *kind = NULL;
-  PS_Value *jval = NULL;
-  if (json_value_kind(ctx, v, &kind, &jval)) {
-    if (strcmp(kind, "null") == 0) return sb_append(sb, "null", 4);
-    if (strcmp(kind, "bool") == 0) {
-      if (!jval || ps_typeof(jval) != PS_T_BOOL) {
-        ps_throw(ctx, PS_ERR_TYPE, "invalid JsonBool");
-        return 0;
-      }
-      return sb_append(sb, ps_as_bool(jval) ? "true" : "false", ps_as_bool(jval) ? 4 : 5);
-    }
-    if (strcmp(kind, "number") == 0) {
-      if (!jval || ps_typeof(jval) != PS_T_FLOAT) {
-        ps_throw(ctx, PS_ERR_TYPE, "invalid JsonNumber");
-        return 0;
-      }
-      return encode_number(ctx, ps_as_float(jval), sb);
-    }
-    if (strcmp(kind, "string") == 0) {
-      if (!jval || ps_typeof(jval) != PS_T_STRING) {
-        ps_throw(ctx, PS_ERR_TYPE, "invalid JsonString");
-        return 0;
-      }
-      return encode_string(ctx, ps_string_ptr(jval), ps_string_len(jval), sb);
-    }
-    if (strcmp(kind, "array") == 0) {
-      if (!jval || ps_typeof(jval) != PS_T_LIST) {
-        ps_throw(ctx, PS_ERR_TYPE, "invalid JsonArray");
-        return 0;
-      }
-      if (!sb_append_c(sb, '[')) return 0;
-      size_t n = ps_list_len(jval);
-      for (size_t i = 0; i < n; i++) {
-        PS_Value *item = ps_list_get(ctx, jval, i);
-        if (!item) return 0;
-        if (i > 0 && !sb_append_c(sb, ',')) return 0;
-        if (!json_encode_value(ctx, item, sb)) return 0;
-      }
-      return sb_append_c(sb, ']');
-    }
-    if (strcmp(kind, "object") == 0) {
-      if (!jval || ps_typeof(jval) != PS_T_MAP) {
-        ps_throw(ctx, PS_ERR_TYPE, "invalid JsonObject");
-        return 0;
-      }
-      return encode_object(ctx, jval, sb);
+  PS_JsonKind kind;
+  if (ps_json_kind(v, &kind)) {
+    PS_Value *jval = ps_json_payload(v);
+    switch (kind) {
+      case PS_JSON_KIND_NULL:
+        return jo_append(o, "null", 4);
+      case PS_JSON_KIND_BOOL:
+        return jo_append(o, ps_json_bool(v) ? "true" : "false", ps_json_bool(v) ? 4 : 5);
+      case PS_JSON_KIND_NUMBER:
+        return encode_number(o, ps_json_number(v));
+      case PS_JSON_KIND_STRING:
+        return encode_string(o, ps_string_ptr(jval), ps_string_len(jval));
+      case PS_JSON_KIND_ARRAY:
+        return encode_array(o, jval);
+      case PS_JSON_KIND_OBJECT:
+        return encode_object(o, jval);
     }
   }
 
   switch (ps_typeof(v)) {
     case PS_T_BOOL:
-      return sb_append(sb, ps_as_bool(v) ? "true" : "false", ps_as_bool(v) ? 4 : 5);
+      return jo_append(o, ps_as_bool(v) ? "true" : "false", ps_as_bool(v) ? 4 : 5);
     case PS_T_INT: {
       char buf[64];
       int n = snprintf(buf, sizeof(buf), "%lld", (long long)ps_as_int(v));
       if (n <= 0) return 0;
-      return sb_append(sb, buf, (size_t)n);
+      return jo_append(o, buf, (size_t)n);
     }
     case PS_T_FLOAT:
-      return encode_number(ctx, ps_as_float(v), sb);
+      return encode_number(o, ps_as_float(v));
     case PS_T_STRING:
-      return encode_string(ctx, ps_string_ptr(v), ps_string_len(v), sb);
-    case PS_T_LIST: {
-      if (!sb_append_c(sb, '[')) return 0;
-      size_t n = ps_list_len(v);
-      for (size_t i = 0; i < n; i++) {
-        PS_Value *item = ps_list_get(ctx, v, i);
-        if (!item) return 0;
-        if (i > 0 && !sb_append_c(sb, ',')) return 0;
-        if (!json_encode_value(ctx, item, sb)) return 0;
-      }
-      return sb_append_c(sb, ']');
-    }
+      return encode_string(o, ps_string_ptr(v), ps_string_len(v));
+    case PS_T_LIST:
+      return encode_array(o, v);
     case PS_T_MAP:
-      return encode_object(ctx, v, sb);
+      return encode_object(o, v);
     case PS_T_OBJECT:
-      return encode_object(ctx, v, sb);
+      return encode_object(o, v);
     default:
-      ps_throw(ctx, PS_ERR_TYPE, "value not JSON-serializable");
+      ps_throw(o->ctx, PS_ERR_TYPE, "value not JSON-serializable");
       return 0;
   }
 }
@@ -387,75 +383,108 @@ static int append_utf8(StrBuf *sb, uint32_t cp) {
   return 0;
 }
 
-static PS_Value *parse_string(JsonParser *p) {
-  if (p->pos >= p->len || p->src[p->pos] != '"') return NULL;
-  p->pos++;
+static int hex4(const char *s, uint32_t *out) {
+  uint32_t cp = 0;
+  for (int i = 0; i < 4; i++) {
+    char h = s[i];
+    cp <<= 4;
+    if (h >= '0' && h <= '9') cp |= (uint32_t)(h - '0');
+    else if (h >= 'a' && h <= 'f') cp |= (uint32_t)(10 + h - 'a');
+    else if (h >= 'A' && h <= 'F') cp |= (uint32_t)(10 + h - 'A');
+    else return 0;
+  }
+  *out = cp;
+  return 1;
+}
+
+// Builds the string whose JSON body (quotes excluded) is src[start, end).
+// Unescaped runs are copied in one piece. `utf8_checked` is set when the
+// caller already validated src, so the result is adopted without a second
+// UTF-8 pass.
+static PS_Value *json_make_string(PS_Context *ctx, const char *src, size_t start, size_t end, int utf8_checked) {
+  const char *bs = (const char *)memchr(src + start, '\\', end - start);
+  if (!bs && !utf8_checked) return ps_make_string_utf8(ctx, src + start, end - start);
+  if (!bs) {
+    char *copy = (char *)malloc(end - start + 1);
+    if (!copy) {
+      ps_throw(ctx, PS_ERR_OOM, "out of memory");
+      return NULL;
+    }
+    memcpy(copy, src + start, end - start);
+    return ps_make_string_utf8_owned(ctx, copy, end - start);
+  }
   StrBuf sb;
   sb_init(&sb);
-  while (p->pos < p->len) {
-    unsigned char c = (unsigned char)p->src[p->pos++];
-    if (c == '"') {
-      PS_Value *s = ps_make_string_utf8(p->ctx, sb.buf ? sb.buf : "", sb.len);
-      sb_free(&sb);
-      return s;
-    }
-    if (c == '\\') {
-      if (p->pos >= p->len) break;
-      unsigned char e = (unsigned char)p->src[p->pos++];
-      switch (e) {
-        case '"': sb_append_c(&sb, '"'); break;
-        case '\\': sb_append_c(&sb, '\\'); break;
-        case '/': sb_append_c(&sb, '/'); break;
-        case 'b': sb_append_c(&sb, '\b'); break;
-        case 'f': sb_append_c(&sb, '\f'); break;
-        case 'n': sb_append_c(&sb, '\n'); break;
-        case 'r': sb_append_c(&sb, '\r'); break;
-        case 't': sb_append_c(&sb, '\t'); break;
-        case 'u': {
-          if (p->pos + 4 > p->len) break;
-          uint32_t cp = 0;
-          for (int i = 0; i < 4; i++) {
-            char h = p->src[p->pos++];
-            cp <<= 4;
-            if (h >= '0' && h <= '9') cp |= (uint32_t)(h - '0');
-            else if (h >= 'a' && h <= 'f') cp |= (uint32_t)(10 + h - 'a');
-            else if (h >= 'A' && h <= 'F') cp |= (uint32_t)(10 + h - 'A');
-            else cp = 0xFFFFFFFF;
-          }
-          if (cp == 0xFFFFFFFF) break;
-          if (cp >= 0xD800 && cp <= 0xDBFF) {
-            if (p->pos + 6 <= p->len && p->src[p->pos] == '\\' && p->src[p->pos + 1] == 'u') {
-              p->pos += 2;
-              uint32_t lo = 0;
-              for (int i = 0; i < 4; i++) {
-                char h = p->src[p->pos++];
-                lo <<= 4;
-                if (h >= '0' && h <= '9') lo |= (uint32_t)(h - '0');
-                else if (h >= 'a' && h <= 'f') lo |= (uint32_t)(10 + h - 'a');
-                else if (h >= 'A' && h <= 'F') lo |= (uint32_t)(10 + h - 'A');
-                else lo = 0xFFFFFFFF;
-              }
-              if (lo != 0xFFFFFFFF && lo >= 0xDC00 && lo <= 0xDFFF) {
-                cp = 0x10000 + (((cp - 0xD800) << 10) | (lo - 0xDC00));
-              }
-            }
-          }
-          if (!append_utf8(&sb, cp)) break;
-          break;
+  size_t i = start;
+  while (i < end) {
+    size_t run_end = bs ? (size_t)(bs - src) : end;
+    if (run_end > i && !sb_append(&sb, src + i, run_end - i)) goto oom;
+    i = run_end;
+    if (i >= end) break;
+    if (++i >= end) goto invalid;
+    char e = src[i++];
+    int ok = 1;
+    switch (e) {
+      case '"': ok = sb_append_c(&sb, '"'); break;
+      case '\\': ok = sb_append_c(&sb, '\\'); break;
+      case '/': ok = sb_append_c(&sb, '/'); break;
+      case 'b': ok = sb_append_c(&sb, '\b'); break;
+      case 'f': ok = sb_append_c(&sb, '\f'); break;
+      case 'n': ok = sb_append_c(&sb, '\n'); break;
+      case 'r': ok = sb_append_c(&sb, '\r'); break;
+      case 't': ok = sb_append_c(&sb, '\t'); break;
+      case 'u': {
+        uint32_t cp = 0;
+        if (i + 4 > end || !hex4(src + i, &cp)) goto invalid;
+        i += 4;
+        if (cp >= 0xDC00 && cp <= 0xDFFF) goto invalid;
+        if (cp >= 0xD800 && cp <= 0xDBFF) {
+          uint32_t lo = 0;
+          if (i + 6 > end || src[i] != '\\' || src[i + 1] != 'u' || !hex4(src + i + 2, &lo)) goto invalid;
+          if (lo < 0xDC00 || lo > 0xDFFF) goto invalid;
+          i += 6;
+          cp = 0x10000 + (((cp - 0xD800) << 10) | (lo - 0xDC00));
         }
-        default:
-          break;
+        ok = append_utf8(&sb, cp);
+        break;
       }
-      continue;
+      default:
+        goto invalid;
     }
-    if (c < 0x20) break;
-    sb_append_c(&sb, (char)c);
+    if (!ok) goto oom;
+    bs = i < end ? (const char *)memchr(src + i, '\\', end - i) : NULL;
   }
+  if (utf8_checked) return ps_make_string_utf8_owned(ctx, sb.buf, sb.len);
+  PS_Value *s = ps_make_string_utf8(ctx, sb.buf ? sb.buf : "", sb.len);
   sb_free(&sb);
-  ps_throw(p->ctx, PS_ERR_TYPE, "invalid JSON string");
+  return s;
+oom:
+  sb_free(&sb);
+  ps_throw(ctx, PS_ERR_OOM, "out of memory");
+  return NULL;
+invalid:
+  sb_free(&sb);
+  ps_throw(ctx, PS_ERR_TYPE, "invalid JSON string");
   return NULL;
 }
 
+static PS_Value *parse_string(JsonParser *p) {
+  if (p->pos >= p->len || p->src[p->pos] != '"') return NULL;
+  size_t start = ++p->pos;
+  size_t end = start;
+  while (end < p->len) {
+    unsigned char c = (unsigned char)p->src[end];
+    if (c == '"' || c < 0x20) break;
+    end += c == '\\' ? 2 : 1;
+  }
+  if (end >= p->len || p->src[end] != '"') {
+    ps_throw(p->ctx, PS_ERR_TYPE, "invalid JSON string");
+    return NULL;
+  }
+  p->pos = end + 1;
+  return json_make_string(p->ctx, p->src, start, end, 0);
+}
+
 static PS_Value *parse_value(JsonParser *p);
 
 static PS_Value *parse_array(JsonParser *p) {
@@ -466,7 +495,7 @@ static PS_Value *parse_array(JsonParser *p) {
   if (!list) return NULL;
   if (p->pos < p->len && p->src[p->pos] == ']') {
     p->pos++;
-    PS_Value *out = json_make_value(p->ctx, "array", list);
+    PS_Value *out = ps_make_json(p->ctx, PS_JSON_KIND_ARRAY, list);
     ps_value_release(list);
     return out;
   }
@@ -486,7 +515,7 @@ static PS_Value *parse_array(JsonParser *p) {
     }
     if (p->pos < p->len && p->src[p->pos] == ']') {
       p->pos++;
-      PS_Value *out = json_make_value(p->ctx, "array", list);
+      PS_Value *out = ps_make_json(p->ctx, PS_JSON_KIND_ARRAY, list);
       ps_value_release(list);
       return out;
     }
@@ -505,7 +534,7 @@ static PS_Value *parse_object(JsonParser *p) {
   if (!obj) return NULL;
   if (p->pos < p->len && p->src[p->pos] == '}') {
     p->pos++;
-    PS_Value *out = json_make_value(p->ctx, "object", obj);
+    PS_Value *out = ps_make_json(p->ctx, PS_JSON_KIND_OBJECT, obj);
     ps_value_release(obj);
     return out;
   }
@@ -546,7 +575,7 @@ static PS_Value *parse_object(JsonParser *p) {
     }
     if (p->pos < p->len && p->src[p->pos] == '}') {
       p->pos++;
-      PS_Value *out = json_make_value(p->ctx, "object", obj);
+      PS_Value *out = ps_make_json(p->ctx, PS_JSON_KIND_OBJECT, obj);
       ps_value_release(obj);
       return out;
     }
@@ -600,11 +629,7 @@ static PS_Value *parse_number(JsonParser *p) {
     ps_throw(p->ctx, PS_ERR_TYPE, "invalid JSON number. got JSON value; expected expected JSON type");
     return NULL;
   }
-  PS_Value *fv = ps_make_float(p->ctx, v);
-  if (!fv) return NULL;
-  PS_Value *out = json_make_value(p->ctx, "number", fv);
-  ps_value_release(fv);
-  return out;
+  return ps_make_json_number(p->ctx, v);
 }
 
 static PS_Value *parse_value(JsonParser *p) {
@@ -614,27 +639,15 @@ static PS_Value *parse_value(JsonParser *p) {
   if (c == '"') {
     PS_Value *s = parse_string(p);
     if (!s) return NULL;
-    PS_Value *out = json_make_value(p->ctx, "string", s);
+    PS_Value *out = ps_make_json(p->ctx, PS_JSON_KIND_STRING, s);
     ps_value_release(s);
     return out;
   }
   if (c == '{') return parse_object(p);
   if (c == '[') return parse_array(p);
-  if (c == 't' && match(p, "true")) {
-    PS_Value *b = ps_make_bool(p->ctx, 1);
-    PS_Value *out = json_make_value(p->ctx, "bool", b);
-    ps_value_release(b);
-    return out;
-  }
-  if (c == 'f' && match(p, "false")) {
-    PS_Value *b = ps_make_bool(p->ctx, 0);
-    PS_Value *out = json_make_value(p->ctx, "bool", b);
-    ps_value_release(b);
-    return out;
-  }
-  if (c == 'n' && match(p, "null")) {
-    return json_make_value(p->ctx, "null", NULL);
-  }
+  if (c == 't' && match(p, "true")) return ps_make_json_bool(p->ctx, 1);
+  if (c == 'f' && match(p, "false")) return ps_make_json_bool(p->ctx, 0);
+  if (c == 'n' && match(p, "null")) return ps_make_json_null(p->ctx);
   if (c == '-' || (c >= '0' && c <= '9')) {
     return parse_number(p);
   }
@@ -642,7 +655,8 @@ static PS_Value *parse_value(JsonParser *p) {
   return NULL;
 }
 
-static PS_Value *json_parse(PS_Context *ctx, const char *s, size_t len) {
+// Recursive descent parser, used for small documents.
+static PS_Value *json_parse_direct(PS_Context *ctx, const char *s, size_t len) {
   JsonParser p = {s, len, 0, ctx};
   PS_Value *v = parse_value(&p);
   if (!v) return NULL;
@@ -655,165 +669,1700 @@ static PS_Value *json_parse(PS_Context *ctx, const char *s, size_t len) {
   return v;
 }
 
-static PS_Status mod_encode(PS_Context *ctx, int argc, PS_Value **argv, PS_Value **out) {
-  (void)argc;
-  StrBuf sb;
-  sb_init(&sb);
-  if (!json_encode_value(ctx, argv[0], &sb)) {
-    sb_free(&sb);
-    return PS_ERR;
+// Two-stage decoder for larger documents (simdjson-style). Stage 1 indexes the
+// document 64 bytes at a time with bit masks: the positions of the structural
+// characters ({}[]:,), of both quotes of every string and of the first byte of
+// every other token. It also validates UTF-8, so stage 2 adopts string bodies
+// without checking them again. Stage 2 walks the index with an explicit stack
+// and builds the values; string bodies and numbers are read from spans it gives.
+// Blocks are classified with AVX2 when the CPU has it (checked at run time),
+// else SSE2 or the scalar loop.
+#define JSON_BLOCK 64
+// Below this size the direct parser is faster than building the index.
+#define JSON_INDEX_MIN_LEN 64
+
+typedef struct {
+  uint32_t *pos;
+  size_t len;
+  size_t cap;
+} JsonIndex;
+
+typedef struct {
+  uint64_t quote;
+  uint64_t backslash;
+  uint64_t op;   // {}[]:,
+  uint64_t ws;   // space, \t, \n, \r
+  uint64_t ctrl; // bytes < 0x20
+  uint64_t high; // bytes >= 0x80 (multi-byte UTF-8 sequences)
+} JsonBlockMasks;
+
+#if defined(__SSE2__)
+static void json_classify_block(const uint8_t *b, JsonBlockMasks *m) {
+  memset(m, 0, sizeof(*m));
+  const __m128i ctrl_max = _mm_set1_epi8(0x1F);
+  for (int i = 0; i < JSON_BLOCK / 16; i++) {
+    __m128i x = _mm_loadu_si128((const __m128i *)(const void *)(b + 16 * i));
+    __m128i op = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(x, _mm_set1_epi8('{')), _mm_cmpeq_epi8(x, _mm_set1_epi8('}'))),
+                              _mm_or_si128(_mm_cmpeq_epi8(x, _mm_set1_epi8('[')), _mm_cmpeq_epi8(x, _mm_set1_epi8(']'))));
+    op = _mm_or_si128(op, _mm_or_si128(_mm_cmpeq_epi8(x, _mm_set1_epi8(':')), _mm_cmpeq_epi8(x, _mm_set1_epi8(','))));
+    __m128i ws = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(x, _mm_set1_epi8(' ')), _mm_cmpeq_epi8(x, _mm_set1_epi8('\t'))),
+                              _mm_or_si128(_mm_cmpeq_epi8(x, _mm_set1_epi8('\n')), _mm_cmpeq_epi8(x, _mm_set1_epi8('\r'))));
+    int shift = 16 * i;
+    m->quote |= (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(x, _mm_set1_epi8('"'))) << shift;
+    m->backslash |= (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(x, _mm_set1_epi8('\\'))) << shift;
+    m->op |= (uint64_t)(uint16_t)_mm_movemask_epi8(op) << shift;
+    m->ws |= (uint64_t)(uint16_t)_mm_movemask_epi8(ws) << shift;
+    m->ctrl |= (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_min_epu8(x, ctrl_max), x)) << shift;
+    m->high |= (uint64_t)(uint16_t)_mm_movemask_epi8(x) << shift;
+  }
+}
+#else
+static void json_classify_block(const uint8_t *b, JsonBlockMasks *m) {
+  memset(m, 0, sizeof(*m));
+  for (int i = 0; i < JSON_BLOCK; i++) {
+    uint64_t bit = 1ULL << i;
+    switch (b[i]) {
+      case '"': m->quote |= bit; break;
+      case '\\': m->backslash |= bit; break;
+      case '{': case '}': case '[': case ']': case ':': case ',': m->op |= bit; break;
+      case ' ': m->ws |= bit; break;
+      case '\t': case '\n': case '\r': m->ws |= bit; m->ctrl |= bit; break;
+      default:
+        if (b[i] < 0x20) m->ctrl |= bit;
+        if (b[i] >= 0x80) m->high |= bit;
+        break;
+    }
   }
-  PS_Value *s = ps_make_string_utf8(ctx, sb.buf ? sb.buf : "", sb.len);
-  sb_free(&sb);
-  if (!s) return PS_ERR;
-  *out = s;
-  return PS_OK;
 }
+#endif
 
-static PS_Status mod_decode(PS_Context *ctx, int argc, PS_Value **argv, PS_Value **out) {
-  (void)argc;
-  PS_Value *sval = argv[0];
-  if (sval && ps_typeof(sval) == PS_T_BYTES) {
-    PS_Value *tmp = ps_bytes_to_utf8_string(ctx, sval);
-    if (!tmp) return PS_ERR;
-    sval = tmp;
+#if defined(JSON_HAVE_AVX2)
+__attribute__((target("avx2"))) static void json_classify_block_avx2(const uint8_t *b, JsonBlockMasks *m) {
+  memset(m, 0, sizeof(*m));
+  const __m256i ctrl_max = _mm256_set1_epi8(0x1F);
+  for (int i = 0; i < JSON_BLOCK / 32; i++) {
+    __m256i x = _mm256_loadu_si256((const __m256i *)(const void *)(b + 32 * i));
+    __m256i op = _mm256_or_si256(
+        _mm256_or_si256(_mm256_cmpeq_epi8(x, _mm256_set1_epi8('{')), _mm256_cmpeq_epi8(x, _mm256_set1_epi8('}'))),
+        _mm256_or_si256(_mm256_cmpeq_epi8(x, _mm256_set1_epi8('[')), _mm256_cmpeq_epi8(x, _mm256_set1_epi8(']'))));
+    op = _mm256_or_si256(op, _mm256_or_si256(_mm256_cmpeq_epi8(x, _mm256_set1_epi8(':')),
+                                             _mm256_cmpeq_epi8(x, _mm256_set1_epi8(','))));
+    __m256i ws = _mm256_or_si256(
+        _mm256_or_si256(_mm256_cmpeq_epi8(x, _mm256_set1_epi8(' ')), _mm256_cmpeq_epi8(x, _mm256_set1_epi8('\t'))),
+        _mm256_or_si256(_mm256_cmpeq_epi8(x, _mm256_set1_epi8('\n')), _mm256_cmpeq_epi8(x, _mm256_set1_epi8('\r'))));
+    int shift = 32 * i;
+    m->quote |= (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(x, _mm256_set1_epi8('"'))) << shift;
+    m->backslash |= (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(x, _mm256_set1_epi8('\\'))) << shift;
+    m->op |= (uint64_t)(uint32_t)_mm256_movemask_epi8(op) << shift;
+    m->ws |= (uint64_t)(uint32_t)_mm256_movemask_epi8(ws) << shift;
+    m->ctrl |= (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_min_epu8(x, ctrl_max), x)) << shift;
+    m->high |= (uint64_t)(uint32_t)_mm256_movemask_epi8(x) << shift;
   }
-  if (sval && ps_typeof(sval) == PS_T_OBJECT) {
-    const char *kind = NULL;
-    PS_Value *jval = NULL;
-    if (json_value_kind(ctx, sval, &kind, &jval) && kind && strcmp(kind, "string") == 0 &&
-        jval && ps_typeof(jval) == PS_T_STRING) {
-      sval = jval;
+}
+#endif
+
+typedef void (*JsonClassifyFn)(const uint8_t *b, JsonBlockMasks *m);
+
+static JsonClassifyFn json_classifier(void) {
+#if defined(JSON_HAVE_AVX2)
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) return json_classify_block_avx2;
+#endif
+  return json_classify_block;
+}
+
+// Bit i set iff an odd number of bits are set at or below i.
+static uint64_t prefix_xor(uint64_t x) {
+  x ^= x << 1;
+  x ^= x << 2;
+  x ^= x << 4;
+  x ^= x << 8;
+  x ^= x << 16;
+  x ^= x << 32;
+  return x;
+}
+
+// 0 on an unterminated string, a control character inside a string or invalid
+// UTF-8; -1 when out of memory.
+static int json_index_build(const char *src, size_t len, JsonIndex *ix) {
+  JsonClassifyFn classify = json_classifier();
+  uint64_t prev_escaped = 0;   // last byte of the previous block escapes bit 0
+  uint64_t prev_in_string = 0; // all ones when the previous block ended inside a string
+  uint64_t prev_scalar = 0;    // last byte of the previous block was part of a token
+  size_t utf8_end = 0;         // end of the last multi-byte sequence checked
+  uint8_t tail[JSON_BLOCK];
+  for (size_t base = 0; base < len; base += JSON_BLOCK) {
+    const uint8_t *block = (const uint8_t *)src + base;
+    if (len - base < JSON_BLOCK) {
+      memset(tail, ' ', sizeof(tail));
+      memcpy(tail, block, len - base);
+      block = tail;
+    }
+    JsonBlockMasks m;
+    classify(block, &m);
+
+    // UTF-8: all-ASCII blocks cost one test. Otherwise each sequence is checked
+    // from its lead byte and may end in the next block; the continuation bytes
+    // it covers are skipped, and a stray one fails as a lead byte.
+    uint64_t high = m.high;
+    while (high) {
+      size_t at = base + (size_t)__builtin_ctzll(high);
+      high &= high - 1;
+      if (at < utf8_end) continue;
+      uint32_t cp = 0;
+      utf8_end = at;
+      if (utf8_next((const uint8_t *)src, len, &utf8_end, &cp) != 1 || (cp >= 0xD800 && cp <= 0xDFFF)) return 0;
+    }
+
+    // Escaped bytes: each backslash not itself escaped escapes the next byte.
+    // Backslashes are rare, so they are walked one by one.
+    uint64_t escaped = prev_escaped;
+    uint64_t bs = m.backslash & ~prev_escaped;
+    prev_escaped = 0;
+    while (bs) {
+      int i = __builtin_ctzll(bs);
+      escaped |= 2ULL << i;
+      if (i == 63) prev_escaped = 1;
+      bs &= ~(3ULL << i);
+    }
+
+    uint64_t quote = m.quote & ~escaped;
+    uint64_t in_string = prefix_xor(quote) ^ prev_in_string; // [opening quote, closing quote)
+    prev_in_string = 0 - (in_string >> 63);
+    uint64_t string_tail = in_string ^ quote; // (opening quote, closing quote]
+    if (m.ctrl & string_tail) return 0;
+
+    uint64_t scalar = ~(m.op | m.ws);
+    uint64_t nonquote_scalar = scalar & ~quote;
+    uint64_t token_start = nonquote_scalar & ~((nonquote_scalar << 1) | prev_scalar);
+    prev_scalar = nonquote_scalar >> 63;
+    uint64_t structurals = ((m.op | token_start) & ~(in_string | string_tail)) | quote;
+
+    size_t need = ix->len + (size_t)__builtin_popcountll(structurals);
+    if (need > ix->cap) {
+      size_t cap = ix->cap ? ix->cap : len / 8 + JSON_BLOCK;
+      while (cap < need) cap *= 2;
+      uint32_t *n = (uint32_t *)realloc(ix->pos, cap * sizeof(uint32_t));
+      if (!n) return -1;
+      ix->pos = n;
+      ix->cap = cap;
+    }
+    while (structurals) {
+      ix->pos[ix->len++] = (uint32_t)(base + (size_t)__builtin_ctzll(structurals));
+      structurals &= structurals - 1;
     }
   }
-  if (!sval || ps_typeof(sval) != PS_T_STRING) {
-    ps_throw(ctx, PS_ERR_TYPE, "decode expects string");
-    return PS_ERR;
-  }
-  const char *s = ps_string_ptr(sval);
-  size_t len = ps_string_len(sval);
-  PS_Value *v = json_parse(ctx, s ? s : "", len);
-  if (sval != argv[0]) ps_value_release(sval);
-  if (!v) {
-    ps_throw(ctx, PS_ERR_TYPE, "invalid JSON. got JSON value; expected expected JSON type");
-    return PS_ERR;
+  return prev_in_string ? 0 : 1;
+}
+
+static int json_is_delim(unsigned char c) {
+  switch (c) {
+    case '{': case '}': case '[': case ']': case ':': case ',': case '"':
+    case ' ': case '\t': case '\n': case '\r':
+      return 1;
+    default:
+      return 0;
   }
-  *out = v;
-  return PS_OK;
 }
 
-static PS_Status mod_isvalid(PS_Context *ctx, int argc, PS_Value **argv, PS_Value **out) {
-  (void)argc;
-  PS_Value *sval = argv[0];
-  if (sval && ps_typeof(sval) == PS_T_BYTES) {
-    PS_Value *tmp = ps_bytes_to_utf8_string(ctx, sval);
-    if (!tmp) return PS_ERR;
-    sval = tmp;
+// Number or literal token starting at src[at].
+static PS_Value *json_make_atom(PS_Context *ctx, const char *src, size_t len, size_t at) {
+  size_t end = at;
+  while (end < len && !json_is_delim((unsigned char)src[end])) end++;
+  size_t n = end - at;
+  if (n == 4 && memcmp(src + at, "true", 4) == 0) return ps_make_json_bool(ctx, 1);
+  if (n == 5 && memcmp(src + at, "false", 5) == 0) return ps_make_json_bool(ctx, 0);
+  if (n == 4 && memcmp(src + at, "null", 4) == 0) return ps_make_json_null(ctx);
+  if (src[at] != '-' && (src[at] < '0' || src[at] > '9')) return NULL;
+  JsonParser p = {src, end, at, ctx};
+  PS_Value *v = parse_number(&p);
+  if (v && p.pos != end) {
+    ps_value_release(v);
+    return NULL;
   }
-  if (sval && ps_typeof(sval) == PS_T_OBJECT) {
-    const char *kind = NULL;
-    PS_Value *jval = NULL;
-    if (json_value_kind(ctx, sval, &kind, &jval) && kind && strcmp(kind, "string") == 0 &&
-        jval && ps_typeof(jval) == PS_T_STRING) {
-      sval = jval;
+  return v;
+}
+
+typedef struct {
+  PS_Value *container; // list or map under construction
+  PS_Value *key;       // pending key (objects)
+  int is_object;
+} JsonFrame;
+
+static PS_Value *json_parse_indexed(PS_Context *ctx, const char *src, size_t len) {
+  JsonIndex ix = {NULL, 0, 0};
+  JsonFrame *stack = NULL;
+  size_t depth = 0;
+  size_t stack_cap = 0;
+  PS_Value *root = NULL;
+  int rc = json_index_build(src, len, &ix);
+  if (rc < 0) goto oom;
+  if (rc == 0) goto invalid;
+  const uint32_t *pos = ix.pos;
+  size_t n = ix.len;
+  size_t k = 0;
+  for (;;) {
+    // A value starts at pos[k].
+    if (k >= n) goto invalid;
+    char c = src[pos[k]];
+    PS_Value *v = NULL;
+    if (c == '[' || c == '{') {
+      if (depth == stack_cap) {
+        size_t cap = stack_cap ? stack_cap * 2 : 16;
+        JsonFrame *ns = (JsonFrame *)realloc(stack, cap * sizeof(JsonFrame));
+        if (!ns) goto oom;
+        stack = ns;
+        stack_cap = cap;
+      }
+      JsonFrame *f = &stack[depth];
+      f->is_object = c == '{';
+      f->key = NULL;
+      f->container = f->is_object ? ps_make_map(ctx) : ps_make_list(ctx);
+      if (!f->container) goto fail;
+      depth++;
+      k++;
+      if (k < n && src[pos[k]] == (f->is_object ? '}' : ']')) {
+        k++;
+        depth--;
+        v = ps_make_json(ctx, f->is_object ? PS_JSON_KIND_OBJECT : PS_JSON_KIND_ARRAY, f->container);
+        ps_value_release(f->container);
+        if (!v) goto fail;
+      } else if (f->is_object) {
+        goto key;
+      } else {
+        continue;
+      }
+    } else if (c == '"') {
+      PS_Value *s = json_make_string(ctx, src, pos[k] + 1, pos[k + 1], 1);
+      if (!s) goto fail;
+      k += 2;
+      v = ps_make_json(ctx, PS_JSON_KIND_STRING, s);
+      ps_value_release(s);
+      if (!v) goto fail;
+    } else {
+      v = json_make_atom(ctx, src, len, pos[k]);
+      if (!v) goto invalid;
+      k++;
     }
+    // v is complete: store it in the enclosing containers, closing those that end here.
+    for (;;) {
+      if (depth == 0) {
+        root = v;
+        if (k != n) goto invalid;
+        goto done;
+      }
+      JsonFrame *f = &stack[depth - 1];
+      int ok = f->is_object ? ps_map_set(ctx, f->container, f->key, v) != 0 : ps_list_push(ctx, f->container, v) == PS_OK;
+      ps_value_release(v);
+      if (f->key) ps_value_release(f->key);
+      f->key = NULL;
+      if (!ok) goto fail;
+      if (k >= n) goto invalid;
+      char d = src[pos[k++]];
+      if (d == ',') {
+        if (f->is_object) goto key;
+        break;
+      }
+      if (d != (f->is_object ? '}' : ']')) goto invalid;
+      depth--;
+      v = ps_make_json(ctx, f->is_object ? PS_JSON_KIND_OBJECT : PS_JSON_KIND_ARRAY, f->container);
+      ps_value_release(f->container);
+      if (!v) goto fail;
+    }
+    continue;
+  key:
+    // Object member: "key" : value
+    if (k + 2 >= n || src[pos[k]] != '"' || src[pos[k + 2]] != ':') goto invalid;
+    stack[depth - 1].key = json_make_string(ctx, src, pos[k] + 1, pos[k + 1], 1);
+    if (!stack[depth - 1].key) goto fail;
+    k += 3;
   }
-  if (!sval || ps_typeof(sval) != PS_T_STRING) {
-    ps_throw(ctx, PS_ERR_TYPE, "isValid expects string");
-    return PS_ERR;
-  }
-  const char *s = ps_string_ptr(sval);
-  size_t len = ps_string_len(sval);
-  PS_Value *v = json_parse(ctx, s ? s : "", len);
-  if (sval != argv[0]) ps_value_release(sval);
-  if (!v) {
-    ps_clear_error(ctx);
-    *out = ps_make_bool(ctx, 0);
-    return *out ? PS_OK : PS_ERR;
+done:
+  free(ix.pos);
+  free(stack);
+  return root;
+oom:
+  ps_throw(ctx, PS_ERR_OOM, "out of memory");
+  goto fail;
+invalid:
+  ps_throw(ctx, PS_ERR_TYPE, "invalid JSON. got JSON value; expected expected JSON type");
+fail:
+  if (root) ps_value_release(root);
+  while (depth > 0) {
+    depth--;
+    if (stack[depth].key) ps_value_release(stack[depth].key);
+    ps_value_release(stack[depth].container);
   }
-  ps_value_release(v);
-  *out = ps_make_bool(ctx, 1);
-  return *out ? PS_OK : PS_ERR;
+  free(ix.pos);
+  free(stack);
+  return NULL;
 }
 
-static PS_Status mod_null(PS_Context *ctx, int argc, PS_Value **argv, PS_Value **out) {
-  (void)argc;
-  (void)argv;
-  PS_Value *v = json_make_value(ctx, "null", NULL);
-  if (!v) return PS_ERR;
-  *out = v;
-  return PS_OK;
+static PS_Value *json_parse(PS_Context *ctx, const char *s, size_t len) {
+  if (len < JSON_INDEX_MIN_LEN || len > UINT32_MAX) return json_parse_direct(ctx, s, len);
+  return json_parse_indexed(ctx, s, len);
 }
 
-static PS_Status mod_bool(PS_Context *ctx, int argc, PS_Value **argv, PS_Value **out) {
-  (void)argc;
-  if (!argv[0] || ps_typeof(argv[0]) != PS_T_BOOL) {
-    ps_throw(ctx, PS_ERR_TYPE, "bool expects bool");
-    return PS_ERR;
+// JSON.decodeAs<T>(text): schema-directed decoding. The target type is compiled
+// once into a JsonSchema graph (prototype layouts come from ps_proto_field_*),
+// then the parser builds the ProtoScript values directly, without JSONValue
+// nodes in between. Members of an object decoded into a prototype are matched
+// to its fields through a perfect hash generated for that prototype.
+typedef enum {
+  JSON_SCHEMA_INT,
+  JSON_SCHEMA_FLOAT,
+  JSON_SCHEMA_BOOL,
+  JSON_SCHEMA_BYTE,
+  JSON_SCHEMA_STRING,
+  JSON_SCHEMA_ANY,
+  JSON_SCHEMA_LIST,
+  JSON_SCHEMA_MAP,
+  JSON_SCHEMA_PROTO
+} JsonSchemaKind;
+
+typedef struct JsonSchema JsonSchema;
+
+typedef struct {
+  char *name;
+  size_t name_len;
+  char *type;
+  JsonSchema *schema;
+} JsonSchemaField;
+
+struct JsonSchema {
+  JsonSchemaKind kind;
+  char *type_name;
+  JsonSchema *elem;
+  JsonSchemaField *fields;
+  size_t field_count;
+  uint32_t seed;
+  uint32_t mask;
+  int32_t *slots;
+  unsigned mark;
+  JsonSchema *next;
+};
+
+// Schemas of the running program, keyed by canonical type name. Prototype
+// layouts are checked against ps_proto_field_* on every call.
+static JsonSchema *g_json_schemas = NULL;
+static unsigned g_json_schema_mark = 0;
+
+static void json_schema_reset(void) {
+  while (g_json_schemas) {
+    JsonSchema *s = g_json_schemas;
+    g_json_schemas = s->next;
+    for (size_t i = 0; i < s->field_count; i++) {
+      free(s->fields[i].name);
+      free(s->fields[i].type);
+    }
+    free(s->fields);
+    free(s->slots);
+    free(s->type_name);
+    free(s);
   }
-  PS_Value *b = ps_make_bool(ctx, ps_as_bool(argv[0]));
-  if (!b) return PS_ERR;
-  PS_Value *v = json_make_value(ctx, "bool", b);
-  ps_value_release(b);
-  if (!v) return PS_ERR;
-  *out = v;
-  return PS_OK;
 }
 
-static PS_Status mod_number(PS_Context *ctx, int argc, PS_Value **argv, PS_Value **out) {
-  (void)argc;
-  double x = 0.0;
-  if (ps_typeof(argv[0]) == PS_T_INT) x = (double)ps_as_int(argv[0]);
-  else if (ps_typeof(argv[0]) == PS_T_FLOAT) x = ps_as_float(argv[0]);
-  else {
-    ps_throw(ctx, PS_ERR_TYPE, "number expects float");
-    return PS_ERR;
-  }
-  if (!isfinite(x)) {
-    ps_throw(ctx, PS_ERR_TYPE, "invalid JSON number. got JSON value; expected expected JSON type");
-    return PS_ERR;
+static char *json_type_canon(const char *t, size_t len) {
+  char *out = (char *)malloc(len + 1);
+  if (!out) return NULL;
+  size_t j = 0;
+  for (size_t i = 0; i < len; i++) {
+    if (!isspace((unsigned char)t[i])) out[j++] = t[i];
   }
-  PS_Value *f = ps_make_float(ctx, x);
-  if (!f) return PS_ERR;
-  PS_Value *v = json_make_value(ctx, "number", f);
-  ps_value_release(f);
-  if (!v) return PS_ERR;
-  *out = v;
-  return PS_OK;
+  out[j] = '\0';
+  return out;
 }
 
-static PS_Status mod_string(PS_Context *ctx, int argc, PS_Value **argv, PS_Value **out) {
-  (void)argc;
-  if (!argv[0] || ps_typeof(argv[0]) != PS_T_STRING) {
-    ps_throw(ctx, PS_ERR_TYPE, "string expects string");
-    return PS_ERR;
+static uint32_t json_field_hash(uint32_t seed, const char *s, size_t len) {
+  uint32_t h = 2166136261u ^ (seed * 0x9E3779B9u);
+  for (size_t i = 0; i < len; i++) {
+    h ^= (unsigned char)s[i];
+    h *= 16777619u;
   }
-  PS_Value *s = ps_make_string_utf8(ctx, ps_string_ptr(argv[0]), ps_string_len(argv[0]));
-  if (!s) return PS_ERR;
-  PS_Value *v = json_make_value(ctx, "string", s);
-  ps_value_release(s);
-  if (!v) return PS_ERR;
-  *out = v;
-  return PS_OK;
+  return h ^ (h >> 16);
 }
 
-static PS_Status mod_array(PS_Context *ctx, int argc, PS_Value **argv, PS_Value **out) {
-  (void)argc;
-  if (!argv[0] || ps_typeof(argv[0]) != PS_T_LIST) {
-    ps_throw(ctx, PS_ERR_TYPE, "array expects list<JSONValue>");
-    return PS_ERR;
+// Smallest table (a power of two, at least twice the field count) for which
+// some seed maps every field name to its own slot.
+static int json_schema_hash_fields(JsonSchema *s) {
+  uint32_t size = 4;
+  while (size < 2 * s->field_count) size <<= 1;
+  for (; size <= (1u << 20); size <<= 1) {
+    int32_t *slots = (int32_t *)malloc(size * sizeof(int32_t));
+    if (!slots) return 0;
+    for (uint32_t seed = 1; seed <= 64; seed++) {
+      for (uint32_t i = 0; i < size; i++) slots[i] = -1;
+      size_t k = 0;
+      for (; k < s->field_count; k++) {
+        uint32_t h = json_field_hash(seed, s->fields[k].name, s->fields[k].name_len) & (size - 1);
+        if (slots[h] >= 0) break;
+        slots[h] = (int32_t)k;
+      }
+      if (k == s->field_count) {
+        s->slots = slots;
+        s->seed = seed;
+        s->mask = size - 1;
+        return 1;
+      }
+    }
+    free(slots);
+  }
+  return 0;
+}
+
+static int json_schema_field_index(const JsonSchema *s, const char *key, size_t len) {
+  int32_t k = s->slots[json_field_hash(s->seed, key, len) & s->mask];
+  if (k < 0) return -1;
+  const JsonSchemaField *f = &s->fields[k];
+  return (f->name_len == len && memcmp(f->name, key, len) == 0) ? k : -1;
+}
+
+static JsonSchema *json_schema_build(PS_Context *ctx, const char *type, size_t len) {
+  char *canon = json_type_canon(type, len);
+  if (!canon) return NULL;
+  for (JsonSchema *s = g_json_schemas; s; s = s->next) {
+    if (strcmp(s->type_name, canon) == 0) {
+      free(canon);
+      return s;
+    }
+  }
+  JsonSchema *s = (JsonSchema *)calloc(1, sizeof(JsonSchema));
+  if (!s) {
+    free(canon);
+    return NULL;
+  }
+  s->type_name = canon;
+  s->next = g_json_schemas;
+  g_json_schemas = s;
+  size_t n = strlen(canon);
+  if (strcmp(canon, "int") == 0) s->kind = JSON_SCHEMA_INT;
+  else if (strcmp(canon, "float") == 0) s->kind = JSON_SCHEMA_FLOAT;
+  else if (strcmp(canon, "bool") == 0) s->kind = JSON_SCHEMA_BOOL;
+  else if (strcmp(canon, "byte") == 0) s->kind = JSON_SCHEMA_BYTE;
+  else if (strcmp(canon, "string") == 0) s->kind = JSON_SCHEMA_STRING;
+  else if (strcmp(canon, "JSONValue") == 0) s->kind = JSON_SCHEMA_ANY;
+  else if (n > 6 && strncmp(canon, "list<", 5) == 0 && canon[n - 1] == '>') {
+    s->kind = JSON_SCHEMA_LIST;
+    s->elem = json_schema_build(ctx, canon + 5, n - 6);
+    if (!s->elem) return NULL;
+  } else if (n > 12 && strncmp(canon, "map<string,", 11) == 0 && canon[n - 1] == '>') {
+    s->kind = JSON_SCHEMA_MAP;
+    s->elem = json_schema_build(ctx, canon + 11, n - 12);
+    if (!s->elem) return NULL;
+  } else {
+    // Registered before its fields are compiled: recursive prototypes end on it.
+    s->kind = JSON_SCHEMA_PROTO;
+    size_t count = 0;
+    if (strchr(canon, '<') || !ps_proto_field_count(ctx, canon, &count)) return NULL;
+    s->fields = (JsonSchemaField *)calloc(count ? count : 1, sizeof(JsonSchemaField));
+    if (!s->fields) return NULL;
+    for (size_t i = 0; i < count; i++) {
+      const char *name = NULL;
+      const char *ftype = NULL;
+      if (!ps_proto_field_at(ctx, canon, i, &name, &ftype) || !name || !ftype) return NULL;
+      JsonSchemaField *f = &s->fields[s->field_count++];
+      f->name = strdup(name);
+      f->type = strdup(ftype);
+      if (!f->name || !f->type) return NULL;
+      f->name_len = strlen(name);
+      f->schema = json_schema_build(ctx, ftype, strlen(ftype));
+      if (!f->schema) return NULL;
+    }
+    if (!json_schema_hash_fields(s)) return NULL;
+  }
+  return s;
+}
+
+static int json_schema_current(PS_Context *ctx, JsonSchema *s) {
+  if (s->mark == g_json_schema_mark) return 1;
+  s->mark = g_json_schema_mark;
+  if (s->kind == JSON_SCHEMA_LIST || s->kind == JSON_SCHEMA_MAP) return json_schema_current(ctx, s->elem);
+  if (s->kind != JSON_SCHEMA_PROTO) return 1;
+  size_t count = 0;
+  if (!ps_proto_field_count(ctx, s->type_name, &count) || count != s->field_count) return 0;
+  for (size_t i = 0; i < count; i++) {
+    const char *name = NULL;
+    const char *ftype = NULL;
+    if (!ps_proto_field_at(ctx, s->type_name, i, &name, &ftype) || !name || !ftype) return 0;
+    if (strcmp(name, s->fields[i].name) != 0 || strcmp(ftype, s->fields[i].type) != 0) return 0;
+    if (!json_schema_current(ctx, s->fields[i].schema)) return 0;
+  }
+  return 1;
+}
+
+static JsonSchema *json_schema_get(PS_Context *ctx, const char *type, size_t len) {
+  for (int attempt = 0; attempt < 2; attempt++) {
+    JsonSchema *s = json_schema_build(ctx, type, len);
+    if (!s) break;
+    if (++g_json_schema_mark == 0) g_json_schema_mark = 1;
+    if (json_schema_current(ctx, s)) return s;
+    // Another program (or a redefinition) changed a layout: start over.
+    json_schema_reset();
+  }
+  json_schema_reset();
+  return NULL;
+}
+
+// Position of the value being decoded, formatted only for diagnostics:
+// $ for the document, .field, [index] and ["key"] for map entries.
+typedef struct JsonPath {
+  const struct JsonPath *up;
+  const char *key;
+  size_t key_len;
+  size_t index;
+  int quoted;
+} JsonPath;
+
+static void json_path_format(StrBuf *sb, const JsonPath *path) {
+  if (!path) {
+    sb_append_c(sb, '$');
+    return;
+  }
+  json_path_format(sb, path->up);
+  if (path->key && path->quoted) {
+    sb_append(sb, "[\"", 2);
+    sb_append(sb, path->key, path->key_len);
+    sb_append(sb, "\"]", 2);
+  } else if (path->key) {
+    sb_append_c(sb, '.');
+    sb_append(sb, path->key, path->key_len);
+  } else {
+    char tmp[32];
+    int n = snprintf(tmp, sizeof(tmp), "[%zu]", path->index);
+    sb_append(sb, tmp, (size_t)n);
+  }
+}
+
+static PS_Value *json_as_invalid(JsonParser *p) {
+  ps_throw(p->ctx, PS_ERR_TYPE, "invalid JSON. got JSON value; expected expected JSON type");
+  return NULL;
+}
+
+static PS_Value *json_as_fail(JsonParser *p, const char *what, const JsonPath *path, const char *got,
+                              const char *expected) {
+  StrBuf sb;
+  sb_init(&sb);
+  sb_append(&sb, what, strlen(what));
+  sb_append(&sb, " at ", 4);
+  json_path_format(&sb, path);
+  sb_append(&sb, ". got ", 6);
+  sb_append(&sb, got, strlen(got));
+  sb_append(&sb, "; expected ", 11);
+  sb_append(&sb, expected, strlen(expected));
+  ps_throw(p->ctx, PS_ERR_TYPE, sb.buf ? sb.buf : what);
+  sb_free(&sb);
+  return NULL;
+}
+
+// The next value does not have the shape of `s`: reported with its JSON kind,
+// unless it is not a JSON value at all.
+static PS_Value *json_as_mismatch(JsonParser *p, const JsonSchema *s, const JsonPath *path) {
+  const char *got = NULL;
+  switch (p->pos < p->len ? p->src[p->pos] : '\0') {
+    case '"': got = "string"; break;
+    case '{': got = "object"; break;
+    case '[': got = "array"; break;
+    case 't':
+    case 'f': got = "bool"; break;
+    case 'n': got = "null"; break;
+    case '-':
+    case '0': case '1': case '2': case '3': case '4':
+    case '5': case '6': case '7': case '8': case '9': got = "number"; break;
+    default: return json_as_invalid(p);
+  }
+  return json_as_fail(p, "JSON type mismatch", path, got, s->type_name);
+}
+
+// Skips a string token; [*start, *end) is its body, escapes not decoded.
+static int json_scan_string(JsonParser *p, size_t *start, size_t *end) {
+  if (p->pos >= p->len || p->src[p->pos] != '"') return 0;
+  size_t i = p->pos + 1;
+  while (i < p->len) {
+    unsigned char c = (unsigned char)p->src[i];
+    if (c == '"' || c < 0x20) break;
+    i += c == '\\' ? 2 : 1;
+  }
+  if (i >= p->len || p->src[i] != '"') return 0;
+  *start = p->pos + 1;
+  *end = i;
+  p->pos = i + 1;
+  return 1;
+}
+
+// Same checks as json_make_string, without building the string.
+static int json_check_escapes(const char *src, size_t i, size_t end) {
+  const char *bs = (const char *)memchr(src + i, '\\', end - i);
+  while (bs) {
+    i = (size_t)(bs - src) + 1;
+    if (i >= end) return 0;
+    char e = src[i++];
+    if (e == 'u') {
+      uint32_t cp = 0;
+      if (i + 4 > end || !hex4(src + i, &cp)) return 0;
+      i += 4;
+      if (cp >= 0xDC00 && cp <= 0xDFFF) return 0;
+      if (cp >= 0xD800 && cp <= 0xDBFF) {
+        uint32_t lo = 0;
+        if (i + 6 > end || src[i] != '\\' || src[i + 1] != 'u' || !hex4(src + i + 2, &lo)) return 0;
+        if (lo < 0xDC00 || lo > 0xDFFF) return 0;
+        i += 6;
+      }
+    } else if (!strchr("\"\\/bfnrt", e) || e == '\0') {
+      return 0;
+    }
+    bs = i < end ? (const char *)memchr(src + i, '\\', end - i) : NULL;
+  }
+  return 1;
+}
+
+// Skips a number token; *integral tells whether it has neither fraction nor
+// exponent.
+static int json_scan_number(JsonParser *p, int *integral) {
+  size_t i = p->pos;
+  if (i < p->len && p->src[i] == '-') i++;
+  if (i >= p->len) return 0;
+  if (p->src[i] == '0') {
+    i++;
+  } else if (p->src[i] >= '1' && p->src[i] <= '9') {
+    while (i < p->len && isdigit((unsigned char)p->src[i])) i++;
+  } else {
+    return 0;
+  }
+  *integral = 1;
+  if (i < p->len && p->src[i] == '.') {
+    i++;
+    if (i >= p->len || !isdigit((unsigned char)p->src[i])) return 0;
+    while (i < p->len && isdigit((unsigned char)p->src[i])) i++;
+    *integral = 0;
+  }
+  if (i < p->len && (p->src[i] == 'e' || p->src[i] == 'E')) {
+    i++;
+    if (i < p->len && (p->src[i] == '+' || p->src[i] == '-')) i++;
+    if (i >= p->len || !isdigit((unsigned char)p->src[i])) return 0;
+    while (i < p->len && isdigit((unsigned char)p->src[i])) i++;
+    *integral = 0;
+  }
+  p->pos = i;
+  return 1;
+}
+
+// Validates and skips a member that no field asks for; builds nothing.
+static int json_skip_value(JsonParser *p) {
+  skip_ws(p);
+  if (p->pos >= p->len) return 0;
+  char c = p->src[p->pos];
+  if (c == '"') {
+    size_t start = 0, end = 0;
+    return json_scan_string(p, &start, &end) && json_check_escapes(p->src, start, end);
+  }
+  if (c == '[' || c == '{') {
+    char close = c == '[' ? ']' : '}';
+    p->pos++;
+    skip_ws(p);
+    if (p->pos < p->len && p->src[p->pos] == close) {
+      p->pos++;
+      return 1;
+    }
+    while (1) {
+      if (c == '{') {
+        size_t start = 0, end = 0;
+        skip_ws(p);
+        if (!json_scan_string(p, &start, &end) || !json_check_escapes(p->src, start, end)) return 0;
+        skip_ws(p);
+        if (p->pos >= p->len || p->src[p->pos] != ':') return 0;
+        p->pos++;
+      }
+      if (!json_skip_value(p)) return 0;
+      skip_ws(p);
+      if (p->pos < p->len && p->src[p->pos] == ',') {
+        p->pos++;
+        continue;
+      }
+      if (p->pos < p->len && p->src[p->pos] == close) {
+        p->pos++;
+        return 1;
+      }
+      return 0;
+    }
+  }
+  if (c == 't') return match(p, "true");
+  if (c == 'f') return match(p, "false");
+  if (c == 'n') return match(p, "null");
+  int integral = 0;
+  return json_scan_number(p, &integral);
+}
+
+static PS_Value *json_decode_as_value(JsonParser *p, const JsonSchema *s, const JsonPath *path);
+
+static PS_Value *json_decode_as_integer(JsonParser *p, const JsonSchema *s, const JsonPath *path) {
+  size_t start = p->pos;
+  int integral = 0;
+  if (!json_scan_number(p, &integral)) return json_as_invalid(p);
+  if (!integral) return json_as_fail(p, "JSON type mismatch", path, "non-integer number", s->type_name);
+  int neg = p->src[start] == '-';
+  uint64_t limit = s->kind == JSON_SCHEMA_BYTE ? (neg ? 0u : 255u) : (neg ? (uint64_t)INT64_MAX + 1u : (uint64_t)INT64_MAX);
+  uint64_t acc = 0;
+  for (size_t i = start + (size_t)neg; i < p->pos; i++) {
+    uint64_t d = (uint64_t)(p->src[i] - '0');
+    if (acc > (limit - d) / 10u) return json_as_fail(p, "JSON type mismatch", path, "number out of range", s->type_name);
+    acc = acc * 10u + d;
+  }
+  if (s->kind == JSON_SCHEMA_BYTE) return ps_make_byte(p->ctx, (uint8_t)acc);
+  return ps_make_int(p->ctx, neg ? (int64_t)(0u - acc) : (int64_t)acc);
+}
+
+static PS_Value *json_decode_as_float(JsonParser *p) {
+  size_t start = p->pos;
+  int integral = 0;
+  if (!json_scan_number(p, &integral)) return json_as_invalid(p);
+  size_t n = p->pos - start;
+  char tmp[64];
+  char *buf = n < sizeof(tmp) ? tmp : (char *)malloc(n + 1);
+  if (!buf) {
+    ps_throw(p->ctx, PS_ERR_OOM, "out of memory");
+    return NULL;
+  }
+  memcpy(buf, p->src + start, n);
+  buf[n] = '\0';
+  double v = strtod(buf, NULL);
+  if (buf != tmp) free(buf);
+  return ps_make_float(p->ctx, v);
+}
+
+static PS_Value *json_decode_as_list(JsonParser *p, const JsonSchema *s, const JsonPath *path) {
+  p->pos++;
+  PS_Value *list = ps_make_list(p->ctx);
+  if (!list) return NULL;
+  skip_ws(p);
+  if (p->pos < p->len && p->src[p->pos] == ']') {
+    p->pos++;
+    return list;
+  }
+  for (size_t i = 0;; i++) {
+    JsonPath seg = {path, NULL, 0, i, 0};
+    PS_Value *v = json_decode_as_value(p, s->elem, &seg);
+    if (!v) break;
+    PS_Status st = ps_list_push(p->ctx, list, v);
+    ps_value_release(v);
+    if (st != PS_OK) break;
+    skip_ws(p);
+    if (p->pos < p->len && p->src[p->pos] == ',') {
+      p->pos++;
+      continue;
+    }
+    if (p->pos < p->len && p->src[p->pos] == ']') {
+      p->pos++;
+      return list;
+    }
+    json_as_invalid(p);
+    break;
+  }
+  ps_value_release(list);
+  return NULL;
+}
+
+// Reads `"key" :` and leaves the parser on the member value. The key bytes
+// are the raw body, or the decoded string held in *decoded when it has escapes.
+static int json_decode_as_key(JsonParser *p, size_t *start, size_t *end, PS_Value **decoded) {
+  *decoded = NULL;
+  skip_ws(p);
+  if (!json_scan_string(p, start, end)) return 0;
+  if (memchr(p->src + *start, '\\', *end - *start)) {
+    *decoded = json_make_string(p->ctx, p->src, *start, *end, 0);
+    if (!*decoded) return 0;
+  }
+  skip_ws(p);
+  if (p->pos >= p->len || p->src[p->pos] != ':') return 0;
+  p->pos++;
+  return 1;
+}
+
+static PS_Value *json_decode_as_map(JsonParser *p, const JsonSchema *s, const JsonPath *path) {
+  p->pos++;
+  PS_Value *map = ps_make_map(p->ctx);
+  if (!map) return NULL;
+  skip_ws(p);
+  if (p->pos < p->len && p->src[p->pos] == '}') {
+    p->pos++;
+    return map;
+  }
+  while (1) {
+    size_t start = 0, end = 0;
+    PS_Value *key = NULL;
+    if (!json_decode_as_key(p, &start, &end, &key)) {
+      ps_value_release(key);
+      json_as_invalid(p);
+      break;
+    }
+    if (!key) key = ps_make_string_utf8(p->ctx, p->src + start, end - start);
+    if (!key) break;
+    JsonPath seg = {path, p->src + start, end - start, 0, 1};
+    PS_Value *v = json_decode_as_value(p, s->elem, &seg);
+    int ok = v && ps_map_set(p->ctx, map, key, v);
+    ps_value_release(key);
+    ps_value_release(v);
+    if (!ok) break;
+    skip_ws(p);
+    if (p->pos < p->len && p->src[p->pos] == ',') {
+      p->pos++;
+      continue;
+    }
+    if (p->pos < p->len && p->src[p->pos] == '}') {
+      p->pos++;
+      return map;
+    }
+    json_as_invalid(p);
+    break;
+  }
+  ps_value_release(map);
+  return NULL;
+}
+
+// Members are matched to fields by the perfect hash; unknown members are
+// skipped, a repeated member replaces the previous value. Every field must be
+// present; the instance is built once the object is closed.
+static PS_Value *json_decode_as_proto(JsonParser *p, const JsonSchema *s, const JsonPath *path) {
+  PS_Value *inline_vals[16];
+  PS_Value **vals = inline_vals;
+  size_t n = s->field_count;
+  if (n > 16) {
+    vals = (PS_Value **)calloc(n, sizeof(PS_Value *));
+    if (!vals) {
+      ps_throw(p->ctx, PS_ERR_OOM, "out of memory");
+      return NULL;
+    }
+  } else {
+    memset(inline_vals, 0, sizeof(inline_vals));
+  }
+  PS_Value *obj = NULL;
+  p->pos++;
+  skip_ws(p);
+  if (p->pos < p->len && p->src[p->pos] == '}') {
+    p->pos++;
+  } else {
+    while (1) {
+      size_t start = 0, end = 0;
+      PS_Value *decoded = NULL;
+      if (!json_decode_as_key(p, &start, &end, &decoded)) {
+        ps_value_release(decoded);
+        json_as_invalid(p);
+        goto done;
+      }
+      const char *key = decoded ? ps_string_ptr(decoded) : p->src + start;
+      size_t key_len = decoded ? ps_string_len(decoded) : end - start;
+      int k = json_schema_field_index(s, key, key_len);
+      ps_value_release(decoded);
+      if (k >= 0) {
+        JsonPath seg = {path, s->fields[k].name, s->fields[k].name_len, 0, 0};
+        PS_Value *v = json_decode_as_value(p, s->fields[k].schema, &seg);
+        if (!v) goto done;
+        ps_value_release(vals[k]);
+        vals[k] = v;
+      } else if (!json_skip_value(p)) {
+        json_as_invalid(p);
+        goto done;
+      }
+      skip_ws(p);
+      if (p->pos < p->len && p->src[p->pos] == ',') {
+        p->pos++;
+        continue;
+      }
+      if (p->pos < p->len && p->src[p->pos] == '}') {
+        p->pos++;
+        break;
+      }
+      json_as_invalid(p);
+      goto done;
+    }
+  }
+  for (size_t k = 0; k < n; k++) {
+    if (!vals[k]) {
+      JsonPath seg = {path, s->fields[k].name, s->fields[k].name_len, 0, 0};
+      json_as_fail(p, "missing JSON field", &seg, "no member", s->fields[k].schema->type_name);
+      goto done;
+    }
+  }
+  obj = ps_make_object(p->ctx);
+  if (!obj) goto done;
+  if (ps_object_set_proto_name(p->ctx, obj, s->type_name) != PS_OK) goto fail;
+  for (size_t k = 0; k < n; k++) {
+    if (ps_object_set_str(p->ctx, obj, s->fields[k].name, s->fields[k].name_len, vals[k]) != PS_OK) goto fail;
+  }
+  goto done;
+fail:
+  ps_value_release(obj);
+  obj = NULL;
+done:
+  for (size_t k = 0; k < n; k++) ps_value_release(vals[k]);
+  if (vals != inline_vals) free(vals);
+  return obj;
+}
+
+static PS_Value *json_decode_as_value(JsonParser *p, const JsonSchema *s, const JsonPath *path) {
+  skip_ws(p);
+  if (p->pos >= p->len) return json_as_invalid(p);
+  char c = p->src[p->pos];
+  int number = c == '-' || (c >= '0' && c <= '9');
+  switch (s->kind) {
+    case JSON_SCHEMA_ANY: {
+      PS_Value *v = parse_value(p);
+      return v ? v : json_as_invalid(p);
+    }
+    case JSON_SCHEMA_INT:
+    case JSON_SCHEMA_BYTE:
+      if (number) return json_decode_as_integer(p, s, path);
+      break;
+    case JSON_SCHEMA_FLOAT:
+      if (number) return json_decode_as_float(p);
+      break;
+    case JSON_SCHEMA_BOOL:
+      if (c == 't') return match(p, "true") ? ps_make_bool(p->ctx, 1) : json_as_invalid(p);
+      if (c == 'f') return match(p, "false") ? ps_make_bool(p->ctx, 0) : json_as_invalid(p);
+      break;
+    case JSON_SCHEMA_STRING:
+      if (c == '"') {
+        PS_Value *v = parse_string(p);
+        return v ? v : json_as_invalid(p);
+      }
+      break;
+    case JSON_SCHEMA_LIST:
+      if (c == '[') return json_decode_as_list(p, s, path);
+      break;
+    case JSON_SCHEMA_MAP:
+      if (c == '{') return json_decode_as_map(p, s, path);
+      break;
+    case JSON_SCHEMA_PROTO:
+      if (c == '{') return json_decode_as_proto(p, s, path);
+      break;
+  }
+  return json_as_mismatch(p, s, path);
+}
+
+// JSONReader: pull parser over a File. The input goes through a fixed window of
+// JSON_READ_CHUNK bytes; apart from the value materialized by next(), a reader
+// only holds the current token and the stack of open containers. The file and
+// the window are fields of the reader object, so a reader dropped without
+// close() does not keep them alive.
+#define JSON_READ_CHUNK 65536
+
+typedef enum {
+  JSON_READ_EVENTS, // one document
+  JSON_READ_ARRAY,  // one document, positioned inside its top-level array
+  JSON_READ_LINES   // JSON Lines: one document per line
+} JsonReadMode;
+
+typedef enum {
+  JSON_EXPECT_DOC,          // top level, before a document
+  JSON_EXPECT_DOC_END,      // top level, after a document
+  JSON_EXPECT_VALUE,        // after ':' or after ',' in an array
+  JSON_EXPECT_VALUE_OR_END, // after '['
+  JSON_EXPECT_COLON,        // after a key
+  JSON_EXPECT_KEY,          // after ',' in an object
+  JSON_EXPECT_KEY_OR_END,   // after '{'
+  JSON_EXPECT_COMMA_OR_END  // after an element or a member
+} JsonExpect;
+
+typedef enum {
+  JSON_EV_ERROR = -1,
+  JSON_EV_BEGIN_OBJECT,
+  JSON_EV_END_OBJECT,
+  JSON_EV_BEGIN_ARRAY,
+  JSON_EV_END_ARRAY,
+  JSON_EV_KEY,
+  JSON_EV_VALUE,
+  JSON_EV_END
+} JsonEvent;
+
+static const char *const JSON_EVENT_NAMES[] = {"beginObject", "endObject", "beginArray", "endArray", "key", "value", "end"};
+
+typedef struct {
+  PS_Value *obj;   // reader object, borrowed for the current call
+  JsonReadMode mode;
+  JsonExpect expect;
+  const char *buf; // bytes of the window value held by `obj`
+  size_t len;
+  size_t pos;
+  int eof;
+  StrBuf tok;   // body of the current string or atom
+  char *stack;  // open containers, '{' or '['
+  size_t depth;
+  size_t cap;
+  size_t docs;     // documents started
+  PS_Value *key;   // payload of the last key event
+  PS_Value *value; // payload of the last value event
+  int failed;
+} JsonReader;
+
+// Per-context list of open readers (ps_ctx_set_module_data): close() frees a
+// reader at once, the ones never closed go with the context.
+typedef struct {
+  JsonReader **items;
+  size_t len;
+  size_t cap;
+  char *scratch; // read buffer, copied into each new window
+} JsonReaderStore;
+
+#define JR_FIELD_PTR "__json_reader_ptr"
+#define JR_FIELD_FILE "__json_reader_file"
+#define JR_FIELD_WINDOW "__json_reader_window"
+
+static void jr_clear_current(JsonReader *r) {
+  if (r->key) ps_value_release(r->key);
+  if (r->value) ps_value_release(r->value);
+  r->key = NULL;
+  r->value = NULL;
+}
+
+static PS_Status jr_set_field(PS_Context *ctx, PS_Value *obj, const char *name, PS_Value *v) {
+  return ps_object_set_str(ctx, obj, name, strlen(name), v);
+}
+
+// Drops the input side (window, token, stack, file) once it is no longer needed.
+static void jr_release_input(PS_Context *ctx, JsonReader *r) {
+  r->buf = NULL;
+  r->len = 0;
+  r->pos = 0;
+  r->eof = 1;
+  sb_free(&r->tok);
+  free(r->stack);
+  r->stack = NULL;
+  r->depth = 0;
+  r->cap = 0;
+  PS_Value *none = r->obj ? ps_make_int(ctx, 0) : NULL;
+  if (none) {
+    jr_set_field(ctx, r->obj, JR_FIELD_WINDOW, none);
+    jr_set_field(ctx, r->obj, JR_FIELD_FILE, none);
+    ps_value_release(none);
+  }
+}
+
+static void jr_free(JsonReader *r) {
+  jr_clear_current(r);
+  sb_free(&r->tok);
+  free(r->stack);
+  free(r);
+}
+
+static void jr_store_free(void *data) {
+  JsonReaderStore *st = (JsonReaderStore *)data;
+  if (!st) return;
+  for (size_t i = 0; i < st->len; i++) jr_free(st->items[i]);
+  free(st->items);
+  free(st->scratch);
+  free(st);
+}
+
+static JsonReaderStore *jr_store(PS_Context *ctx) {
+  JsonReaderStore *st = (JsonReaderStore *)ps_ctx_get_module_data(ctx, "JSON");
+  if (st) return st;
+  st = (JsonReaderStore *)calloc(1, sizeof(JsonReaderStore));
+  if (!st) return NULL;
+  if (!(st->scratch = (char *)malloc(JSON_READ_CHUNK)) || ps_ctx_set_module_data(ctx, "JSON", st, jr_store_free) != PS_OK) {
+    free(st->scratch);
+    free(st);
+    return NULL;
+  }
+  return st;
+}
+
+static int jr_store_add(JsonReaderStore *st, JsonReader *r) {
+  if (st->len == st->cap) {
+    size_t cap = st->cap ? st->cap * 2 : 8;
+    JsonReader **items = (JsonReader **)realloc(st->items, cap * sizeof(JsonReader *));
+    if (!items) return 0;
+    st->items = items;
+    st->cap = cap;
+  }
+  st->items[st->len++] = r;
+  return 1;
+}
+
+static void jr_store_remove(JsonReaderStore *st, JsonReader *r) {
+  for (size_t i = 0; i < st->len; i++) {
+    if (st->items[i] == r) {
+      st->items[i] = st->items[--st->len];
+      return;
+    }
+  }
+}
+
+static JsonEvent jr_invalid(PS_Context *ctx, JsonReader *r) {
+  r->failed = 1;
+  jr_release_input(ctx, r);
+  ps_throw(ctx, PS_ERR_TYPE, "invalid JSON. got JSON value; expected expected JSON type");
+  return JSON_EV_ERROR;
+}
+
+static JsonEvent jr_oom(PS_Context *ctx) {
+  ps_throw(ctx, PS_ERR_OOM, "out of memory");
+  return JSON_EV_ERROR;
+}
+
+// Next input byte (not consumed): -1 at end of input, -2 on read error.
+static int jr_peek(PS_Context *ctx, JsonReader *r) {
+  if (r->pos < r->len) return (unsigned char)r->buf[r->pos];
+  if (r->eof) return -1;
+  JsonReaderStore *st = jr_store(ctx);
+  if (!st) {
+    jr_oom(ctx);
+    return -2;
+  }
+  PS_Value *file = ps_object_get_str(ctx, r->obj, JR_FIELD_FILE, strlen(JR_FIELD_FILE));
+  size_t n = 0;
+  if (ps_file_read(ctx, file, st->scratch, JSON_READ_CHUNK, &n) != PS_OK) return -2;
+  r->buf = NULL;
+  r->pos = 0;
+  r->len = 0;
+  if (n == 0) {
+    r->eof = 1;
+    return -1;
+  }
+  PS_Value *window = ps_make_bytes(ctx, (const uint8_t *)st->scratch, n);
+  if (!window || jr_set_field(ctx, r->obj, JR_FIELD_WINDOW, window) != PS_OK) {
+    if (window) ps_value_release(window);
+    return -2;
+  }
+  ps_value_release(window);
+  r->buf = (const char *)ps_bytes_ptr(window);
+  r->len = n;
+  return (unsigned char)r->buf[0];
+}
+
+// In JSON Lines mode a newline ends a document: it is only skipped between
+// documents (`newlines`).
+static int jr_skip_ws(PS_Context *ctx, JsonReader *r, int newlines) {
+  for (;;) {
+    int c = jr_peek(ctx, r);
+    if (c == ' ' || c == '\t' || c == '\r' || (c == '\n' && newlines)) {
+      r->pos++;
+      continue;
+    }
+    return c;
+  }
+}
+
+static int jr_newlines(const JsonReader *r) {
+  return r->mode != JSON_READ_LINES || r->expect == JSON_EXPECT_DOC;
+}
+
+// String body after the opening quote, gathered across windows.
+static PS_Value *jr_read_string(PS_Context *ctx, JsonReader *r) {
+  int escaped = 0;
+  r->tok.len = 0;
+  for (;;) {
+    int c = jr_peek(ctx, r);
+    if (c == -2) return NULL;
+    if (c == -1) {
+      jr_invalid(ctx, r);
+      return NULL;
+    }
+    const char *p = r->buf + r->pos;
+    size_t n = r->len - r->pos;
+    size_t i = 0;
+    for (; i < n; i++) {
+      unsigned char b = (unsigned char)p[i];
+      if (escaped) {
+        escaped = 0;
+      } else if (b == '\\') {
+        escaped = 1;
+      } else if (b == '"') {
+        break;
+      } else if (b < 0x20) {
+        jr_invalid(ctx, r);
+        return NULL;
+      }
+    }
+    if (!sb_append(&r->tok, p, i)) {
+      jr_oom(ctx);
+      return NULL;
+    }
+    r->pos += i;
+    if (i < n) {
+      r->pos++;
+      break;
+    }
+  }
+  PS_Value *s = json_make_string(ctx, r->tok.buf, 0, r->tok.len, 0);
+  if (!s) {
+    r->failed = 1;
+    jr_release_input(ctx, r);
+  }
+  return s;
+}
+
+// Number or literal starting at the current byte.
+static PS_Value *jr_read_atom(PS_Context *ctx, JsonReader *r) {
+  r->tok.len = 0;
+  for (;;) {
+    int c = jr_peek(ctx, r);
+    if (c == -2) return NULL;
+    if (c == -1 || json_is_delim((unsigned char)c)) break;
+    size_t end = r->pos;
+    while (end < r->len && !json_is_delim((unsigned char)r->buf[end])) end++;
+    if (!sb_append(&r->tok, r->buf + r->pos, end - r->pos)) {
+      jr_oom(ctx);
+      return NULL;
+    }
+    r->pos = end;
+  }
+  PS_Value *v = r->tok.len > 0 ? json_make_atom(ctx, r->tok.buf, r->tok.len, 0) : NULL;
+  if (!v) jr_invalid(ctx, r);
+  return v;
+}
+
+static int jr_push(JsonReader *r, char c) {
+  if (r->depth == r->cap) {
+    size_t cap = r->cap ? r->cap * 2 : 32;
+    char *ns = (char *)realloc(r->stack, cap);
+    if (!ns) return 0;
+    r->stack = ns;
+    r->cap = cap;
+  }
+  r->stack[r->depth++] = c;
+  return 1;
+}
+
+static void jr_after_value(JsonReader *r) {
+  r->expect = r->depth > 0 ? JSON_EXPECT_COMMA_OR_END : JSON_EXPECT_DOC_END;
+}
+
+static JsonEvent jr_next_event(PS_Context *ctx, JsonReader *r) {
+  jr_clear_current(r);
+  if (r->failed) return jr_invalid(ctx, r);
+  for (;;) {
+    int c = jr_skip_ws(ctx, r, jr_newlines(r));
+    if (c == -2) return JSON_EV_ERROR;
+    switch (r->expect) {
+      case JSON_EXPECT_DOC:
+        if (c == -1) {
+          // An empty JSON Lines input has no record; a document is required otherwise.
+          if (r->mode != JSON_READ_LINES) return jr_invalid(ctx, r);
+          jr_release_input(ctx, r);
+          return JSON_EV_END;
+        }
+        r->docs++;
+        goto value;
+      case JSON_EXPECT_DOC_END:
+        if (c == -1) {
+          jr_release_input(ctx, r);
+          return JSON_EV_END;
+        }
+        if (r->mode == JSON_READ_LINES && c == '\n') {
+          r->pos++;
+          r->expect = JSON_EXPECT_DOC;
+          continue;
+        }
+        return jr_invalid(ctx, r);
+      case JSON_EXPECT_VALUE:
+        goto value;
+      case JSON_EXPECT_VALUE_OR_END:
+        if (c == ']') goto close;
+        goto value;
+      case JSON_EXPECT_COLON:
+        if (c != ':') return jr_invalid(ctx, r);
+        r->pos++;
+        r->expect = JSON_EXPECT_VALUE;
+        continue;
+      case JSON_EXPECT_KEY_OR_END:
+        if (c == '}') goto close;
+        /* fall through */
+      case JSON_EXPECT_KEY:
+        if (c != '"') return jr_invalid(ctx, r);
+        r->pos++;
+        r->key = jr_read_string(ctx, r);
+        if (!r->key) return JSON_EV_ERROR;
+        r->expect = JSON_EXPECT_COLON;
+        return JSON_EV_KEY;
+      case JSON_EXPECT_COMMA_OR_END:
+        if (c == ',') {
+          r->pos++;
+          r->expect = r->stack[r->depth - 1] == '{' ? JSON_EXPECT_KEY : JSON_EXPECT_VALUE;
+          continue;
+        }
+        goto close;
+    }
+  value:
+    if (c == '{' || c == '[') {
+      if (!jr_push(r, (char)c)) return jr_oom(ctx);
+      r->pos++;
+      r->expect = c == '{' ? JSON_EXPECT_KEY_OR_END : JSON_EXPECT_VALUE_OR_END;
+      return c == '{' ? JSON_EV_BEGIN_OBJECT : JSON_EV_BEGIN_ARRAY;
+    }
+    if (c == '"') {
+      r->pos++;
+      PS_Value *s = jr_read_string(ctx, r);
+      if (!s) return JSON_EV_ERROR;
+      r->value = ps_make_json(ctx, PS_JSON_KIND_STRING, s);
+      ps_value_release(s);
+    } else {
+      if (c == -1 || json_is_delim((unsigned char)c)) return jr_invalid(ctx, r);
+      r->value = jr_read_atom(ctx, r);
+    }
+    if (!r->value) return JSON_EV_ERROR;
+    jr_after_value(r);
+    return JSON_EV_VALUE;
+  close:
+    if (r->depth == 0 || c != (r->stack[r->depth - 1] == '{' ? '}' : ']')) return jr_invalid(ctx, r);
+    r->pos++;
+    r->depth--;
+    jr_after_value(r);
+    return c == '}' ? JSON_EV_END_OBJECT : JSON_EV_END_ARRAY;
+  }
+}
+
+// 1 if a whole value can be read at the current position, consuming the
+// separator before it; 0 at the end of the enclosing array, before an object
+// key, or at the end of input; -1 on error.
+static int jr_has_value(PS_Context *ctx, JsonReader *r) {
+  if (r->failed) return jr_invalid(ctx, r);
+  for (;;) {
+    if (r->expect == JSON_EXPECT_VALUE) return 1;
+    if (r->expect == JSON_EXPECT_KEY || r->expect == JSON_EXPECT_KEY_OR_END) return 0;
+    int c = jr_skip_ws(ctx, r, jr_newlines(r));
+    if (c == -2) return -1;
+    switch (r->expect) {
+      case JSON_EXPECT_DOC:
+        // A missing document is reported by next().
+        return c != -1 || r->mode != JSON_READ_LINES;
+      case JSON_EXPECT_DOC_END:
+        if (c == -1) return 0;
+        if (r->mode == JSON_READ_LINES && c == '\n') {
+          r->pos++;
+          r->expect = JSON_EXPECT_DOC;
+          continue;
+        }
+        return jr_invalid(ctx, r);
+      case JSON_EXPECT_VALUE_OR_END:
+        return c != ']';
+      case JSON_EXPECT_COLON:
+        if (c != ':') return jr_invalid(ctx, r);
+        r->pos++;
+        r->expect = JSON_EXPECT_VALUE;
+        return 1;
+      case JSON_EXPECT_COMMA_OR_END:
+        if (c != ',' || r->stack[r->depth - 1] != '[') return 0;
+        r->pos++;
+        r->expect = JSON_EXPECT_VALUE;
+        return 1;
+      default:
+        return 0;
+    }
+  }
+}
+
+// Whole value at the current position, built from the events.
+static PS_Value *jr_read_value(PS_Context *ctx, JsonReader *r) {
+  JsonFrame *stack = NULL;
+  size_t depth = 0;
+  size_t cap = 0;
+  for (;;) {
+    JsonEvent ev = jr_next_event(ctx, r);
+    PS_Value *v = NULL;
+    switch (ev) {
+      case JSON_EV_BEGIN_OBJECT:
+      case JSON_EV_BEGIN_ARRAY: {
+        if (depth == cap) {
+          size_t ncap = cap ? cap * 2 : 16;
+          JsonFrame *ns = (JsonFrame *)realloc(stack, ncap * sizeof(JsonFrame));
+          if (!ns) {
+            jr_oom(ctx);
+            goto fail;
+          }
+          stack = ns;
+          cap = ncap;
+        }
+        JsonFrame *f = &stack[depth];
+        f->is_object = ev == JSON_EV_BEGIN_OBJECT;
+        f->key = NULL;
+        f->container = f->is_object ? ps_make_map(ctx) : ps_make_list(ctx);
+        if (!f->container) goto fail;
+        depth++;
+        continue;
+      }
+      case JSON_EV_KEY:
+        if (depth == 0) goto invalid;
+        stack[depth - 1].key = r->key;
+        r->key = NULL;
+        continue;
+      case JSON_EV_VALUE:
+        v = r->value;
+        r->value = NULL;
+        break;
+      case JSON_EV_END_OBJECT:
+      case JSON_EV_END_ARRAY: {
+        if (depth == 0) goto invalid;
+        JsonFrame *f = &stack[--depth];
+        v = ps_make_json(ctx, f->is_object ? PS_JSON_KIND_OBJECT : PS_JSON_KIND_ARRAY, f->container);
+        ps_value_release(f->container);
+        if (!v) goto fail;
+        break;
+      }
+      case JSON_EV_END:
+        goto invalid;
+      default:
+        goto fail;
+    }
+    if (depth == 0) {
+      free(stack);
+      return v;
+    }
+    JsonFrame *f = &stack[depth - 1];
+    int ok = f->is_object ? ps_map_set(ctx, f->container, f->key, v) != 0 : ps_list_push(ctx, f->container, v) == PS_OK;
+    ps_value_release(v);
+    if (f->key) ps_value_release(f->key);
+    f->key = NULL;
+    if (!ok) goto fail;
+  }
+invalid:
+  jr_invalid(ctx, r);
+fail:
+  while (depth > 0) {
+    depth--;
+    if (stack[depth].key) ps_value_release(stack[depth].key);
+    ps_value_release(stack[depth].container);
+  }
+  free(stack);
+  return NULL;
+}
+
+static JsonReader *jr_state(PS_Context *ctx, PS_Value *obj) {
+  PS_Value *ptr = NULL;
+  if (obj && ps_typeof(obj) == PS_T_OBJECT) ptr = ps_object_get_str(ctx, obj, JR_FIELD_PTR, strlen(JR_FIELD_PTR));
+  if (!ptr || ps_typeof(ptr) != PS_T_INT) {
+    ps_throw(ctx, PS_ERR_TYPE, "invalid JSONReader. got non-reader value; expected JSONReader");
+    return NULL;
+  }
+  JsonReader *r = (JsonReader *)(intptr_t)ps_as_int(ptr);
+  if (!r) {
+    ps_throw(ctx, PS_ERR_TYPE, "JSONReader is closed. got closed reader; expected open reader");
+    return NULL;
+  }
+  r->obj = obj;
+  return r;
+}
+
+static PS_Status jr_open(PS_Context *ctx, PS_Value *file, JsonReadMode mode, PS_Value **out) {
+  if (!file || ps_typeof(file) != PS_T_FILE) {
+    ps_throw(ctx, PS_ERR_TYPE, "JSON reader expects File");
+    return PS_ERR;
+  }
+  JsonReaderStore *st = jr_store(ctx);
+  JsonReader *r = st ? (JsonReader *)calloc(1, sizeof(JsonReader)) : NULL;
+  if (!r || !jr_store_add(st, r)) {
+    free(r);
+    jr_oom(ctx);
+    return PS_ERR;
+  }
+  r->mode = mode;
+  r->expect = JSON_EXPECT_DOC;
+  sb_init(&r->tok);
+  PS_Value *obj = ps_make_object(ctx);
+  PS_Value *ptr = obj ? ps_make_int(ctx, (int64_t)(intptr_t)r) : NULL;
+  int ok = ptr && ps_object_set_proto_name(ctx, obj, "JSONReader") == PS_OK && jr_set_field(ctx, obj, JR_FIELD_PTR, ptr) == PS_OK &&
+           jr_set_field(ctx, obj, JR_FIELD_FILE, file) == PS_OK;
+  if (ptr) ps_value_release(ptr);
+  r->obj = obj;
+  if (ok && mode == JSON_READ_ARRAY) {
+    JsonEvent ev = jr_next_event(ctx, r);
+    if (ev != JSON_EV_BEGIN_ARRAY) {
+      if (ev != JSON_EV_ERROR) jr_invalid(ctx, r);
+      ok = 0;
+    }
+  }
+  if (!ok) {
+    jr_store_remove(st, r);
+    jr_free(r);
+    if (obj) ps_value_release(obj);
+    return PS_ERR;
+  }
+  *out = obj;
+  return PS_OK;
+}
+
+static PS_Status mod_encode(PS_Context *ctx, int argc, PS_Value **argv, PS_Value **out) {
+  (void)argc;
+  JsonOut o;
+  jo_init(&o, ctx, NULL);
+  if (!json_encode_value(&o, argv[0])) {
+    sb_free(&o.sb);
+    return PS_ERR;
+  }
+  // The encoder only emits valid UTF-8: the buffer becomes the string as is.
+  PS_Value *s = ps_make_string_utf8_owned(ctx, o.sb.buf, o.sb.len);
+  if (!s) return PS_ERR;
+  *out = s;
+  return PS_OK;
+}
+
+static PS_Status mod_encode_to(PS_Context *ctx, int argc, PS_Value **argv, PS_Value **out) {
+  (void)argc;
+  (void)out;
+  if (!argv[0] || ps_typeof(argv[0]) != PS_T_FILE) {
+    ps_throw(ctx, PS_ERR_TYPE, "encodeTo expects File");
+    return PS_ERR;
+  }
+  JsonOut o;
+  jo_init(&o, ctx, argv[0]);
+  if (!sb_reserve(&o.sb, JSON_OUT_CHUNK + 1)) {
+    ps_throw(ctx, PS_ERR_OOM, "out of memory");
+    return PS_ERR;
+  }
+  int ok = json_encode_value(&o, argv[1]) && jo_flush(&o);
+  sb_free(&o.sb);
+  return ok ? PS_OK : PS_ERR;
+}
+
+static PS_Status mod_decode(PS_Context *ctx, int argc, PS_Value **argv, PS_Value **out) {
+  (void)argc;
+  PS_Value *sval = argv[0];
+  if (sval && ps_typeof(sval) == PS_T_BYTES) {
+    PS_Value *tmp = ps_bytes_to_utf8_string(ctx, sval);
+    if (!tmp) return PS_ERR;
+    sval = tmp;
+  }
+  if (json_string_payload(sval)) sval = json_string_payload(sval);
+  if (!sval || ps_typeof(sval) != PS_T_STRING) {
+    ps_throw(ctx, PS_ERR_TYPE, "decode expects string");
+    return PS_ERR;
+  }
+  const char *s = ps_string_ptr(sval);
+  size_t len = ps_string_len(sval);
+  PS_Value *v = json_parse(ctx, s ? s : "", len);
+  if (sval != argv[0]) ps_value_release(sval);
+  if (!v) {
+    ps_throw(ctx, PS_ERR_TYPE, "invalid JSON. got JSON value; expected expected JSON type");
+    return PS_ERR;
+  }
+  *out = v;
+  return PS_OK;
+}
+
+static PS_Status mod_decode_as(PS_Context *ctx, int argc, PS_Value **argv, PS_Value **out) {
+  PS_Value *sval = argv[0];
+  PS_Value *tval = argc > 1 ? argv[1] : NULL;
+  if (!sval || ps_typeof(sval) != PS_T_STRING) {
+    ps_throw(ctx, PS_ERR_TYPE, "decodeAs expects string");
+    return PS_ERR;
+  }
+  if (!tval || ps_typeof(tval) != PS_T_STRING) {
+    ps_throw(ctx, PS_ERR_TYPE, "decodeAs expects a JSON target type");
+    return PS_ERR;
+  }
+  const char *type = ps_string_ptr(tval);
+  JsonSchema *schema = json_schema_get(ctx, type ? type : "", ps_string_len(tval));
+  if (!schema) {
+    ps_throw(ctx, PS_ERR_TYPE, "invalid JSON target type. got unknown type; expected decodable type");
+    return PS_ERR;
+  }
+  const char *s = ps_string_ptr(sval);
+  JsonParser p = {s ? s : "", ps_string_len(sval), 0, ctx};
+  PS_Value *v = json_decode_as_value(&p, schema, NULL);
+  if (!v) return PS_ERR;
+  skip_ws(&p);
+  if (p.pos != p.len) {
+    ps_value_release(v);
+    json_as_invalid(&p);
+    return PS_ERR;
+  }
+  *out = v;
+  return PS_OK;
+}
+
+static PS_Status mod_isvalid(PS_Context *ctx, int argc, PS_Value **argv, PS_Value **out) {
+  (void)argc;
+  PS_Value *sval = argv[0];
+  if (sval && ps_typeof(sval) == PS_T_BYTES) {
+    PS_Value *tmp = ps_bytes_to_utf8_string(ctx, sval);
+    if (!tmp) return PS_ERR;
+    sval = tmp;
+  }
+  if (json_string_payload(sval)) sval = json_string_payload(sval);
+  if (!sval || ps_typeof(sval) != PS_T_STRING) {
+    ps_throw(ctx, PS_ERR_TYPE, "isValid expects string");
+    return PS_ERR;
+  }
+  const char *s = ps_string_ptr(sval);
+  size_t len = ps_string_len(sval);
+  PS_Value *v = json_parse(ctx, s ? s : "", len);
+  if (sval != argv[0]) ps_value_release(sval);
+  if (!v) {
+    ps_clear_error(ctx);
+    *out = ps_make_bool(ctx, 0);
+    return *out ? PS_OK : PS_ERR;
+  }
+  ps_value_release(v);
+  *out = ps_make_bool(ctx, 1);
+  return *out ? PS_OK : PS_ERR;
+}
+
+static PS_Status mod_null(PS_Context *ctx, int argc, PS_Value **argv, PS_Value **out) {
+  (void)argc;
+  (void)argv;
+  PS_Value *v = ps_make_json_null(ctx);
+  if (!v) return PS_ERR;
+  *out = v;
+  return PS_OK;
+}
+
+static PS_Status mod_bool(PS_Context *ctx, int argc, PS_Value **argv, PS_Value **out) {
+  (void)argc;
+  if (!argv[0] || ps_typeof(argv[0]) != PS_T_BOOL) {
+    ps_throw(ctx, PS_ERR_TYPE, "bool expects bool");
+    return PS_ERR;
+  }
+  PS_Value *v = ps_make_json_bool(ctx, ps_as_bool(argv[0]));
+  if (!v) return PS_ERR;
+  *out = v;
+  return PS_OK;
+}
+
+static PS_Status mod_number(PS_Context *ctx, int argc, PS_Value **argv, PS_Value **out) {
+  (void)argc;
+  double x = 0.0;
+  if (ps_typeof(argv[0]) == PS_T_INT) x = (double)ps_as_int(argv[0]);
+  else if (ps_typeof(argv[0]) == PS_T_FLOAT) x = ps_as_float(argv[0]);
+  else {
+    ps_throw(ctx, PS_ERR_TYPE, "number expects float");
+    return PS_ERR;
+  }
+  if (!isfinite(x)) {
+    ps_throw(ctx, PS_ERR_TYPE, "invalid JSON number. got JSON value; expected expected JSON type");
+    return PS_ERR;
+  }
+  PS_Value *v = ps_make_json_number(ctx, x);
+  if (!v) return PS_ERR;
+  *out = v;
+  return PS_OK;
+}
+
+static PS_Status mod_string(PS_Context *ctx, int argc, PS_Value **argv, PS_Value **out) {
+  (void)argc;
+  if (!argv[0] || ps_typeof(argv[0]) != PS_T_STRING) {
+    ps_throw(ctx, PS_ERR_TYPE, "string expects string");
+    return PS_ERR;
+  }
+  PS_Value *v = ps_make_json(ctx, PS_JSON_KIND_STRING, argv[0]);
+  if (!v) return PS_ERR;
+  *out = v;
+  return PS_OK;
+}
+
+static PS_Status mod_array(PS_Context *ctx, int argc, PS_Value **argv, PS_Value **out) {
+  (void)argc;
+  if (!argv[0] || ps_typeof(argv[0]) != PS_T_LIST) {
+    ps_throw(ctx, PS_ERR_TYPE, "array expects list<JSONValue>");
+    return PS_ERR;
   }
   size_t n = ps_list_len(argv[0]);
   for (size_t i = 0; i < n; i++) {
     PS_Value *it = ps_list_get(ctx, argv[0], i);
     if (!it) return PS_ERR;
-    const char *kind = NULL;
-    if (!json_value_kind(ctx, it, &kind, NULL)) {
+    if (!ps_json_kind(it, NULL)) {
       ps_throw(ctx, PS_ERR_TYPE, "array expects list<JSONValue>");
       return PS_ERR;
     }
   }
-  PS_Value *v = json_make_value(ctx, "array", argv[0]);
+  PS_Value *v = ps_make_json(ctx, PS_JSON_KIND_ARRAY, argv[0]);
   if (!v) return PS_ERR;
   *out = v;
   return PS_OK;
@@ -834,35 +2383,127 @@ static PS_Status mod_object(PS_Context *ctx, int argc, PS_Value **argv, PS_Value
       ps_throw(ctx, PS_ERR_TYPE, "object expects map<string,JSONValue>");
       return PS_ERR;
     }
-    if (!json_value_kind(ctx, val, NULL, NULL)) {
+    if (!ps_json_kind(val, NULL)) {
       ps_throw(ctx, PS_ERR_TYPE, "object expects map<string,JSONValue>");
       return PS_ERR;
     }
   }
-  PS_Value *v = json_make_value(ctx, "object", argv[0]);
+  PS_Value *v = ps_make_json(ctx, PS_JSON_KIND_OBJECT, argv[0]);
+  if (!v) return PS_ERR;
+  *out = v;
+  return PS_OK;
+}
+
+static PS_Status mod_reader(PS_Context *ctx, int argc, PS_Value **argv, PS_Value **out) {
+  (void)argc;
+  return jr_open(ctx, argv[0], JSON_READ_EVENTS, out);
+}
+
+static PS_Status mod_read_array(PS_Context *ctx, int argc, PS_Value **argv, PS_Value **out) {
+  (void)argc;
+  return jr_open(ctx, argv[0], JSON_READ_ARRAY, out);
+}
+
+static PS_Status mod_read_lines(PS_Context *ctx, int argc, PS_Value **argv, PS_Value **out) {
+  (void)argc;
+  return jr_open(ctx, argv[0], JSON_READ_LINES, out);
+}
+
+static PS_Status mod_reader_has_next(PS_Context *ctx, int argc, PS_Value **argv, PS_Value **out) {
+  (void)argc;
+  JsonReader *r = jr_state(ctx, argv[0]);
+  if (!r) return PS_ERR;
+  int has = jr_has_value(ctx, r);
+  if (has < 0) return PS_ERR;
+  PS_Value *b = ps_make_bool(ctx, has);
+  if (!b) return PS_ERR;
+  *out = b;
+  return PS_OK;
+}
+
+static PS_Status mod_reader_next(PS_Context *ctx, int argc, PS_Value **argv, PS_Value **out) {
+  (void)argc;
+  JsonReader *r = jr_state(ctx, argv[0]);
+  if (!r) return PS_ERR;
+  int has = jr_has_value(ctx, r);
+  if (has < 0) return PS_ERR;
+  if (!has) {
+    ps_throw(ctx, PS_ERR_TYPE, "no more JSON values. got end of values; expected JSON value");
+    return PS_ERR;
+  }
+  PS_Value *v = jr_read_value(ctx, r);
   if (!v) return PS_ERR;
   *out = v;
   return PS_OK;
 }
 
+static PS_Status mod_reader_next_event(PS_Context *ctx, int argc, PS_Value **argv, PS_Value **out) {
+  (void)argc;
+  JsonReader *r = jr_state(ctx, argv[0]);
+  if (!r) return PS_ERR;
+  JsonEvent ev = jr_next_event(ctx, r);
+  if (ev == JSON_EV_ERROR) return PS_ERR;
+  const char *name = JSON_EVENT_NAMES[ev];
+  PS_Value *s = ps_make_string_utf8(ctx, name, strlen(name));
+  if (!s) return PS_ERR;
+  *out = s;
+  return PS_OK;
+}
+
+static PS_Status mod_reader_key(PS_Context *ctx, int argc, PS_Value **argv, PS_Value **out) {
+  (void)argc;
+  JsonReader *r = jr_state(ctx, argv[0]);
+  if (!r) return PS_ERR;
+  if (!r->key) {
+    ps_throw(ctx, PS_ERR_TYPE, "no current JSON key. got no key event; expected key event");
+    return PS_ERR;
+  }
+  *out = ps_value_retain(r->key);
+  return PS_OK;
+}
+
+static PS_Status mod_reader_value(PS_Context *ctx, int argc, PS_Value **argv, PS_Value **out) {
+  (void)argc;
+  JsonReader *r = jr_state(ctx, argv[0]);
+  if (!r) return PS_ERR;
+  if (!r->value) {
+    ps_throw(ctx, PS_ERR_TYPE, "no current JSON value. got no value event; expected value event");
+    return PS_ERR;
+  }
+  *out = ps_value_retain(r->value);
+  return PS_OK;
+}
+
+static PS_Status mod_reader_close(PS_Context *ctx, int argc, PS_Value **argv, PS_Value **out) {
+  (void)argc;
+  (void)out;
+  JsonReader *r = jr_state(ctx, argv[0]);
+  if (!r) return PS_ERR;
+  PS_Value *none = ps_make_int(ctx, 0);
+  if (!none) return PS_ERR;
+  jr_release_input(ctx, r);
+  PS_Status st = jr_set_field(ctx, argv[0], JR_FIELD_PTR, none);
+  ps_value_release(none);
+  if (st != PS_OK) return PS_ERR;
+  JsonReaderStore *store = (JsonReaderStore *)ps_ctx_get_module_data(ctx, "JSON");
+  if (store) jr_store_remove(store, r);
+  jr_free(r);
+  return PS_OK;
+}
+
 static int json_debug_dump(PS_Context *ctx, PS_Value *v, const PS_DebugWriter *w, int depth, int indent) {
-  const char *kind = NULL;
-  PS_Value *val = NULL;
-  if (!json_value_kind(ctx, v, &kind, &val)) return 0;
+  PS_JsonKind kind;
+  if (!ps_json_kind(v, &kind)) return 0;
   if (!w || !w->write || !w->printf || !w->indent || !w->dump_value) return 0;
-  if (strcmp(kind, "null") == 0) return w->write(w->ud, "JSONValue(null)");
-  if (strcmp(kind, "bool") == 0) {
-    if (!val || ps_typeof(val) != PS_T_BOOL) return w->write(w->ud, "JSONValue(bool=unknown)");
-    return w->printf(w->ud, "JSONValue(bool=%s)", ps_as_bool(val) ? "true" : "false");
-  }
-  if (strcmp(kind, "number") == 0) {
-    if (!val || ps_typeof(val) != PS_T_FLOAT) return w->write(w->ud, "JSONValue(number=unknown)");
+  PS_Value *val = ps_json_payload(v);
+  if (kind == PS_JSON_KIND_NULL) return w->write(w->ud, "JSONValue(null)");
+  if (kind == PS_JSON_KIND_BOOL) return w->printf(w->ud, "JSONValue(bool=%s)", ps_json_bool(v) ? "true" : "false");
+  if (kind == PS_JSON_KIND_NUMBER) {
     char buf[64];
-    snprintf(buf, sizeof(buf), "%.17g", ps_as_float(val));
+    snprintf(buf, sizeof(buf), "%.17g", ps_json_number(v));
     return w->printf(w->ud, "JSONValue(number=%s)", buf);
   }
-  if (strcmp(kind, "string") == 0) {
-    if (!val || ps_typeof(val) != PS_T_STRING) return w->write(w->ud, "JSONValue(string=unknown)");
+  if (kind == PS_JSON_KIND_STRING) {
     StrBuf sb;
     sb_init(&sb);
     int truncated = 0;
@@ -877,8 +2518,7 @@ static int json_debug_dump(PS_Context *ctx, PS_Value *v, const PS_DebugWriter *w
     sb_free(&sb);
     return ok;
   }
-  if (strcmp(kind, "array") == 0) {
-    if (!val || ps_typeof(val) != PS_T_LIST) return w->write(w->ud, "JSONValue(array,len=unknown)");
+  if (kind == PS_JSON_KIND_ARRAY) {
     size_t len = ps_list_len(val);
     if (!w->printf(w->ud, "JSONValue(array,len=%zu) [", len)) return 0;
     if (depth >= (int)w->max_depth) {
@@ -900,8 +2540,7 @@ static int json_debug_dump(PS_Context *ctx, PS_Value *v, const PS_DebugWriter *w
     w->indent(w->ud, indent);
     return w->write(w->ud, "]");
   }
-  if (strcmp(kind, "object") == 0) {
-    if (!val || ps_typeof(val) != PS_T_MAP) return w->write(w->ud, "JSONValue(object,len=unknown)");
+  if (kind == PS_JSON_KIND_OBJECT) {
     size_t len = ps_map_len(val);
     if (!w->printf(w->ud, "JSONValue(object,len=%zu) {", len)) return 0;
     if (depth >= (int)w->max_depth) {
@@ -962,6 +2601,15 @@ static const PS_ProtoMethodDesc JSONValue_methods[] = {
   { .name = "asObject", .params = NULL, .param_count = 0, .ret_type = "map<string,JSONValue>" },
 };
 
+static const PS_ProtoMethodDesc JSONReader_methods[] = {
+  { .name = "hasNext", .params = NULL, .param_count = 0, .ret_type = "bool" },
+  { .name = "next", .params = NULL, .param_count = 0, .ret_type = "JSONValue" },
+  { .name = "nextEvent", .params = NULL, .param_count = 0, .ret_type = "string" },
+  { .name = "key", .params = NULL, .param_count = 0, .ret_type = "string" },
+  { .name = "value", .params = NULL, .param_count = 0, .ret_type = "JSONValue" },
+  { .name = "close", .params = NULL, .param_count = 0, .ret_type = "void" },
+};
+
 static const PS_ProtoDesc JSON_protos[] = {
   {
     .name = "JSONValue",
@@ -971,6 +2619,15 @@ static const PS_ProtoDesc JSON_protos[] = {
     .methods = JSONValue_methods,
     .method_count = sizeof(JSONValue_methods) / sizeof(JSONValue_methods[0]),
     .is_sealed = 1
+  },
+  {
+    .name = "JSONReader",
+    .parent = NULL,
+    .fields = NULL,
+    .field_count = 0,
+    .methods = JSONReader_methods,
+    .method_count = sizeof(JSONReader_methods) / sizeof(JSONReader_methods[0]),
+    .is_sealed = 1
   }
 };
 
@@ -978,7 +2635,9 @@ PS_Status ps_module_init(PS_Context *ctx, PS_Module *out) {
   (void)ctx;
   static PS_NativeFnDesc fns[] = {
       {.name = "encode", .fn = mod_encode, .arity = 1, .ret_type = PS_T_STRING, .param_types = NULL, .flags = 0},
+      {.name = "encodeTo", .fn = mod_encode_to, .arity = 2, .ret_type = PS_T_VOID, .param_types = NULL, .flags = 0},
       {.name = "decode", .fn = mod_decode, .arity = 1, .ret_type = PS_T_OBJECT, .param_types = NULL, .flags = 0},
+      {.name = "decodeAs", .fn = mod_decode_as, .arity = 2, .ret_type = PS_T_OBJECT, .param_types = NULL, .flags = 0},
       {.name = "isValid", .fn = mod_isvalid, .arity = 1, .ret_type = PS_T_BOOL, .param_types = NULL, .flags = 0},
       {.name = "null", .fn = mod_null, .arity = 0, .ret_type = PS_T_OBJECT, .param_types = NULL, .flags = 0},
       {.name = "bool", .fn = mod_bool, .arity = 1, .ret_type = PS_T_OBJECT, .param_types = NULL, .flags = 0},
@@ -986,6 +2645,15 @@ PS_Status ps_module_init(PS_Context *ctx, PS_Module *out) {
       {.name = "string", .fn = mod_string, .arity = 1, .ret_type = PS_T_OBJECT, .param_types = NULL, .flags = 0},
       {.name = "array", .fn = mod_array, .arity = 1, .ret_type = PS_T_OBJECT, .param_types = NULL, .flags = 0},
       {.name = "object", .fn = mod_object, .arity = 1, .ret_type = PS_T_OBJECT, .param_types = NULL, .flags = 0},
+      {.name = "reader", .fn = mod_reader, .arity = 1, .ret_type = PS_T_OBJECT, .param_types = NULL, .flags = 0},
+      {.name = "readArray", .fn = mod_read_array, .arity = 1, .ret_type = PS_T_OBJECT, .param_types = NULL, .flags = 0},
+      {.name = "readLines", .fn = mod_read_lines, .arity = 1, .ret_type = PS_T_OBJECT, .param_types = NULL, .flags = 0},
+      {.name = "__reader_hasNext", .fn = mod_reader_has_next, .arity = 1, .ret_type = PS_T_BOOL, .param_types = NULL, .flags = 0},
+      {.name = "__reader_next", .fn = mod_reader_next, .arity = 1, .ret_type = PS_T_OBJECT, .param_types = NULL, .flags = 0},
+      {.name = "__reader_nextEvent", .fn = mod_reader_next_event, .arity = 1, .ret_type = PS_T_STRING, .param_types = NULL, .flags = 0},
+      {.name = "__reader_key", .fn = mod_reader_key, .arity = 1, .ret_type = PS_T_STRING, .param_types = NULL, .flags = 0},
+      {.name = "__reader_value", .fn = mod_reader_value, .arity = 1, .ret_type = PS_T_OBJECT, .param_types = NULL, .flags = 0},
+      {.name = "__reader_close", .fn = mod_reader_close, .arity = 1, .ret_type = PS_T_VOID, .param_types = NULL, .flags = 0},
   };
   out->module_name = "JSON";
   out->api_version = PS_API_VERSION;
@@ -0,0 +1,137 @@
+#ifndef _POSIX_C_SOURCE
+#define _POSIX_C_SOURCE 200809L
+#endif
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/resource.h>
+
+#include "frontend.h"
+#include "runtime/ps_runtime.h"
+#include "runtime/ps_vm.h"
+#include "runtime/ps_vm_internal.h"
+
+static PS_IR_Module *load_ir_from_file(PS_Context *ctx, const char *file) {
+  PsDiag d;
+  char *buf = NULL;
+  size_t len = 0;
+  FILE *mem = open_memstream(&buf, &len);
+  if (!mem) {
+    fprintf(stderr, "open_memstream failed\n");
+    return NULL;
+  }
+  int rc = ps_emit_ir_json(file, &d, mem);
+  fclose(mem);
+  if (rc != 0) {
+    fprintf(stderr, "%s:%d:%d %s %s: %s\n",
+            d.file ? d.file : file,
+            d.line ? d.line : 1,
+            d.col ? d.col : 1,
+            d.code ? d.code : "E?",
+            d.category ? d.category : "ERROR",
+            d.message[0] ? d.message : "failed to emit IR");
+    free(buf);
+    return NULL;
+  }
+  PS_IR_Module *m = ps_ir_load_json(ctx, buf, len);
+  free(buf);
+  return m;
+}
+
+// ASan's quarantine keeps freed blocks mapped, so peak RSS says nothing about
+// the collector there: the live value count is checked alone.
+#if defined(__SANITIZE_ADDRESS__)
+#define CHECK_RSS 0
+#elif defined(__has_feature)
+#if __has_feature(address_sanitizer)
+#define CHECK_RSS 0
+#endif
+#endif
+#ifndef CHECK_RSS
+#define CHECK_RSS 1
+#endif
+
+static long max_rss_kb(void) {
+  struct rusage ru;
+  if (getrusage(RUSAGE_SELF, &ru) != 0) return 0;
+  return ru.ru_maxrss;
+}
+
+// Runs a program that leaks reference cycles on every round, with the cycle
+// collector enabled: the structure it keeps alive must stay intact (same node
+// count returned by every run), live values must come back to the same level
+// after each run and the process peak RSS must stop growing (not checked
+// under ASan).
+int main(int argc, char **argv) {
+  const char *file = argc > 1 ? argv[1] : "tests/robustness/cycle_churn.pts";
+  const int runs = 12;
+  PS_Context *ctx = ps_ctx_create();
+  if (!ctx) {
+    fprintf(stderr, "ctx create failed\n");
+    return 1;
+  }
+  ps_heap_set_gc(ctx, 1000);
+  PS_IR_Module *m = load_ir_from_file(ctx, file);
+  if (!m) {
+    ps_ctx_destroy(ctx);
+    return 1;
+  }
+
+  int64_t nodes = 0;
+  int64_t base_values = 0;
+  long base_rss = 0;
+  for (int i = 0; i < runs; i++) {
+    PS_Value *ret = NULL;
+    int rc = ps_vm_run_main(ctx, m, NULL, 0, &ret);
+    int64_t count = (ret && ret->tag == PS_V_INT) ? ret->as.int_v : -1;
+    if (ret) ps_value_release(ret);
+    if (rc != 0) {
+      const char *msg = ps_last_error_message(ctx);
+      fprintf(stderr, "run failed at iter %d: %s\n", i, msg ? msg : "error");
+      ps_ir_free(m);
+      ps_ctx_destroy(ctx);
+      return 2;
+    }
+    if (i == 0) nodes = count;
+    if (count <= 0 || count != nodes) {
+      fprintf(stderr, "live tree damaged at iter %d: %lld nodes\n", i, (long long)count);
+      ps_ir_free(m);
+      ps_ctx_destroy(ctx);
+      return 3;
+    }
+    ps_heap_collect(ctx);
+    if (i == 0) {
+      base_values = ctx->heap.live_values;
+    } else if (ctx->heap.live_values != base_values) {
+      fprintf(stderr, "live values drift at iter %d: %lld -> %lld\n", i, (long long)base_values,
+              (long long)ctx->heap.live_values);
+      ps_ir_free(m);
+      ps_ctx_destroy(ctx);
+      return 4;
+    }
+    if (i == 4) base_rss = max_rss_kb();
+  }
+  if (ctx->heap.gc_collected == 0) {
+    fprintf(stderr, "cycle collector freed nothing\n");
+    ps_ir_free(m);
+    ps_ctx_destroy(ctx);
+    return 5;
+  }
+  long rss = max_rss_kb();
+  if (CHECK_RSS && base_rss && rss > base_rss + 8192) {
+    fprintf(stderr, "peak RSS grew from %ld KiB to %ld KiB\n", base_rss, rss);
+    ps_ir_free(m);
+    ps_ctx_destroy(ctx);
+    return 6;
+  }
+  printf("cycle_collect runs=%d nodes=%lld collections=%llu freed=%llu live=%lld\n", runs, (long long)nodes,
+         (unsigned long long)ctx->heap.gc_runs, (unsigned long long)ctx->heap.gc_collected,
+         (long long)ctx->heap.live_values);
+
+  ps_ir_free(m);
+  ps_ctx_destroy(ctx);
+  return 0;
+}
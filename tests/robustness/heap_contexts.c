@@ -0,0 +1,82 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "runtime/ps_runtime.h"
+#include "runtime/ps_list.h"
+
+// Two live contexts keep separate heap accounting: values are charged to the
+// context that created them and refunded there, and the quota of one context
+// is not consumed by the other.
+
+static int fill(PS_Context *ctx, PS_Value *list, int n) {
+  for (int i = 0; i < n; i++) {
+    PS_Value *v = ps_make_string_utf8(ctx, "0123456789abcdef", 16);
+    if (!v) return 0;
+    if (ps_list_push(ctx, list, v) != PS_OK) {
+      ps_value_release(v);
+      return 0;
+    }
+    ps_value_release(v);
+  }
+  return 1;
+}
+
+int main(void) {
+  PS_Context *a = ps_ctx_create();
+  PS_Context *b = ps_ctx_create();
+  if (!a || !b) {
+    fprintf(stderr, "ctx create failed\n");
+    return 1;
+  }
+  PS_HeapStats sa0, sb0, sa, sb;
+  ps_heap_stats(a, &sa0);
+  ps_heap_stats(b, &sb0);
+
+  PS_Value *la = ps_make_list(a);
+  if (!la || !fill(a, la, 10000)) return 2;
+  ps_heap_stats(a, &sa);
+  ps_heap_stats(b, &sb);
+  if (sa.live_values != sa0.live_values + 10001 || sa.string_bytes < 10000 * 17 || sa.list_bytes == 0) {
+    fprintf(stderr, "context A not charged: %zu values\n", sa.live_values);
+    return 3;
+  }
+  if (sb.live_values != sb0.live_values || sb.live_bytes != sb0.live_bytes) {
+    fprintf(stderr, "context B charged for A: %zu values\n", sb.live_values);
+    return 4;
+  }
+
+  // A's allocations do not count against B's quota.
+  ps_heap_set_limit(b, sb.live_bytes + 64 * 1024);
+  PS_Value *lb = ps_make_list(b);
+  if (!lb || !fill(b, lb, 200)) {
+    fprintf(stderr, "context B quota consumed by A\n");
+    return 5;
+  }
+  // ... and B's quota still holds for B.
+  if (fill(b, lb, 100000)) {
+    fprintf(stderr, "context B quota bypassed\n");
+    return 6;
+  }
+  ps_error_clear(b);
+
+  // Releasing A's values, even from B's side, refunds A only.
+  ps_heap_stats(b, &sb);
+  ps_value_release(la);
+  ps_heap_stats(a, &sa);
+  PS_HeapStats sb2;
+  ps_heap_stats(b, &sb2);
+  if (sa.live_values != sa0.live_values || sa.live_bytes != sa0.live_bytes) {
+    fprintf(stderr, "context A not refunded: %zu values\n", sa.live_values);
+    return 7;
+  }
+  if (sb2.live_values != sb.live_values || sb2.live_bytes != sb.live_bytes) {
+    fprintf(stderr, "context B refunded for A\n");
+    return 8;
+  }
+
+  ps_value_release(lb);
+  ps_ctx_destroy(b);
+  ps_ctx_destroy(a);
+  puts("heap_contexts OK");
+  return 0;
+}
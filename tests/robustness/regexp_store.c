@@ -0,0 +1,92 @@
+// The module uses memmem; scripts/build_modules.sh defines _GNU_SOURCE too.
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// The RegExp handle table stays bounded when every compile uses a new
+// pattern: entries past the cache are freed and their slots reused. A value
+// whose entry was freed is rebuilt from its pattern; a reused slot never
+// answers for an old handle. The module is compiled into the test to reach
+// its store.
+#undef ps_module_init
+#define ps_module_init ps_module_init_RegExp
+#include "../../c/modules/regexp.c"
+
+#define PATTERNS 5000
+
+static PS_Value *compile(PS_Context *ctx, const char *pattern) {
+  PS_Value *argv[2] = {ps_make_string_utf8(ctx, pattern, strlen(pattern)), ps_make_string_utf8(ctx, "", 0)};
+  PS_Value *out = NULL;
+  if (!argv[0] || !argv[1] || mod_compile(ctx, 2, argv, &out) != PS_OK) out = NULL;
+  if (argv[0]) ps_value_release(argv[0]);
+  if (argv[1]) ps_value_release(argv[1]);
+  return out;
+}
+
+static int test(PS_Context *ctx, PS_Value *re, const char *input) {
+  PS_Value *argv[3] = {re, ps_make_string_utf8(ctx, input, strlen(input)), ps_make_int(ctx, 0)};
+  PS_Value *out = NULL;
+  int r = -1;
+  if (argv[1] && argv[2] && mod_test(ctx, 3, argv, &out) == PS_OK) r = ps_as_bool(out);
+  if (out) ps_value_release(out);
+  if (argv[1]) ps_value_release(argv[1]);
+  if (argv[2]) ps_value_release(argv[2]);
+  return r;
+}
+
+static int64_t rid(PS_Context *ctx, PS_Value *re) {
+  return ps_as_int(ps_object_get_str(ctx, re, "_rid", 4));
+}
+
+int main(void) {
+  PS_Context *ctx = ps_ctx_create();
+  if (!ctx) return 1;
+  PS_Value *first = compile(ctx, "line-0+");
+  if (!first) return 2;
+  int64_t first_rid = rid(ctx, first);
+
+  char pattern[64];
+  for (int i = 1; i < PATTERNS; i++) {
+    snprintf(pattern, sizeof(pattern), "line-%d+", i);
+    PS_Value *re = compile(ctx, pattern);
+    if (!re || test(ctx, re, pattern) != 1) {
+      fprintf(stderr, "compile/test failed at %d\n", i);
+      return 3;
+    }
+    ps_value_release(re);
+  }
+  RegexStore *st = (RegexStore *)ps_ctx_get_module_data(ctx, "RegExp");
+  if (!st || st->live > RX_CACHE_MAX || st->len > RX_CACHE_MAX + 1 || st->index_cap > 4 * RX_CACHE_MAX) {
+    fprintf(stderr, "store not bounded: live=%zu slots=%zu index=%zu\n", st ? st->live : 0, st ? st->len : 0, st ? st->index_cap : 0);
+    return 4;
+  }
+
+  // A handle held across the churn is rebuilt from its own pattern.
+  if (test(ctx, first, "line-00") != 1 || rid(ctx, first) == first_rid) {
+    fprintf(stderr, "stale handle not rebuilt\n");
+    return 5;
+  }
+  // Without a pattern to rebuild from, the old handle is refused even though
+  // its slot is in use again.
+  PS_Value *forged = ps_make_object(ctx);
+  PS_Value *v_rid = ps_make_int(ctx, first_rid);
+  if (!forged || !v_rid || ps_object_set_str(ctx, forged, "_rid", 4, v_rid) != PS_OK) return 6;
+  ps_value_release(v_rid);
+  if (!st->slots[(first_rid & 0xFFFFFFFF) - 1].entry) {
+    fprintf(stderr, "slot of the first handle not reused\n");
+    return 7;
+  }
+  if (test(ctx, forged, "line-0") != -1 || !strstr(ps_last_error_message(ctx), "unknown RegExp handle")) {
+    fprintf(stderr, "stale handle accepted\n");
+    return 8;
+  }
+  ps_clear_error(ctx);
+
+  printf("regexp_store OK live=%zu slots=%zu\n", st->live, st->len);
+  ps_value_release(forged);
+  ps_value_release(first);
+  ps_ctx_destroy(ctx);
+  return 0;
+}
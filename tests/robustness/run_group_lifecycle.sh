@@ -32,6 +32,7 @@ cc $CFLAGS \
   "$ROOT_DIR/c/runtime/ps_dynlib_posix.c" \
   "$ROOT_DIR/c/runtime/ps_json.c" \
   "$ROOT_DIR/c/runtime/ps_modules.c" \
+  "$ROOT_DIR/c/runtime/ps_profile.c" \
   "$ROOT_DIR/c/runtime/ps_vm.c" \
   "$ROOT_DIR/c/modules/debug.c" \
   "$MCPP_LIB" \
@@ -41,6 +41,7 @@ build_test() {
     "$ROOT_DIR/c/runtime/ps_dynlib_posix.c" \
     "$ROOT_DIR/c/runtime/ps_json.c" \
     "$ROOT_DIR/c/runtime/ps_modules.c" \
+    "$ROOT_DIR/c/runtime/ps_profile.c" \
     "$ROOT_DIR/c/runtime/ps_vm.c" \
     "$ROOT_DIR/c/modules/debug.c" \
     "$MCPP_LIB" \
@@ -55,11 +56,17 @@ build_test "ir_load_loop" "tests/robustness/ir_load_loop.c"
 build_test "proto_clone_stress" "tests/robustness/proto_clone_stress.c"
 build_test "collection_growth" "tests/robustness/collection_growth.c"
 build_test "view_lifetime" "tests/robustness/view_lifetime.c"
+build_test "cycle_collect" "tests/robustness/cycle_collect.c"
+build_test "heap_contexts" "tests/robustness/heap_contexts.c"
+build_test "regexp_store" "tests/robustness/regexp_store.c"
 
 "$OUT_DIR/group_lifecycle" "$ROOT_DIR/stress.pts"
 "$OUT_DIR/ir_load_loop" "$ROOT_DIR/stress.pts"
 "$OUT_DIR/proto_clone_stress" "$ROOT_DIR/tests/edge/proto_clone_stress.pts"
 "$OUT_DIR/collection_growth"
 "$OUT_DIR/view_lifetime"
+"$OUT_DIR/cycle_collect" "$ROOT_DIR/tests/robustness/cycle_churn.pts"
+"$OUT_DIR/heap_contexts"
+"$OUT_DIR/regexp_store"
 
 echo "MEMORY AUDIT OK"
@@ -33,7 +33,7 @@ int main(void) {
     ps_value_release(v);
   }
 
-  PS_Value *view = ps_value_alloc(PS_V_VIEW);
+  PS_Value *view = ps_value_alloc(ctx, PS_V_VIEW);
   if (!view) {
     ps_value_release(list);
     ps_ctx_destroy(ctx);
@@ -3,7 +3,7 @@ set -euo pipefail
 
 ROOT_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")/.." && pwd)"
 
-SEALED_NON_CLONABLE=(TextFile BinaryFile Dir Walker RegExp PathInfo PathEntry RegExpMatch ProcessEvent ProcessResult)
+SEALED_NON_CLONABLE=(TextFile BinaryFile Dir Walker JSONReader RegExp PathInfo PathEntry RegExpMatch ProcessEvent ProcessResult)
 CLONABLE_NON_SEALED=(CivilDateTime)
 
 echo "== Builtin Contract Guard =="
@@ -71,7 +71,7 @@ for h in "${CLONABLE_NON_SEALED[@]}"; do
 done
 
 # 5) Clone not supported expectations remain present for sealed builtins
-for h in textfile binaryfile dir walker regexp pathinfo pathentry regexpmatch processevent processresult; do
+for h in textfile binaryfile dir walker jsonreader regexp pathinfo pathentry regexpmatch processevent processresult; do
   for mode in direct; do
     expect="$ROOT_DIR/tests/edge/handle_clone_${h}_${mode}.expect.json"
     if [[ ! -f "$expect" ]]; then
@@ -94,6 +94,7 @@ for case in \
   "$ROOT_DIR/tests/invalid/type/builtin_sealed_inheritance_textfile.pts" \
   "$ROOT_DIR/tests/invalid/type/builtin_sealed_inheritance_binaryfile.pts" \
   "$ROOT_DIR/tests/invalid/type/builtin_sealed_inheritance_walker.pts" \
+  "$ROOT_DIR/tests/invalid/type/builtin_sealed_inheritance_jsonreader.pts" \
   "$ROOT_DIR/tests/invalid/type/builtin_sealed_inheritance_regexp.pts" \
   "$ROOT_DIR/tests/invalid/type/builtin_sealed_inheritance_dir.pts" \
   "$ROOT_DIR/tests/invalid/type/builtin_sealed_inheritance_pathinfo.pts" \
@@ -118,6 +119,7 @@ for case in \
   "$ROOT_DIR/tests/edge/handle_clone_binaryfile_direct.pts" \
   "$ROOT_DIR/tests/edge/handle_clone_dir_direct.pts" \
   "$ROOT_DIR/tests/edge/handle_clone_walker_direct.pts" \
+  "$ROOT_DIR/tests/edge/handle_clone_jsonreader_direct.pts" \
   "$ROOT_DIR/tests/edge/handle_clone_regexp_direct.pts" \
   "$ROOT_DIR/tests/edge/handle_clone_pathinfo_direct.pts" \
   "$ROOT_DIR/tests/edge/handle_clone_pathentry_direct.pts" \
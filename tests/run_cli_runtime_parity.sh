@@ -6,6 +6,8 @@ TESTS_DIR="$ROOT_DIR/tests"
 MANIFEST="$TESTS_DIR/manifest.json"
 COMPILER="${COMPILER:-$ROOT_DIR/bin/protoscriptc}"
 PS="${PS:-$ROOT_DIR/c/ps}"
+# Extra c/ps options, e.g. PS_FLAGS=--no-fuse to check the unfused VM path.
+PS_FLAGS="${PS_FLAGS:-}"
 CLI_RUNTIME_PARITY_MODULES="${CLI_RUNTIME_PARITY_MODULES:-1}"
 MODULES_BUILT=0
 MODULES_TMP_DIR=""
@@ -52,7 +54,7 @@ normalize_stream() {
 
 echo "== CLI Runtime Parity (protoscriptc --run vs c/ps run) =="
 echo "Node compiler: $COMPILER"
-echo "CLI runtime:   $PS"
+echo "CLI runtime:   $PS${PS_FLAGS:+ $PS_FLAGS}"
 echo
 
 while IFS= read -r case_id; do
@@ -109,7 +111,7 @@ while IFS= read -r case_id; do
   set +e
   "$COMPILER" --run "$src" >"$out_node" 2>"$err_node"
   rc_node=$?
-  "$PS" run "$src" >"$out_cli" 2>"$err_cli"
+  "$PS" $PS_FLAGS run "$src" >"$out_cli" 2>"$err_cli"
   rc_cli=$?
   set -e
   normalize_stream "$out_node" "$out_node_norm"
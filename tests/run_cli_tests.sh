@@ -276,6 +276,29 @@ expect_node_c_run_parity() {
   fi
 }
 
+expect_fuse_parity() {
+  local desc="$1"
+  local src="$2"
+  set +e
+  "$PS" run "$src" >/tmp/ps_cli_fused.out 2>&1
+  local rc_fused=$?
+  "$PS" --no-fuse run "$src" >/tmp/ps_cli_unfused.out 2>&1
+  local rc_unfused=$?
+  set -e
+  if [[ "$rc_fused" -eq "$rc_unfused" ]] && cmp -s /tmp/ps_cli_fused.out /tmp/ps_cli_unfused.out; then
+    echo "PASS $desc"
+    pass=$((pass + 1))
+  else
+    echo "FAIL $desc"
+    echo "  c/ps run differs from c/ps --no-fuse run (rc $rc_fused vs $rc_unfused)"
+    echo "  fused output:"
+    sed -n '1,80p' /tmp/ps_cli_fused.out
+    echo "  unfused output:"
+    sed -n '1,80p' /tmp/ps_cli_unfused.out
+    fail=$((fail + 1))
+  fi
+}
+
 expect_token_dump_parity() {
   local desc="$1"
   local src="$2"
@@ -427,6 +450,27 @@ expect_output_contains "ir outputs" "\"functions\"" "$PS" ir "$ROOT_DIR/tests/cl
 expect_exit "trace enabled" 0 "$PS" run "$ROOT_DIR/tests/cli/hello.pts" --trace
 expect_output_contains "trace-ir enabled" "[ir]" "$PS" run "$ROOT_DIR/tests/cli/hello.pts" --trace-ir
 expect_output_contains "time enabled" "time:" "$PS" run "$ROOT_DIR/tests/cli/hello.pts" --time
+expect_output_contains "time phases" "module_load" "$PS" run "$ROOT_DIR/tests/cli/hello.pts" --time
+expect_output_contains "time json" "\"peak_live_values\"" "$PS" run "$ROOT_DIR/tests/cli/hello.pts" --time=json
+expect_output_contains "profile report" "functions (by exclusive time):" "$PS" run "$ROOT_DIR/tests/cli/hello.pts" --profile
+expect_output_contains "profile json" "\"exclusive_ms\"" bash -c "\"$PS\" run \"$ROOT_DIR/tests/cli/hello.pts\" --profile=/tmp/ps_cli_profile.json && cat /tmp/ps_cli_profile.json"
+expect_output_contains "sample profile folded" "main (" bash -c "\"$PS\" run \"$ROOT_DIR/tests/cli/tail_recursion_deep.pts\" --sample-profile=/tmp/ps_cli_profile.folded && cat /tmp/ps_cli_profile.folded"
+expect_output_contains "sample profile chrome trace" "\"traceEvents\"" bash -c "\"$PS\" run \"$ROOT_DIR/tests/cli/tail_recursion_deep.pts\" --sample-profile=/tmp/ps_cli_profile.json && cat /tmp/ps_cli_profile.json"
+expect_node_c_run_parity "heap stats keys parity" "$ROOT_DIR/tests/cli/heap_stats.pts"
+expect_output_contains "loop temps released at last use" "loop temps released" "$PS" run "$ROOT_DIR/tests/cli/heap_loop_temps.pts"
+expect_output_contains "max-heap catchable oom" "recovered" "$PS" run "$ROOT_DIR/tests/cli/heap_limit.pts" --max-heap=2M
+expect_error_contains "max-heap invalid size" "invalid --max-heap size" "$PS" run "$ROOT_DIR/tests/cli/hello.pts" --max-heap=12X
+expect_output_contains "heap report leak site" "heap_leak_cycle.pts:9" "$PS" run "$ROOT_DIR/tests/cli/heap_leak_cycle.pts" --heap-report
+expect_output_contains "heap snapshot json" "\"retained\"" bash -c "\"$PS\" run \"$ROOT_DIR/tests/cli/heap_leak_cycle.pts\" /tmp/ps_cli_heap_snapshot.json --heap-report && cat /tmp/ps_cli_heap_snapshot.json"
+expect_output_contains "gc-cycles collects leaked cycles" "heap: 0 live values" "$PS" run "$ROOT_DIR/tests/cli/heap_leak_cycle.pts" --gc-cycles --heap-report
+expect_error_contains "gc-cycles invalid threshold" "invalid --gc-cycles threshold" "$PS" run "$ROOT_DIR/tests/cli/hello.pts" --gc-cycles=0
+expect_output_contains "deep chain release" "released" "$PS" run "$ROOT_DIR/tests/cli/deep_chain_release.pts"
+expect_output_contains "gc-cycles large acyclic chain" "released" timeout 20 "$PS" run "$ROOT_DIR/tests/cli/deep_chain_release.pts" --gc-cycles=1
+expect_output_contains "free-budget deferred release" "released" "$PS" run "$ROOT_DIR/tests/cli/deep_chain_release.pts" --free-budget=50
+expect_error_contains "free-budget invalid count" "invalid --free-budget count" "$PS" run "$ROOT_DIR/tests/cli/hello.pts" --free-budget=x
+expect_fuse_parity "no-fuse parity typed ops" "$ROOT_DIR/tests/edge/vm_typed_ops.pts"
+expect_fuse_parity "no-fuse parity int overflow" "$ROOT_DIR/tests/edge/vm_fused_overflow.pts"
+expect_output_contains "tail recursion constant stack" "1000000" "$PS" run "$ROOT_DIR/tests/cli/tail_recursion_deep.pts"
 expect_output_contains "pscc emit-c outputs C" "int main" "$ROOT_DIR/c/pscc" --emit-c "$ROOT_DIR/tests/cli/exit_code.pts"
 expect_token_dump_parity "token dump parity generic context" "$ROOT_DIR/tests/edge/generic_token_parity.pts"
 
@@ -40,6 +40,7 @@ fi
 
 pass=0
 fail=0
+skip=0
 
 echo "== Runtime Crosscheck (Node runtime vs C runtime) =="
 echo "Compiler: $COMPILER"
@@ -62,6 +63,14 @@ while IFS= read -r case_id; do
     continue
   fi
 
+  # Cases relying on a feature the emit-c runtime does not lower give the reason.
+  skip_reason="$(jq -r '.emit_c_skip // empty' "$expect")"
+  if [[ -n "$skip_reason" ]]; then
+    echo "SKIP $case_id ($skip_reason)"
+    skip=$((skip + 1))
+    continue
+  fi
+
   expected_code="$(jq -r '.error_code // empty' "$expect")"
   expected_cat="$(jq -r '.category // empty' "$expect")"
   expected_stdout="$(jq -r '.expected_stdout // empty' "$expect")"
@@ -129,7 +138,7 @@ while IFS= read -r case_id; do
 done < <(jq -r '.suites | to_entries[] | .value[]' "$MANIFEST")
 
 echo
-echo "Summary: PASS=$pass FAIL=$fail TOTAL=$((pass + fail))"
+echo "Summary: PASS=$pass FAIL=$fail SKIP=$skip TOTAL=$((pass + fail + skip))"
 if [[ "$fail" -ne 0 ]]; then
   rm -f "$TESTS_DIR/.runtime_crosscheck_passed"
   exit 1
@@ -128,6 +128,13 @@ while IFS= read -r case_id; do
     continue
   fi
 
+  skip_reason="$(jq -r '.emit_c_skip // empty' "$expect")"
+  if [[ -n "$skip_reason" ]]; then
+    echo "SKIP $case_id ($skip_reason)"
+    skip=$((skip + 1))
+    continue
+  fi
+
   requires_modules="$(jq -r '.requires | index("modules") // empty' "$expect")"
   if [[ -n "$requires_modules" && "$TRIANGLE_PARITY_MODULES" != "1" ]]; then
     echo "SKIP $case_id (modules not enabled)"
@@ -119,6 +119,7 @@ const methodsByType = {
   BinaryFile: ["read", "write", "seek", "tell", "size", "name", "close"],
   Dir: ["hasNext", "next", "close", "reset"],
   Walker: ["hasNext", "next", "close"],
+  JSONReader: ["hasNext", "next", "nextEvent", "key", "value", "close"],
   JSONValue: ["isNull", "isBool", "isNumber", "isString", "isArray", "isObject", "asBool", "asNumber", "asString", "asArray", "asObject"],
   RegExp: ["test", "find", "findAll", "replaceFirst", "replaceAll", "split", "pattern", "flags"],
 };
@@ -221,12 +222,12 @@ for (const [type, methods] of Object.entries(methodsByType)) {
     const sym = `${type}.${m}()`;
     const cLoc = firstLineContaining("c/frontend.c", `\"${m}\"`);
     const nLoc = firstLineContaining("src/runtime.js", `\"${m}\"`);
-    entries.push(entry(sym, "method", type.startsWith("RegExp") || type.startsWith("JSONValue") || type.startsWith("TextFile") || type.startsWith("BinaryFile") || type.startsWith("Dir") || type.startsWith("Walker") ? "STDLIB" : "CORE", [cLoc, nLoc], `Built-in method ${m} on ${type}.`, { c: true, node: true }));
+    entries.push(entry(sym, "method", type.startsWith("RegExp") || type.startsWith("JSONValue") || type.startsWith("JSONReader") || type.startsWith("TextFile") || type.startsWith("BinaryFile") || type.startsWith("Dir") || type.startsWith("Walker") ? "STDLIB" : "CORE", [cLoc, nLoc], `Built-in method ${m} on ${type}.`, { c: true, node: true }));
   }
 }
 
 const cExceptions = [
-  "Exception", "RuntimeException", "CivilDateTime", "PathInfo", "PathEntry", "Dir", "Walker", "RegExpMatch",
+  "Exception", "RuntimeException", "CivilDateTime", "PathInfo", "PathEntry", "Dir", "Walker", "JSONReader", "RegExpMatch",
   "DSTAmbiguousTimeException", "DSTNonExistentTimeException", "InvalidTimeZoneException", "InvalidDateException", "InvalidISOFormatException",
   "InvalidModeException", "FileOpenException", "FileNotFoundException", "PermissionDeniedException", "InvalidPathException", "FileClosedException", "InvalidArgumentException", "InvalidGlyphPositionException", "ReadFailureException", "WriteFailureException", "Utf8DecodeException", "StandardStreamCloseException", "IOException",
 ];
@@ -282,7 +283,7 @@ Official modules from registry (non-test):
 
 - ${modules.filter((m) => !String(m.name).startsWith("test.")).map((m) => `\`${m.name}\``).join("\n- ")}
 
-Exposed types include: \`TextFile\`, \`BinaryFile\`, \`JSONValue\`, \`CivilDateTime\`, \`PathInfo\`, \`PathEntry\`, \`Dir\`, \`Walker\`, \`RegExp\`, \`RegExpMatch\`.
+Exposed types include: \`TextFile\`, \`BinaryFile\`, \`JSONValue\`, \`JSONReader\`, \`CivilDateTime\`, \`PathInfo\`, \`PathEntry\`, \`Dir\`, \`Walker\`, \`RegExp\`, \`RegExpMatch\`.
 
 ## 3. Runtime-only Constructs
 
@@ -168,14 +168,19 @@ const registryJson = String.raw`{
       "name": "JSON",
       "functions": [
         { "name": "encode", "ret": "string", "params": ["JSONValue"] },
+        { "name": "encodeTo", "ret": "void", "params": ["TextFile", "JSONValue"] },
         { "name": "decode", "ret": "JSONValue", "params": ["string"] },
+        { "name": "decodeAs", "ret": "JSONValue", "params": ["string"] },
         { "name": "isValid", "ret": "bool", "params": ["string"] },
         { "name": "null", "ret": "JSONValue", "params": [] },
         { "name": "bool", "ret": "JSONValue", "params": ["bool"] },
         { "name": "number", "ret": "JSONValue", "params": ["float"] },
         { "name": "string", "ret": "JSONValue", "params": ["string"] },
         { "name": "array", "ret": "JSONValue", "params": ["list<JSONValue>"] },
-        { "name": "object", "ret": "JSONValue", "params": ["map<string,JSONValue>"] }
+        { "name": "object", "ret": "JSONValue", "params": ["map<string,JSONValue>"] },
+        { "name": "reader", "ret": "JSONReader", "params": ["TextFile"] },
+        { "name": "readArray", "ret": "JSONReader", "params": ["TextFile"] },
+        { "name": "readLines", "ret": "JSONReader", "params": ["TextFile"] }
       ]
     }
   ]